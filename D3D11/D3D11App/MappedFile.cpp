@@ -0,0 +1,145 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <string>
+#endif
+
+MappedFile::MappedFile()
+{
+	data = 0;
+	size = 0;
+#ifdef _WIN32
+	fileHandle = INVALID_HANDLE_VALUE;
+	mappingHandle = 0;
+#else
+	fileDescriptor = -1;
+#endif
+}
+
+MappedFile::MappedFile(const wchar_t* fileName) : MappedFile()
+{
+	Open(fileName);
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+// --------------------------------------------------------
+// Maps the whole file into the address space of this process
+//
+// Returns false if the file can't be opened or is empty,
+// in which case no data is available
+// --------------------------------------------------------
+bool MappedFile::Open(const wchar_t* fileName)
+{
+	Close();
+
+#ifdef _WIN32
+	fileHandle = CreateFileW(
+		fileName,
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		0,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, // Hint that we'll read front to back
+		0);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize{};
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+
+	mappingHandle = CreateFileMappingW(fileHandle, 0, PAGE_READONLY, 0, 0, 0);
+	if (!mappingHandle)
+	{
+		Close();
+		return false;
+	}
+
+	data = (const char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if (!data)
+	{
+		Close();
+		return false;
+	}
+
+	size = (size_t)fileSize.QuadPart;
+#else
+	// POSIX paths are narrow, so convert using the current locale
+	std::string narrowName(wcstombs(0, fileName, 0), '\0');
+	wcstombs(&narrowName[0], fileName, narrowName.size());
+
+	fileDescriptor = open(narrowName.c_str(), O_RDONLY);
+	if (fileDescriptor < 0)
+		return false;
+
+	struct stat fileStats {};
+	if (fstat(fileDescriptor, &fileStats) != 0 || fileStats.st_size == 0)
+	{
+		Close();
+		return false;
+	}
+
+	void* view = mmap(0, (size_t)fileStats.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	if (view == MAP_FAILED)
+	{
+		Close();
+		return false;
+	}
+
+	madvise(view, (size_t)fileStats.st_size, MADV_SEQUENTIAL);
+	data = (const char*)view;
+	size = (size_t)fileStats.st_size;
+#endif
+
+	return true;
+}
+
+// --------------------------------------------------------
+// Unmaps the view and releases the OS handles, if any
+// --------------------------------------------------------
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (data) UnmapViewOfFile(data);
+	if (mappingHandle) CloseHandle(mappingHandle);
+	if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+	mappingHandle = 0;
+	fileHandle = INVALID_HANDLE_VALUE;
+#else
+	if (data) munmap((void*)data, size);
+	if (fileDescriptor >= 0) close(fileDescriptor);
+	fileDescriptor = -1;
+#endif
+
+	data = 0;
+	size = 0;
+}
+
+bool MappedFile::IsOpen()
+{
+	return data != 0;
+}
+
+const char* MappedFile::GetData()
+{
+	return data;
+}
+
+size_t MappedFile::GetSize()
+{
+	return size;
+}
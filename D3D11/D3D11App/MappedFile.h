@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+
+// --------------------------------------------------------
+// A read-only, memory-mapped view of an entire file
+//
+// The file's contents are accessed in place through the OS
+// page cache, so nothing is copied into a user buffer.
+// --------------------------------------------------------
+class MappedFile
+{
+public:
+
+	MappedFile();
+	MappedFile(const wchar_t* fileName);
+	~MappedFile();
+
+	// Mappings own OS handles, so they can't be copied
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const wchar_t* fileName);
+	void Close();
+
+	bool IsOpen();
+	const char* GetData();
+	size_t GetSize();
+
+private:
+
+	const char* data;
+	size_t size;
+
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+};
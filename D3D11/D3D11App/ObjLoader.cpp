@@ -0,0 +1,444 @@
+#include "ObjLoader.h"
+#include "MappedFile.h"
+#include "VertexWelder.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace ObjLoader
+{
+	// Annonymous namespace to hold helpers
+	// only accessible in this file
+	namespace
+	{
+		// Every power of ten that a double can represent exactly, which
+		// lets us scale a parsed mantissa with a single correctly-rounded op
+		const double exactPowersOf10[] =
+		{
+			1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+			1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+			1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+
+		inline bool IsDigit(char c) { return (unsigned char)(c - '0') < 10; }
+		inline bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+		inline const char* SkipSpaces(const char* p, const char* end)
+		{
+			while (p < end && IsSpace(*p)) p++;
+			return p;
+		}
+
+		inline const char* SkipLine(const char* p, const char* end)
+		{
+			const char* newline = (const char*)memchr(p, '\n', end - p);
+			return newline ? newline + 1 : end;
+		}
+
+		// --------------------------------------------------------
+		// Reads a decimal float (optional sign, fraction and exponent)
+		// starting at p, skipping any leading spaces. Leaves out untouched
+		// and returns p if there is no number there.
+		// --------------------------------------------------------
+		const char* ScanFloat(const char* p, const char* end, float& out)
+		{
+			const char* start = p = SkipSpaces(p, end);
+
+			bool negative = false;
+			if (p < end && (*p == '-' || *p == '+'))
+			{
+				negative = *p == '-';
+				p++;
+			}
+
+			// Only the first 19 significant digits fit in the mantissa,
+			// any extras just shift the exponent
+			unsigned long long mantissa = 0;
+			int significantDigits = 0;
+			int exponent = 0;
+			bool anyDigits = false;
+
+			while (p < end && IsDigit(*p))
+			{
+				if (significantDigits < 19)
+				{
+					mantissa = mantissa * 10 + (*p - '0');
+					if (mantissa) significantDigits++;
+				}
+				else
+					exponent++;
+
+				anyDigits = true;
+				p++;
+			}
+
+			if (p < end && *p == '.')
+			{
+				p++;
+				while (p < end && IsDigit(*p))
+				{
+					if (significantDigits < 19)
+					{
+						mantissa = mantissa * 10 + (*p - '0');
+						if (mantissa) significantDigits++;
+						exponent--;
+					}
+
+					anyDigits = true;
+					p++;
+				}
+			}
+
+			if (!anyDigits)
+				return start;
+
+			if (p < end && (*p == 'e' || *p == 'E'))
+			{
+				const char* e = p + 1;
+				bool negativeExponent = false;
+				if (e < end && (*e == '-' || *e == '+'))
+				{
+					negativeExponent = *e == '-';
+					e++;
+				}
+
+				// Only treat this as an exponent if digits follow
+				if (e < end && IsDigit(*e))
+				{
+					int value = 0;
+					while (e < end && IsDigit(*e))
+					{
+						if (value < 10000) value = value * 10 + (*e - '0');
+						e++;
+					}
+
+					exponent += negativeExponent ? -value : value;
+					p = e;
+				}
+			}
+
+			double result = (double)mantissa;
+			if (exponent < 0)
+				result = -exponent <= 22 ? result / exactPowersOf10[-exponent] : result * std::pow(10.0, exponent);
+			else if (exponent > 0)
+				result = exponent <= 22 ? result * exactPowersOf10[exponent] : result * std::pow(10.0, exponent);
+
+			out = (float)(negative ? -result : result);
+			return p;
+		}
+
+		// --------------------------------------------------------
+		// Reads a (possibly negative) decimal integer starting at p.
+		// Leaves out untouched and returns p if there is no number.
+		// --------------------------------------------------------
+		const char* ScanInt(const char* p, const char* end, int& out)
+		{
+			const char* start = p;
+
+			bool negative = false;
+			if (p < end && (*p == '-' || *p == '+'))
+			{
+				negative = *p == '-';
+				p++;
+			}
+
+			if (p >= end || !IsDigit(*p))
+				return start;
+
+			int value = 0;
+			while (p < end && IsDigit(*p))
+			{
+				value = value * 10 + (*p - '0');
+				p++;
+			}
+
+			out = negative ? -value : value;
+			return p;
+		}
+
+		// --------------------------------------------------------
+		// Open-addressing hash table from a corner's 1-based
+		// (position, uv, normal) index triple to the vertex built
+		// for it. Position indices are never zero, so a zero
+		// position marks an empty slot.
+		// --------------------------------------------------------
+		class CornerTable
+		{
+		public:
+
+			void Reserve(size_t expectedCorners)
+			{
+				size_t capacity = 64;
+				while (capacity < expectedCorners * 2)
+					capacity *= 2;
+				Rehash(capacity);
+			}
+
+			// Returns the vertex already mapped to this triple, or maps
+			// it to newVertex and returns that if it hasn't been seen
+			unsigned int FindOrInsert(int pos, int uv, int normal, unsigned int newVertex)
+			{
+				if ((used + 1) * 2 > slots.size())
+					Rehash(slots.size() * 2);
+
+				size_t i = Hash(pos, uv, normal) & mask;
+				while (slots[i].pos != 0)
+				{
+					if (slots[i].pos == pos && slots[i].uv == uv && slots[i].normal == normal)
+						return slots[i].vertex;
+					i = (i + 1) & mask;
+				}
+
+				slots[i] = { pos, uv, normal, newVertex };
+				used++;
+				return newVertex;
+			}
+
+		private:
+
+			struct Slot
+			{
+				int pos, uv, normal;
+				unsigned int vertex;
+			};
+
+			std::vector<Slot> slots;
+			size_t mask = 0;
+			size_t used = 0;
+
+			static size_t Hash(int pos, int uv, int normal)
+			{
+				unsigned long long h = (unsigned int)pos;
+				h = h * 0x9E3779B97F4A7C15ull ^ (unsigned int)uv;
+				h = h * 0x9E3779B97F4A7C15ull ^ (unsigned int)normal;
+				return (size_t)((h * 0x9E3779B97F4A7C15ull) >> 20);
+			}
+
+			void Rehash(size_t capacity)
+			{
+				if (capacity < 64) capacity = 64;
+				std::vector<Slot> old;
+				old.swap(slots);
+				slots.assign(capacity, Slot{});
+				mask = capacity - 1;
+
+				for (Slot& s : old)
+				{
+					if (s.pos == 0) continue;
+					size_t i = Hash(s.pos, s.uv, s.normal) & mask;
+					while (slots[i].pos != 0)
+						i = (i + 1) & mask;
+					slots[i] = s;
+				}
+			}
+		};
+
+		// --------------------------------------------------------
+		// Quickly counts each kind of record so the parse can size
+		// its arrays once instead of growing them repeatedly
+		// --------------------------------------------------------
+		void CountRecords(const char* p, const char* end,
+			size_t& positionCount, size_t& uvCount, size_t& normalCount, size_t& faceCount)
+		{
+			positionCount = uvCount = normalCount = faceCount = 0;
+			while (p + 1 < end)
+			{
+				if (p[0] == 'v')
+				{
+					if (p[1] == 'n') normalCount++;
+					else if (p[1] == 't') uvCount++;
+					else positionCount++;
+				}
+				else if (p[0] == 'f')
+					faceCount++;
+
+				p = SkipLine(p, end);
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Memory-maps the given .OBJ file and parses it in place
+//
+// fileName    - Path to the .obj file
+// verts       - Receives the final vertices
+// indices     - Receives the final triangle list indices
+// weldEpsilon - If positive, also merge vertices that are
+//               this close after the exact v/vt/vn weld
+//
+// Returns false if the file could not be opened
+// --------------------------------------------------------
+bool ObjLoader::LoadFile(const wchar_t* fileName, std::vector<Vertex>& verts, std::vector<unsigned int>& indices, float weldEpsilon)
+{
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	MappedFile file(fileName);
+	if (!file.IsOpen())
+		return false;
+
+	Parse(file.GetData(), file.GetSize(), verts, indices);
+
+	// Report throughput so slow assets are easy to spot in the console
+	std::chrono::duration<double> seconds = std::chrono::high_resolution_clock::now() - startTime;
+	double megabytes = file.GetSize() / (1024.0 * 1024.0);
+	printf("Parsed %ls: %.2f MB in %.2f ms (%.1f MB/s)\n",
+		fileName, megabytes, seconds.count() * 1000.0, megabytes / seconds.count());
+
+	// Compare against one vertex per corner, which is what we'd have without welding
+	WeldStats indexWeld;
+	indexWeld.verticesBefore = indices.size();
+	indexWeld.verticesAfter = verts.size();
+	indexWeld.bytesBefore = indices.size() * (sizeof(Vertex) + sizeof(unsigned int));
+	indexWeld.bytesAfter = verts.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned int);
+	VertexWelder::PrintStats("Index weld", indexWeld);
+
+	if (weldEpsilon > 0.0f)
+		VertexWelder::PrintStats("Distance weld", VertexWelder::WeldByDistance(verts, indices, weldEpsilon));
+
+	return true;
+}
+
+// --------------------------------------------------------
+// Parses .OBJ text, supporting positions, uvs and normals
+//
+// Like the original loader, this converts the right-handed
+// model to DirectX's left-handed space by inverting Z on
+// positions and normals, flipping the winding order and
+// flipping the V texture coordinate.
+// --------------------------------------------------------
+void ObjLoader::Parse(const char* data, size_t size, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	verts.clear();
+	indices.clear();
+
+	// Variables used while reading the file
+	std::vector<XMFLOAT3> positions;	// Positions from the file
+	std::vector<XMFLOAT3> normals;		// Normals from the file
+	std::vector<XMFLOAT2> uvs;			// UVs from the file
+
+	const char* p = data;
+	const char* end = data + size;
+
+	// Reserve up front, assuming mostly triangles
+	size_t positionCount, uvCount, normalCount, faceCount;
+	CountRecords(p, end, positionCount, uvCount, normalCount, faceCount);
+	positions.reserve(positionCount);
+	uvs.reserve(uvCount);
+	normals.reserve(normalCount);
+	verts.reserve(positionCount);
+	indices.reserve(faceCount * 3);
+
+	// Maps each unique v/vt/vn triple to its vertex
+	CornerTable cornerTable;
+	cornerTable.Reserve(positionCount);
+
+	while (p < end)
+	{
+		p = SkipSpaces(p, end);
+		if (p + 1 >= end)
+			break;
+
+		if (p[0] == 'v' && p[1] == 'n')
+		{
+			XMFLOAT3 norm(0, 0, 0);
+			const char* q = ScanFloat(p + 2, end, norm.x);
+			q = ScanFloat(q, end, norm.y);
+			ScanFloat(q, end, norm.z);
+			normals.push_back(norm);
+		}
+		else if (p[0] == 'v' && p[1] == 't')
+		{
+			XMFLOAT2 uv(0, 0);
+			const char* q = ScanFloat(p + 2, end, uv.x);
+			ScanFloat(q, end, uv.y);
+			uvs.push_back(uv);
+		}
+		else if (p[0] == 'v' && IsSpace(p[1]))
+		{
+			XMFLOAT3 pos(0, 0, 0);
+			const char* q = ScanFloat(p + 1, end, pos.x);
+			q = ScanFloat(q, end, pos.y);
+			ScanFloat(q, end, pos.z);
+			positions.push_back(pos);
+		}
+		else if (p[0] == 'f' && IsSpace(p[1]))
+		{
+			// Read up to four v/vt/vn corners, where vt and vn are optional
+			int corners[4][3]{};
+			int cornerCount = 0;
+			bool valid = true;
+
+			const char* q = p + 1;
+			while (cornerCount < 4)
+			{
+				q = SkipSpaces(q, end);
+
+				int* corner = corners[cornerCount];
+				const char* next = ScanInt(q, end, corner[0]);
+				if (next == q)
+					break;
+
+				q = next;
+				if (q < end && *q == '/')
+				{
+					q = ScanInt(q + 1, end, corner[1]);
+					if (q < end && *q == '/')
+						q = ScanInt(q + 1, end, corner[2]);
+				}
+
+				// OBJ indices are 1-based (zero here means "not given")
+				valid = valid &&
+					corner[0] >= 1 && corner[0] <= (int)positions.size() &&
+					corner[1] >= 0 && corner[1] <= (int)uvs.size() &&
+					corner[2] >= 0 && corner[2] <= (int)normals.size();
+				cornerCount++;
+			}
+
+			if (valid && cornerCount >= 3)
+			{
+				// Find or create the vertex for each corner, so corners
+				// that share a v/vt/vn triple share a single vertex
+				unsigned int cornerVerts[4]{};
+				for (int c = 0; c < cornerCount; c++)
+				{
+					int* corner = corners[c];
+					unsigned int newIndex = (unsigned int)verts.size();
+					cornerVerts[c] = cornerTable.FindOrInsert(corner[0], corner[1], corner[2], newIndex);
+					if (cornerVerts[c] != newIndex)
+						continue;
+
+					Vertex v{};
+					v.Position = positions[corner[0] - 1];
+					v.UV = corner[1] > 0 ? uvs[corner[1] - 1] : XMFLOAT2(0, 0);
+					v.Normal = corner[2] > 0 ? normals[corner[2] - 1] : XMFLOAT3(0, 0, 0);
+
+					// Flip the UV since it's probably "upside down", then
+					// flip Z on the position and normal (RH to LH)
+					v.UV.y = 1.0f - v.UV.y;
+					v.Position.z *= -1.0f;
+					v.Normal.z *= -1.0f;
+					verts.push_back(v);
+				}
+
+				// Add the triangle(s), flipping the winding order
+				indices.push_back(cornerVerts[0]);
+				indices.push_back(cornerVerts[2]);
+				indices.push_back(cornerVerts[1]);
+
+				if (cornerCount == 4)
+				{
+					indices.push_back(cornerVerts[0]);
+					indices.push_back(cornerVerts[3]);
+					indices.push_back(cornerVerts[2]);
+				}
+			}
+		}
+
+		p = SkipLine(p, end);
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Fast .OBJ loading
+//
+// Files are memory-mapped and parsed in place with a small
+// hand-written number scanner, so there are no per-line
+// copies and no locale-dependent sscanf calls. Supports
+// positions, uvs and normals on triangle and quad faces,
+// converting to DirectX's left-handed conventions exactly
+// like the original line-by-line loader did.
+//
+// Corners that share the same v/vt/vn index triple are
+// welded into a single vertex, so the index buffer actually
+// shares vertices between triangles.
+// --------------------------------------------------------
+namespace ObjLoader
+{
+	// Load and parse the given file, replacing the contents of verts and indices.
+	// A positive weldEpsilon additionally merges nearly-identical vertices.
+	bool LoadFile(const wchar_t* fileName, std::vector<Vertex>& verts, std::vector<unsigned int>& indices, float weldEpsilon = 0.0f);
+
+	// Parse an in-memory .OBJ file (does not need to be null terminated)
+	void Parse(const char* data, size_t size, std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+}
@@ -0,0 +1,147 @@
+#include "VertexWelder.h"
+
+#include <cmath>
+#include <cstdio>
+#include <unordered_map>
+
+namespace VertexWelder
+{
+	// Annonymous namespace to hold helpers
+	// only accessible in this file
+	namespace
+	{
+		inline bool Near(float a, float b, float epsilon) { return std::fabs(a - b) <= epsilon; }
+
+		bool NearlyEqual(const Vertex& a, const Vertex& b, float epsilon)
+		{
+			return
+				Near(a.Position.x, b.Position.x, epsilon) &&
+				Near(a.Position.y, b.Position.y, epsilon) &&
+				Near(a.Position.z, b.Position.z, epsilon) &&
+				Near(a.Normal.x, b.Normal.x, epsilon) &&
+				Near(a.Normal.y, b.Normal.y, epsilon) &&
+				Near(a.Normal.z, b.Normal.z, epsilon) &&
+				Near(a.UV.x, b.UV.x, epsilon) &&
+				Near(a.UV.y, b.UV.y, epsilon);
+		}
+
+		// Packs a grid cell's coordinates into a single hash key
+		inline unsigned long long CellKey(long long x, long long y, long long z)
+		{
+			return
+				((unsigned long long)(x & 0x1FFFFF) << 42) |
+				((unsigned long long)(y & 0x1FFFFF) << 21) |
+				((unsigned long long)(z & 0x1FFFFF));
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Welds vertices by distance using a uniform grid of
+// epsilon-sized cells. Each vertex is compared against the
+// already-kept vertices in its own and neighboring cells,
+// so the first vertex of each cluster is the one that stays.
+//
+// verts   - Vertices to weld (compacted in place)
+// indices - Triangle list indices (remapped in place)
+// epsilon - Maximum per-component difference to merge
+// --------------------------------------------------------
+WeldStats VertexWelder::WeldByDistance(std::vector<Vertex>& verts, std::vector<unsigned int>& indices, float epsilon)
+{
+	WeldStats stats;
+	stats.verticesBefore = verts.size();
+	stats.bytesBefore = verts.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned int);
+
+	if (epsilon > 0.0f && !verts.empty())
+	{
+		float cellScale = 1.0f / epsilon;
+
+		// Each cell holds a linked list of kept vertices (through nextInCell)
+		std::unordered_map<unsigned long long, unsigned int> cellHeads;
+		std::vector<unsigned int> nextInCell;
+		std::vector<unsigned int> remap(verts.size());
+		const unsigned int endOfList = 0xFFFFFFFF;
+
+		cellHeads.reserve(verts.size());
+		nextInCell.reserve(verts.size());
+
+		unsigned int keptCount = 0;
+		for (size_t i = 0; i < verts.size(); i++)
+		{
+			const Vertex& v = verts[i];
+			long long cx = (long long)std::floor(v.Position.x * cellScale);
+			long long cy = (long long)std::floor(v.Position.y * cellScale);
+			long long cz = (long long)std::floor(v.Position.z * cellScale);
+
+			// Search the 3x3x3 block of cells around this vertex
+			unsigned int match = endOfList;
+			for (long long dx = -1; dx <= 1 && match == endOfList; dx++)
+				for (long long dy = -1; dy <= 1 && match == endOfList; dy++)
+					for (long long dz = -1; dz <= 1 && match == endOfList; dz++)
+					{
+						auto cell = cellHeads.find(CellKey(cx + dx, cy + dy, cz + dz));
+						if (cell == cellHeads.end())
+							continue;
+
+						for (unsigned int k = cell->second; k != endOfList; k = nextInCell[k])
+						{
+							if (NearlyEqual(verts[k], v, epsilon))
+							{
+								match = k;
+								break;
+							}
+						}
+					}
+
+			if (match != endOfList)
+			{
+				remap[i] = match;
+				continue;
+			}
+
+			// Keep this vertex, compacting it towards the front
+			verts[keptCount] = v;
+			remap[i] = keptCount;
+
+			unsigned int& head = cellHeads.try_emplace(CellKey(cx, cy, cz), endOfList).first->second;
+			nextInCell.push_back(head);
+			head = keptCount;
+			keptCount++;
+		}
+
+		verts.resize(keptCount);
+
+		// Remap the triangles, dropping any that became degenerate
+		size_t outIndex = 0;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			unsigned int a = remap[indices[i]];
+			unsigned int b = remap[indices[i + 1]];
+			unsigned int c = remap[indices[i + 2]];
+			if (a == b || b == c || a == c)
+				continue;
+
+			indices[outIndex++] = a;
+			indices[outIndex++] = b;
+			indices[outIndex++] = c;
+		}
+		indices.resize(outIndex);
+	}
+
+	stats.verticesAfter = verts.size();
+	stats.bytesAfter = verts.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned int);
+	return stats;
+}
+
+// --------------------------------------------------------
+// Prints the before/after vertex counts and sizes
+// --------------------------------------------------------
+void VertexWelder::PrintStats(const char* label, const WeldStats& stats)
+{
+	printf("  %s: %zu -> %zu vertices, %.1f KB -> %.1f KB\n",
+		label,
+		stats.verticesBefore,
+		stats.verticesAfter,
+		stats.bytesBefore / 1024.0,
+		stats.bytesAfter / 1024.0);
+}
@@ -11,6 +11,24 @@ struct VSExternalData
 	DirectX::XMFLOAT4X4 worldInverseTranspose;
 	DirectX::XMFLOAT4X4 view;
 	DirectX::XMFLOAT4X4 proj;
+
+	// Decodes the mesh's packed positions (see VertexPacking.h)
+	DirectX::XMFLOAT3 positionScale;
+	float padding0;
+	DirectX::XMFLOAT3 positionOffset;
+	float padding1;
+};
+
+// One material in the bindless material buffer (match MaterialData
+// in PixelShader.hlsl). Texture indices are bindless texture slots.
+struct MaterialGPUData
+{
+	unsigned int albedoIndex;
+	unsigned int normalIndex;
+	unsigned int metalIndex;
+	unsigned int roughnessIndex;
+	DirectX::XMFLOAT2 uvScale;
+	DirectX::XMFLOAT2 uvOffset;
 };
 
 struct PSExternalData
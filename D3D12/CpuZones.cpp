@@ -0,0 +1,328 @@
+#include "CpuZones.h"
+#include "JsonHelpers.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// Every ring ever made, indexed by thread number. Rings whose
+	// threads have exited are handed to the next new thread once
+	// they're drained, so short-lived threads reuse a handful of
+	// rings and tracks.
+	std::mutex registryMutex;
+	std::vector<std::unique_ptr<CpuZones::ZoneRing>> rings;
+	std::vector<bool> ringFree;
+	std::vector<std::string> threadNames;
+
+	// Where the tick clock started, against steady_clock, for turning
+	// ticks into seconds
+	bool clockStarted = false;
+	unsigned long long startTicks = 0;
+	std::chrono::steady_clock::time_point startTime;
+	double ticksPerSecond = 1000000000.0;
+
+	std::vector<CpuZoneFrame> history;	// A ring, oldest at historyStart once full
+	size_t historyStart = 0;
+	unsigned long long frameCount = 0;
+	size_t droppedZones = 0;
+
+	// Marks the thread's ring as retired when the thread exits
+	struct RingRetirer
+	{
+		CpuZones::ZoneRing* ring = 0;
+		~RingRetirer()
+		{
+			if (ring)
+				ring->retired.store(true, std::memory_order_release);
+			CpuZones::threadRing = 0;
+		}
+	};
+
+	std::string DefaultThreadName(size_t thread)
+	{
+		return "Thread " + std::to_string(thread);
+	}
+
+	void StartClock()
+	{
+		if (clockStarted)
+			return;
+
+		startTicks = CpuZones::Now();
+		startTime = std::chrono::steady_clock::now();
+		clockStarted = true;
+	}
+
+	// rdtsc's rate isn't known up front, so it's measured against
+	// steady_clock over everything since the clock started
+	void CalibrateClock()
+	{
+#ifdef CPU_ZONES_RDTSC
+		unsigned long long ticks = CpuZones::Now() - startTicks;
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		if (seconds > 0.001)
+			ticksPerSecond = ticks / seconds;
+#endif
+	}
+
+	double TicksToSeconds(unsigned long long ticks)
+	{
+		return (double)(long long)(ticks - startTicks) / ticksPerSecond;
+	}
+
+	// Time in a zone across the history, keyed by the names of the
+	// zones it's nested in, separated by a character that sorts below
+	// any printable one so children come right after their parent
+	struct ZoneTotal
+	{
+		const char* name = 0;
+		unsigned int depth = 0;
+		double seconds = 0;
+		size_t calls = 0;
+	};
+	const char PathSeparator = '\x1f';
+}
+
+CpuZones::ZoneRing* CpuZones::RegisterThread()
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	StartClock();
+
+	ZoneRing* ring = 0;
+	for (size_t i = 0; i < rings.size() && !ring; i++)
+	{
+		if (!ringFree[i])
+			continue;
+
+		ring = rings[i].get();
+		ring->head.store(0, std::memory_order_relaxed);
+		ring->tail.store(0, std::memory_order_relaxed);
+		ring->retired.store(false, std::memory_order_relaxed);
+		ring->depth = 0;
+		ringFree[i] = false;
+		threadNames[i] = DefaultThreadName(i);
+	}
+
+	if (!ring)
+	{
+		// Not make_unique, which would zero the whole ring first
+		ring = new ZoneRing;
+		ring->thread = (unsigned int)rings.size();
+		rings.emplace_back(ring);
+		ringFree.push_back(false);
+		threadNames.push_back(DefaultThreadName(ring->thread));
+	}
+
+	thread_local RingRetirer retirer;
+	retirer.ring = ring;
+	threadRing = ring;
+	return ring;
+}
+
+void CpuZones::SetThreadName(const char* name)
+{
+	ZoneRing* ring = ThreadRing();
+	std::lock_guard<std::mutex> lock(registryMutex);
+	threadNames[ring->thread] = name;
+}
+
+std::vector<std::string> CpuZones::GetThreadNames()
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	return threadNames;
+}
+
+void CpuZones::EndFrame()
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	if (!clockStarted)
+		return;
+	CalibrateClock();
+
+	CpuZoneFrame frame;
+	frame.frame = ++frameCount;
+	for (size_t i = 0; i < rings.size(); i++)
+	{
+		if (ringFree[i])
+			continue;
+
+		// Checked first, so everything it wrote before exiting is seen below
+		ZoneRing& ring = *rings[i];
+		bool retired = ring.retired.load(std::memory_order_acquire);
+
+		unsigned long long head = ring.head.load(std::memory_order_acquire);
+		unsigned long long tail = ring.tail.load(std::memory_order_relaxed);
+		for (; tail < head; tail++)
+		{
+			const ZoneEvent& event = ring.events[tail & (RingSize - 1)];
+			CpuZoneRecord zone;
+			zone.name = event.name;
+			zone.thread = ring.thread;
+			zone.depth = event.depth;
+			zone.start = TicksToSeconds(event.start);
+			zone.end = TicksToSeconds(event.end);
+			frame.zones.push_back(zone);
+		}
+		ring.tail.store(head, std::memory_order_release);
+		droppedZones += ring.dropped.exchange(0, std::memory_order_relaxed);
+
+		if (retired)
+			ringFree[i] = true;
+	}
+
+	// Rings hold zones in the order they ended, so children come
+	// before their parents until sorted
+	std::sort(frame.zones.begin(), frame.zones.end(),
+		[](const CpuZoneRecord& a, const CpuZoneRecord& b)
+		{
+			if (a.thread != b.thread) return a.thread < b.thread;
+			if (a.start != b.start) return a.start < b.start;
+			return a.depth < b.depth;
+		});
+
+	if (history.size() < HistoryLength)
+	{
+		history.push_back(std::move(frame));
+	}
+	else
+	{
+		history[historyStart] = std::move(frame);
+		historyStart = (historyStart + 1) % HistoryLength;
+	}
+}
+
+std::vector<CpuZoneFrame> CpuZones::GetHistory()
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	std::vector<CpuZoneFrame> ordered(history.begin() + historyStart, history.end());
+	ordered.insert(ordered.end(), history.begin(), history.begin() + historyStart);
+	return ordered;
+}
+
+CpuZoneFrame CpuZones::GetLatestFrame()
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	if (history.empty())
+		return CpuZoneFrame();
+
+	return history[(historyStart + history.size() - 1) % history.size()];
+}
+
+size_t CpuZones::GetDroppedZones()
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	return droppedZones;
+}
+
+void CpuZones::WriteChromeTrace(std::ostream& out, const std::vector<CpuZoneFrame>& frames,
+	const std::vector<std::string>& names)
+{
+	double origin = 0;
+	for (const CpuZoneFrame& frame : frames)
+	{
+		for (const CpuZoneRecord& zone : frame.zones)
+		{
+			if (origin == 0 || zone.start < origin)
+				origin = zone.start;
+		}
+		if (!frame.zones.empty())
+			break;
+	}
+
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"D3D12Starter\"}}";
+	for (size_t i = 0; i < names.size(); i++)
+	{
+		out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i << ",\"args\":{\"name\":";
+		WriteJsonString(out, names[i]);
+		out << "}}";
+	}
+
+	for (const CpuZoneFrame& frame : frames)
+	{
+		for (const CpuZoneRecord& zone : frame.zones)
+		{
+			char times[64];
+			snprintf(times, sizeof(times), "%.3f,\"dur\":%.3f",
+				(zone.start - origin) * 1000000.0, (zone.end - zone.start) * 1000000.0);
+
+			out << ",\n{\"name\":";
+			WriteJsonString(out, zone.name ? zone.name : "");
+			out << ",\"cat\":\"CPU\",\"ph\":\"X\",\"ts\":" << times <<
+				",\"pid\":1,\"tid\":" << zone.thread << ",\"args\":{\"frame\":" << frame.frame << "}}";
+		}
+	}
+
+	out << "\n]}\n";
+}
+
+bool CpuZones::ExportChromeTrace(const std::filesystem::path& file)
+{
+	std::ofstream out(file, std::ios::trunc);
+	if (!out)
+		return false;
+
+	WriteChromeTrace(out, GetHistory(), GetThreadNames());
+	return (bool)out;
+}
+
+void CpuZones::PrintStats()
+{
+	std::vector<CpuZoneFrame> frames = GetHistory();
+	if (frames.empty())
+		return;
+
+	std::map<std::string, ZoneTotal> totals;
+	std::vector<std::string> stack;
+	for (const CpuZoneFrame& frame : frames)
+	{
+		unsigned int thread = 0;
+		stack.clear();
+		for (const CpuZoneRecord& zone : frame.zones)
+		{
+			if (zone.thread != thread)
+			{
+				thread = zone.thread;
+				stack.clear();
+			}
+
+			// A zone whose parent hasn't ended yet has no name for it
+			stack.resize(zone.depth + 1, "?");
+			stack[zone.depth] = zone.name ? zone.name : "";
+
+			std::string path;
+			for (const std::string& name : stack)
+			{
+				if (!path.empty())
+					path += PathSeparator;
+				path += name;
+			}
+
+			ZoneTotal& total = totals[path];
+			total.name = zone.name;
+			total.depth = zone.depth;
+			total.seconds += zone.end - zone.start;
+			total.calls++;
+		}
+	}
+
+	printf("CPU zones: per frame, averaged over the last %zu frames\n", frames.size());
+	for (auto& pair : totals)
+	{
+		const ZoneTotal& total = pair.second;
+		printf("  %*s%-*s %8.3f ms %8.1f calls\n", total.depth * 2, "",
+			32 - (int)total.depth * 2, total.name ? total.name : "",
+			total.seconds * 1000.0 / frames.size(), (double)total.calls / frames.size());
+	}
+
+	size_t dropped = GetDroppedZones();
+	if (dropped > 0)
+		printf("  %zu zones dropped, their threads' rings were full\n", dropped);
+}
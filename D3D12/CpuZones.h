@@ -0,0 +1,184 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define CPU_ZONES_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CPU_ZONES_RDTSC 1
+#endif
+
+// Define CPU_ZONES_ENABLED as 0 (in the project's preprocessor
+// definitions) to compile every CPU_ZONE out entirely
+#ifndef CPU_ZONES_ENABLED
+#define CPU_ZONES_ENABLED 1
+#endif
+
+#define CPU_ZONE_JOIN2(a, b) a##b
+#define CPU_ZONE_JOIN(a, b) CPU_ZONE_JOIN2(a, b)
+
+#if CPU_ZONES_ENABLED
+// Times the rest of the enclosing block. The name has to be a string
+// literal (or otherwise outlive the program's zones).
+#define CPU_ZONE(name) CpuZones::Zone CPU_ZONE_JOIN(cpuZone, __LINE__)(name)
+#else
+#define CPU_ZONE(name) ((void)0)
+#endif
+
+// One finished zone, in seconds since the zones started
+struct CpuZoneRecord
+{
+	const char* name = 0;
+	unsigned int thread = 0;	// Index into CpuZones::GetThreadNames()
+	unsigned int depth = 0;		// Zones open around it on the same thread
+	double start = 0;
+	double end = 0;
+};
+
+// Zones that finished during one frame, by thread and then start time,
+// so every zone comes after the one it's nested in
+struct CpuZoneFrame
+{
+	unsigned long long frame = 0;
+	std::vector<CpuZoneRecord> zones;
+};
+
+// --------------------------------------------------------
+// Low overhead CPU timing for scoped zones on any thread
+//
+// Each thread writes its finished zones into a ring buffer
+// of its own (made the first time it opens a zone), with
+// nothing but a release store to publish them, so zones
+// never lock or wait. Timestamps are raw rdtsc ticks where
+// there is one (steady_clock elsewhere), converted to
+// seconds only when collected.
+//
+// Once a frame, the main thread calls EndFrame(), which
+// drains every ring into that frame's zones. The most
+// recent frames are kept for printing and for exporting
+// as a Chrome trace. A ring that fills up between frames
+// drops zones rather than wait; GetDroppedZones() counts
+// them.
+// --------------------------------------------------------
+namespace CpuZones
+{
+	const unsigned int RingSize = 8192;	// Zones per thread per frame, a power of two
+	const unsigned int HistoryLength = 120;
+
+	// A zone as written by its thread, in raw ticks
+	struct ZoneEvent
+	{
+		const char* name;
+		unsigned long long start;
+		unsigned long long end;
+		unsigned int depth;
+	};
+
+	// --------------------------------------------------------
+	// One thread's zones, written only by that thread and read
+	// only by EndFrame(). The two counters sit on separate
+	// cache lines so writing and draining don't contend.
+	// --------------------------------------------------------
+	struct ZoneRing
+	{
+		ZoneEvent events[RingSize];
+		alignas(64) std::atomic<unsigned long long> head{ 0 };	// Next to write
+		alignas(64) std::atomic<unsigned long long> tail{ 0 };	// Next to read
+		std::atomic<size_t> dropped{ 0 };
+		std::atomic<bool> retired{ false };	// Its thread has exited
+		unsigned int depth = 0;
+		unsigned int thread = 0;
+
+		void Write(const ZoneEvent& event)
+		{
+			unsigned long long h = head.load(std::memory_order_relaxed);
+			if (h - tail.load(std::memory_order_acquire) >= RingSize)
+			{
+				dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+
+			events[h & (RingSize - 1)] = event;
+			head.store(h + 1, std::memory_order_release);
+		}
+	};
+
+	inline unsigned long long Now()
+	{
+#ifdef CPU_ZONES_RDTSC
+		return __rdtsc();
+#else
+		return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	// Makes (and registers) the calling thread's ring
+	ZoneRing* RegisterThread();
+
+	inline thread_local ZoneRing* threadRing = 0;
+	inline ZoneRing* ThreadRing()
+	{
+		return threadRing ? threadRing : RegisterThread();
+	}
+
+	class Zone
+	{
+	public:
+
+		Zone(const char* name)
+		{
+			this->name = name;
+			ring = ThreadRing();
+			depth = ring->depth++;
+			start = Now();
+		}
+
+		~Zone()
+		{
+			unsigned long long end = Now();
+			ring->depth--;
+			ring->Write({ name, start, end, depth });
+		}
+
+		Zone(const Zone&) = delete;
+		Zone& operator=(const Zone&) = delete;
+
+	private:
+
+		const char* name;
+		ZoneRing* ring;
+		unsigned long long start;
+		unsigned int depth;
+	};
+
+	// Names the calling thread in printouts and traces
+	void SetThreadName(const char* name);
+	std::vector<std::string> GetThreadNames();
+
+	// Collects every zone finished since the last call as one frame
+	void EndFrame();
+
+	// Finished frames, oldest first, or just the one EndFrame() last made
+	std::vector<CpuZoneFrame> GetHistory();
+	CpuZoneFrame GetLatestFrame();
+	size_t GetDroppedZones();
+
+	// Writes frames as Chrome trace_event JSON, a track per thread, with
+	// times in microseconds from the first frame's first zone
+	void WriteChromeTrace(std::ostream& out, const std::vector<CpuZoneFrame>& frames,
+		const std::vector<std::string>& threadNames);
+	bool ExportChromeTrace(const std::filesystem::path& file);
+
+	// Time per frame spent in each zone (summed over threads), averaged
+	// over the history and printed as a tree
+	void PrintStats();
+}
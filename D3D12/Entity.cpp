@@ -1,5 +1,7 @@
 #include "Entity.h"
 
+#include <cmath>
+
 Entity::Entity(std::shared_ptr<Mesh> model)
 {
 	mesh = model;
@@ -8,10 +10,10 @@ Entity::Entity(std::shared_ptr<Mesh> model)
 Entity::Entity(std::shared_ptr<Mesh> model, std::shared_ptr<Material> material)
 {
 	mesh = model;
-	this->material = material;
+	materials.push_back(material);
 }
 
-std::shared_ptr<Mesh> Entity::GetMesh()
+const std::shared_ptr<Mesh>& Entity::GetMesh()
 {
 	return mesh;
 }
@@ -26,12 +28,47 @@ void Entity::SetWorldTM(Transform newTM)
 	tm = newTM;
 }
 
-const std::shared_ptr<Material> Entity::GetMaterial()
+// --------------------------------------------------------
+// Uses the largest scale axis, so the sphere still contains
+// the mesh when it's scaled unevenly
+// --------------------------------------------------------
+void Entity::GetWorldBoundingSphere(DirectX::XMFLOAT3& center, float& radius)
 {
-	return material;
+	DirectX::XMFLOAT3 localCenter = mesh->GetBoundsCenter();
+	DirectX::XMStoreFloat3(&center, DirectX::XMVector3Transform(
+		DirectX::XMLoadFloat3(&localCenter), DirectX::XMLoadFloat4x4(&tm.GetWorldMatrix())));
+
+	DirectX::XMFLOAT3 scale = tm.GetScale();
+	float maxScale = fmaxf(fabsf(scale.x), fmaxf(fabsf(scale.y), fabsf(scale.z)));
+	radius = mesh->GetBoundsRadius() * maxScale;
+}
+
+const std::shared_ptr<Material>& Entity::GetMaterial()
+{
+	return GetMaterial(0);
 }
 
 void Entity::SetMaterial(std::shared_ptr<Material> material)
 {
-	this->material = material;
+	SetMaterial(0, material);
+}
+
+const std::shared_ptr<Material>& Entity::GetMaterial(unsigned int slot)
+{
+	if (slot < materials.size() && materials[slot])
+		return materials[slot];
+
+	static const std::shared_ptr<Material> noMaterial;
+	if (materials.empty())
+		return noMaterial;
+
+	return materials[0];
+}
+
+void Entity::SetMaterial(unsigned int slot, std::shared_ptr<Material> material)
+{
+	if (slot >= materials.size())
+		materials.resize(slot + 1);
+
+	materials[slot] = material;
 }
\ No newline at end of file
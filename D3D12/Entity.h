@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 
 #include "Mesh.h"
 #include "Transform.h"
@@ -13,17 +14,27 @@ public:
 	Entity(std::shared_ptr<Mesh> model);
 	Entity(std::shared_ptr<Mesh> model, std::shared_ptr<Material> material);
 
-	std::shared_ptr<Mesh> GetMesh();
-	const std::shared_ptr<Material> GetMaterial();
+	// These return references, so draws recorded on several threads
+	// don't all bump the same reference counts
+	const std::shared_ptr<Mesh>& GetMesh();
+	const std::shared_ptr<Material>& GetMaterial();
 	void SetMaterial(std::shared_ptr<Material> material);
 
+	// Per sub-mesh materials (see Mesh::GetMaterialNames), where
+	// slots without their own material fall back to slot 0's
+	const std::shared_ptr<Material>& GetMaterial(unsigned int slot);
+	void SetMaterial(unsigned int slot, std::shared_ptr<Material> material);
+
 	Transform GetWorldTM();
 	void SetWorldTM(Transform newTM);
 
+	// The mesh's bounding sphere, moved and scaled into world space
+	void GetWorldBoundingSphere(DirectX::XMFLOAT3& center, float& radius);
+
 private:
 
 	std::shared_ptr<Mesh> mesh;
 	Transform tm;
-	std::shared_ptr<Material> material;
+	std::vector<std::shared_ptr<Material>> materials;
 };
 
@@ -0,0 +1,111 @@
+#include "FrameAllocator.h"
+
+FrameAllocator::FrameAllocator(unsigned long long pageSize, unsigned int maxPages)
+{
+	Reset(pageSize, maxPages);
+}
+
+void FrameAllocator::Reset(unsigned long long pageSize, unsigned int maxPages)
+{
+	this->pageSize = pageSize;
+	this->maxPages = maxPages;
+	pageCount = 0;
+	freePages.clear();
+	currentPages.clear();
+	currentOffset = 0;
+	currentBytes = 0;
+	framesInFlight.clear();
+
+	stats = FrameAllocatorStats();
+	stats.pageSize = pageSize;
+}
+
+// --------------------------------------------------------
+// Bumps along the current page, moving on to a free page
+// (or a brand new one) when it's full. The rest of a full
+// page goes unused until the frame is retired.
+// --------------------------------------------------------
+bool FrameAllocator::Allocate(unsigned long long size, unsigned long long alignment, FrameAllocation& allocation)
+{
+	if (alignment == 0)
+		alignment = 1;
+
+	unsigned long long offset = (currentOffset + alignment - 1) & ~(alignment - 1);
+	if (currentPages.empty() || offset + size > pageSize)
+	{
+		if (size > pageSize)
+		{
+			stats.failures++;
+			return false;
+		}
+
+		if (!freePages.empty())
+		{
+			currentPages.push_back(freePages.back());
+			freePages.pop_back();
+		}
+		else if (maxPages == 0 || pageCount < maxPages)
+		{
+			currentPages.push_back(pageCount++);
+		}
+		else
+		{
+			stats.failures++;
+			return false;
+		}
+
+		offset = 0;
+	}
+
+	allocation.page = currentPages.back();
+	allocation.offset = offset;
+	currentOffset = offset + size;
+	currentBytes += size;
+	return true;
+}
+
+void FrameAllocator::EndFrame(unsigned long long fenceValue)
+{
+	stats.lastFrameBytes = currentBytes;
+	if (currentBytes > stats.highWaterBytes)
+		stats.highWaterBytes = currentBytes;
+	if (currentPages.size() > stats.highWaterPages)
+		stats.highWaterPages = (unsigned int)currentPages.size();
+
+	if (!currentPages.empty())
+	{
+		Frame frame;
+		frame.pages.swap(currentPages);
+		frame.fenceValue = fenceValue;
+		framesInFlight.push_back(frame);
+	}
+
+	currentOffset = 0;
+	currentBytes = 0;
+}
+
+void FrameAllocator::Retire(unsigned long long completedFenceValue)
+{
+	while (!framesInFlight.empty() && framesInFlight.front().fenceValue <= completedFenceValue)
+	{
+		const std::vector<unsigned int>& pages = framesInFlight.front().pages;
+		freePages.insert(freePages.end(), pages.begin(), pages.end());
+		framesInFlight.pop_front();
+	}
+}
+
+unsigned long long FrameAllocator::GetOldestFence()
+{
+	return framesInFlight.empty() ? 0 : framesInFlight.front().fenceValue;
+}
+
+unsigned int FrameAllocator::GetPageCount() { return pageCount; }
+unsigned long long FrameAllocator::GetPageSize() { return pageSize; }
+
+FrameAllocatorStats FrameAllocator::GetStats()
+{
+	FrameAllocatorStats current = stats;
+	current.pages = pageCount;
+	current.pagesInUse = pageCount - (unsigned int)freePages.size();
+	return current;
+}
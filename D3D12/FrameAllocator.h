@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+// Where a FrameAllocator put something: a page, and an offset into it
+struct FrameAllocation
+{
+	unsigned int page;
+	unsigned long long offset;
+};
+
+struct FrameAllocatorStats
+{
+	unsigned long long pageSize = 0;
+	unsigned int pages = 0;					// Created so far
+	unsigned int pagesInUse = 0;			// By the current frame and frames in flight
+	unsigned long long lastFrameBytes = 0;
+	unsigned long long highWaterBytes = 0;	// Most used by any one frame
+	unsigned int highWaterPages = 0;
+	size_t failures = 0;					// Allocations that couldn't be made
+};
+
+// --------------------------------------------------------
+// Linear allocator for data that only lives for a frame
+//
+// Each frame bump allocates through its own chain of
+// fixed-size pages. When the frame ends, its pages are
+// tagged with the fence value signalled after it, and only
+// come back into use once Retire() sees that value reached.
+// If no page is free another is added (up to an optional
+// limit), so a busy frame grows the chain instead of
+// overwriting anything the GPU may still be reading.
+//
+// Pages are just indices here. The caller backs each one
+// with real memory the first time it shows up, which keeps
+// this free of any graphics API and lets a simulated fence
+// drive it.
+// --------------------------------------------------------
+class FrameAllocator
+{
+public:
+
+	// A maxPages of 0 means there's no limit
+	FrameAllocator(unsigned long long pageSize = 0, unsigned int maxPages = 0);
+	void Reset(unsigned long long pageSize, unsigned int maxPages = 0);
+
+	// Finds size bytes at the given (power of two) alignment in the current
+	// frame's pages. Fails if it's bigger than a page, or all pages are taken.
+	bool Allocate(unsigned long long size, unsigned long long alignment, FrameAllocation& allocation);
+
+	// Closes the current frame. Its pages are reused once fenceValue is reached.
+	void EndFrame(unsigned long long fenceValue);
+
+	// Frees the pages of every ended frame whose fence value has been reached
+	void Retire(unsigned long long completedFenceValue);
+
+	// Fence value of the oldest frame still holding pages, or 0 if there are none
+	unsigned long long GetOldestFence();
+
+	unsigned int GetPageCount();
+	unsigned long long GetPageSize();
+	FrameAllocatorStats GetStats();
+
+private:
+
+	struct Frame
+	{
+		std::vector<unsigned int> pages;
+		unsigned long long fenceValue;
+	};
+
+	unsigned long long pageSize;
+	unsigned int maxPages;
+	unsigned int pageCount;
+	std::vector<unsigned int> freePages;
+
+	// The frame being filled
+	std::vector<unsigned int> currentPages;
+	unsigned long long currentOffset;
+	unsigned long long currentBytes;
+
+	std::deque<Frame> framesInFlight;
+	FrameAllocatorStats stats;
+};
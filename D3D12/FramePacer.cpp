@@ -0,0 +1,184 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <cstdio>
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	unsigned int ClampFramesInFlight(unsigned int count)
+	{
+		if (count < FramePacer::MinFramesInFlight) return FramePacer::MinFramesInFlight;
+		if (count > FramePacer::MaxFramesInFlight) return FramePacer::MaxFramesInFlight;
+		return count;
+	}
+}
+
+FramePacer::FramePacer(FramePacingDevice* device, unsigned int framesInFlight)
+{
+	this->device = device;
+	this->framesInFlight = ClampFramesInFlight(framesInFlight);
+	slot = 0;
+	frameFence = 1; // Starts past the fence's initial 0, so every frame's value is unique
+	timelineStart = 0;
+	for (bool& pending : slotPending)
+		pending = false;
+
+	current.frame = frameFence;
+	current.begin = device->GetTime();
+}
+
+// --------------------------------------------------------
+// Slots past the new count are never used again, so their
+// last frames (finished, with the GPU idle) are collected
+// now. The current frame keeps its slot either way.
+// --------------------------------------------------------
+void FramePacer::SetFramesInFlight(unsigned int count)
+{
+	framesInFlight = ClampFramesInFlight(count);
+	CollectFinishedFrames(device->GetCompletedFence());
+}
+
+unsigned int FramePacer::GetFramesInFlight() { return framesInFlight; }
+unsigned int FramePacer::GetFrameSlot() { return slot; }
+unsigned long long FramePacer::GetFrameFence() { return frameFence; }
+
+void FramePacer::FrameSubmitted()
+{
+	current.submit = device->GetTime();
+}
+
+void FramePacer::FramePresented()
+{
+	current.present = device->GetTime();
+	device->EndGpuFrame(slot);
+	device->SignalFence(frameFence);
+
+	slotFrames[slot] = current;
+	slotPending[slot] = true;
+
+	frameFence++;
+	slot = (slot + 1) % framesInFlight;
+	BeginFrame();
+}
+
+// --------------------------------------------------------
+// The swap chain comes first: with a low frame latency it
+// holds the CPU back further than the slots do, and once
+// it lets go the slot's last frame is usually done too.
+//
+// Waiting for the frame framesInFlight back as well as the
+// slot's last one keeps the limit right straight after the
+// count changes, when slots haven't been used in order.
+// --------------------------------------------------------
+void FramePacer::BeginFrame()
+{
+	double start = device->GetTime();
+	device->WaitForPresentQueue();
+
+	unsigned long long waitFence = frameFence > framesInFlight ? frameFence - framesInFlight : 0;
+	if (slotPending[slot] && slotFrames[slot].frame > waitFence)
+		waitFence = slotFrames[slot].frame;
+	if (device->GetCompletedFence() < waitFence)
+		device->WaitForFence(waitFence);
+	CollectFinishedFrames(device->GetCompletedFence());
+
+	current = FrameTiming();
+	current.frame = frameFence;
+	current.begin = device->GetTime();
+	current.wait = current.begin - start;
+}
+
+void FramePacer::CollectFinishedFrames(unsigned long long completedFence)
+{
+	// Slots aren't in frame order once the count changes, so sort them
+	FrameTiming* finished[MaxFramesInFlight];
+	unsigned int finishedCount = 0;
+	for (unsigned int s = 0; s < MaxFramesInFlight; s++)
+	{
+		if (!slotPending[s] || slotFrames[s].frame > completedFence)
+			continue;
+
+		FrameTiming& frame = slotFrames[s];
+		frame.gpuTimed = device->GetGpuTimes(s, frame.gpuStart, frame.gpuEnd);
+		finished[finishedCount++] = &frame;
+		slotPending[s] = false;
+	}
+	std::sort(finished, finished + finishedCount,
+		[](const FrameTiming* a, const FrameTiming* b) { return a->frame < b->frame; });
+
+	for (unsigned int i = 0; i < finishedCount; i++)
+	{
+		if (timeline.size() < TimelineLength)
+		{
+			timeline.push_back(*finished[i]);
+		}
+		else
+		{
+			timeline[timelineStart] = *finished[i];
+			timelineStart = (timelineStart + 1) % TimelineLength;
+		}
+	}
+}
+
+std::vector<FrameTiming> FramePacer::GetTimeline()
+{
+	std::vector<FrameTiming> ordered(timeline.begin() + timelineStart, timeline.end());
+	ordered.insert(ordered.end(), timeline.begin(), timeline.begin() + timelineStart);
+	return ordered;
+}
+
+FramePacingStats FramePacer::GetStats()
+{
+	FramePacingStats stats;
+	std::vector<FrameTiming> frames = GetTimeline();
+	stats.frames = (unsigned int)frames.size();
+	if (frames.empty())
+		return stats;
+
+	unsigned int gpuTimed = 0;
+	for (size_t i = 0; i < frames.size(); i++)
+	{
+		const FrameTiming& frame = frames[i];
+		if (i > 0)
+		{
+			double frameTime = frame.begin - frames[i - 1].begin;
+			stats.frameTime += frameTime;
+			stats.longestFrameTime = frameTime > stats.longestFrameTime ? frameTime : stats.longestFrameTime;
+		}
+		stats.wait += frame.wait;
+		stats.cpuTime += frame.submit - frame.begin;
+
+		if (frame.gpuTimed)
+		{
+			stats.gpuTime += frame.gpuEnd - frame.gpuStart;
+			stats.queueTime += frame.gpuStart - frame.submit;
+			stats.latency += frame.gpuEnd - frame.begin;
+			gpuTimed++;
+		}
+	}
+
+	// Averages, in milliseconds
+	double intervals = frames.size() > 1 ? (double)(frames.size() - 1) : 1.0;
+	stats.frameTime *= 1000.0 / intervals;
+	stats.longestFrameTime *= 1000.0;
+	stats.wait *= 1000.0 / frames.size();
+	stats.cpuTime *= 1000.0 / frames.size();
+	if (gpuTimed > 0)
+	{
+		stats.gpuTime *= 1000.0 / gpuTimed;
+		stats.queueTime *= 1000.0 / gpuTimed;
+		stats.latency *= 1000.0 / gpuTimed;
+	}
+	return stats;
+}
+
+void FramePacer::PrintStats()
+{
+	FramePacingStats stats = GetStats();
+	printf("Frame pacing: %u frames in flight, %.2f ms per frame (%.2f ms longest) over the last %u, %.2f ms waiting to start\n",
+		framesInFlight, stats.frameTime, stats.longestFrameTime, stats.frames, stats.wait);
+	printf("  CPU %.2f ms to submit, queued %.2f ms, GPU %.2f ms, %.2f ms from start to GPU done\n",
+		stats.cpuTime, stats.queueTime, stats.gpuTime, stats.latency);
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// When one frame happened, on the CPU's clock (in seconds)
+struct FrameTiming
+{
+	unsigned long long frame = 0;	// The frame's fence value
+	double begin = 0;				// CPU started the frame, after waiting
+	double wait = 0;				// Seconds it waited for the GPU or swap chain first
+	double submit = 0;				// Last command lists handed to the queue
+	double present = 0;				// Present() returned
+	double gpuStart = 0;			// GPU started and finished the frame's work
+	double gpuEnd = 0;
+	bool gpuTimed = false;			// False if the GPU times aren't known
+};
+
+// Averages over the timeline, in milliseconds
+struct FramePacingStats
+{
+	unsigned int frames = 0;
+	double frameTime = 0;			// Begin to begin
+	double wait = 0;
+	double cpuTime = 0;				// Begin to submit
+	double gpuTime = 0;				// GPU start to end
+	double queueTime = 0;			// Submit to GPU start
+	double latency = 0;				// Begin to GPU end
+	double longestFrameTime = 0;
+};
+
+// --------------------------------------------------------
+// The GPU and swap chain operations FramePacer needs, so
+// its pacing doesn't depend on D3D12 (see
+// FramePacingDeviceD3D12.h) and can run against a
+// simulated GPU clock.
+// --------------------------------------------------------
+class FramePacingDevice
+{
+public:
+
+	virtual ~FramePacingDevice() {}
+
+	// CPU clock, in seconds
+	virtual double GetTime() = 0;
+
+	// The frame fence, signalled on the queue after each frame's work
+	virtual void SignalFence(unsigned long long value) = 0;
+	virtual unsigned long long GetCompletedFence() = 0;
+	virtual void WaitForFence(unsigned long long value) = 0;
+
+	// Blocks until the swap chain will take another present without
+	// going over its maximum frame latency
+	virtual void WaitForPresentQueue() = 0;
+
+	// Queues whatever times the end of the frame using this slot, just
+	// before its fence signal
+	virtual void EndGpuFrame(unsigned int slot) = 0;
+
+	// When the GPU started and finished the last frame that used a slot,
+	// on the CPU clock. Only asked once that frame's fence is reached.
+	virtual bool GetGpuTimes(unsigned int slot, double& start, double& end) = 0;
+};
+
+// --------------------------------------------------------
+// Paces the CPU against the GPU and the swap chain
+//
+// Each frame gets the next of framesInFlight slots, for its
+// own command allocators and such, and a fence value that
+// only ever grows. Before a frame starts, the CPU waits for
+// the swap chain to have room under its maximum latency,
+// then for the last frame that used the slot to finish on
+// the GPU. So at most framesInFlight - 1 frames are ever on
+// the GPU while the CPU records another.
+//
+// How many frames are in flight is up to the caller and
+// has nothing to do with the number of back buffers. More
+// keeps the GPU busier; fewer (or a lower frame latency)
+// gets input on screen sooner.
+//
+// The timeline keeps the most recent frames' timings, on
+// the CPU's clock, once the GPU has finished them.
+// --------------------------------------------------------
+class FramePacer
+{
+public:
+
+	static const unsigned int MinFramesInFlight = 2;
+	static const unsigned int MaxFramesInFlight = 4;
+	static const unsigned int TimelineLength = 120;
+
+	FramePacer(FramePacingDevice* device, unsigned int framesInFlight = MinFramesInFlight);
+
+	// Changes how many frames can be in flight (clamped to the limits
+	// above). Only while the GPU is idle, between frames.
+	void SetFramesInFlight(unsigned int count);
+	unsigned int GetFramesInFlight();
+
+	// The current frame's slot and fence value. The first frame is
+	// already begun, so these are good straight away.
+	unsigned int GetFrameSlot();
+	unsigned long long GetFrameFence();
+
+	// Notes the time the frame's command lists were submitted
+	void FrameSubmitted();
+
+	// Ends the current frame once it's presented, signalling its fence,
+	// then waits until the next one can begin and begins it
+	void FramePresented();
+
+	// Frames the GPU has finished, oldest first
+	std::vector<FrameTiming> GetTimeline();
+	FramePacingStats GetStats();
+	void PrintStats();
+
+private:
+
+	// Picks up the GPU times of every finished frame
+	void CollectFinishedFrames(unsigned long long completedFence);
+	void BeginFrame();
+
+	FramePacingDevice* device;
+	unsigned int framesInFlight;
+	unsigned int slot;
+	unsigned long long frameFence;
+
+	// The frame most recently given each slot, waiting on its GPU times
+	FrameTiming slotFrames[MaxFramesInFlight];
+	bool slotPending[MaxFramesInFlight];
+
+	FrameTiming current;
+	std::vector<FrameTiming> timeline;	// A ring, oldest at timelineStart once full
+	size_t timelineStart;
+};
@@ -0,0 +1,152 @@
+#include "FramePacingDeviceD3D12.h"
+
+FramePacingDeviceD3D12::FramePacingDeviceD3D12(ID3D12Device* device, ID3D12CommandQueue* queue, ID3D12Fence* fence, HANDLE fenceEvent)
+{
+	this->queue = queue;
+	this->fence = fence;
+	this->fenceEvent = fenceEvent;
+	latencyWaitable = 0;
+	timestamps = 0;
+
+	LARGE_INTEGER frequency{};
+	QueryPerformanceFrequency(&frequency);
+	cpuFrequency = (double)frequency.QuadPart;
+	gpuFrequency = 0;
+	queue->GetTimestampFrequency(&gpuFrequency);
+
+	const unsigned int queryCount = 2 * FramePacer::MaxFramesInFlight;
+	D3D12_QUERY_HEAP_DESC heapDesc = {};
+	heapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+	heapDesc.Count = queryCount;
+	device->CreateQueryHeap(&heapDesc, IID_PPV_ARGS(timestampHeap.GetAddressOf()));
+
+	D3D12_HEAP_PROPERTIES heapProps = {};
+	heapProps.Type = D3D12_HEAP_TYPE_READBACK;
+	heapProps.CreationNodeMask = 1;
+	heapProps.VisibleNodeMask = 1;
+
+	D3D12_RESOURCE_DESC resDesc = {};
+	resDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	resDesc.Width = queryCount * sizeof(UINT64);
+	resDesc.Height = 1;
+	resDesc.DepthOrArraySize = 1;
+	resDesc.MipLevels = 1;
+	resDesc.Format = DXGI_FORMAT_UNKNOWN;
+	resDesc.SampleDesc.Count = 1;
+	resDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+
+	device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &resDesc,
+		D3D12_RESOURCE_STATE_COPY_DEST, 0, IID_PPV_ARGS(timestampReadback.GetAddressOf()));
+
+	// Readback memory can stay mapped; each slot is only read once its frame is done
+	if (timestampReadback)
+		timestampReadback->Map(0, 0, (void**)&timestamps);
+
+	for (unsigned int i = 0; i < FramePacer::MaxFramesInFlight; i++)
+	{
+		device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(endAllocators[i].GetAddressOf()));
+		device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, endAllocators[i].Get(), 0, IID_PPV_ARGS(endLists[i].GetAddressOf()));
+		endLists[i]->Close();
+		started[i] = false;
+		timed[i] = false;
+	}
+}
+
+FramePacingDeviceD3D12::~FramePacingDeviceD3D12()
+{
+	if (timestamps)
+		timestampReadback->Unmap(0, 0);
+	if (latencyWaitable)
+		CloseHandle(latencyWaitable);
+}
+
+void FramePacingDeviceD3D12::SetSwapChain(IDXGISwapChain2* swapChain, unsigned int maxFrameLatency)
+{
+	if (FAILED(swapChain->SetMaximumFrameLatency(maxFrameLatency)))
+		return;
+
+	if (!latencyWaitable)
+		latencyWaitable = swapChain->GetFrameLatencyWaitableObject();
+}
+
+void FramePacingDeviceD3D12::BeginGpuFrame(ID3D12GraphicsCommandList* commandList, unsigned int slot)
+{
+	commandList->EndQuery(timestampHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, 2 * slot);
+	started[slot] = true;
+}
+
+double FramePacingDeviceD3D12::GetTime()
+{
+	LARGE_INTEGER now{};
+	QueryPerformanceCounter(&now);
+	return now.QuadPart / cpuFrequency;
+}
+
+void FramePacingDeviceD3D12::SignalFence(unsigned long long value)
+{
+	queue->Signal(fence.Get(), value);
+}
+
+unsigned long long FramePacingDeviceD3D12::GetCompletedFence()
+{
+	return fence->GetCompletedValue();
+}
+
+void FramePacingDeviceD3D12::WaitForFence(unsigned long long value)
+{
+	fence->SetEventOnCompletion(value, fenceEvent);
+	WaitForSingleObject(fenceEvent, INFINITE);
+}
+
+// --------------------------------------------------------
+// The timeout keeps a swap chain that's stopped presenting
+// (say, while the window is hidden) from hanging the frame
+// --------------------------------------------------------
+void FramePacingDeviceD3D12::WaitForPresentQueue()
+{
+	if (latencyWaitable)
+		WaitForSingleObjectEx(latencyWaitable, 1000, true);
+}
+
+// --------------------------------------------------------
+// The slot's last frame is finished by now (FramePacer
+// waited for it), so its allocator can be reset. Frames
+// that never had their start timed aren't timed at all.
+// --------------------------------------------------------
+void FramePacingDeviceD3D12::EndGpuFrame(unsigned int slot)
+{
+	timed[slot] = false;
+	if (!started[slot] || !timestamps)
+		return;
+
+	endAllocators[slot]->Reset();
+	ID3D12GraphicsCommandList* list = endLists[slot].Get();
+	list->Reset(endAllocators[slot].Get(), 0);
+	list->EndQuery(timestampHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, 2 * slot + 1);
+	list->ResolveQueryData(timestampHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, 2 * slot, 2,
+		timestampReadback.Get(), 2 * slot * sizeof(UINT64));
+	list->Close();
+
+	ID3D12CommandList* lists[] = { list };
+	queue->ExecuteCommandLists(1, lists);
+	started[slot] = false;
+	timed[slot] = true;
+}
+
+bool FramePacingDeviceD3D12::GetGpuTimes(unsigned int slot, double& start, double& end)
+{
+	if (!timed[slot] || gpuFrequency == 0)
+		return false;
+	timed[slot] = false;
+
+	// A fresh calibration each time, so the clocks can't drift apart
+	UINT64 gpuNow = 0;
+	UINT64 cpuNow = 0;
+	if (FAILED(queue->GetClockCalibration(&gpuNow, &cpuNow)))
+		return false;
+
+	double cpuSeconds = cpuNow / cpuFrequency;
+	start = cpuSeconds + (double)(long long)(timestamps[2 * slot] - gpuNow) / gpuFrequency;
+	end = cpuSeconds + (double)(long long)(timestamps[2 * slot + 1] - gpuNow) / gpuFrequency;
+	return true;
+}
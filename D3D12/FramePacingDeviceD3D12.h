@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Windows.h>
+#include <d3d12.h>
+#include <dxgi1_3.h>
+#include <wrl/client.h>
+#include "FramePacer.h"
+
+// --------------------------------------------------------
+// FramePacer's device for a D3D12 direct queue and a swap
+// chain made with the frame latency waitable object flag
+//
+// Frames are timed on the GPU with a pair of timestamp
+// queries per slot: one at the top of the frame's first
+// command list (see BeginGpuFrame) and one in a small list
+// of its own, run after the rest of the frame. They're
+// moved onto the CPU's clock (QueryPerformanceCounter) with
+// the queue's clock calibration.
+// --------------------------------------------------------
+class FramePacingDeviceD3D12 : public FramePacingDevice
+{
+public:
+
+	FramePacingDeviceD3D12(ID3D12Device* device, ID3D12CommandQueue* queue, ID3D12Fence* fence, HANDLE fenceEvent);
+	~FramePacingDeviceD3D12();
+	FramePacingDeviceD3D12(const FramePacingDeviceD3D12&) = delete;
+	FramePacingDeviceD3D12& operator=(const FramePacingDeviceD3D12&) = delete;
+
+	// Sets how many presents the swap chain may queue, and waits on its
+	// waitable object from then on. Without one, only the fence paces.
+	void SetSwapChain(IDXGISwapChain2* swapChain, unsigned int maxFrameLatency);
+
+	// Times the start of the frame using a slot, so call it first thing
+	// in the frame's first command list
+	void BeginGpuFrame(ID3D12GraphicsCommandList* commandList, unsigned int slot);
+
+	double GetTime() override;
+	void SignalFence(unsigned long long value) override;
+	unsigned long long GetCompletedFence() override;
+	void WaitForFence(unsigned long long value) override;
+	void WaitForPresentQueue() override;
+	void EndGpuFrame(unsigned int slot) override;
+	bool GetGpuTimes(unsigned int slot, double& start, double& end) override;
+
+private:
+
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue> queue;
+	Microsoft::WRL::ComPtr<ID3D12Fence> fence;
+	HANDLE fenceEvent;
+	HANDLE latencyWaitable;
+
+	// Start and end timestamps for each slot, resolved into readback memory
+	Microsoft::WRL::ComPtr<ID3D12QueryHeap> timestampHeap;
+	Microsoft::WRL::ComPtr<ID3D12Resource> timestampReadback;
+	UINT64* timestamps;
+	UINT64 gpuFrequency;
+	double cpuFrequency;
+
+	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> endAllocators[FramePacer::MaxFramesInFlight];
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> endLists[FramePacer::MaxFramesInFlight];
+	bool started[FramePacer::MaxFramesInFlight];
+	bool timed[FramePacer::MaxFramesInFlight];
+};
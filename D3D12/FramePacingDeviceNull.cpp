@@ -0,0 +1,34 @@
+#include "FramePacingDeviceNull.h"
+
+#include <chrono>
+
+FramePacingDeviceNull::FramePacingDeviceNull()
+{
+	signalledFence = 0;
+	completedFence = 0;
+}
+
+double FramePacingDeviceNull::GetTime()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void FramePacingDeviceNull::SignalFence(unsigned long long value)
+{
+	signalledFence = value;
+}
+
+unsigned long long FramePacingDeviceNull::GetCompletedFence() { return completedFence; }
+
+// Only what has been signalled can finish
+void FramePacingDeviceNull::WaitForFence(unsigned long long value)
+{
+	if (value > signalledFence)
+		value = signalledFence;
+	if (value > completedFence)
+		completedFence = value;
+}
+
+void FramePacingDeviceNull::WaitForPresentQueue() {}
+void FramePacingDeviceNull::EndGpuFrame(unsigned int) {}
+bool FramePacingDeviceNull::GetGpuTimes(unsigned int, double&, double&) { return false; }
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "FramePacer.h"
+
+// --------------------------------------------------------
+// FramePacer's device when there's no GPU at all, for the
+// headless benchmark (see SceneBenchmark.h)
+//
+// The fence only moves when the pacer waits on it, as if
+// the GPU finished each frame at the last possible moment,
+// so frames in flight stay as far behind as the pacer
+// allows. Nothing is timed on the GPU.
+// --------------------------------------------------------
+class FramePacingDeviceNull : public FramePacingDevice
+{
+public:
+
+	FramePacingDeviceNull();
+
+	double GetTime() override;
+	void SignalFence(unsigned long long value) override;
+	unsigned long long GetCompletedFence() override;
+	void WaitForFence(unsigned long long value) override;
+	void WaitForPresentQueue() override;
+	void EndGpuFrame(unsigned int slot) override;
+	bool GetGpuTimes(unsigned int slot, double& start, double& end) override;
+
+private:
+
+	unsigned long long signalledFence;
+	unsigned long long completedFence;
+};
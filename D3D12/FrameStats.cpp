@@ -0,0 +1,173 @@
+#include "FrameStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// The value at least the given fraction of the (sorted) values are at or under
+	double NearestRank(const std::vector<double>& sorted, double fraction)
+	{
+		size_t rank = (size_t)std::ceil(fraction * sorted.size());
+		if (rank < 1) rank = 1;
+		if (rank > sorted.size()) rank = sorted.size();
+		return sorted[rank - 1];
+	}
+
+	void PrintPercentiles(const char* name, const FramePercentiles& times)
+	{
+		if (times.count == 0)
+			return;
+
+		printf("  %-6s mean %7.2f  p50 %7.2f  p90 %7.2f  p99 %7.2f  p99.9 %7.2f  max %7.2f ms\n",
+			name, times.mean, times.p50, times.p90, times.p99, times.p999, times.max);
+	}
+}
+
+FrameStats::FrameStats(double hitchThreshold)
+{
+	this->hitchThreshold = hitchThreshold;
+	sampleStart = 0;
+	totalFrames = 0;
+	totalHitches = 0;
+}
+
+FrameStats::~FrameStats()
+{
+	StopCapture();
+}
+
+void FrameStats::SetHitchThreshold(double milliseconds) { hitchThreshold = milliseconds; }
+double FrameStats::GetHitchThreshold() { return hitchThreshold; }
+
+void FrameStats::AddFrame(const FrameSample& sample)
+{
+	bool hitch = sample.frameTime > hitchThreshold;
+	totalFrames++;
+	if (hitch)
+		totalHitches++;
+
+	if (samples.size() < Capacity)
+	{
+		samples.push_back(sample);
+	}
+	else
+	{
+		samples[sampleStart] = sample;
+		sampleStart = (sampleStart + 1) % Capacity;
+	}
+
+	if (capture.is_open())
+		WriteCsvRow(capture, sample, hitch);
+}
+
+FrameStatsSummary FrameStats::GetSummary(double windowSeconds)
+{
+	FrameStatsSummary summary;
+	std::vector<double> frameTimes;
+	std::vector<double> cpuTimes;
+	std::vector<double> gpuTimes;
+
+	// Newest first, until the window's covered
+	double windowMilliseconds = windowSeconds * 1000.0;
+	double covered = 0;
+	for (size_t i = samples.size(); i > 0; i--)
+	{
+		if (windowSeconds > 0 && covered >= windowMilliseconds)
+			break;
+
+		const FrameSample& sample = samples[(sampleStart + i - 1) % samples.size()];
+		covered += sample.frameTime;
+		frameTimes.push_back(sample.frameTime);
+		cpuTimes.push_back(sample.cpuTime);
+		if (sample.gpuTime >= 0)
+			gpuTimes.push_back(sample.gpuTime);
+		if (sample.frameTime > hitchThreshold)
+			summary.hitches++;
+	}
+
+	summary.frames = (unsigned int)frameTimes.size();
+	summary.seconds = covered / 1000.0;
+	summary.frameTime = ComputePercentiles(frameTimes);
+	summary.cpuTime = ComputePercentiles(cpuTimes);
+	summary.gpuTime = ComputePercentiles(gpuTimes);
+	return summary;
+}
+
+unsigned long long FrameStats::GetTotalFrames() { return totalFrames; }
+unsigned long long FrameStats::GetTotalHitches() { return totalHitches; }
+
+bool FrameStats::StartCapture(const std::filesystem::path& file)
+{
+	StopCapture();
+	capture.open(file, std::ios::trunc);
+	if (!capture)
+		return false;
+
+	WriteCsvHeader(capture);
+	return true;
+}
+
+void FrameStats::StopCapture()
+{
+	if (capture.is_open())
+		capture.close();
+}
+
+bool FrameStats::IsCapturing() { return capture.is_open(); }
+
+void FrameStats::PrintStats(double windowSeconds)
+{
+	FrameStatsSummary summary = GetSummary(windowSeconds);
+	if (summary.frames == 0)
+		return;
+
+	printf("Frame times: last %u frames (%.1f s), %u over %.1f ms (%llu of %llu overall)%s\n",
+		summary.frames, summary.seconds, summary.hitches, hitchThreshold,
+		totalHitches, totalFrames, capture.is_open() ? ", capturing to CSV" : "");
+	PrintPercentiles("Frame", summary.frameTime);
+	PrintPercentiles("CPU", summary.cpuTime);
+	PrintPercentiles("GPU", summary.gpuTime);
+}
+
+FramePercentiles FrameStats::ComputePercentiles(std::vector<double>& values)
+{
+	FramePercentiles percentiles;
+	if (values.empty())
+		return percentiles;
+
+	std::sort(values.begin(), values.end());
+	double total = 0;
+	for (double value : values)
+		total += value;
+
+	percentiles.count = (unsigned int)values.size();
+	percentiles.mean = total / values.size();
+	percentiles.p50 = NearestRank(values, 0.5);
+	percentiles.p90 = NearestRank(values, 0.9);
+	percentiles.p99 = NearestRank(values, 0.99);
+	percentiles.p999 = NearestRank(values, 0.999);
+	percentiles.max = values.back();
+	return percentiles;
+}
+
+void FrameStats::WriteCsvHeader(std::ostream& out)
+{
+	out << "frame,frame_ms,cpu_ms,gpu_ms,hitch\n";
+}
+
+// The GPU column is left empty for frames it didn't time
+void FrameStats::WriteCsvRow(std::ostream& out, const FrameSample& sample, bool hitch)
+{
+	char row[128];
+	if (sample.gpuTime >= 0)
+		snprintf(row, sizeof(row), "%llu,%.4f,%.4f,%.4f,%d\n",
+			sample.frame, sample.frameTime, sample.cpuTime, sample.gpuTime, hitch ? 1 : 0);
+	else
+		snprintf(row, sizeof(row), "%llu,%.4f,%.4f,,%d\n",
+			sample.frame, sample.frameTime, sample.cpuTime, hitch ? 1 : 0);
+	out << row;
+}
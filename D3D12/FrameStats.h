@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <ostream>
+#include <vector>
+
+// One finished frame's times, in milliseconds
+struct FrameSample
+{
+	unsigned long long frame = 0;
+	double frameTime = 0;	// Start of this frame to the start of the next
+	double cpuTime = 0;		// Recording and submitting
+	double gpuTime = -1;	// Negative if the GPU didn't time it
+};
+
+// Nearest-rank percentiles of a set of times, in milliseconds
+struct FramePercentiles
+{
+	unsigned int count = 0;
+	double mean = 0;
+	double p50 = 0;
+	double p90 = 0;
+	double p99 = 0;
+	double p999 = 0;
+	double max = 0;
+};
+
+struct FrameStatsSummary
+{
+	unsigned int frames = 0;
+	double seconds = 0;			// Covered by those frames
+	FramePercentiles frameTime;
+	FramePercentiles cpuTime;
+	FramePercentiles gpuTime;	// Only frames the GPU timed
+	unsigned int hitches = 0;	// Frames over the hitch threshold
+};
+
+// --------------------------------------------------------
+// Frame time statistics over a rolling window
+//
+// Keeps the most recent frames' times in a ring and works
+// out percentiles of them on request, over however many
+// of the latest seconds are asked for, so one slow frame
+// in a hundred shows up instead of vanishing into an
+// average. Frames slower than the hitch threshold are
+// counted as hitches.
+//
+// Every frame can also be written out to a CSV file while
+// a capture is running.
+// --------------------------------------------------------
+class FrameStats
+{
+public:
+
+	static const unsigned int Capacity = 16384;	// Frames kept, about a minute at 240 fps
+
+	FrameStats(double hitchThreshold = 50.0);
+	~FrameStats();
+
+	void SetHitchThreshold(double milliseconds);
+	double GetHitchThreshold();
+
+	void AddFrame(const FrameSample& sample);
+
+	// Covers the latest frames adding up to the window (or every frame
+	// kept, for a window of 0 or one longer than they cover)
+	FrameStatsSummary GetSummary(double windowSeconds = 0);
+	unsigned long long GetTotalFrames();
+	unsigned long long GetTotalHitches();
+
+	// Writes every frame added from now on to a CSV file, until stopped
+	bool StartCapture(const std::filesystem::path& file);
+	void StopCapture();
+	bool IsCapturing();
+
+	void PrintStats(double windowSeconds);
+
+	// Sorts the values, and picks percentiles by nearest rank
+	static FramePercentiles ComputePercentiles(std::vector<double>& values);
+	static void WriteCsvHeader(std::ostream& out);
+	static void WriteCsvRow(std::ostream& out, const FrameSample& sample, bool hitch);
+
+private:
+
+	std::vector<FrameSample> samples;	// A ring, oldest at sampleStart once full
+	size_t sampleStart;
+	double hitchThreshold;
+	unsigned long long totalFrames;
+	unsigned long long totalHitches;
+
+	std::ofstream capture;
+};
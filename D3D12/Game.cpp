@@ -1,11 +1,17 @@
 #include "Game.h"
+#include "CpuZones.h"
 #include "Graphics.h"
 #include "Vertex.h"
 #include "Input.h"
+#include "LodSelector.h"
+#include "Parallel.h"
 #include "PathHelpers.h"
 #include "Window.h"
 
 #include <DirectXMath.h>
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
 
 // Needed for a helper function to load pre-compiled shader files
 #pragma comment(lib, "d3dcompiler.lib")
@@ -16,13 +22,24 @@
 // For the DirectX Math library
 using namespace DirectX;
 
+// Helper macro for getting a float between min and max
+#define RandomRange(min, max) (float)rand() / RAND_MAX * (max - min) + min
+
 // --------------------------------------------------------
 // Called once per program, after the window and graphics API
 // are initialized but before the game loop begins
 // --------------------------------------------------------
 void Game::Initialize()
 {
+	if (bindlessMaterials && !Graphics::SupportsBindless())
+	{
+		printf("Resource binding tier 1 can't index textures bindlessly; using a descriptor table per material\n");
+		bindlessMaterials = false;
+	}
+
 	CreateRootSigAndPipelineState();
+	if (printStats)
+		Graphics::PrintPipelineStats();
 
 	// create meshes
 	meshMap["SM_Cube"] = std::make_shared<Mesh>(FixPath(L"../../Assets/Basic Meshes/cube.obj").c_str());
@@ -30,42 +47,45 @@ void Game::Initialize()
 	meshMap["SM_Sphere"] = std::make_shared<Mesh>(FixPath(L"../../Assets/Basic Meshes/sphere.obj").c_str());
 	meshMap["SM_Torus"] = std::make_shared<Mesh>(FixPath(L"../../Assets/Basic Meshes/torus.obj").c_str());
 	
-	// create materials
-	// wood
-	std::shared_ptr<Material> mat = std::make_shared<Material>(pipelineState, XMFLOAT3(1, 1, 1), XMFLOAT2(1, 1), XMFLOAT2(0, 0));
-	mat->AddTexture(Graphics::LoadTexture(FixPath(L"../../Assets/PBR/wood_albedo.png").c_str()), 0);
-	mat->AddTexture(Graphics::LoadTexture(FixPath(L"../../Assets/PBR/wood_normals.png").c_str()), 1);
-	mat->AddTexture(Graphics::LoadTexture(FixPath(L"../../Assets/PBR/wood_metal.png").c_str()), 2);
-	mat->AddTexture(Graphics::LoadTexture(FixPath(L"../../Assets/PBR/wood_roughness.png").c_str()), 3);
-	mat->FinalizeMaterial();
-	materialMap["M_Wood"] = mat;
-
-	// paint
-	mat = std::make_shared<Material>(pipelineState, XMFLOAT3(1, 1, 1), XMFLOAT2(1, 1), XMFLOAT2(0, 0));
-	mat->AddTexture(Graphics::LoadTexture(FixPath(L"../../Assets/PBR/paint_albedo.png").c_str()), 0);
-	mat->AddTexture(Graphics::LoadTexture(FixPath(L"../../Assets/PBR/paint_normals.png").c_str()), 1);
-	mat->AddTexture(Graphics::LoadTexture(FixPath(L"../../Assets/PBR/paint_metal.png").c_str()), 2);
-	mat->AddTexture(Graphics::LoadTexture(FixPath(L"../../Assets/PBR/paint_roughness.png").c_str()), 3);
-	mat->FinalizeMaterial();
-	materialMap["M_Paint"] = mat;
-
-	// rock
-	mat = std::make_shared<Material>(pipelineState, XMFLOAT3(1, 1, 1), XMFLOAT2(1, 1), XMFLOAT2(0, 0));
-	mat->AddTexture(Graphics::LoadTexture(FixPath(L"../../Assets/PBR/rough_albedo.png").c_str()), 0);
-	mat->AddTexture(Graphics::LoadTexture(FixPath(L"../../Assets/PBR/rough_normals.png").c_str()), 1);
-	mat->AddTexture(Graphics::LoadTexture(FixPath(L"../../Assets/PBR/rough_metal.png").c_str()), 2);
-	mat->AddTexture(Graphics::LoadTexture(FixPath(L"../../Assets/PBR/rough_roughness.png").c_str()), 3);
-	mat->FinalizeMaterial();
-	materialMap["M_Rock"] = mat;
-
-	// scratched
-	mat = std::make_shared<Material>(pipelineState, XMFLOAT3(1, 1, 1), XMFLOAT2(1, 1), XMFLOAT2(0, 0));
-	mat->AddTexture(Graphics::LoadTexture(FixPath(L"../../Assets/PBR/scratched_albedo.png").c_str()), 0);
-	mat->AddTexture(Graphics::LoadTexture(FixPath(L"../../Assets/PBR/scratched_normals.png").c_str()), 1);
-	mat->AddTexture(Graphics::LoadTexture(FixPath(L"../../Assets/PBR/scratched_metal.png").c_str()), 2);
-	mat->AddTexture(Graphics::LoadTexture(FixPath(L"../../Assets/PBR/scratched_roughness.png").c_str()), 3);
-	mat->FinalizeMaterial();
-	materialMap["M_Scratched"] = mat;
+	// create materials, loading all of their textures together
+	// (albedo, normals, metal, roughness for each, in slot order)
+	const char* materialNames[] = { "M_Wood", "M_Paint", "M_Rock", "M_Scratched" };
+	const wchar_t* texturePrefixes[] = { L"wood", L"paint", L"rough", L"scratched" };
+	const wchar_t* textureSuffixes[] = { L"_albedo.png", L"_normals.png", L"_metal.png", L"_roughness.png" };
+
+	std::vector<std::wstring> textureFiles;
+	for (const wchar_t* prefix : texturePrefixes)
+	{
+		for (const wchar_t* suffix : textureSuffixes)
+			textureFiles.push_back(FixPath(std::wstring(L"../../Assets/PBR/") + prefix + suffix));
+	}
+
+	// They're streamed, so only their smallest mips are loaded up front
+	std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> textureSRVs;
+	Graphics::LoadTextures(textureFiles, textureSRVs, true, true);
+
+	for (int m = 0; m < 4; m++)
+	{
+		std::shared_ptr<Material> mat = std::make_shared<Material>(pipelineState, XMFLOAT3(1, 1, 1), XMFLOAT2(1, 1), XMFLOAT2(0, 0));
+		for (int t = 0; t < 4; t++)
+			mat->AddTexture(textureSRVs[m * 4 + t], t);
+		if (!mat->FinalizeMaterial(bindlessMaterials))
+			printf("Error: %s is missing textures, so nothing using it will be drawn\n", materialNames[m]);
+		materialMap[materialNames[m]] = mat;
+	}
+
+	if (bindlessMaterials)
+		CreateMaterialBuffer();
+
+	// Every mesh and texture so far went into one upload batch;
+	// send it off now so the copies overlap the rest of start-up
+	Graphics::FlushUploads();
+	if (printStats)
+		Graphics::PrintTextureStats();
+	if (printStats)
+		Graphics::PrintUploadStats();
+	if (printStats)
+		Graphics::PrintMemoryReport();
 
 	// create entities
 	entities.push_back(Entity(meshMap["SM_Cube"], materialMap["M_Wood"]));
@@ -79,6 +99,21 @@ void Game::Initialize()
 	entities[2].SetWorldTM(Transform(XMFLOAT3(2, 0, 4)));
 	entities[3].SetWorldTM(Transform(XMFLOAT3(6, 0, 4)));
 
+	// Scatter spheres of random sizes around the scene, most of which
+	// end up small enough on screen to draw with a coarser LOD
+	srand(fixedRandomSeed ? randomSeed : (unsigned int)time(0));
+	const char* randomMaterials[] = { "M_Wood", "M_Paint", "M_Rock", "M_Scratched" };
+	for (int i = 0; i < 32; i++)
+	{
+		float size = RandomRange(0.1f, 3.0f);
+		Entity sphere(meshMap["SM_Sphere"], materialMap[randomMaterials[i % 4]]);
+		sphere.SetWorldTM(Transform(
+			XMFLOAT3(RandomRange(-25.0f, 25.0f), RandomRange(0.0f, 3.0f), RandomRange(-25.0f, 25.0f)),
+			XMFLOAT3(0, 0, 0),
+			XMFLOAT3(size, size, size)));
+		entitiesRandom.push_back(sphere);
+	}
+
 	// Create camera
 	cam = Camera();
 
@@ -114,6 +149,35 @@ Game::~Game()
 {
 	// Wait for the GPU before we shut down
 	Graphics::WaitForGPU();
+	Graphics::FreeGpuMemory(materialBuffer);
+}
+
+void Game::SetRandomSeed(unsigned int seed)
+{
+	randomSeed = seed;
+	fixedRandomSeed = true;
+}
+
+void Game::SetPrintStats(bool print)
+{
+	printStats = print;
+}
+
+// --------------------------------------------------------
+// Gives every material a slot in one structured buffer of
+// texture indices and uv settings, which the bindless pixel
+// shader looks up by the index each draw passes in
+// --------------------------------------------------------
+void Game::CreateMaterialBuffer()
+{
+	std::vector<MaterialGPUData> materialData;
+	for (auto& pair : materialMap)
+	{
+		pair.second->SetMaterialIndex((unsigned int)materialData.size());
+		materialData.push_back(pair.second->GetGPUData());
+	}
+
+	materialBuffer = Graphics::CreateStaticBuffer(sizeof(MaterialGPUData), materialData.size(), materialData.data());
 }
 
 // --------------------------------------------------------
@@ -133,41 +197,37 @@ void Game::CreateRootSigAndPipelineState()
 		D3DReadFileToBlob(
 			FixPath(L"VertexShader.cso").c_str(), vertexShaderByteCode.GetAddressOf());
 		D3DReadFileToBlob(
-			FixPath(L"PixelShader.cso").c_str(), pixelShaderByteCode.GetAddressOf());
+			FixPath(bindlessMaterials ? L"PixelShaderBindless.cso" : L"PixelShader.cso").c_str(), pixelShaderByteCode.GetAddressOf());
 	}
 
 	// Input layout
-	const unsigned int inputElementCount = 4;
+	const unsigned int inputElementCount = 3;
 	D3D12_INPUT_ELEMENT_DESC inputElements[inputElementCount] = {};
 	{
 		// Create an input layout that describes the vertex format
 		// used by the vertex shader we're using
 		// - This is used by the pipeline to know how to interpret the raw data
 		// sitting inside a vertex buffer
+		// - Meshes upload PackedVertex data (see Vertex.h), which the
+		// vertex shader decodes back into full precision
 
-		// position
+		// position (xyz within the mesh bounds, w = bitangent sign)
 		inputElements[0].AlignedByteOffset = D3D12_APPEND_ALIGNED_ELEMENT;
-		inputElements[0].Format = DXGI_FORMAT_R32G32B32_FLOAT; // float3
-		inputElements[0].SemanticName = "POSITION";            // must match semantic in shader
-		inputElements[0].SemanticIndex = 0;                    // first POSITION semantic
+		inputElements[0].Format = DXGI_FORMAT_R16G16B16A16_UNORM; // 4 x 16-bit, 0 to 1
+		inputElements[0].SemanticName = "POSITION";                // must match semantic in shader
+		inputElements[0].SemanticIndex = 0;                        // first POSITION semantic
 
-		// normal
+		// octahedral normal (xy) and tangent (zw)
 		inputElements[1].AlignedByteOffset = D3D12_APPEND_ALIGNED_ELEMENT;
-		inputElements[1].Format = DXGI_FORMAT_R32G32B32_FLOAT;
+		inputElements[1].Format = DXGI_FORMAT_R16G16B16A16_SNORM;
 		inputElements[1].SemanticName = "NORMAL";
 		inputElements[1].SemanticIndex = 0;
 
 		// uv
 		inputElements[2].AlignedByteOffset = D3D12_APPEND_ALIGNED_ELEMENT;
-		inputElements[2].Format = DXGI_FORMAT_R32G32_FLOAT;
+		inputElements[2].Format = DXGI_FORMAT_R16G16_FLOAT;
 		inputElements[2].SemanticName = "TEXCOORD";
 		inputElements[2].SemanticIndex = 0;
-
-		// tangent
-		inputElements[3].AlignedByteOffset = D3D12_APPEND_ALIGNED_ELEMENT;
-		inputElements[3].Format = DXGI_FORMAT_R32G32B32_FLOAT;
-		inputElements[3].SemanticName = "TANGENT";
-		inputElements[3].SemanticIndex = 0;
 	}
 
 	// Root Signature
@@ -196,20 +256,44 @@ void Game::CreateRootSigAndPipelineState()
 		srvRange.RegisterSpace = 0;
 		srvRange.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
 
-		// Create the root parameters
-		D3D12_ROOT_PARAMETER rootParams[3] = {};
+		// Bindless: every texture, as one unbounded array in t0, space1
+		if (bindlessMaterials)
+		{
+			srvRange.NumDescriptors = UINT_MAX;
+			srvRange.RegisterSpace = 1;
+		}
 
-		// CBV table param for vertex shader
-		rootParams[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-		rootParams[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
-		rootParams[0].DescriptorTable.NumDescriptorRanges = 1;
-		rootParams[0].DescriptorTable.pDescriptorRanges = &cbvRangeVS;
+		// Create the root parameters (the last two are bindless only)
+		D3D12_ROOT_PARAMETER rootParams[5] = {};
 
-		// CBV table param for pixel shader
-		rootParams[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-		rootParams[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
-		rootParams[1].DescriptorTable.NumDescriptorRanges = 1;
-		rootParams[1].DescriptorTable.pDescriptorRanges = &cbvRangePS;
+		if (rootConstantBuffers)
+		{
+			// Root CBV param for vertex shader (b0)
+			rootParams[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+			rootParams[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+			rootParams[0].Descriptor.ShaderRegister = 0;
+			rootParams[0].Descriptor.RegisterSpace = 0;
+
+			// Root CBV param for pixel shader (b0)
+			rootParams[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+			rootParams[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+			rootParams[1].Descriptor.ShaderRegister = 0;
+			rootParams[1].Descriptor.RegisterSpace = 0;
+		}
+		else
+		{
+			// CBV table param for vertex shader
+			rootParams[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+			rootParams[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+			rootParams[0].DescriptorTable.NumDescriptorRanges = 1;
+			rootParams[0].DescriptorTable.pDescriptorRanges = &cbvRangeVS;
+
+			// CBV table param for pixel shader
+			rootParams[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+			rootParams[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+			rootParams[1].DescriptorTable.NumDescriptorRanges = 1;
+			rootParams[1].DescriptorTable.pDescriptorRanges = &cbvRangePS;
+		}
 
 		// SRV table param
 		rootParams[2].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
@@ -217,6 +301,19 @@ void Game::CreateRootSigAndPipelineState()
 		rootParams[2].DescriptorTable.NumDescriptorRanges = 1;
 		rootParams[2].DescriptorTable.pDescriptorRanges = &srvRange;
 
+		// Material index root constant (b1)
+		rootParams[3].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+		rootParams[3].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+		rootParams[3].Constants.ShaderRegister = 1;
+		rootParams[3].Constants.RegisterSpace = 0;
+		rootParams[3].Constants.Num32BitValues = 1;
+
+		// Material buffer root SRV (t0)
+		rootParams[4].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+		rootParams[4].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+		rootParams[4].Descriptor.ShaderRegister = 0;
+		rootParams[4].Descriptor.RegisterSpace = 0;
+
 		// Create a single static sampler (available to all pixel shaders at the same slot)
 		D3D12_STATIC_SAMPLER_DESC anisoWrap = {};
 		anisoWrap.AddressU = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
@@ -232,32 +329,13 @@ void Game::CreateRootSigAndPipelineState()
 		// Describe the full root signature
 		D3D12_ROOT_SIGNATURE_DESC rootSig = {};
 		rootSig.Flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
-		rootSig.NumParameters = ARRAYSIZE(rootParams);
+		rootSig.NumParameters = bindlessMaterials ? 5 : 3;
 		rootSig.pParameters = rootParams;
 		rootSig.NumStaticSamplers = ARRAYSIZE(samplers);
 		rootSig.pStaticSamplers = samplers;
 
-		ID3DBlob* serializedRootSig = 0;
-		ID3DBlob* errors = 0;
-
-		D3D12SerializeRootSignature(
-			&rootSig,
-			D3D_ROOT_SIGNATURE_VERSION_1,
-			&serializedRootSig,
-			&errors);
-
-		// Check for errors during serialization
-		if (errors != 0)
-		{
-			OutputDebugString((wchar_t*)errors->GetBufferPointer());
-		}
-
-		// Actually create the root sig
-		Graphics::Device->CreateRootSignature(
-			0,
-			serializedRootSig->GetBufferPointer(),
-			serializedRootSig->GetBufferSize(),
-			IID_PPV_ARGS(rootSignature.GetAddressOf()));
+		// Identical root signatures are shared
+		rootSignature = Graphics::GetRootSignature(rootSig);
 	}
 
 	// Pipeline state
@@ -305,10 +383,9 @@ void Game::CreateRootSigAndPipelineState()
 		// -- Misc ---
 		psoDesc.SampleMask = 0xffffffff;
 
-		// Create the pipe state object
-		Graphics::Device->CreateGraphicsPipelineState(
-			&psoDesc,
-			IID_PPV_ARGS(pipelineState.GetAddressOf()));
+		// Create the pipe state object, or load it from the
+		// pipeline library if an earlier run compiled it
+		pipelineState = Graphics::GetPipelineState(psoDesc);
 	}
 
 	// Set up the viewport and scissor rectangle
@@ -385,19 +462,257 @@ void Game::Update(float deltaTime, float totalTime)
 	// Example input checking: Quit if the escape key is pressed
 	if (Input::KeyDown(VK_ESCAPE))
 		Window::Quit();
+
+	// Save the last couple of seconds of frames as Chrome traces:
+	// the frame profile, and every thread's CPU zones
+	if (Input::KeyPress(VK_F9))
+	{
+		std::wstring traceFile = FixPath(L"Profile.json");
+		if (Graphics::ExportProfile(traceFile))
+			printf("Profile written to %ls\n", traceFile.c_str());
+
+		std::wstring zoneFile = FixPath(L"Zones.json");
+		if (CpuZones::ExportChromeTrace(zoneFile))
+			printf("CPU zones written to %ls\n", zoneFile.c_str());
+	}
+
+	// Start or stop writing every frame's times to a CSV file
+	if (Input::KeyPress(VK_F10))
+	{
+		std::wstring csvFile = FixPath(L"FrameTimes.csv");
+		if (Graphics::IsCapturingFrames())
+		{
+			Graphics::StopFrameCapture();
+			printf("Frame times written to %ls\n", csvFile.c_str());
+		}
+		else if (Graphics::StartFrameCapture(csvFile))
+			printf("Capturing frame times to %ls\n", csvFile.c_str());
+	}
 }
 
 
+// --------------------------------------------------------
+// Fills the pixel shader's constant buffer (lights, camera
+// and the given uv settings) and binds it to root parameter 1.
+// Returns false, binding nothing, if there was no room for it
+// this frame, in which case the draws that need it are skipped.
+// --------------------------------------------------------
+bool Game::SetPixelShaderData(ID3D12GraphicsCommandList* commandList, Graphics::FrameUploadRange* uploads,
+	DirectX::XMFLOAT2 uvScale, DirectX::XMFLOAT2 uvOffset)
+{
+	PSExternalData psData = {};
+	psData.uvScale = uvScale;
+	psData.uvOffset = uvOffset;
+	psData.cameraPosition = cam.GetTransform().GetPosition();
+	psData.ambient = XMFLOAT4(0.02f, 0.02f, 0.02f, 1);
+	psData.lightCount = (unsigned int)lights.size();
+
+	memcpy(psData.lights, &lights[0], sizeof(Light) * MAX_LIGHTS);
+
+	// Send this to this frame's upload memory and set it for this draw
+	// Note: This assumes that root parameter 1 is the
+	// place to put this particular constant buffer. This
+	// is based on how we set up our root signature.
+	if (rootConstantBuffers)
+	{
+		D3D12_GPU_VIRTUAL_ADDRESS cbAddressPS =
+			Graphics::FillNextConstantBufferAndGetGPUAddress(
+				(void*)(&psData), sizeof(PSExternalData), uploads);
+		if (cbAddressPS == 0)
+			return false;
+		commandList->SetGraphicsRootConstantBufferView(1, cbAddressPS);
+	}
+	else
+	{
+		D3D12_GPU_DESCRIPTOR_HANDLE cbHandlePS =
+			Graphics::FillNextConstantBufferAndGetGPUDescriptorHandle(
+				(void*)(&psData), sizeof(PSExternalData), uploads);
+		if (cbHandlePS.ptr == 0)
+			return false;
+		commandList->SetGraphicsRootDescriptorTable(1, cbHandlePS);
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Records the draws for part of the draw list into the
+// chunk's command list, after setting all the state they
+// need (command lists don't inherit any from each other).
+// Only the chunk and its own entities are changed, so
+// chunks can be recorded on separate threads at once.
+// --------------------------------------------------------
+void Game::RecordDraws(DrawChunk& chunk, Entity* const* drawList, size_t count, const VSExternalData& frameData)
+{
+	CPU_ZONE("Game::RecordDraws");
+	ID3D12GraphicsCommandList* commandList = chunk.commandList;
+
+	// set descriptor heap for CBVs
+	commandList->SetDescriptorHeaps(1, Graphics::cbvSrvDescriptorHeap.GetAddressOf());
+
+	// Root sig (must happen before root descriptor table)
+	commandList->SetGraphicsRootSignature(rootSignature.Get());
+
+	// Set up other commands for rendering
+	commandList->OMSetRenderTargets(
+		1, &Graphics::RTVHandles[Graphics::SwapChainIndex()], true, &Graphics::DSVHandle);
+	commandList->RSSetViewports(1, &viewport);
+	commandList->RSSetScissorRects(1, &scissorRect);
+	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	// Bindless: the PS data is the same for every draw, and every texture
+	// and material is already in the heap and material buffer, so they're
+	// all bound once here (uv settings come from the material buffer)
+	if (bindlessMaterials)
+	{
+		if (!SetPixelShaderData(commandList, &chunk.uploads, XMFLOAT2(1, 1), XMFLOAT2(0, 0)))
+			return;
+		commandList->SetGraphicsRootDescriptorTable(2, Graphics::GetBindlessTextureTable());
+		commandList->SetGraphicsRootShaderResourceView(4,
+			materialBuffer.resource->GetGPUVirtualAddress() + materialBuffer.offset);
+	}
+
+	VSExternalData data = frameData;
+	XMFLOAT3 cameraPosition = cam.GetTransform().GetPosition();
+	for (size_t i = 0; i < count; i++)
+	{
+		Entity& e = *drawList[i];
+		const std::shared_ptr<Mesh>& mesh = e.GetMesh();
+
+		// VS data
+		{
+			data.world = e.GetWorldTM().GetWorldMatrix();
+			XMMATRIX worldM = XMLoadFloat4x4(&data.world);
+			XMStoreFloat4x4(&data.worldInverseTranspose, XMMatrixInverse(0, XMMatrixTranspose(worldM)));
+
+			PositionQuantization quantization = mesh->GetPositionQuantization();
+			data.positionScale = quantization.scale;
+			data.positionOffset = quantization.offset;
+
+			// copy VS data into this frame's upload memory and bind it,
+			// either directly or through a CBV in a descriptor table
+			// (skipping the entity if this frame has run out of room)
+			if (rootConstantBuffers)
+			{
+				D3D12_GPU_VIRTUAL_ADDRESS cbAddress = Graphics::FillNextConstantBufferAndGetGPUAddress(&data, sizeof(data), &chunk.uploads);
+				if (cbAddress == 0)
+					continue;
+				commandList->SetGraphicsRootConstantBufferView(0, cbAddress);
+			}
+			else
+			{
+				D3D12_GPU_DESCRIPTOR_HANDLE cbvHandle = Graphics::FillNextConstantBufferAndGetGPUDescriptorHandle(&data, sizeof(data), &chunk.uploads);
+				if (cbvHandle.ptr == 0)
+					continue;
+				commandList->SetGraphicsRootDescriptorTable(0, cbvHandle);
+			}
+		}
+
+		// set VB and IB once, since every sub-mesh shares them
+		D3D12_VERTEX_BUFFER_VIEW vbView = mesh->GetVertexBufferView();
+		D3D12_INDEX_BUFFER_VIEW ibView = mesh->GetIndexBufferView();
+		commandList->IASetVertexBuffers(0, 1, &vbView);
+		commandList->IASetIndexBuffer(&ibView);
+		bool meshIndicesBound = true;
+
+		// pick the coarsest LOD that stays within a pixel of the full mesh
+		XMFLOAT3 sphereCenter;
+		float sphereRadius;
+		e.GetWorldBoundingSphere(sphereCenter, sphereRadius);
+		float screenRadius = LodSelector::ScreenRadius(sphereCenter, sphereRadius,
+			data.view, data.proj, cam.viewDimensions.y);
+
+		const std::vector<MeshLod>& lods = mesh->GetLods();
+		const MeshletData& meshlets = mesh->GetMeshlets();
+		Material* boundMat = 0;
+
+		for (const SubMesh& subMesh : mesh->GetSubMeshes())
+		{
+			if (subMesh.indexCount == 0)
+				continue;
+
+			// Only rebind material state when it actually changes
+			Material* mat = e.GetMaterial(subMesh.materialSlot).get();
+			if (!mat->IsReady())
+				continue;
+			if (mat != boundMat)
+			{
+				boundMat = mat;
+				chunk.textureRequests.push_back({ mat, screenRadius * 2.0f });
+
+				// Bindless materials only need their index, since the
+				// PS data and every texture are already bound
+				if (bindlessMaterials)
+					commandList->SetGraphicsRoot32BitConstant(3, mat->GetMaterialIndex(), 0);
+				else if (!SetPixelShaderData(commandList, &chunk.uploads, mat->GetUVScale(), mat->GetUVOffset()))
+				{
+					boundMat = 0;
+					continue;
+				}
+
+				// Set overall pipeline state
+				commandList->SetPipelineState(mat->GetPipelineState().Get());
+
+				// Set the SRV descriptor handle for this material's textures
+				// Note: This assumes that descriptor table 2 is for textures (as per our root sig)
+				if (!bindlessMaterials)
+					commandList->SetGraphicsRootDescriptorTable(2, mat->GetFinalGPUHandleForSRVs());
+			}
+
+			unsigned int lodIndex = LodSelector::Select(&lods[subMesh.lodOffset], subMesh.lodCount, mesh->GetBoundsRadius(), screenRadius);
+			const MeshLod& lod = lods[subMesh.lodOffset + lodIndex];
+
+			// At full detail, dense sub-meshes only draw the meshlets
+			// that are on screen and facing the camera
+			if (lodIndex == 0 && subMesh.meshletCount > 0)
+			{
+				MeshletCullView cullView = Meshlets::MakeCullView(data.world, data.view, data.proj, cameraPosition);
+				Meshlets::Cull(meshlets, subMesh.meshletOffset, subMesh.meshletCount, cullView, chunk.culledIndices, &chunk.meshletStats);
+
+				if (chunk.culledIndices.size() <= Graphics::maxDynamicIndices)
+				{
+					if (!chunk.culledIndices.empty())
+					{
+						D3D12_INDEX_BUFFER_VIEW culledView = Graphics::FillNextIndexBufferAndGetView(
+							chunk.culledIndices.data(), (unsigned int)chunk.culledIndices.size(), &chunk.uploads);
+						commandList->IASetIndexBuffer(&culledView);
+						commandList->DrawIndexedInstanced((unsigned int)chunk.culledIndices.size(), 1, 0, 0, 0);
+						meshIndicesBound = false;
+					}
+					continue;
+				}
+			}
+
+			if (!meshIndicesBound)
+			{
+				commandList->IASetIndexBuffer(&ibView);
+				meshIndicesBound = true;
+			}
+
+			// draw
+			commandList->DrawIndexedInstanced(lod.indexCount, 1, lod.indexOffset, 0, 0);
+		}
+	}
+}
+
 // --------------------------------------------------------
 // Clear the screen, redraw everything, present to the user
 // --------------------------------------------------------
 void Game::Draw(float deltaTime, float totalTime)
 {
+	Graphics::BeginProfiledFrame();
+
+	// Swap in any texture mips that finished streaming, and
+	// start on what last frame's draws asked for
+	Graphics::BeginCpuScope("Texture streaming");
+	Graphics::UpdateTextureStreaming();
+	Graphics::EndCpuScope();
+
 	// Grab the current back buffer for this frame
 	Microsoft::WRL::ComPtr<ID3D12Resource> currentBackBuffer =
 		Graphics::BackBuffers[Graphics::SwapChainIndex()];
 
 	// Clearing the render target
+	Graphics::BeginGpuScope("Clear");
 	{
 		// Transition the back buffer from present to render target
 		D3D12_RESOURCE_BARRIER rb = {};
@@ -426,83 +741,88 @@ void Game::Draw(float deltaTime, float totalTime)
 			0,                      // Not clearing stencil, but need a value
 			0, 0);                  // No scissor rects
 	}
+	Graphics::EndGpuScope();
 
-	// Rendering here!
+	// Rendering here! The GPU scope starts in CommandList and
+	// ends in the last list that draws (see Present below)
+	unsigned int recordingListCount = 0;
+	Graphics::BeginGpuScope("Entities");
+	Graphics::BeginCpuScope("Record entities");
 	{
-		// set descriptor heap for CBVs
-		Graphics::CommandList->SetDescriptorHeaps(1, Graphics::cbvSrvDescriptorHeap.GetAddressOf());
-
-		// Root sig (must happen before root descriptor table)
-		Graphics::CommandList->SetGraphicsRootSignature(rootSignature.Get());
-
-		// Set up other commands for rendering
-		Graphics::CommandList->OMSetRenderTargets(
-			1, &Graphics::RTVHandles[Graphics::SwapChainIndex()], true, &Graphics::DSVHandle);
-		Graphics::CommandList->RSSetViewports(1, &viewport);
-		Graphics::CommandList->RSSetScissorRects(1, &scissorRect);
-		Graphics::CommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
 		VSExternalData data = {};
 		data.proj = cam.GetProjection();
 		data.view = cam.GetView();
 
 		// render entities
-		for (Entity& e : entities)
-		{
-			std::shared_ptr<Mesh> mesh = e.GetMesh();
-			std::shared_ptr<Material> mat = e.GetMaterial();
-
-			// VS data
+		std::vector<Entity*> drawList;
+		for (Entity& e : entities) drawList.push_back(&e);
+		for (Entity& e : entitiesRandom) drawList.push_back(&e);
+
+		// Split the list into contiguous chunks, one per thread. A lone
+		// chunk is recorded right into the main command list; otherwise
+		// each gets its own list, executed after it in chunk order.
+		unsigned int maxThreads = recordingThreads > 0 ? recordingThreads : Parallel::HardwareThreads();
+		if (maxThreads > Graphics::MaxRecordingThreads)
+			maxThreads = Graphics::MaxRecordingThreads;
+		size_t chunkCount = (drawList.size() + minEntitiesPerRecordingThread - 1) / minEntitiesPerRecordingThread;
+		chunkCount = std::clamp<size_t>(chunkCount, 1, maxThreads);
+		size_t chunkSize = (drawList.size() + chunkCount - 1) / chunkCount;
+		if (drawChunks.size() < chunkCount)
+			drawChunks.resize(chunkCount);
+
+		Parallel::Run(chunkCount, [&](size_t c)
 			{
-				data.world = e.GetWorldTM().GetWorldMatrix();
-				XMMATRIX worldM = XMLoadFloat4x4(&data.world);
-				XMStoreFloat4x4(&data.worldInverseTranspose, XMMatrixInverse(0, XMMatrixTranspose(worldM)));
-
-				// copy VS data into CB ring buffer and set root descriptor table to it
-				D3D12_GPU_DESCRIPTOR_HANDLE cbvHandle = Graphics::FillNextConstantBufferAndGetGPUDescriptorHandle(&data, sizeof(data));
-				Graphics::CommandList->SetGraphicsRootDescriptorTable(0, cbvHandle);
-			}
-
-			// PS data and cbuffer setup
-			{
-				PSExternalData psData = {};
-				psData.uvScale = mat->GetUVScale();
-				psData.uvOffset = mat->GetUVOffset();
-				psData.cameraPosition = cam.GetTransform().GetPosition();
-				psData.ambient = XMFLOAT4(0.02f, 0.02f, 0.02f, 1);
-				psData.lightCount = (unsigned int)lights.size();
-
-				memcpy(psData.lights, &lights[0], sizeof(Light) * MAX_LIGHTS);
-
-				// Send this to a chunk of the constant buffer heap
-				// and grab the GPU handle for it so we can set it for this draw
-				D3D12_GPU_DESCRIPTOR_HANDLE cbHandlePS =
-					Graphics::FillNextConstantBufferAndGetGPUDescriptorHandle(
-						(void*)(&psData), sizeof(PSExternalData));
-
-				// Set this constant buffer handle
-				// Note: This assumes that descriptor table 1 is the
-				// place to put this particular descriptor. This
-				// is based on how we set up our root signature.
-				Graphics::CommandList->SetGraphicsRootDescriptorTable(1, cbHandlePS);
-			}
-
-			// Set overall pipeline state
-			Graphics::CommandList->SetPipelineState(mat->GetPipelineState().Get());
-
-			// Set the SRV descriptor handle for this material's textures
-			// Note: This assumes that descriptor table 2 is for textures (as per our root sig)
-			Graphics::CommandList->SetGraphicsRootDescriptorTable(2, mat->GetFinalGPUHandleForSRVs());
-
-			// set VB and IB
-			D3D12_VERTEX_BUFFER_VIEW vbView = mesh->GetVertexBufferView();
-			D3D12_INDEX_BUFFER_VIEW ibView = mesh->GetIndexBufferView();
-			Graphics::CommandList->IASetVertexBuffers(0, 1, &vbView);
-			Graphics::CommandList->IASetIndexBuffer(&ibView);
+				DrawChunk& chunk = drawChunks[c];
+				chunk.commandList = chunkCount > 1 ?
+					Graphics::ResetRecordingCommandList((unsigned int)c) :
+					Graphics::CommandList.Get();
+				chunk.uploads = Graphics::FrameUploadRange();
+
+				size_t first = c * chunkSize;
+				size_t count = first < drawList.size() ? drawList.size() - first : 0;
+				RecordDraws(chunk, drawList.data() + first, count < chunkSize ? count : chunkSize, data);
+			});
+		recordingListCount = chunkCount > 1 ? (unsigned int)chunkCount : 0;
+
+		// Texture streaming and culling stats aren't thread safe,
+		// so the chunks hand theirs over here
+		for (size_t c = 0; c < chunkCount; c++)
+		{
+			DrawChunk& chunk = drawChunks[c];
+			for (auto& request : chunk.textureRequests)
+				request.first->RequestTextureDetail(request.second);
+			chunk.textureRequests.clear();
+
+			meshletStats.meshlets += chunk.meshletStats.meshlets;
+			meshletStats.frustumCulled += chunk.meshletStats.frustumCulled;
+			meshletStats.backfaceCulled += chunk.meshletStats.backfaceCulled;
+			meshletStats.triangles += chunk.meshletStats.triangles;
+			meshletStats.trianglesDrawn += chunk.meshletStats.trianglesDrawn;
+			chunk.meshletStats = MeshletCullStats();
+		}
+	}
+	Graphics::EndCpuScope();
 
-			// draw
-			Graphics::CommandList->DrawIndexedInstanced(mesh->GetIndexCount(), 1, 0, 0, 0);
+	// Report how much meshlet culling saved, and how much
+	// per-frame memory is in use, and how frames are paced, every few seconds
+	if (totalTime - meshletStatsTime >= 5.0f)
+	{
+		if (Mesh::GetPrintLoadStats() && meshletStats.meshlets > 0)
+			Meshlets::PrintStats(meshletStats);
+		if (printStats)
+		{
+			Graphics::PrintFrameMemoryStats();
+			Graphics::PrintTextureStreamingStats();
+			Graphics::PrintFramePacingStats();
+			Graphics::PrintFrameStats();
 		}
+		if (Graphics::GetPrintProfileStats())
+		{
+			Graphics::PrintProfileStats();
+			CpuZones::PrintStats();
+		}
+		meshletStats = MeshletCullStats();
+		meshletStatsTime = totalTime;
 	}
 
 	// Present
@@ -515,19 +835,32 @@ void Game::Draw(float deltaTime, float totalTime)
 		rb.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
 		rb.Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
 		rb.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-		Graphics::CommandList->ResourceBarrier(1, &rb);
+
+		// It has to come after the draws, so it goes at the end of the last list
+		ID3D12GraphicsCommandList* lastList = recordingListCount > 0 ?
+			Graphics::RecordingCommandLists[recordingListCount - 1].Get() :
+			Graphics::CommandList.Get();
+		Graphics::EndGpuScope(lastList);
+		lastList->ResourceBarrier(1, &rb);
+		Graphics::EndProfiledFrame(lastList);
 
 		// Must occur BEFORE present
-		Graphics::CloseAndExecuteCommandList();
+		Graphics::CloseAndExecuteCommandList(recordingListCount);
 
 		// Present the current back buffer and move to the next one
 		bool vsync = Graphics::VsyncState();
-		Graphics::SwapChain->Present(
-			vsync ? 1 : 0,
-			vsync ? 0 : DXGI_PRESENT_ALLOW_TEARING);
-		Graphics::AdvanceSwapChainIndex();
+		{
+			CPU_ZONE("Present");
+			Graphics::SwapChain->Present(
+				vsync ? 1 : 0,
+				vsync ? 0 : DXGI_PRESENT_ALLOW_TEARING);
+		}
+		{
+			CPU_ZONE("Wait for next frame");
+			Graphics::AdvanceSwapChainIndex();
+		}
 
 		// Work ahead on the next frame; program will halt only if CPU is too far ahead of GPU
-		Graphics::ResetAllocatorAndCommandList(Graphics::SwapChainIndex());
+		Graphics::ResetAllocatorAndCommandList(Graphics::FrameSlot());
 	}
 }
\ No newline at end of file
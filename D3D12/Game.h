@@ -6,9 +6,13 @@
 #include <unordered_map>
 #include <string>
 
+#include "BufferStructs.h"
 #include "Camera.h"
 #include "Entity.h"
+#include "GpuMemory.h"
+#include "Graphics.h"
 #include "Light.h"
+#include "Meshlets.h"
 
 class Game
 {
@@ -25,11 +29,57 @@ public:
 	void Draw(float deltaTime, float totalTime);
 	void OnResize();
 
+	// Scatters the scene's random spheres from this seed instead of
+	// the clock, so runs can be repeated. Call before Initialize().
+	void SetRandomSeed(unsigned int seed);
+
+	// Print the engine's start-up reports and its periodic frame
+	// reports to the console. Off unless turned on.
+	void SetPrintStats(bool print);
+
 private:
 
+	bool fixedRandomSeed = false;
+	unsigned int randomSeed = 0;
+	bool printStats = false;
+
 	// Initialization helper methods - feel free to customize, combine, remove, etc.
 	void CreateRootSigAndPipelineState();
 
+	// Binds per-draw constant buffers as root CBVs (just a GPU address)
+	// instead of creating a CBV for each one and binding a descriptor
+	// table. Textures always use a table. Set to false to compare.
+	bool rootConstantBuffers = true;
+
+	// Puts every texture SRV in one unbounded table and every material
+	// in a structured buffer, so draws only set a material index (a root
+	// constant). Set to false for a descriptor table per material, which
+	// is also what hardware below resource binding tier 2 falls back to.
+	bool bindlessMaterials = true;
+	GpuAllocation materialBuffer;
+	void CreateMaterialBuffer();
+
+	// Splits the draw list into contiguous chunks, each recorded on its
+	// own thread into its own command list (0 means one per core, up to
+	// Graphics::MaxRecordingThreads). Small scenes stay on one thread.
+	unsigned int recordingThreads = 0;
+	const unsigned int minEntitiesPerRecordingThread = 256;
+
+	// What each thread recording a chunk of the draw list keeps to itself,
+	// merged back (or applied) on the main thread once they're all done
+	struct DrawChunk
+	{
+		ID3D12GraphicsCommandList* commandList = 0;
+		Graphics::FrameUploadRange uploads;
+		std::vector<unsigned int> culledIndices;
+		MeshletCullStats meshletStats;
+		std::vector<std::pair<Material*, float>> textureRequests;
+	};
+	std::vector<DrawChunk> drawChunks;
+	void RecordDraws(DrawChunk& chunk, Entity* const* drawList, size_t count, const VSExternalData& frameData);
+	bool SetPixelShaderData(ID3D12GraphicsCommandList* commandList, Graphics::FrameUploadRange* uploads,
+		DirectX::XMFLOAT2 uvScale, DirectX::XMFLOAT2 uvOffset);
+
 	// Note the usage of ComPtr below
 	//  - This is a smart pointer for objects that abide by the
 	//     Component Object Model, which DirectX objects do
@@ -45,8 +95,13 @@ private:
 
 	Camera cam;
 	std::vector<Entity> entities;
+	std::vector<Entity> entitiesRandom;
 	std::unordered_map<std::string, std::shared_ptr<Mesh>> meshMap;
 	std::unordered_map<std::string, std::shared_ptr<Material>> materialMap;
 	std::vector<Light> lights;
+
+	// Meshlet culling running totals
+	MeshletCullStats meshletStats;
+	float meshletStatsTime = 0.0f;
 };
 
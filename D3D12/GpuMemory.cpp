@@ -0,0 +1,297 @@
+#include "GpuMemory.h"
+
+#include <cstdio>
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// Small buffers are aligned for anything a buffer can be used as
+	const UINT64 SmallBufferAlignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+
+	inline UINT64 AlignUp(UINT64 value, UINT64 alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	D3D12_RESOURCE_DESC BufferDesc(UINT64 size)
+	{
+		D3D12_RESOURCE_DESC desc = {};
+		desc.Alignment = 0;
+		desc.DepthOrArraySize = 1;
+		desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+		desc.Format = DXGI_FORMAT_UNKNOWN;
+		desc.Height = 1;
+		desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		desc.MipLevels = 1;
+		desc.SampleDesc.Count = 1;
+		desc.SampleDesc.Quality = 0;
+		desc.Width = size;
+		return desc;
+	}
+}
+
+GpuMemory::GpuMemory(ID3D12Device* device, UINT64 heapSize)
+{
+	this->device = device;
+	this->heapSize = AlignUp(heapSize, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+
+	pools[SmallBuffers].name = "Small buffers";
+	pools[SmallBuffers].flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+	pools[LargeBuffers].name = "Large buffers";
+	pools[LargeBuffers].flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+	pools[Textures].name = "Textures";
+	pools[Textures].flags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+
+	for (Pool& pool : pools)
+	{
+		pool.heapsCreated = 0;
+		pool.heapsReleased = 0;
+	}
+}
+
+// --------------------------------------------------------
+// Small buffers become a range of their heap's shared
+// buffer, and larger ones a placed buffer of their own.
+// Either way the resource starts out in the common state,
+// which buffers can be promoted out of on any queue.
+// --------------------------------------------------------
+GpuAllocation GpuMemory::CreateBuffer(UINT64 size)
+{
+	GpuAllocation allocation;
+	if (size <= SmallBufferLimit)
+	{
+		if (!Allocate(SmallBuffers, size, SmallBufferAlignment, allocation))
+			return allocation;
+
+		allocation.resource = pools[SmallBuffers].heaps[allocation.block]->buffer;
+		allocation.offset = allocation.range.offset;
+	}
+	else
+	{
+		if (!Allocate(LargeBuffers, size, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, allocation))
+			return allocation;
+
+		D3D12_RESOURCE_DESC desc = BufferDesc(size);
+		HRESULT result = device->CreatePlacedResource(
+			pools[LargeBuffers].heaps[allocation.block]->heap.Get(),
+			allocation.range.offset,
+			&desc,
+			D3D12_RESOURCE_STATE_COMMON,
+			0,
+			IID_PPV_ARGS(allocation.resource.GetAddressOf()));
+
+		if (FAILED(result))
+		{
+			Free(allocation);
+			return allocation;
+		}
+	}
+
+	allocation.size = size;
+	return allocation;
+}
+
+// --------------------------------------------------------
+// Places a texture, using the small (4 KB) alignment when
+// the device allows it for this texture, which saves most
+// of the space a small texture would otherwise waste
+// --------------------------------------------------------
+GpuAllocation GpuMemory::CreateTexture(const D3D12_RESOURCE_DESC& desc, D3D12_RESOURCE_STATES initialState)
+{
+	D3D12_RESOURCE_DESC placed = desc;
+	placed.Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+	D3D12_RESOURCE_ALLOCATION_INFO info = device->GetResourceAllocationInfo(0, 1, &placed);
+	if (info.Alignment != D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT)
+	{
+		placed.Alignment = 0;
+		info = device->GetResourceAllocationInfo(0, 1, &placed);
+	}
+
+	GpuAllocation allocation;
+	if (!Allocate(Textures, info.SizeInBytes, info.Alignment, allocation))
+		return allocation;
+
+	HRESULT result = device->CreatePlacedResource(
+		pools[Textures].heaps[allocation.block]->heap.Get(),
+		allocation.range.offset,
+		&placed,
+		initialState,
+		0,
+		IID_PPV_ARGS(allocation.resource.GetAddressOf()));
+
+	if (FAILED(result))
+	{
+		Free(allocation);
+		return allocation;
+	}
+
+	allocation.size = info.SizeInBytes;
+	return allocation;
+}
+
+// --------------------------------------------------------
+// Returns an allocation's range to its heap. Heaps left
+// empty are released, except for the last one in a pool,
+// which stays around for whatever comes next.
+// --------------------------------------------------------
+void GpuMemory::Free(GpuAllocation& allocation)
+{
+	// Placed resources have to go before their memory does
+	allocation.resource.Reset();
+
+	if (allocation.range.block != TlsfAllocation().block &&
+		allocation.pool < PoolCount &&
+		allocation.block < pools[allocation.pool].heaps.size() &&
+		pools[allocation.pool].heaps[allocation.block])
+	{
+		Pool& pool = pools[allocation.pool];
+		Heap& heap = *pool.heaps[allocation.block];
+		heap.allocator.Free(allocation.range);
+
+		if (heap.allocator.IsEmpty())
+		{
+			size_t heapsInUse = 0;
+			for (const std::unique_ptr<Heap>& other : pool.heaps)
+			{
+				if (other && !other->dedicated)
+					heapsInUse++;
+			}
+
+			if (heap.dedicated || heapsInUse > 1)
+			{
+				pool.heaps[allocation.block].reset();
+				pool.heapsReleased++;
+			}
+		}
+	}
+
+	allocation = GpuAllocation();
+}
+
+void GpuMemory::PrintReport()
+{
+	const double MB = 1024.0 * 1024.0;
+	UINT64 totalReserved = 0;
+	UINT64 totalUsed = 0;
+
+	printf("GPU memory:\n");
+	for (Pool& pool : pools)
+	{
+		size_t heapCount = 0;
+		TlsfStats poolStats;
+		for (const std::unique_ptr<Heap>& heap : pool.heaps)
+		{
+			if (!heap)
+				continue;
+
+			TlsfStats stats = heap->allocator.GetStats();
+			poolStats.capacity += stats.capacity;
+			poolStats.usedBytes += stats.usedBytes;
+			poolStats.freeBytes += stats.freeBytes;
+			if (stats.largestFree > poolStats.largestFree)
+				poolStats.largestFree = stats.largestFree;
+			poolStats.allocations += stats.allocations;
+			poolStats.freeRanges += stats.freeRanges;
+			heapCount++;
+		}
+
+		printf("  %-14s %zu heaps (%zu created, %zu released), %.2f MB reserved, %.2f MB used by %zu allocations\n",
+			pool.name, heapCount, pool.heapsCreated, pool.heapsReleased,
+			poolStats.capacity / MB, poolStats.usedBytes / MB, poolStats.allocations);
+		printf("  %-14s %.2f MB free in %zu ranges, largest %.2f MB, fragmentation %.1f%%\n",
+			"", poolStats.freeBytes / MB, poolStats.freeRanges, poolStats.largestFree / MB,
+			poolStats.Fragmentation() * 100.0f);
+
+		totalReserved += poolStats.capacity;
+		totalUsed += poolStats.usedBytes;
+	}
+
+	printf("  Total: %.2f MB reserved, %.2f MB used\n", totalReserved / MB, totalUsed / MB);
+}
+
+// --------------------------------------------------------
+// Finds room in an existing heap of the pool, or creates
+// another one. Anything too big for a regular heap gets a
+// dedicated heap sized to fit.
+// --------------------------------------------------------
+bool GpuMemory::Allocate(PoolType type, UINT64 size, UINT64 alignment, GpuAllocation& allocation)
+{
+	Pool& pool = pools[type];
+	allocation.pool = type;
+
+	if (size <= heapSize)
+	{
+		for (unsigned int i = 0; i < pool.heaps.size(); i++)
+		{
+			Heap* heap = pool.heaps[i].get();
+			if (heap && !heap->dedicated && heap->allocator.Allocate(size, alignment, allocation.range))
+			{
+				allocation.block = i;
+				return true;
+			}
+		}
+	}
+
+	unsigned int index = 0;
+	UINT64 newHeapSize = size > heapSize ? AlignUp(size, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT) : heapSize;
+	Heap* heap = CreateHeap(pool, newHeapSize, index);
+	if (!heap || !heap->allocator.Allocate(size, alignment, allocation.range))
+		return false;
+
+	heap->dedicated = size > heapSize;
+	allocation.block = index;
+	return true;
+}
+
+GpuMemory::Heap* GpuMemory::CreateHeap(Pool& pool, UINT64 size, unsigned int& index)
+{
+	std::unique_ptr<Heap> heap = std::make_unique<Heap>();
+	heap->dedicated = false;
+
+	D3D12_HEAP_DESC desc = {};
+	desc.SizeInBytes = size;
+	desc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+	desc.Properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	desc.Properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	desc.Properties.CreationNodeMask = 1;
+	desc.Properties.VisibleNodeMask = 1;
+	desc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+	desc.Flags = pool.flags;
+
+	if (FAILED(device->CreateHeap(&desc, IID_PPV_ARGS(heap->heap.GetAddressOf()))))
+		return 0;
+
+	// Small buffers are all ranges of one buffer covering the whole heap
+	if (&pool == &pools[SmallBuffers])
+	{
+		D3D12_RESOURCE_DESC bufferDesc = BufferDesc(size);
+		HRESULT result = device->CreatePlacedResource(
+			heap->heap.Get(),
+			0,
+			&bufferDesc,
+			D3D12_RESOURCE_STATE_COMMON,
+			0,
+			IID_PPV_ARGS(heap->buffer.GetAddressOf()));
+
+		if (FAILED(result))
+			return 0;
+	}
+
+	heap->allocator.Reset(size);
+	pool.heapsCreated++;
+
+	// Reuse an empty slot if there is one, so existing indices stay put
+	for (index = 0; index < pool.heaps.size(); index++)
+	{
+		if (!pool.heaps[index])
+			break;
+	}
+
+	if (index == pool.heaps.size())
+		pool.heaps.emplace_back();
+
+	pool.heaps[index] = std::move(heap);
+	return pool.heaps[index].get();
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <Windows.h>
+#include <d3d12.h>
+#include <memory>
+#include <vector>
+#include <wrl/client.h>
+#include "TlsfAllocator.h"
+
+// A buffer or texture living in one of GpuMemory's heaps. Small
+// buffers share a resource with others, starting at offset.
+struct GpuAllocation
+{
+	Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+	UINT64 offset = 0;
+	UINT64 size = 0;
+
+	// Where the memory came from, so it can be given back
+	unsigned int pool = 0;
+	unsigned int block = 0;
+	TlsfAllocation range;
+};
+
+// --------------------------------------------------------
+// Hands out GPU memory from a few large heaps instead of
+// giving every resource its own committed allocation
+//
+// Heaps on older hardware can only hold one kind of
+// resource, so there's a pool of heaps for each:
+//  - Small buffers are ranges of one big buffer per heap,
+//    so they don't each burn a 64 KB placement slot
+//  - Large buffers are placed buffers, 64 KB aligned
+//  - Textures (other than render targets and depth
+//    buffers) are placed, 4 KB aligned where possible
+//
+// Each heap's space is managed by a TlsfAllocator. Anything
+// bigger than a heap gets a dedicated heap of its own.
+// --------------------------------------------------------
+class GpuMemory
+{
+public:
+
+	// Buffers up to this size share a resource with others
+	static const UINT64 SmallBufferLimit = 1024 * 1024;
+
+	GpuMemory(ID3D12Device* device, UINT64 heapSize);
+	GpuMemory(const GpuMemory&) = delete;
+	GpuMemory& operator=(const GpuMemory&) = delete;
+
+	// Buffers start out in the common state. Returns an empty
+	// allocation (no resource) if there's no memory left.
+	GpuAllocation CreateBuffer(UINT64 size);
+	GpuAllocation CreateTexture(const D3D12_RESOURCE_DESC& desc, D3D12_RESOURCE_STATES initialState);
+
+	// Gives the memory back right away, so the GPU must be done with it.
+	// Allocations that didn't come from here just lose their resource.
+	void Free(GpuAllocation& allocation);
+
+	// Prints how much each pool has reserved, how much of that is in
+	// use, and how badly the free space is split up
+	void PrintReport();
+
+private:
+
+	enum PoolType { SmallBuffers, LargeBuffers, Textures, PoolCount };
+
+	struct Heap
+	{
+		Microsoft::WRL::ComPtr<ID3D12Heap> heap;
+		Microsoft::WRL::ComPtr<ID3D12Resource> buffer;	// Small buffer pool only
+		TlsfAllocator allocator;
+		bool dedicated;
+	};
+
+	struct Pool
+	{
+		const char* name;
+		D3D12_HEAP_FLAGS flags;
+		std::vector<std::unique_ptr<Heap>> heaps;	// Empty slots are reused
+		size_t heapsCreated;
+		size_t heapsReleased;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D12Device> device;
+	UINT64 heapSize;
+	Pool pools[PoolCount];
+
+	bool Allocate(PoolType type, UINT64 size, UINT64 alignment, GpuAllocation& allocation);
+	Heap* CreateHeap(Pool& pool, UINT64 size, unsigned int& index);
+};
@@ -0,0 +1,263 @@
+#include "GpuProfiler.h"
+#include "JsonHelpers.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// One complete ("X") event; times in seconds, written in microseconds
+	void WriteTraceEvent(std::ostream& out, const ProfileScope& scope, const char* category,
+		unsigned int track, unsigned long long frame, double origin)
+	{
+		char times[64];
+		snprintf(times, sizeof(times), "%.3f,\"dur\":%.3f",
+			(scope.start - origin) * 1000000.0, (scope.end - scope.start) * 1000000.0);
+
+		out << ",\n{\"name\":";
+		WriteJsonString(out, scope.name);
+		out << ",\"cat\":\"" << category << "\",\"ph\":\"X\",\"ts\":" << times <<
+			",\"pid\":1,\"tid\":" << track << ",\"args\":{\"frame\":" << frame << "}}";
+	}
+
+	// Averages one tree's scopes over the frames, matching them by
+	// position and name, and prints them indented by depth
+	void PrintScopeTree(const char* title, const std::vector<ProfileFrame>& frames, bool gpu)
+	{
+		const std::vector<ProfileScope>& latest = gpu ? frames.back().gpuScopes : frames.back().cpuScopes;
+		printf("  %s\n", title);
+		for (size_t i = 0; i < latest.size(); i++)
+		{
+			double total = 0;
+			unsigned int count = 0;
+			for (const ProfileFrame& frame : frames)
+			{
+				const std::vector<ProfileScope>& scopes = gpu ? frame.gpuScopes : frame.cpuScopes;
+				if ((gpu && !frame.gpuTimed) || i >= scopes.size() || scopes[i].name != latest[i].name)
+					continue;
+
+				total += scopes[i].end - scopes[i].start;
+				count++;
+			}
+
+			if (count > 0)
+				printf("    %*s%-*s %8.3f ms\n", latest[i].depth * 2, "",
+					24 - (int)latest[i].depth * 2, latest[i].name.c_str(), total * 1000.0 / count);
+		}
+	}
+}
+
+GpuProfiler::GpuProfiler(GpuProfilerDevice* device)
+{
+	this->device = device;
+	inFrame = false;
+	slot = 0;
+	droppedScopes = 0;
+	historyStart = 0;
+	for (bool& pending : slotPending)
+		pending = false;
+}
+
+void GpuProfiler::BeginFrame(unsigned long long frameFence, unsigned int slot, void* commandList)
+{
+	if (inFrame)
+		EndFrame(commandList);
+
+	// Anything the slot still holds was never collected, and its
+	// timestamps are about to be overwritten
+	this->slot = slot % MaxSlots;
+	slotPending[this->slot] = false;
+
+	current = ProfileFrame();
+	current.frame = frameFence;
+	cpuStack.clear();
+	gpuStack.clear();
+	inFrame = true;
+
+	BeginCpuScope("Frame");
+	BeginGpuScope("Frame", commandList);
+}
+
+void GpuProfiler::EndFrame(void* commandList)
+{
+	if (!inFrame)
+		return;
+
+	while (!cpuStack.empty())
+		EndCpuScope();
+	while (!gpuStack.empty())
+		EndGpuScope(commandList);
+
+	device->ResolveTimestamps(commandList, slot, (unsigned int)current.gpuScopes.size() * 2);
+	slotFrames[slot] = std::move(current);
+	slotPending[slot] = true;
+	inFrame = false;
+}
+
+void GpuProfiler::Collect(unsigned long long completedFence)
+{
+	// Slots aren't always finished in order, so sort them
+	ProfileFrame* finished[MaxSlots];
+	unsigned int finishedCount = 0;
+	for (unsigned int s = 0; s < MaxSlots; s++)
+	{
+		if (!slotPending[s] || slotFrames[s].frame > completedFence)
+			continue;
+
+		ProfileFrame& frame = slotFrames[s];
+		std::vector<double> times(frame.gpuScopes.size() * 2);
+		frame.gpuTimed = device->ReadTimestamps(s, (unsigned int)times.size(), times.data());
+		for (size_t i = 0; frame.gpuTimed && i < frame.gpuScopes.size(); i++)
+		{
+			frame.gpuScopes[i].start = times[2 * i];
+			frame.gpuScopes[i].end = times[2 * i + 1];
+		}
+
+		finished[finishedCount++] = &frame;
+		slotPending[s] = false;
+	}
+	std::sort(finished, finished + finishedCount,
+		[](const ProfileFrame* a, const ProfileFrame* b) { return a->frame < b->frame; });
+
+	for (unsigned int i = 0; i < finishedCount; i++)
+	{
+		if (history.size() < HistoryLength)
+		{
+			history.push_back(std::move(*finished[i]));
+		}
+		else
+		{
+			history[historyStart] = std::move(*finished[i]);
+			historyStart = (historyStart + 1) % HistoryLength;
+		}
+	}
+}
+
+void GpuProfiler::BeginCpuScope(const char* name)
+{
+	if (!inFrame)
+		return;
+
+	ProfileScope scope;
+	scope.name = name;
+	scope.parent = cpuStack.empty() ? -1 : cpuStack.back();
+	scope.depth = (unsigned int)cpuStack.size();
+	scope.start = device->GetTime();
+	cpuStack.push_back((int)current.cpuScopes.size());
+	current.cpuScopes.push_back(std::move(scope));
+}
+
+void GpuProfiler::EndCpuScope()
+{
+	if (!inFrame || cpuStack.empty())
+		return;
+
+	current.cpuScopes[cpuStack.back()].end = device->GetTime();
+	cpuStack.pop_back();
+}
+
+void GpuProfiler::BeginGpuScope(const char* name, void* commandList)
+{
+	if (!inFrame)
+		return;
+
+	// Past the limit, scopes still nest but aren't timed
+	if (current.gpuScopes.size() >= MaxGpuScopes)
+	{
+		droppedScopes++;
+		gpuStack.push_back(-1);
+		return;
+	}
+
+	// The parent is the nearest enclosing scope that's timed
+	int parent = -1;
+	for (size_t i = gpuStack.size(); i > 0 && parent < 0; i--)
+		parent = gpuStack[i - 1];
+
+	ProfileScope scope;
+	scope.name = name;
+	scope.parent = parent;
+	scope.depth = parent < 0 ? 0 : current.gpuScopes[parent].depth + 1;
+
+	unsigned int index = (unsigned int)current.gpuScopes.size();
+	device->WriteTimestamp(commandList, slot, 2 * index);
+	gpuStack.push_back((int)index);
+	current.gpuScopes.push_back(std::move(scope));
+}
+
+void GpuProfiler::EndGpuScope(void* commandList)
+{
+	if (!inFrame || gpuStack.empty())
+		return;
+
+	int index = gpuStack.back();
+	gpuStack.pop_back();
+	if (index >= 0)
+		device->WriteTimestamp(commandList, slot, 2 * index + 1);
+}
+
+std::vector<ProfileFrame> GpuProfiler::GetHistory()
+{
+	std::vector<ProfileFrame> ordered(history.begin() + historyStart, history.end());
+	ordered.insert(ordered.end(), history.begin(), history.begin() + historyStart);
+	return ordered;
+}
+
+size_t GpuProfiler::GetDroppedScopes() { return droppedScopes; }
+
+// --------------------------------------------------------
+// Every scope is a complete event, so nesting comes from
+// the times alone. Frames without GPU times only add their
+// CPU scopes.
+// --------------------------------------------------------
+void GpuProfiler::WriteChromeTrace(std::ostream& out, const std::vector<ProfileFrame>& frames)
+{
+	double origin = 0;
+	if (!frames.empty() && !frames[0].cpuScopes.empty())
+		origin = frames[0].cpuScopes[0].start;
+
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"D3D12Starter\"}},\n";
+	out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+	out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+
+	for (const ProfileFrame& frame : frames)
+	{
+		for (const ProfileScope& scope : frame.cpuScopes)
+			WriteTraceEvent(out, scope, "CPU", 1, frame.frame, origin);
+
+		if (!frame.gpuTimed)
+			continue;
+		for (const ProfileScope& scope : frame.gpuScopes)
+			WriteTraceEvent(out, scope, "GPU", 2, frame.frame, origin);
+	}
+
+	out << "\n]}\n";
+}
+
+bool GpuProfiler::ExportChromeTrace(const std::filesystem::path& file)
+{
+	std::ofstream out(file, std::ios::trunc);
+	if (!out)
+		return false;
+
+	WriteChromeTrace(out, GetHistory());
+	return (bool)out;
+}
+
+void GpuProfiler::PrintStats()
+{
+	std::vector<ProfileFrame> frames = GetHistory();
+	if (frames.empty())
+		return;
+
+	printf("Profile: average of the last %zu frames\n", frames.size());
+	PrintScopeTree("CPU", frames, false);
+	if (frames.back().gpuTimed)
+		PrintScopeTree("GPU", frames, true);
+	if (droppedScopes > 0)
+		printf("  %zu GPU scopes went untimed, past %u in a frame\n", droppedScopes, MaxGpuScopes);
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// One named span of a frame, on the CPU's clock (in seconds)
+struct ProfileScope
+{
+	std::string name;
+	int parent = -1;		// Index of the enclosing scope, or -1 for the frame itself
+	unsigned int depth = 0;
+	double start = 0;
+	double end = 0;
+};
+
+// A finished frame's scopes, each list in the order they began (so
+// every scope comes after its parent)
+struct ProfileFrame
+{
+	unsigned long long frame = 0;	// The frame's fence value
+	std::vector<ProfileScope> cpuScopes;
+	std::vector<ProfileScope> gpuScopes;
+	bool gpuTimed = false;			// False if the GPU scopes have no times
+};
+
+// --------------------------------------------------------
+// The GPU operations GpuProfiler needs, so its scope tree
+// doesn't depend on D3D12 (see GpuProfilerDeviceD3D12.h)
+// and can run against a fake device.
+//
+// Each frame slot has its own range of timestamps, so a
+// slot's times can be read while later frames write theirs.
+// Command lists are the device's own type, passed through.
+// --------------------------------------------------------
+class GpuProfilerDevice
+{
+public:
+
+	virtual ~GpuProfilerDevice() {}
+
+	// CPU clock, in seconds
+	virtual double GetTime() = 0;
+
+	virtual void WriteTimestamp(void* commandList, unsigned int slot, unsigned int index) = 0;
+
+	// Copies a slot's first count timestamps somewhere the CPU can read
+	// them, once the GPU gets there
+	virtual void ResolveTimestamps(void* commandList, unsigned int slot, unsigned int count) = 0;
+
+	// Reads resolved timestamps, on the CPU clock. Only asked once the
+	// frame that resolved them is finished.
+	virtual bool ReadTimestamps(unsigned int slot, unsigned int count, double* times) = 0;
+};
+
+// --------------------------------------------------------
+// Times nested, named scopes of each frame on the CPU and
+// the GPU
+//
+// CPU and GPU scopes make two separate trees, each under a
+// root "Frame" scope opened by BeginFrame(). GPU scopes
+// write a timestamp into a command list at each end, so a
+// scope can begin in one list and end in a later one run
+// on the same queue. Only the main thread records scopes.
+//
+// EndFrame() resolves the frame's timestamps on the GPU;
+// nothing waits for them. Collect() picks up every frame
+// the GPU has finished since, a frame or few later, and
+// keeps the most recent ones for printing and exporting
+// as a Chrome trace (chrome://tracing or ui.perfetto.dev).
+// --------------------------------------------------------
+class GpuProfiler
+{
+public:
+
+	static const unsigned int MaxSlots = 4;
+	static const unsigned int MaxGpuScopes = 64;	// Per frame; more are ignored
+	static const unsigned int HistoryLength = 120;
+
+	GpuProfiler(GpuProfilerDevice* device);
+
+	// Starts a frame that will use the given slot, which can't be reused
+	// until the GPU is past the frame's fence value
+	void BeginFrame(unsigned long long frameFence, unsigned int slot, void* commandList);
+
+	// Closes any scopes left open, ends the frame and resolves its
+	// timestamps at the end of the given (last) command list
+	void EndFrame(void* commandList);
+
+	// Picks up the times of every frame up to the completed fence value
+	void Collect(unsigned long long completedFence);
+
+	void BeginCpuScope(const char* name);
+	void EndCpuScope();
+	void BeginGpuScope(const char* name, void* commandList);
+	void EndGpuScope(void* commandList);
+
+	// Finished frames, oldest first
+	std::vector<ProfileFrame> GetHistory();
+	size_t GetDroppedScopes();
+
+	// Writes frames as Chrome trace_event JSON, with CPU and GPU scopes
+	// on separate tracks and times in microseconds from the first frame
+	static void WriteChromeTrace(std::ostream& out, const std::vector<ProfileFrame>& frames);
+	bool ExportChromeTrace(const std::filesystem::path& file);
+
+	// Average times of the latest frame's scopes over the history
+	void PrintStats();
+
+private:
+
+	GpuProfilerDevice* device;
+	bool inFrame;
+	unsigned int slot;
+	ProfileFrame current;
+	std::vector<int> cpuStack;
+	std::vector<int> gpuStack;	// -1 for scopes past MaxGpuScopes
+	size_t droppedScopes;
+
+	// The frame most recently ended in each slot, waiting on its GPU times
+	ProfileFrame slotFrames[MaxSlots];
+	bool slotPending[MaxSlots];
+
+	std::vector<ProfileFrame> history;	// A ring, oldest at historyStart once full
+	size_t historyStart;
+};
@@ -0,0 +1,91 @@
+#include "GpuProfilerDeviceD3D12.h"
+
+GpuProfilerDeviceD3D12::GpuProfilerDeviceD3D12(ID3D12Device* device, ID3D12CommandQueue* queue)
+{
+	this->queue = queue;
+	timestamps = 0;
+
+	LARGE_INTEGER frequency{};
+	QueryPerformanceFrequency(&frequency);
+	cpuFrequency = (double)frequency.QuadPart;
+	gpuFrequency = 0;
+	queue->GetTimestampFrequency(&gpuFrequency);
+
+	const unsigned int queryCount = QueriesPerSlot * GpuProfiler::MaxSlots;
+	D3D12_QUERY_HEAP_DESC heapDesc = {};
+	heapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+	heapDesc.Count = queryCount;
+	device->CreateQueryHeap(&heapDesc, IID_PPV_ARGS(timestampHeap.GetAddressOf()));
+
+	D3D12_HEAP_PROPERTIES heapProps = {};
+	heapProps.Type = D3D12_HEAP_TYPE_READBACK;
+	heapProps.CreationNodeMask = 1;
+	heapProps.VisibleNodeMask = 1;
+
+	D3D12_RESOURCE_DESC resDesc = {};
+	resDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	resDesc.Width = queryCount * sizeof(UINT64);
+	resDesc.Height = 1;
+	resDesc.DepthOrArraySize = 1;
+	resDesc.MipLevels = 1;
+	resDesc.Format = DXGI_FORMAT_UNKNOWN;
+	resDesc.SampleDesc.Count = 1;
+	resDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+
+	device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &resDesc,
+		D3D12_RESOURCE_STATE_COPY_DEST, 0, IID_PPV_ARGS(timestampReadback.GetAddressOf()));
+
+	// Readback memory can stay mapped; each slot is only read once its frame is done
+	if (timestampReadback)
+		timestampReadback->Map(0, 0, (void**)&timestamps);
+}
+
+GpuProfilerDeviceD3D12::~GpuProfilerDeviceD3D12()
+{
+	if (timestamps)
+		timestampReadback->Unmap(0, 0);
+}
+
+double GpuProfilerDeviceD3D12::GetTime()
+{
+	LARGE_INTEGER now{};
+	QueryPerformanceCounter(&now);
+	return now.QuadPart / cpuFrequency;
+}
+
+void GpuProfilerDeviceD3D12::WriteTimestamp(void* commandList, unsigned int slot, unsigned int index)
+{
+	if (!timestampHeap)
+		return;
+
+	((ID3D12GraphicsCommandList*)commandList)->EndQuery(
+		timestampHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, slot * QueriesPerSlot + index);
+}
+
+void GpuProfilerDeviceD3D12::ResolveTimestamps(void* commandList, unsigned int slot, unsigned int count)
+{
+	if (!timestampHeap || !timestampReadback || count == 0)
+		return;
+
+	((ID3D12GraphicsCommandList*)commandList)->ResolveQueryData(
+		timestampHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, slot * QueriesPerSlot, count,
+		timestampReadback.Get(), slot * QueriesPerSlot * sizeof(UINT64));
+}
+
+bool GpuProfilerDeviceD3D12::ReadTimestamps(unsigned int slot, unsigned int count, double* times)
+{
+	if (!timestamps || gpuFrequency == 0)
+		return false;
+
+	// A fresh calibration each time, so the clocks can't drift apart
+	UINT64 gpuNow = 0;
+	UINT64 cpuNow = 0;
+	if (FAILED(queue->GetClockCalibration(&gpuNow, &cpuNow)))
+		return false;
+
+	double cpuSeconds = cpuNow / cpuFrequency;
+	const UINT64* slotTimestamps = timestamps + slot * QueriesPerSlot;
+	for (unsigned int i = 0; i < count; i++)
+		times[i] = cpuSeconds + (double)(long long)(slotTimestamps[i] - gpuNow) / gpuFrequency;
+	return true;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <Windows.h>
+#include <d3d12.h>
+#include <wrl/client.h>
+#include "GpuProfiler.h"
+
+// --------------------------------------------------------
+// GpuProfiler's device for a D3D12 direct queue
+//
+// Each slot has MaxGpuScopes pairs of timestamp queries in
+// one heap, resolved into its own part of a readback
+// buffer that stays mapped. Times are moved onto the CPU's
+// clock (QueryPerformanceCounter) with the queue's clock
+// calibration. Command lists are ID3D12GraphicsCommandList.
+// --------------------------------------------------------
+class GpuProfilerDeviceD3D12 : public GpuProfilerDevice
+{
+public:
+
+	GpuProfilerDeviceD3D12(ID3D12Device* device, ID3D12CommandQueue* queue);
+	~GpuProfilerDeviceD3D12();
+	GpuProfilerDeviceD3D12(const GpuProfilerDeviceD3D12&) = delete;
+	GpuProfilerDeviceD3D12& operator=(const GpuProfilerDeviceD3D12&) = delete;
+
+	double GetTime() override;
+	void WriteTimestamp(void* commandList, unsigned int slot, unsigned int index) override;
+	void ResolveTimestamps(void* commandList, unsigned int slot, unsigned int count) override;
+	bool ReadTimestamps(unsigned int slot, unsigned int count, double* times) override;
+
+private:
+
+	static const unsigned int QueriesPerSlot = 2 * GpuProfiler::MaxGpuScopes;
+
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue> queue;
+	Microsoft::WRL::ComPtr<ID3D12QueryHeap> timestampHeap;
+	Microsoft::WRL::ComPtr<ID3D12Resource> timestampReadback;
+	UINT64* timestamps;
+	UINT64 gpuFrequency;
+	double cpuFrequency;
+};
@@ -1,9 +1,35 @@
 #include "Graphics.h"
 #include <dxgi1_6.h>
+#include <wincodec.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cwctype>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
+#include "CpuZones.h"
+#include "FrameAllocator.h"
+#include "FramePacingDeviceD3D12.h"
+#include "GpuProfilerDeviceD3D12.h"
+#include "Parallel.h"
+#include "PathHelpers.h"
+#include "PipelineCache.h"
+#include "PipelineDeviceD3D12.h"
+#include "TextureCooker.h"
+#include "TextureStreamer.h"
+#include "UploadBatch.h"
+#include "UploadDeviceD3D12.h"
+
 // for texture loading
 #include "WICTextureLoader.h"
+#include "DDSTextureLoader.h"
 #include "ResourceUploadBatch.h"
 
 // Tell the drivers to use high-performance GPU in multi-GPU systems (like laptops)
@@ -25,27 +51,657 @@ namespace Graphics
 		BOOL isFullscreen = false;
 
 		D3D_FEATURE_LEVEL featureLevel{};
+		D3D12_RESOURCE_BINDING_TIER resourceBindingTier = D3D12_RESOURCE_BINDING_TIER_1;
 		unsigned int currentBackBufferIndex = 0;
 
+		// Frame pacing (see FramePacer.h). The swap chain is made with a
+		// frame latency waitable object, which needs IDXGISwapChain3 to
+		// find out which back buffer comes next.
+		Microsoft::WRL::ComPtr<IDXGISwapChain3> swapChain3;
+		std::unique_ptr<FramePacingDeviceD3D12> framePacingDevice;
+		std::unique_ptr<FramePacer> framePacer;
+
+		// Frame times, each added once the frame after it has finished
+		// too (a frame's time runs until the next one starts)
+		FrameStats frameStats;
+		FrameTiming lastFinishedFrame;
+		unsigned int framesInFlight = DefaultFramesInFlight;
+		unsigned int maxFrameLatency = DefaultMaxFrameLatency;
+
+		// Scope timing, with a slot for every frame that can be in flight
+		static_assert(GpuProfiler::MaxSlots >= FramePacer::MaxFramesInFlight);
+		std::unique_ptr<GpuProfilerDeviceD3D12> profilerDevice;
+		std::unique_ptr<GpuProfiler> profiler;
+		bool printProfileStats = false;
+
 		// Descriptor heap management
 		SIZE_T cbvSrvDescriptorHeapIncrementSize = 0;
-		unsigned int cbvDescriptorOffset = 0;
 
-		// CB upload heap management
-		UINT64 cbUploadHeapSizeInBytes = 0;
-		UINT64 cbUploadHeapOffsetInBytes = 0;
-		void* cbUploadHeapStartAddress = 0;
+		// Per-frame upload memory (constant buffers, culled indices),
+		// in pages that are created as needed and only reused once the
+		// GPU has finished the frame that filled them
+		FrameAllocator frameUploadAllocator;
+		std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> frameUploadPages;
+		std::vector<void*> frameUploadPageAddresses;
+
+		// Taken by anything using the shared upload pages or CBV slots,
+		// which threads recording draws do when they need another block
+		std::mutex frameUploadMutex;
+
+		// CBVs are handed out the same way, from the first
+		// maxConstantBuffers slots of the CBV/SRV heap
+		const unsigned int cbvDescriptorPageSize = 64;
+		FrameAllocator cbvDescriptorAllocator;
+		std::atomic<size_t> cbvDescriptorStalls = 0;
+		std::atomic<size_t> cbvDescriptorFailures = 0;
+		bool cbvOverflowReported = false;
+
+		// Constant buffers bound through a CBV (a descriptor write each)
+		// and as root CBVs (no descriptor at all), this frame and last
+		std::atomic<unsigned int> cbvDescriptorWrites = 0;
+		std::atomic<unsigned int> rootConstantBuffers = 0;
+		unsigned int lastFrameCbvDescriptorWrites = 0;
+		unsigned int lastFrameRootConstantBuffers = 0;
+
+		// Batched uploads on the copy queue, and the last of
+		// its fence values the direct queue has been told to wait for
+		std::unique_ptr<UploadDeviceD3D12> uploadDevice;
+		std::unique_ptr<UploadBatch> uploads;
+		UINT64 uploadFenceWaitedOn = 0;
+
+		// Heaps that static buffers and textures are placed in, and
+		// allocations waiting for the GPU to finish with them. Their
+		// frame fence value is 0 until the frame that freed them ends.
+		struct DeferredFree
+		{
+			GpuAllocation allocation;
+			UINT64 fenceValue;
+		};
+		std::unique_ptr<GpuMemory> gpuMemory;
+		std::vector<DeferredFree> deferredFrees;
+
+		// Root signatures, shared by the hash of their serialized form,
+		// and pipeline states, kept in a library on disk between runs
+		std::unique_ptr<PipelineDeviceD3D12> pipelineDevice;
+		std::unique_ptr<PipelineCache> pipelineCache;
+		std::unordered_map<unsigned long long, Microsoft::WRL::ComPtr<ID3D12RootSignature>> rootSignatures;
+		std::unordered_map<ID3D12RootSignature*, unsigned long long> rootSignatureHashes;
+		const wchar_t* pipelineCacheFile = L"PipelineCache.bin";
 
 		unsigned int srvDescriptorOffset = maxConstantBuffers; // Assume first SRV is after all CBVs
 
-		// Texture resources we need to keep alive
-		std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> textures;
-		std::vector<Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>> cpuSideTextureDescriptorHeaps;
+		// Bindless texture slots (relative to the first SRV) that are free
+		// again, and removed ones waiting for the GPU like deferredFrees
+		struct DeferredDescriptorFree
+		{
+			unsigned int index;
+			UINT64 fenceValue;
+		};
+		std::vector<unsigned int> freeBindlessTextures;
+		std::vector<DeferredDescriptorFree> deferredBindlessFrees;
+
+		// A texture between decoding (on a worker thread) and upload
+		struct DecodedTexture
+		{
+			std::wstring path;
+			unsigned int references = 0;	// Requests for it in this load
+			Microsoft::WRL::ComPtr<ID3D12Resource> loaded;
+			std::unique_ptr<uint8_t[]> decodedData;
+			std::vector<std::vector<unsigned char>> mips;
+			std::vector<UploadSubresource> subresources;
+			bool gpuMips = false;
+			unsigned int bitsPerPixel = 0;
+			bool cooked = false;			// Loaded from a .dds made by TextureCooker
+			double seconds = 0;
+
+			// Streamed textures only decode their startup mips, so
+			// this is the size of the full image
+			bool streamed = false;
+			unsigned int width = 0;
+			unsigned int height = 0;
+		};
+
+		// Loaded textures, indexed by their slot in the CPU-side SRV heap,
+		// and which slot each (canonical) path was loaded into. Freed slots
+		// are reused first.
+		struct LoadedTexture
+		{
+			GpuAllocation texture;
+			std::wstring path;
+			unsigned int references;
+
+			// Streaming state, and every place in the shader visible heap
+			// the SRV was copied to (which change along with the texture)
+			unsigned int streamId;
+			unsigned int width;
+			unsigned int height;
+			unsigned int residentMip;
+			std::vector<unsigned int> copies;
+		};
+		std::vector<LoadedTexture> textures;
+		std::unordered_map<std::wstring, unsigned int> textureSlotsByPath;
+		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> textureSRVHeap;
+		std::vector<unsigned int> freeTextureSRVs;
+
+		// The texture region of the shader visible heap (everything after
+		// the CBVs) has a copy for each frame in flight. Materials and
+		// streaming write to a CPU-side master instead, and a frame's copy
+		// catches up with it as that frame begins, once the GPU is done with
+		// the slot's last frame, so nothing in use is ever overwritten.
+		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> textureRegionHeap;
+		unsigned long long textureRegionVersion = 0;
+		unsigned long long frameTextureRegionVersions[FramePacer::MaxFramesInFlight] = {};
+
+		// Running totals for every texture load so far
+		struct TextureLoadStats
+		{
+			size_t requested = 0;
+			size_t loaded = 0;
+			size_t shared = 0;			// Requests that reused an already loaded file
+			size_t cooked = 0;			// Files loaded from a cooked .dds
+			size_t failed = 0;			// Files with no SRV slot left for them
+			unsigned int threads = 0;	// Most decode threads used at once
+			double pathSeconds = 0;
+			double decodeSeconds = 0;	// Wall clock
+			double decodeCpuSeconds = 0;	// Summed over every thread
+			double uploadSeconds = 0;
+			double srvSeconds = 0;
+		};
+		TextureLoadStats textureStats;
+
+		// Mip streaming: the policy deciding what should be resident, and a
+		// thread decoding each change it makes. The job queues are shared
+		// with that thread (under streamMutex); everything else is ours.
+		struct StreamJob
+		{
+			unsigned int slot;
+			unsigned int streamId;
+			unsigned int firstMip;
+			unsigned int maxSize;
+			DecodedTexture decoded;
+		};
+		const unsigned int NoIndex = 0xFFFFFFFF;	// No stream id, or no texture slot
+		TextureStreamer textureStreamer;
+		std::vector<unsigned int> streamSlots;	// Texture slot of each stream id
+		std::thread streamThread;
+		std::mutex streamMutex;
+		std::condition_variable streamSignal;
+		std::deque<std::unique_ptr<StreamJob>> streamJobs;
+		std::deque<std::unique_ptr<StreamJob>> streamResults;
+		bool streamThreadQuit = false;
+		unsigned int streamJobsInFlight = 0;
+		size_t streamSwaps = 0;
+	}
+
+	// Annonymous namespace to hold helpers
+	// only accessible in this file
+	namespace
+	{
+		// Bytes per pixel of formats whose mips we can filter on the
+		// CPU (8 bits per channel), or 0 for anything else
+		unsigned int CpuMipBytesPerPixel(DXGI_FORMAT format)
+		{
+			switch (format)
+			{
+			case DXGI_FORMAT_R8_UNORM:
+			case DXGI_FORMAT_A8_UNORM:
+				return 1;
+			case DXGI_FORMAT_R8G8_UNORM:
+				return 2;
+			case DXGI_FORMAT_R8G8B8A8_UNORM:
+			case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+			case DXGI_FORMAT_B8G8R8A8_UNORM:
+			case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+			case DXGI_FORMAT_B8G8R8X8_UNORM:
+			case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+				return 4;
+			default:
+				return 0;
+			}
+		}
+
+		// Size of a pixel in any format a texture can load as, in bits
+		unsigned int FormatBitsPerPixel(DXGI_FORMAT format)
+		{
+			switch (format)
+			{
+			case DXGI_FORMAT_BC1_UNORM:
+			case DXGI_FORMAT_BC1_UNORM_SRGB:
+			case DXGI_FORMAT_BC4_UNORM:
+			case DXGI_FORMAT_BC4_SNORM:
+				return 4;
+			case DXGI_FORMAT_BC2_UNORM:
+			case DXGI_FORMAT_BC2_UNORM_SRGB:
+			case DXGI_FORMAT_BC3_UNORM:
+			case DXGI_FORMAT_BC3_UNORM_SRGB:
+			case DXGI_FORMAT_BC5_UNORM:
+			case DXGI_FORMAT_BC5_SNORM:
+			case DXGI_FORMAT_BC6H_UF16:
+			case DXGI_FORMAT_BC6H_SF16:
+			case DXGI_FORMAT_BC7_UNORM:
+			case DXGI_FORMAT_BC7_UNORM_SRGB:
+				return 8;
+			default:
+				return CpuMipBytesPerPixel(format) * 8;
+			}
+		}
+
+		// Averages each 2x2 block of the source into one destination
+		// pixel, repeating the last row or column of odd-sized sources
+		void DownsampleBox(
+			const unsigned char* source, size_t sourcePitch, unsigned int sourceWidth, unsigned int sourceHeight,
+			unsigned char* destination, unsigned int width, unsigned int height, unsigned int bytesPerPixel)
+		{
+			for (unsigned int y = 0; y < height; y++)
+			{
+				const unsigned char* row0 = source + (size_t)(2 * y < sourceHeight ? 2 * y : sourceHeight - 1) * sourcePitch;
+				const unsigned char* row1 = source + (size_t)(2 * y + 1 < sourceHeight ? 2 * y + 1 : sourceHeight - 1) * sourcePitch;
+				unsigned char* out = destination + (size_t)y * width * bytesPerPixel;
+
+				for (unsigned int x = 0; x < width; x++)
+				{
+					size_t x0 = (size_t)(2 * x < sourceWidth ? 2 * x : sourceWidth - 1) * bytesPerPixel;
+					size_t x1 = (size_t)(2 * x + 1 < sourceWidth ? 2 * x + 1 : sourceWidth - 1) * bytesPerPixel;
+
+					for (unsigned int c = 0; c < bytesPerPixel; c++)
+					{
+						unsigned int sum = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+						out[(size_t)x * bytesPerPixel + c] = (unsigned char)((sum + 2) / 4);
+					}
+				}
+			}
+		}
+
+		UINT SwapChainFlags()
+		{
+			return DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT |
+				(supportsTearing ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0);
+		}
+
+		// Finds room for per-frame upload data, creating another page
+		// of upload memory the first time the allocator asks for it
+		bool AllocateFrameUpload(UINT64 size, UINT64 alignment, D3D12_GPU_VIRTUAL_ADDRESS& gpuAddress, void*& cpuAddress)
+		{
+			FrameAllocation allocation;
+			if (!frameUploadAllocator.Allocate(size, alignment, allocation))
+				return false;
+
+			while (allocation.page >= frameUploadPages.size())
+			{
+				D3D12_HEAP_PROPERTIES heapProps = {};
+				heapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+				heapProps.CreationNodeMask = 1;
+				heapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+				heapProps.Type = D3D12_HEAP_TYPE_UPLOAD;
+				heapProps.VisibleNodeMask = 1;
+
+				D3D12_RESOURCE_DESC resDesc = {};
+				resDesc.Alignment = 0;
+				resDesc.DepthOrArraySize = 1;
+				resDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+				resDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+				resDesc.Format = DXGI_FORMAT_UNKNOWN;
+				resDesc.Height = 1;
+				resDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+				resDesc.MipLevels = 1;
+				resDesc.SampleDesc.Count = 1;
+				resDesc.SampleDesc.Quality = 0;
+				resDesc.Width = frameUploadAllocator.GetPageSize();
+
+				Microsoft::WRL::ComPtr<ID3D12Resource> page;
+				Device->CreateCommittedResource(
+					&heapProps,
+					D3D12_HEAP_FLAG_NONE,
+					&resDesc,
+					D3D12_RESOURCE_STATE_GENERIC_READ,
+					0,
+					IID_PPV_ARGS(page.GetAddressOf()));
+
+				// Keep mapped!
+				void* address = 0;
+				D3D12_RANGE range{ 0, 0 };
+				page->Map(0, &range, &address);
+
+				frameUploadPages.push_back(page);
+				frameUploadPageAddresses.push_back(address);
+			}
+
+			gpuAddress = frameUploadPages[allocation.page]->GetGPUVirtualAddress() + allocation.offset;
+			cpuAddress = (unsigned char*)frameUploadPageAddresses[allocation.page] + allocation.offset;
+			return true;
+		}
+
+		// Finds room for per-frame upload data in a thread's own range if
+		// one is given, only locking to take another block when it's full.
+		// Blocks start CBV aligned, so smaller alignments hold within them.
+		bool AllocateFrameUpload(FrameUploadRange* range, UINT64 size, UINT64 alignment, D3D12_GPU_VIRTUAL_ADDRESS& gpuAddress, void*& cpuAddress)
+		{
+			if (!range)
+			{
+				std::lock_guard<std::mutex> lock(frameUploadMutex);
+				return AllocateFrameUpload(size, alignment, gpuAddress, cpuAddress);
+			}
+
+			UINT64 offset = (range->used + alignment - 1) & ~(alignment - 1);
+			if (!range->cpuAddress || offset + size > range->size)
+			{
+				std::lock_guard<std::mutex> lock(frameUploadMutex);
+
+				// Anything too big to share a block gets room of its own
+				if (size > frameUploadBlockSize / 4)
+					return AllocateFrameUpload(size, alignment, gpuAddress, cpuAddress);
+
+				void* blockAddress = 0;
+				if (!AllocateFrameUpload(frameUploadBlockSize, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, range->gpuAddress, blockAddress))
+					return false;
+
+				range->cpuAddress = (unsigned char*)blockAddress;
+				range->size = frameUploadBlockSize;
+				offset = 0;
+			}
+
+			gpuAddress = range->gpuAddress + offset;
+			cpuAddress = range->cpuAddress + offset;
+			range->used = offset + size;
+			return true;
+		}
+
+		// Finds a CBV slot for this frame. If every slot is taken, waits for
+		// the oldest frame using some to finish, without holding the upload
+		// lock so other recording threads carry on. If this frame alone is
+		// using them all, nothing can free up until it's submitted, and every
+		// slot may already be referenced by a recorded draw, so it fails
+		// (and says so, since that means maxConstantBuffers is too small)
+		// rather than hand out a slot that's in use.
+		bool AllocateCbvDescriptor(unsigned int& index)
+		{
+			FrameAllocation allocation;
+			UINT64 oldestFrame = 0;
+			{
+				std::lock_guard<std::mutex> lock(frameUploadMutex);
+				if (cbvDescriptorAllocator.Allocate(1, 1, allocation))
+				{
+					index = allocation.page * cbvDescriptorPageSize + (unsigned int)allocation.offset;
+					return true;
+				}
+				oldestFrame = cbvDescriptorAllocator.GetOldestFence();
+			}
+
+			// A null event makes this block until the fence gets there,
+			// which is safe to do from any number of threads at once
+			if (oldestFrame != 0 && FrameSyncFence->GetCompletedValue() < oldestFrame)
+			{
+				FrameSyncFence->SetEventOnCompletion(oldestFrame, 0);
+				cbvDescriptorStalls++;
+			}
+
+			std::lock_guard<std::mutex> lock(frameUploadMutex);
+			cbvDescriptorAllocator.Retire(FrameSyncFence->GetCompletedValue());
+			if (cbvDescriptorAllocator.Allocate(1, 1, allocation))
+			{
+				index = allocation.page * cbvDescriptorPageSize + (unsigned int)allocation.offset;
+				return true;
+			}
+
+			cbvDescriptorFailures++;
+			if (!cbvOverflowReported)
+			{
+				printf("Error: one frame needs more than %u constant buffers, so draws are being skipped; raise Graphics::maxConstantBuffers\n",
+					maxConstantBuffers);
+				cbvOverflowReported = true;
+			}
+			return false;
+		}
+
+		// Paths are compared case-insensitively (as Windows does) after
+		// resolving ".." and friends, so one file is never loaded twice
+		std::wstring CanonicalTexturePath(const wchar_t* file)
+		{
+			std::error_code error;
+			std::filesystem::path canonical = std::filesystem::weakly_canonical(file, error);
+			std::wstring path = error ? std::wstring(file) : canonical.wstring();
+			for (wchar_t& c : path)
+				c = (wchar_t)std::towlower(c);
+			return path;
+		}
+
+		// Decodes the file into a (not yet placed) texture and, for 8-bit
+		// formats, box filters its mips. Only touches the device to create
+		// the resource, which is safe from any thread.
+		// A maxSize other than 0 scales the image down to fit while decoding.
+		// An up to date cooked .dds beside the file is loaded instead, mips
+		// and all (skipping any bigger than maxSize).
+		void DecodeTexture(DecodedTexture& decoded, bool generateMips, unsigned int maxSize = 0)
+		{
+			auto startTime = std::chrono::high_resolution_clock::now();
+
+			if (TextureCooker::IsCookedCurrent(decoded.path))
+			{
+				std::vector<D3D12_SUBRESOURCE_DATA> subresources;
+				DirectX::LoadDDSTextureFromFileEx(
+					Device.Get(),
+					TextureCooker::CookedPath(decoded.path).c_str(),
+					maxSize,
+					D3D12_RESOURCE_FLAG_NONE,
+					DirectX::DDS_LOADER_DEFAULT,
+					decoded.loaded.GetAddressOf(),
+					decoded.decodedData,
+					subresources);
+
+				if (decoded.loaded)
+				{
+					decoded.cooked = true;
+					decoded.bitsPerPixel = FormatBitsPerPixel(decoded.loaded->GetDesc().Format);
+					decoded.subresources.resize(subresources.size());
+					for (size_t i = 0; i < subresources.size(); i++)
+					{
+						decoded.subresources[i].data = subresources[i].pData;
+						decoded.subresources[i].rowPitch = subresources[i].RowPitch;
+						decoded.subresources[i].slicePitch = subresources[i].SlicePitch;
+					}
+
+					std::chrono::duration<double> seconds = std::chrono::high_resolution_clock::now() - startTime;
+					decoded.seconds = seconds.count();
+					return;
+				}
+			}
+
+			D3D12_SUBRESOURCE_DATA topMip = {};
+			DirectX::LoadWICTextureFromFileEx(
+				Device.Get(),
+				decoded.path.c_str(),
+				maxSize,
+				D3D12_RESOURCE_FLAG_NONE,
+				generateMips ? DirectX::WIC_LOADER_MIP_RESERVE : DirectX::WIC_LOADER_DEFAULT,
+				decoded.loaded.GetAddressOf(),
+				decoded.decodedData,
+				topMip);
+
+			if (decoded.loaded)
+			{
+				D3D12_RESOURCE_DESC desc = decoded.loaded->GetDesc();
+				unsigned int bytesPerPixel = CpuMipBytesPerPixel(desc.Format);
+				decoded.bitsPerPixel = bytesPerPixel * 8;
+				if (desc.MipLevels > 1 && bytesPerPixel == 0)
+				{
+					decoded.gpuMips = true;
+					decoded.loaded.Reset();
+				}
+				else
+				{
+					// The full size image, then each mip filtered down from the one before it
+					decoded.mips.resize(desc.MipLevels - 1);
+					decoded.subresources.resize(desc.MipLevels);
+					decoded.subresources[0].data = topMip.pData;
+					decoded.subresources[0].rowPitch = topMip.RowPitch;
+					decoded.subresources[0].slicePitch = topMip.SlicePitch;
+
+					unsigned int width = (unsigned int)desc.Width;
+					unsigned int height = desc.Height;
+					for (unsigned int m = 1; m < desc.MipLevels; m++)
+					{
+						unsigned int mipWidth = width > 1 ? width / 2 : 1;
+						unsigned int mipHeight = height > 1 ? height / 2 : 1;
+						std::vector<unsigned char>& mip = decoded.mips[m - 1];
+						mip.resize((size_t)mipWidth * mipHeight * bytesPerPixel);
+
+						DownsampleBox(
+							(const unsigned char*)decoded.subresources[m - 1].data, (size_t)decoded.subresources[m - 1].rowPitch, width, height,
+							mip.data(), mipWidth, mipHeight, bytesPerPixel);
+
+						decoded.subresources[m].data = mip.data();
+						decoded.subresources[m].rowPitch = (long long)mipWidth * bytesPerPixel;
+						decoded.subresources[m].slicePitch = (long long)mip.size();
+
+						width = mipWidth;
+						height = mipHeight;
+					}
+				}
+			}
+
+			std::chrono::duration<double> seconds = std::chrono::high_resolution_clock::now() - startTime;
+			decoded.seconds = seconds.count();
+		}
+
+		// Full size of an image, read from its header without decoding it
+		bool ReadImageSize(const wchar_t* file, unsigned int& width, unsigned int& height)
+		{
+			Microsoft::WRL::ComPtr<IWICImagingFactory> factory;
+			Microsoft::WRL::ComPtr<IWICBitmapDecoder> decoder;
+			Microsoft::WRL::ComPtr<IWICBitmapFrameDecode> frame;
+			if (FAILED(CoCreateInstance(CLSID_WICImagingFactory, 0, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(factory.GetAddressOf()))) ||
+				FAILED(factory->CreateDecoderFromFilename(file, 0, GENERIC_READ, WICDecodeMetadataCacheOnDemand, decoder.GetAddressOf())) ||
+				FAILED(decoder->GetFrame(0, frame.GetAddressOf())))
+				return false;
+
+			UINT frameWidth = 0;
+			UINT frameHeight = 0;
+			if (FAILED(frame->GetSize(&frameWidth, &frameHeight)))
+				return false;
+
+			width = frameWidth;
+			height = frameHeight;
+			return true;
+		}
+
+		// Slot of a texture in the CPU-side SRV heap, or NoIndex
+		// if the descriptor isn't one of ours
+		unsigned int TextureSlot(D3D12_CPU_DESCRIPTOR_HANDLE srv)
+		{
+			D3D12_CPU_DESCRIPTOR_HANDLE heapStart = textureSRVHeap->GetCPUDescriptorHandleForHeapStart();
+			if (srv.ptr < heapStart.ptr)
+				return NoIndex;
+
+			SIZE_T slot = (srv.ptr - heapStart.ptr) / cbvSrvDescriptorHeapIncrementSize;
+			return slot < textures.size() ? (unsigned int)slot : NoIndex;
+		}
+
+		// Remembers (or forgets) where a texture's SRV was copied in the shader
+		// visible heap, so streaming can update the copy when the texture changes
+		void TrackTextureCopy(D3D12_CPU_DESCRIPTOR_HANDLE source, unsigned int destination)
+		{
+			unsigned int slot = TextureSlot(source);
+			if (slot != NoIndex)
+				textures[slot].copies.push_back(destination);
+		}
+
+		void UntrackTextureCopy(unsigned int destination)
+		{
+			for (LoadedTexture& texture : textures)
+			{
+				for (size_t i = 0; i < texture.copies.size(); i++)
+				{
+					if (texture.copies[i] == destination)
+					{
+						texture.copies[i] = texture.copies.back();
+						texture.copies.pop_back();
+						return;
+					}
+				}
+			}
+		}
+
+		// Where a slot of the texture region (by its index in the whole
+		// heap, as handed out) is written in the master copy
+		D3D12_CPU_DESCRIPTOR_HANDLE TextureRegionSlot(unsigned int heapIndex)
+		{
+			D3D12_CPU_DESCRIPTOR_HANDLE handle = textureRegionHeap->GetCPUDescriptorHandleForHeapStart();
+			handle.ptr += (SIZE_T)(heapIndex - maxConstantBuffers) * cbvSrvDescriptorHeapIncrementSize;
+			return handle;
+		}
+
+		// Brings the current frame's copy of the texture region up to
+		// date with the master, if anything has changed since
+		void SyncFrameTextureRegion()
+		{
+			unsigned int slot = framePacer->GetFrameSlot();
+			if (frameTextureRegionVersions[slot] == textureRegionVersion)
+				return;
+
+			unsigned int used = srvDescriptorOffset - maxConstantBuffers;
+			if (used > 0)
+			{
+				D3D12_CPU_DESCRIPTOR_HANDLE destination = cbvSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
+				destination.ptr += (SIZE_T)(maxConstantBuffers + slot * MaxTextureDescriptors) * cbvSrvDescriptorHeapIncrementSize;
+				Device->CopyDescriptorsSimple(used, destination,
+					textureRegionHeap->GetCPUDescriptorHandleForHeapStart(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+			}
+			frameTextureRegionVersions[slot] = textureRegionVersion;
+		}
+
+		// Decodes streaming changes one at a time, until told to quit
+		void StreamThreadMain()
+		{
+			HRESULT com = CoInitializeEx(0, COINIT_MULTITHREADED);
+			CpuZones::SetThreadName("Texture streaming");
+			while (true)
+			{
+				std::unique_ptr<StreamJob> job;
+				{
+					std::unique_lock<std::mutex> lock(streamMutex);
+					streamSignal.wait(lock, [] { return streamThreadQuit || !streamJobs.empty(); });
+					if (streamThreadQuit)
+						break;
+
+					job = std::move(streamJobs.front());
+					streamJobs.pop_front();
+				}
+
+				{
+					CPU_ZONE("Decode streamed mips");
+					DecodeTexture(job->decoded, true, job->maxSize);
+				}
+
+				std::lock_guard<std::mutex> lock(streamMutex);
+				streamResults.push_back(std::move(job));
+			}
+
+			if (SUCCEEDED(com))
+				CoUninitialize();
+		}
+
+		// The original path for textures whose mips the CPU can't make:
+		// DXTK generates them on the direct queue and we wait for it
+		Microsoft::WRL::ComPtr<ID3D12Resource> LoadTextureWithGPUMips(const wchar_t* file)
+		{
+			DirectX::ResourceUploadBatch upload(Device.Get());
+			upload.Begin();
+
+			Microsoft::WRL::ComPtr<ID3D12Resource> texture;
+			DirectX::CreateWICTextureFromFile(Device.Get(), upload, file, texture.GetAddressOf(), true);
+
+			auto finish = upload.End(CommandQueue.Get());
+			finish.wait();
+			return texture;
+		}
 	}
 }
 
 // Getters
 unsigned int Graphics::SwapChainIndex() { return currentBackBufferIndex; }
+unsigned int Graphics::FrameSlot() { return framePacer->GetFrameSlot(); }
+UINT64 Graphics::FrameFence() { return framePacer->GetFrameFence(); }
+bool Graphics::SupportsBindless() { return resourceBindingTier >= D3D12_RESOURCE_BINDING_TIER_2; }
 bool Graphics::VsyncState() { return vsyncDesired || !supportsTearing || isFullscreen; }
 std::wstring Graphics::APIName() 
 { 
@@ -137,6 +793,12 @@ HRESULT Graphics::Initialize(unsigned int windowWidth, unsigned int windowHeight
 			sizeof(D3D12_FEATURE_DATA_FEATURE_LEVELS));
 
 		featureLevel = levels.MaxSupportedFeatureLevel;
+
+		// Tier 1 hardware can't have unbounded descriptor ranges
+		// in a root signature, which bindless textures rely on
+		D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+		if (SUCCEEDED(Device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options))))
+			resourceBindingTier = options.ResourceBindingTier;
 	}
 
 #if defined(DEBUG) || defined(_DEBUG)
@@ -149,13 +811,13 @@ HRESULT Graphics::Initialize(unsigned int windowWidth, unsigned int windowHeight
 	// Set up D3D12 command allocator / queue / list,
 	// which are necessary pieces for issuing standard API calls
 	{
-		// Set up allocators
-		Device->CreateCommandAllocator(
-			D3D12_COMMAND_LIST_TYPE_DIRECT,
-			IID_PPV_ARGS(CommandAllocators[0].GetAddressOf()));
-		Device->CreateCommandAllocator(
-			D3D12_COMMAND_LIST_TYPE_DIRECT,
-			IID_PPV_ARGS(CommandAllocators[1].GetAddressOf()));
+		// Set up allocators, one per frame that can be in flight
+		for (unsigned int i = 0; i < FramePacer::MaxFramesInFlight; i++)
+		{
+			Device->CreateCommandAllocator(
+				D3D12_COMMAND_LIST_TYPE_DIRECT,
+				IID_PPV_ARGS(CommandAllocators[i].GetAddressOf()));
+		}
 
 		// Command queue
 		D3D12_COMMAND_QUEUE_DESC qDesc = {};
@@ -185,7 +847,7 @@ HRESULT Graphics::Initialize(unsigned int windowWidth, unsigned int windowHeight
 		swapDesc.BufferDesc.ScanlineOrdering = DXGI_MODE_SCANLINE_ORDER_UNSPECIFIED;
 		swapDesc.BufferDesc.Scaling = DXGI_MODE_SCALING_UNSPECIFIED;
 		swapDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-		swapDesc.Flags = supportsTearing ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0;
+		swapDesc.Flags = SwapChainFlags();
 		swapDesc.OutputWindow = windowHandle;
 		swapDesc.SampleDesc.Count = 1;
 		swapDesc.SampleDesc.Quality = 0;
@@ -201,6 +863,9 @@ HRESULT Graphics::Initialize(unsigned int windowWidth, unsigned int windowHeight
 
 		if (FAILED(swapResult))
 			return swapResult;
+
+		SwapChain.As(&swapChain3);
+		currentBackBufferIndex = swapChain3->GetCurrentBackBufferIndex();
 	}
 
 	// What is the increment size between RTV descriptors in a descriptor heap?
@@ -296,10 +961,18 @@ HRESULT Graphics::Initialize(unsigned int windowWidth, unsigned int windowHeight
 		WaitFenceEvent = CreateEventEx(0, 0, 0, EVENT_ALL_ACCESS);
 		WaitFenceCounter = 0;
 	}
-	// Create frame sync fence
+	// Create frame sync fence, and the pacer that signals it
 	{
 		Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(FrameSyncFence.GetAddressOf()));
 		FrameSyncFenceEvent = CreateEventEx(0, 0, 0, EVENT_ALL_ACCESS);
+
+		framePacingDevice = std::make_unique<FramePacingDeviceD3D12>(
+			Device.Get(), CommandQueue.Get(), FrameSyncFence.Get(), FrameSyncFenceEvent);
+		framePacingDevice->SetSwapChain(swapChain3.Get(), maxFrameLatency);
+		framePacer = std::make_unique<FramePacer>(framePacingDevice.get(), framesInFlight);
+
+		profilerDevice = std::make_unique<GpuProfilerDeviceD3D12>(Device.Get(), CommandQueue.Get());
+		profiler = std::make_unique<GpuProfiler>(profilerDevice.get());
 	}
 
 	// Create the CBV/SRV descriptor heap
@@ -313,61 +986,49 @@ HRESULT Graphics::Initialize(unsigned int windowWidth, unsigned int windowHeight
 		D3D12_DESCRIPTOR_HEAP_DESC dhDesc = {};
 		dhDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE; // Shaders can see these!
 		dhDesc.NodeMask = 0; // Node here means physical GPU - we only have 1 so its index is 0
-		dhDesc.NumDescriptors = maxConstantBuffers + MaxTextureDescriptors; // How many descriptors will we need?
+		dhDesc.NumDescriptors = maxConstantBuffers + FramePacer::MaxFramesInFlight * MaxTextureDescriptors; // How many descriptors will we need?
 		dhDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV; // This heap can store CBVs, SRVs and UAVs
 
 		Device->CreateDescriptorHeap(&dhDesc, IID_PPV_ARGS(cbvSrvDescriptorHeap.GetAddressOf()));
 
-		// Assume the first CBV will be at the beginning of the heap
-		// This will increase as we use more CBVs and will wrap back to 0
-		cbvDescriptorOffset = 0;
-	}
-
-	// Create an upload heap for constant buffer data
-	{
-		// This heap MUST have a size that is a multiple of 256
-		// We'll support up to the max number of CBs if they're
-		// all 256 bytes or less, or fewer overall CBs if they're larger
-		cbUploadHeapSizeInBytes = (UINT64)maxConstantBuffers * 256;
-
-		// Assume the first CB will start at the beginning of the heap
-		// This offset changes as we use more CBs, and wraps around when full
-		cbUploadHeapOffsetInBytes = 0;
-
-		// Create the upload heap for our constant buffer
-		D3D12_HEAP_PROPERTIES heapProps = {};
-		heapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-		heapProps.CreationNodeMask = 1;
-		heapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-		heapProps.Type = D3D12_HEAP_TYPE_UPLOAD; // Upload heap since we'll be copying often!
-		heapProps.VisibleNodeMask = 1;
-
-		// Fill out description
-		D3D12_RESOURCE_DESC resDesc = {};
-		resDesc.Alignment = 0;
-		resDesc.DepthOrArraySize = 1;
-		resDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-		resDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-		resDesc.Format = DXGI_FORMAT_UNKNOWN;
-		resDesc.Height = 1;
-		resDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-		resDesc.MipLevels = 1;
-		resDesc.SampleDesc.Count = 1;
-		resDesc.SampleDesc.Quality = 0;
-		resDesc.Width = cbUploadHeapSizeInBytes; // Must be 256 byte aligned!
-
-		// Create a constant buffer resource heap
-		Device->CreateCommittedResource(
-			&heapProps,
-			D3D12_HEAP_FLAG_NONE,
-			&resDesc,
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			0,
-			IID_PPV_ARGS(cbUploadHeap.GetAddressOf()));
+		// Loaded textures keep their SRVs in one CPU-side heap, ready
+		// to be copied into the shader visible one by materials
+		dhDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE; // Non-shader visible!
+		dhDesc.NumDescriptors = MaxTextureDescriptors;
+		Device->CreateDescriptorHeap(&dhDesc, IID_PPV_ARGS(textureSRVHeap.GetAddressOf()));
+
+		// And the master copy of the texture region, which each
+		// frame's part of the shader visible heap is copied from
+		Device->CreateDescriptorHeap(&dhDesc, IID_PPV_ARGS(textureRegionHeap.GetAddressOf()));
+	}
 
-		// Keep mapped!
-		D3D12_RANGE range{ 0, 0 };
-		cbUploadHeap->Map(0, &range, &cbUploadHeapStartAddress);
+	// Streamed textures get their finer mips decoded in the background
+	{
+		textureStreamer.Reset(textureStreamingBudget, textureStreamingStartupMips, textureStreamingIdleFrames);
+		streamThread = std::thread(StreamThreadMain);
+	}
+
+	// Per-frame constant buffer and index data goes into pages of
+	// upload memory, which are created the first time they're needed
+	{
+		frameUploadAllocator.Reset(frameUploadPageSize);
+		cbvDescriptorAllocator.Reset(cbvDescriptorPageSize, maxConstantBuffers / cbvDescriptorPageSize);
+	}
+
+	// Set up the heaps that static buffers and textures live in, and the
+	// copy queue and staging ring they're uploaded through
+	{
+		gpuMemory = std::make_unique<GpuMemory>(Device.Get(), gpuMemoryHeapSize);
+		uploadDevice = std::make_unique<UploadDeviceD3D12>(Device.Get());
+		uploads = std::make_unique<UploadBatch>(uploadDevice.get(), uploadStagingSize);
+	}
+
+	// Pipeline states compiled on earlier runs are loaded from
+	// the library file rather than compiled again
+	{
+		pipelineDevice = std::make_unique<PipelineDeviceD3D12>(Device.Get());
+		pipelineCache = std::make_unique<PipelineCache>(pipelineDevice.get());
+		pipelineCache->Load(FixPath(pipelineCacheFile));
 	}
 
 	// Wait for the GPU before we proceed
@@ -378,43 +1039,36 @@ HRESULT Graphics::Initialize(unsigned int windowWidth, unsigned int windowHeight
 }
 
 // --------------------------------------------------------
-// Copies the given data into the next "unused" spot in the CBV upload heap (wrapping at the end, since
-// we treat it like a ring buffer). Then creates a CBV in the next "unused" spot in the CBV heap that
-// points to the aforementioned spot in the upload heap and returns that CBV (a GPU descriptor handle).
+// Copies the given data into this frame's upload pages, then creates a CBV in one of this frame's
+// slots of the CBV heap that points to it and returns that CBV (a GPU descriptor handle).
+//
+// Both are only reused once the GPU has finished this frame (see FrameAllocator.h), so nothing
+// the GPU may still be reading gets overwritten no matter how many are used per frame.
+// If this frame has used every one of the maxConstantBuffers slots, the handle is empty
+// (ptr of 0) and the caller should skip whatever it was going to draw with it.
 //
 // data - The data to copy to the GPU
 // dataSizeInBytes - The byte size of the data to copy
 // --------------------------------------------------------
 D3D12_GPU_DESCRIPTOR_HANDLE Graphics::FillNextConstantBufferAndGetGPUDescriptorHandle(
-	void* data, unsigned int dataSizeInBytes)
+	void* data, unsigned int dataSizeInBytes, FrameUploadRange* range)
 {
 	// How much space will we need? Each CBV must point to a chunk of the upload heap that is
 	// a multiple of 256 bytes, so we need to calculate and reserve that amount.
 	SIZE_T reservationSize = (SIZE_T)dataSizeInBytes;
 	reservationSize = (reservationSize + 255) / 256 * 256; // Integer division trick
 
-	// Ensure this upload will fit in the remaining space. If not, reset to beginning.
-	if (cbUploadHeapOffsetInBytes + reservationSize >= cbUploadHeapSizeInBytes)
-		cbUploadHeapOffsetInBytes = 0;
-
-	// Where in the upload heap will this data go?
-	D3D12_GPU_VIRTUAL_ADDRESS virtualGPUAddress = cbUploadHeap->GetGPUVirtualAddress() + cbUploadHeapOffsetInBytes;
-
 	// === Copy data to the upload heap ===
+	D3D12_GPU_VIRTUAL_ADDRESS virtualGPUAddress = 0;
 	{
-		// Calculate the actual upload address (which we got from mapping the buffer)
-		// Note that this is different than the GPU virtual address needed for the CBV below
-		void* uploadAddress = reinterpret_cast<void*>(
-			(SIZE_T)cbUploadHeapStartAddress + cbUploadHeapOffsetInBytes);
+		// Note that the upload address (which we got from mapping the page)
+		// is different than the GPU virtual address needed for the CBV below
+		void* uploadAddress = 0;
+		if (!AllocateFrameUpload(range, reservationSize, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, virtualGPUAddress, uploadAddress))
+			return D3D12_GPU_DESCRIPTOR_HANDLE{};
 
 		// Perform the mem copy to put new data into this part of the heap
 		memcpy(uploadAddress, data, dataSizeInBytes);
-
-		// Increment the offset and loop back to the beginning if necessary,
-		// allowing us to treat the upload heap like a ring buffer
-		cbUploadHeapOffsetInBytes += reservationSize;
-		if (cbUploadHeapOffsetInBytes >= cbUploadHeapSizeInBytes)
-			cbUploadHeapOffsetInBytes = 0;
 	}
 
 	// Create a CBV for this section of the heap
@@ -423,10 +1077,13 @@ D3D12_GPU_DESCRIPTOR_HANDLE Graphics::FillNextConstantBufferAndGetGPUDescriptorH
 		D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle = cbvSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
 		D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle = cbvSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart();
 
-		// Offset each by based on how many descriptors we've used
-		// Note: cbvDescriptorOffset is a COUNT of descriptors, not bytes so we must calculate the size
-		cpuHandle.ptr += (SIZE_T)cbvDescriptorOffset * cbvSrvDescriptorHeapIncrementSize;
-		gpuHandle.ptr += (SIZE_T)cbvDescriptorOffset * cbvSrvDescriptorHeapIncrementSize;
+		// Offset each by based on which descriptor we got
+		// Note: This is a COUNT of descriptors, not bytes so we must calculate the size
+		unsigned int cbvDescriptorIndex = 0;
+		if (!AllocateCbvDescriptor(cbvDescriptorIndex))
+			return D3D12_GPU_DESCRIPTOR_HANDLE{};
+		cpuHandle.ptr += (SIZE_T)cbvDescriptorIndex * cbvSrvDescriptorHeapIncrementSize;
+		gpuHandle.ptr += (SIZE_T)cbvDescriptorIndex * cbvSrvDescriptorHeapIncrementSize;
 
 		// Describe the constant buffer view that points to our latest chunk of the CB upload heap
 		D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
@@ -435,12 +1092,7 @@ D3D12_GPU_DESCRIPTOR_HANDLE Graphics::FillNextConstantBufferAndGetGPUDescriptorH
 
 		// Create the CBV, which is a lightweight operation in DX12
 		Device->CreateConstantBufferView(&cbvDesc, cpuHandle);
-
-		// Increment the offset and loop back to the beginning if necessary
-		// which allows us to treat the descriptor heap as a ring buffer
-		cbvDescriptorOffset++;
-		if (cbvDescriptorOffset >= maxConstantBuffers)
-			cbvDescriptorOffset = 0;
+		cbvDescriptorWrites++;
 
 		// Now that the CBV is ready, we return the GPU handle to it
 		// so it can be set as part of the root signature during drawing
@@ -448,6 +1100,73 @@ D3D12_GPU_DESCRIPTOR_HANDLE Graphics::FillNextConstantBufferAndGetGPUDescriptorH
 	}
 }
 
+// --------------------------------------------------------
+// Copies the given data into this frame's upload pages and
+// returns its GPU virtual address, for binding as a root CBV
+// with SetGraphicsRootConstantBufferView(). Unlike the call
+// above, no descriptor is written at all. The address is 0
+// if there's no upload memory left for it.
+//
+// data - The data to copy to the GPU
+// dataSizeInBytes - The byte size of the data to copy
+// --------------------------------------------------------
+D3D12_GPU_VIRTUAL_ADDRESS Graphics::FillNextConstantBufferAndGetGPUAddress(
+	void* data, unsigned int dataSizeInBytes, FrameUploadRange* range)
+{
+	// Root CBVs have the same 256 byte alignment rule as any other CBV
+	D3D12_GPU_VIRTUAL_ADDRESS virtualGPUAddress = 0;
+	void* uploadAddress = 0;
+	if (!AllocateFrameUpload(range, dataSizeInBytes, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, virtualGPUAddress, uploadAddress))
+		return 0;
+
+	memcpy(uploadAddress, data, dataSizeInBytes);
+	rootConstantBuffers++;
+	return virtualGPUAddress;
+}
+
+// --------------------------------------------------------
+// Copies the given indices into this frame's upload pages
+// (just like constant buffer data) and returns an index
+// buffer view of them, ready for IASetIndexBuffer(). The
+// view is empty if there are more than maxDynamicIndices.
+//
+// indices - The 32-bit indices to copy to the GPU
+// indexCount - How many there are
+// --------------------------------------------------------
+D3D12_INDEX_BUFFER_VIEW Graphics::FillNextIndexBufferAndGetView(
+	const unsigned int* indices, unsigned int indexCount, FrameUploadRange* range)
+{
+	UINT64 sizeInBytes = (UINT64)indexCount * sizeof(unsigned int);
+
+	D3D12_INDEX_BUFFER_VIEW view = {};
+	void* uploadAddress = 0;
+	if (!AllocateFrameUpload(range, sizeInBytes, sizeof(unsigned int), view.BufferLocation, uploadAddress))
+		return view;
+
+	memcpy(uploadAddress, indices, (size_t)sizeInBytes);
+	view.SizeInBytes = (UINT)sizeInBytes;
+	view.Format = DXGI_FORMAT_R32_UINT;
+	return view;
+}
+
+// --------------------------------------------------------
+// Prints how much per-frame upload memory and how many
+// CBVs the last frame used, and the most any frame has
+// --------------------------------------------------------
+void Graphics::PrintFrameMemoryStats()
+{
+	FrameAllocatorStats uploadStats = frameUploadAllocator.GetStats();
+	FrameAllocatorStats cbvStats = cbvDescriptorAllocator.GetStats();
+	printf("Frame uploads: %.1f KB last frame, %.1f KB peak (%u pages), %u pages of %.1f MB in use of %u\n",
+		uploadStats.lastFrameBytes / 1024.0, uploadStats.highWaterBytes / 1024.0, uploadStats.highWaterPages,
+		uploadStats.pagesInUse, uploadStats.pageSize / (1024.0 * 1024.0), uploadStats.pages);
+	printf("CBVs: %llu last frame, %llu peak, %u of %u in use, %zu stalls, %zu failed\n",
+		cbvStats.lastFrameBytes, cbvStats.highWaterBytes, cbvStats.pagesInUse * cbvDescriptorPageSize,
+		maxConstantBuffers, cbvDescriptorStalls.load(), cbvDescriptorFailures.load());
+	printf("Constant buffers last frame: %u through CBVs, %u as root CBVs (descriptor writes skipped)\n",
+		lastFrameCbvDescriptorWrites, lastFrameRootConstantBuffers);
+}
+
 // --------------------------------------------------------
 // Called at the end of the program to clean up any
 // graphics API specific memory. 
@@ -458,6 +1177,50 @@ D3D12_GPU_DESCRIPTOR_HANDLE Graphics::FillNextConstantBufferAndGetGPUDescriptorH
 // --------------------------------------------------------
 void Graphics::ShutDown()
 {
+	// Stop streaming before anything it uses goes away
+	if (streamThread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(streamMutex);
+			streamThreadQuit = true;
+		}
+		streamSignal.notify_one();
+		streamThread.join();
+	}
+	streamJobs.clear();
+	streamResults.clear();
+
+	// The batch waits for its last copies, so it has to
+	// go before the device it records them on
+	uploads.reset();
+	uploadDevice.reset();
+
+	// Anything compiled this run is saved for the next one
+	if (pipelineCache)
+		pipelineCache->Save(FixPath(pipelineCacheFile));
+	pipelineCache.reset();
+	pipelineDevice.reset();
+	rootSignatures.clear();
+	rootSignatureHashes.clear();
+
+	frameUploadPages.clear();
+	frameUploadPageAddresses.clear();
+
+	// Placed resources have to go before the heaps they live in
+	for (DeferredFree& entry : deferredFrees)
+		gpuMemory->Free(entry.allocation);
+	for (LoadedTexture& loaded : textures)
+		gpuMemory->Free(loaded.texture);
+	deferredFrees.clear();
+	textures.clear();
+	textureSlotsByPath.clear();
+	gpuMemory.reset();
+
+	frameStats.StopCapture();
+	profiler.reset();
+	profilerDevice.reset();
+	framePacer.reset();
+	framePacingDevice.reset();
 }
 
 // --------------------------------------------------------
@@ -491,7 +1254,7 @@ void Graphics::ResizeBuffers(unsigned int width, unsigned int height)
 		width,
 		height,
 		DXGI_FORMAT_R8G8B8A8_UNORM,
-		supportsTearing ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0);
+		SwapChainFlags());
 
 	// What is the increment size between RTV descriptors in a
 	// descriptor heap? This differs per GPU so we need to
@@ -565,8 +1328,8 @@ void Graphics::ResizeBuffers(unsigned int width, unsigned int height)
 			DSVHandle);
 	}
 
-	// Reset back to the first buffer
-	currentBackBufferIndex = 0;
+	// Frame fence values carry on as they were; only the back buffer changes
+	currentBackBufferIndex = swapChain3->GetCurrentBackBufferIndex();
 
 	// Are we in a fullscreen state?
 	SwapChain->GetFullscreenState(&isFullscreen, 0);
@@ -579,170 +1342,541 @@ void Graphics::ResizeBuffers(unsigned int width, unsigned int height)
 // Helper for creating a static buffer that will get
 // data once and remain immutable
 //
+// The buffer is placed in one of the shared GPU heaps (see
+// GpuMemory.h) rather than getting an allocation of its
+// own, and should be freed with FreeGpuMemory(). The data
+// goes up through the upload batch on the copy queue, so
+// this doesn't wait for the GPU. The buffer is ready for
+// any command list executed after the next FlushUploads(),
+// which CloseAndExecuteCommandList() does.
+//
 // dataStride - The size of one piece of data in the buffer (like a vertex)
 // dataCount - How many pieces of data (like how many vertices)
 // data - Pointer to the data itself
 // --------------------------------------------------------
-Microsoft::WRL::ComPtr<ID3D12Resource> Graphics::CreateStaticBuffer(
-	size_t dataStride, size_t dataCount, void* data)
-
-{
-	// Creates a temporary command allocator and list so we don't
-	// screw up any other ongoing work (since resetting a command allocator
-	// cannot happen while its list is being executed). These ComPtrs will
-	// be cleaned up automatically when they go out of scope.
-	// Note: This certainly isn't efficient, but hopefully this only
-	// happens during start-up. Otherwise, refactor this to use
-	// the existing list and allocator(s).
-	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> localAllocator;
-	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> localList;
-
-	Device->CreateCommandAllocator(
-		D3D12_COMMAND_LIST_TYPE_DIRECT,
-		IID_PPV_ARGS(localAllocator.GetAddressOf()));
-
-	Device->CreateCommandList(
-		0,                              // Which physical GPU will handle these tasks? 0 for single GPU setup
-		D3D12_COMMAND_LIST_TYPE_DIRECT, // Type of command list
-		localAllocator.Get(),           // The allocator for this list (to start)
-		0,                              // Initial pipeline state - none for now
-		IID_PPV_ARGS(localList.GetAddressOf()));
-
-	// The overall buffer we'll be creating
-	Microsoft::WRL::ComPtr<ID3D12Resource> buffer;
-
-	// Describes the final heap
-	D3D12_HEAP_PROPERTIES props = {};
-	props.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-	props.CreationNodeMask = 1;
-	props.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-	props.Type = D3D12_HEAP_TYPE_DEFAULT;
-	props.VisibleNodeMask = 1;
-
-	D3D12_RESOURCE_DESC desc = {};
-	desc.Alignment = 0;
-	desc.DepthOrArraySize = 1;
-	desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-	desc.Flags = D3D12_RESOURCE_FLAG_NONE;
-	desc.Format = DXGI_FORMAT_UNKNOWN;
-	desc.Height = 1;                     // Assuming this is a regular buffer, not a texture
-	desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-	desc.MipLevels = 1;
-	desc.SampleDesc.Count = 1;
-	desc.SampleDesc.Quality = 0;
-	desc.Width = dataStride * dataCount; // Size of the buffer
-
-	Device->CreateCommittedResource(
-		&props,
-		D3D12_HEAP_FLAG_NONE,
-		&desc,
-		D3D12_RESOURCE_STATE_COPY_DEST,
-		0,
-		IID_PPV_ARGS(buffer.GetAddressOf()));
-
-	// Now create an intermediate upload heap for copying initial data
-	D3D12_HEAP_PROPERTIES uploadProps = {};
-	uploadProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-	uploadProps.CreationNodeMask = 1;
-	uploadProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-	uploadProps.Type = D3D12_HEAP_TYPE_UPLOAD;
-	uploadProps.VisibleNodeMask = 1;
-
-	Microsoft::WRL::ComPtr<ID3D12Resource> uploadHeap;
-
-	Device->CreateCommittedResource(
-		&uploadProps,
-		D3D12_HEAP_FLAG_NONE,
-		&desc,
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		0,
-		IID_PPV_ARGS(uploadHeap.GetAddressOf()));
-
-	// Do a straight map/memcpy/unmap
-	void* gpuAddress = 0;
-	uploadHeap->Map(0, 0, &gpuAddress);
-	memcpy(gpuAddress, data, dataStride * dataCount);
-	uploadHeap->Unmap(0, 0);
-
-	// Copy the whole buffer from uploadheap to vert buffer
-	localList->CopyResource(buffer.Get(), uploadHeap.Get());
-
-	// Transition the buffer to generic read for the rest of the app lifetime (presumable)
-	D3D12_RESOURCE_BARRIER rb = {};
-	rb.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-	rb.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-	rb.Transition.pResource = buffer.Get();
-	rb.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
-	rb.Transition.StateAfter = D3D12_RESOURCE_STATE_GENERIC_READ;
-	rb.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-	localList->ResourceBarrier(1, &rb);
-
-	// Execute the local command list and wait for it to complete
-	// before returning the final buffer
-	localList->Close();
-	ID3D12CommandList* list[] = { localList.Get() };
-	CommandQueue->ExecuteCommandLists(1, list);
+GpuAllocation Graphics::CreateStaticBuffer(
+	size_t dataStride, size_t dataCount, const void* data)
+
+{
+	// Buffers start out in the common state, which the copy queue
+	// promotes to a copy destination and the direct queue then
+	// promotes to whatever read state it needs - no barriers required.
+	// Small buffers are just a range of a larger one, so the upload
+	// and any views need to start at the allocation's offset.
+	GpuAllocation buffer = gpuMemory->CreateBuffer(dataStride * dataCount);
+	if (buffer.resource)
+		uploads->UploadBuffer(buffer.resource.Get(), data, dataStride * dataCount, buffer.offset);
 
-	WaitForGPU();
 	return buffer;
 }
 
+// --------------------------------------------------------
+// Hands an allocation back to the GPU heaps once the GPU
+// is done with it. Frames already in flight (and the one
+// being built) may still use it, so it's only really freed
+// once everything submitted so far has finished - see
+// AdvanceSwapChainIndex().
+// --------------------------------------------------------
+void Graphics::FreeGpuMemory(GpuAllocation& allocation)
+{
+	if (gpuMemory && allocation.resource)
+	{
+		DeferredFree entry = { allocation, 0 };
+		deferredFrees.push_back(entry);
+	}
+
+	allocation = GpuAllocation();
+}
+
+void Graphics::PrintMemoryReport()
+{
+	gpuMemory->PrintReport();
+}
+
+// --------------------------------------------------------
+// Submits any uploads recorded since the last flush and
+// has the direct queue wait for them on the GPU, so work
+// executed after this can use the uploaded resources
+// without the CPU ever waiting
+// --------------------------------------------------------
+void Graphics::FlushUploads()
+{
+	UploadTicket ticket = uploads->Submit();
+
+	// The batch may also have submitted on its own when its
+	// staging ring filled up, so compare against the last wait
+	if (ticket.fenceValue > uploadFenceWaitedOn)
+	{
+		CommandQueue->Wait(uploadDevice->GetFence(), ticket.fenceValue);
+		uploadFenceWaitedOn = ticket.fenceValue;
+	}
+}
+
+void Graphics::PrintUploadStats()
+{
+	uploads->PrintStats();
+}
+
+// --------------------------------------------------------
+// Creates a root signature, or returns the one already
+// made from an identical description. Returns null if the
+// description doesn't serialize.
+// --------------------------------------------------------
+Microsoft::WRL::ComPtr<ID3D12RootSignature> Graphics::GetRootSignature(const D3D12_ROOT_SIGNATURE_DESC& desc)
+{
+	Microsoft::WRL::ComPtr<ID3DBlob> serialized;
+	Microsoft::WRL::ComPtr<ID3DBlob> errors;
+	D3D12SerializeRootSignature(&desc, D3D_ROOT_SIGNATURE_VERSION_1, serialized.GetAddressOf(), errors.GetAddressOf());
+
+	// Check for errors during serialization
+	if (errors)
+		OutputDebugStringA((const char*)errors->GetBufferPointer());
+	if (!serialized)
+		return 0;
+
+	// The serialized form holds everything, pointed-to parameters included
+	unsigned long long hash = PipelineHasher::HashBytes(serialized->GetBufferPointer(), serialized->GetBufferSize());
+	auto existing = rootSignatures.find(hash);
+	if (existing != rootSignatures.end())
+		return existing->second;
+
+	Microsoft::WRL::ComPtr<ID3D12RootSignature> rootSignature;
+	if (FAILED(Device->CreateRootSignature(0, serialized->GetBufferPointer(), serialized->GetBufferSize(), IID_PPV_ARGS(rootSignature.GetAddressOf()))))
+		return 0;
+
+	rootSignatures[hash] = rootSignature;
+	rootSignatureHashes[rootSignature.Get()] = hash;
+	return rootSignature;
+}
+
+// --------------------------------------------------------
+// Creates a pipeline state, or returns the one already made
+// from an identical description, loading it from the
+// pipeline library when an earlier run compiled it. Its
+// root signature has to come from GetRootSignature() for
+// it to be cached; any other is just compiled each time.
+// --------------------------------------------------------
+Microsoft::WRL::ComPtr<ID3D12PipelineState> Graphics::GetPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+{
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineState;
+	auto rootSignatureHash = rootSignatureHashes.find(desc.pRootSignature);
+	if (rootSignatureHash == rootSignatureHashes.end())
+	{
+		Device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(pipelineState.GetAddressOf()));
+		return pipelineState;
+	}
+
+	unsigned long long key = PipelineDeviceD3D12::HashDescription(desc, rootSignatureHash->second);
+	pipelineState = (ID3D12PipelineState*)pipelineCache->GetPipeline(key, &desc);
+	return pipelineState;
+}
+
+void Graphics::PrintPipelineStats()
+{
+	printf("Root signatures: %zu distinct\n", rootSignatures.size());
+	pipelineCache->PrintStats();
+}
+
+// --------------------------------------------------------
+// Loads a set of textures and returns CPU-side descriptors
+// for their SRVs, in the same order as the files
+//
+// Each file is only loaded once, however many times (or by
+// however many paths) it's asked for, here or in an earlier
+// call. New files are decoded on worker threads, then all
+// of them go up through the upload batch without waiting.
+// Mips of 8-bit formats are box filtered on the CPU while
+// decoding; anything else falls back to DXTK's GPU mip
+// generation, which waits for its own upload. Files with
+// a cooked .dds (see TextureCooker) skip all of that.
+// --------------------------------------------------------
+void Graphics::LoadTextures(const std::vector<std::wstring>& files, std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>& srvs, bool generateMips, bool streamed)
+{
+	// Find which files are new, and which are already loaded (or requested twice)
+	auto startTime = std::chrono::high_resolution_clock::now();
+	std::vector<DecodedTexture> pending;
+	std::vector<unsigned int> slots(files.size());
+	std::vector<size_t> pendingIndices(files.size(), (size_t)-1);
+	{
+		std::unordered_map<std::wstring, size_t> pendingByPath;
+		for (size_t i = 0; i < files.size(); i++)
+		{
+			std::wstring path = CanonicalTexturePath(files[i].c_str());
+
+			auto loaded = textureSlotsByPath.find(path);
+			if (loaded != textureSlotsByPath.end())
+			{
+				slots[i] = loaded->second;
+				textures[loaded->second].references++;
+				textureStats.shared++;
+				continue;
+			}
+
+			auto requested = pendingByPath.find(path);
+			if (requested != pendingByPath.end())
+			{
+				pendingIndices[i] = requested->second;
+				pending[requested->second].references++;
+				textureStats.shared++;
+				continue;
+			}
+
+			pendingIndices[i] = pending.size();
+			pendingByPath[path] = pending.size();
+			pending.emplace_back();
+			pending.back().path = path;
+			pending.back().references = 1;
+			pending.back().streamed = streamed && generateMips;
+		}
+	}
+	auto decodeTime = std::chrono::high_resolution_clock::now();
+
+	// Decode on as many threads as there are files (or cores), each one
+	// taking the next file until they're gone. WIC needs COM on each thread.
+	// Streamed textures are scaled down to their startup mips as they decode.
+	unsigned int threadCount = Parallel::HardwareThreads();
+	if (threadCount > pending.size())
+		threadCount = (unsigned int)pending.size();
+
+	std::atomic<size_t> nextFile = 0;
+	Parallel::Run(threadCount, [&](size_t)
+		{
+			HRESULT com = CoInitializeEx(0, COINIT_MULTITHREADED);
+			for (size_t i = nextFile++; i < pending.size(); i = nextFile++)
+			{
+				DecodedTexture& decoded = pending[i];
+				unsigned int maxSize = 0;
+				if (decoded.streamed && ReadImageSize(decoded.path.c_str(), decoded.width, decoded.height))
+				{
+					unsigned int size = decoded.width > decoded.height ? decoded.width : decoded.height;
+					maxSize = size >> TextureStreamer::StartupMip(decoded.width, decoded.height, textureStreamingStartupMips);
+				}
+				else
+				{
+					decoded.streamed = false;
+				}
+
+				DecodeTexture(decoded, generateMips, maxSize);
+			}
+			if (SUCCEEDED(com))
+				CoUninitialize();
+		});
+	auto uploadTime = std::chrono::high_resolution_clock::now();
+
+	// Place each texture in our heaps and queue its upload
+	std::vector<GpuAllocation> created(pending.size());
+	for (size_t i = 0; i < pending.size(); i++)
+	{
+		DecodedTexture& decoded = pending[i];
+		textureStats.decodeCpuSeconds += decoded.seconds;
+		if (decoded.cooked)
+			textureStats.cooked++;
+
+		if (decoded.gpuMips)
+		{
+			created[i].resource = LoadTextureWithGPUMips(decoded.path.c_str());
+			decoded.streamed = false;
+		}
+		else if (decoded.loaded)
+		{
+			// DXTK only makes committed textures, so swap it for one placed in
+			// our heaps (the GPU never saw it, so it can go right away). If the
+			// heaps can't make room, just keep the committed one.
+			D3D12_RESOURCE_DESC desc = decoded.loaded->GetDesc();
+			created[i] = gpuMemory->CreateTexture(desc, D3D12_RESOURCE_STATE_COMMON);
+			if (!created[i].resource)
+				created[i].resource = decoded.loaded;
+			decoded.loaded.Reset();
+
+			// The batch copies everything into staging memory right away,
+			// so none of the CPU-side data needs to outlive this call
+			uploads->UploadTexture(created[i].resource.Get(), decoded.subresources.data(), desc.MipLevels);
+		}
+	}
+	auto srvTime = std::chrono::high_resolution_clock::now();
+
+	// Give each new texture a slot in the CPU-side SRV heap
+	D3D12_CPU_DESCRIPTOR_HANDLE heapStart = textureSRVHeap->GetCPUDescriptorHandleForHeapStart();
+	std::vector<unsigned int> pendingSlots(pending.size());
+	size_t failedCount = 0;
+	for (size_t i = 0; i < pending.size(); i++)
+	{
+		unsigned int slot;
+		if (!freeTextureSRVs.empty())
+		{
+			slot = freeTextureSRVs.back();
+			freeTextureSRVs.pop_back();
+		}
+		else if (textures.size() < MaxTextureDescriptors)
+		{
+			slot = (unsigned int)textures.size();
+			textures.emplace_back();
+		}
+		else
+		{
+			printf("Error: out of texture descriptors, so %ls wasn't loaded; raise Graphics::MaxTextureDescriptors\n",
+				pending[i].path.c_str());
+			FreeGpuMemory(created[i]);
+			pendingSlots[i] = NoIndex;
+			failedCount++;
+			continue;
+		}
+
+		LoadedTexture& loaded = textures[slot];
+		loaded.texture = created[i];
+		loaded.path = pending[i].path;
+		loaded.references = pending[i].references;
+		loaded.streamId = NoIndex;
+		loaded.copies.clear();
+		textureSlotsByPath[pending[i].path] = slot;
+		pendingSlots[i] = slot;
+
+		if (pending[i].streamed && created[i].resource)
+		{
+			loaded.width = pending[i].width;
+			loaded.height = pending[i].height;
+			loaded.streamId = textureStreamer.Add(loaded.width, loaded.height, pending[i].bitsPerPixel);
+			loaded.residentMip = textureStreamer.GetStartupMip(loaded.streamId);
+			streamSlots.push_back(slot);
+		}
+
+		// Note: Using a null description results in the "default" SRV
+		// (same format, all mips, all array slices, etc.)
+		D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle = heapStart;
+		cpuHandle.ptr += (SIZE_T)slot * cbvSrvDescriptorHeapIncrementSize;
+		Device->CreateShaderResourceView(created[i].resource.Get(), 0, cpuHandle);
+	}
+
+	// Return the CPU descriptor handles, which can be used to
+	// copy the descriptors to a shader-visible heap later
+	// (files that didn't get a slot get an empty one)
+	srvs.resize(files.size());
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		unsigned int slot = pendingIndices[i] != (size_t)-1 ? pendingSlots[pendingIndices[i]] : slots[i];
+		srvs[i] = {};
+		if (slot == NoIndex)
+			continue;
+
+		srvs[i] = heapStart;
+		srvs[i].ptr += (SIZE_T)slot * cbvSrvDescriptorHeapIncrementSize;
+	}
+	auto endTime = std::chrono::high_resolution_clock::now();
+
+	textureStats.requested += files.size();
+	textureStats.loaded += pending.size() - failedCount;
+	textureStats.failed += failedCount;
+	if (threadCount > textureStats.threads)
+		textureStats.threads = threadCount;
+	textureStats.pathSeconds += std::chrono::duration<double>(decodeTime - startTime).count();
+	textureStats.decodeSeconds += std::chrono::duration<double>(uploadTime - decodeTime).count();
+	textureStats.uploadSeconds += std::chrono::duration<double>(srvTime - uploadTime).count();
+	textureStats.srvSeconds += std::chrono::duration<double>(endTime - srvTime).count();
+}
+
+// --------------------------------------------------------
+// Loads a single texture (see LoadTextures) and returns a
+// CPU-side descriptor for its SRV
+// --------------------------------------------------------
 D3D12_CPU_DESCRIPTOR_HANDLE Graphics::LoadTexture(const wchar_t* file, bool generateMips)
 {
-	// Helper function from DXTK for uploading a resource
-	// (like a texture) to the appropriate GPU memory
-	DirectX::ResourceUploadBatch upload(Device.Get());
-	upload.Begin();
+	std::vector<std::wstring> files(1, file);
+	std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> srvs;
+	LoadTextures(files, srvs, generateMips);
+	return srvs[0];
+}
 
-	// Attempt to create the texture
-	Microsoft::WRL::ComPtr<ID3D12Resource> texture;
-	DirectX::CreateWICTextureFromFile(Device.Get(), upload, file, texture.GetAddressOf(), generateMips);
+// --------------------------------------------------------
+// Drops one reference to a loaded texture. The last one
+// frees the texture (once the GPU is done with it) and its
+// SRV slot, so a later load of the same file starts over.
+// SRVs already copied to the shader visible heap are the
+// caller's to stop using.
+// --------------------------------------------------------
+void Graphics::UnloadTexture(D3D12_CPU_DESCRIPTOR_HANDLE srv)
+{
+	unsigned int slot = TextureSlot(srv);
+	if (slot == NoIndex || textures[slot].references == 0)
+		return;
 
-	// Perform the upload and wait for it to finish before returning the texture
-	auto finish = upload.End(CommandQueue.Get());
-	finish.wait();
+	LoadedTexture& loaded = textures[slot];
+	if (--loaded.references > 0)
+		return;
 
-	// Now that we have the texture, add to our list and make a CPU-side descriptor heap
-	// just for this texture's SRV. Note that it would probably be better to put all
-	// texture SRVs into the same descriptor heap, but we don't know how many we'll need
-	// until they're all loaded and this is a quick and dirty implementation!
-	textures.push_back(texture);
+	if (loaded.streamId != NoIndex)
+	{
+		textureStreamer.Remove(loaded.streamId);
+		streamSlots[loaded.streamId] = NoIndex;
+		loaded.streamId = NoIndex;
+	}
 
-	// Create the CPU-SIDE descriptor heap for our descriptor
-	D3D12_DESCRIPTOR_HEAP_DESC dhDesc = {};
-	dhDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE; // Non-shader visible!
-	dhDesc.NodeMask = 0;
-	dhDesc.NumDescriptors = 1;
-	dhDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> descHeap;
-	Device->CreateDescriptorHeap(&dhDesc, IID_PPV_ARGS(descHeap.GetAddressOf()));
+	FreeGpuMemory(loaded.texture);
+	loaded.copies.clear();
+	textureSlotsByPath.erase(loaded.path);
+	loaded.path.clear();
+	freeTextureSRVs.push_back(slot);
+}
 
-	// Add to our list of heaps (to keep the resource alive)
-	cpuSideTextureDescriptorHeaps.push_back(descHeap);
+void Graphics::PrintTextureStats()
+{
+	printf("Textures: %zu requested, %zu files loaded (%zu cooked, %zu failed), %zu requests shared an already loaded file\n",
+		textureStats.requested, textureStats.loaded, textureStats.cooked, textureStats.failed, textureStats.shared);
+	printf("  paths %.2f ms, decode %.2f ms (%.2f ms of work on up to %u threads), upload %.2f ms, SRVs %.2f ms\n",
+		textureStats.pathSeconds * 1000.0, textureStats.decodeSeconds * 1000.0, textureStats.decodeCpuSeconds * 1000.0,
+		textureStats.threads, textureStats.uploadSeconds * 1000.0, textureStats.srvSeconds * 1000.0);
+}
 
-	// Create the SRV on this descriptor heap
-	// Note: Using a null description results in the "default" SRV
-	// (same format, all mips, all array slices, etc.)
-	D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle = descHeap->GetCPUDescriptorHandleForHeapStart();
-	Device->CreateShaderResourceView(texture.Get(), 0, cpuHandle);
+// --------------------------------------------------------
+// Asks for enough detail from a texture (if it's streamed)
+// for it to cover screenTexels texels across the screen
+// --------------------------------------------------------
+void Graphics::RequestTextureDetail(D3D12_CPU_DESCRIPTOR_HANDLE srv, float screenTexels)
+{
+	unsigned int slot = TextureSlot(srv);
+	if (slot == NoIndex || textures[slot].streamId == NoIndex)
+		return;
 
-	// Return the CPU descriptor handle, which can be used to
-	// copy the descriptor to a shader-visible heap later
-	return cpuHandle;
+	LoadedTexture& texture = textures[slot];
+	unsigned int mip = TextureStreamer::MipForScreenSize(texture.width, texture.height, screenTexels);
+	textureStreamer.Request(texture.streamId, mip, framePacer->GetFrameFence());
 }
 
+// --------------------------------------------------------
+// Hands the streaming thread whatever changes the policy
+// wants this frame, then swaps in the textures it has
+// finished decoding.
+//
+// A swap reallocates the texture with its new mip chain and
+// rewrites its SRV everywhere it was copied, in the master
+// copy of the texture region. Frames in flight keep their
+// own copies (and the old texture, until they're done), so
+// nothing waits for the GPU; each frame picks the changes up
+// as it begins. Call this before recording anything into
+// the frame, streamed textures or not, since that's when
+// the frame's texture descriptors are brought up to date.
+// --------------------------------------------------------
+void Graphics::UpdateTextureStreaming()
+{
+	CPU_ZONE("Graphics::UpdateTextureStreaming");
+	SyncFrameTextureRegion();
+
+	std::vector<TextureStreamChange> changes;
+	textureStreamer.Update(
+		framePacer->GetFrameFence(),
+		textureStreamingMaxChanges - streamJobsInFlight,
+		changes);
+
+	if (!changes.empty())
+	{
+		std::lock_guard<std::mutex> lock(streamMutex);
+		for (const TextureStreamChange& change : changes)
+		{
+			LoadedTexture& texture = textures[streamSlots[change.texture]];
+			unsigned int size = texture.width > texture.height ? texture.width : texture.height;
+
+			std::unique_ptr<StreamJob> job = std::make_unique<StreamJob>();
+			job->slot = streamSlots[change.texture];
+			job->streamId = change.texture;
+			job->firstMip = change.firstMip;
+			job->maxSize = (size >> change.firstMip) > 0 ? size >> change.firstMip : 1;
+			job->decoded.path = texture.path;
+			streamJobs.push_back(std::move(job));
+			streamJobsInFlight++;
+		}
+		streamSignal.notify_one();
+	}
+
+	std::deque<std::unique_ptr<StreamJob>> finished;
+	{
+		std::lock_guard<std::mutex> lock(streamMutex);
+		finished.swap(streamResults);
+	}
+	if (finished.empty())
+		return;
+
+	// Place and upload the new versions (skipping any unloaded since)
+	std::vector<GpuAllocation> created(finished.size());
+	for (size_t i = 0; i < finished.size(); i++)
+	{
+		StreamJob& job = *finished[i];
+		streamJobsInFlight--;
+		if (streamSlots[job.streamId] != job.slot || !job.decoded.loaded)
+			continue;
+
+		D3D12_RESOURCE_DESC desc = job.decoded.loaded->GetDesc();
+		created[i] = gpuMemory->CreateTexture(desc, D3D12_RESOURCE_STATE_COMMON);
+		if (!created[i].resource)
+			created[i].resource = job.decoded.loaded;
+		job.decoded.loaded.Reset();
+		uploads->UploadTexture(created[i].resource.Get(), job.decoded.subresources.data(), desc.MipLevels);
+	}
+
+	D3D12_CPU_DESCRIPTOR_HANDLE heapStart = textureSRVHeap->GetCPUDescriptorHandleForHeapStart();
+	for (size_t i = 0; i < finished.size(); i++)
+	{
+		StreamJob& job = *finished[i];
+		if (streamSlots[job.streamId] != job.slot)
+			continue;
+
+		// Decoding failed, so it keeps what it has
+		LoadedTexture& texture = textures[job.slot];
+		if (!created[i].resource)
+		{
+			textureStreamer.Complete(job.streamId, texture.residentMip);
+			continue;
+		}
+
+		// The old texture stays until every frame that can see it is done
+		FreeGpuMemory(texture.texture);
+		texture.texture = created[i];
+		texture.residentMip = job.firstMip;
+
+		// Neither the CPU-side SRV nor the master region is read by the GPU
+		D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle = heapStart;
+		cpuHandle.ptr += (SIZE_T)job.slot * cbvSrvDescriptorHeapIncrementSize;
+		Device->CreateShaderResourceView(texture.texture.resource.Get(), 0, cpuHandle);
+		for (unsigned int destination : texture.copies)
+			Device->CopyDescriptorsSimple(1, TextureRegionSlot(destination), cpuHandle, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+		textureRegionVersion++;
+
+		textureStreamer.Complete(job.streamId, job.firstMip);
+		streamSwaps++;
+	}
+}
+
+void Graphics::PrintTextureStreamingStats()
+{
+	const double MB = 1024.0 * 1024.0;
+	TextureStreamStats stats = textureStreamer.GetStats();
+	printf("Texture streaming: %u textures (%u at full detail), %.1f of %.1f MB, %u promotions, %u evictions, %u held back by the budget\n",
+		stats.textures, stats.texturesAtFullDetail, stats.residentBytes / MB, stats.budgetBytes / MB,
+		stats.promotions, stats.evictions, stats.deferred);
+	printf("  %zu textures swapped, %u changes in flight\n", streamSwaps, streamJobsInFlight);
+}
+
+// --------------------------------------------------------
+// Copies SRVs to the next open part of the texture region
+// of the shader visible heap, returning the GPU handle of
+// the first, or an empty handle if the region is full.
+// The handle is for the first frame's copy of the region,
+// so draws should bind GetFrameTextureTable() of it.
+// --------------------------------------------------------
 D3D12_GPU_DESCRIPTOR_HANDLE Graphics::CopySRVsToDescriptorHeapAndGetGPUDescriptorHandle(
 	D3D12_CPU_DESCRIPTOR_HANDLE firstDescriptorToCopy,
 	unsigned int numDescriptorsToCopy)
 {
-	// Grab the actual heap start on both sides and offset to the next open SRV portion
-	D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle =
-		cbvSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
+	if (srvDescriptorOffset + numDescriptorsToCopy > maxConstantBuffers + MaxTextureDescriptors)
+	{
+		printf("Error: out of texture descriptors in the shader visible heap; raise Graphics::MaxTextureDescriptors\n");
+		return D3D12_GPU_DESCRIPTOR_HANDLE{};
+	}
+
+	// Offset to the next open SRV portion, both in the master
+	// copy we write to and the GPU side we hand back
+	D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle = TextureRegionSlot(srvDescriptorOffset);
 
 	D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle =
 		cbvSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart();
-
-	cpuHandle.ptr += (SIZE_T)srvDescriptorOffset * cbvSrvDescriptorHeapIncrementSize;
 	gpuHandle.ptr += (SIZE_T)srvDescriptorOffset * cbvSrvDescriptorHeapIncrementSize;
 
 	// We know where to copy these descriptors, so copy all of them and remember the new offset
@@ -752,7 +1886,15 @@ D3D12_GPU_DESCRIPTOR_HANDLE Graphics::CopySRVsToDescriptorHeapAndGetGPUDescripto
 		firstDescriptorToCopy,
 		D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
+	for (unsigned int i = 0; i < numDescriptorsToCopy; i++)
+	{
+		D3D12_CPU_DESCRIPTOR_HANDLE source = firstDescriptorToCopy;
+		source.ptr += (SIZE_T)i * cbvSrvDescriptorHeapIncrementSize;
+		TrackTextureCopy(source, srvDescriptorOffset + i);
+	}
+
 	srvDescriptorOffset += numDescriptorsToCopy;
+	textureRegionVersion++;
 
 	// Pass back the GPU handle to the start of this section
 	// in the final CBV/SRV heap so the caller can use it later
@@ -760,34 +1902,224 @@ D3D12_GPU_DESCRIPTOR_HANDLE Graphics::CopySRVsToDescriptorHeapAndGetGPUDescripto
 }
 
 // --------------------------------------------------------
-// Advances the swap chain back buffer index by 1, wrapping
-// back to zero when necessary. This should occur after
-// presenting the current frame.
+// Copies a texture's SRV into a free slot of the texture
+// region and gives back its index in that region, which is
+// what shaders use to find it. Freed slots are reused
+// first, then new ones are taken from the end. Fails (and
+// says so) when every slot is taken.
+// --------------------------------------------------------
+bool Graphics::AddBindlessTexture(D3D12_CPU_DESCRIPTOR_HANDLE srv, unsigned int& index)
+{
+	if (!freeBindlessTextures.empty())
+	{
+		index = freeBindlessTextures.back();
+		freeBindlessTextures.pop_back();
+	}
+	else if (srvDescriptorOffset < maxConstantBuffers + MaxTextureDescriptors)
+	{
+		index = srvDescriptorOffset++ - maxConstantBuffers;
+	}
+	else
+	{
+		printf("Error: out of bindless texture slots; raise Graphics::MaxTextureDescriptors\n");
+		return false;
+	}
+
+	Device->CopyDescriptorsSimple(1, TextureRegionSlot(maxConstantBuffers + index), srv, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	TrackTextureCopy(srv, maxConstantBuffers + index);
+	textureRegionVersion++;
+	return true;
+}
+
+// --------------------------------------------------------
+// Gives a bindless slot back once the frame being recorded
+// (the last one that could use it) is done on the GPU
+// --------------------------------------------------------
+void Graphics::RemoveBindlessTexture(unsigned int index)
+{
+	DeferredDescriptorFree entry = { index, 0 };
+	deferredBindlessFrees.push_back(entry);
+	UntrackTextureCopy(maxConstantBuffers + index);
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE Graphics::GetBindlessTextureTable()
+{
+	D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle = cbvSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart();
+	gpuHandle.ptr += (SIZE_T)maxConstantBuffers * cbvSrvDescriptorHeapIncrementSize;
+	return GetFrameTextureTable(gpuHandle);
+}
+
+// --------------------------------------------------------
+// Moves a handle into the texture region (as given out by
+// CopySRVsToDescriptorHeapAndGetGPUDescriptorHandle) over
+// to the current frame's copy of the region
+// --------------------------------------------------------
+D3D12_GPU_DESCRIPTOR_HANDLE Graphics::GetFrameTextureTable(D3D12_GPU_DESCRIPTOR_HANDLE table)
+{
+	if (table.ptr != 0)
+		table.ptr += (SIZE_T)framePacer->GetFrameSlot() * MaxTextureDescriptors * cbvSrvDescriptorHeapIncrementSize;
+	return table;
+}
+
+// --------------------------------------------------------
+// Ends the frame that was just presented and begins the
+// next, waiting (see FramePacer) until the swap chain and
+// GPU are ready for it. This should occur after presenting
+// the current frame.
 // --------------------------------------------------------
 void Graphics::AdvanceSwapChainIndex()
 {
-	// signal into command queue with current fence value
-	CommandQueue->Signal(FrameSyncFence.Get(), FrameSyncFenceCounters[currentBackBufferIndex]);
+	// The pacer signals this frame's fence value into the queue
+	UINT64 frameFenceValue = framePacer->GetFrameFence();
+
+	// Everything this frame wrote per-frame data into, or freed,
+	// can be reused once the GPU gets past that signal
+	frameUploadAllocator.EndFrame(frameFenceValue);
+	cbvDescriptorAllocator.EndFrame(frameFenceValue);
+	lastFrameCbvDescriptorWrites = cbvDescriptorWrites;
+	lastFrameRootConstantBuffers = rootConstantBuffers;
+	cbvDescriptorWrites = 0;
+	rootConstantBuffers = 0;
+	for (DeferredFree& entry : deferredFrees)
+	{
+		if (entry.fenceValue == 0)
+			entry.fenceValue = frameFenceValue;
+	}
+	for (DeferredDescriptorFree& entry : deferredBindlessFrees)
+	{
+		if (entry.fenceValue == 0)
+			entry.fenceValue = frameFenceValue;
+	}
 
-	// calculate next index
-	unsigned int nextBuffer = (currentBackBufferIndex + 1) % NumBackBuffers;
+	framePacer->FramePresented();
 
-	// do we need to wait for the next frame?
-	if (FrameSyncFence->GetCompletedValue() < FrameSyncFenceCounters[nextBuffer])
+	// Any frames the GPU finished meanwhile go into the frame statistics
+	for (const FrameTiming& timing : framePacer->GetTimeline())
 	{
-		// not completed, so wait
-		FrameSyncFence->SetEventOnCompletion(FrameSyncFenceCounters[nextBuffer], FrameSyncFenceEvent);
-		WaitForSingleObject(FrameSyncFenceEvent, INFINITE);
+		if (timing.frame <= lastFinishedFrame.frame)
+			continue;
+
+		// Frames that went missing (say, while changing frames in
+		// flight) leave no time for the one before them. Fences start
+		// at 1, so frame 0 means there's no frame before this one yet.
+		if (lastFinishedFrame.frame != 0 && timing.frame == lastFinishedFrame.frame + 1)
+		{
+			FrameSample sample;
+			sample.frame = lastFinishedFrame.frame;
+			sample.frameTime = (timing.begin - lastFinishedFrame.begin) * 1000.0;
+			sample.cpuTime = (lastFinishedFrame.submit - lastFinishedFrame.begin) * 1000.0;
+			if (lastFinishedFrame.gpuTimed)
+				sample.gpuTime = (lastFinishedFrame.gpuEnd - lastFinishedFrame.gpuStart) * 1000.0;
+			frameStats.AddFrame(sample);
+		}
+		lastFinishedFrame = timing;
 	}
 
-	// Frame is done, so update the next frame's counter
-	FrameSyncFenceCounters[nextBuffer] = FrameSyncFenceCounters[currentBackBufferIndex] + 1;
+	// The swap chain decides which buffer comes next
+	currentBackBufferIndex = swapChain3->GetCurrentBackBufferIndex();
+
+	// Take back whatever the frames the GPU has finished were holding on to
+	UINT64 completed = FrameSyncFence->GetCompletedValue();
+	frameUploadAllocator.Retire(completed);
+	cbvDescriptorAllocator.Retire(completed);
+
+	for (size_t i = 0; i < deferredFrees.size();)
+	{
+		if (deferredFrees[i].fenceValue != 0 && deferredFrees[i].fenceValue <= completed)
+		{
+			gpuMemory->Free(deferredFrees[i].allocation);
+			deferredFrees[i] = deferredFrees.back();
+			deferredFrees.pop_back();
+		}
+		else
+		{
+			i++;
+		}
+	}
 
-	// Return the new buffer index, which the caller can
-	// use to track which buffer to use for the next frame
-	currentBackBufferIndex = nextBuffer;
+	for (size_t i = 0; i < deferredBindlessFrees.size();)
+	{
+		if (deferredBindlessFrees[i].fenceValue != 0 && deferredBindlessFrees[i].fenceValue <= completed)
+		{
+			freeBindlessTextures.push_back(deferredBindlessFrees[i].index);
+			deferredBindlessFrees[i] = deferredBindlessFrees.back();
+			deferredBindlessFrees.pop_back();
+		}
+		else
+		{
+			i++;
+		}
+	}
 }
 
+// --------------------------------------------------------
+// Changes how many frames the CPU can get ahead of the GPU
+// (2 to 4) and how many presents the swap chain can have
+// queued before the CPU waits on it. Either can be set
+// before Initialize(); afterwards the GPU is flushed first.
+// --------------------------------------------------------
+void Graphics::SetFramePacing(unsigned int newFramesInFlight, unsigned int newMaxFrameLatency)
+{
+	framesInFlight = newFramesInFlight;
+	maxFrameLatency = std::clamp(newMaxFrameLatency, 1u, 16u); // DXGI's own limits
+	if (!apiInitialized)
+		return;
+
+	WaitForGPU();
+	framePacer->SetFramesInFlight(framesInFlight);
+	framesInFlight = framePacer->GetFramesInFlight();
+	framePacingDevice->SetSwapChain(swapChain3.Get(), maxFrameLatency);
+}
+
+std::vector<FrameTiming> Graphics::GetFrameTimeline() { return framePacer->GetTimeline(); }
+
+void Graphics::PrintFramePacingStats()
+{
+	printf("Swap chain: %u back buffers, maximum frame latency %u\n", NumBackBuffers, maxFrameLatency);
+	framePacer->PrintStats();
+}
+
+// --------------------------------------------------------
+// Starts profiling the current frame, first collecting the
+// times of any earlier frames the GPU has finished. Call it
+// once CommandList is ready for the frame.
+// --------------------------------------------------------
+void Graphics::BeginProfiledFrame()
+{
+	profiler->Collect(FrameSyncFence->GetCompletedValue());
+	profiler->BeginFrame(framePacer->GetFrameFence(), framePacer->GetFrameSlot(), CommandList.Get());
+}
+
+// Ends the frame's scopes in the last list it executes (CommandList by default)
+void Graphics::EndProfiledFrame(ID3D12GraphicsCommandList* lastCommandList)
+{
+	profiler->EndFrame(lastCommandList ? lastCommandList : CommandList.Get());
+}
+
+void Graphics::BeginCpuScope(const char* name) { profiler->BeginCpuScope(name); }
+void Graphics::EndCpuScope() { profiler->EndCpuScope(); }
+
+void Graphics::BeginGpuScope(const char* name, ID3D12GraphicsCommandList* commandList)
+{
+	profiler->BeginGpuScope(name, commandList ? commandList : CommandList.Get());
+}
+
+void Graphics::EndGpuScope(ID3D12GraphicsCommandList* commandList)
+{
+	profiler->EndGpuScope(commandList ? commandList : CommandList.Get());
+}
+
+FrameStatsSummary Graphics::GetFrameStats(double windowSeconds) { return frameStats.GetSummary(windowSeconds); }
+void Graphics::PrintFrameStats() { frameStats.PrintStats(5.0); }
+bool Graphics::StartFrameCapture(const std::wstring& file) { return frameStats.StartCapture(file); }
+void Graphics::StopFrameCapture() { frameStats.StopCapture(); }
+bool Graphics::IsCapturingFrames() { return frameStats.IsCapturing(); }
+
+bool Graphics::ExportProfile(const std::wstring& file) { return profiler->ExportChromeTrace(file); }
+void Graphics::PrintProfileStats() { profiler->PrintStats(); }
+void Graphics::SetPrintProfileStats(bool print) { printProfileStats = print; }
+bool Graphics::GetPrintProfileStats() { return printProfileStats; }
+
 // --------------------------------------------------------
 // Resets the command allocator and list
 //
@@ -798,6 +2130,47 @@ void Graphics::ResetAllocatorAndCommandList(int allocatorIndex)
 {
 	CommandAllocators[allocatorIndex]->Reset();
 	CommandList->Reset(CommandAllocators[allocatorIndex].Get(), 0);
+
+	// This starts a frame, so the GPU's timing of it starts here too
+	framePacingDevice->BeginGpuFrame(CommandList.Get(), allocatorIndex);
+}
+
+// --------------------------------------------------------
+// Resets one of the recording command lists (and its
+// allocator for the current frame slot, which the GPU is
+// done with by now) for this frame, creating them the first
+// time. Each index can be reset on its own thread.
+// --------------------------------------------------------
+ID3D12GraphicsCommandList* Graphics::ResetRecordingCommandList(unsigned int index)
+{
+	Microsoft::WRL::ComPtr<ID3D12CommandAllocator>& allocator = RecordingCommandAllocators[framePacer->GetFrameSlot()][index];
+	if (!allocator)
+	{
+		Device->CreateCommandAllocator(
+			D3D12_COMMAND_LIST_TYPE_DIRECT,
+			IID_PPV_ARGS(allocator.GetAddressOf()));
+	}
+	else
+	{
+		allocator->Reset();
+	}
+
+	// New lists start out open, ready to record
+	if (!RecordingCommandLists[index])
+	{
+		Device->CreateCommandList(
+			0,
+			D3D12_COMMAND_LIST_TYPE_DIRECT,
+			allocator.Get(),
+			0,
+			IID_PPV_ARGS(RecordingCommandLists[index].GetAddressOf()));
+	}
+	else
+	{
+		RecordingCommandLists[index]->Reset(allocator.Get(), 0);
+	}
+
+	return RecordingCommandLists[index].Get();
 }
 
 // --------------------------------------------------------
@@ -807,12 +2180,22 @@ void Graphics::ResetAllocatorAndCommandList(int allocatorIndex)
 // command allocator (which CANNOT be reset while the
 // GPU is using its commands) and the command list itself.
 // --------------------------------------------------------
-void Graphics::CloseAndExecuteCommandList()
+void Graphics::CloseAndExecuteCommandList(unsigned int recordingListCount)
 {
-	// Close the current list and execute it as our only list
+	// Anything these lists draw with may have been uploaded since the last one
+	FlushUploads();
+
+	// Close the current list, and any recording lists that go
+	// after it, and execute them all at once
+	ID3D12CommandList* lists[1 + MaxRecordingThreads] = { CommandList.Get() };
 	CommandList->Close();
-	ID3D12CommandList* lists[] = { CommandList.Get() };
-	CommandQueue->ExecuteCommandLists(1, lists);
+	for (unsigned int i = 0; i < recordingListCount; i++)
+	{
+		RecordingCommandLists[i]->Close();
+		lists[1 + i] = RecordingCommandLists[i].Get();
+	}
+	CommandQueue->ExecuteCommandLists(1 + recordingListCount, lists);
+	framePacer->FrameSubmitted();
 }
 
 // --------------------------------------------------------
@@ -821,6 +2204,11 @@ void Graphics::CloseAndExecuteCommandList()
 // --------------------------------------------------------
 void Graphics::WaitForGPU()
 {
+	// Pending uploads count as current work too (the direct
+	// queue waits on them, so the fence below covers them)
+	if (uploads)
+		FlushUploads();
+
 	// Update our ongoing fence value (a unique index for each "stop sign")
 	// and then place that value into the GPU's command queue
 	WaitFenceCounter++;
@@ -4,7 +4,11 @@
 #include <d3d12.h>
 #include <dxgi1_6.h>
 #include <string>
+#include <vector>
 #include <wrl/client.h>
+#include "FramePacer.h"
+#include "FrameStats.h"
+#include "GpuMemory.h"
 
 #pragma comment(lib, "d3d12.lib")
 #pragma comment(lib, "dxgi.lib")
@@ -12,12 +16,36 @@
 namespace Graphics
 {
 	// --- CONSTANTS ---
-	const unsigned int NumBackBuffers = 2;
+	const unsigned int NumBackBuffers = 3;
 
-	// Maximum number of constant buffers, assuming each buffer
-	// is 256 bytes or less. Larger buffers are fine, but will
-	// result in fewer buffers in use at any time
-	const unsigned int maxConstantBuffers = 1000;
+	// Frames the CPU may work on ahead of the GPU (see FramePacer.h),
+	// separate from the back buffer count, and presents the swap chain
+	// may queue before the CPU waits at the start of a frame. Both can
+	// be changed with SetFramePacing(), before or after Initialize().
+	const unsigned int DefaultFramesInFlight = 2;
+	const unsigned int DefaultMaxFrameLatency = 2;
+
+	// Maximum number of constant buffer views in use at once,
+	// counting every frame the GPU may still be reading. They
+	// can be any size, since their data lives in the pages below.
+	const unsigned int maxConstantBuffers = 1024;
+
+	// Per-frame data (constant buffers, culled index lists) goes into
+	// upload memory pages of this size, chained as a frame needs more.
+	// A frame's pages are only reused once the GPU has finished it.
+	const unsigned int frameUploadPageSize = 4 * 1024 * 1024;
+
+	// Most indices that can be uploaded for a single draw
+	const unsigned int maxDynamicIndices = frameUploadPageSize / sizeof(unsigned int);
+
+	// Size of the staging ring that static buffers and textures
+	// are uploaded through. Anything bigger than this still works,
+	// but grows the ring (after a full stall).
+	const size_t uploadStagingSize = 64 * 1024 * 1024;
+
+	// Size of each heap that static buffers and textures are
+	// placed in (see GpuMemory.h)
+	const UINT64 gpuMemoryHeapSize = 64 * 1024 * 1024;
 
 	// --- GLOBAL VARS ---
 
@@ -26,7 +54,7 @@ namespace Graphics
 	inline Microsoft::WRL::ComPtr<IDXGISwapChain> SwapChain;
 
 	// Command submission
-	inline Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CommandAllocators[NumBackBuffers];
+	inline Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CommandAllocators[FramePacer::MaxFramesInFlight];
 	inline Microsoft::WRL::ComPtr<ID3D12CommandQueue> CommandQueue;
 	inline Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> CommandList;
 
@@ -38,19 +66,17 @@ namespace Graphics
 	inline Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> DSVHeap;
 	inline D3D12_CPU_DESCRIPTOR_HANDLE DSVHandle{};
 
-	// Constant ring buffers & descriptors
+	// Constant buffer & texture descriptors
 	inline Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> cbvSrvDescriptorHeap;
-	inline Microsoft::WRL::ComPtr<ID3D12Resource> cbUploadHeap;
 
 	// Basic CPU/GPU synchronization
 	inline Microsoft::WRL::ComPtr<ID3D12Fence> WaitFence;
 	inline HANDLE WaitFenceEvent = 0;
 	inline UINT64 WaitFenceCounter = 0;
 
-	// Frame sync fence
+	// Frame sync fence, signalled with each frame's fence value (see FrameFence())
 	inline Microsoft::WRL::ComPtr<ID3D12Fence> FrameSyncFence;
 	inline HANDLE FrameSyncFenceEvent = 0;
-	inline UINT64 FrameSyncFenceCounters[NumBackBuffers] {};
 
 	// Maximum number of texture descriptors (SRVs) we can have.
 	// Each material will have a chunk of this,
@@ -58,30 +84,137 @@ namespace Graphics
 	// after all textures and materials were created,
 	// we could come up with an exact amount. The following
 	// constant ensures we (hopefully) never run out of room.
+	// If it does, the files that don't fit aren't loaded
+	// and their SRVs come back empty (a ptr of 0).
 	const unsigned int MaxTextureDescriptors = 1000;
+	void LoadTextures(const std::vector<std::wstring>& files, std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>& srvs, bool generateMips = true, bool streamed = false);
 	D3D12_CPU_DESCRIPTOR_HANDLE LoadTexture(const wchar_t* file, bool generateMips = true);
+	void UnloadTexture(D3D12_CPU_DESCRIPTOR_HANDLE srv);
+	void PrintTextureStats();
+
+	// Streamed textures (see LoadTextures) start out with only their coarsest
+	// mips, and get finer ones decoded in the background as draws ask for
+	// them, within a memory budget. Textures no one has asked for in a while,
+	// or that were asked for least recently when room is needed, drop back.
+	// UpdateTextureStreaming() also brings the frame's texture descriptors
+	// up to date, so it's called at the start of every frame regardless.
+	const unsigned int textureStreamingStartupMips = 6;	// 32x32 and down
+	const unsigned long long textureStreamingBudget = 256 * 1024 * 1024;
+	const unsigned int textureStreamingIdleFrames = 300;
+	const unsigned int textureStreamingMaxChanges = 4;		// In flight at once
+	void RequestTextureDetail(D3D12_CPU_DESCRIPTOR_HANDLE srv, float screenTexels);
+	void UpdateTextureStreaming();
+	void PrintTextureStreamingStats();
+
+	// Texture SRVs for the shader visible heap. Each frame in flight has its
+	// own copy of that part of the heap, so changes never touch descriptors
+	// the GPU may be reading. Handles given out are for the first frame's
+	// copy; GetFrameTextureTable() finds the current frame's.
 	D3D12_GPU_DESCRIPTOR_HANDLE CopySRVsToDescriptorHeapAndGetGPUDescriptorHandle(
 		D3D12_CPU_DESCRIPTOR_HANDLE firstDescriptorToCopy,
 		unsigned int numDescriptorsToCopy);
+	D3D12_GPU_DESCRIPTOR_HANDLE GetFrameTextureTable(D3D12_GPU_DESCRIPTOR_HANDLE table);
+
+	// Bindless textures: each SRV gets its own slot in the texture part of
+	// the shader-visible heap, and shaders index the whole region as one
+	// unbounded array starting at GetBindlessTextureTable(). Slots are only
+	// reused once the GPU is done with the frame that removed them.
+	bool AddBindlessTexture(D3D12_CPU_DESCRIPTOR_HANDLE srv, unsigned int& index);
+	void RemoveBindlessTexture(unsigned int index);
+	D3D12_GPU_DESCRIPTOR_HANDLE GetBindlessTextureTable();
 
 	// Debug Layer
 	inline Microsoft::WRL::ComPtr<ID3D12InfoQueue> InfoQueue;
 
 	// Getters
 	unsigned int SwapChainIndex();
+	unsigned int FrameSlot();		// Which frame-in-flight's allocators to use
+	UINT64 FrameFence();			// Signalled once the current frame is done
+	bool SupportsBindless();		// Unbounded SRV ranges need resource binding tier 2
+
+	// A recording thread's share of this frame's upload memory: blocks
+	// of frameUploadBlockSize taken from the shared pages (the only part
+	// that locks), which it then fills on its own. Each thread filling
+	// per-frame data at the same time needs its own, started fresh every
+	// frame. Without one, the shared pages are used directly.
+	const unsigned int frameUploadBlockSize = 64 * 1024;
+	struct FrameUploadRange
+	{
+		D3D12_GPU_VIRTUAL_ADDRESS gpuAddress = 0;
+		unsigned char* cpuAddress = 0;
+		UINT64 used = 0;
+		UINT64 size = 0;
+	};
 
 	// General functions
 	void AdvanceSwapChainIndex();
+	void SetFramePacing(unsigned int framesInFlight, unsigned int maxFrameLatency);
+	std::vector<FrameTiming> GetFrameTimeline();
+	void PrintFramePacingStats();
+
+	// Frame time percentiles and hitches (see FrameStats.h) over the
+	// latest seconds, from the frames the pacer has seen finish. Every
+	// frame can also be captured to a CSV file.
+	FrameStatsSummary GetFrameStats(double windowSeconds);
+	void PrintFrameStats();
+	bool StartFrameCapture(const std::wstring& file);
+	void StopFrameCapture();
+	bool IsCapturingFrames();
 	D3D12_GPU_DESCRIPTOR_HANDLE FillNextConstantBufferAndGetGPUDescriptorHandle(
 		void* data,
-		unsigned int dataSizeInBytes);
+		unsigned int dataSizeInBytes,
+		FrameUploadRange* range = 0);
+	D3D12_GPU_VIRTUAL_ADDRESS FillNextConstantBufferAndGetGPUAddress(
+		void* data,
+		unsigned int dataSizeInBytes,
+		FrameUploadRange* range = 0);
+	D3D12_INDEX_BUFFER_VIEW FillNextIndexBufferAndGetView(
+		const unsigned int* indices,
+		unsigned int indexCount,
+		FrameUploadRange* range = 0);
+	void PrintFrameMemoryStats();
 
 	// Resource creation
-	Microsoft::WRL::ComPtr<ID3D12Resource> CreateStaticBuffer(size_t dataStride, size_t dataCount, void* data);
+	GpuAllocation CreateStaticBuffer(size_t dataStride, size_t dataCount, const void* data);
+	void FreeGpuMemory(GpuAllocation& allocation);
+	void FlushUploads();
+	void PrintUploadStats();
+	void PrintMemoryReport();
+
+	// Root signatures and pipeline states, each made once per distinct
+	// description. Pipeline states are also kept in a library file
+	// between runs, so later runs load them instead of compiling.
+	Microsoft::WRL::ComPtr<ID3D12RootSignature> GetRootSignature(const D3D12_ROOT_SIGNATURE_DESC& desc);
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> GetPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+	void PrintPipelineStats();
+
+	// Frame profiling (see GpuProfiler.h): named scopes that nest, timed
+	// on the CPU and, separately, on the GPU. A frame's GPU times are
+	// picked up a few frames later, without waiting. GPU scopes go in
+	// CommandList unless given another list. Main thread only.
+	void BeginProfiledFrame();
+	void EndProfiledFrame(ID3D12GraphicsCommandList* lastCommandList = 0);
+	void BeginCpuScope(const char* name);
+	void EndCpuScope();
+	void BeginGpuScope(const char* name, ID3D12GraphicsCommandList* commandList = 0);
+	void EndGpuScope(ID3D12GraphicsCommandList* commandList = 0);
+	bool ExportProfile(const std::wstring& file);	// Chrome trace_event JSON
+	void PrintProfileStats();
+	void SetPrintProfileStats(bool print);	// Whether the game prints them periodically
+	bool GetPrintProfileStats();
+
+	// Command lists a frame's draws can be recorded into on other threads,
+	// one per thread, each with its own allocator per frame in flight. They're
+	// executed right after CommandList, in order, by passing how many were
+	// used to CloseAndExecuteCommandList().
+	const unsigned int MaxRecordingThreads = 16;
+	inline Microsoft::WRL::ComPtr<ID3D12CommandAllocator> RecordingCommandAllocators[FramePacer::MaxFramesInFlight][MaxRecordingThreads];
+	inline Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> RecordingCommandLists[MaxRecordingThreads];
 
 	// Command list & synchronization
 	void ResetAllocatorAndCommandList(int allocatorIndex);
-	void CloseAndExecuteCommandList();
+	ID3D12GraphicsCommandList* ResetRecordingCommandList(unsigned int index);
+	void CloseAndExecuteCommandList(unsigned int recordingListCount = 0);
 	void WaitForGPU();
 
 	// --- FUNCTIONS ---
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdio>
+#include <ostream>
+#include <string>
+
+// Writes text as a quoted JSON string, escaping what JSON requires
+inline void WriteJsonString(std::ostream& out, const std::string& text)
+{
+	out << '"';
+	for (unsigned char c : text)
+	{
+		if (c == '"' || c == '\\')
+			out << '\\' << c;
+		else if (c < 0x20)
+		{
+			char escaped[8];
+			snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+			out << escaped;
+		}
+		else
+			out << c;
+	}
+	out << '"';
+}
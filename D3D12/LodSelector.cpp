@@ -0,0 +1,53 @@
+#include "LodSelector.h"
+
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Projects a sphere's radius onto the screen. For
+// perspective cameras this uses the tangent distance
+// sqrt(d^2 - r^2), which is exact for the sphere's
+// silhouette at the center of the view.
+// --------------------------------------------------------
+float LodSelector::ScreenRadius(XMFLOAT3 center, float radius,
+	const XMFLOAT4X4& view, const XMFLOAT4X4& projection, float viewportHeight)
+{
+	// Half the viewport height covers this many world units (at distance 1 for perspective)
+	float pixelsPerUnit = projection._22 * viewportHeight * 0.5f;
+
+	// Orthographic projections don't shrink with distance
+	if (projection._44 != 0.0f)
+		return radius * pixelsPerUnit;
+
+	float x = center.x * view._11 + center.y * view._21 + center.z * view._31 + view._41;
+	float y = center.x * view._12 + center.y * view._22 + center.z * view._32 + view._42;
+	float z = center.x * view._13 + center.y * view._23 + center.z * view._33 + view._43;
+
+	float tangentSq = x * x + y * y + z * z - radius * radius;
+	if (tangentSq <= 0.0f)
+		return FLT_MAX;
+
+	return radius * pixelsPerUnit / std::sqrt(tangentSq);
+}
+
+// --------------------------------------------------------
+// LOD errors are object-space distances, so scaling them by
+// screenRadius / meshRadius turns them into pixels no matter
+// how the entity itself is scaled
+// --------------------------------------------------------
+unsigned int LodSelector::Select(const MeshLod* lods, size_t lodCount, float meshRadius, float screenRadius,
+	float maxErrorPixels)
+{
+	if (lodCount == 0 || !(meshRadius > 0.0f))
+		return 0;
+
+	float pixelsPerUnit = screenRadius / meshRadius;
+	for (size_t i = lodCount - 1; i > 0; i--)
+	{
+		if (lods[i].error * pixelsPerUnit <= maxErrorPixels)
+			return (unsigned int)i;
+	}
+	return 0;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <DirectXMath.h>
+#include "MeshSimplifier.h"
+
+// --------------------------------------------------------
+// Picks a level of detail from how big an object's bounding
+// sphere is on screen. Works on plain matrices so it can be
+// used (and checked) without a window or a GPU.
+// --------------------------------------------------------
+namespace LodSelector
+{
+	// How far, in pixels, a LOD may stray from the full mesh on screen
+	const float DefaultMaxErrorPixels = 1.0f;
+
+	// Radius in pixels of a world-space sphere, given the camera's matrices and
+	// the viewport height. Huge when the camera is inside the sphere.
+	float ScreenRadius(DirectX::XMFLOAT3 center, float radius,
+		const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection, float viewportHeight);
+
+	// Index of the coarsest LOD whose error stays within maxErrorPixels, where
+	// meshRadius is the object-space radius the screen radius was measured with
+	unsigned int Select(const MeshLod* lods, size_t lodCount, float meshRadius, float screenRadius,
+		float maxErrorPixels = DefaultMaxErrorPixels);
+}
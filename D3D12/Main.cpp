@@ -1,11 +1,16 @@
 
 #include <Windows.h>
+#include <shellapi.h>
 #include <crtdbg.h>
 
 #include "Window.h"
 #include "Graphics.h"
 #include "Game.h"
+#include "CpuZones.h"
 #include "Input.h"
+#include "Mesh.h"
+#include "PathHelpers.h"
+#include "SceneBenchmark.h"
 
 // Annonymous namespace to hold variables
 // only accessible in this file
@@ -50,6 +55,57 @@ int WINAPI WinMain(
 	printf("Console window created successfully.  Feel free to printf() here.\n");
 #endif
 
+	// Optional settings for the game itself:
+	//  -framesinflight <2-4>                  How far the CPU can get ahead of the GPU
+	//  -framelatency <1-16>                   Presents the swap chain can queue before the CPU waits
+	//  -framecsv <file.csv>                   Capture every frame's times, from start to exit
+	//  -meshstats 1                           Print what loading each mesh does, and meshlet culling
+	//  -stats 1                               Print the engine's start-up and periodic frame reports
+	//  -profilestats 1                        Print profiler scope and CPU zone times every few seconds
+	// And repeatable benchmark runs, reported as JSON:
+	//  -benchmark <frames>                    A scripted scene's update, culling and uploads, with no window or GPU
+	//  -benchmarkrender <frames>              The game itself, rendered, at a fixed delta time
+	//  -benchmarkout <file.json>              Where the report goes (Benchmark.json by default)
+	unsigned int framesInFlight = Graphics::DefaultFramesInFlight;
+	unsigned int maxFrameLatency = Graphics::DefaultMaxFrameLatency;
+	std::wstring frameCsvFile;
+	bool printStats = false;
+	SceneBenchmarkSettings benchmarkSettings;
+	bool headlessBenchmark = false;
+	bool renderBenchmark = false;
+	std::wstring benchmarkFile = FixPath(L"Benchmark.json");
+	int argCount = 0;
+	LPWSTR* args = CommandLineToArgvW(GetCommandLineW(), &argCount);
+	for (int i = 1; args && i + 1 < argCount; i++)
+	{
+		if (wcscmp(args[i], L"-framesinflight") == 0)
+			framesInFlight = (unsigned int)_wtoi(args[i + 1]);
+		else if (wcscmp(args[i], L"-framelatency") == 0)
+			maxFrameLatency = (unsigned int)_wtoi(args[i + 1]);
+		else if (wcscmp(args[i], L"-framecsv") == 0)
+			frameCsvFile = args[i + 1];
+		else if (wcscmp(args[i], L"-meshstats") == 0)
+			Mesh::SetPrintLoadStats(_wtoi(args[i + 1]) != 0);
+		else if (wcscmp(args[i], L"-stats") == 0)
+			printStats = _wtoi(args[i + 1]) != 0;
+		else if (wcscmp(args[i], L"-profilestats") == 0)
+			Graphics::SetPrintProfileStats(_wtoi(args[i + 1]) != 0);
+		else if (wcscmp(args[i], L"-benchmarkout") == 0)
+			benchmarkFile = args[i + 1];
+		else if (wcscmp(args[i], L"-benchmark") == 0 || wcscmp(args[i], L"-benchmarkrender") == 0)
+		{
+			benchmarkSettings.frames = (unsigned int)_wtoi(args[i + 1]);
+			headlessBenchmark = wcscmp(args[i], L"-benchmark") == 0;
+			renderBenchmark = !headlessBenchmark;
+		}
+	}
+	LocalFree(args);
+
+	if (headlessBenchmark || renderBenchmark)
+		Window::CreateConsoleWindow(500, 120, 32, 120);
+	if (headlessBenchmark)
+		return SceneBenchmark::RunHeadless(benchmarkSettings, benchmarkFile) ? 0 : 1;
+
 	// Set up app initialization details
 	unsigned int windowWidth = 1280;
 	unsigned int windowHeight = 720;
@@ -59,6 +115,13 @@ int WINAPI WinMain(
 
 	// The main application object
 	game = new Game();
+	game->SetPrintStats(printStats);
+	if (renderBenchmark)
+	{
+		game->SetRandomSeed(benchmarkSettings.seed);
+		benchmarkSettings.viewportWidth = windowWidth;
+		benchmarkSettings.viewportHeight = windowHeight;
+	}
 
 	// Create the window and verify
 	HRESULT windowResult = Window::Create(
@@ -72,19 +135,28 @@ int WINAPI WinMain(
 		return windowResult;
 
 	// Initialize the graphics API and verify
+	Graphics::SetFramePacing(framesInFlight, maxFrameLatency);
 	HRESULT graphicsResult = Graphics::Initialize(
 		Window::Width(), 
 		Window::Height(), 
 		Window::Handle(),
 		vsync);
 	if (FAILED(graphicsResult))
+	{
+		// With no device to render with, a benchmark falls back to the null backend
+		if (renderBenchmark)
+			return SceneBenchmark::RunHeadless(benchmarkSettings, benchmarkFile) ? 0 : 1;
 		return graphicsResult;
+	}
+	if (!frameCsvFile.empty())
+		Graphics::StartFrameCapture(frameCsvFile);
 
 	// Initalize the input system, which requires the window handle
 	Input::Initialize(Window::Handle());
 
 	// Now the game itself can be initialzied
 	game->Initialize();
+	CpuZones::SetThreadName("Main");
 
 	// Time tracking
 	LARGE_INTEGER perfFreq{};
@@ -102,6 +174,10 @@ int WINAPI WinMain(
 	currentTime = startTime;
 	previousTime = startTime;
 
+	// Benchmark runs record every frame after the warm-up
+	BenchmarkRecorder benchmarkRecorder;
+	unsigned int benchmarkFrame = 0;
+
 	// Windows message loop (and our game loop)
 	MSG msg = {};
 	while (msg.message != WM_QUIT)
@@ -122,18 +198,58 @@ int WINAPI WinMain(
 			float totalTime = (float)((currentTime - startTime) * perfSeconds);
 			previousTime = currentTime;
 
+			// Benchmarks step by a fixed delta, however long frames really take
+			bool recordingBenchmark = false;
+			if (renderBenchmark)
+			{
+				benchmarkFrame++;
+				deltaTime = (float)benchmarkSettings.deltaTime;
+				totalTime = (float)(benchmarkFrame * benchmarkSettings.deltaTime);
+				recordingBenchmark = benchmarkFrame > benchmarkSettings.warmupFrames;
+				if (recordingBenchmark)
+					benchmarkRecorder.BeginFrame();
+			}
+
 			// Calculate basic fps
 			Window::UpdateStats(totalTime);
 
 			// Input updating
-			Input::Update();
+			{
+				CPU_ZONE("Input::Update");
+				Input::Update();
+			}
 
 			// Update and draw
-			game->Update(deltaTime, totalTime);
-			game->Draw(deltaTime, totalTime);
+			{
+				CPU_ZONE("Game::Update");
+				game->Update(deltaTime, totalTime);
+			}
+			{
+				CPU_ZONE("Game::Draw");
+				game->Draw(deltaTime, totalTime);
+			}
 
-			// Notify Input system about end of frame
+			// Notify Input system about end of frame, and
+			// collect every thread's zones for this one
 			Input::EndOfFrame();
+			if (recordingBenchmark)
+				benchmarkRecorder.EndFrame();
+			else
+				CpuZones::EndFrame();
+
+			// Report once every benchmark frame is done, and quit
+			if (recordingBenchmark && benchmarkRecorder.GetFrameCount() >= benchmarkSettings.frames)
+			{
+				benchmarkRecorder.SetGpuTimes(Graphics::GetFrameStats(0).gpuTime);
+				benchmarkRecorder.PrintSummary();
+				if (benchmarkRecorder.WriteJson(benchmarkFile, "d3d12", benchmarkSettings))
+					printf("Benchmark: wrote %ls\n", benchmarkFile.c_str());
+				else
+					printf("Benchmark: couldn't write %ls\n", benchmarkFile.c_str());
+
+				renderBenchmark = false;
+				Window::Quit();
+			}
 
 #if defined(DEBUG) || defined(_DEBUG)
 			// Print any graphics debug messages that occurred this frame
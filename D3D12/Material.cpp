@@ -15,6 +15,15 @@ Material::Material(Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineState,
 	finalGPUHandleForSRVs = {};
 }
 
+Material::~Material()
+{
+	if (ready && bindless)
+	{
+		for (int i = 0; i < maxTextures; i++)
+			Graphics::RemoveBindlessTexture(bindlessTextureIndices[i]);
+	}
+}
+
 DirectX::XMFLOAT3 Material::GetColorTint()
 {
 	return colorTint;
@@ -30,10 +39,11 @@ DirectX::XMFLOAT2 Material::GetUVOffset()
 
 D3D12_GPU_DESCRIPTOR_HANDLE Material::GetFinalGPUHandleForSRVs()
 {
-	return finalGPUHandleForSRVs;
+	// each frame in flight has its own copy of the texture descriptors
+	return Graphics::GetFrameTextureTable(finalGPUHandleForSRVs);
 }
 
-Microsoft::WRL::ComPtr<ID3D12PipelineState> Material::GetPipelineState()
+const Microsoft::WRL::ComPtr<ID3D12PipelineState>& Material::GetPipelineState()
 {
 	return pipelineState;
 }
@@ -44,17 +54,82 @@ void Material::AddTexture(D3D12_CPU_DESCRIPTOR_HANDLE srv, int slot)
 	textureSRVsBySlot[slot] = srv;
 }
 
-void Material::FinalizeMaterial()
+void Material::RequestTextureDetail(float screenPixels)
+{
+	// Tiling the texture more times needs more of its texels
+	float scale = uvScale.x > uvScale.y ? uvScale.x : uvScale.y;
+	for (int i = 0; i < maxTextures; i++)
+		Graphics::RequestTextureDetail(textureSRVsBySlot[i], screenPixels * scale);
+}
+
+MaterialGPUData Material::GetGPUData()
+{
+	MaterialGPUData data = {};
+	data.albedoIndex = bindlessTextureIndices[0];
+	data.normalIndex = bindlessTextureIndices[1];
+	data.metalIndex = bindlessTextureIndices[2];
+	data.roughnessIndex = bindlessTextureIndices[3];
+	data.uvScale = uvScale;
+	data.uvOffset = uvOffset;
+	return data;
+}
+
+unsigned int Material::GetMaterialIndex()
+{
+	return materialIndex;
+}
+
+void Material::SetMaterialIndex(unsigned int index)
+{
+	materialIndex = index;
+}
+
+bool Material::IsReady()
+{
+	return ready;
+}
+
+bool Material::FinalizeMaterial(bool bindless)
 {
 	if (!finalized) // only finalize once
 	{
 		finalized = true;
+		this->bindless = bindless;
 
-		// save the first GPU descriptor handle here
+		// a texture that failed to load has no SRV to copy
+		for (int i = 0; i < maxTextures; i++)
+		{
+			if (textureSRVsBySlot[i].ptr == 0)
+				return false;
+		}
+
+		// each texture gets a slot of its own, found by index in the shader
+		if (bindless)
+		{
+			for (int i = 0; i < maxTextures; i++)
+			{
+				if (!Graphics::AddBindlessTexture(textureSRVsBySlot[i], bindlessTextureIndices[i]))
+				{
+					// give back the slots this material did get
+					for (int j = 0; j < i; j++)
+						Graphics::RemoveBindlessTexture(bindlessTextureIndices[j]);
+					return false;
+				}
+			}
+			ready = true;
+			return true;
+		}
+
+		// save the first GPU descriptor handle here (the rest follow it)
 		finalGPUHandleForSRVs = Graphics::CopySRVsToDescriptorHeapAndGetGPUDescriptorHandle(textureSRVsBySlot[0], 1);
+		if (finalGPUHandleForSRVs.ptr == 0)
+			return false;
 		for (int i = 1; i < maxTextures; i++)
 		{
-			Graphics::CopySRVsToDescriptorHeapAndGetGPUDescriptorHandle(textureSRVsBySlot[i], 1);
+			if (Graphics::CopySRVsToDescriptorHeapAndGetGPUDescriptorHandle(textureSRVsBySlot[i], 1).ptr == 0)
+				return false;
 		}
+		ready = true;
 	}
-}
\ No newline at end of file
+	return ready;
+}
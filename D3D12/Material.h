@@ -4,6 +4,8 @@
 #include <wrl/client.h>
 #include <DirectXMath.h>
 
+#include "BufferStructs.h"
+
 class Material
 {
 public:
@@ -12,15 +14,34 @@ public:
 		DirectX::XMFLOAT3 colorTint,
 		DirectX::XMFLOAT2 uvScale,
 		DirectX::XMFLOAT2 uvOffset);
+	~Material();
+	Material(const Material&) = delete;
+	Material& operator=(const Material&) = delete;
 
 	DirectX::XMFLOAT3 GetColorTint();
 	DirectX::XMFLOAT2 GetUVScale();
 	DirectX::XMFLOAT2 GetUVOffset();
 
 	D3D12_GPU_DESCRIPTOR_HANDLE GetFinalGPUHandleForSRVs();
-	Microsoft::WRL::ComPtr<ID3D12PipelineState> GetPipelineState();
+	const Microsoft::WRL::ComPtr<ID3D12PipelineState>& GetPipelineState();
 	void AddTexture(D3D12_CPU_DESCRIPTOR_HANDLE srv, int slot);
-	void FinalizeMaterial();
+
+	// Asks for enough texture detail (for streamed textures) to
+	// cover about screenPixels across the screen
+	void RequestTextureDetail(float screenPixels);
+
+	// Copies the textures' SRVs into the shader-visible heap, either as
+	// one contiguous table or (bindless) as individual texture slots.
+	// Fails if a texture didn't load or there's no room left, in which
+	// case the material isn't ready and nothing should draw with it.
+	bool FinalizeMaterial(bool bindless = false);
+	bool IsReady();
+
+	// Bindless only: this material's entry in the material buffer,
+	// and where in that buffer it lives (set by whoever builds it)
+	MaterialGPUData GetGPUData();
+	unsigned int GetMaterialIndex();
+	void SetMaterialIndex(unsigned int index);
 	
 private:
 
@@ -29,9 +50,14 @@ private:
 	DirectX::XMFLOAT2 uvOffset;
 
 	bool finalized = false;
+	bool ready = false;
 	Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineState; // replaces VS and PS in D3D11
 	int maxTextures = 4;
 	D3D12_CPU_DESCRIPTOR_HANDLE textureSRVsBySlot[4] {};
 	D3D12_GPU_DESCRIPTOR_HANDLE finalGPUHandleForSRVs {};
+
+	bool bindless = false;
+	unsigned int bindlessTextureIndices[4] {};
+	unsigned int materialIndex = 0;
 };
 
@@ -1,11 +1,18 @@
 #include "Mesh.h"
 
 #include "Graphics.h"
-#include <iostream>
-#include <fstream>
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "ObjLoader.h"
+#include "Tangents.h"
+
+#include <cstdio>
 
 using namespace DirectX;
 
+bool Mesh::printLoadStats = false;
+
 Mesh::Mesh()
 {
 	this->indexCount = 0;
@@ -16,344 +23,208 @@ Mesh::Mesh(Vertex* vertices,
 	unsigned int* indices,
 	unsigned int numIndices, bool dynamic)
 {
-	for (unsigned int i = 0; i < numVerts; i++)
-		this->vertices.push_back(vertices[i]);
+	CalculateBounds(vertices, numVerts);
 
-	CreateBuffers(indices, numIndices);
+	std::vector<PackedVertex> packed(numVerts);
+	quantization = VertexPacking::ComputeQuantization(boundsMin, boundsMax);
+	VertexPacking::EncodeAll(vertices, numVerts, quantization, packed.data());
+	CreateBuffers(packed.data(), numVerts, indices, numIndices);
 }
 
-Mesh::Mesh(const wchar_t* fileName,bool dynamic)
+Mesh::Mesh(const wchar_t* fileName, bool dynamic, float weldEpsilon, bool optimize, bool generateLods)
 {
 	this->indexCount = 0;
-	// Author: Chris Cascioli
-	// Purpose: Basic .OBJ 3D model loading, supporting positions, uvs and normals
-	// 
-	// - You are allowed to directly copy/paste this into your code base
-	//   for assignments, given that you clearly cite that this is not
-	//   code of your own design.
-	//
-	// - NOTE: You'll need to #include <fstream>
 
+	// Hash the source so we can tell if its cached copy is still valid.
+	// The processing settings change the output, so they're part of the hash too.
+	MappedFile source(fileName);
+	if (!source.IsOpen())
+		return;
 
-	// File input object
-	std::ifstream obj(fileName);
+	unsigned long long sourceSize = source.GetSize();
+	unsigned long long sourceHash = MeshCache::HashSource(source.GetData(), source.GetSize(), weldEpsilon, optimize, generateLods);
+	source.Close();
 
-	// Check for successful open
-	if (!obj.is_open())
+	// Fast path: hand the memory-mapped cache straight to buffer creation
+	std::wstring cachePath = MeshCache::GetCachePath(fileName);
+	MappedFile cacheFile;
+	MeshCache::View cached;
+	if (MeshCache::Open(cachePath.c_str(), sourceHash, sourceSize, cacheFile, cached))
+	{
+		boundsMin = cached.boundsMin;
+		boundsMax = cached.boundsMax;
+		boundsRadius = cached.boundsRadius;
+		quantization = cached.quantization;
+		subMeshes.assign(cached.subMeshes, cached.subMeshes + cached.subMeshCount);
+		materialNames = cached.materialNames;
+		lods.assign(cached.lods, cached.lods + cached.lodCount);
+		meshlets.meshlets.assign(cached.meshlets, cached.meshlets + cached.meshletCount);
+		meshlets.vertices.assign(cached.meshletVertices, cached.meshletVertices + cached.meshletVertexCount);
+		meshlets.triangles.assign(cached.meshletTriangles, cached.meshletTriangles + cached.meshletTriangleBytes);
+		CreateBuffers(cached.vertices, cached.vertexCount, cached.indices, cached.indexCount);
+
+		if (printLoadStats)
+			printf("Loaded %ls from cache (%u vertices, %u indices, %u sub-meshes, %u LODs, %u meshlets)\n",
+				cachePath.c_str(), cached.vertexCount, cached.indexCount, cached.subMeshCount, cached.lodCount, cached.meshletCount);
 		return;
+	}
 
-	// Variables used while reading the file
-	std::vector<XMFLOAT3> positions;	// Positions from the file
-	std::vector<XMFLOAT3> normals;		// Normals from the file
-	std::vector<XMFLOAT2> uvs;		// UVs from the file
-	std::vector<Vertex> verts;		// Verts we're assembling
-	std::vector<UINT> indices;		// Indices of these verts
-	int vertCounter = 0;			// Count of vertices
-	int indexCounter = 0;			// Count of indices
-	char chars[100];			// String for line reading
-
-	// Still have data left?
-	while (obj.good())
-	{
-		// Get the line (100 characters should be more than enough)
-		obj.getline(chars, 100);
+	// Memory-map and parse the file (see ObjLoader.cpp), welding
+	// shared corners so the index buffer actually shares vertices.
+	// Every group and material comes back as its own sub-mesh.
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	if (!ObjLoader::LoadFile(fileName, verts, indices, subMeshes, materialNames, weldEpsilon, printLoadStats) || indices.empty())
+		return;
 
-		// Check the type of line
-		if (chars[0] == 'v' && chars[1] == 'n')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 norm;
-			sscanf_s(
-				chars,
-				"vn %f %f %f",
-				&norm.x, &norm.y, &norm.z);
-
-			// Add to the list of normals
-			normals.push_back(norm);
-		}
-		else if (chars[0] == 'v' && chars[1] == 't')
-		{
-			// Read the 2 numbers directly into an XMFLOAT2
-			XMFLOAT2 uv;
-			sscanf_s(
-				chars,
-				"vt %f %f",
-				&uv.x, &uv.y);
-
-			// Add to the list of uv's
-			uvs.push_back(uv);
-		}
-		else if (chars[0] == 'v')
+	// Optionally reorder triangles and vertices for the GPU's caches
+	// (see MeshOptimizer.cpp), reporting ACMR/ATVR if stats are on
+	if (optimize)
+		MeshOptimizer::Optimize(verts, indices, subMeshes, printLoadStats);
+
+	// calculate vertex tangents (and handedness) before creating buffers,
+	// now that they can accumulate across triangles that share a vertex
+	Tangents::Calculate(&verts[0], verts.size(), &indices[0], indices.size());
+	CalculateBounds(&verts[0], (unsigned int)verts.size());
+
+	for (SubMesh& subMesh : subMeshes)
+	{
+		// Append simplified versions of the sub-mesh's triangles to the
+		// index array (see MeshSimplifier.cpp), all sharing the same vertices
+		std::vector<MeshLod> chain;
+		if (generateLods)
 		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 pos;
-			sscanf_s(
-				chars,
-				"v %f %f %f",
-				&pos.x, &pos.y, &pos.z);
-
-			// Add to the positions
-			positions.push_back(pos);
+			chain = MeshSimplifier::BuildLodChain(&verts[0], verts.size(), indices,
+				subMesh.indexOffset, subMesh.indexCount,
+				MeshSimplifier::DefaultLodTargets, _countof(MeshSimplifier::DefaultLodTargets));
+			if (printLoadStats)
+				MeshSimplifier::PrintLodChain(chain);
 		}
-		else if (chars[0] == 'f')
+		else
 		{
-			// Read the face indices into an array
-			// NOTE: This assumes the given obj file contains
-			//  vertex positions, uv coordinates AND normals.
-			unsigned int i[12];
-			int numbersRead = sscanf_s(
-				chars,
-				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
-				&i[0], &i[1], &i[2],
-				&i[3], &i[4], &i[5],
-				&i[6], &i[7], &i[8],
-				&i[9], &i[10], &i[11]);
-
-			// If we only got the first number, chances are the OBJ
-			// file has no UV coordinates.  This isn't great, but we
-			// still want to load the model without crashing, so we
-			// need to re-read a different pattern (in which we assume
-			// there are no UVs denoted for any of the vertices)
-			if (numbersRead == 1)
-			{
-				// Re-read with a different pattern
-				numbersRead = sscanf_s(
-					chars,
-					"f %d//%d %d//%d %d//%d %d//%d",
-					&i[0], &i[2],
-					&i[3], &i[5],
-					&i[6], &i[8],
-					&i[9], &i[11]);
-
-				// The following indices are where the UVs should 
-				// have been, so give them a valid value
-				i[1] = 1;
-				i[4] = 1;
-				i[7] = 1;
-				i[10] = 1;
-
-				// If we have no UVs, create a single UV coordinate
-				// that will be used for all vertices
-				if (uvs.size() == 0)
-					uvs.push_back(XMFLOAT2(0, 0));
-			}
-
-			// - Create the verts by looking up
-			//    corresponding data from vectors
-			// - OBJ File indices are 1-based, so
-			//    they need to be adusted
-			Vertex v1;
-			v1.Position = positions[i[0] - 1];
-			v1.UV = uvs[i[1] - 1];
-			v1.Normal = normals[i[2] - 1];
-
-			Vertex v2;
-			v2.Position = positions[i[3] - 1];
-			v2.UV = uvs[i[4] - 1];
-			v2.Normal = normals[i[5] - 1];
-
-			Vertex v3;
-			v3.Position = positions[i[6] - 1];
-			v3.UV = uvs[i[7] - 1];
-			v3.Normal = normals[i[8] - 1];
-
-			// The model is most likely in a right-handed space,
-			// especially if it came from Maya.  We want to convert
-			// to a left-handed space for DirectX.  This means we 
-			// need to:
-			//  - Invert the Z position
-			//  - Invert the normal's Z
-			//  - Flip the winding order
-			// We also need to flip the UV coordinate since DirectX
-			// defines (0,0) as the top left of the texture, and many
-			// 3D modeling packages use the bottom left as (0,0)
-
-			// Flip the UV's since they're probably "upside down"
-			v1.UV.y = 1.0f - v1.UV.y;
-			v2.UV.y = 1.0f - v2.UV.y;
-			v3.UV.y = 1.0f - v3.UV.y;
-
-			// Flip Z (LH vs. RH)
-			v1.Position.z *= -1.0f;
-			v2.Position.z *= -1.0f;
-			v3.Position.z *= -1.0f;
-
-			// Flip normal's Z
-			v1.Normal.z *= -1.0f;
-			v2.Normal.z *= -1.0f;
-			v3.Normal.z *= -1.0f;
-
-			// Add the verts to the vector (flipping the winding order)
-			verts.push_back(v1);
-			verts.push_back(v3);
-			verts.push_back(v2);
-			vertCounter += 3;
-
-			// Add three more indices
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-
-			// Was there a 4th face?
-			// - 12 numbers read means 4 faces WITH uv's
-			// - 8 numbers read means 4 faces WITHOUT uv's
-			if (numbersRead == 12 || numbersRead == 8)
-			{
-				// Make the last vertex
-				Vertex v4;
-				v4.Position = positions[i[9] - 1];
-				v4.UV = uvs[i[10] - 1];
-				v4.Normal = normals[i[11] - 1];
-
-				// Flip the UV, Z pos and normal's Z
-				v4.UV.y = 1.0f - v4.UV.y;
-				v4.Position.z *= -1.0f;
-				v4.Normal.z *= -1.0f;
-
-				// Add a whole triangle (flipping the winding order)
-				verts.push_back(v1);
-				verts.push_back(v4);
-				verts.push_back(v3);
-				vertCounter += 3;
-
-				// Add three more indices
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
-			}
+			MeshLod full = { subMesh.indexOffset, subMesh.indexCount, 0.0f };
+			chain.push_back(full);
 		}
+
+		subMesh.lodOffset = (unsigned int)lods.size();
+		subMesh.lodCount = (unsigned int)chain.size();
+		lods.insert(lods.end(), chain.begin(), chain.end());
+
+		// Dense sub-meshes also get split into meshlets (see Meshlets.cpp),
+		// so parts of them facing away or off screen can be skipped
+		subMesh.meshletOffset = (unsigned int)meshlets.meshlets.size();
+		if (subMesh.indexCount / 3 >= Meshlets::MinTriangles)
+			Meshlets::Build(&verts[0], verts.size(), &indices[subMesh.indexOffset], subMesh.indexCount, meshlets);
+		subMesh.meshletCount = (unsigned int)meshlets.meshlets.size() - subMesh.meshletOffset;
 	}
 
-	// Close the file and create the actual buffers
-	obj.close();
-	this->vertices = verts;
+	if (printLoadStats && !meshlets.meshlets.empty())
+		printf("Built %zu meshlets\n", meshlets.meshlets.size());
 
-	// calculate vertex tangents before creating buffers
-	CalculateTangents(&verts[0], vertCounter, &indices[0], indexCounter);
-	CreateBuffers(&indices[0], indexCounter);
+	// Pack the vertices for the GPU (see VertexPacking.h), relative to the bounding box
+	std::vector<PackedVertex> packed(verts.size());
+	quantization = VertexPacking::ComputeQuantization(boundsMin, boundsMax);
+	VertexPacking::EncodeAll(&verts[0], verts.size(), quantization, packed.data());
+
+	// Save the final arrays so the next run can skip all of the above
+	if (!MeshCache::Write(cachePath.c_str(), sourceHash, sourceSize,
+		packed.data(), (unsigned int)packed.size(), quantization, &indices[0], (unsigned int)indices.size(),
+		&lods[0], (unsigned int)lods.size(), meshlets,
+		&subMeshes[0], (unsigned int)subMeshes.size(), materialNames,
+		boundsMin, boundsMax, boundsRadius))
+	{
+		printf("Failed to write mesh cache %ls\n", cachePath.c_str());
+	}
+
+	CreateBuffers(packed.data(), (unsigned int)packed.size(), &indices[0], (unsigned int)indices.size());
 }
 
 // --------------------------------------------------------
-// Author: Chris Cascioli
-// Purpose: Calculates the tangents of the vertices in a mesh
-// 
-// - You are allowed to directly copy/paste this into your code base
-//   for assignments, given that you clearly cite that this is not
-//   code of your own design.
-//
-// - Code originally adapted from: http://www.terathon.com/code/tangent.html
-//   - Updated version now found here: http://foundationsofgameenginedev.com/FGED2-sample.pdf
-//   - See listing 7.4 in section 7.5 (page 9 of the PDF)
-//
-// - Note: For this code to work, your Vertex format must
-//         contain an XMFLOAT3 called Tangent
-//
-// - Be sure to call this BEFORE creating your D3D vertex/index buffers
+// Finds the object-space bounding box of the given vertices,
+// and the smallest sphere around the box's center that
+// still holds all of them
 // --------------------------------------------------------
-void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
+void Mesh::CalculateBounds(const Vertex* verts, unsigned int numVerts)
 {
-	// Reset tangents
-	for (int i = 0; i < numVerts; i++)
+	if (numVerts == 0)
 	{
-		verts[i].Tangent = XMFLOAT3(0, 0, 0);
+		boundsMin = boundsMax = XMFLOAT3(0, 0, 0);
+		boundsRadius = 0.0f;
+		return;
 	}
 
-	// Calculate tangents one whole triangle at a time
-	for (int i = 0; i < numIndices;)
+	XMVECTOR minV = XMLoadFloat3(&verts[0].Position);
+	XMVECTOR maxV = minV;
+	for (unsigned int i = 1; i < numVerts; i++)
 	{
-		// Grab indices and vertices of first triangle
-		unsigned int i1 = indices[i++];
-		unsigned int i2 = indices[i++];
-		unsigned int i3 = indices[i++];
-		Vertex* v1 = &verts[i1];
-		Vertex* v2 = &verts[i2];
-		Vertex* v3 = &verts[i3];
-
-		// Calculate vectors relative to triangle positions
-		float x1 = v2->Position.x - v1->Position.x;
-		float y1 = v2->Position.y - v1->Position.y;
-		float z1 = v2->Position.z - v1->Position.z;
-
-		float x2 = v3->Position.x - v1->Position.x;
-		float y2 = v3->Position.y - v1->Position.y;
-		float z2 = v3->Position.z - v1->Position.z;
-
-		// Do the same for vectors relative to triangle uv's
-		float s1 = v2->UV.x - v1->UV.x;
-		float t1 = v2->UV.y - v1->UV.y;
-
-		float s2 = v3->UV.x - v1->UV.x;
-		float t2 = v3->UV.y - v1->UV.y;
-
-		// Create vectors for tangent calculation
-		float r = 1.0f / (s1 * t2 - s2 * t1);
-
-		float tx = (t2 * x1 - t1 * x2) * r;
-		float ty = (t2 * y1 - t1 * y2) * r;
-		float tz = (t2 * z1 - t1 * z2) * r;
-
-		// Adjust tangents of each vert of the triangle
-		v1->Tangent.x += tx;
-		v1->Tangent.y += ty;
-		v1->Tangent.z += tz;
-
-		v2->Tangent.x += tx;
-		v2->Tangent.y += ty;
-		v2->Tangent.z += tz;
-
-		v3->Tangent.x += tx;
-		v3->Tangent.y += ty;
-		v3->Tangent.z += tz;
+		XMVECTOR pos = XMLoadFloat3(&verts[i].Position);
+		minV = XMVectorMin(minV, pos);
+		maxV = XMVectorMax(maxV, pos);
 	}
 
-	// Ensure all of the tangents are orthogonal to the normals
-	for (int i = 0; i < numVerts; i++)
-	{
-		// Grab the two vectors
-		XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
-		XMVECTOR tangent = XMLoadFloat3(&verts[i].Tangent);
-
-		// Use Gram-Schmidt orthonormalize to ensure
-		// the normal and tangent are exactly 90 degrees apart
-		tangent = XMVector3Normalize(
-			tangent - normal * XMVector3Dot(normal, tangent));
+	XMStoreFloat3(&boundsMin, minV);
+	XMStoreFloat3(&boundsMax, maxV);
 
-		// Store the tangent
-		XMStoreFloat3(&verts[i].Tangent, tangent);
-	}
+	XMVECTOR center = (minV + maxV) * 0.5f;
+	XMVECTOR maxLengthSq = XMVectorZero();
+	for (unsigned int i = 0; i < numVerts; i++)
+		maxLengthSq = XMVectorMax(maxLengthSq, XMVector3LengthSq(XMLoadFloat3(&verts[i].Position) - center));
+	boundsRadius = sqrtf(XMVectorGetX(maxLengthSq));
 }
 
-void Mesh::CreateBuffers(unsigned int* indices, unsigned int numIndices)
+// --------------------------------------------------------
+// Uploads the already packed vertices (see VertexPacking.h)
+// along with the indices. The quantization they were packed
+// with must already be set.
+// Without sub-meshes, all of the indices are LOD 0 of a
+// single sub-mesh using material slot 0.
+// --------------------------------------------------------
+void Mesh::CreateBuffers(const PackedVertex* verts, unsigned int numVerts, const unsigned int* indices, unsigned int numIndices)
 {
-	this->indexCount = numIndices;
+	if (subMeshes.empty())
+	{
+		MeshLod full = { 0, numIndices, 0.0f };
+		lods.assign(1, full);
+
+		SubMesh whole = { 0, numIndices, 0, 1, 0, 0, 0 };
+		subMeshes.push_back(whole);
+		materialNames.assign(1, std::string());
+	}
+
+	this->indexCount = 0;
+	for (const SubMesh& subMesh : subMeshes)
+		this->indexCount += subMesh.indexCount;
 
 	// set up buffers
-	vertexBuffer = Graphics::CreateStaticBuffer(sizeof(Vertex), this->vertices.size(), &this->vertices[0]);
-	indexBuffer = Graphics::CreateStaticBuffer(sizeof(unsigned int), this->indexCount, indices);
+	vertexBuffer = Graphics::CreateStaticBuffer(sizeof(PackedVertex), numVerts, verts);
+	indexBuffer = Graphics::CreateStaticBuffer(sizeof(unsigned int), numIndices, indices);
 
 	// Set up views
-	vbView.StrideInBytes = sizeof(Vertex);
-	vbView.SizeInBytes = sizeof(Vertex) * (UINT)this->vertices.size();
-	vbView.BufferLocation = vertexBuffer->GetGPUVirtualAddress();
+	vbView.StrideInBytes = sizeof(PackedVertex);
+	vbView.SizeInBytes = sizeof(PackedVertex) * numVerts;
+	vbView.BufferLocation = vertexBuffer.resource->GetGPUVirtualAddress() + vertexBuffer.offset;
 
 	ibView.Format = DXGI_FORMAT_R32_UINT;
-	ibView.SizeInBytes = sizeof(unsigned int) * this->indexCount;
-	ibView.BufferLocation = indexBuffer->GetGPUVirtualAddress();
+	ibView.SizeInBytes = sizeof(unsigned int) * numIndices;
+	ibView.BufferLocation = indexBuffer.resource->GetGPUVirtualAddress() + indexBuffer.offset;
 }
 
 Mesh::~Mesh()
 {
-	// For now, this is empty, as smart pointers are doing the cleanup
+	// The buffers live in shared GPU heaps, which get their space back
+	// once the GPU is done with them
+	Graphics::FreeGpuMemory(vertexBuffer);
+	Graphics::FreeGpuMemory(indexBuffer);
 }
 
 Microsoft::WRL::ComPtr<ID3D12Resource> Mesh::GetVertexBuffer()
 {
-	return vertexBuffer;
+	return vertexBuffer.resource;
 }
 
 Microsoft::WRL::ComPtr<ID3D12Resource> Mesh::GetIndexBuffer()
 {
-	return indexBuffer;
+	return indexBuffer.resource;
 }
 
 D3D12_VERTEX_BUFFER_VIEW Mesh::GetVertexBufferView()
@@ -369,4 +240,61 @@ D3D12_INDEX_BUFFER_VIEW Mesh::GetIndexBufferView()
 unsigned int Mesh::GetIndexCount()
 {
 	return indexCount;
-}
\ No newline at end of file
+}
+
+DirectX::XMFLOAT3 Mesh::GetBoundsMin()
+{
+	return boundsMin;
+}
+
+DirectX::XMFLOAT3 Mesh::GetBoundsMax()
+{
+	return boundsMax;
+}
+
+PositionQuantization Mesh::GetPositionQuantization()
+{
+	return quantization;
+}
+
+DirectX::XMFLOAT3 Mesh::GetBoundsCenter()
+{
+	return XMFLOAT3(
+		(boundsMin.x + boundsMax.x) * 0.5f,
+		(boundsMin.y + boundsMax.y) * 0.5f,
+		(boundsMin.z + boundsMax.z) * 0.5f);
+}
+
+float Mesh::GetBoundsRadius()
+{
+	return boundsRadius;
+}
+
+const std::vector<SubMesh>& Mesh::GetSubMeshes()
+{
+	return subMeshes;
+}
+
+const std::vector<std::string>& Mesh::GetMaterialNames()
+{
+	return materialNames;
+}
+
+const std::vector<MeshLod>& Mesh::GetLods()
+{
+	return lods;
+}
+
+const MeshletData& Mesh::GetMeshlets()
+{
+	return meshlets;
+}
+void Mesh::SetPrintLoadStats(bool print)
+{
+	printLoadStats = print;
+}
+
+bool Mesh::GetPrintLoadStats()
+{
+	return printLoadStats;
+}
@@ -2,32 +2,57 @@
 
 #include <d3d12.h>
 #include <wrl/client.h>
+#include <string>
 #include <vector>
+#include "GpuMemory.h"
+#include "Meshlets.h"
+#include "MeshSimplifier.h"
+#include "SubMesh.h"
 #include "Vertex.h"
+#include "VertexPacking.h"
 
 class Mesh
 {
 private:
 
-	// Vertex and index buffers, context pointer
-	Microsoft::WRL::ComPtr<ID3D12Resource> vertexBuffer;
+	// Vertex and index buffers (which may share a resource with other meshes)
+	GpuAllocation vertexBuffer;
 	D3D12_VERTEX_BUFFER_VIEW vbView{};
-	Microsoft::WRL::ComPtr<ID3D12Resource> indexBuffer;
+	GpuAllocation indexBuffer;
 	D3D12_INDEX_BUFFER_VIEW ibView{};
 
+	// Object-space bounding box, and a sphere around its center
+	DirectX::XMFLOAT3 boundsMin{};
+	DirectX::XMFLOAT3 boundsMax{};
+	float boundsRadius = 0.0f;
+
+	// Parts drawn with their own materials, all sharing the buffers above
+	std::vector<SubMesh> subMeshes;
+	std::vector<std::string> materialNames;
+
+	// Ranges of the index buffer, from full resolution down (each sub-mesh has its own run of these)
+	std::vector<MeshLod> lods;
+
+	// LOD 0 split into clusters that can be culled on their own (dense sub-meshes only)
+	MeshletData meshlets;
+
+	// How the packed vertex positions map back into object space
+	PositionQuantization quantization{};
+
+	// Whether loading a file reports what each step did
+	static bool printLoadStats;
+
 protected:
 
-	// Hold num indices in index buffer
+	// Hold num indices in LOD 0 of every sub-mesh
 	unsigned int indexCount;
 
-	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
+	void CalculateBounds(const Vertex* verts, unsigned int numVerts);
 
-	void CreateBuffers(unsigned int* indices, unsigned int numIndices);
+	void CreateBuffers(const PackedVertex* verts, unsigned int numVerts, const unsigned int* indices, unsigned int numIndices);
 
 public:
 
-	std::vector<Vertex> vertices;
-
 	Mesh();
 
 	Mesh(Vertex* vertices,
@@ -35,14 +60,32 @@ public:
 		unsigned int* indices,
 		unsigned int numIndices, bool dynamic = false);
 
-	Mesh(const wchar_t* fileName, bool dynamic = false);
+	Mesh(const wchar_t* fileName, bool dynamic = false, float weldEpsilon = 0.0f, bool optimize = true, bool generateLods = true);
 
 	~Mesh();
 
+	// Meshes free their buffers' GPU memory, so they can't be copied
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
+
 	Microsoft::WRL::ComPtr<ID3D12Resource> GetVertexBuffer();
 	Microsoft::WRL::ComPtr<ID3D12Resource> GetIndexBuffer();
 	D3D12_VERTEX_BUFFER_VIEW GetVertexBufferView();
 	D3D12_INDEX_BUFFER_VIEW GetIndexBufferView();
 	unsigned int GetIndexCount();
+	DirectX::XMFLOAT3 GetBoundsMin();
+	DirectX::XMFLOAT3 GetBoundsMax();
+	DirectX::XMFLOAT3 GetBoundsCenter();
+	float GetBoundsRadius();
+	const std::vector<SubMesh>& GetSubMeshes();
+	const std::vector<std::string>& GetMaterialNames();
+	const std::vector<MeshLod>& GetLods();
+	const MeshletData& GetMeshlets();
+	PositionQuantization GetPositionQuantization();
+
+	// Print what loading each file does (parsing, welding, the cache and the
+	// other processing steps) to the console. Off unless turned on.
+	static void SetPrintLoadStats(bool print);
+	static bool GetPrintLoadStats();
 
 };
\ No newline at end of file
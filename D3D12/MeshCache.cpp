@@ -0,0 +1,358 @@
+#include "MeshCache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <system_error>
+#include <thread>
+
+namespace MeshCache
+{
+	// Annonymous namespace to hold helpers
+	// only accessible in this file
+	namespace
+	{
+		const char Magic[4] = { 'M', 'E', 'S', 'H' };
+
+		inline unsigned long long AlignUp(unsigned long long value, unsigned long long alignment)
+		{
+			return (value + alignment - 1) / alignment * alignment;
+		}
+
+		inline unsigned long long Mix(unsigned long long h)
+		{
+			h ^= h >> 33;
+			h *= 0xFF51AFD7ED558CCDull;
+			h ^= h >> 33;
+			h *= 0xC4CEB9FE1A85EC53ull;
+			h ^= h >> 33;
+			return h;
+		}
+
+		FILE* OpenForWriting(const wchar_t* fileName)
+		{
+			FILE* file = 0;
+#ifdef _WIN32
+			_wfopen_s(&file, fileName, L"wb");
+#else
+			std::string narrowName(wcstombs(0, fileName, 0), '\0');
+			wcstombs(&narrowName[0], fileName, narrowName.size());
+			file = fopen(narrowName.c_str(), "wb");
+#endif
+			return file;
+		}
+
+		// A name next to the cache that no other writer (thread or
+		// process) will pick at the same moment
+		std::wstring TempPath(const wchar_t* cachePath)
+		{
+			unsigned long long unique[3] =
+			{
+				(unsigned long long)std::chrono::steady_clock::now().time_since_epoch().count(),
+				(unsigned long long)std::hash<std::thread::id>()(std::this_thread::get_id()),
+				(unsigned long long)(size_t)&unique
+			};
+
+			wchar_t suffix[32];
+			swprintf(suffix, 32, L".%016llx.tmp", HashBytes(unique, sizeof(unique)));
+			return std::wstring(cachePath) + suffix;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Swaps the source file's extension for .mesh, so
+// "Assets/cube.obj" is cached as "Assets/cube.mesh"
+// --------------------------------------------------------
+std::wstring MeshCache::GetCachePath(const wchar_t* sourceFile)
+{
+	std::wstring path = sourceFile;
+	size_t dot = path.find_last_of(L'.');
+	size_t slash = path.find_last_of(L"\\/");
+	if (dot != std::wstring::npos && (slash == std::wstring::npos || dot > slash))
+		path.resize(dot);
+
+	return path + L".mesh";
+}
+
+// --------------------------------------------------------
+// Hashes 8 bytes at a time, which keeps validating a cache
+// entry far cheaper than re-parsing its source file
+// --------------------------------------------------------
+unsigned long long MeshCache::HashBytes(const void* data, size_t size)
+{
+	const unsigned long long multiplier = 0x9E3779B97F4A7C15ull;
+	const unsigned char* bytes = (const unsigned char*)data;
+	unsigned long long h = size * multiplier;
+
+	while (size >= 8)
+	{
+		unsigned long long k;
+		memcpy(&k, bytes, 8);
+		h = (h ^ Mix(k)) * multiplier;
+		bytes += 8;
+		size -= 8;
+	}
+
+	unsigned long long tail = 0;
+	memcpy(&tail, bytes, size);
+	h = (h ^ Mix(tail)) * multiplier;
+
+	return Mix(h);
+}
+
+// --------------------------------------------------------
+// The settings are hashed along with the source's hash,
+// so changing any one of them misses the cache
+// --------------------------------------------------------
+unsigned long long MeshCache::HashSource(const void* data, size_t size, float weldEpsilon, bool optimize, bool generateLods)
+{
+	struct
+	{
+		unsigned long long source;
+		float weldEpsilon;
+		unsigned int flags;
+	} key = {};
+	key.source = HashBytes(data, size);
+	key.weldEpsilon = weldEpsilon;
+	key.flags = (optimize ? 1u : 0u) | (generateLods ? 2u : 0u);
+	return HashBytes(&key, sizeof(key));
+}
+
+// --------------------------------------------------------
+// Memory-maps a cache file and checks that it is complete
+// and was built from the given source with this exact
+// format version and vertex layout
+//
+// cachePath  - Path of the .mesh file
+// sourceHash - HashBytes() of the current source file
+// sourceSize - Byte size of the current source file
+// cacheFile  - Receives the mapping (must outlive the view)
+// view       - Receives pointers to the cached arrays
+// --------------------------------------------------------
+bool MeshCache::Open(const wchar_t* cachePath, unsigned long long sourceHash, unsigned long long sourceSize,
+	MappedFile& cacheFile, View& view)
+{
+	if (!cacheFile.Open(cachePath))
+		return false;
+
+	const char* data = cacheFile.GetData();
+	unsigned long long size = cacheFile.GetSize();
+
+	Header header;
+	if (size < sizeof(Header))
+	{
+		cacheFile.Close();
+		return false;
+	}
+	memcpy(&header, data, sizeof(Header));
+
+	// Any mismatch means the cache is stale or was written by another build
+	bool valid =
+		memcmp(header.magic, Magic, sizeof(Magic)) == 0 &&
+		header.version == FormatVersion &&
+		header.vertexStride == sizeof(PackedVertex) &&
+		header.sourceHash == sourceHash &&
+		header.sourceSize == sourceSize &&
+		header.vertexOffset % alignof(PackedVertex) == 0 &&
+		header.indexOffset % alignof(unsigned int) == 0 &&
+		header.lodOffset % alignof(MeshLod) == 0 &&
+		header.lodCount > 0 &&
+		header.vertexOffset + (unsigned long long)header.vertexCount * sizeof(PackedVertex) <= size &&
+		header.indexOffset + (unsigned long long)header.indexCount * sizeof(unsigned int) <= size &&
+		header.lodOffset + (unsigned long long)header.lodCount * sizeof(MeshLod) <= size &&
+		header.meshletOffset % alignof(Meshlet) == 0 &&
+		header.meshletVertexOffset % alignof(unsigned int) == 0 &&
+		header.meshletOffset + (unsigned long long)header.meshletCount * sizeof(Meshlet) <= size &&
+		header.meshletVertexOffset + (unsigned long long)header.meshletVertexCount * sizeof(unsigned int) <= size &&
+		header.meshletTriangleOffset + header.meshletTriangleBytes <= size &&
+		header.subMeshOffset % alignof(SubMesh) == 0 &&
+		header.subMeshCount > 0 &&
+		header.subMeshOffset + (unsigned long long)header.subMeshCount * sizeof(SubMesh) <= size &&
+		header.materialNameOffset + header.materialNameBytes <= size;
+
+	// Every LOD has to stay inside the index array
+	const MeshLod* lods = (const MeshLod*)(data + header.lodOffset);
+	for (unsigned int i = 0; valid && i < header.lodCount; i++)
+		valid = (unsigned long long)lods[i].indexOffset + lods[i].indexCount <= header.indexCount;
+
+	// Same for every meshlet and its two arrays
+	const Meshlet* meshlets = (const Meshlet*)(data + header.meshletOffset);
+	for (unsigned int i = 0; valid && i < header.meshletCount; i++)
+	{
+		valid =
+			(unsigned long long)meshlets[i].vertexOffset + meshlets[i].vertexCount <= header.meshletVertexCount &&
+			(unsigned long long)meshlets[i].triangleOffset + meshlets[i].triangleCount * 3ull <= header.meshletTriangleBytes;
+	}
+
+	// Every index, and every meshlet's vertex and local triangle index,
+	// has to point inside the arrays it indexes
+	const unsigned int* indices = (const unsigned int*)(data + header.indexOffset);
+	for (unsigned int i = 0; valid && i < header.indexCount; i++)
+		valid = indices[i] < header.vertexCount;
+
+	const unsigned int* meshletVertices = (const unsigned int*)(data + header.meshletVertexOffset);
+	for (unsigned int i = 0; valid && i < header.meshletVertexCount; i++)
+		valid = meshletVertices[i] < header.vertexCount;
+
+	const unsigned char* meshletTriangles = (const unsigned char*)(data + header.meshletTriangleOffset);
+	for (unsigned int i = 0; valid && i < header.meshletCount; i++)
+	{
+		const unsigned char* corners = meshletTriangles + meshlets[i].triangleOffset;
+		for (unsigned int c = 0; valid && c < meshlets[i].triangleCount * 3; c++)
+			valid = corners[c] < meshlets[i].vertexCount;
+	}
+
+	// The names have to end in a null, and there's one per material slot
+	const char* names = data + header.materialNameOffset;
+	std::vector<std::string> materialNames;
+	if (valid && header.materialNameBytes > 0)
+	{
+		valid = names[header.materialNameBytes - 1] == '\0';
+		for (const char* name = names; valid && name < names + header.materialNameBytes; name += strlen(name) + 1)
+			materialNames.push_back(name);
+	}
+
+	// And every sub-mesh's ranges have to stay inside their arrays
+	const SubMesh* subMeshes = (const SubMesh*)(data + header.subMeshOffset);
+	for (unsigned int i = 0; valid && i < header.subMeshCount; i++)
+	{
+		valid =
+			(unsigned long long)subMeshes[i].indexOffset + subMeshes[i].indexCount <= header.indexCount &&
+			(unsigned long long)subMeshes[i].lodOffset + subMeshes[i].lodCount <= header.lodCount &&
+			(unsigned long long)subMeshes[i].meshletOffset + subMeshes[i].meshletCount <= header.meshletCount &&
+			subMeshes[i].materialSlot < materialNames.size();
+	}
+
+	if (!valid)
+	{
+		cacheFile.Close();
+		return false;
+	}
+
+	view.vertices = (const PackedVertex*)(data + header.vertexOffset);
+	view.vertexCount = header.vertexCount;
+	view.indices = indices;
+	view.indexCount = header.indexCount;
+	view.lods = lods;
+	view.lodCount = header.lodCount;
+	view.meshlets = meshlets;
+	view.meshletCount = header.meshletCount;
+	view.meshletVertices = meshletVertices;
+	view.meshletVertexCount = header.meshletVertexCount;
+	view.meshletTriangles = meshletTriangles;
+	view.meshletTriangleBytes = header.meshletTriangleBytes;
+	view.subMeshes = subMeshes;
+	view.subMeshCount = header.subMeshCount;
+	view.materialNames.swap(materialNames);
+	view.boundsMin = header.boundsMin;
+	view.boundsMax = header.boundsMax;
+	view.boundsRadius = header.boundsRadius;
+	view.quantization = header.quantization;
+	return true;
+}
+
+// --------------------------------------------------------
+// Writes the header followed by the vertex, index, LOD,
+// meshlet and sub-mesh arrays and the material names, each
+// starting on a 16 byte boundary
+//
+// Everything goes into a temporary file first. Only once
+// that's complete and closed is it renamed over the cache,
+// so readers see either the old file or the whole new one.
+// --------------------------------------------------------
+bool MeshCache::Write(const wchar_t* cachePath, unsigned long long sourceHash, unsigned long long sourceSize,
+	const PackedVertex* vertices, unsigned int vertexCount, const PositionQuantization& quantization,
+	const unsigned int* indices, unsigned int indexCount,
+	const MeshLod* lods, unsigned int lodCount,
+	const MeshletData& meshlets,
+	const SubMesh* subMeshes, unsigned int subMeshCount,
+	const std::vector<std::string>& materialNames,
+	DirectX::XMFLOAT3 boundsMin, DirectX::XMFLOAT3 boundsMax, float boundsRadius)
+{
+	std::string names;
+	for (const std::string& name : materialNames)
+		names.append(name.c_str(), name.size() + 1);
+
+	Header header = {};
+	memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = FormatVersion;
+	header.sourceHash = sourceHash;
+	header.sourceSize = sourceSize;
+	header.vertexStride = sizeof(PackedVertex);
+	header.vertexCount = vertexCount;
+	header.indexCount = indexCount;
+	header.lodCount = lodCount;
+	header.boundsMin = boundsMin;
+	header.boundsMax = boundsMax;
+	header.boundsRadius = boundsRadius;
+	header.quantization = quantization;
+	header.vertexOffset = AlignUp(sizeof(Header), 16);
+	header.indexOffset = AlignUp(header.vertexOffset + (unsigned long long)vertexCount * sizeof(PackedVertex), 16);
+	header.lodOffset = AlignUp(header.indexOffset + (unsigned long long)indexCount * sizeof(unsigned int), 16);
+	header.meshletCount = (unsigned int)meshlets.meshlets.size();
+	header.meshletVertexCount = (unsigned int)meshlets.vertices.size();
+	header.meshletTriangleBytes = (unsigned int)meshlets.triangles.size();
+	header.meshletOffset = AlignUp(header.lodOffset + (unsigned long long)lodCount * sizeof(MeshLod), 16);
+	header.meshletVertexOffset = AlignUp(header.meshletOffset + (unsigned long long)header.meshletCount * sizeof(Meshlet), 16);
+	header.meshletTriangleOffset = AlignUp(header.meshletVertexOffset + (unsigned long long)header.meshletVertexCount * sizeof(unsigned int), 16);
+	header.subMeshCount = subMeshCount;
+	header.materialNameBytes = (unsigned int)names.size();
+	header.subMeshOffset = AlignUp(header.meshletTriangleOffset + header.meshletTriangleBytes, 16);
+	header.materialNameOffset = AlignUp(header.subMeshOffset + (unsigned long long)subMeshCount * sizeof(SubMesh), 16);
+
+	std::wstring tempPath = TempPath(cachePath);
+	FILE* file = OpenForWriting(tempPath.c_str());
+	if (!file)
+		return false;
+
+	// Zero padding between sections
+	const char zeros[16] = {};
+
+	bool ok = fwrite(&header, sizeof(Header), 1, file) == 1;
+	ok = ok && fwrite(zeros, 1, (size_t)(header.vertexOffset - sizeof(Header)), file) == header.vertexOffset - sizeof(Header);
+	ok = ok && fwrite(vertices, sizeof(PackedVertex), vertexCount, file) == vertexCount;
+
+	unsigned long long vertexEnd = header.vertexOffset + (unsigned long long)vertexCount * sizeof(PackedVertex);
+	ok = ok && fwrite(zeros, 1, (size_t)(header.indexOffset - vertexEnd), file) == header.indexOffset - vertexEnd;
+	ok = ok && fwrite(indices, sizeof(unsigned int), indexCount, file) == indexCount;
+
+	unsigned long long indexEnd = header.indexOffset + (unsigned long long)indexCount * sizeof(unsigned int);
+	ok = ok && fwrite(zeros, 1, (size_t)(header.lodOffset - indexEnd), file) == header.lodOffset - indexEnd;
+	ok = ok && fwrite(lods, sizeof(MeshLod), lodCount, file) == lodCount;
+
+	unsigned long long lodEnd = header.lodOffset + (unsigned long long)lodCount * sizeof(MeshLod);
+	ok = ok && fwrite(zeros, 1, (size_t)(header.meshletOffset - lodEnd), file) == header.meshletOffset - lodEnd;
+	ok = ok && fwrite(meshlets.meshlets.data(), sizeof(Meshlet), header.meshletCount, file) == header.meshletCount;
+
+	unsigned long long meshletEnd = header.meshletOffset + (unsigned long long)header.meshletCount * sizeof(Meshlet);
+	ok = ok && fwrite(zeros, 1, (size_t)(header.meshletVertexOffset - meshletEnd), file) == header.meshletVertexOffset - meshletEnd;
+	ok = ok && fwrite(meshlets.vertices.data(), sizeof(unsigned int), header.meshletVertexCount, file) == header.meshletVertexCount;
+
+	unsigned long long meshletVertexEnd = header.meshletVertexOffset + (unsigned long long)header.meshletVertexCount * sizeof(unsigned int);
+	ok = ok && fwrite(zeros, 1, (size_t)(header.meshletTriangleOffset - meshletVertexEnd), file) == header.meshletTriangleOffset - meshletVertexEnd;
+	ok = ok && fwrite(meshlets.triangles.data(), 1, header.meshletTriangleBytes, file) == header.meshletTriangleBytes;
+
+	unsigned long long meshletTriangleEnd = header.meshletTriangleOffset + header.meshletTriangleBytes;
+	ok = ok && fwrite(zeros, 1, (size_t)(header.subMeshOffset - meshletTriangleEnd), file) == header.subMeshOffset - meshletTriangleEnd;
+	ok = ok && fwrite(subMeshes, sizeof(SubMesh), subMeshCount, file) == subMeshCount;
+
+	unsigned long long subMeshEnd = header.subMeshOffset + (unsigned long long)subMeshCount * sizeof(SubMesh);
+	ok = ok && fwrite(zeros, 1, (size_t)(header.materialNameOffset - subMeshEnd), file) == header.materialNameOffset - subMeshEnd;
+	ok = ok && fwrite(names.data(), 1, names.size(), file) == names.size();
+
+	ok = fclose(file) == 0 && ok;
+
+	std::error_code error;
+	if (ok)
+		std::filesystem::rename(tempPath, cachePath, error);
+	if (!ok || error)
+	{
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+	return true;
+}
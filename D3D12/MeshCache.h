@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "Meshlets.h"
+#include "MeshSimplifier.h"
+#include "SubMesh.h"
+#include "Vertex.h"
+#include "VertexPacking.h"
+
+// --------------------------------------------------------
+// Binary .mesh cache for fully processed OBJ meshes
+//
+// A .mesh file stores the final packed vertex and index
+// arrays exactly as they'll be uploaded, along with what
+// unpacks the positions, the mesh's sub-meshes,
+// LOD chain and meshlets, its material names, its bounds
+// and a hash of the source file it came from.
+// Loading one is just a memory map and a header check.
+// --------------------------------------------------------
+namespace MeshCache
+{
+	// Bump this whenever the file layout or the
+	// processing that produces the arrays changes
+	const unsigned int FormatVersion = 6;
+
+	// The fixed-size header at the start of every .mesh file
+	struct Header
+	{
+		char magic[4];                   // Always "MESH"
+		unsigned int version;            // Must match FormatVersion
+		unsigned long long sourceHash;   // HashBytes() of the source file
+		unsigned long long sourceSize;   // Byte size of the source file
+		unsigned int vertexStride;       // sizeof(PackedVertex) when written
+		unsigned int vertexCount;
+		unsigned int indexCount;         // All LODs together
+		unsigned int lodCount;
+		DirectX::XMFLOAT3 boundsMin;
+		DirectX::XMFLOAT3 boundsMax;
+		float boundsRadius;
+		PositionQuantization quantization;
+		unsigned int padding;
+		unsigned long long vertexOffset; // Byte offset of the PackedVertex array
+		unsigned long long indexOffset;  // Byte offset of the index array
+		unsigned long long lodOffset;    // Byte offset of the MeshLod array
+		unsigned int meshletCount;       // Zero if the mesh has no meshlets
+		unsigned int meshletVertexCount;
+		unsigned int meshletTriangleBytes;
+		unsigned int meshletPadding;
+		unsigned long long meshletOffset;         // Byte offset of the Meshlet array
+		unsigned long long meshletVertexOffset;   // Byte offset of MeshletData::vertices
+		unsigned long long meshletTriangleOffset; // Byte offset of MeshletData::triangles
+		unsigned int subMeshCount;
+		unsigned int materialNameBytes;           // Null-terminated names, one per material slot
+		unsigned long long subMeshOffset;         // Byte offset of the SubMesh array
+		unsigned long long materialNameOffset;    // Byte offset of the material names
+	};
+
+	// Pointers into a memory-mapped .mesh file
+	struct View
+	{
+		const PackedVertex* vertices = 0;
+		unsigned int vertexCount = 0;
+		const unsigned int* indices = 0;
+		unsigned int indexCount = 0;
+		const MeshLod* lods = 0;
+		unsigned int lodCount = 0;
+		const Meshlet* meshlets = 0;
+		unsigned int meshletCount = 0;
+		const unsigned int* meshletVertices = 0;
+		unsigned int meshletVertexCount = 0;
+		const unsigned char* meshletTriangles = 0;
+		unsigned int meshletTriangleBytes = 0;
+		const SubMesh* subMeshes = 0;
+		unsigned int subMeshCount = 0;
+		std::vector<std::string> materialNames;	// Copied out of the file
+		DirectX::XMFLOAT3 boundsMin{};
+		DirectX::XMFLOAT3 boundsMax{};
+		float boundsRadius = 0.0f;
+		PositionQuantization quantization{};
+	};
+
+	// Where the cache for a given source file lives (next to it)
+	std::wstring GetCachePath(const wchar_t* sourceFile);
+
+	// Fast, stable 64-bit hash of a block of memory
+	unsigned long long HashBytes(const void* data, size_t size);
+
+	// The hash a cache is keyed on: the source file's bytes along with
+	// every processing setting that changes what ends up in the cache
+	unsigned long long HashSource(const void* data, size_t size, float weldEpsilon, bool optimize, bool generateLods);
+
+	// Maps the cache file and validates it against the source, including
+	// that every index points at a vertex. The view points into cacheFile,
+	// so it is only valid while that stays open.
+	bool Open(const wchar_t* cachePath, unsigned long long sourceHash, unsigned long long sourceSize,
+		MappedFile& cacheFile, View& view);
+
+	// Writes a new cache file next to the old one, then renames it into
+	// place, so a crash or another instance part-way through never leaves
+	// a truncated cache behind
+	bool Write(const wchar_t* cachePath, unsigned long long sourceHash, unsigned long long sourceSize,
+		const PackedVertex* vertices, unsigned int vertexCount, const PositionQuantization& quantization,
+		const unsigned int* indices, unsigned int indexCount,
+		const MeshLod* lods, unsigned int lodCount,
+		const MeshletData& meshlets,
+		const SubMesh* subMeshes, unsigned int subMeshCount,
+		const std::vector<std::string>& materialNames,
+		DirectX::XMFLOAT3 boundsMin, DirectX::XMFLOAT3 boundsMax, float boundsRadius);
+}
@@ -0,0 +1,501 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+namespace MeshOptimizer
+{
+	// Annonymous namespace to hold helpers
+	// only accessible in this file
+	namespace
+	{
+		// Tuning values from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+		const int ForsythCacheSize = 32;
+		const float CacheDecayPower = 1.5f;
+		const float LastTriangleScore = 0.75f;
+		const float ValenceBoostScale = 2.0f;
+		const float ValenceBoostPower = 0.5f;
+		const unsigned int ValenceTableSize = 32;
+
+		// Clusters smaller than this aren't worth sorting on their own
+		const size_t MinClusterTriangles = 16;
+
+		// --------------------------------------------------------
+		// Precomputed vertex scores by cache position and by the
+		// number of triangles still waiting to use the vertex
+		// --------------------------------------------------------
+		struct ScoreTables
+		{
+			float cache[ForsythCacheSize];
+			float valence[ValenceTableSize];
+
+			ScoreTables()
+			{
+				for (int i = 0; i < ForsythCacheSize; i++)
+				{
+					// The last triangle's vertices get a fixed score so the
+					// algorithm doesn't favor one of them over the others
+					cache[i] = i < 3 ?
+						LastTriangleScore :
+						std::pow(1.0f - (float)(i - 3) / (ForsythCacheSize - 3), CacheDecayPower);
+				}
+
+				valence[0] = 0.0f;
+				for (unsigned int i = 1; i < ValenceTableSize; i++)
+					valence[i] = ValenceBoostScale * std::pow((float)i, -ValenceBoostPower);
+			}
+
+			float VertexScore(int cachePosition, unsigned int remainingTriangles) const
+			{
+				// Vertices with nothing left to draw should never be picked
+				if (remainingTriangles == 0)
+					return -1.0f;
+
+				float score = cachePosition >= 0 ? cache[cachePosition] : 0.0f;
+				score += remainingTriangles < ValenceTableSize ?
+					valence[remainingTriangles] :
+					ValenceBoostScale * std::pow((float)remainingTriangles, -ValenceBoostPower);
+				return score;
+			}
+		};
+
+		// --------------------------------------------------------
+		// FIFO cache simulator that can be cleared in constant time.
+		// A vertex is cached if it was added within the last
+		// cacheSize insertions.
+		// --------------------------------------------------------
+		class FifoCache
+		{
+		public:
+
+			FifoCache(size_t vertexCount, unsigned int cacheSize) :
+				timestamps(vertexCount, 0),
+				cacheSize(cacheSize),
+				time(cacheSize + 1)
+			{
+			}
+
+			// Returns 1 if the vertex missed (and is now cached), 0 if it hit
+			unsigned int Access(unsigned int vertex)
+			{
+				if (time - timestamps[vertex] <= cacheSize)
+					return 0;
+
+				timestamps[vertex] = time++;
+				return 1;
+			}
+
+			void Clear()
+			{
+				time += cacheSize + 1;
+			}
+
+		private:
+
+			std::vector<unsigned int> timestamps;
+			unsigned int cacheSize;
+			unsigned int time;
+		};
+
+		// Twice the area of the triangle, pointing along its front face
+		inline DirectX::XMFLOAT3 TriangleNormal(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b, const DirectX::XMFLOAT3& c)
+		{
+			float e1x = b.x - a.x, e1y = b.y - a.y, e1z = b.z - a.z;
+			float e2x = c.x - a.x, e2y = c.y - a.y, e2z = c.z - a.z;
+			return DirectX::XMFLOAT3(
+				e1y * e2z - e1z * e2y,
+				e1z * e2x - e1x * e2z,
+				e1x * e2y - e1y * e2x);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Runs all three passes, optionally printing cache
+// efficiency before and after along with how long the
+// passes took. The two triangle passes run on each sub-mesh
+// separately, so every sub-mesh keeps its own range of the
+// index array.
+// --------------------------------------------------------
+void MeshOptimizer::Optimize(std::vector<Vertex>& verts, std::vector<unsigned int>& indices,
+	const std::vector<SubMesh>& subMeshes, bool printStats)
+{
+	if (indices.size() < 3 || verts.empty())
+		return;
+
+	// The cache simulation is only worth running if it's reported
+	VertexCacheStats before;
+	if (printStats)
+		before = SimulateVertexCache(indices.data(), indices.size(), verts.size());
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	SubMesh whole = {};
+	whole.indexCount = (unsigned int)indices.size();
+	const SubMesh* ranges = subMeshes.empty() ? &whole : subMeshes.data();
+	size_t rangeCount = subMeshes.empty() ? 1 : subMeshes.size();
+
+	size_t clusters = 0;
+	for (size_t r = 0; r < rangeCount; r++)
+	{
+		if (ranges[r].indexCount < 3)
+			continue;
+
+		unsigned int* rangeIndices = &indices[ranges[r].indexOffset];
+		OptimizeVertexCache(rangeIndices, ranges[r].indexCount, verts.size());
+		clusters += OptimizeOverdraw(rangeIndices, ranges[r].indexCount, verts.data(), verts.size());
+	}
+	verts.resize(OptimizeVertexFetch(verts.data(), verts.size(), indices.data(), indices.size()));
+
+	std::chrono::duration<double> seconds = std::chrono::high_resolution_clock::now() - startTime;
+	if (!printStats)
+		return;
+
+	VertexCacheStats after = SimulateVertexCache(indices.data(), indices.size(), verts.size());
+	printf("Optimized in %.2f ms: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (%u entry FIFO), %zu overdraw clusters\n",
+		seconds.count() * 1000.0, before.acmr, after.acmr, before.atvr, after.atvr, SimulatedCacheSize, clusters);
+}
+
+// --------------------------------------------------------
+// Greedily emits the best scoring triangle, where a
+// triangle's score is the sum of its vertices' scores.
+// Vertices score higher when they're near the front of a
+// simulated LRU cache and when few triangles still use them
+// (so isolated corners get finished off). Only triangles
+// touching the cache are rescored after each step, which
+// keeps the whole thing linear in the triangle count.
+// --------------------------------------------------------
+void MeshOptimizer::OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	static const ScoreTables scores;
+
+	// Build each vertex's list of (not yet emitted) triangles
+	std::vector<unsigned int> remaining(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		remaining[indices[i]]++;
+
+	std::vector<unsigned int> firstTriangle(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+		firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+
+	std::vector<unsigned int> adjacency(triangleCount * 3);
+	std::vector<unsigned int> filled(vertexCount, 0);
+	for (size_t t = 0; t < triangleCount; t++)
+		for (int c = 0; c < 3; c++)
+		{
+			unsigned int v = indices[t * 3 + c];
+			adjacency[firstTriangle[v] + filled[v]++] = (unsigned int)t;
+		}
+
+	// Initial scores, with nothing in the cache
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		vertexScore[v] = scores.VertexScore(-1, remaining[v]);
+
+	std::vector<float> triangleScore(triangleCount);
+	int bestTriangle = 0;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		triangleScore[t] =
+			vertexScore[indices[t * 3 + 0]] +
+			vertexScore[indices[t * 3 + 1]] +
+			vertexScore[indices[t * 3 + 2]];
+
+		if (triangleScore[t] > triangleScore[bestTriangle])
+			bestTriangle = (int)t;
+	}
+
+	std::vector<char> emitted(triangleCount, 0);
+	std::vector<unsigned int> output(triangleCount * 3);
+	unsigned int cache[ForsythCacheSize + 3];
+	int cacheCount = 0;
+	size_t nextUnemitted = 0;
+
+	for (size_t outTriangle = 0; outTriangle < triangleCount; outTriangle++)
+	{
+		// Nothing in the cache has triangles left, so jump to the next one in
+		// input order. The cursor only moves forward, so this stays linear.
+		if (bestTriangle < 0)
+		{
+			while (emitted[nextUnemitted])
+				nextUnemitted++;
+			bestTriangle = (int)nextUnemitted;
+		}
+
+		const unsigned int* tri = &indices[bestTriangle * 3];
+		output[outTriangle * 3 + 0] = tri[0];
+		output[outTriangle * 3 + 1] = tri[1];
+		output[outTriangle * 3 + 2] = tri[2];
+		emitted[bestTriangle] = 1;
+
+		// Remove the triangle from its vertices' lists
+		for (int c = 0; c < 3; c++)
+		{
+			unsigned int v = tri[c];
+			unsigned int* list = &adjacency[firstTriangle[v]];
+			for (unsigned int i = 0; i < remaining[v]; i++)
+			{
+				if (list[i] == (unsigned int)bestTriangle)
+				{
+					list[i] = list[remaining[v] - 1];
+					remaining[v]--;
+					break;
+				}
+			}
+		}
+
+		// Move the triangle's vertices to the front of the cache
+		unsigned int newCache[ForsythCacheSize + 3];
+		int newCount = 0;
+		for (int c = 0; c < 3; c++)
+		{
+			if (std::find(newCache, newCache + newCount, tri[c]) == newCache + newCount)
+				newCache[newCount++] = tri[c];
+		}
+		for (int i = 0; i < cacheCount; i++)
+		{
+			if (cache[i] != tri[0] && cache[i] != tri[1] && cache[i] != tri[2])
+				newCache[newCount++] = cache[i];
+		}
+
+		// Anything pushed past the end falls out, but still needs rescoring
+		for (int i = 0; i < newCount; i++)
+			cachePosition[newCache[i]] = i < ForsythCacheSize ? i : -1;
+
+		for (int i = 0; i < newCount; i++)
+		{
+			unsigned int v = newCache[i];
+			float score = scores.VertexScore(cachePosition[v], remaining[v]);
+			float delta = score - vertexScore[v];
+			vertexScore[v] = score;
+
+			const unsigned int* list = &adjacency[firstTriangle[v]];
+			for (unsigned int n = 0; n < remaining[v]; n++)
+				triangleScore[list[n]] += delta;
+		}
+
+		// The next triangle is the best one touching the cache
+		cacheCount = newCount < ForsythCacheSize ? newCount : ForsythCacheSize;
+		bestTriangle = -1;
+		float bestScore = -1.0f;
+		for (int i = 0; i < cacheCount; i++)
+		{
+			unsigned int v = newCache[i];
+			cache[i] = v;
+
+			const unsigned int* list = &adjacency[firstTriangle[v]];
+			for (unsigned int n = 0; n < remaining[v]; n++)
+			{
+				if (triangleScore[list[n]] > bestScore)
+				{
+					bestScore = triangleScore[list[n]];
+					bestTriangle = (int)list[n];
+				}
+			}
+		}
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+// --------------------------------------------------------
+// Overdraw-aware cluster sort, after Sander et al.'s "Fast
+// Triangle Reordering for Vertex Locality and Reduced
+// Overdraw". The cache-optimized triangles are cut into
+// clusters wherever the cache starts cold anyway (hard
+// boundaries), and further wherever a cluster's ACMR is
+// already within threshold of its parent's (soft
+// boundaries). Clusters facing away from the mesh center
+// are likely to occlude the rest, so they're drawn first.
+//
+// Returns the number of clusters
+// --------------------------------------------------------
+size_t MeshOptimizer::OptimizeOverdraw(unsigned int* indices, size_t indexCount, const Vertex* verts, size_t vertexCount, float threshold)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return 0;
+
+	// Hard boundaries: triangles where all three vertices miss
+	std::vector<size_t> hardStarts;
+	FifoCache cache(vertexCount, SimulatedCacheSize);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		unsigned int misses =
+			cache.Access(indices[t * 3 + 0]) +
+			cache.Access(indices[t * 3 + 1]) +
+			cache.Access(indices[t * 3 + 2]);
+		if (t == 0 || misses == 3)
+			hardStarts.push_back(t);
+	}
+	hardStarts.push_back(triangleCount);
+
+	// Soft boundaries: split each hard cluster as soon as the
+	// running ACMR (from a cold cache) is close enough to its own
+	std::vector<size_t> clusterStarts;
+	for (size_t h = 0; h + 1 < hardStarts.size(); h++)
+	{
+		size_t first = hardStarts[h];
+		size_t last = hardStarts[h + 1];
+
+		cache.Clear();
+		size_t hardMisses = 0;
+		for (size_t t = first; t < last; t++)
+			for (int c = 0; c < 3; c++)
+				hardMisses += cache.Access(indices[t * 3 + c]);
+		float limit = (float)hardMisses / (last - first) * threshold;
+
+		cache.Clear();
+		size_t start = first;
+		size_t misses = 0;
+		clusterStarts.push_back(start);
+		for (size_t t = first; t < last; t++)
+		{
+			for (int c = 0; c < 3; c++)
+				misses += cache.Access(indices[t * 3 + c]);
+
+			size_t size = t + 1 - start;
+			if (t + 1 < last && size >= MinClusterTriangles && (float)misses / size <= limit)
+			{
+				start = t + 1;
+				misses = 0;
+				cache.Clear();
+				clusterStarts.push_back(start);
+			}
+		}
+	}
+	clusterStarts.push_back(triangleCount);
+	size_t clusterCount = clusterStarts.size() - 1;
+
+	// Area-weighted centroid of the whole mesh
+	double meshCenter[3] = {};
+	double meshArea = 0.0;
+	std::vector<float> clusterKeys(clusterCount);
+	std::vector<double> clusterData(clusterCount * 7);
+	for (size_t k = 0; k < clusterCount; k++)
+	{
+		double* d = &clusterData[k * 7];
+		for (size_t t = clusterStarts[k]; t < clusterStarts[k + 1]; t++)
+		{
+			const DirectX::XMFLOAT3& a = verts[indices[t * 3 + 0]].Position;
+			const DirectX::XMFLOAT3& b = verts[indices[t * 3 + 1]].Position;
+			const DirectX::XMFLOAT3& c = verts[indices[t * 3 + 2]].Position;
+			DirectX::XMFLOAT3 n = TriangleNormal(a, b, c);
+			double area = std::sqrt((double)n.x * n.x + (double)n.y * n.y + (double)n.z * n.z);
+
+			d[0] += (a.x + b.x + c.x) * area;
+			d[1] += (a.y + b.y + c.y) * area;
+			d[2] += (a.z + b.z + c.z) * area;
+			d[3] += n.x;
+			d[4] += n.y;
+			d[5] += n.z;
+			d[6] += area * 3.0;
+		}
+
+		meshCenter[0] += d[0];
+		meshCenter[1] += d[1];
+		meshCenter[2] += d[2];
+		meshArea += d[6];
+	}
+
+	if (meshArea > 0.0)
+	{
+		meshCenter[0] /= meshArea;
+		meshCenter[1] /= meshArea;
+		meshCenter[2] /= meshArea;
+	}
+
+	// Sort key: how much the cluster faces away from the mesh center
+	for (size_t k = 0; k < clusterCount; k++)
+	{
+		const double* d = &clusterData[k * 7];
+		double length = std::sqrt(d[3] * d[3] + d[4] * d[4] + d[5] * d[5]);
+		if (d[6] <= 0.0 || length <= 0.0)
+		{
+			clusterKeys[k] = 0.0f;
+			continue;
+		}
+
+		clusterKeys[k] = (float)(
+			((d[0] / d[6]) - meshCenter[0]) * d[3] / length +
+			((d[1] / d[6]) - meshCenter[1]) * d[4] / length +
+			((d[2] / d[6]) - meshCenter[2]) * d[5] / length);
+	}
+
+	std::vector<size_t> order(clusterCount);
+	for (size_t k = 0; k < clusterCount; k++)
+		order[k] = k;
+	std::stable_sort(order.begin(), order.end(),
+		[&](size_t a, size_t b) { return clusterKeys[a] > clusterKeys[b]; });
+
+	std::vector<unsigned int> sorted;
+	sorted.reserve(triangleCount * 3);
+	for (size_t k : order)
+		sorted.insert(sorted.end(), indices + clusterStarts[k] * 3, indices + clusterStarts[k + 1] * 3);
+
+	std::copy(sorted.begin(), sorted.end(), indices);
+	return clusterCount;
+}
+
+// --------------------------------------------------------
+// Renumbers vertices in the order the index buffer first
+// uses them, so vertex fetches walk memory mostly forward
+// --------------------------------------------------------
+size_t MeshOptimizer::OptimizeVertexFetch(Vertex* verts, size_t vertexCount, unsigned int* indices, size_t indexCount)
+{
+	const unsigned int unused = 0xFFFFFFFF;
+	std::vector<unsigned int> remap(vertexCount, unused);
+	unsigned int newCount = 0;
+
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int& newIndex = remap[indices[i]];
+		if (newIndex == unused)
+			newIndex = newCount++;
+		indices[i] = newIndex;
+	}
+
+	std::vector<Vertex> original(verts, verts + vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		if (remap[v] != unused)
+			verts[remap[v]] = original[v];
+	}
+
+	return newCount;
+}
+
+// --------------------------------------------------------
+// Simulates a FIFO post-transform cache like the ones on
+// most GPUs, counting how many vertices must be shaded
+// --------------------------------------------------------
+VertexCacheStats MeshOptimizer::SimulateVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize)
+{
+	VertexCacheStats stats;
+	if (indexCount < 3 || vertexCount == 0)
+		return stats;
+
+	FifoCache cache(vertexCount, cacheSize);
+	std::vector<char> used(vertexCount, 0);
+	size_t usedCount = 0;
+
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		stats.misses += cache.Access(indices[i]);
+		if (!used[indices[i]])
+		{
+			used[indices[i]] = 1;
+			usedCount++;
+		}
+	}
+
+	stats.acmr = (float)stats.misses / (indexCount / 3);
+	stats.atvr = (float)stats.misses / usedCount;
+	return stats;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "SubMesh.h"
+#include "Vertex.h"
+
+// Results of running an index buffer through a simulated
+// post-transform vertex cache
+struct VertexCacheStats
+{
+	size_t misses = 0;
+	float acmr = 0.0f;	// Average cache misses per triangle (0.5 is ideal on big meshes)
+	float atvr = 0.0f;	// Average transforms per vertex (1.0 is ideal)
+};
+
+// --------------------------------------------------------
+// Reorders mesh data so the GPU does less work drawing it
+//
+// The passes are meant to run in this order:
+//  1. OptimizeVertexCache  - Triangle order for vertex reuse
+//  2. OptimizeOverdraw     - Cluster order for early-z
+//  3. OptimizeVertexFetch  - Vertex order for memory locality
+// Optimize() runs all three and can report the difference.
+// --------------------------------------------------------
+namespace MeshOptimizer
+{
+	// Entries in the simulated FIFO cache used for reporting
+	const unsigned int SimulatedCacheSize = 16;
+
+	// Run every pass on a mesh, printing ACMR/ATVR before and after if asked. Triangles
+	// only move within their own sub-mesh's range (the whole array if there are none).
+	void Optimize(std::vector<Vertex>& verts, std::vector<unsigned int>& indices,
+		const std::vector<SubMesh>& subMeshes = std::vector<SubMesh>(), bool printStats = false);
+
+	// Forsyth's linear-speed vertex cache optimization (reorders triangles in place)
+	void OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount);
+
+	// Splits the (already cache-optimized) triangles into clusters and sorts them
+	// so outward-facing ones draw first. ACMR grows by at most about threshold.
+	size_t OptimizeOverdraw(unsigned int* indices, size_t indexCount, const Vertex* verts, size_t vertexCount, float threshold = 1.05f);
+
+	// Renumbers vertices in order of first use, dropping unused ones.
+	// Returns the new vertex count.
+	size_t OptimizeVertexFetch(Vertex* verts, size_t vertexCount, unsigned int* indices, size_t indexCount);
+
+	// Counts cache misses for the index buffer with a FIFO cache of the given size
+	VertexCacheStats SimulateVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = SimulatedCacheSize);
+}
@@ -0,0 +1,640 @@
+#include "MeshSimplifier.h"
+
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+using namespace DirectX;
+
+namespace MeshSimplifier
+{
+	// Annonymous namespace to hold helpers
+	// only accessible in this file
+	namespace
+	{
+		// Open borders and attribute seams get planes perpendicular to
+		// their faces, weighted well above the surface so they keep their shape
+		const double BorderWeight = 10.0;
+
+		// Collapses may rotate a neighboring triangle by at most ~75 degrees
+		const double MinNormalDot = 0.25;
+
+		// Levels that keep more than this fraction of the previous level are skipped
+		const float MinLodReduction = 0.9f;
+
+		const unsigned int None = ~0u;
+
+		// Sum of squared distances to a set of weighted planes, stored as the
+		// symmetric matrix A, vector b and constant c of p'Ap + 2b'p + c
+		struct Quadric
+		{
+			double a00 = 0, a11 = 0, a22 = 0, a01 = 0, a02 = 0, a12 = 0;
+			double b0 = 0, b1 = 0, b2 = 0;
+			double c = 0;
+			double weight = 0;
+		};
+
+		void AddPlane(Quadric& q, double nx, double ny, double nz, double d, double weight)
+		{
+			q.a00 += weight * nx * nx;
+			q.a11 += weight * ny * ny;
+			q.a22 += weight * nz * nz;
+			q.a01 += weight * nx * ny;
+			q.a02 += weight * nx * nz;
+			q.a12 += weight * ny * nz;
+			q.b0 += weight * nx * d;
+			q.b1 += weight * ny * d;
+			q.b2 += weight * nz * d;
+			q.c += weight * d * d;
+			q.weight += weight;
+		}
+
+		void AddQuadric(Quadric& q, const Quadric& other)
+		{
+			q.a00 += other.a00; q.a11 += other.a11; q.a22 += other.a22;
+			q.a01 += other.a01; q.a02 += other.a02; q.a12 += other.a12;
+			q.b0 += other.b0; q.b1 += other.b1; q.b2 += other.b2;
+			q.c += other.c;
+			q.weight += other.weight;
+		}
+
+		// Weighted mean squared distance from p to the quadric's planes
+		double Evaluate(const Quadric& q, const XMFLOAT3& p)
+		{
+			if (q.weight <= 0.0)
+				return 0.0;
+
+			double x = p.x, y = p.y, z = p.z;
+			double result =
+				q.a00 * x * x + q.a11 * y * y + q.a22 * z * z +
+				2.0 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z) +
+				2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) +
+				q.c;
+			return result > 0.0 ? result / q.weight : 0.0;
+		}
+
+		inline void Sub(const XMFLOAT3& a, const XMFLOAT3& b, double out[3])
+		{
+			out[0] = (double)a.x - b.x;
+			out[1] = (double)a.y - b.y;
+			out[2] = (double)a.z - b.z;
+		}
+
+		inline void Cross(const double a[3], const double b[3], double out[3])
+		{
+			out[0] = a[1] * b[2] - a[2] * b[1];
+			out[1] = a[2] * b[0] - a[0] * b[2];
+			out[2] = a[0] * b[1] - a[1] * b[0];
+		}
+
+		inline double Dot(const double a[3], const double b[3])
+		{
+			return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+		}
+
+		// Un-normalized face normal (twice the area in length)
+		inline void FaceNormal(const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2, double out[3])
+		{
+			double e1[3], e2[3];
+			Sub(p1, p0, e1);
+			Sub(p2, p0, e2);
+			Cross(e1, e2, out);
+		}
+
+		struct PositionHash
+		{
+			size_t operator()(const XMFLOAT3& p) const
+			{
+				unsigned int bits[3];
+				memcpy(bits, &p, sizeof(bits));
+				return (size_t)(bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u);
+			}
+		};
+
+		struct PositionEqual
+		{
+			bool operator()(const XMFLOAT3& a, const XMFLOAT3& b) const
+			{
+				return memcmp(&a, &b, sizeof(XMFLOAT3)) == 0;
+			}
+		};
+
+		// A candidate collapse of position u onto position v
+		struct Collapse
+		{
+			unsigned int u;
+			unsigned int v;
+			double cost;
+		};
+
+		// Triangles around each position, rebuilt every pass
+		struct Adjacency
+		{
+			std::vector<unsigned int> offsets;
+			std::vector<unsigned int> triangles;
+		};
+
+		// Everything Simplify() works on, so the helpers
+		// below don't need a dozen parameters each
+		struct State
+		{
+			const Vertex* verts;
+			std::vector<unsigned int> position;	// Vertex index -> first vertex with the same position
+			std::vector<unsigned int> tris;
+			Adjacency adjacency;
+			std::vector<Quadric> quadrics;		// Indexed by position
+		};
+
+		inline unsigned int PositionOf(const State& s, unsigned int triangle, unsigned int corner)
+		{
+			return s.position[s.tris[triangle * 3 + corner]];
+		}
+
+		void BuildAdjacency(State& s)
+		{
+			size_t vertexCount = s.position.size();
+			size_t triangleCount = s.tris.size() / 3;
+
+			s.adjacency.offsets.assign(vertexCount + 1, 0);
+			for (size_t i = 0; i < s.tris.size(); i++)
+				s.adjacency.offsets[s.position[s.tris[i]] + 1]++;
+			for (size_t i = 0; i < vertexCount; i++)
+				s.adjacency.offsets[i + 1] += s.adjacency.offsets[i];
+
+			std::vector<unsigned int> fill(s.adjacency.offsets.begin(), s.adjacency.offsets.end() - 1);
+			s.adjacency.triangles.resize(s.tris.size());
+			for (size_t t = 0; t < triangleCount; t++)
+				for (unsigned int k = 0; k < 3; k++)
+					s.adjacency.triangles[fill[PositionOf(s, (unsigned int)t, k)]++] = (unsigned int)t;
+		}
+
+		// Finds a triangle with the directed edge a -> b (by position),
+		// returning it and the corner that holds a, or None if there isn't one
+		unsigned int FindEdge(const State& s, unsigned int a, unsigned int b, unsigned int& corner)
+		{
+			for (unsigned int i = s.adjacency.offsets[a]; i < s.adjacency.offsets[a + 1]; i++)
+			{
+				unsigned int t = s.adjacency.triangles[i];
+				for (unsigned int k = 0; k < 3; k++)
+				{
+					if (PositionOf(s, t, k) == a && PositionOf(s, t, (k + 1) % 3) == b)
+					{
+						corner = k;
+						return t;
+					}
+				}
+			}
+			return None;
+		}
+
+		// Plane quadrics for every face, plus edge quadrics that hold open
+		// borders and attribute seams in place. Only done once, on the
+		// original triangles, so collapses remember the surface they replaced.
+		void BuildQuadrics(State& s)
+		{
+			s.quadrics.assign(s.position.size(), Quadric());
+			size_t triangleCount = s.tris.size() / 3;
+
+			for (unsigned int t = 0; t < triangleCount; t++)
+			{
+				const XMFLOAT3& p0 = s.verts[s.tris[t * 3 + 0]].Position;
+				const XMFLOAT3& p1 = s.verts[s.tris[t * 3 + 1]].Position;
+				const XMFLOAT3& p2 = s.verts[s.tris[t * 3 + 2]].Position;
+
+				double n[3];
+				FaceNormal(p0, p1, p2, n);
+				double length = std::sqrt(Dot(n, n));
+				if (length == 0.0)
+					continue;
+
+				n[0] /= length; n[1] /= length; n[2] /= length;
+				double d = -(n[0] * p0.x + n[1] * p0.y + n[2] * p0.z);
+				for (unsigned int k = 0; k < 3; k++)
+					AddPlane(s.quadrics[PositionOf(s, t, k)], n[0], n[1], n[2], d, length * 0.5);
+
+				for (unsigned int k = 0; k < 3; k++)
+				{
+					unsigned int a = PositionOf(s, t, k);
+					unsigned int b = PositionOf(s, t, (k + 1) % 3);
+
+					// Border if nothing shares the edge, seam if whatever does uses other vertices
+					unsigned int twinCorner = 0;
+					unsigned int twin = FindEdge(s, b, a, twinCorner);
+					bool border = twin == None;
+					bool seam = !border &&
+						(s.tris[twin * 3 + twinCorner] != s.tris[t * 3 + (k + 1) % 3] ||
+						s.tris[twin * 3 + (twinCorner + 1) % 3] != s.tris[t * 3 + k]);
+					if (!border && !seam)
+						continue;
+
+					const XMFLOAT3& pa = s.verts[s.tris[t * 3 + k]].Position;
+					const XMFLOAT3& pb = s.verts[s.tris[t * 3 + (k + 1) % 3]].Position;
+					double edge[3], edgeNormal[3];
+					Sub(pb, pa, edge);
+					Cross(edge, n, edgeNormal);
+					double edgeLength = std::sqrt(Dot(edgeNormal, edgeNormal));
+					if (edgeLength == 0.0)
+						continue;
+
+					edgeNormal[0] /= edgeLength; edgeNormal[1] /= edgeLength; edgeNormal[2] /= edgeLength;
+					double ed = -(edgeNormal[0] * pa.x + edgeNormal[1] * pa.y + edgeNormal[2] * pa.z);
+					double weight = edgeLength * edgeLength * BorderWeight;
+					AddPlane(s.quadrics[a], edgeNormal[0], edgeNormal[1], edgeNormal[2], ed, weight);
+					AddPlane(s.quadrics[b], edgeNormal[0], edgeNormal[1], edgeNormal[2], ed, weight);
+				}
+			}
+		}
+
+		// How far moving u onto v takes it from the surface u stands for
+		inline double CollapseCost(const State& s, unsigned int u, unsigned int v)
+		{
+			return Evaluate(s.quadrics[u], s.verts[v].Position);
+		}
+
+		// Checks that moving position u onto position v keeps the mesh manifold,
+		// doesn't flip any triangle and has a single destination for every vertex
+		// at u (so seams move along themselves). On success, remap receives those
+		// destinations and removed the number of triangles that disappear.
+		bool CanCollapse(const State& s, unsigned int u, unsigned int v,
+			std::vector<unsigned int>& mark, unsigned int& markStamp,
+			std::vector<std::pair<unsigned int, unsigned int>>& remap, unsigned int& removed)
+		{
+			remap.clear();
+			removed = 0;
+			markStamp += 2;
+
+			const XMFLOAT3& target = s.verts[v].Position;
+			for (unsigned int i = s.adjacency.offsets[u]; i < s.adjacency.offsets[u + 1]; i++)
+			{
+				unsigned int t = s.adjacency.triangles[i];
+				unsigned int ku = None, kv = None;
+				for (unsigned int k = 0; k < 3; k++)
+				{
+					unsigned int p = PositionOf(s, t, k);
+					if (p == u) ku = k;
+					else if (p == v) kv = k;
+					else mark[p] = markStamp;
+				}
+
+				// Record where this triangle's vertex at u has to go
+				unsigned int wedge = s.tris[t * 3 + ku];
+				unsigned int destination = kv == None ? None : s.tris[t * 3 + kv];
+				bool found = false;
+				for (std::pair<unsigned int, unsigned int>& r : remap)
+				{
+					if (r.first != wedge)
+						continue;
+
+					found = true;
+					if (destination != None && r.second != None && r.second != destination)
+						return false;
+					if (destination != None)
+						r.second = destination;
+				}
+				if (!found)
+					remap.push_back(std::make_pair(wedge, destination));
+
+				if (kv != None)
+				{
+					removed++;
+					continue;
+				}
+
+				// This triangle survives, so make sure it doesn't flip over
+				const XMFLOAT3* p[3] =
+				{
+					&s.verts[s.tris[t * 3 + 0]].Position,
+					&s.verts[s.tris[t * 3 + 1]].Position,
+					&s.verts[s.tris[t * 3 + 2]].Position,
+				};
+				double before[3], after[3];
+				FaceNormal(*p[0], *p[1], *p[2], before);
+				p[ku] = &target;
+				FaceNormal(*p[0], *p[1], *p[2], after);
+
+				double dot = Dot(before, after);
+				if (dot <= 0.0 || dot * dot < MinNormalDot * MinNormalDot * Dot(before, before) * Dot(after, after))
+					return false;
+			}
+
+			// Every vertex at u needs somewhere to go
+			for (const std::pair<unsigned int, unsigned int>& r : remap)
+				if (r.second == None)
+					return false;
+
+			// Link condition: u and v may only share the neighbors opposite their
+			// shared edge, otherwise the collapse pinches the surface together
+			unsigned int shared = 0;
+			for (unsigned int i = s.adjacency.offsets[v]; i < s.adjacency.offsets[v + 1]; i++)
+			{
+				unsigned int t = s.adjacency.triangles[i];
+				for (unsigned int k = 0; k < 3; k++)
+				{
+					unsigned int p = PositionOf(s, t, k);
+					if (mark[p] == markStamp)
+					{
+						mark[p] = markStamp + 1;
+						shared++;
+					}
+				}
+			}
+
+			return removed > 0 && shared <= removed;
+		}
+
+		// One round of non-overlapping collapses, cheapest first
+		size_t CollapsePass(State& s, size_t triangleGoal, double maxErrorSq, double& worstError)
+		{
+			size_t vertexCount = s.position.size();
+			size_t triangleCount = s.tris.size() / 3;
+
+			// Count the open border edges at each position
+			std::vector<unsigned int> borderEdges(vertexCount, 0);
+			std::vector<unsigned char> edgeIsBorder(s.tris.size(), 0);
+			for (unsigned int t = 0; t < triangleCount; t++)
+			{
+				for (unsigned int k = 0; k < 3; k++)
+				{
+					unsigned int a = PositionOf(s, t, k);
+					unsigned int b = PositionOf(s, t, (k + 1) % 3);
+					unsigned int corner;
+					if (FindEdge(s, b, a, corner) == None)
+					{
+						edgeIsBorder[t * 3 + k] = 1;
+						borderEdges[a]++;
+						borderEdges[b]++;
+					}
+				}
+			}
+
+			// Border positions may only slide along the border, and
+			// positions where several borders meet can't move at all
+			std::vector<Collapse> candidates;
+			candidates.reserve(s.tris.size());
+			for (unsigned int t = 0; t < triangleCount; t++)
+			{
+				for (unsigned int k = 0; k < 3; k++)
+				{
+					unsigned int a = PositionOf(s, t, k);
+					unsigned int b = PositionOf(s, t, (k + 1) % 3);
+					bool border = edgeIsBorder[t * 3 + k] != 0;
+					if (a == b || (!border && a > b))
+						continue;
+
+					bool aMoves = borderEdges[a] == 0 || (border && borderEdges[a] == 2);
+					bool bMoves = borderEdges[b] == 0 || (border && borderEdges[b] == 2);
+					double costAB = aMoves ? CollapseCost(s, a, b) : HUGE_VAL;
+					double costBA = bMoves ? CollapseCost(s, b, a) : HUGE_VAL;
+					if (!aMoves && !bMoves)
+						continue;
+
+					Collapse c;
+					c.u = costAB <= costBA ? a : b;
+					c.v = costAB <= costBA ? b : a;
+					c.cost = costAB <= costBA ? costAB : costBA;
+					if (c.cost <= maxErrorSq)
+						candidates.push_back(c);
+				}
+			}
+
+			std::sort(candidates.begin(), candidates.end(),
+				[](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+			// Positions touched by a collapse are left alone for the rest of the
+			// pass, so every check below sees the triangles as they really are
+			std::vector<unsigned char> locked(vertexCount, 0);
+			std::vector<unsigned int> mark(vertexCount, 0);
+			unsigned int markStamp = 0;
+			std::vector<unsigned int> vertexRemap(vertexCount, None);
+			std::vector<std::pair<unsigned int, unsigned int>> remap;
+
+			size_t removedTotal = 0;
+			size_t collapses = 0;
+			for (const Collapse& c : candidates)
+			{
+				if (triangleCount - removedTotal <= triangleGoal)
+					break;
+				if (locked[c.u] || locked[c.v])
+					continue;
+
+				unsigned int removed = 0;
+				if (!CanCollapse(s, c.u, c.v, mark, markStamp, remap, removed))
+					continue;
+
+				for (const std::pair<unsigned int, unsigned int>& r : remap)
+					vertexRemap[r.first] = r.second;
+				AddQuadric(s.quadrics[c.v], s.quadrics[c.u]);
+
+				locked[c.u] = locked[c.v] = 1;
+				for (unsigned int i = s.adjacency.offsets[c.u]; i < s.adjacency.offsets[c.u + 1]; i++)
+					for (unsigned int k = 0; k < 3; k++)
+						locked[PositionOf(s, s.adjacency.triangles[i], k)] = 1;
+
+				removedTotal += removed;
+				collapses++;
+				if (c.cost > worstError)
+					worstError = c.cost;
+			}
+
+			if (collapses == 0)
+				return 0;
+
+			// Apply the remap, dropping triangles that collapsed to a line
+			size_t write = 0;
+			for (size_t t = 0; t < triangleCount; t++)
+			{
+				unsigned int tri[3];
+				for (unsigned int k = 0; k < 3; k++)
+				{
+					unsigned int index = s.tris[t * 3 + k];
+					tri[k] = vertexRemap[index] == None ? index : vertexRemap[index];
+				}
+
+				if (s.position[tri[0]] == s.position[tri[1]] ||
+					s.position[tri[1]] == s.position[tri[2]] ||
+					s.position[tri[2]] == s.position[tri[0]])
+					continue;
+
+				s.tris[write++] = tri[0];
+				s.tris[write++] = tri[1];
+				s.tris[write++] = tri[2];
+			}
+			s.tris.resize(write);
+			return collapses;
+		}
+
+		// Welds positions, drops degenerate triangles and builds the quadrics
+		void Begin(State& s, const Vertex* verts, size_t vertexCount, const unsigned int* indices, size_t indexCount)
+		{
+			s.verts = verts;
+
+			// Vertices that only differ by normal or UV share a position
+			s.position.resize(vertexCount);
+			std::unordered_map<XMFLOAT3, unsigned int, PositionHash, PositionEqual> firstAtPosition;
+			firstAtPosition.reserve(vertexCount);
+			for (unsigned int i = 0; i < vertexCount; i++)
+				s.position[i] = firstAtPosition.insert(std::make_pair(verts[i].Position, i)).first->second;
+
+			// Triangles that are already degenerate have nothing to contribute
+			s.tris.reserve(indexCount);
+			for (size_t i = 0; i + 2 < indexCount; i += 3)
+			{
+				unsigned int a = s.position[indices[i]], b = s.position[indices[i + 1]], c = s.position[indices[i + 2]];
+				if (a != b && b != c && c != a)
+					s.tris.insert(s.tris.end(), indices + i, indices + i + 3);
+			}
+
+			BuildAdjacency(s);
+			BuildQuadrics(s);
+		}
+
+		// Collapses until the goal or the error limit is reached. The state can
+		// keep going afterwards, which is how a whole LOD chain comes out of one run.
+		void Run(State& s, size_t triangleGoal, float maxError, double& worstError)
+		{
+			double maxErrorSq = (double)maxError * maxError;
+			while (s.tris.size() / 3 > triangleGoal)
+			{
+				if (CollapsePass(s, triangleGoal, maxErrorSq, worstError) == 0)
+					break;
+				BuildAdjacency(s);
+			}
+		}
+
+		float BoundingRadius(const Vertex* verts, const std::vector<unsigned int>& indices)
+		{
+			if (indices.empty())
+				return 0.0f;
+
+			XMFLOAT3 minP = verts[indices[0]].Position;
+			XMFLOAT3 maxP = minP;
+			for (unsigned int index : indices)
+			{
+				const XMFLOAT3& p = verts[index].Position;
+				minP = XMFLOAT3(std::min(minP.x, p.x), std::min(minP.y, p.y), std::min(minP.z, p.z));
+				maxP = XMFLOAT3(std::max(maxP.x, p.x), std::max(maxP.y, p.y), std::max(maxP.z, p.z));
+			}
+
+			XMFLOAT3 center((minP.x + maxP.x) * 0.5f, (minP.y + maxP.y) * 0.5f, (minP.z + maxP.z) * 0.5f);
+			float radiusSq = 0.0f;
+			for (unsigned int index : indices)
+			{
+				const XMFLOAT3& p = verts[index].Position;
+				float dx = p.x - center.x, dy = p.y - center.y, dz = p.z - center.z;
+				radiusSq = std::max(radiusSq, dx * dx + dy * dy + dz * dz);
+			}
+			return std::sqrt(radiusSq);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Simplifies a triangle list without changing its vertices
+//
+// verts            - The vertex array the indices refer to
+// indices          - Source triangle list
+// destination      - Receives the simplified triangle list
+//                    (room for indexCount indices)
+// targetIndexCount - Stop once this many indices remain
+// maxError         - Largest object-space distance any
+//                    collapse may move the surface
+// resultError      - Receives the largest error used
+// --------------------------------------------------------
+size_t MeshSimplifier::Simplify(const Vertex* verts, size_t vertexCount,
+	const unsigned int* indices, size_t indexCount,
+	unsigned int* destination, size_t targetIndexCount,
+	float maxError, float* resultError)
+{
+	State s;
+	Begin(s, verts, vertexCount, indices, indexCount);
+
+	double worstError = 0.0;
+	Run(s, targetIndexCount / 3, maxError, worstError);
+
+	if (resultError)
+		*resultError = (float)std::sqrt(worstError);
+
+	memcpy(destination, s.tris.data(), s.tris.size() * sizeof(unsigned int));
+	return s.tris.size();
+}
+
+// --------------------------------------------------------
+// Builds LODs 1+ with a single simplification run that
+// stops at each target in turn, so the cost is about that
+// of the coarsest level and each level's error is still
+// measured against the full resolution surface. The levels
+// are appended to the end of the index array.
+//
+// The run only sees the vertices LOD 0 actually uses, so
+// simplifying one small part of a big mesh stays cheap.
+// --------------------------------------------------------
+std::vector<MeshLod> MeshSimplifier::BuildLodChain(const Vertex* verts, size_t vertexCount,
+	std::vector<unsigned int>& indices, unsigned int indexOffset, unsigned int indexCount,
+	const LodTarget* targets, size_t targetCount)
+{
+	std::vector<MeshLod> lods;
+	MeshLod full = { indexOffset, indexCount, 0.0f };
+	lods.push_back(full);
+	if (indexCount == 0)
+		return lods;
+
+	// Gather LOD 0's vertices into a compact local array
+	const unsigned int None = ~0u;
+	std::vector<unsigned int> globalToLocal(vertexCount, None);
+	std::vector<unsigned int> localToGlobal;
+	std::vector<Vertex> localVerts;
+	std::vector<unsigned int> localIndices(indexCount);
+	for (unsigned int i = 0; i < indexCount; i++)
+	{
+		unsigned int v = indices[indexOffset + i];
+		if (globalToLocal[v] == None)
+		{
+			globalToLocal[v] = (unsigned int)localToGlobal.size();
+			localToGlobal.push_back(v);
+			localVerts.push_back(verts[v]);
+		}
+		localIndices[i] = globalToLocal[v];
+	}
+
+	float radius = BoundingRadius(localVerts.data(), localIndices);
+	size_t sourceTriangles = indexCount / 3;
+
+	State s;
+	Begin(s, localVerts.data(), localVerts.size(), localIndices.data(), localIndices.size());
+
+	double worstError = 0.0;
+	for (size_t i = 0; i < targetCount; i++)
+	{
+		Run(s, (size_t)(sourceTriangles * targets[i].triangleRatio), targets[i].maxError * radius, worstError);
+
+		size_t count = s.tris.size();
+		if (count == 0 || count > lods.back().indexCount * MinLodReduction)
+			continue;
+
+		// Optimize a copy, since the state's triangles are still needed
+		std::vector<unsigned int> lodIndices(s.tris);
+		MeshOptimizer::OptimizeVertexCache(&lodIndices[0], count, localVerts.size());
+
+		MeshLod lod;
+		lod.indexOffset = (unsigned int)indices.size();
+		lod.indexCount = (unsigned int)count;
+		lod.error = (float)std::sqrt(worstError);
+		for (unsigned int index : lodIndices)
+			indices.push_back(localToGlobal[index]);
+		lods.push_back(lod);
+	}
+
+	return lods;
+}
+
+void MeshSimplifier::PrintLodChain(const std::vector<MeshLod>& lods)
+{
+	printf("LOD chain:");
+	for (size_t i = 0; i < lods.size(); i++)
+		printf(" %s%u tris (error %.3g)", i ? "-> " : "", lods[i].indexCount / 3, lods[i].error);
+	printf("\n");
+}
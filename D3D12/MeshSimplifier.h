@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "Vertex.h"
+
+// One level of detail: a range of the mesh's shared index
+// buffer and how far (in object space) it strays from the
+// full resolution surface
+struct MeshLod
+{
+	unsigned int indexOffset;
+	unsigned int indexCount;
+	float error;
+};
+
+// What to aim for at each level of a LOD chain
+struct LodTarget
+{
+	float triangleRatio;	// Fraction of LOD 0's triangles to keep
+	float maxError;			// Largest allowed error, relative to the mesh's bounding radius
+};
+
+// --------------------------------------------------------
+// Quadric error metric mesh simplification
+//
+// Edges are collapsed onto one of their existing vertices,
+// cheapest first, so every LOD indexes the same vertex
+// buffer. Vertices are matched by position, which lets
+// collapses run along UV and normal seams without tearing
+// them, and open borders only ever collapse along the
+// border. Nothing here touches the GPU.
+// --------------------------------------------------------
+namespace MeshSimplifier
+{
+	// Levels generated by Mesh when loading a file
+	const LodTarget DefaultLodTargets[] =
+	{
+		{ 0.5f, 0.01f },
+		{ 0.25f, 0.02f },
+		{ 0.125f, 0.04f },
+		{ 0.0625f, 0.08f },
+	};
+
+	// Collapses edges until at most targetIndexCount indices remain, or until
+	// the next collapse would exceed maxError (an object-space distance).
+	// Returns the new index count; resultError receives the error reached.
+	size_t Simplify(const Vertex* verts, size_t vertexCount,
+		const unsigned int* indices, size_t indexCount,
+		unsigned int* destination, size_t targetIndexCount,
+		float maxError, float* resultError = 0);
+
+	// Simplifies LOD 0 (indexCount indices starting at indexOffset) down through each
+	// target in turn and appends each level's cache-optimized indices to the array. Levels that can't get
+	// meaningfully smaller than the one before them (see maxError) are skipped.
+	std::vector<MeshLod> BuildLodChain(const Vertex* verts, size_t vertexCount,
+		std::vector<unsigned int>& indices, unsigned int indexOffset, unsigned int indexCount,
+		const LodTarget* targets, size_t targetCount);
+
+	void PrintLodChain(const std::vector<MeshLod>& lods);
+}
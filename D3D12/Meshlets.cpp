@@ -0,0 +1,371 @@
+#include "Meshlets.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+using namespace DirectX;
+
+namespace Meshlets
+{
+	// Annonymous namespace to hold helpers
+	// only accessible in this file
+	namespace
+	{
+		const unsigned char NotInMeshlet = 0xFF;
+
+		// How much a triangle facing away from the meshlet counts against it,
+		// relative to the cost of one new vertex
+		const float ConeWeight = 0.5f;
+
+		// Cones wider than ~84 degrees can't cull anything worthwhile
+		const float MinConeDot = 0.1f;
+
+		inline XMFLOAT3 Sub(const XMFLOAT3& a, const XMFLOAT3& b) { return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z); }
+		inline float Dot(const XMFLOAT3& a, const XMFLOAT3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+		inline XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b)
+		{
+			return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+		}
+
+		inline XMFLOAT3 Normalize(const XMFLOAT3& v)
+		{
+			float length = std::sqrt(Dot(v, v));
+			return length > 0.0f ? XMFLOAT3(v.x / length, v.y / length, v.z / length) : XMFLOAT3(0, 0, 0);
+		}
+
+		// Row-vector 4x4 multiply, matching DirectXMath's conventions
+		XMFLOAT4X4 Multiply(const XMFLOAT4X4& a, const XMFLOAT4X4& b)
+		{
+			XMFLOAT4X4 result;
+			for (int r = 0; r < 4; r++)
+				for (int c = 0; c < 4; c++)
+					result.m[r][c] = a.m[r][0] * b.m[0][c] + a.m[r][1] * b.m[1][c] + a.m[r][2] * b.m[2][c] + a.m[r][3] * b.m[3][c];
+			return result;
+		}
+
+		inline XMFLOAT4 NormalizePlane(float a, float b, float c, float d)
+		{
+			float length = std::sqrt(a * a + b * b + c * c);
+			return length > 0.0f ? XMFLOAT4(a / length, b / length, c / length, d / length) : XMFLOAT4(0, 0, 0, 0);
+		}
+
+		// The front face's outward normal (clockwise winding, as the rasterizer sees it)
+		inline XMFLOAT3 FaceNormal(const Vertex* verts, const unsigned int* tri)
+		{
+			const XMFLOAT3& p0 = verts[tri[0]].Position;
+			return Normalize(Cross(Sub(verts[tri[1]].Position, p0), Sub(verts[tri[2]].Position, p0)));
+		}
+
+		// Bounding sphere around the box of the meshlet's vertices,
+		// and the narrowest cone around the average normal
+		void ComputeBounds(Meshlet& meshlet, const MeshletData& data, const Vertex* verts)
+		{
+			const unsigned int* meshletVerts = &data.vertices[meshlet.vertexOffset];
+			XMFLOAT3 minP = verts[meshletVerts[0]].Position;
+			XMFLOAT3 maxP = minP;
+			for (unsigned int i = 1; i < meshlet.vertexCount; i++)
+			{
+				const XMFLOAT3& p = verts[meshletVerts[i]].Position;
+				minP = XMFLOAT3(fminf(minP.x, p.x), fminf(minP.y, p.y), fminf(minP.z, p.z));
+				maxP = XMFLOAT3(fmaxf(maxP.x, p.x), fmaxf(maxP.y, p.y), fmaxf(maxP.z, p.z));
+			}
+
+			meshlet.center = XMFLOAT3((minP.x + maxP.x) * 0.5f, (minP.y + maxP.y) * 0.5f, (minP.z + maxP.z) * 0.5f);
+			float radiusSq = 0.0f;
+			for (unsigned int i = 0; i < meshlet.vertexCount; i++)
+			{
+				XMFLOAT3 d = Sub(verts[meshletVerts[i]].Position, meshlet.center);
+				radiusSq = fmaxf(radiusSq, Dot(d, d));
+			}
+			meshlet.radius = std::sqrt(radiusSq);
+
+			XMFLOAT3 normals[MaxTriangles];
+			XMFLOAT3 axis(0, 0, 0);
+			for (unsigned int t = 0; t < meshlet.triangleCount; t++)
+			{
+				const unsigned char* local = &data.triangles[meshlet.triangleOffset + t * 3];
+				unsigned int tri[3] = { meshletVerts[local[0]], meshletVerts[local[1]], meshletVerts[local[2]] };
+				normals[t] = FaceNormal(verts, tri);
+				axis = XMFLOAT3(axis.x + normals[t].x, axis.y + normals[t].y, axis.z + normals[t].z);
+			}
+
+			meshlet.coneAxis = Normalize(axis);
+			float minDot = 1.0f;
+			for (unsigned int t = 0; t < meshlet.triangleCount; t++)
+			{
+				// Degenerate triangles are never drawn, so they don't widen the cone
+				if (Dot(normals[t], normals[t]) > 0.0f)
+					minDot = fminf(minDot, Dot(normals[t], meshlet.coneAxis));
+			}
+
+			meshlet.coneCutoff = minDot <= MinConeDot ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+			meshlet.coneApex = meshlet.center;
+			meshlet.padding = 0.0f;
+			if (meshlet.coneCutoff >= 1.0f)
+				return;
+
+			// Slide the apex back along the axis until it's behind every triangle's plane
+			float maxT = 0.0f;
+			for (unsigned int t = 0; t < meshlet.triangleCount; t++)
+			{
+				float facing = Dot(normals[t], meshlet.coneAxis);
+				if (facing <= 0.0f)
+					continue;
+
+				const unsigned char* local = &data.triangles[meshlet.triangleOffset + t * 3];
+				XMFLOAT3 toCenter = Sub(meshlet.center, verts[meshletVerts[local[0]]].Position);
+				maxT = fmaxf(maxT, Dot(toCenter, normals[t]) / facing);
+			}
+
+			meshlet.coneApex = XMFLOAT3(
+				meshlet.center.x - meshlet.coneAxis.x * maxT,
+				meshlet.center.y - meshlet.coneAxis.y * maxT,
+				meshlet.center.z - meshlet.coneAxis.z * maxT);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Greedily partitions a triangle list into meshlets
+//
+// verts   - The vertex array the indices refer to
+// indices - Triangle list (ideally already optimized for
+//           the vertex cache, which gives better seeds)
+// data    - Meshlets are appended to whatever it holds
+// --------------------------------------------------------
+void Meshlets::Build(const Vertex* verts, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+	MeshletData& data)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Unused triangles around each vertex. Used triangles are swapped out
+	// of the live part of each list, so the search below stays short.
+	std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+	std::vector<unsigned int> liveCounts(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		liveCounts[indices[i]]++;
+	for (size_t i = 0; i < vertexCount; i++)
+		adjacencyOffsets[i + 1] = adjacencyOffsets[i] + liveCounts[i];
+
+	std::vector<unsigned int> adjacency(triangleCount * 3);
+	std::fill(liveCounts.begin(), liveCounts.end(), 0);
+	for (size_t t = 0; t < triangleCount; t++)
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			unsigned int v = indices[t * 3 + k];
+			adjacency[adjacencyOffsets[v] + liveCounts[v]++] = (unsigned int)t;
+		}
+
+	std::vector<XMFLOAT3> normals(triangleCount);
+	for (size_t t = 0; t < triangleCount; t++)
+		normals[t] = FaceNormal(verts, &indices[t * 3]);
+
+	std::vector<bool> used(triangleCount, false);
+	std::vector<unsigned char> localIndex(vertexCount, NotInMeshlet);
+	size_t nextUnused = 0;
+
+	Meshlet meshlet = {};
+	meshlet.vertexOffset = (unsigned int)data.vertices.size();
+	meshlet.triangleOffset = (unsigned int)data.triangles.size();
+	XMFLOAT3 normalSum(0, 0, 0);
+
+	auto finishMeshlet = [&]()
+	{
+		if (meshlet.triangleCount == 0)
+			return;
+
+		ComputeBounds(meshlet, data, verts);
+		data.meshlets.push_back(meshlet);
+
+		for (unsigned int i = 0; i < meshlet.vertexCount; i++)
+			localIndex[data.vertices[meshlet.vertexOffset + i]] = NotInMeshlet;
+
+		meshlet = {};
+		meshlet.vertexOffset = (unsigned int)data.vertices.size();
+		meshlet.triangleOffset = (unsigned int)data.triangles.size();
+		normalSum = XMFLOAT3(0, 0, 0);
+	};
+
+	for (size_t added = 0; added < triangleCount; added++)
+	{
+		// Look for the best unused triangle touching the meshlet
+		unsigned int best = ~0u;
+		float bestScore = 0.0f;
+		XMFLOAT3 axis = Normalize(normalSum);
+		for (unsigned int i = 0; i < meshlet.vertexCount; i++)
+		{
+			unsigned int v = data.vertices[meshlet.vertexOffset + i];
+			for (unsigned int a = 0; a < liveCounts[v]; a++)
+			{
+				unsigned int t = adjacency[adjacencyOffsets[v] + a];
+				unsigned int extra =
+					(localIndex[indices[t * 3 + 0]] == NotInMeshlet) +
+					(localIndex[indices[t * 3 + 1]] == NotInMeshlet) +
+					(localIndex[indices[t * 3 + 2]] == NotInMeshlet);
+				if (meshlet.vertexCount + extra > MaxVertices)
+					continue;
+
+				float score = extra + ConeWeight * (1.0f - Dot(normals[t], axis));
+				if (best == ~0u || score < bestScore)
+				{
+					best = t;
+					bestScore = score;
+				}
+			}
+		}
+
+		// Nothing connected fits, so start over at the next unused triangle
+		if (best == ~0u)
+		{
+			finishMeshlet();
+			while (used[nextUnused])
+				nextUnused++;
+			best = (unsigned int)nextUnused;
+		}
+
+		// Add it, along with any vertices the meshlet doesn't have yet
+		unsigned char local[3];
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			unsigned int v = indices[best * 3 + k];
+			if (localIndex[v] == NotInMeshlet)
+			{
+				localIndex[v] = (unsigned char)meshlet.vertexCount++;
+				data.vertices.push_back(v);
+			}
+			local[k] = localIndex[v];
+
+			// Swap the triangle out of this vertex's live list
+			unsigned int* live = &adjacency[adjacencyOffsets[v]];
+			for (unsigned int a = 0; a < liveCounts[v]; a++)
+			{
+				if (live[a] == best)
+				{
+					live[a] = live[--liveCounts[v]];
+					break;
+				}
+			}
+		}
+
+		data.triangles.insert(data.triangles.end(), local, local + 3);
+		meshlet.triangleCount++;
+		used[best] = true;
+		normalSum = XMFLOAT3(normalSum.x + normals[best].x, normalSum.y + normals[best].y, normalSum.z + normals[best].z);
+
+		if (meshlet.triangleCount == MaxTriangles || meshlet.vertexCount == MaxVertices)
+			finishMeshlet();
+	}
+
+	finishMeshlet();
+}
+
+// --------------------------------------------------------
+// Extracts the frustum planes from world * view * projection
+// (so they come out in object space already), and moves the
+// camera into object space with the inverse of the world
+// matrix's affine part
+// --------------------------------------------------------
+MeshletCullView Meshlets::MakeCullView(const XMFLOAT4X4& world, const XMFLOAT4X4& view,
+	const XMFLOAT4X4& projection, XMFLOAT3 cameraPosition)
+{
+	MeshletCullView cullView;
+	XMFLOAT4X4 m = Multiply(Multiply(world, view), projection);
+
+	// Clip space is -w <= x, y <= w and 0 <= z <= w
+	for (int i = 0; i < 2; i++)
+	{
+		cullView.planes[i * 2 + 0] = NormalizePlane(m.m[0][3] + m.m[0][i], m.m[1][3] + m.m[1][i], m.m[2][3] + m.m[2][i], m.m[3][3] + m.m[3][i]);
+		cullView.planes[i * 2 + 1] = NormalizePlane(m.m[0][3] - m.m[0][i], m.m[1][3] - m.m[1][i], m.m[2][3] - m.m[2][i], m.m[3][3] - m.m[3][i]);
+	}
+	cullView.planes[4] = NormalizePlane(m.m[0][2], m.m[1][2], m.m[2][2], m.m[3][2]);
+	cullView.planes[5] = NormalizePlane(m.m[0][3] - m.m[0][2], m.m[1][3] - m.m[1][2], m.m[2][3] - m.m[2][2], m.m[3][3] - m.m[3][2]);
+
+	// Invert the upper 3x3 by cofactors
+	const float (*w)[4] = world.m;
+	float c00 = w[1][1] * w[2][2] - w[1][2] * w[2][1];
+	float c01 = w[1][2] * w[2][0] - w[1][0] * w[2][2];
+	float c02 = w[1][0] * w[2][1] - w[1][1] * w[2][0];
+	float determinant = w[0][0] * c00 + w[0][1] * c01 + w[0][2] * c02;
+	if (determinant == 0.0f)
+	{
+		cullView.cameraPosition = cameraPosition;
+		return cullView;
+	}
+
+	float inverse[3][3] =
+	{
+		{ c00, w[0][2] * w[2][1] - w[0][1] * w[2][2], w[0][1] * w[1][2] - w[0][2] * w[1][1] },
+		{ c01, w[0][0] * w[2][2] - w[0][2] * w[2][0], w[0][2] * w[1][0] - w[0][0] * w[1][2] },
+		{ c02, w[0][1] * w[2][0] - w[0][0] * w[2][1], w[0][0] * w[1][1] - w[0][1] * w[1][0] },
+	};
+
+	XMFLOAT3 p(cameraPosition.x - w[3][0], cameraPosition.y - w[3][1], cameraPosition.z - w[3][2]);
+	cullView.cameraPosition = XMFLOAT3(
+		(p.x * inverse[0][0] + p.y * inverse[1][0] + p.z * inverse[2][0]) / determinant,
+		(p.x * inverse[0][1] + p.y * inverse[1][1] + p.z * inverse[2][1]) / determinant,
+		(p.x * inverse[0][2] + p.y * inverse[1][2] + p.z * inverse[2][2]) / determinant);
+	return cullView;
+}
+
+// --------------------------------------------------------
+// A meshlet is skipped if its sphere is fully outside any
+// frustum plane, or if the camera sits in the backfacing
+// cone behind its apex, where it's behind every triangle:
+//   dot(normalize(apex - camera), axis) >= cutoff
+// --------------------------------------------------------
+size_t Meshlets::Cull(const MeshletData& data, unsigned int firstMeshlet, unsigned int meshletCount,
+	const MeshletCullView& cullView, std::vector<unsigned int>& out, MeshletCullStats* stats)
+{
+	out.clear();
+
+	for (unsigned int m = firstMeshlet; m < firstMeshlet + meshletCount; m++)
+	{
+		const Meshlet& meshlet = data.meshlets[m];
+		if (stats)
+		{
+			stats->meshlets++;
+			stats->triangles += meshlet.triangleCount;
+		}
+
+		bool outside = false;
+		for (int i = 0; i < 6 && !outside; i++)
+		{
+			const XMFLOAT4& plane = cullView.planes[i];
+			outside = plane.x * meshlet.center.x + plane.y * meshlet.center.y + plane.z * meshlet.center.z + plane.w < -meshlet.radius;
+		}
+		if (outside)
+		{
+			if (stats) stats->frustumCulled++;
+			continue;
+		}
+
+		if (meshlet.coneCutoff < 1.0f)
+		{
+			XMFLOAT3 toApex = Sub(meshlet.coneApex, cullView.cameraPosition);
+			if (Dot(toApex, meshlet.coneAxis) >= meshlet.coneCutoff * std::sqrt(Dot(toApex, toApex)))
+			{
+				if (stats) stats->backfaceCulled++;
+				continue;
+			}
+		}
+
+		const unsigned int* meshletVerts = &data.vertices[meshlet.vertexOffset];
+		const unsigned char* local = &data.triangles[meshlet.triangleOffset];
+		for (unsigned int i = 0; i < meshlet.triangleCount * 3; i++)
+			out.push_back(meshletVerts[local[i]]);
+
+		if (stats) stats->trianglesDrawn += meshlet.triangleCount;
+	}
+
+	return out.size();
+}
+
+void Meshlets::PrintStats(const MeshletCullStats& stats)
+{
+	printf("Meshlets: %zu, %zu frustum culled, %zu backface culled, %zu of %zu triangles drawn (%.1f%% culled)\n",
+		stats.meshlets, stats.frustumCulled, stats.backfaceCulled, stats.trianglesDrawn, stats.triangles,
+		stats.triangles ? 100.0 * (stats.triangles - stats.trianglesDrawn) / stats.triangles : 0.0);
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "Vertex.h"
+
+// A small, connected cluster of triangles with its own
+// vertex list and the bounds needed to cull it as a whole
+struct Meshlet
+{
+	unsigned int vertexOffset;		// First entry in MeshletData::vertices
+	unsigned int triangleOffset;	// First byte in MeshletData::triangles
+	unsigned int vertexCount;
+	unsigned int triangleCount;
+
+	// Object-space bounding sphere
+	DirectX::XMFLOAT3 center;
+	float radius;
+
+	// Normal cone: no triangle faces more than asin(coneCutoff) away from
+	// coneAxis, and every triangle faces away from a camera inside the cone
+	// behind coneApex. A cutoff of 1 means the cone is too wide to ever cull.
+	DirectX::XMFLOAT3 coneApex;
+	float coneCutoff;
+	DirectX::XMFLOAT3 coneAxis;
+	float padding;
+};
+
+// All of a mesh's meshlets, sharing two flat arrays
+struct MeshletData
+{
+	std::vector<Meshlet> meshlets;
+	std::vector<unsigned int> vertices;		// Indices into the mesh's vertex buffer
+	std::vector<unsigned char> triangles;	// Meshlet-local vertex indices, 3 per triangle
+};
+
+// A camera as seen from a mesh's object space
+struct MeshletCullView
+{
+	DirectX::XMFLOAT4 planes[6];		// Normalized, pointing into the frustum
+	DirectX::XMFLOAT3 cameraPosition;
+};
+
+struct MeshletCullStats
+{
+	size_t meshlets = 0;
+	size_t frustumCulled = 0;
+	size_t backfaceCulled = 0;
+	size_t triangles = 0;
+	size_t trianglesDrawn = 0;
+};
+
+// --------------------------------------------------------
+// Meshlet building and CPU culling
+//
+// Meshlets are grown one triangle at a time from their
+// neighbors, preferring triangles that add no new vertices
+// and face the same way as the rest, so they stay compact
+// and their normal cones stay narrow. Culling works in the
+// mesh's object space on plain matrices, so none of this
+// needs a GPU.
+// --------------------------------------------------------
+namespace Meshlets
+{
+	const unsigned int MaxVertices = 64;
+	const unsigned int MaxTriangles = 124;
+
+	// Meshes with fewer triangles than this are cheaper to draw whole
+	const size_t MinTriangles = 1024;
+
+	// Appends meshlets for the given triangles to data
+	void Build(const Vertex* verts, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+		MeshletData& data);
+
+	// Moves the camera's frustum and position into the object space of the given world matrix
+	MeshletCullView MakeCullView(const DirectX::XMFLOAT4X4& world, const DirectX::XMFLOAT4X4& view,
+		const DirectX::XMFLOAT4X4& projection, DirectX::XMFLOAT3 cameraPosition);
+
+	// Replaces out with the indices of every meshlet in the given range that survives
+	// frustum and backface culling, ready for DrawIndexedInstanced. Returns the index count.
+	size_t Cull(const MeshletData& data, unsigned int firstMeshlet, unsigned int meshletCount,
+		const MeshletCullView& cullView, std::vector<unsigned int>& out, MeshletCullStats* stats = 0);
+
+	void PrintStats(const MeshletCullStats& stats);
+}
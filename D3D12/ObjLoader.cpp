@@ -0,0 +1,815 @@
+#include "ObjLoader.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+#include "VertexWelder.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+using namespace DirectX;
+
+namespace ObjLoader
+{
+	// Annonymous namespace to hold helpers
+	// only accessible in this file
+	namespace
+	{
+		// Every power of ten that a double can represent exactly, which
+		// lets us scale a parsed mantissa with a single correctly-rounded op
+		const double exactPowersOf10[] =
+		{
+			1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+			1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+			1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+
+		inline bool IsDigit(char c) { return (unsigned char)(c - '0') < 10; }
+		inline bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+		inline const char* SkipSpaces(const char* p, const char* end)
+		{
+			while (p < end && IsSpace(*p)) p++;
+			return p;
+		}
+
+		inline const char* SkipLine(const char* p, const char* end)
+		{
+			const char* newline = (const char*)memchr(p, '\n', end - p);
+			return newline ? newline + 1 : end;
+		}
+
+		// --------------------------------------------------------
+		// Reads a decimal float (optional sign, fraction and exponent)
+		// starting at p, skipping any leading spaces. Leaves out untouched
+		// and returns p if there is no number there.
+		// --------------------------------------------------------
+		const char* ScanFloat(const char* p, const char* end, float& out)
+		{
+			const char* start = p = SkipSpaces(p, end);
+
+			bool negative = false;
+			if (p < end && (*p == '-' || *p == '+'))
+			{
+				negative = *p == '-';
+				p++;
+			}
+
+			// Only the first 19 significant digits fit in the mantissa,
+			// any extras just shift the exponent
+			unsigned long long mantissa = 0;
+			int significantDigits = 0;
+			int exponent = 0;
+			bool anyDigits = false;
+
+			while (p < end && IsDigit(*p))
+			{
+				if (significantDigits < 19)
+				{
+					mantissa = mantissa * 10 + (*p - '0');
+					if (mantissa) significantDigits++;
+				}
+				else
+					exponent++;
+
+				anyDigits = true;
+				p++;
+			}
+
+			if (p < end && *p == '.')
+			{
+				p++;
+				while (p < end && IsDigit(*p))
+				{
+					if (significantDigits < 19)
+					{
+						mantissa = mantissa * 10 + (*p - '0');
+						if (mantissa) significantDigits++;
+						exponent--;
+					}
+
+					anyDigits = true;
+					p++;
+				}
+			}
+
+			if (!anyDigits)
+				return start;
+
+			if (p < end && (*p == 'e' || *p == 'E'))
+			{
+				const char* e = p + 1;
+				bool negativeExponent = false;
+				if (e < end && (*e == '-' || *e == '+'))
+				{
+					negativeExponent = *e == '-';
+					e++;
+				}
+
+				// Only treat this as an exponent if digits follow
+				if (e < end && IsDigit(*e))
+				{
+					int value = 0;
+					while (e < end && IsDigit(*e))
+					{
+						if (value < 10000) value = value * 10 + (*e - '0');
+						e++;
+					}
+
+					exponent += negativeExponent ? -value : value;
+					p = e;
+				}
+			}
+
+			double result = (double)mantissa;
+			if (exponent < 0)
+				result = -exponent <= 22 ? result / exactPowersOf10[-exponent] : result * std::pow(10.0, exponent);
+			else if (exponent > 0)
+				result = exponent <= 22 ? result * exactPowersOf10[exponent] : result * std::pow(10.0, exponent);
+
+			out = (float)(negative ? -result : result);
+			return p;
+		}
+
+		// --------------------------------------------------------
+		// Reads the rest of the line starting at p as a name,
+		// without any leading or trailing spaces. The bytes left
+		// in the chunk are worked out as a size that can't go
+		// negative, so the search's bound is plain to see.
+		// --------------------------------------------------------
+		const char* ScanName(const char* p, const char* end, size_t& length)
+		{
+			p = SkipSpaces(p, end);
+			size_t remaining = p < end ? (size_t)(end - p) : 0;
+			const char* lineEnd = (const char*)memchr(p, '\n', remaining);
+			if (!lineEnd) lineEnd = p + remaining;
+			while (lineEnd > p && IsSpace(lineEnd[-1]))
+				lineEnd--;
+
+			length = lineEnd - p;
+			return p;
+		}
+
+		// --------------------------------------------------------
+		// Reads a (possibly negative) decimal integer starting at p.
+		// Leaves out untouched and returns p if there is no number.
+		// --------------------------------------------------------
+		const char* ScanInt(const char* p, const char* end, int& out)
+		{
+			const char* start = p;
+
+			bool negative = false;
+			if (p < end && (*p == '-' || *p == '+'))
+			{
+				negative = *p == '-';
+				p++;
+			}
+
+			if (p >= end || !IsDigit(*p))
+				return start;
+
+			int value = 0;
+			while (p < end && IsDigit(*p))
+			{
+				value = value * 10 + (*p - '0');
+				p++;
+			}
+
+			out = negative ? -value : value;
+			return p;
+		}
+
+		// --------------------------------------------------------
+		// Open-addressing hash table from a corner's 1-based
+		// (position, uv, normal) index triple to the vertex built
+		// for it. Position indices are never zero, so a zero
+		// position marks an empty slot.
+		// --------------------------------------------------------
+		class CornerTable
+		{
+		public:
+
+			void Reserve(size_t expectedCorners)
+			{
+				size_t capacity = 64;
+				while (capacity < expectedCorners * 2)
+					capacity *= 2;
+				Rehash(capacity);
+			}
+
+			// Returns the vertex already mapped to this triple, or maps
+			// it to newVertex and returns that if it hasn't been seen
+			unsigned int FindOrInsert(int pos, int uv, int normal, unsigned int newVertex)
+			{
+				if ((used + 1) * 2 > slots.size())
+					Rehash(slots.size() * 2);
+
+				size_t i = Hash(pos, uv, normal) & mask;
+				while (slots[i].pos != 0)
+				{
+					if (slots[i].pos == pos && slots[i].uv == uv && slots[i].normal == normal)
+						return slots[i].vertex;
+					i = (i + 1) & mask;
+				}
+
+				slots[i] = { pos, uv, normal, newVertex };
+				used++;
+				return newVertex;
+			}
+
+		private:
+
+			struct Slot
+			{
+				int pos, uv, normal;
+				unsigned int vertex;
+			};
+
+			std::vector<Slot> slots;
+			size_t mask = 0;
+			size_t used = 0;
+
+			static size_t Hash(int pos, int uv, int normal)
+			{
+				unsigned long long h = (unsigned int)pos;
+				h = h * 0x9E3779B97F4A7C15ull ^ (unsigned int)uv;
+				h = h * 0x9E3779B97F4A7C15ull ^ (unsigned int)normal;
+				return (size_t)((h * 0x9E3779B97F4A7C15ull) >> 20);
+			}
+
+			void Rehash(size_t capacity)
+			{
+				if (capacity < 64) capacity = 64;
+				std::vector<Slot> old;
+				old.swap(slots);
+				slots.assign(capacity, Slot{});
+				mask = capacity - 1;
+
+				for (Slot& s : old)
+				{
+					if (s.pos == 0) continue;
+					size_t i = Hash(s.pos, s.uv, s.normal) & mask;
+					while (slots[i].pos != 0)
+						i = (i + 1) & mask;
+					slots[i] = s;
+				}
+			}
+		};
+
+		// --------------------------------------------------------
+		// A 1-based v/vt/vn index triple from a face, where a zero
+		// uv or normal index means that attribute wasn't given
+		// --------------------------------------------------------
+		struct Corner
+		{
+			int pos, uv, normal;
+		};
+
+		// --------------------------------------------------------
+		// Turns a negative index, which counts back from the most
+		// recent attribute, into a regular 1-based one. Returns
+		// false if the index points past either end.
+		// --------------------------------------------------------
+		inline bool ResolveIndex(int& index, int countSoFar)
+		{
+			if (index < 0)
+			{
+				index += countSoFar + 1;
+				return index >= 1;
+			}
+			return index <= countSoFar;
+		}
+
+		// --------------------------------------------------------
+		// An o, g or usemtl line. The name points into the file,
+		// and applies from the chunk's given triangle onwards.
+		// --------------------------------------------------------
+		struct NameChange
+		{
+			size_t triangle;
+			bool material;		// usemtl, otherwise o or g
+			const char* name;
+			size_t length;
+		};
+
+		// --------------------------------------------------------
+		// A newline-aligned slice of the file and everything parsed
+		// out of it. Positions, uvs and normals go straight into the
+		// shared arrays at this chunk's base offsets, while faces are
+		// welded locally and remapped once all chunks are done.
+		// --------------------------------------------------------
+		struct Chunk
+		{
+			const char* begin = 0;
+			const char* end = 0;
+
+			// Exact record counts, from CountRecords()
+			size_t positionCount = 0;
+			size_t uvCount = 0;
+			size_t normalCount = 0;
+			size_t faceCount = 0;
+			size_t triangleCount = 0;		// Filled in by ParseChunk()
+
+			// Totals of all earlier chunks
+			size_t positionBase = 0;
+			size_t uvBase = 0;
+			size_t normalBase = 0;
+			size_t indexBase = 0;
+
+			std::vector<Corner> corners;			// Unique corners in order of first use
+			std::vector<unsigned int> indices;		// Triangle list indexing into corners
+			std::vector<unsigned int> remap;		// Chunk corner -> final vertex
+			std::vector<NameChange> nameChanges;	// In file order
+		};
+
+		// Files smaller than this per thread aren't worth splitting
+		const size_t MinChunkBytes = 1024 * 1024;
+
+		// --------------------------------------------------------
+		// Splits the file into up to maxChunks pieces that each end
+		// just after a newline, so no record straddles two chunks
+		// --------------------------------------------------------
+		std::vector<Chunk> SplitIntoChunks(const char* data, size_t size, size_t maxChunks)
+		{
+			size_t chunkCount = size / MinChunkBytes;
+			if (chunkCount > maxChunks) chunkCount = maxChunks;
+			if (chunkCount < 1) chunkCount = 1;
+
+			std::vector<Chunk> chunks;
+			const char* end = data + size;
+			const char* begin = data;
+			for (size_t i = 1; i <= chunkCount && begin < end; i++)
+			{
+				const char* split = i == chunkCount ? end : data + size / chunkCount * i;
+				if (split < begin) split = begin;
+				if (split < end)
+					split = SkipLine(split, end);
+
+				Chunk chunk;
+				chunk.begin = begin;
+				chunk.end = split;
+				chunks.push_back(std::move(chunk));
+				begin = split;
+			}
+
+			return chunks;
+		}
+
+		// --------------------------------------------------------
+		// Counts each kind of record in a chunk, classifying lines
+		// exactly like ParseChunk() so the counts can be used as
+		// offsets into the shared attribute arrays
+		// --------------------------------------------------------
+		void CountRecords(Chunk& chunk)
+		{
+			const char* p = chunk.begin;
+			const char* end = chunk.end;
+			while (p < end)
+			{
+				p = SkipSpaces(p, end);
+				if (p + 1 >= end)
+					break;
+
+				if (p[0] == 'v')
+				{
+					if (p[1] == 'n') chunk.normalCount++;
+					else if (p[1] == 't') chunk.uvCount++;
+					else if (IsSpace(p[1])) chunk.positionCount++;
+				}
+				else if (p[0] == 'f' && IsSpace(p[1]))
+					chunk.faceCount++;
+
+				p = SkipLine(p, end);
+			}
+		}
+
+		// --------------------------------------------------------
+		// Parses one chunk, writing its attributes into the shared
+		// arrays and its faces into the chunk's own corner list.
+		// Faces can only use attributes declared before them, so
+		// indices are validated against the running totals.
+		// --------------------------------------------------------
+		void ParseChunk(Chunk& chunk, XMFLOAT3* positions, XMFLOAT2* uvs, XMFLOAT3* normals)
+		{
+			const char* p = chunk.begin;
+			const char* end = chunk.end;
+
+			int positionsSoFar = (int)chunk.positionBase;
+			int uvsSoFar = (int)chunk.uvBase;
+			int normalsSoFar = (int)chunk.normalBase;
+
+			// Reserve assuming mostly triangles that share most corners
+			chunk.corners.reserve(chunk.faceCount);
+			chunk.indices.reserve(chunk.faceCount * 3);
+
+			// Maps each unique v/vt/vn triple to its corner
+			CornerTable cornerTable;
+			cornerTable.Reserve(chunk.faceCount);
+
+			// The current face, reused so big polygons don't allocate
+			std::vector<Corner> faceCorners;
+			std::vector<unsigned int> faceIndices;
+
+			while (p < end)
+			{
+				p = SkipSpaces(p, end);
+				if (p + 1 >= end)
+					break;
+
+				if (p[0] == 'v' && p[1] == 'n')
+				{
+					XMFLOAT3 norm(0, 0, 0);
+					const char* q = ScanFloat(p + 2, end, norm.x);
+					q = ScanFloat(q, end, norm.y);
+					ScanFloat(q, end, norm.z);
+					normals[normalsSoFar++] = norm;
+				}
+				else if (p[0] == 'v' && p[1] == 't')
+				{
+					XMFLOAT2 uv(0, 0);
+					const char* q = ScanFloat(p + 2, end, uv.x);
+					ScanFloat(q, end, uv.y);
+					uvs[uvsSoFar++] = uv;
+				}
+				else if (p[0] == 'v' && IsSpace(p[1]))
+				{
+					XMFLOAT3 pos(0, 0, 0);
+					const char* q = ScanFloat(p + 1, end, pos.x);
+					q = ScanFloat(q, end, pos.y);
+					ScanFloat(q, end, pos.z);
+					positions[positionsSoFar++] = pos;
+				}
+				else if (p[0] == 'f' && IsSpace(p[1]))
+				{
+					// Read every v/vt/vn corner, where vt and vn are optional
+					faceCorners.clear();
+					bool valid = true;
+
+					const char* q = p + 1;
+					while (true)
+					{
+						q = SkipSpaces(q, end);
+
+						Corner corner{};
+						const char* next = ScanInt(q, end, corner.pos);
+						if (next == q)
+							break;
+
+						q = next;
+						if (q < end && *q == '/')
+						{
+							q = ScanInt(q + 1, end, corner.uv);
+							if (q < end && *q == '/')
+								q = ScanInt(q + 1, end, corner.normal);
+						}
+
+						// OBJ indices are 1-based (zero here means "not given")
+						valid = valid &&
+							ResolveIndex(corner.pos, positionsSoFar) && corner.pos >= 1 &&
+							ResolveIndex(corner.uv, uvsSoFar) &&
+							ResolveIndex(corner.normal, normalsSoFar);
+						faceCorners.push_back(corner);
+					}
+
+					if (valid && faceCorners.size() >= 3)
+					{
+						// Corners that share a v/vt/vn triple share a single vertex
+						faceIndices.resize(faceCorners.size());
+						for (size_t c = 0; c < faceCorners.size(); c++)
+						{
+							const Corner& corner = faceCorners[c];
+							unsigned int newIndex = (unsigned int)chunk.corners.size();
+							faceIndices[c] = cornerTable.FindOrInsert(corner.pos, corner.uv, corner.normal, newIndex);
+							if (faceIndices[c] == newIndex)
+								chunk.corners.push_back(corner);
+						}
+
+						// Fan the polygon out from its first corner, flipping the winding order
+						for (size_t c = 1; c + 1 < faceIndices.size(); c++)
+						{
+							chunk.indices.push_back(faceIndices[0]);
+							chunk.indices.push_back(faceIndices[c + 1]);
+							chunk.indices.push_back(faceIndices[c]);
+						}
+					}
+				}
+				else if ((p[0] == 'o' || p[0] == 'g') && (IsSpace(p[1]) || p[1] == '\n'))
+				{
+					NameChange change = { chunk.indices.size() / 3, false, 0, 0 };
+					change.name = ScanName(p + 1, end, change.length);
+					chunk.nameChanges.push_back(change);
+				}
+				else if (end - p > 6 && memcmp(p, "usemtl", 6) == 0 && IsSpace(p[6]))
+				{
+					NameChange change = { chunk.indices.size() / 3, true, 0, 0 };
+					change.name = ScanName(p + 6, end, change.length);
+					chunk.nameChanges.push_back(change);
+				}
+
+				p = SkipLine(p, end);
+			}
+
+			chunk.triangleCount = chunk.indices.size() / 3;
+		}
+
+		// --------------------------------------------------------
+		// Finds the sub-mesh for a group and material, adding it
+		// (and the material's slot) the first time it's used
+		// --------------------------------------------------------
+		unsigned int FindOrAddSubMesh(const std::string& group, const std::string& material,
+			std::unordered_map<std::string, unsigned int>& subMeshIds,
+			std::unordered_map<std::string, unsigned int>& materialSlots,
+			std::vector<SubMesh>& subMeshes, std::vector<std::string>& materialNames)
+		{
+			// The null can't appear in either name, so keys can't collide
+			std::string key = group;
+			key.push_back('\0');
+			key += material;
+
+			auto found = subMeshIds.find(key);
+			if (found != subMeshIds.end())
+				return found->second;
+
+			auto slot = materialSlots.try_emplace(material, (unsigned int)materialNames.size());
+			if (slot.second)
+				materialNames.push_back(material);
+
+			SubMesh subMesh = {};
+			subMesh.materialSlot = slot.first->second;
+			subMeshes.push_back(subMesh);
+
+			unsigned int id = (unsigned int)subMeshes.size() - 1;
+			subMeshIds.emplace(key, id);
+			return id;
+		}
+
+		// --------------------------------------------------------
+		// Replays every chunk's o/g/usemtl lines in file order to
+		// find each triangle's sub-mesh, one per unique pair of
+		// group and material. Sub-meshes and material slots are
+		// numbered in order of first use. Returns the sub-mesh of
+		// every triangle, with each sub-mesh's indexCount filled in.
+		// --------------------------------------------------------
+		std::vector<unsigned int> AssignSubMeshes(const std::vector<Chunk>& chunks, size_t triangleCount,
+			std::vector<SubMesh>& subMeshes, std::vector<std::string>& materialNames)
+		{
+			std::vector<unsigned int> triangleSubMesh(triangleCount);
+			std::unordered_map<std::string, unsigned int> subMeshIds;	// Keyed by group + '\0' + material
+			std::unordered_map<std::string, unsigned int> materialSlots;
+
+			std::string group;
+			std::string material;
+			unsigned int current = ~0u;	// Looked up when the next triangle needs it
+
+			size_t triangleBase = 0;
+			for (const Chunk& chunk : chunks)
+			{
+				size_t t = 0;
+				for (size_t c = 0; c <= chunk.nameChanges.size(); c++)
+				{
+					size_t runEnd = c < chunk.nameChanges.size() ? chunk.nameChanges[c].triangle : chunk.triangleCount;
+					if (t < runEnd)
+					{
+						if (current == ~0u)
+							current = FindOrAddSubMesh(group, material, subMeshIds, materialSlots, subMeshes, materialNames);
+
+						subMeshes[current].indexCount += (unsigned int)(runEnd - t) * 3;
+						for (; t < runEnd; t++)
+							triangleSubMesh[triangleBase + t] = current;
+					}
+
+					if (c < chunk.nameChanges.size())
+					{
+						const NameChange& change = chunk.nameChanges[c];
+						(change.material ? material : group).assign(change.name, change.length);
+						current = ~0u;
+					}
+				}
+
+				triangleBase += chunk.triangleCount;
+			}
+
+			return triangleSubMesh;
+		}
+
+		// --------------------------------------------------------
+		// Moves each sub-mesh's triangles next to each other (in
+		// sub-mesh order, keeping their file order within each)
+		// and fills in the sub-meshes' index offsets
+		// --------------------------------------------------------
+		void SortBySubMesh(std::vector<unsigned int>& indices, const std::vector<unsigned int>& triangleSubMesh,
+			std::vector<SubMesh>& subMeshes)
+		{
+			std::vector<unsigned int> cursors(subMeshes.size());
+			unsigned int offset = 0;
+			for (size_t i = 0; i < subMeshes.size(); i++)
+			{
+				subMeshes[i].indexOffset = cursors[i] = offset;
+				offset += subMeshes[i].indexCount;
+			}
+
+			// Nothing moves if there's only one
+			if (subMeshes.size() <= 1)
+				return;
+
+			std::vector<unsigned int> sorted(indices.size());
+			for (size_t t = 0; t < triangleSubMesh.size(); t++)
+			{
+				unsigned int& cursor = cursors[triangleSubMesh[t]];
+				memcpy(&sorted[cursor], &indices[t * 3], sizeof(unsigned int) * 3);
+				cursor += 3;
+			}
+			indices.swap(sorted);
+		}
+
+		// --------------------------------------------------------
+		// Builds the final vertex for a corner, flipping the UV
+		// since it's probably "upside down", then flipping Z on
+		// the position and normal (RH to LH)
+		// --------------------------------------------------------
+		inline Vertex MakeVertex(const Corner& corner, const XMFLOAT3* positions, const XMFLOAT2* uvs, const XMFLOAT3* normals)
+		{
+			Vertex v{};
+			v.Position = positions[corner.pos - 1];
+			v.UV = corner.uv > 0 ? uvs[corner.uv - 1] : XMFLOAT2(0, 0);
+			v.Normal = corner.normal > 0 ? normals[corner.normal - 1] : XMFLOAT3(0, 0, 0);
+
+			v.UV.y = 1.0f - v.UV.y;
+			v.Position.z *= -1.0f;
+			v.Normal.z *= -1.0f;
+			return v;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Memory-maps the given .OBJ file and parses it in place
+//
+// fileName      - Path to the .obj file
+// verts         - Receives the final vertices
+// indices       - Receives the final triangle list indices
+// subMeshes     - Receives each group/material's index range
+// materialNames - Receives the usemtl name of each material slot
+// weldEpsilon   - If positive, also merge vertices that are
+//                 this close after the exact v/vt/vn weld
+// printStats    - Print the parse time and how much welding saved
+//
+// Returns false if the file could not be opened
+// --------------------------------------------------------
+bool ObjLoader::LoadFile(const wchar_t* fileName, std::vector<Vertex>& verts, std::vector<unsigned int>& indices,
+	std::vector<SubMesh>& subMeshes, std::vector<std::string>& materialNames, float weldEpsilon, bool printStats)
+{
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	MappedFile file(fileName);
+	if (!file.IsOpen())
+		return false;
+
+	Parse(file.GetData(), file.GetSize(), verts, indices, subMeshes, materialNames);
+
+	std::chrono::duration<double> seconds = std::chrono::high_resolution_clock::now() - startTime;
+
+	// Compare against one vertex per corner, which is what we'd have without welding
+	WeldStats indexWeld;
+	indexWeld.verticesBefore = indices.size();
+	indexWeld.verticesAfter = verts.size();
+	indexWeld.bytesBefore = indices.size() * (sizeof(Vertex) + sizeof(unsigned int));
+	indexWeld.bytesAfter = verts.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned int);
+
+	WeldStats distanceWeld;
+	if (weldEpsilon > 0.0f)
+		distanceWeld = VertexWelder::WeldByDistance(verts, indices, weldEpsilon, &subMeshes);
+
+	if (printStats)
+	{
+		// Report throughput so slow assets are easy to spot in the console
+		double megabytes = file.GetSize() / (1024.0 * 1024.0);
+		printf("Parsed %ls: %.2f MB in %.2f ms (%.1f MB/s), %zu sub-meshes, %zu materials\n",
+			fileName, megabytes, seconds.count() * 1000.0, megabytes / seconds.count(), subMeshes.size(), materialNames.size());
+
+		VertexWelder::PrintStats("Index weld", indexWeld);
+		if (weldEpsilon > 0.0f)
+			VertexWelder::PrintStats("Distance weld", distanceWeld);
+	}
+
+	return true;
+}
+
+// --------------------------------------------------------
+// Parses .OBJ text, supporting positions, uvs and normals
+//
+// Like the original loader, this converts the right-handed
+// model to DirectX's left-handed space by inverting Z on
+// positions and normals, flipping the winding order and
+// flipping the V texture coordinate.
+//
+// Large files are split into newline-aligned chunks that
+// are parsed on separate threads:
+//  1. Count the records in each chunk (in parallel)
+//  2. Prefix-sum the counts into per-chunk attribute offsets
+//  3. Parse each chunk, welding its faces locally (in parallel)
+//  4. Walk the chunks in file order, mapping each chunk's
+//     corners to final vertices through one global table
+//  5. Build vertices and fix up each chunk's indices (in parallel)
+//  6. Replay the o/g/usemtl lines in file order and group
+//     the triangles by sub-mesh
+// Steps 4 and 6 visit everything in the same order a single
+// thread would, so the output doesn't depend on the thread
+// count.
+//
+// threadCount - Maximum threads to use, or 0 for one per core
+// --------------------------------------------------------
+void ObjLoader::Parse(const char* data, size_t size, std::vector<Vertex>& verts, std::vector<unsigned int>& indices,
+	std::vector<SubMesh>& subMeshes, std::vector<std::string>& materialNames, unsigned int threadCount)
+{
+	verts.clear();
+	indices.clear();
+	subMeshes.clear();
+	materialNames.clear();
+
+	if (threadCount == 0)
+		threadCount = Parallel::HardwareThreads();
+
+	std::vector<Chunk> chunks = SplitIntoChunks(data, size, threadCount);
+	if (chunks.empty())
+		return;
+
+	Parallel::Run(chunks.size(), [&](size_t i) { CountRecords(chunks[i]); });
+
+	// Each chunk's attributes start where the previous chunk's end
+	size_t positionCount = 0, uvCount = 0, normalCount = 0;
+	for (Chunk& chunk : chunks)
+	{
+		chunk.positionBase = positionCount;
+		chunk.uvBase = uvCount;
+		chunk.normalBase = normalCount;
+		positionCount += chunk.positionCount;
+		uvCount += chunk.uvCount;
+		normalCount += chunk.normalCount;
+	}
+
+	// Attributes from the file, shared by every chunk
+	std::vector<XMFLOAT3> positions(positionCount);
+	std::vector<XMFLOAT2> uvs(uvCount);
+	std::vector<XMFLOAT3> normals(normalCount);
+
+	Parallel::Run(chunks.size(), [&](size_t i) { ParseChunk(chunks[i], positions.data(), uvs.data(), normals.data()); });
+
+	// A single chunk's corners and indices are already final
+	std::vector<Corner> corners;
+	if (chunks.size() == 1)
+	{
+		corners.swap(chunks[0].corners);
+		indices.swap(chunks[0].indices);
+	}
+	else
+	{
+		// Weld corners across chunks in file order
+		CornerTable cornerTable;
+		cornerTable.Reserve(positionCount);
+		corners.reserve(positionCount);
+
+		size_t indexCount = 0;
+		for (Chunk& chunk : chunks)
+		{
+			chunk.remap.resize(chunk.corners.size());
+			for (size_t c = 0; c < chunk.corners.size(); c++)
+			{
+				const Corner& corner = chunk.corners[c];
+				unsigned int newIndex = (unsigned int)corners.size();
+				chunk.remap[c] = cornerTable.FindOrInsert(corner.pos, corner.uv, corner.normal, newIndex);
+				if (chunk.remap[c] == newIndex)
+					corners.push_back(corner);
+			}
+
+			chunk.indexBase = indexCount;
+			indexCount += chunk.indices.size();
+		}
+
+		indices.resize(indexCount);
+		Parallel::Run(chunks.size(), [&](size_t i)
+			{
+				const Chunk& chunk = chunks[i];
+				unsigned int* out = indices.data() + chunk.indexBase;
+				for (size_t n = 0; n < chunk.indices.size(); n++)
+					out[n] = chunk.remap[chunk.indices[n]];
+			});
+	}
+
+	// Turn each unique corner into a vertex, splitting the work evenly
+	verts.resize(corners.size());
+	size_t ranges = corners.size() >= 65536 ? chunks.size() : 1;
+	Parallel::Run(ranges, [&](size_t i)
+		{
+			size_t first = corners.size() * i / ranges;
+			size_t last = corners.size() * (i + 1) / ranges;
+			for (size_t c = first; c < last; c++)
+				verts[c] = MakeVertex(corners[c], positions.data(), uvs.data(), normals.data());
+		});
+
+	// Make each sub-mesh's triangles a single range
+	std::vector<unsigned int> triangleSubMesh = AssignSubMeshes(chunks, indices.size() / 3, subMeshes, materialNames);
+	SortBySubMesh(indices, triangleSubMesh, subMeshes);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "SubMesh.h"
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Fast .OBJ loading
+//
+// Files are memory-mapped and parsed in place with a small
+// hand-written number scanner, so there are no per-line
+// copies and no locale-dependent sscanf calls. Supports
+// positions, uvs and normals on faces with any number of
+// corners (fanned into triangles) and negative, relative
+// indices, converting to DirectX's left-handed conventions
+// exactly like the original line-by-line loader did.
+//
+// Faces are grouped into sub-meshes by their o/g name and
+// usemtl material, so a multi-part file still loads as one
+// vertex and index array. Each sub-mesh's triangles are
+// contiguous in the index array, in file order.
+//
+// Corners that share the same v/vt/vn index triple are
+// welded into a single vertex, so the index buffer actually
+// shares vertices between triangles.
+//
+// Big files are parsed in newline-aligned chunks on
+// multiple threads, then merged back in file order.
+// --------------------------------------------------------
+namespace ObjLoader
+{
+	// Load and parse the given file, replacing the contents of the arrays. Only the
+	// index range and material slot of each sub-mesh are filled in, and materialNames
+	// gets one usemtl name per slot ("" for faces before any usemtl).
+	// A positive weldEpsilon additionally merges nearly-identical vertices.
+	// printStats reports the parse throughput and what welding saved.
+	bool LoadFile(const wchar_t* fileName, std::vector<Vertex>& verts, std::vector<unsigned int>& indices,
+		std::vector<SubMesh>& subMeshes, std::vector<std::string>& materialNames, float weldEpsilon = 0.0f, bool printStats = false);
+
+	// Parse an in-memory .OBJ file (does not need to be null terminated). Large
+	// files are split across up to threadCount threads (0 = one per core), and
+	// the output is identical no matter how many threads are used.
+	void Parse(const char* data, size_t size, std::vector<Vertex>& verts, std::vector<unsigned int>& indices,
+		std::vector<SubMesh>& subMeshes, std::vector<std::string>& materialNames, unsigned int threadCount = 0);
+}
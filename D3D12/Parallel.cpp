@@ -0,0 +1,115 @@
+#include "Parallel.h"
+#include "CpuZones.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// --------------------------------------------------------
+	// One worker per hardware thread but the caller's, and the
+	// jobs that still have indices to hand out. Claiming an
+	// index happens under the mutex; running it doesn't.
+	// --------------------------------------------------------
+	struct Pool
+	{
+		std::mutex mutex;
+		std::condition_variable workReady;	// A job was queued, or it's time to quit
+		std::condition_variable jobDone;	// Some job's last index finished
+		std::deque<Parallel::Job*> jobs;
+		std::vector<std::thread> workers;
+		bool quit = false;
+
+		Pool()
+		{
+			unsigned int count = Parallel::HardwareThreads() - 1;
+			for (unsigned int i = 0; i < count; i++)
+				workers.emplace_back(&Pool::WorkerMain, this, i);
+		}
+
+		~Pool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				quit = true;
+			}
+			workReady.notify_all();
+			for (std::thread& worker : workers)
+				worker.join();
+		}
+
+		// Takes the job's next index, and the job off the queue once
+		// it has none left. The mutex must be held.
+		size_t Claim(Parallel::Job& job)
+		{
+			size_t index = job.next++;
+			if (job.next == job.count)
+				jobs.erase(std::find(jobs.begin(), jobs.end(), &job));
+			return index;
+		}
+
+		// Runs a claimed index outside the mutex, then counts it as
+		// done. The job may be gone as soon as its last one is.
+		void Execute(std::unique_lock<std::mutex>& lock, Parallel::Job& job, size_t index)
+		{
+			lock.unlock();
+			job.call(job.work, index);
+			lock.lock();
+			if (--job.remaining == 0)
+				jobDone.notify_all();
+		}
+
+		void WorkerMain(unsigned int number)
+		{
+			CpuZones::SetThreadName(("Worker " + std::to_string(number + 1)).c_str());
+
+			std::unique_lock<std::mutex> lock(mutex);
+			while (true)
+			{
+				workReady.wait(lock, [this]() { return quit || !jobs.empty(); });
+				if (quit)
+					return;
+
+				Parallel::Job& job = *jobs.front();
+				size_t index = Claim(job);
+				Execute(lock, job, index);
+			}
+		}
+	};
+
+	// Made the first time anything runs in parallel
+	Pool& GetPool()
+	{
+		static Pool pool;
+		return pool;
+	}
+}
+
+void Parallel::RunJob(Job& job)
+{
+	Pool& pool = GetPool();
+	std::unique_lock<std::mutex> lock(pool.mutex);
+	pool.jobs.push_back(&job);
+	for (size_t i = 1; i < job.count && i <= pool.workers.size(); i++)
+		pool.workReady.notify_one();
+
+	// Work through the job here too until every index is handed
+	// out, then wait for any still running on the workers
+	while (job.next < job.count)
+	{
+		size_t index = pool.Claim(job);
+		pool.Execute(lock, job, index);
+	}
+	pool.jobDone.wait(lock, [&job]() { return job.remaining == 0; });
+}
+
+unsigned int Parallel::WorkerCount()
+{
+	return (unsigned int)GetPool().workers.size();
+}
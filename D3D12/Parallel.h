@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <thread>
+
+// --------------------------------------------------------
+// Minimal fork/join helpers for splitting work (parsing,
+// tangents, draw recording, etc.) across the CPU's cores
+//
+// Work runs on a pool of threads made once, the first time
+// it's needed, so something run every frame doesn't pay to
+// create and join threads each time (see Parallel.cpp).
+// --------------------------------------------------------
+namespace Parallel
+{
+	// Number of hardware threads, never less than one
+	inline unsigned int HardwareThreads()
+	{
+		unsigned int count = std::thread::hardware_concurrency();
+		return count > 0 ? count : 1;
+	}
+
+	// One call to Run(), as the pool sees it
+	struct Job
+	{
+		void (*call)(void* work, size_t index);
+		void* work;
+		size_t count;
+		size_t next;		// Next index to hand out
+		size_t remaining;	// Indices that haven't finished
+	};
+
+	// Queues the job for the pool, works on it as well, and
+	// returns once every index is done
+	void RunJob(Job& job);
+
+	// Threads in the pool, not counting whoever calls Run()
+	unsigned int WorkerCount();
+
+	// --------------------------------------------------------
+	// Runs work(0) .. work(count - 1) across the calling thread
+	// and the pool, and returns once they've all finished.
+	// Indices beyond the number of threads run one after
+	// another. Calls can nest, since the caller always works
+	// through its own indices rather than waiting on the pool.
+	// --------------------------------------------------------
+	template<typename Work>
+	void Run(size_t count, Work work)
+	{
+		if (count == 0)
+			return;
+		if (count == 1)
+		{
+			work(0);
+			return;
+		}
+
+		Job job = {};
+		job.call = [](void* data, size_t index) { (*(Work*)data)(index); };
+		job.work = &work;
+		job.count = count;
+		job.remaining = count;
+		RunJob(job);
+	}
+}
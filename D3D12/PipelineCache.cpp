@@ -0,0 +1,223 @@
+#include "PipelineCache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	const unsigned long long Multiplier = 0x9E3779B97F4A7C15ull;
+
+	inline unsigned long long Mix(unsigned long long h)
+	{
+		h ^= h >> 33;
+		h *= 0xFF51AFD7ED558CCDull;
+		h ^= h >> 33;
+		h *= 0xC4CEB9FE1A85EC53ull;
+		h ^= h >> 33;
+		return h;
+	}
+
+	// Start of a pipeline library file, ahead of the device's own data
+	struct FileHeader
+	{
+		char magic[4];				// Always "PSOL"
+		unsigned int version;		// PipelineCache::FormatVersion
+		unsigned long long size;	// Bytes of library data that follow
+		unsigned long long hash;	// HashBytes() of that data
+	};
+
+	const char Magic[4] = { 'P', 'S', 'O', 'L' };
+}
+
+PipelineHasher::PipelineHasher()
+{
+	hash = 0;
+	length = 0;
+}
+
+void PipelineHasher::Add(const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	length += size;
+
+	while (size >= 8)
+	{
+		unsigned long long k;
+		memcpy(&k, bytes, 8);
+		hash = (hash ^ Mix(k)) * Multiplier;
+		bytes += 8;
+		size -= 8;
+	}
+
+	// Short tails are tagged with their length, so "ab" + "c" and "a" + "bc" differ
+	unsigned long long tail = (unsigned long long)size << 56;
+	memcpy(&tail, bytes, size);
+	hash = (hash ^ Mix(tail)) * Multiplier;
+}
+
+void PipelineHasher::AddString(const char* text)
+{
+	if (!text)
+	{
+		AddValue((unsigned char)0xFF);
+		return;
+	}
+
+	Add(text, strlen(text));
+	AddValue((unsigned char)0);
+}
+
+unsigned long long PipelineHasher::GetHash()
+{
+	return Mix(hash ^ (length * Multiplier));
+}
+
+unsigned long long PipelineHasher::HashBytes(const void* data, size_t size)
+{
+	PipelineHasher hasher;
+	hasher.Add(data, size);
+	return hasher.GetHash();
+}
+
+PipelineCache::PipelineCache(PipelineDevice* device)
+{
+	this->device = device;
+	libraryChanged = false;
+	device->OpenLibrary(0, 0);
+}
+
+PipelineCache::~PipelineCache()
+{
+	for (auto& pair : pipelines)
+	{
+		if (pair.second)
+			device->ReleasePipeline(pair.second);
+	}
+}
+
+// --------------------------------------------------------
+// Reads a library file, checking it's complete and was
+// written by this version before the device sees it. The
+// device itself turns down libraries from other drivers
+// or GPUs.
+// --------------------------------------------------------
+bool PipelineCache::Load(const std::filesystem::path& file)
+{
+	std::ifstream in(file, std::ios::binary);
+	FileHeader header = {};
+	if (!in || !in.read((char*)&header, sizeof(header)) ||
+		memcmp(header.magic, Magic, sizeof(Magic)) != 0 ||
+		header.version != FormatVersion)
+		return false;
+
+	std::error_code error;
+	unsigned long long fileSize = std::filesystem::file_size(file, error);
+	if (error || header.size != fileSize - sizeof(header))
+		return false;
+
+	std::vector<unsigned char> data((size_t)header.size);
+	if (!in.read((char*)data.data(), (std::streamsize)data.size()) ||
+		PipelineHasher::HashBytes(data.data(), data.size()) != header.hash)
+		return false;
+
+	if (!device->OpenLibrary(data.data(), data.size()))
+		return false;
+
+	stats.libraryOpened = true;
+	libraryChanged = false;
+	return true;
+}
+
+bool PipelineCache::Save(const std::filesystem::path& file)
+{
+	if (!libraryChanged)
+		return true;
+
+	std::vector<unsigned char> data;
+	if (!device->SerializeLibrary(data))
+		return false;
+
+	FileHeader header = {};
+	memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = FormatVersion;
+	header.size = data.size();
+	header.hash = PipelineHasher::HashBytes(data.data(), data.size());
+
+	std::ofstream out(file, std::ios::binary | std::ios::trunc);
+	if (!out)
+		return false;
+
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)data.data(), (std::streamsize)data.size());
+	if (!out)
+		return false;
+
+	libraryChanged = false;
+	return true;
+}
+
+void* PipelineCache::GetPipeline(unsigned long long key, const void* description)
+{
+	stats.requests++;
+	auto existing = pipelines.find(key);
+	if (existing != pipelines.end())
+	{
+		stats.shared++;
+		return existing->second;
+	}
+
+	std::wstring name = PipelineName(key);
+	auto startTime = std::chrono::high_resolution_clock::now();
+	void* pipeline = device->LoadPipeline(name.c_str(), description);
+	if (pipeline)
+	{
+		stats.loaded++;
+		stats.loadSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+	}
+	else
+	{
+		pipeline = device->CreatePipeline(description);
+		stats.compileSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+		if (!pipeline)
+		{
+			// Not remembered, so a later request tries again
+			stats.failed++;
+			return 0;
+		}
+
+		stats.compiled++;
+		if (device->StorePipeline(name.c_str(), pipeline))
+		{
+			stats.stored++;
+			libraryChanged = true;
+		}
+	}
+
+	pipelines[key] = pipeline;
+	return pipeline;
+}
+
+// Library entries are named by key, as 16 hex digits
+std::wstring PipelineCache::PipelineName(unsigned long long key)
+{
+	const wchar_t* digits = L"0123456789abcdef";
+	std::wstring name(16, L'0');
+	for (int i = 15; i >= 0; i--, key >>= 4)
+		name[i] = digits[key & 15];
+	return name;
+}
+
+size_t PipelineCache::GetPipelineCount() { return pipelines.size(); }
+PipelineCacheStats PipelineCache::GetStats() { return stats; }
+
+void PipelineCache::PrintStats()
+{
+	printf("Pipelines: %zu requested, %zu distinct (%zu shared), library %s\n",
+		stats.requests, pipelines.size(), stats.shared, stats.libraryOpened ? "opened" : "started empty");
+	printf("  %zu loaded from the library in %.2f ms, %zu compiled in %.2f ms (%zu stored), %zu failed\n",
+		stats.loaded, stats.loadSeconds * 1000.0, stats.compiled, stats.compileSeconds * 1000.0, stats.stored, stats.failed);
+}
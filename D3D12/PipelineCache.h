@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// --------------------------------------------------------
+// Builds a stable 64-bit hash out of a pipeline's state
+//
+// Fields are added one at a time, never whole structs, so
+// padding bytes and pointers can't leak into the hash and
+// the same description hashes the same on every run.
+// --------------------------------------------------------
+class PipelineHasher
+{
+public:
+
+	PipelineHasher();
+
+	void Add(const void* data, size_t size);
+	void AddString(const char* text);	// Null is distinct from ""
+
+	template<typename T>
+	void AddValue(const T& value) { Add(&value, sizeof(T)); }
+
+	unsigned long long GetHash();
+
+	static unsigned long long HashBytes(const void* data, size_t size);
+
+private:
+
+	unsigned long long hash;
+	unsigned long long length;
+};
+
+struct PipelineCacheStats
+{
+	size_t requests = 0;
+	size_t shared = 0;			// Requests for a pipeline that was already made
+	size_t loaded = 0;			// From the on-disk library
+	size_t compiled = 0;		// From scratch
+	size_t stored = 0;			// Added to the library this run
+	size_t failed = 0;
+	double loadSeconds = 0;
+	double compileSeconds = 0;
+	bool libraryOpened = false;	// The file was there, and the driver accepted it
+};
+
+// --------------------------------------------------------
+// The pipeline operations PipelineCache needs, so its
+// bookkeeping doesn't depend on D3D12 (see
+// PipelineDeviceD3D12.h) and can run against a fake device.
+//
+// Pipelines and their descriptions are the device's own
+// types, passed through untouched.
+// --------------------------------------------------------
+class PipelineDevice
+{
+public:
+
+	virtual ~PipelineDevice() {}
+
+	// Starts a library from data written by SerializeLibrary() (or an empty
+	// one for no data). Returns false, and starts empty, if it's unusable.
+	virtual bool OpenLibrary(const void* data, size_t size) = 0;
+
+	// Finds a pipeline stored in the library under the given name, or
+	// returns 0. The description has to match the stored one.
+	virtual void* LoadPipeline(const wchar_t* name, const void* description) = 0;
+
+	virtual void* CreatePipeline(const void* description) = 0;
+	virtual bool StorePipeline(const wchar_t* name, void* pipeline) = 0;
+	virtual void ReleasePipeline(void* pipeline) = 0;
+
+	virtual bool SerializeLibrary(std::vector<unsigned char>& data) = 0;
+};
+
+// --------------------------------------------------------
+// Pipeline states, made once per distinct description
+//
+// Callers hash their description (see PipelineHasher) and
+// ask for it by that key. The first request for a key
+// loads the pipeline from the on-disk library if it's
+// there, or compiles it and adds it to the library; every
+// later request gets the same pipeline back. The library
+// is only written out again when something was added.
+//
+// The cache holds a reference to every pipeline it hands
+// out until it's destroyed.
+// --------------------------------------------------------
+class PipelineCache
+{
+public:
+
+	// Bump this whenever the key hashing changes
+	static const unsigned int FormatVersion = 1;
+
+	PipelineCache(PipelineDevice* device);
+	~PipelineCache();
+	PipelineCache(const PipelineCache&) = delete;
+	PipelineCache& operator=(const PipelineCache&) = delete;
+
+	// Opens the library saved in a file, before any pipelines are made.
+	// A missing, damaged or out of date file just means starting empty.
+	bool Load(const std::filesystem::path& file);
+
+	// Writes the library back out, if anything was added to it
+	bool Save(const std::filesystem::path& file);
+
+	// The pipeline for this key, made from the description the first time.
+	// Returns 0 if it can't be made.
+	void* GetPipeline(unsigned long long key, const void* description);
+
+	static std::wstring PipelineName(unsigned long long key);
+
+	size_t GetPipelineCount();
+	PipelineCacheStats GetStats();
+	void PrintStats();
+
+private:
+
+	PipelineDevice* device;
+	std::unordered_map<unsigned long long, void*> pipelines;
+	bool libraryChanged;
+	PipelineCacheStats stats;
+};
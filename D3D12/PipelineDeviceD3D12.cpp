@@ -0,0 +1,170 @@
+#include "PipelineDeviceD3D12.h"
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	void AddShader(PipelineHasher& hasher, const D3D12_SHADER_BYTECODE& shader)
+	{
+		hasher.AddValue((unsigned long long)shader.BytecodeLength);
+		if (shader.pShaderBytecode)
+			hasher.Add(shader.pShaderBytecode, shader.BytecodeLength);
+	}
+}
+
+PipelineDeviceD3D12::PipelineDeviceD3D12(ID3D12Device* device)
+{
+	this->device = device;
+	device->QueryInterface(IID_PPV_ARGS(libraryDevice.GetAddressOf()));
+}
+
+// --------------------------------------------------------
+// The driver turns down libraries saved by another driver
+// version or on another GPU, in which case this starts a
+// new, empty one instead
+// --------------------------------------------------------
+bool PipelineDeviceD3D12::OpenLibrary(const void* data, size_t size)
+{
+	library.Reset();
+	libraryData.clear();
+	if (!libraryDevice)
+		return false;
+
+	if (size > 0)
+	{
+		const unsigned char* bytes = (const unsigned char*)data;
+		libraryData.assign(bytes, bytes + size);
+		if (SUCCEEDED(libraryDevice->CreatePipelineLibrary(libraryData.data(), libraryData.size(), IID_PPV_ARGS(library.GetAddressOf()))))
+			return true;
+
+		libraryData.clear();
+	}
+
+	libraryDevice->CreatePipelineLibrary(0, 0, IID_PPV_ARGS(library.GetAddressOf()));
+	return size == 0 && library;
+}
+
+void* PipelineDeviceD3D12::LoadPipeline(const wchar_t* name, const void* description)
+{
+	ID3D12PipelineState* pipeline = 0;
+	if (!library || FAILED(library->LoadGraphicsPipeline(name, (const D3D12_GRAPHICS_PIPELINE_STATE_DESC*)description, IID_PPV_ARGS(&pipeline))))
+		return 0;
+	return pipeline;
+}
+
+void* PipelineDeviceD3D12::CreatePipeline(const void* description)
+{
+	ID3D12PipelineState* pipeline = 0;
+	if (FAILED(device->CreateGraphicsPipelineState((const D3D12_GRAPHICS_PIPELINE_STATE_DESC*)description, IID_PPV_ARGS(&pipeline))))
+		return 0;
+	return pipeline;
+}
+
+bool PipelineDeviceD3D12::StorePipeline(const wchar_t* name, void* pipeline)
+{
+	return library && SUCCEEDED(library->StorePipeline(name, (ID3D12PipelineState*)pipeline));
+}
+
+void PipelineDeviceD3D12::ReleasePipeline(void* pipeline)
+{
+	((ID3D12PipelineState*)pipeline)->Release();
+}
+
+bool PipelineDeviceD3D12::SerializeLibrary(std::vector<unsigned char>& data)
+{
+	if (!library)
+		return false;
+
+	data.resize(library->GetSerializedSize());
+	return SUCCEEDED(library->Serialize(data.data(), data.size()));
+}
+
+// --------------------------------------------------------
+// Walks the description field by field, following its
+// pointers (shaders, input layout, stream output) rather
+// than hashing them. CachedPSO is left out, since it's a
+// cache of the pipeline and not part of what it does.
+// --------------------------------------------------------
+unsigned long long PipelineDeviceD3D12::HashDescription(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, unsigned long long rootSignatureHash)
+{
+	PipelineHasher hasher;
+	hasher.AddValue(rootSignatureHash);
+
+	AddShader(hasher, desc.VS);
+	AddShader(hasher, desc.PS);
+	AddShader(hasher, desc.DS);
+	AddShader(hasher, desc.HS);
+	AddShader(hasher, desc.GS);
+
+	const D3D12_STREAM_OUTPUT_DESC& streamOutput = desc.StreamOutput;
+	hasher.AddValue(streamOutput.NumEntries);
+	for (UINT i = 0; i < streamOutput.NumEntries && streamOutput.pSODeclaration; i++)
+	{
+		const D3D12_SO_DECLARATION_ENTRY& entry = streamOutput.pSODeclaration[i];
+		hasher.AddValue(entry.Stream);
+		hasher.AddString(entry.SemanticName);
+		hasher.AddValue(entry.SemanticIndex);
+		hasher.AddValue(entry.StartComponent);
+		hasher.AddValue(entry.ComponentCount);
+		hasher.AddValue(entry.OutputSlot);
+	}
+	hasher.AddValue(streamOutput.NumStrides);
+	if (streamOutput.pBufferStrides)
+		hasher.Add(streamOutput.pBufferStrides, sizeof(UINT) * streamOutput.NumStrides);
+	hasher.AddValue(streamOutput.RasterizedStream);
+
+	// Render target blend descriptions end in a byte, so they have padding
+	hasher.AddValue(desc.BlendState.AlphaToCoverageEnable);
+	hasher.AddValue(desc.BlendState.IndependentBlendEnable);
+	for (const D3D12_RENDER_TARGET_BLEND_DESC& target : desc.BlendState.RenderTarget)
+	{
+		hasher.AddValue(target.BlendEnable);
+		hasher.AddValue(target.LogicOpEnable);
+		hasher.AddValue(target.SrcBlend);
+		hasher.AddValue(target.DestBlend);
+		hasher.AddValue(target.BlendOp);
+		hasher.AddValue(target.SrcBlendAlpha);
+		hasher.AddValue(target.DestBlendAlpha);
+		hasher.AddValue(target.BlendOpAlpha);
+		hasher.AddValue(target.LogicOp);
+		hasher.AddValue(target.RenderTargetWriteMask);
+	}
+	hasher.AddValue(desc.SampleMask);
+
+	// Every rasterizer field is 4 bytes, so the struct has no padding
+	hasher.AddValue(desc.RasterizerState);
+
+	const D3D12_DEPTH_STENCIL_DESC& depthStencil = desc.DepthStencilState;
+	hasher.AddValue(depthStencil.DepthEnable);
+	hasher.AddValue(depthStencil.DepthWriteMask);
+	hasher.AddValue(depthStencil.DepthFunc);
+	hasher.AddValue(depthStencil.StencilEnable);
+	hasher.AddValue(depthStencil.StencilReadMask);
+	hasher.AddValue(depthStencil.StencilWriteMask);
+	hasher.AddValue(depthStencil.FrontFace);
+	hasher.AddValue(depthStencil.BackFace);
+
+	hasher.AddValue(desc.InputLayout.NumElements);
+	for (UINT i = 0; i < desc.InputLayout.NumElements && desc.InputLayout.pInputElementDescs; i++)
+	{
+		const D3D12_INPUT_ELEMENT_DESC& element = desc.InputLayout.pInputElementDescs[i];
+		hasher.AddString(element.SemanticName);
+		hasher.AddValue(element.SemanticIndex);
+		hasher.AddValue(element.Format);
+		hasher.AddValue(element.InputSlot);
+		hasher.AddValue(element.AlignedByteOffset);
+		hasher.AddValue(element.InputSlotClass);
+		hasher.AddValue(element.InstanceDataStepRate);
+	}
+
+	hasher.AddValue(desc.IBStripCutValue);
+	hasher.AddValue(desc.PrimitiveTopologyType);
+	hasher.AddValue(desc.NumRenderTargets);
+	hasher.AddValue(desc.RTVFormats);
+	hasher.AddValue(desc.DSVFormat);
+	hasher.AddValue(desc.SampleDesc.Count);
+	hasher.AddValue(desc.SampleDesc.Quality);
+	hasher.AddValue(desc.NodeMask);
+	hasher.AddValue(desc.Flags);
+	return hasher.GetHash();
+}
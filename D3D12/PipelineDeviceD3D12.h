@@ -0,0 +1,43 @@
+#pragma once
+
+#include <Windows.h>
+#include <d3d12.h>
+#include <vector>
+#include <wrl/client.h>
+#include "PipelineCache.h"
+
+// --------------------------------------------------------
+// PipelineCache's device, keeping pipelines in an
+// ID3D12PipelineLibrary
+//
+// Descriptions are D3D12_GRAPHICS_PIPELINE_STATE_DESC and
+// pipelines are ID3D12PipelineState pointers, each holding
+// one reference for the cache. Without pipeline library
+// support every pipeline is simply compiled.
+// --------------------------------------------------------
+class PipelineDeviceD3D12 : public PipelineDevice
+{
+public:
+
+	PipelineDeviceD3D12(ID3D12Device* device);
+	PipelineDeviceD3D12(const PipelineDeviceD3D12&) = delete;
+	PipelineDeviceD3D12& operator=(const PipelineDeviceD3D12&) = delete;
+
+	bool OpenLibrary(const void* data, size_t size) override;
+	void* LoadPipeline(const wchar_t* name, const void* description) override;
+	void* CreatePipeline(const void* description) override;
+	bool StorePipeline(const wchar_t* name, void* pipeline) override;
+	void ReleasePipeline(void* pipeline) override;
+	bool SerializeLibrary(std::vector<unsigned char>& data) override;
+
+	// Key for a pipeline: every state field, the shaders' bytecode and
+	// a hash of its root signature (the description only has a pointer)
+	static unsigned long long HashDescription(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, unsigned long long rootSignatureHash);
+
+private:
+
+	Microsoft::WRL::ComPtr<ID3D12Device> device;
+	Microsoft::WRL::ComPtr<ID3D12Device1> libraryDevice;
+	Microsoft::WRL::ComPtr<ID3D12PipelineLibrary> library;
+	std::vector<unsigned char> libraryData;	// Has to outlive the library
+};
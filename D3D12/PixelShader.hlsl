@@ -13,10 +13,33 @@ cbuffer ExternalData : register(b0)
     Light lights[MAX_LIGHTS];
 }
 
+#ifdef BINDLESS
+// Bindless materials (see PixelShaderBindless.hlsl): the draw only says
+// which material it uses, and the material says which textures those are
+// (match MaterialGPUData in BufferStructs.h)
+struct MaterialData
+{
+    uint albedoIndex;
+    uint normalIndex;
+    uint metalIndex;
+    uint roughnessIndex;
+    float2 uvScale;
+    float2 uvOffset;
+};
+
+cbuffer DrawData : register(b1)
+{
+    uint materialIndex;
+}
+
+StructuredBuffer<MaterialData> materials : register(t0);
+Texture2D textures[] : register(t0, space1);
+#else
 Texture2D albedo    : register(t0);
 Texture2D normal    : register(t1);
 Texture2D metallic  : register(t2);
 Texture2D roughness : register(t3);
+#endif
 
 SamplerState basicSampler : register(s0);
 
@@ -31,31 +54,46 @@ SamplerState basicSampler : register(s0);
 // --------------------------------------------------------
 float4 main(VertexToPixel input) : SV_TARGET
 {
-    // scroll uv
-    input.uv += uvOffset;
+    // scroll and scale uv, then sample the material's textures
+#ifdef BINDLESS
+    MaterialData material = materials[materialIndex];
+    float2 uv = (input.uv + material.uvOffset) * material.uvScale;
+    float3 normalSample = textures[material.normalIndex].Sample(basicSampler, uv).rgb;
+    float3 albedoSample = textures[material.albedoIndex].Sample(basicSampler, uv).rgb;
+    float metal = textures[material.metalIndex].Sample(basicSampler, uv).r;
+    float rough = textures[material.roughnessIndex].Sample(basicSampler, uv).r;
+#else
+    float2 uv = (input.uv + uvOffset) * uvScale;
+    float3 normalSample = normal.Sample(basicSampler, uv).rgb;
+    float3 albedoSample = albedo.Sample(basicSampler, uv).rgb;
+    float metal = metallic.Sample(basicSampler, uv).r;
+    float rough = roughness.Sample(basicSampler, uv).r;
+#endif
 
     // Calculate vector from surface to camera
     float3 viewVector = normalize(cameraPosition - input.worldPosition);
 
-    // Renormalize from the map if using normal map
-    float3 normalFromMap = normalize(normal.Sample(basicSampler, input.uv * uvScale).rgb * 2 - 1); // scale 0 to 1 values to -1 to 1
+    // Renormalize from the map if using normal map, scaling 0 to 1 values to -1 to 1.
+    // Only x and y are used (cooked BC5 maps don't store z), so z is rebuilt.
+    float3 normalFromMap;
+    normalFromMap.xy = normalSample.xy * 2 - 1;
+    normalFromMap.z = sqrt(saturate(1 - dot(normalFromMap.xy, normalFromMap.xy)));
+    normalFromMap = normalize(normalFromMap);
         
     // rotate normal map to convert from tangent to world space (since our input values are already in world space from VS)
     // Ensure we orthonormalize the tangent again
     float3 N = normalize(input.normal); // Normal
-    float3 T = normalize(input.tangent); // Tangent
+    float3 T = normalize(input.tangent.xyz); // Tangent
     T = normalize(T - N * dot(T, N)); // Gram-Schmidt orthonomalizing of the Tangent
-    float3 B = cross(T, N); // Bi-tangent
+    float3 B = cross(T, N) * input.tangent.w; // Bi-tangent, flipped for mirrored UVs
     float3x3 TBN = float3x3(T, B, N); // TBN rotation matrix
 
     // multiply normal map vector by the TBN matrix
     input.normal = mul(normalFromMap, TBN);
 
-    // Sample the surface texture for the initial pixel color (scale texture if a scale was specified)
+    // Use the surface texture for the initial pixel color
     // un-correct the albedo color w/ gamma value
-    float3 albedoColor = pow(albedo.Sample(basicSampler, input.uv * uvScale).rgb, 2.2f);
-    float metal = metallic.Sample(basicSampler, input.uv * uvScale).r;
-    float rough = roughness.Sample(basicSampler, input.uv * uvScale).r;
+    float3 albedoColor = pow(albedoSample, 2.2f);
     
     // Specular color determination -----------------
     // Assume albedo texture is actually holding specular color where metalness == 1
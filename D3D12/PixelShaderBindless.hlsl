@@ -0,0 +1,4 @@
+// The regular pixel shader, with every material's textures in one
+// unbounded array instead of a table per material (needs SM 5.1)
+#define BINDLESS
+#include "PixelShader.hlsl"
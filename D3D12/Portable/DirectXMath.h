@@ -0,0 +1,60 @@
+#pragma once
+
+// --------------------------------------------------------
+// Stand-in for DirectXMath on platforms without it, used
+// only by the portable CMake build (see CMakeLists.txt)
+//
+// The engine's portable code keeps its math on plain
+// structs, so this only declares the storage types it
+// uses. Anything needing XMVECTOR or XMMATRIX (Transform,
+// Camera, ...) stays Windows-only.
+// --------------------------------------------------------
+namespace DirectX
+{
+	struct XMFLOAT2
+	{
+		float x;
+		float y;
+
+		XMFLOAT2() = default;
+		constexpr XMFLOAT2(float x, float y) : x(x), y(y) {}
+	};
+
+	struct XMFLOAT3
+	{
+		float x;
+		float y;
+		float z;
+
+		XMFLOAT3() = default;
+		constexpr XMFLOAT3(float x, float y, float z) : x(x), y(y), z(z) {}
+	};
+
+	struct XMFLOAT4
+	{
+		float x;
+		float y;
+		float z;
+		float w;
+
+		XMFLOAT4() = default;
+		constexpr XMFLOAT4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+	};
+
+	struct XMFLOAT4X4
+	{
+		union
+		{
+			struct
+			{
+				float _11, _12, _13, _14;
+				float _21, _22, _23, _24;
+				float _31, _32, _33, _34;
+				float _41, _42, _43, _44;
+			};
+			float m[4][4];
+		};
+
+		XMFLOAT4X4() = default;
+	};
+}
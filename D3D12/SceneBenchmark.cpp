@@ -0,0 +1,654 @@
+#include "SceneBenchmark.h"
+#include "CpuZones.h"
+#include "FrameAllocator.h"
+#include "FramePacingDeviceNull.h"
+#include "JsonHelpers.h"
+#include "LodSelector.h"
+#include "Meshlets.h"
+#include "MeshSimplifier.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+
+using namespace DirectX;
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	std::atomic<unsigned long long> allocationCount{ 0 };
+	std::atomic<unsigned long long> allocatedBytes{ 0 };
+
+	void* CountedAllocate(size_t size)
+	{
+		allocationCount.fetch_add(1, std::memory_order_relaxed);
+		allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+
+		void* memory = malloc(size > 0 ? size : 1);
+		if (!memory)
+			throw std::bad_alloc();
+		return memory;
+	}
+
+	void* CountedAllocateAligned(size_t size, size_t alignment)
+	{
+		allocationCount.fetch_add(1, std::memory_order_relaxed);
+		allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+
+		// aligned_alloc wants a size that's a multiple of the alignment
+		size = (size + alignment - 1) & ~(alignment - 1);
+#ifdef _MSC_VER
+		void* memory = _aligned_malloc(size > 0 ? size : alignment, alignment);
+#else
+		void* memory = aligned_alloc(alignment, size > 0 ? size : alignment);
+#endif
+		if (!memory)
+			throw std::bad_alloc();
+		return memory;
+	}
+
+	void AlignedFree(void* memory)
+	{
+#ifdef _MSC_VER
+		_aligned_free(memory);
+#else
+		free(memory);
+#endif
+	}
+
+	// How far the null GPU is allowed to fall behind
+	const unsigned int FramesInFlight = 2;
+	const unsigned long long UploadPageSize = 1024 * 1024;
+	const unsigned long long ConstantBufferAlignment = 256;
+
+	// Per draw constants, laid out like the vertex shader's cbuffer
+	struct DrawConstants
+	{
+		XMFLOAT4X4 world;
+		XMFLOAT4X4 worldInverseTranspose;
+		XMFLOAT4X4 view;
+		XMFLOAT4X4 proj;
+	};
+
+	struct BenchmarkEntity
+	{
+		XMFLOAT3 position;
+		float scale;
+		float spinSpeed;	// Radians per second
+		float angle;
+		XMFLOAT4X4 world;
+	};
+
+	// What culling decided to draw: a LOD's range of the mesh's
+	// indices, or a run of the frame's meshlet-culled indices
+	struct BenchmarkDraw
+	{
+		unsigned int entity;
+		unsigned int indexOffset;
+		unsigned int indexCount;
+		bool culledIndices;
+	};
+
+	struct BenchmarkScene
+	{
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+		std::vector<MeshLod> lods;
+		MeshletData meshlets;
+		float meshRadius = 1.0f;
+
+		std::vector<BenchmarkEntity> entities;
+		XMFLOAT4X4 view;
+		XMFLOAT4X4 proj;
+		XMFLOAT3 cameraPosition;
+
+		// Rebuilt every frame, keeping their capacity
+		std::vector<BenchmarkDraw> draws;
+		std::vector<unsigned int> culledIndices;
+		std::vector<unsigned int> meshletIndices;
+
+		// Stand-ins for upload heap pages
+		FrameAllocator uploads;
+		std::vector<std::vector<unsigned char>> pages;
+	};
+
+	// Same sequence on every platform, unlike rand()
+	unsigned int NextRandom(unsigned int& state)
+	{
+		state = state * 1664525u + 1013904223u;
+		return state >> 8;
+	}
+
+	float RandomRange(unsigned int& state, float min, float max)
+	{
+		return (float)NextRandom(state) / (float)(1u << 24) * (max - min) + min;
+	}
+
+	XMFLOAT4X4 Identity()
+	{
+		XMFLOAT4X4 m;
+		for (int r = 0; r < 4; r++)
+			for (int c = 0; c < 4; c++)
+				m.m[r][c] = r == c ? 1.0f : 0.0f;
+		return m;
+	}
+
+	XMFLOAT3 Normalize(XMFLOAT3 v)
+	{
+		float length = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+		return length > 0.0f ? XMFLOAT3(v.x / length, v.y / length, v.z / length) : v;
+	}
+
+	XMFLOAT3 Cross(XMFLOAT3 a, XMFLOAT3 b)
+	{
+		return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	float Dot(XMFLOAT3 a, XMFLOAT3 b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	// Row vector matrices, matching XMMatrixLookAtLH and XMMatrixPerspectiveFovLH
+	XMFLOAT4X4 LookAt(XMFLOAT3 eye, XMFLOAT3 target, XMFLOAT3 up)
+	{
+		XMFLOAT3 z = Normalize(XMFLOAT3(target.x - eye.x, target.y - eye.y, target.z - eye.z));
+		XMFLOAT3 x = Normalize(Cross(up, z));
+		XMFLOAT3 y = Cross(z, x);
+
+		XMFLOAT4X4 m = Identity();
+		m._11 = x.x; m._12 = y.x; m._13 = z.x;
+		m._21 = x.y; m._22 = y.y; m._23 = z.y;
+		m._31 = x.z; m._32 = y.z; m._33 = z.z;
+		m._41 = -Dot(x, eye); m._42 = -Dot(y, eye); m._43 = -Dot(z, eye);
+		return m;
+	}
+
+	XMFLOAT4X4 Perspective(float fieldOfView, float aspectRatio, float nearClip, float farClip)
+	{
+		float height = 1.0f / std::tan(fieldOfView * 0.5f);
+		float range = farClip / (farClip - nearClip);
+
+		XMFLOAT4X4 m = Identity();
+		m._11 = height / aspectRatio;
+		m._22 = height;
+		m._33 = range;
+		m._34 = 1.0f;
+		m._43 = -range * nearClip;
+		m._44 = 0.0f;
+		return m;
+	}
+
+	// A ridged UV sphere, dense and bumpy enough that LODs cost it some
+	// detail and close ones stay at full detail (and get meshlet culled)
+	void BuildSphere(unsigned int rings, unsigned int segments,
+		std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+	{
+		const float pi = 3.14159265f;
+		for (unsigned int r = 0; r <= rings; r++)
+		{
+			float phi = pi * r / rings;
+			for (unsigned int s = 0; s <= segments; s++)
+			{
+				float theta = 2.0f * pi * s / segments;
+				float radius = 0.9f + 0.1f * std::sin(theta * 12.0f) * std::sin(phi * 8.0f);
+				Vertex v;
+				v.Normal = XMFLOAT3(std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta));
+				v.Position = XMFLOAT3(v.Normal.x * radius, v.Normal.y * radius, v.Normal.z * radius);
+				v.UV = XMFLOAT2((float)s / segments, (float)r / rings);
+				v.Tangent = XMFLOAT4(-std::sin(theta), 0.0f, std::cos(theta), 1.0f);
+				verts.push_back(v);
+			}
+		}
+
+		// Clockwise from outside, skipping the triangles that collapse at the poles
+		for (unsigned int r = 0; r < rings; r++)
+		{
+			for (unsigned int s = 0; s < segments; s++)
+			{
+				unsigned int a = r * (segments + 1) + s;
+				unsigned int b = a + segments + 1;
+				if (r > 0)
+				{
+					indices.push_back(a);
+					indices.push_back(a + 1);
+					indices.push_back(b);
+				}
+				if (r < rings - 1)
+				{
+					indices.push_back(a + 1);
+					indices.push_back(b + 1);
+					indices.push_back(b);
+				}
+			}
+		}
+	}
+
+	void BuildScene(BenchmarkScene& scene, const SceneBenchmarkSettings& settings)
+	{
+		BuildSphere(64, 128, scene.vertices, scene.indices);
+		unsigned int indexCount = (unsigned int)scene.indices.size();
+		scene.lods = MeshSimplifier::BuildLodChain(&scene.vertices[0], scene.vertices.size(), scene.indices,
+			0, indexCount, MeshSimplifier::DefaultLodTargets,
+			sizeof(MeshSimplifier::DefaultLodTargets) / sizeof(MeshSimplifier::DefaultLodTargets[0]));
+		Meshlets::Build(&scene.vertices[0], scene.vertices.size(), &scene.indices[0], indexCount, scene.meshlets);
+
+		unsigned int random = settings.seed;
+		scene.entities.resize(settings.entityCount);
+		for (BenchmarkEntity& e : scene.entities)
+		{
+			// Scattered over a disc, so the orbiting camera sees them near and far
+			float angle = RandomRange(random, 0.0f, 6.2831853f);
+			float distance = std::sqrt(RandomRange(random, 0.0f, 1.0f)) * 80.0f;
+			e.position = XMFLOAT3(std::cos(angle) * distance, RandomRange(random, -5.0f, 5.0f), std::sin(angle) * distance);
+			e.scale = RandomRange(random, 0.5f, 2.0f);
+			e.spinSpeed = RandomRange(random, -2.0f, 2.0f);
+			e.angle = RandomRange(random, 0.0f, 6.2831853f);
+			e.world = Identity();
+		}
+
+		scene.uploads.Reset(UploadPageSize);
+		printf("Benchmark scene: %u entities, %u triangles, %zu LODs, %zu meshlets\n",
+			settings.entityCount, scene.lods[0].indexCount / 3, scene.lods.size(), scene.meshlets.meshlets.size());
+	}
+
+	void UpdateScene(BenchmarkScene& scene, const SceneBenchmarkSettings& settings, float deltaTime, float totalTime)
+	{
+		CPU_ZONE("Update");
+
+		for (BenchmarkEntity& e : scene.entities)
+		{
+			e.angle += e.spinSpeed * deltaTime;
+			float c = std::cos(e.angle) * e.scale;
+			float s = std::sin(e.angle) * e.scale;
+
+			// Scale, then spin around Y, then move into place
+			XMFLOAT4X4& w = e.world;
+			w._11 = c;    w._12 = 0.0f;    w._13 = -s;   w._14 = 0.0f;
+			w._21 = 0.0f; w._22 = e.scale; w._23 = 0.0f; w._24 = 0.0f;
+			w._31 = s;    w._32 = 0.0f;    w._33 = c;    w._34 = 0.0f;
+			w._41 = e.position.x; w._42 = e.position.y; w._43 = e.position.z; w._44 = 1.0f;
+		}
+
+		// The camera circles through the scene once a minute, bobbing up and down
+		float orbit = totalTime * 6.2831853f / 60.0f;
+		scene.cameraPosition = XMFLOAT3(std::cos(orbit) * 40.0f, 4.0f + std::sin(orbit * 3.0f) * 2.0f, std::sin(orbit) * 40.0f);
+		scene.view = LookAt(scene.cameraPosition, XMFLOAT3(0, 0, 0), XMFLOAT3(0, 1, 0));
+		scene.proj = Perspective(3.14159265f / 3.0f,
+			(float)settings.viewportWidth / (float)settings.viewportHeight, 0.1f, 500.0f);
+	}
+
+	void CullScene(BenchmarkScene& scene, const SceneBenchmarkSettings& settings, BenchmarkRecorder* recorder)
+	{
+		CPU_ZONE("Culling");
+
+		scene.draws.clear();
+		scene.culledIndices.clear();
+		MeshletCullView frustum = Meshlets::MakeCullView(Identity(), scene.view, scene.proj, scene.cameraPosition);
+		MeshletCullStats meshletStats;
+		double triangles = 0;
+
+		for (unsigned int i = 0; i < (unsigned int)scene.entities.size(); i++)
+		{
+			const BenchmarkEntity& e = scene.entities[i];
+			float radius = scene.meshRadius * e.scale;
+
+			bool visible = true;
+			for (int p = 0; p < 6 && visible; p++)
+			{
+				const XMFLOAT4& plane = frustum.planes[p];
+				visible = plane.x * e.position.x + plane.y * e.position.y + plane.z * e.position.z + plane.w >= -radius;
+			}
+			if (!visible)
+				continue;
+
+			float screenRadius = LodSelector::ScreenRadius(e.position, radius, scene.view, scene.proj, (float)settings.viewportHeight);
+			unsigned int lodIndex = LodSelector::Select(&scene.lods[0], scene.lods.size(), scene.meshRadius, screenRadius);
+			const MeshLod& lod = scene.lods[lodIndex];
+
+			// At full detail, only the meshlets on screen and facing the camera
+			if (lodIndex == 0 && !scene.meshlets.meshlets.empty())
+			{
+				MeshletCullView cullView = Meshlets::MakeCullView(e.world, scene.view, scene.proj, scene.cameraPosition);
+				Meshlets::Cull(scene.meshlets, 0, (unsigned int)scene.meshlets.meshlets.size(), cullView,
+					scene.meshletIndices, &meshletStats);
+				if (scene.meshletIndices.empty())
+					continue;
+
+				BenchmarkDraw draw = { i, (unsigned int)scene.culledIndices.size(), (unsigned int)scene.meshletIndices.size(), true };
+				scene.culledIndices.insert(scene.culledIndices.end(), scene.meshletIndices.begin(), scene.meshletIndices.end());
+				scene.draws.push_back(draw);
+			}
+			else
+			{
+				BenchmarkDraw draw = { i, lod.indexOffset, lod.indexCount, false };
+				scene.draws.push_back(draw);
+			}
+			triangles += scene.draws.back().indexCount / 3;
+		}
+
+		if (recorder)
+		{
+			recorder->AddCount("entitiesVisible", (double)scene.draws.size());
+			recorder->AddCount("trianglesDrawn", triangles);
+			recorder->AddCount("meshletsTested", (double)meshletStats.meshlets);
+			recorder->AddCount("meshletsCulled", (double)(meshletStats.frustumCulled + meshletStats.backfaceCulled));
+		}
+	}
+
+	// Copies into the frame's upload pages, backing each page with
+	// memory the first time the allocator hands it out
+	bool Upload(BenchmarkScene& scene, const void* data, unsigned long long size, unsigned long long alignment)
+	{
+		FrameAllocation allocation;
+		if (!scene.uploads.Allocate(size, alignment, allocation))
+			return false;
+
+		if (allocation.page >= scene.pages.size())
+			scene.pages.resize(allocation.page + 1);
+		std::vector<unsigned char>& page = scene.pages[allocation.page];
+		if (page.empty())
+			page.resize(scene.uploads.GetPageSize());
+
+		memcpy(&page[allocation.offset], data, size);
+		return true;
+	}
+
+	// Pages come back once the (null) GPU has finished with them, as FramePacer sees it
+	void UploadScene(BenchmarkScene& scene, unsigned long long frameFence, unsigned long long completedFence,
+		BenchmarkRecorder* recorder)
+	{
+		CPU_ZONE("Upload");
+		scene.uploads.Retire(completedFence);
+
+		DrawConstants constants;
+		constants.view = scene.view;
+		constants.proj = scene.proj;
+		double bytes = 0;
+		size_t failures = 0;
+		for (const BenchmarkDraw& draw : scene.draws)
+		{
+			// Uniform scale and a rotation, so the inverse transpose is the
+			// world matrix with its scale undone twice
+			const BenchmarkEntity& e = scene.entities[draw.entity];
+			constants.world = e.world;
+			constants.worldInverseTranspose = e.world;
+			float inverseScaleSq = 1.0f / (e.scale * e.scale);
+			for (int r = 0; r < 3; r++)
+			{
+				for (int c = 0; c < 3; c++)
+					constants.worldInverseTranspose.m[r][c] *= inverseScaleSq;
+				constants.worldInverseTranspose.m[3][r] = 0.0f;
+			}
+
+			if (!Upload(scene, &constants, sizeof(constants), ConstantBufferAlignment))
+				failures++;
+			bytes += sizeof(constants);
+
+			if (draw.culledIndices)
+			{
+				unsigned long long size = (unsigned long long)draw.indexCount * sizeof(unsigned int);
+				if (!Upload(scene, &scene.culledIndices[draw.indexOffset], size, sizeof(unsigned int)))
+					failures++;
+				bytes += (double)size;
+			}
+		}
+
+		scene.uploads.EndFrame(frameFence);
+		if (failures > 0)
+			printf("Benchmark: %zu uploads didn't fit in a page\n", failures);
+
+		if (recorder)
+		{
+			recorder->AddCount("drawCalls", (double)scene.draws.size());
+			recorder->AddCount("uploadBytes", bytes);
+		}
+	}
+
+	void WritePercentiles(std::ostream& out, const FramePercentiles& p)
+	{
+		char text[256];
+		snprintf(text, sizeof(text),
+			"{\"count\":%u,\"mean\":%.4f,\"p50\":%.4f,\"p90\":%.4f,\"p99\":%.4f,\"p999\":%.4f,\"max\":%.4f}",
+			p.count, p.mean, p.p50, p.p90, p.p99, p.p999, p.max);
+		out << text;
+	}
+
+	void WriteNumber(std::ostream& out, double value)
+	{
+		char text[64];
+		snprintf(text, sizeof(text), "%.4f", value);
+		out << text;
+	}
+}
+
+// --------------------------------------------------------
+// Every allocation the program makes goes through these,
+// so a frame's allocations can be counted from anywhere
+// --------------------------------------------------------
+void* operator new(size_t size) { return CountedAllocate(size); }
+void* operator new[](size_t size) { return CountedAllocate(size); }
+void operator delete(void* memory) noexcept { free(memory); }
+void operator delete[](void* memory) noexcept { free(memory); }
+void operator delete(void* memory, size_t) noexcept { free(memory); }
+void operator delete[](void* memory, size_t) noexcept { free(memory); }
+
+void* operator new(size_t size, std::align_val_t alignment) { return CountedAllocateAligned(size, (size_t)alignment); }
+void* operator new[](size_t size, std::align_val_t alignment) { return CountedAllocateAligned(size, (size_t)alignment); }
+void operator delete(void* memory, std::align_val_t) noexcept { AlignedFree(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { AlignedFree(memory); }
+void operator delete(void* memory, size_t, std::align_val_t) noexcept { AlignedFree(memory); }
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept { AlignedFree(memory); }
+
+
+BenchmarkRecorder::BenchmarkRecorder()
+{
+	frameStartAllocations = 0;
+	frameStartBytes = 0;
+	allocatedBytes = 0;
+	gpuTimed = false;
+}
+
+void BenchmarkRecorder::BeginFrame()
+{
+	frameStartAllocations = SceneBenchmark::GetAllocationCount();
+	frameStartBytes = SceneBenchmark::GetAllocatedBytes();
+	frameStart = std::chrono::steady_clock::now();
+}
+
+// --------------------------------------------------------
+// The frame's time and allocations are taken first, so
+// collecting the zones (and this bookkeeping) isn't part
+// of them
+// --------------------------------------------------------
+void BenchmarkRecorder::EndFrame()
+{
+	auto frameEnd = std::chrono::steady_clock::now();
+	unsigned long long frameAllocations = SceneBenchmark::GetAllocationCount() - frameStartAllocations;
+	unsigned long long frameBytes = SceneBenchmark::GetAllocatedBytes() - frameStartBytes;
+
+	frameTimes.push_back(std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
+	allocations.push_back((double)frameAllocations);
+	allocatedBytes += (double)frameBytes;
+
+	CpuZones::EndFrame();
+	CpuZoneFrame frame = CpuZones::GetLatestFrame();
+	std::map<std::string, double> totals;
+	for (const CpuZoneRecord& zone : frame.zones)
+		totals[zone.name ? zone.name : ""] += (zone.end - zone.start) * 1000.0;
+
+	// Zones that didn't run in earlier frames count as zero for them
+	for (auto& pair : totals)
+	{
+		std::vector<double>& times = zoneTimes[pair.first];
+		times.resize(frameTimes.size() - 1, 0.0);
+		times.push_back(pair.second);
+	}
+}
+
+void BenchmarkRecorder::AddCount(const char* name, double amount)
+{
+	counts[name] += amount;
+}
+
+void BenchmarkRecorder::SetGpuTimes(const FramePercentiles& gpuTime)
+{
+	this->gpuTime = gpuTime;
+	gpuTimed = gpuTime.count > 0;
+}
+
+unsigned int BenchmarkRecorder::GetFrameCount() { return (unsigned int)frameTimes.size(); }
+
+void BenchmarkRecorder::WriteJson(std::ostream& out, const char* backend, const SceneBenchmarkSettings& settings)
+{
+	double frames = frameTimes.empty() ? 1.0 : (double)frameTimes.size();
+	double wallSeconds = 0;
+	for (double time : frameTimes)
+		wallSeconds += time / 1000.0;
+
+	out << "{\n\"backend\":";
+	WriteJsonString(out, backend);
+	out << ",\n\"frames\":" << frameTimes.size() <<
+		",\n\"warmupFrames\":" << settings.warmupFrames <<
+		",\n\"deltaTime\":";
+	WriteNumber(out, settings.deltaTime);
+	out << ",\n\"seed\":" << settings.seed <<
+		",\n\"viewport\":[" << settings.viewportWidth << "," << settings.viewportHeight << "]" <<
+		",\n\"wallSeconds\":";
+	WriteNumber(out, wallSeconds);
+
+	std::vector<double> values = frameTimes;
+	out << ",\n\"frameTime\":";
+	WritePercentiles(out, FrameStats::ComputePercentiles(values));
+	if (gpuTimed)
+	{
+		out << ",\n\"gpuTime\":";
+		WritePercentiles(out, gpuTime);
+	}
+
+	out << ",\n\"subsystems\":{";
+	bool first = true;
+	for (auto& pair : zoneTimes)
+	{
+		values = pair.second;
+		values.resize(frameTimes.size(), 0.0);
+		out << (first ? "\n" : ",\n");
+		WriteJsonString(out, pair.first);
+		out << ":";
+		WritePercentiles(out, FrameStats::ComputePercentiles(values));
+		first = false;
+	}
+
+	values = allocations;
+	FramePercentiles allocationCounts = FrameStats::ComputePercentiles(values);
+	out << "},\n\"allocations\":{\"perFrame\":";
+	WriteNumber(out, allocationCounts.mean);
+	out << ",\"max\":";
+	WriteNumber(out, allocationCounts.max);
+	out << ",\"bytesPerFrame\":";
+	WriteNumber(out, allocatedBytes / frames);
+
+	out << "},\n\"counts\":{";
+	first = true;
+	for (auto& pair : counts)
+	{
+		out << (first ? "\n" : ",\n");
+		WriteJsonString(out, pair.first);
+		out << ":{\"total\":";
+		WriteNumber(out, pair.second);
+		out << ",\"perFrame\":";
+		WriteNumber(out, pair.second / frames);
+		out << ",\"perSecond\":";
+		WriteNumber(out, wallSeconds > 0 ? pair.second / wallSeconds : 0.0);
+		out << "}";
+		first = false;
+	}
+	out << "}\n}\n";
+}
+
+bool BenchmarkRecorder::WriteJson(const std::filesystem::path& file, const char* backend, const SceneBenchmarkSettings& settings)
+{
+	std::ofstream out(file, std::ios::trunc);
+	if (!out)
+		return false;
+
+	WriteJson(out, backend, settings);
+	return (bool)out;
+}
+
+void BenchmarkRecorder::PrintSummary()
+{
+	std::vector<double> values = frameTimes;
+	FramePercentiles frameTime = FrameStats::ComputePercentiles(values);
+	values = allocations;
+	FramePercentiles allocationCounts = FrameStats::ComputePercentiles(values);
+
+	printf("Benchmark: %u frames, %.3f ms mean, %.3f ms p99, %.3f ms max, %.1f allocations per frame\n",
+		frameTime.count, frameTime.mean, frameTime.p99, frameTime.max, allocationCounts.mean);
+	for (auto& pair : zoneTimes)
+	{
+		values = pair.second;
+		values.resize(frameTimes.size(), 0.0);
+		FramePercentiles zone = FrameStats::ComputePercentiles(values);
+		printf("  %-32s %8.3f ms mean %8.3f ms p99\n", pair.first.c_str(), zone.mean, zone.p99);
+	}
+}
+
+
+unsigned long long SceneBenchmark::GetAllocationCount() { return allocationCount.load(std::memory_order_relaxed); }
+unsigned long long SceneBenchmark::GetAllocatedBytes() { return allocatedBytes.load(std::memory_order_relaxed); }
+
+// --------------------------------------------------------
+// Warm-up frames run exactly like the rest, so caches,
+// upload pages and vector capacities have settled before
+// anything is recorded
+// --------------------------------------------------------
+bool SceneBenchmark::RunHeadless(const SceneBenchmarkSettings& settings, const std::filesystem::path& reportFile)
+{
+	BenchmarkScene scene;
+	BuildScene(scene, settings);
+	CpuZones::EndFrame();
+
+	FramePacingDeviceNull device;
+	FramePacer pacer(&device, FramesInFlight);
+
+	BenchmarkRecorder recorder;
+	unsigned int totalFrames = settings.warmupFrames + settings.frames;
+	for (unsigned int i = 0; i < totalFrames; i++)
+	{
+		bool recording = i >= settings.warmupFrames;
+		BenchmarkRecorder* frameRecorder = recording ? &recorder : 0;
+		float totalTime = (float)((i + 1) * settings.deltaTime);
+
+		if (recording)
+			recorder.BeginFrame();
+		{
+			CPU_ZONE("Frame");
+			UpdateScene(scene, settings, (float)settings.deltaTime, totalTime);
+			CullScene(scene, settings, frameRecorder);
+			UploadScene(scene, pacer.GetFrameFence(), device.GetCompletedFence(), frameRecorder);
+		}
+		pacer.FrameSubmitted();
+		pacer.FramePresented();
+
+		if (recording)
+			recorder.EndFrame();
+		else
+			CpuZones::EndFrame();
+	}
+
+	recorder.PrintSummary();
+	if (!recorder.WriteJson(reportFile, "null", settings))
+	{
+		printf("Benchmark: couldn't write %s\n", reportFile.string().c_str());
+		return false;
+	}
+
+	printf("Benchmark: wrote %s\n", reportFile.string().c_str());
+	return true;
+}
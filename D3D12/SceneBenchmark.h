@@ -0,0 +1,105 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "FrameStats.h"
+
+struct SceneBenchmarkSettings
+{
+	unsigned int frames = 600;			// Recorded, after the warm-up frames
+	unsigned int warmupFrames = 30;
+	double deltaTime = 1.0 / 60.0;		// Simulated seconds per frame, whatever the real time
+	unsigned int entityCount = 2000;	// Headless scene only
+	unsigned int seed = 1;
+	unsigned int viewportWidth = 1280;
+	unsigned int viewportHeight = 720;
+};
+
+// --------------------------------------------------------
+// Gathers a benchmark run's per-frame measurements and
+// writes them out as JSON
+//
+// Each frame records its CPU time, the allocations made
+// during it (every operator new in the program is counted,
+// see SceneBenchmark.cpp) and the time spent in each CPU
+// zone, summed by name over every thread. Anything else
+// worth a throughput figure is added with AddCount().
+// --------------------------------------------------------
+class BenchmarkRecorder
+{
+public:
+
+	BenchmarkRecorder();
+
+	void BeginFrame();
+
+	// Ends the frame's timing and allocation counting, then collects its
+	// CPU zones (this calls CpuZones::EndFrame())
+	void EndFrame();
+
+	// Adds to a total reported overall, per frame and per second
+	void AddCount(const char* name, double amount);
+
+	// GPU times from wherever the run gets them, if it renders
+	void SetGpuTimes(const FramePercentiles& gpuTime);
+
+	unsigned int GetFrameCount();
+
+	void WriteJson(std::ostream& out, const char* backend, const SceneBenchmarkSettings& settings);
+	bool WriteJson(const std::filesystem::path& file, const char* backend, const SceneBenchmarkSettings& settings);
+	void PrintSummary();
+
+private:
+
+	std::chrono::steady_clock::time_point frameStart;
+	unsigned long long frameStartAllocations;
+	unsigned long long frameStartBytes;
+
+	std::vector<double> frameTimes;		// Milliseconds
+	std::vector<double> allocations;	// Per frame
+	double allocatedBytes;
+
+	// Milliseconds per frame in each zone, zero where it didn't run
+	std::map<std::string, std::vector<double>> zoneTimes;
+	std::map<std::string, double> counts;
+
+	bool gpuTimed;
+	FramePercentiles gpuTime;
+};
+
+// --------------------------------------------------------
+// A scripted scene that runs the CPU side of a frame with
+// no window and no GPU (the "null" backend), for perf runs
+// that have to be repeatable and run anywhere, CI included
+//
+// A procedural sphere gets the same LOD chain and meshlets
+// as a loaded mesh. The entities are placed from the seed,
+// spin, and are seen by a camera on a fixed orbit. Every
+// frame advances by the same simulated delta. Each frame
+// then:
+//  - Update: spins every entity and moves the camera
+//  - Culling: frustum culls entities, picks their LODs and
+//    culls the meshlets of those at full detail
+//  - Upload: writes each draw's constants and culled
+//    indices into per-frame pages from a FrameAllocator,
+//    backed by plain memory
+//
+// Frames are paced by a FramePacer on a null device (see
+// FramePacingDeviceNull.h), whose fence decides when the
+// upload pages come back. Only plain matrices and standard
+// C++ are used, so none of it depends on Windows or D3D12,
+// and the SceneBenchmark tool runs it on any platform.
+// --------------------------------------------------------
+namespace SceneBenchmark
+{
+	// Every operator new since the program started
+	unsigned long long GetAllocationCount();
+	unsigned long long GetAllocatedBytes();
+
+	// Runs the scene and writes the report. Returns false if it can't be written.
+	bool RunHeadless(const SceneBenchmarkSettings& settings, const std::filesystem::path& reportFile);
+}
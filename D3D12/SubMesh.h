@@ -0,0 +1,15 @@
+#pragma once
+
+// A part of a mesh that's drawn with its own material. Every
+// sub-mesh shares the mesh's vertex and index buffers, so
+// drawing one is just a different range of them.
+struct SubMesh
+{
+	unsigned int indexOffset;	// Full resolution triangles in the index buffer
+	unsigned int indexCount;
+	unsigned int lodOffset;		// First entry in the mesh's LOD array
+	unsigned int lodCount;
+	unsigned int meshletOffset;	// First entry in MeshletData::meshlets
+	unsigned int meshletCount;
+	unsigned int materialSlot;	// Index into the mesh's material names
+};
@@ -0,0 +1,327 @@
+#include "Tangents.h"
+#include "Parallel.h"
+
+#include <cmath>
+#include <vector>
+#include <xmmintrin.h>
+
+namespace Tangents
+{
+	// Annonymous namespace to hold helpers
+	// only accessible in this file
+	namespace
+	{
+		// Each thread's accumulator holds 8 floats per vertex:
+		// tangent xyz + padding, then bitangent xyz + padding
+		const size_t AccumulatorStride = 8;
+
+		// Fewer triangles than this per thread aren't worth a thread
+		const size_t MinTrianglesPerThread = 16384;
+
+		inline float Dot(const float* a, const float* b)
+		{
+			return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+		}
+
+		// --------------------------------------------------------
+		// Adds one triangle's tangent and bitangent to each of its
+		// three vertices in the given accumulator
+		// --------------------------------------------------------
+		inline void Accumulate(float* accumulator, const unsigned int* tri, __m128 tangent, __m128 bitangent)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				float* a = accumulator + tri[c] * AccumulatorStride;
+				_mm_storeu_ps(a, _mm_add_ps(_mm_loadu_ps(a), tangent));
+				_mm_storeu_ps(a + 4, _mm_add_ps(_mm_loadu_ps(a + 4), bitangent));
+			}
+		}
+
+		// --------------------------------------------------------
+		// Accumulates a single triangle, used for leftovers that
+		// don't fill a group of four. Triangles with degenerate
+		// UVs contribute nothing rather than infinities.
+		// --------------------------------------------------------
+		void AccumulateTriangle(float* accumulator, const Vertex* verts, const unsigned int* tri)
+		{
+			const Vertex& v1 = verts[tri[0]];
+			const Vertex& v2 = verts[tri[1]];
+			const Vertex& v3 = verts[tri[2]];
+
+			float x1 = v2.Position.x - v1.Position.x;
+			float y1 = v2.Position.y - v1.Position.y;
+			float z1 = v2.Position.z - v1.Position.z;
+			float x2 = v3.Position.x - v1.Position.x;
+			float y2 = v3.Position.y - v1.Position.y;
+			float z2 = v3.Position.z - v1.Position.z;
+
+			float s1 = v2.UV.x - v1.UV.x;
+			float t1 = v2.UV.y - v1.UV.y;
+			float s2 = v3.UV.x - v1.UV.x;
+			float t2 = v3.UV.y - v1.UV.y;
+
+			float det = s1 * t2 - s2 * t1;
+			float r = det != 0.0f ? 1.0f / det : 0.0f;
+
+			__m128 tangent = _mm_set_ps(0.0f, (t2 * z1 - t1 * z2) * r, (t2 * y1 - t1 * y2) * r, (t2 * x1 - t1 * x2) * r);
+			__m128 bitangent = _mm_set_ps(0.0f, (s1 * z2 - s2 * z1) * r, (s1 * y2 - s2 * y1) * r, (s1 * x2 - s2 * x1) * r);
+			Accumulate(accumulator, tri, tangent, bitangent);
+		}
+
+		// --------------------------------------------------------
+		// Accumulates triangles [first, last) four at a time. Each
+		// group is transposed into structure-of-arrays registers
+		// (one lane per triangle), solved together, then transposed
+		// back into one tangent/bitangent vector per triangle.
+		// --------------------------------------------------------
+		void AccumulateRange(float* accumulator, const Vertex* verts, const unsigned int* indices, size_t first, size_t last)
+		{
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 one = _mm_set1_ps(1.0f);
+
+			size_t t = first;
+			for (; t + 4 <= last; t += 4)
+			{
+				const unsigned int* tris = indices + t * 3;
+
+				// Load each corner as (x, y, z, normal.x) and (u, v, tangent.x, tangent.y),
+				// then transpose so every register holds one component of all four
+				__m128 pa[4], pb[4], pc[4], ua[4], ub[4], uc[4];
+				for (int lane = 0; lane < 4; lane++)
+				{
+					const Vertex& a = verts[tris[lane * 3 + 0]];
+					const Vertex& b = verts[tris[lane * 3 + 1]];
+					const Vertex& c = verts[tris[lane * 3 + 2]];
+					pa[lane] = _mm_loadu_ps(&a.Position.x);
+					pb[lane] = _mm_loadu_ps(&b.Position.x);
+					pc[lane] = _mm_loadu_ps(&c.Position.x);
+					ua[lane] = _mm_loadu_ps(&a.UV.x);
+					ub[lane] = _mm_loadu_ps(&b.UV.x);
+					uc[lane] = _mm_loadu_ps(&c.UV.x);
+				}
+				_MM_TRANSPOSE4_PS(pa[0], pa[1], pa[2], pa[3]);
+				_MM_TRANSPOSE4_PS(pb[0], pb[1], pb[2], pb[3]);
+				_MM_TRANSPOSE4_PS(pc[0], pc[1], pc[2], pc[3]);
+				_MM_TRANSPOSE4_PS(ua[0], ua[1], ua[2], ua[3]);
+				_MM_TRANSPOSE4_PS(ub[0], ub[1], ub[2], ub[3]);
+				_MM_TRANSPOSE4_PS(uc[0], uc[1], uc[2], uc[3]);
+
+				__m128 x1 = _mm_sub_ps(pb[0], pa[0]);
+				__m128 y1 = _mm_sub_ps(pb[1], pa[1]);
+				__m128 z1 = _mm_sub_ps(pb[2], pa[2]);
+				__m128 x2 = _mm_sub_ps(pc[0], pa[0]);
+				__m128 y2 = _mm_sub_ps(pc[1], pa[1]);
+				__m128 z2 = _mm_sub_ps(pc[2], pa[2]);
+
+				__m128 s1 = _mm_sub_ps(ub[0], ua[0]);
+				__m128 t1 = _mm_sub_ps(ub[1], ua[1]);
+				__m128 s2 = _mm_sub_ps(uc[0], ua[0]);
+				__m128 t2 = _mm_sub_ps(uc[1], ua[1]);
+
+				// r = 1 / det, or 0 for degenerate UVs
+				__m128 det = _mm_sub_ps(_mm_mul_ps(s1, t2), _mm_mul_ps(s2, t1));
+				__m128 r = _mm_and_ps(_mm_div_ps(one, det), _mm_cmpneq_ps(det, zero));
+
+				__m128 tx = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, x1), _mm_mul_ps(t1, x2)), r);
+				__m128 ty = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, y1), _mm_mul_ps(t1, y2)), r);
+				__m128 tz = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, z1), _mm_mul_ps(t1, z2)), r);
+				__m128 tw = zero;
+
+				__m128 bx = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(s1, x2), _mm_mul_ps(s2, x1)), r);
+				__m128 by = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(s1, y2), _mm_mul_ps(s2, y1)), r);
+				__m128 bz = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(s1, z2), _mm_mul_ps(s2, z1)), r);
+				__m128 bw = zero;
+
+				// After transposing, each register holds one triangle's xyz0
+				_MM_TRANSPOSE4_PS(tx, ty, tz, tw);
+				_MM_TRANSPOSE4_PS(bx, by, bz, bw);
+
+				Accumulate(accumulator, tris + 0, tx, bx);
+				Accumulate(accumulator, tris + 3, ty, by);
+				Accumulate(accumulator, tris + 6, tz, bz);
+				Accumulate(accumulator, tris + 9, tw, bw);
+			}
+
+			for (; t < last; t++)
+				AccumulateTriangle(accumulator, verts, indices + t * 3);
+		}
+
+		// --------------------------------------------------------
+		// Gram-Schmidt orthogonalizes the summed tangent against
+		// the normal and works out the bitangent's handedness
+		// --------------------------------------------------------
+		void FinishVertex(Vertex& v, const float* tangent, const float* bitangent)
+		{
+			const float* n = &v.Normal.x;
+			float nDotT = Dot(n, tangent);
+			float t[3] =
+			{
+				tangent[0] - n[0] * nDotT,
+				tangent[1] - n[1] * nDotT,
+				tangent[2] - n[2] * nDotT
+			};
+
+			// No usable UVs here, so any tangent perpendicular to the normal will do
+			float lengthSq = Dot(t, t);
+			if (!(lengthSq > 1e-20f))
+			{
+				float axis[3] = { 0, 0, 0 };
+				axis[std::fabs(n[0]) < 0.9f ? 0 : 1] = 1.0f;
+				float aDotN = Dot(axis, n);
+				t[0] = axis[0] - n[0] * aDotN;
+				t[1] = axis[1] - n[1] * aDotN;
+				t[2] = axis[2] - n[2] * aDotN;
+				lengthSq = Dot(t, t);
+			}
+
+			float scale = lengthSq > 0.0f ? 1.0f / std::sqrt(lengthSq) : 0.0f;
+			v.Tangent.x = t[0] * scale;
+			v.Tangent.y = t[1] * scale;
+			v.Tangent.z = t[2] * scale;
+
+			// Right-handed when the bitangent lines up with cross(N, T)
+			float nCrossT[3] =
+			{
+				n[1] * t[2] - n[2] * t[1],
+				n[2] * t[0] - n[0] * t[2],
+				n[0] * t[1] - n[1] * t[0]
+			};
+			v.Tangent.w = Dot(nCrossT, bitangent) < 0.0f ? -1.0f : 1.0f;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Each thread accumulates a contiguous range of triangles
+// into its own per-vertex array. Once they're done, the
+// vertices are split into ranges and each thread sums every
+// array for its range before finishing those vertices, so
+// no two threads ever write the same memory.
+// --------------------------------------------------------
+void Tangents::Calculate(Vertex* verts, size_t vertexCount, const unsigned int* indices, size_t indexCount, unsigned int threadCount)
+{
+	size_t triangleCount = indexCount / 3;
+	if (vertexCount == 0)
+		return;
+
+	if (threadCount == 0)
+		threadCount = Parallel::HardwareThreads();
+
+	size_t threads = triangleCount / MinTrianglesPerThread;
+	if (threads > threadCount) threads = threadCount;
+	if (threads < 1) threads = 1;
+
+	std::vector<std::vector<float>> accumulators(threads);
+	Parallel::Run(threads, [&](size_t i)
+		{
+			accumulators[i].assign(vertexCount * AccumulatorStride, 0.0f);
+			AccumulateRange(accumulators[i].data(), verts, indices,
+				triangleCount * i / threads,
+				triangleCount * (i + 1) / threads);
+		});
+
+	Parallel::Run(threads, [&](size_t i)
+		{
+			size_t first = vertexCount * i / threads;
+			size_t last = vertexCount * (i + 1) / threads;
+			for (size_t v = first; v < last; v++)
+			{
+				__m128 tangent = _mm_loadu_ps(&accumulators[0][v * AccumulatorStride]);
+				__m128 bitangent = _mm_loadu_ps(&accumulators[0][v * AccumulatorStride + 4]);
+				for (size_t a = 1; a < threads; a++)
+				{
+					tangent = _mm_add_ps(tangent, _mm_loadu_ps(&accumulators[a][v * AccumulatorStride]));
+					bitangent = _mm_add_ps(bitangent, _mm_loadu_ps(&accumulators[a][v * AccumulatorStride + 4]));
+				}
+
+				float sums[8];
+				_mm_storeu_ps(sums, tangent);
+				_mm_storeu_ps(sums + 4, bitangent);
+				FinishVertex(verts[v], sums, sums + 4);
+			}
+		});
+}
+
+// --------------------------------------------------------
+// Author: Chris Cascioli
+// Purpose: Calculates the tangents of the vertices in a mesh
+//
+// - You are allowed to directly copy/paste this into your code base
+//   for assignments, given that you clearly cite that this is not
+//   code of your own design.
+//
+// - Code originally adapted from: http://www.terathon.com/code/tangent.html
+//   - Updated version now found here: http://foundationsofgameenginedev.com/FGED2-sample.pdf
+//   - See listing 7.4 in section 7.5 (page 9 of the PDF)
+//
+// - This is the original Mesh::CalculateTangents, plus the bitangent
+//   accumulation needed for handedness. Calculate() must match it.
+// --------------------------------------------------------
+void Tangents::CalculateReference(Vertex* verts, size_t vertexCount, const unsigned int* indices, size_t indexCount)
+{
+	// Reset tangents
+	std::vector<DirectX::XMFLOAT3> bitangents(vertexCount, DirectX::XMFLOAT3(0, 0, 0));
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		verts[i].Tangent = DirectX::XMFLOAT4(0, 0, 0, 0);
+	}
+
+	// Calculate tangents one whole triangle at a time
+	for (size_t i = 0; i + 2 < indexCount;)
+	{
+		// Grab indices and vertices of first triangle
+		unsigned int i1 = indices[i++];
+		unsigned int i2 = indices[i++];
+		unsigned int i3 = indices[i++];
+		Vertex* v1 = &verts[i1];
+		Vertex* v2 = &verts[i2];
+		Vertex* v3 = &verts[i3];
+
+		// Calculate vectors relative to triangle positions
+		float x1 = v2->Position.x - v1->Position.x;
+		float y1 = v2->Position.y - v1->Position.y;
+		float z1 = v2->Position.z - v1->Position.z;
+
+		float x2 = v3->Position.x - v1->Position.x;
+		float y2 = v3->Position.y - v1->Position.y;
+		float z2 = v3->Position.z - v1->Position.z;
+
+		// Do the same for vectors relative to triangle uv's
+		float s1 = v2->UV.x - v1->UV.x;
+		float t1 = v2->UV.y - v1->UV.y;
+
+		float s2 = v3->UV.x - v1->UV.x;
+		float t2 = v3->UV.y - v1->UV.y;
+
+		// Create vectors for tangent calculation
+		float r = 1.0f / (s1 * t2 - s2 * t1);
+
+		float tx = (t2 * x1 - t1 * x2) * r;
+		float ty = (t2 * y1 - t1 * y2) * r;
+		float tz = (t2 * z1 - t1 * z2) * r;
+
+		float bx = (s1 * x2 - s2 * x1) * r;
+		float by = (s1 * y2 - s2 * y1) * r;
+		float bz = (s1 * z2 - s2 * z1) * r;
+
+		// Adjust tangents and bitangents of each vert of the triangle
+		unsigned int tri[3] = { i1, i2, i3 };
+		for (unsigned int v : tri)
+		{
+			verts[v].Tangent.x += tx;
+			verts[v].Tangent.y += ty;
+			verts[v].Tangent.z += tz;
+
+			bitangents[v].x += bx;
+			bitangents[v].y += by;
+			bitangents[v].z += bz;
+		}
+	}
+
+	// Ensure all of the tangents are orthogonal to the normals
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		float tangent[3] = { verts[i].Tangent.x, verts[i].Tangent.y, verts[i].Tangent.z };
+		FinishVertex(verts[i], tangent, &bitangents[i].x);
+	}
+}
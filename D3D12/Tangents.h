@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Per-vertex tangent frame generation
+//
+// Tangents are written to Vertex::Tangent.xyz, orthogonal
+// to the normal, with the bitangent's handedness (+1 or -1)
+// in Tangent.w so mirrored UVs shade correctly. Shaders
+// rebuild the bitangent as cross(T, N) * Tangent.w.
+// --------------------------------------------------------
+namespace Tangents
+{
+	// Triangles are processed four at a time with SSE, split across up to
+	// threadCount threads (0 = one per core) that each accumulate into their
+	// own arrays, which are summed at the end so no atomics are needed
+	void Calculate(Vertex* verts, size_t vertexCount, const unsigned int* indices, size_t indexCount, unsigned int threadCount = 0);
+
+	// Straightforward one-triangle-at-a-time version, kept as a reference
+	void CalculateReference(Vertex* verts, size_t vertexCount, const unsigned int* indices, size_t indexCount);
+}
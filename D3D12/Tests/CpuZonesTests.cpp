@@ -0,0 +1,104 @@
+#include "TestFramework.h"
+#include "CpuZones.h"
+
+#include <cstring>
+#include <thread>
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	const char* OuterName = "CpuZonesTest Outer";
+	const char* InnerName = "CpuZonesTest Inner";
+
+	// Opens count outer zones, each around an inner one
+	void OpenZones(unsigned int count)
+	{
+		for (unsigned int i = 0; i < count; i++)
+		{
+			CpuZones::Zone outer(OuterName);
+			CpuZones::Zone inner(InnerName);
+		}
+	}
+
+	size_t CountZones(const CpuZoneFrame& frame, const char* name)
+	{
+		size_t count = 0;
+		for (const CpuZoneRecord& zone : frame.zones)
+		{
+			if (zone.name && strcmp(zone.name, name) == 0)
+				count++;
+		}
+		return count;
+	}
+
+	// Zones from threads that have already exited, collected into a new frame
+	CpuZoneFrame RunThreads(unsigned int threadCount, unsigned int zonesPerThread)
+	{
+		std::vector<std::thread> threads;
+		for (unsigned int t = 0; t < threadCount; t++)
+			threads.emplace_back(OpenZones, zonesPerThread);
+		for (std::thread& t : threads)
+			t.join();
+
+		CpuZones::EndFrame();
+		return CpuZones::GetLatestFrame();
+	}
+}
+
+// Every thread's zones are drained into the next frame, once, with each parent before its child
+TEST(CpuZones, DrainsEveryThreadOnce)
+{
+	CpuZones::EndFrame();
+	CpuZoneFrame frame = RunThreads(4, 100);
+	CHECK_EQUAL(400u, CountZones(frame, OuterName));
+	CHECK_EQUAL(400u, CountZones(frame, InnerName));
+
+	size_t misplaced = 0;
+	for (size_t i = 0; i < frame.zones.size(); i++)
+	{
+		const CpuZoneRecord& zone = frame.zones[i];
+		if (!zone.name || strcmp(zone.name, InnerName) != 0)
+			continue;
+
+		const CpuZoneRecord* parent = i > 0 ? &frame.zones[i - 1] : 0;
+		if (zone.depth != 1 || !parent || strcmp(parent->name, OuterName) != 0 ||
+			parent->thread != zone.thread || parent->start > zone.start || parent->end < zone.end)
+			misplaced++;
+	}
+	CHECK_EQUAL(0u, misplaced);
+
+	CpuZones::EndFrame();
+	CHECK_EQUAL(0u, CountZones(CpuZones::GetLatestFrame(), OuterName));
+}
+
+// Threads that have exited hand their rings (and tracks) on to new threads
+TEST(CpuZones, ReusesRetiredRings)
+{
+	RunThreads(4, 10);
+	size_t rings = CpuZones::GetThreadNames().size();
+
+	for (int round = 0; round < 5; round++)
+	{
+		CpuZoneFrame frame = RunThreads(4, 10);
+		CHECK_EQUAL(40u, CountZones(frame, OuterName));
+	}
+	CHECK_EQUAL(rings, CpuZones::GetThreadNames().size());
+}
+
+// A ring that fills between frames drops what doesn't fit, and counts it
+TEST(CpuZones, DropsWhenRingFull)
+{
+	CpuZones::EndFrame();
+	size_t droppedBefore = CpuZones::GetDroppedZones();
+
+	std::thread([]()
+		{
+			for (unsigned int i = 0; i < CpuZones::RingSize + 100; i++)
+				CpuZones::Zone zone(OuterName);
+		}).join();
+	CpuZones::EndFrame();
+
+	CHECK_EQUAL(CpuZones::RingSize, CountZones(CpuZones::GetLatestFrame(), OuterName));
+	CHECK_EQUAL(100u, CpuZones::GetDroppedZones() - droppedBefore);
+}
@@ -0,0 +1,196 @@
+#include "TestFramework.h"
+#include "FrameAllocator.h"
+
+#include <map>
+#include <random>
+#include <utility>
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// Stands in for the GPU: frames are submitted with the fence value
+	// signalled after them, and finish some frames later in order
+	struct SimulatedFence
+	{
+		unsigned long long completed = 0;
+		unsigned long long next = 1;
+
+		unsigned long long Submit() { return next++; }
+		void CompleteUpTo(unsigned long long value) { if (value > completed) completed = value; }
+	};
+
+	// Which frame (by fence value) last wrote each byte range, so a
+	// new allocation can be checked against frames still in flight
+	struct PageMemory
+	{
+		std::map<std::pair<unsigned int, unsigned long long>, std::pair<unsigned long long, unsigned long long>> writes;
+
+		// False if any part of [offset, offset + size) in the page still
+		// belongs to a frame the fence hasn't reached yet
+		bool Write(const FrameAllocation& allocation, unsigned long long size, unsigned long long frameFence, unsigned long long completedFence)
+		{
+			bool safe = true;
+			for (auto it = writes.begin(); it != writes.end();)
+			{
+				unsigned long long start = it->first.second;
+				unsigned long long end = start + it->second.first;
+				bool overlaps = it->first.first == allocation.page && start < allocation.offset + size && allocation.offset < end;
+				if (overlaps)
+				{
+					if (it->second.second != frameFence && it->second.second > completedFence)
+						safe = false;
+					it = writes.erase(it);
+				}
+				else
+				{
+					it++;
+				}
+			}
+			writes[{ allocation.page, allocation.offset }] = { size, frameFence };
+			return safe;
+		}
+	};
+}
+
+// Nothing a frame in flight wrote is handed out again until the fence
+// passes that frame, however far the GPU falls behind
+TEST(FrameAllocator, ReusesPagesOnlyAfterTheirFence)
+{
+	FrameAllocator allocator(1024);
+	SimulatedFence fence;
+	PageMemory memory;
+	std::mt19937 random(7);
+
+	size_t unsafeWrites = 0;
+	for (int frame = 0; frame < 400; frame++)
+	{
+		// The GPU runs anywhere from zero to three frames behind
+		unsigned long long lag = random() % 4;
+		if (fence.next > lag + 1)
+			fence.CompleteUpTo(fence.next - 1 - lag);
+		allocator.Retire(fence.completed);
+
+		unsigned long long frameFence = fence.next;
+		int count = 1 + random() % 20;
+		for (int i = 0; i < count; i++)
+		{
+			unsigned long long size = 16 + random() % 300;
+			FrameAllocation allocation;
+			CHECK(allocator.Allocate(size, 256, allocation));
+			CHECK(allocation.offset % 256 == 0);
+			CHECK(allocation.offset + size <= 1024);
+			if (!memory.Write(allocation, size, frameFence, fence.completed))
+				unsafeWrites++;
+		}
+		allocator.EndFrame(fence.Submit());
+	}
+
+	CHECK_EQUAL(0u, unsafeWrites);
+
+	// Every page is free again once the GPU catches up
+	fence.CompleteUpTo(fence.next - 1);
+	allocator.Retire(fence.completed);
+	CHECK_EQUAL(0ull, allocator.GetOldestFence());
+	CHECK_EQUAL(0u, allocator.GetStats().pagesInUse);
+}
+
+// Frames come back oldest first, and a single completed value can cover several
+TEST(FrameAllocator, RetiresFramesInOrder)
+{
+	FrameAllocator allocator(256);
+	FrameAllocation allocation;
+
+	for (unsigned long long fenceValue = 1; fenceValue <= 3; fenceValue++)
+	{
+		CHECK(allocator.Allocate(256, 1, allocation));
+		CHECK_EQUAL((unsigned int)(fenceValue - 1), allocation.page);
+		allocator.EndFrame(fenceValue);
+	}
+	CHECK_EQUAL(1ull, allocator.GetOldestFence());
+	CHECK_EQUAL(3u, allocator.GetStats().pagesInUse);
+
+	// Not there yet: nothing changes
+	allocator.Retire(0);
+	CHECK_EQUAL(1ull, allocator.GetOldestFence());
+	CHECK_EQUAL(3u, allocator.GetStats().pagesInUse);
+
+	allocator.Retire(1);
+	CHECK_EQUAL(2ull, allocator.GetOldestFence());
+	CHECK_EQUAL(2u, allocator.GetStats().pagesInUse);
+
+	// The first frame's page is the one that comes back
+	CHECK(allocator.Allocate(256, 1, allocation));
+	CHECK_EQUAL(0u, allocation.page);
+	CHECK_EQUAL(3u, allocator.GetPageCount());
+	allocator.EndFrame(4);
+
+	allocator.Retire(3);
+	CHECK_EQUAL(4ull, allocator.GetOldestFence());
+	CHECK_EQUAL(1u, allocator.GetStats().pagesInUse);
+
+	allocator.Retire(4);
+	CHECK_EQUAL(0ull, allocator.GetOldestFence());
+	CHECK_EQUAL(0u, allocator.GetStats().pagesInUse);
+}
+
+// A busy frame adds pages instead of touching ones still in flight
+TEST(FrameAllocator, BusyFrameGrowsPages)
+{
+	FrameAllocator allocator(1024);
+	FrameAllocation allocation;
+
+	for (int i = 0; i < 4; i++)
+		CHECK(allocator.Allocate(1024, 1, allocation));
+	allocator.EndFrame(1);
+	CHECK_EQUAL(4u, allocator.GetPageCount());
+
+	// The GPU hasn't finished frame 1, so frame 2 gets new pages
+	for (int i = 0; i < 2; i++)
+	{
+		CHECK(allocator.Allocate(512, 1, allocation));
+		CHECK(allocation.page >= 4);
+	}
+	allocator.EndFrame(2);
+	CHECK_EQUAL(5u, allocator.GetPageCount());
+
+	FrameAllocatorStats stats = allocator.GetStats();
+	CHECK_EQUAL(4096ull, stats.highWaterBytes);
+	CHECK_EQUAL(4u, stats.highWaterPages);
+	CHECK_EQUAL(1024ull, stats.lastFrameBytes);
+	CHECK_EQUAL(0u, stats.failures);
+}
+
+// With a page limit, running out fails rather than reusing a page in flight
+TEST(FrameAllocator, PageLimitFailsInsteadOfAliasing)
+{
+	FrameAllocator allocator(64, 2);
+	FrameAllocation allocation;
+
+	CHECK(allocator.Allocate(64, 1, allocation));
+	allocator.EndFrame(1);
+
+	// One page left for this frame, then nothing
+	CHECK(allocator.Allocate(64, 1, allocation));
+	CHECK_EQUAL(1u, allocation.page);
+	CHECK(!allocator.Allocate(1, 1, allocation));
+	CHECK_EQUAL(1u, allocator.GetStats().failures);
+
+	// Once frame 1 is done its page can be used
+	allocator.Retire(1);
+	CHECK(allocator.Allocate(1, 1, allocation));
+	CHECK_EQUAL(0u, allocation.page);
+
+	// A frame that fills every page itself can't be helped by retiring
+	CHECK(allocator.Allocate(63, 1, allocation));
+	CHECK(!allocator.Allocate(1, 1, allocation));
+	allocator.Retire(100);
+	CHECK(!allocator.Allocate(1, 1, allocation));
+	CHECK_EQUAL(3u, allocator.GetStats().failures);
+
+	// Bigger than a page never fits
+	allocator.EndFrame(2);
+	allocator.Retire(2);
+	CHECK(!allocator.Allocate(65, 1, allocation));
+	CHECK_EQUAL(4u, allocator.GetStats().failures);
+}
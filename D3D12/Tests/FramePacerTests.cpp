@@ -0,0 +1,258 @@
+#include "TestFramework.h"
+#include "FramePacer.h"
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// --------------------------------------------------------
+	// A GPU that takes gpuFrameTime for each frame, one after
+	// another, on a clock that only moves when the test (or a
+	// wait) moves it
+	// --------------------------------------------------------
+	class FakeFramePacingDevice : public FramePacingDevice
+	{
+	public:
+
+		struct GpuFrame
+		{
+			unsigned long long fence = 0;
+			double start = 0;
+			double end = 0;
+		};
+
+		double now = 0;
+		double gpuFrameTime = 0.010;
+		double gpuFree = 0;
+		bool timed = true;
+		unsigned long long signalled = 0;
+		size_t fenceWaits = 0;
+		size_t presentWaits = 0;
+		size_t earlyTimeQueries = 0;
+		std::vector<GpuFrame> frames;
+		GpuFrame slotFrames[FramePacer::MaxFramesInFlight];
+		int endedSlot = -1;
+
+		double GetTime() override { return now; }
+
+		void SignalFence(unsigned long long value) override
+		{
+			GpuFrame frame;
+			frame.fence = value;
+			frame.start = now > gpuFree ? now : gpuFree;
+			frame.end = frame.start + gpuFrameTime;
+			gpuFree = frame.end;
+			frames.push_back(frame);
+			signalled = value;
+
+			if (endedSlot >= 0)
+				slotFrames[endedSlot] = frame;
+			endedSlot = -1;
+		}
+
+		unsigned long long GetCompletedFence() override
+		{
+			unsigned long long completed = 0;
+			for (const GpuFrame& frame : frames)
+			{
+				if (frame.end <= now)
+					completed = frame.fence;
+			}
+			return completed;
+		}
+
+		void WaitForFence(unsigned long long value) override
+		{
+			fenceWaits++;
+			for (const GpuFrame& frame : frames)
+			{
+				if (frame.fence >= value)
+				{
+					now = frame.end > now ? frame.end : now;
+					return;
+				}
+			}
+		}
+
+		void WaitForPresentQueue() override { presentWaits++; }
+
+		void EndGpuFrame(unsigned int slot) override { endedSlot = (int)slot; }
+
+		bool GetGpuTimes(unsigned int slot, double& start, double& end) override
+		{
+			if (slotFrames[slot].end > now)
+				earlyTimeQueries++;
+			start = slotFrames[slot].start;
+			end = slotFrames[slot].end;
+			return timed;
+		}
+
+		// Lets the GPU finish everything, as a flush would
+		void Drain() { now = gpuFree > now ? gpuFree : now; }
+	};
+
+	// Runs frames that take cpuTime to record, then are submitted and presented
+	void RunFrames(FramePacer& pacer, FakeFramePacingDevice& device, int count, double cpuTime,
+		unsigned long long& mostInFlight)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			// Frames still on the GPU while this one records
+			unsigned long long inFlight = pacer.GetFrameFence() - 1 - device.GetCompletedFence();
+			mostInFlight = inFlight > mostInFlight ? inFlight : mostInFlight;
+
+			device.now += cpuTime;
+			pacer.FrameSubmitted();
+			pacer.FramePresented();
+		}
+	}
+}
+
+// Counts are clamped, slots take turns and every frame gets the next fence value
+TEST(FramePacer, SlotsAndFences)
+{
+	FakeFramePacingDevice device;
+	CHECK_EQUAL(FramePacer::MinFramesInFlight, FramePacer(&device, 1).GetFramesInFlight());
+	CHECK_EQUAL(FramePacer::MaxFramesInFlight, FramePacer(&device, 9).GetFramesInFlight());
+
+	FramePacer pacer(&device, 3);
+	CHECK_EQUAL(0u, pacer.GetFrameSlot());
+	CHECK_EQUAL(1u, pacer.GetFrameFence());
+	for (unsigned int frame = 1; frame <= 10; frame++)
+	{
+		CHECK_EQUAL((frame - 1) % 3, pacer.GetFrameSlot());
+		CHECK_EQUAL(frame, pacer.GetFrameFence());
+		device.now += 0.001;
+		pacer.FramePresented();
+		CHECK_EQUAL(frame, device.signalled);
+	}
+	CHECK_EQUAL(10u, device.presentWaits);
+}
+
+// A slow GPU holds the CPU back to framesInFlight - 1 frames ahead, and the frame rate to its own
+TEST(FramePacer, GpuBoundKeepsLimit)
+{
+	for (unsigned int count = FramePacer::MinFramesInFlight; count <= FramePacer::MaxFramesInFlight; count++)
+	{
+		FakeFramePacingDevice device;
+		FramePacer pacer(&device, count);
+		unsigned long long mostInFlight = 0;
+		RunFrames(pacer, device, 200, 0.001, mostInFlight);
+
+		CHECK_EQUAL(count - 1, mostInFlight);
+		CHECK(device.fenceWaits > 0);
+		CHECK_EQUAL(0u, device.earlyTimeQueries);
+
+		FramePacingStats stats = pacer.GetStats();
+		CHECK_EQUAL(FramePacer::TimelineLength, stats.frames);
+		CHECK_NEAR(10.0, stats.frameTime, 0.001);
+		CHECK_NEAR(10.0, stats.gpuTime, 0.001);
+		CHECK_NEAR(1.0, stats.cpuTime, 0.001);
+		CHECK_NEAR(9.0, stats.wait, 0.001);
+
+		// Each frame waits behind the ones queued ahead of it
+		CHECK_NEAR(count * 10.0, stats.latency, 0.001);
+	}
+}
+
+// A fast GPU never makes the CPU wait, and finishes each frame before the next
+TEST(FramePacer, CpuBoundNeverWaits)
+{
+	FakeFramePacingDevice device;
+	device.gpuFrameTime = 0.002;
+	FramePacer pacer(&device, 3);
+	unsigned long long mostInFlight = 0;
+	RunFrames(pacer, device, 50, 0.005, mostInFlight);
+
+	CHECK_EQUAL(1u, mostInFlight);
+	CHECK_EQUAL(0u, device.fenceWaits);
+
+	FramePacingStats stats = pacer.GetStats();
+	CHECK_NEAR(5.0, stats.frameTime, 0.001);
+	CHECK_NEAR(0.0, stats.wait, 0.001);
+	CHECK_NEAR(0.0, stats.queueTime, 0.001);
+}
+
+// The timeline holds the latest frames the GPU finished, in order, each once
+TEST(FramePacer, TimelineInOrder)
+{
+	FakeFramePacingDevice device;
+	FramePacer pacer(&device, 4);
+	unsigned long long mostInFlight = 0;
+	RunFrames(pacer, device, 300, 0.003, mostInFlight);
+
+	std::vector<FrameTiming> timeline = pacer.GetTimeline();
+	CHECK_EQUAL(FramePacer::TimelineLength, timeline.size());
+
+	unsigned long long completed = device.GetCompletedFence();
+	CHECK_EQUAL(completed, timeline.back().frame);
+
+	size_t outOfOrder = 0;
+	size_t badTimes = 0;
+	for (size_t i = 0; i < timeline.size(); i++)
+	{
+		const FrameTiming& frame = timeline[i];
+		if (i > 0 && frame.frame != timeline[i - 1].frame + 1)
+			outOfOrder++;
+
+		const FakeFramePacingDevice::GpuFrame& gpu = device.frames[frame.frame - 1];
+		if (!frame.gpuTimed || frame.gpuStart != gpu.start || frame.gpuEnd != gpu.end ||
+			frame.submit < frame.begin || frame.present < frame.submit || frame.gpuStart < frame.present)
+			badTimes++;
+	}
+	CHECK_EQUAL(0u, outOfOrder);
+	CHECK_EQUAL(0u, badTimes);
+}
+
+// Going down a count mid-run collects the dropped slots and keeps the new limit straight away
+TEST(FramePacer, ChangesFramesInFlight)
+{
+	FakeFramePacingDevice device;
+	FramePacer pacer(&device, 4);
+	unsigned long long mostInFlight = 0;
+	RunFrames(pacer, device, 10, 0.001, mostInFlight);
+	CHECK_EQUAL(3u, mostInFlight);
+
+	device.Drain();
+	pacer.SetFramesInFlight(2);
+	CHECK_EQUAL(2u, pacer.GetFramesInFlight());
+	CHECK_EQUAL(device.GetCompletedFence(), pacer.GetTimeline().back().frame);
+
+	mostInFlight = 0;
+	RunFrames(pacer, device, 20, 0.001, mostInFlight);
+	CHECK_EQUAL(1u, mostInFlight);
+	CHECK_EQUAL(0u, device.earlyTimeQueries);
+
+	// Back up again, with no frame lost or repeated along the way
+	device.Drain();
+	pacer.SetFramesInFlight(3);
+	mostInFlight = 0;
+	RunFrames(pacer, device, 20, 0.001, mostInFlight);
+	CHECK_EQUAL(2u, mostInFlight);
+
+	std::vector<FrameTiming> timeline = pacer.GetTimeline();
+	size_t outOfOrder = 0;
+	for (size_t i = 1; i < timeline.size(); i++)
+	{
+		if (timeline[i].frame != timeline[i - 1].frame + 1)
+			outOfOrder++;
+	}
+	CHECK_EQUAL(1u, timeline.front().frame);
+	CHECK_EQUAL(0u, outOfOrder);
+}
+
+// Without GPU times, only the CPU side is averaged
+TEST(FramePacer, UntimedGpu)
+{
+	FakeFramePacingDevice device;
+	device.timed = false;
+	FramePacer pacer(&device, 2);
+	unsigned long long mostInFlight = 0;
+	RunFrames(pacer, device, 20, 0.001, mostInFlight);
+
+	FramePacingStats stats = pacer.GetStats();
+	CHECK(stats.frames > 0);
+	CHECK_NEAR(0.0, stats.gpuTime, 0.0);
+	CHECK_NEAR(0.0, stats.latency, 0.0);
+	CHECK_NEAR(1.0, stats.cpuTime, 0.001);
+}
@@ -0,0 +1,147 @@
+#include "TestFramework.h"
+#include "FrameStats.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	FrameSample Sample(unsigned long long frame, double frameTime, double gpuTime = -1)
+	{
+		FrameSample sample;
+		sample.frame = frame;
+		sample.frameTime = frameTime;
+		sample.cpuTime = frameTime / 2;
+		sample.gpuTime = gpuTime;
+		return sample;
+	}
+}
+
+// Percentiles are the nearest rank, so always one of the values, whatever order they come in
+TEST(FrameStats, NearestRankPercentiles)
+{
+	std::vector<double> values;
+	for (int i = 1000; i >= 1; i--)
+		values.push_back(i);
+
+	FramePercentiles p = FrameStats::ComputePercentiles(values);
+	CHECK_EQUAL(1000u, p.count);
+	CHECK_NEAR(500.5, p.mean, 0.000001);
+	CHECK_NEAR(500.0, p.p50, 0.0);
+	CHECK_NEAR(900.0, p.p90, 0.0);
+	CHECK_NEAR(990.0, p.p99, 0.0);
+	CHECK_NEAR(999.0, p.p999, 0.0);
+	CHECK_NEAR(1000.0, p.max, 0.0);
+
+	// With few values the high percentiles are the slowest one, not an interpolation
+	std::vector<double> few = { 16.0, 50.0, 17.0, 15.0 };
+	p = FrameStats::ComputePercentiles(few);
+	CHECK_NEAR(16.0, p.p50, 0.0);
+	CHECK_NEAR(50.0, p.p90, 0.0);
+	CHECK_NEAR(50.0, p.p999, 0.0);
+	CHECK_NEAR(24.5, p.mean, 0.000001);
+
+	std::vector<double> one = { 7.0 };
+	p = FrameStats::ComputePercentiles(one);
+	CHECK(p.count == 1 && p.p50 == 7.0 && p.p999 == 7.0 && p.max == 7.0);
+
+	std::vector<double> none;
+	p = FrameStats::ComputePercentiles(none);
+	CHECK(p.count == 0 && p.max == 0.0);
+}
+
+// Only frames over the threshold are hitches, in the summary and overall
+TEST(FrameStats, CountsHitches)
+{
+	FrameStats stats(50.0);
+	for (unsigned long long frame = 1; frame <= 100; frame++)
+		stats.AddFrame(Sample(frame, frame % 10 == 0 ? 60.0 : 16.0));
+	stats.AddFrame(Sample(101, 50.0));
+
+	CHECK_EQUAL(10u, stats.GetTotalHitches());
+	CHECK_EQUAL(101u, stats.GetTotalFrames());
+	FrameStatsSummary summary = stats.GetSummary();
+	CHECK_EQUAL(101u, summary.frames);
+	CHECK_EQUAL(10u, summary.hitches);
+	CHECK_NEAR(60.0, summary.frameTime.max, 0.0);
+	CHECK_NEAR(16.0, summary.frameTime.p50, 0.0);
+	CHECK_NEAR(50.0, summary.frameTime.p90, 0.0);
+	CHECK_NEAR(60.0, summary.frameTime.p99, 0.0);
+
+	// A new threshold applies to summaries, not to what was already counted
+	stats.SetHitchThreshold(10.0);
+	CHECK_EQUAL(101u, stats.GetSummary().hitches);
+	CHECK_EQUAL(10u, stats.GetTotalHitches());
+}
+
+// A window covers just the latest frames adding up to it
+TEST(FrameStats, SummarizesWindow)
+{
+	FrameStats stats;
+	for (unsigned long long frame = 1; frame <= 100; frame++)
+		stats.AddFrame(Sample(frame, 100.0, frame <= 95 ? -1 : 4.0));
+	for (unsigned long long frame = 101; frame <= 200; frame++)
+		stats.AddFrame(Sample(frame, 10.0, frame % 2 == 0 ? 8.0 : -1));
+
+	FrameStatsSummary summary = stats.GetSummary(0.5);
+	CHECK_EQUAL(50u, summary.frames);
+	CHECK_NEAR(0.5, summary.seconds, 0.000001);
+	CHECK_NEAR(10.0, summary.frameTime.max, 0.0);
+	CHECK_NEAR(5.0, summary.cpuTime.mean, 0.000001);
+	CHECK_EQUAL(25u, summary.gpuTime.count);
+	CHECK_EQUAL(0u, summary.hitches);
+
+	// Longer than everything kept, or 0, covers every frame
+	CHECK_EQUAL(200u, stats.GetSummary(1000.0).frames);
+	CHECK_EQUAL(200u, stats.GetSummary().frames);
+	CHECK_EQUAL(55u, stats.GetSummary().gpuTime.count);
+	CHECK_EQUAL(100u, stats.GetSummary().hitches);
+
+	FrameStats empty;
+	CHECK_EQUAL(0u, empty.GetSummary(5.0).frames);
+}
+
+// Past capacity the oldest frames make way, and totals keep counting
+TEST(FrameStats, KeepsLatestFrames)
+{
+	FrameStats stats;
+	for (unsigned long long frame = 1; frame <= FrameStats::Capacity + 10; frame++)
+		stats.AddFrame(Sample(frame, frame <= 10 ? 100.0 : 5.0));
+
+	FrameStatsSummary summary = stats.GetSummary();
+	CHECK_EQUAL(FrameStats::Capacity, summary.frames);
+	CHECK_EQUAL(0u, summary.hitches);
+	CHECK_NEAR(5.0, summary.frameTime.max, 0.0);
+	CHECK_EQUAL(10u, stats.GetTotalHitches());
+	CHECK_EQUAL(FrameStats::Capacity + 10u, stats.GetTotalFrames());
+}
+
+// A capture writes a row per frame added while it runs, leaving the GPU column empty when untimed
+TEST(FrameStats, CapturesCsv)
+{
+	std::ostringstream row;
+	FrameStats::WriteCsvRow(row, Sample(3, 16.5, 4.25), false);
+	FrameStats::WriteCsvRow(row, Sample(4, 70.0), true);
+	CHECK(row.str() == "3,16.5000,8.2500,4.2500,0\n4,70.0000,35.0000,,1\n");
+
+	std::filesystem::path file = TestFramework::TempPath("FrameStatsTest.csv");
+	FrameStats stats;
+	stats.AddFrame(Sample(1, 16.0));
+	CHECK(stats.StartCapture(file));
+	CHECK(stats.IsCapturing());
+	stats.AddFrame(Sample(2, 16.0, 3.0));
+	stats.AddFrame(Sample(3, 80.0));
+	stats.StopCapture();
+	stats.AddFrame(Sample(4, 16.0));
+	CHECK(!stats.IsCapturing());
+
+	std::ifstream in(file);
+	std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	CHECK(text == "frame,frame_ms,cpu_ms,gpu_ms,hitch\n2,16.0000,8.0000,3.0000,0\n3,80.0000,40.0000,,1\n");
+	in.close();
+	std::filesystem::remove(file);
+}
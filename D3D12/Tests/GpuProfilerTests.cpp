@@ -0,0 +1,295 @@
+#include "TestFramework.h"
+#include "GpuProfiler.h"
+
+#include <sstream>
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// What got written into one command list, in order
+	struct FakeCommandList
+	{
+		std::vector<unsigned int> timestamps;
+		unsigned int resolved = 0;
+	};
+
+	// --------------------------------------------------------
+	// A GPU whose timestamps are taken straight away, each a
+	// millisecond after the last, with a CPU clock the test
+	// moves by hand
+	// --------------------------------------------------------
+	class FakeGpuProfilerDevice : public GpuProfilerDevice
+	{
+	public:
+
+		double now = 0;
+		double gpuClock = 100.0;
+		bool timed = true;
+		size_t reads = 0;
+		size_t unresolvedReads = 0;
+		std::vector<double> stamps[GpuProfiler::MaxSlots];
+		unsigned int resolved[GpuProfiler::MaxSlots] = {};
+
+		double GetTime() override { return now; }
+
+		void WriteTimestamp(void* commandList, unsigned int slot, unsigned int index) override
+		{
+			((FakeCommandList*)commandList)->timestamps.push_back(index);
+			if (stamps[slot].size() <= index)
+				stamps[slot].resize(index + 1);
+			stamps[slot][index] = gpuClock;
+			gpuClock += 0.001;
+		}
+
+		void ResolveTimestamps(void* commandList, unsigned int slot, unsigned int count) override
+		{
+			((FakeCommandList*)commandList)->resolved = count;
+			resolved[slot] = count;
+		}
+
+		bool ReadTimestamps(unsigned int slot, unsigned int count, double* times) override
+		{
+			reads++;
+			if (resolved[slot] < count || stamps[slot].size() < count)
+			{
+				unresolvedReads++;
+				return false;
+			}
+			for (unsigned int i = 0; i < count; i++)
+				times[i] = stamps[slot][i];
+			return timed;
+		}
+	};
+
+	// A frame with one CPU scope around one GPU scope
+	void RecordFrame(GpuProfiler& profiler, FakeGpuProfilerDevice& device, unsigned long long fence, unsigned int slot)
+	{
+		FakeCommandList list;
+		profiler.BeginFrame(fence, slot, &list);
+		profiler.BeginCpuScope("Draw");
+		profiler.BeginGpuScope("Draw", &list);
+		device.now += 0.002;
+		profiler.EndGpuScope(&list);
+		profiler.EndCpuScope();
+		profiler.EndFrame(&list);
+	}
+
+	size_t Count(const std::string& text, const std::string& part)
+	{
+		size_t count = 0;
+		for (size_t at = text.find(part); at != std::string::npos; at = text.find(part, at + 1))
+			count++;
+		return count;
+	}
+}
+
+// Scopes nest under the frame on both trees, with CPU and GPU times in the right places
+TEST(GpuProfiler, BuildsScopeTrees)
+{
+	FakeGpuProfilerDevice device;
+	GpuProfiler profiler(&device);
+	FakeCommandList list;
+
+	device.now = 1.0;
+	profiler.BeginFrame(7, 1, &list);
+	profiler.BeginCpuScope("Update");
+	device.now = 1.5;
+	profiler.EndCpuScope();
+	profiler.BeginCpuScope("Render");
+	profiler.BeginGpuScope("Shadows", &list);
+	profiler.EndGpuScope(&list);
+	profiler.BeginGpuScope("Opaque", &list);
+	profiler.BeginGpuScope("Terrain", &list);
+	profiler.EndGpuScope(&list);
+	profiler.EndGpuScope(&list);
+	device.now = 2.0;
+	profiler.EndCpuScope();
+	profiler.EndFrame(&list);
+
+	// Frame begin, then each scope's begin and end, then frame end
+	const unsigned int expectedWrites[] = { 0, 2, 3, 4, 6, 7, 5, 1 };
+	CHECK_EQUAL(8u, list.timestamps.size());
+	for (unsigned int i = 0; i < 8 && i < list.timestamps.size(); i++)
+		CHECK_EQUAL(expectedWrites[i], list.timestamps[i]);
+	CHECK_EQUAL(8u, list.resolved);
+
+	// Nothing is read until the GPU is past the frame
+	profiler.Collect(6);
+	CHECK_EQUAL(0u, profiler.GetHistory().size());
+	CHECK_EQUAL(0u, device.reads);
+	profiler.Collect(7);
+	std::vector<ProfileFrame> history = profiler.GetHistory();
+	CHECK_EQUAL(1u, history.size());
+	if (history.size() != 1)
+		return;
+
+	const ProfileFrame& frame = history[0];
+	CHECK_EQUAL(7u, frame.frame);
+	CHECK(frame.gpuTimed);
+	CHECK_EQUAL(3u, frame.cpuScopes.size());
+	CHECK_EQUAL(4u, frame.gpuScopes.size());
+	if (frame.cpuScopes.size() != 3 || frame.gpuScopes.size() != 4)
+		return;
+
+	CHECK(frame.cpuScopes[0].name == "Frame");
+	CHECK_EQUAL(-1, frame.cpuScopes[0].parent);
+	CHECK_NEAR(1.0, frame.cpuScopes[0].start, 0.0);
+	CHECK_NEAR(2.0, frame.cpuScopes[0].end, 0.0);
+	CHECK(frame.cpuScopes[1].name == "Update");
+	CHECK_EQUAL(0, frame.cpuScopes[1].parent);
+	CHECK_EQUAL(1u, frame.cpuScopes[1].depth);
+	CHECK_NEAR(0.5, frame.cpuScopes[1].end - frame.cpuScopes[1].start, 0.0);
+	CHECK(frame.cpuScopes[2].name == "Render");
+
+	CHECK(frame.gpuScopes[3].name == "Terrain");
+	CHECK_EQUAL(2, frame.gpuScopes[3].parent);
+	CHECK_EQUAL(2u, frame.gpuScopes[3].depth);
+	CHECK_NEAR(100.0, frame.gpuScopes[0].start, 0.0000001);
+	CHECK_NEAR(0.007, frame.gpuScopes[0].end - frame.gpuScopes[0].start, 0.0000001);
+	CHECK_NEAR(0.001, frame.gpuScopes[3].end - frame.gpuScopes[3].start, 0.0000001);
+	CHECK_EQUAL(0u, device.unresolvedReads);
+}
+
+// A GPU scope can begin in one command list and end in a later one, and open scopes close at the end
+TEST(GpuProfiler, ScopesSpanCommandLists)
+{
+	FakeGpuProfilerDevice device;
+	GpuProfiler profiler(&device);
+	FakeCommandList first, second;
+
+	profiler.BeginFrame(1, 0, &first);
+	profiler.BeginCpuScope("Left open");
+	profiler.BeginGpuScope("Post", &first);
+	profiler.EndGpuScope(&second);
+	profiler.BeginGpuScope("Left open", &second);
+	profiler.EndFrame(&second);
+
+	CHECK_EQUAL(2u, first.timestamps.size());
+	CHECK_EQUAL(4u, second.timestamps.size());
+	CHECK_EQUAL(0u, first.resolved);
+	CHECK_EQUAL(6u, second.resolved);
+
+	profiler.Collect(1);
+	std::vector<ProfileFrame> history = profiler.GetHistory();
+	CHECK(history.size() == 1 && history[0].gpuScopes.size() == 3 && history[0].cpuScopes.size() == 2);
+	if (history.size() == 1 && history[0].cpuScopes.size() == 2)
+		CHECK(history[0].cpuScopes[1].end >= history[0].cpuScopes[1].start);
+
+	// Scopes outside a frame are ignored
+	profiler.BeginCpuScope("Between frames");
+	profiler.BeginGpuScope("Between frames", &first);
+	profiler.EndGpuScope(&first);
+	CHECK_EQUAL(2u, first.timestamps.size());
+}
+
+// Past the limit, scopes still nest but go untimed, and only the timed ones are resolved
+TEST(GpuProfiler, DropsScopesPastLimit)
+{
+	FakeGpuProfilerDevice device;
+	GpuProfiler profiler(&device);
+	FakeCommandList list;
+
+	profiler.BeginFrame(1, 0, &list);
+	for (unsigned int i = 0; i < GpuProfiler::MaxGpuScopes + 5; i++)
+	{
+		profiler.BeginGpuScope("Pass", &list);
+		profiler.EndGpuScope(&list);
+	}
+	profiler.EndFrame(&list);
+	CHECK_EQUAL(6u, profiler.GetDroppedScopes());
+	CHECK_EQUAL(GpuProfiler::MaxGpuScopes * 2, list.resolved);
+
+	profiler.Collect(1);
+	std::vector<ProfileFrame> history = profiler.GetHistory();
+	CHECK(history.size() == 1 && history[0].gpuScopes.size() == GpuProfiler::MaxGpuScopes);
+	CHECK_EQUAL(0u, device.unresolvedReads);
+}
+
+// Frames from several slots are collected in frame order, and the history keeps the latest
+TEST(GpuProfiler, HistoryInFrameOrder)
+{
+	FakeGpuProfilerDevice device;
+	GpuProfiler profiler(&device);
+
+	// Three slots, collected two frames behind
+	for (unsigned long long fence = 1; fence <= 200; fence++)
+	{
+		RecordFrame(profiler, device, fence, (unsigned int)(fence - 1) % 3);
+		if (fence > 2)
+			profiler.Collect(fence - 2);
+	}
+	profiler.Collect(200);
+
+	std::vector<ProfileFrame> history = profiler.GetHistory();
+	CHECK_EQUAL(GpuProfiler::HistoryLength, history.size());
+	CHECK_EQUAL(200u, history.back().frame);
+	size_t outOfOrder = 0;
+	for (size_t i = 1; i < history.size(); i++)
+	{
+		if (history[i].frame != history[i - 1].frame + 1)
+			outOfOrder++;
+	}
+	CHECK_EQUAL(0u, outOfOrder);
+
+	// A slot reused before it was collected loses its frame rather than mixing timestamps
+	GpuProfiler skipped(&device);
+	RecordFrame(skipped, device, 1, 0);
+	RecordFrame(skipped, device, 2, 0);
+	skipped.Collect(2);
+	history = skipped.GetHistory();
+	CHECK(history.size() == 1 && history[0].frame == 2);
+}
+
+// Without GPU times, frames keep their CPU scopes only
+TEST(GpuProfiler, UntimedGpu)
+{
+	FakeGpuProfilerDevice device;
+	device.timed = false;
+	GpuProfiler profiler(&device);
+	RecordFrame(profiler, device, 1, 0);
+	profiler.Collect(1);
+
+	std::vector<ProfileFrame> history = profiler.GetHistory();
+	CHECK(history.size() == 1 && !history[0].gpuTimed);
+
+	std::ostringstream json;
+	GpuProfiler::WriteChromeTrace(json, history);
+	CHECK_EQUAL(2u, Count(json.str(), "\"ph\":\"X\""));
+	CHECK_EQUAL(0u, Count(json.str(), "\"cat\":\"GPU\""));
+}
+
+// The trace has one complete event per scope, in microseconds from the first frame, with names escaped
+TEST(GpuProfiler, WritesChromeTrace)
+{
+	FakeGpuProfilerDevice device;
+	GpuProfiler profiler(&device);
+	FakeCommandList list;
+
+	device.now = 3.0;
+	profiler.BeginFrame(5, 0, &list);
+	profiler.BeginCpuScope("Say \"hi\"\\\n");
+	device.now = 3.25;
+	profiler.EndCpuScope();
+	profiler.EndFrame(&list);
+	profiler.Collect(5);
+
+	std::ostringstream json;
+	GpuProfiler::WriteChromeTrace(json, profiler.GetHistory());
+	std::string text = json.str();
+
+	CHECK(text.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 0) == 0);
+	CHECK(text.size() > 3 && text.compare(text.size() - 3, 3, "]}\n") == 0);
+	CHECK_EQUAL(3u, Count(text, "\"ph\":\"X\""));
+	CHECK_EQUAL(2u, Count(text, "\"cat\":\"CPU\",\"ph\":\"X\",\"ts\":0.000,"));
+	CHECK_EQUAL(1u, Count(text, "\"cat\":\"GPU\""));
+	CHECK_EQUAL(1u, Count(text, "\"name\":\"Say \\\"hi\\\"\\\\\\u000a\""));
+	CHECK_EQUAL(2u, Count(text, "\"dur\":250000.000"));
+	CHECK_EQUAL(3u, Count(text, "\"args\":{\"frame\":5}"));
+
+	// An empty trace is still valid
+	std::ostringstream empty;
+	GpuProfiler::WriteChromeTrace(empty, std::vector<ProfileFrame>());
+	CHECK_EQUAL(0u, Count(empty.str(), "\"ph\":\"X\""));
+	CHECK_EQUAL(1u, Count(empty.str(), "]}"));
+}
@@ -0,0 +1,141 @@
+#include "TestFramework.h"
+#include "LodSelector.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	const float ViewportHeight = 1000.0f;
+
+	// Errors relative to a mesh of radius 1, as Mesh builds them
+	const MeshLod Lods[] =
+	{
+		{ 0, 3000, 0.0f },
+		{ 3000, 1500, 0.01f },
+		{ 4500, 750, 0.02f },
+		{ 5250, 375, 0.04f },
+	};
+	const size_t LodCount = sizeof(Lods) / sizeof(Lods[0]);
+
+	XMFLOAT4X4 Identity()
+	{
+		XMFLOAT4X4 m;
+		memset(&m, 0, sizeof(m));
+		m._11 = m._22 = m._33 = m._44 = 1.0f;
+		return m;
+	}
+
+	// A camera at the given z looking down +z, as the game's row-vector view matrix
+	XMFLOAT4X4 ViewFrom(float z)
+	{
+		XMFLOAT4X4 view = Identity();
+		view._43 = -z;
+		return view;
+	}
+
+	// Left-handed perspective, like XMMatrixPerspectiveFovLH
+	XMFLOAT4X4 Perspective(float fovY)
+	{
+		float yScale = 1.0f / std::tan(fovY * 0.5f);
+		float nearZ = 0.01f, farZ = 1000.0f;
+		XMFLOAT4X4 m;
+		memset(&m, 0, sizeof(m));
+		m._11 = yScale;
+		m._22 = yScale;
+		m._33 = farZ / (farZ - nearZ);
+		m._34 = 1.0f;
+		m._43 = -nearZ * farZ / (farZ - nearZ);
+		return m;
+	}
+
+	// Left-handed orthographic showing the given height, like XMMatrixOrthographicLH
+	XMFLOAT4X4 Orthographic(float height)
+	{
+		XMFLOAT4X4 m = Identity();
+		m._11 = 2.0f / height;
+		m._22 = 2.0f / height;
+		m._33 = 1.0f / 1000.0f;
+		return m;
+	}
+
+	unsigned int Select(XMFLOAT3 center, float radius, const XMFLOAT4X4& view, const XMFLOAT4X4& projection)
+	{
+		float screenRadius = LodSelector::ScreenRadius(center, radius, view, projection, ViewportHeight);
+		return LodSelector::Select(Lods, LodCount, 1.0f, screenRadius);
+	}
+}
+
+// A perspective sphere's radius shrinks with its tangent distance, wherever the camera is
+TEST(LodSelector, PerspectiveScreenRadius)
+{
+	XMFLOAT4X4 projection = Perspective(1.5707963f);
+	float r = LodSelector::ScreenRadius(XMFLOAT3(0, 0, 10), 1.0f, Identity(), projection, ViewportHeight);
+	CHECK_NEAR(500.0 / std::sqrt(99.0), r, 0.01);
+
+	// The same sphere seen from a moved camera, and twice as far away
+	CHECK_NEAR(r, LodSelector::ScreenRadius(XMFLOAT3(0, 0, 0), 1.0f, ViewFrom(-10.0f), projection, ViewportHeight), 0.01);
+	CHECK_NEAR(500.0 / std::sqrt(399.0), LodSelector::ScreenRadius(XMFLOAT3(0, 0, 20), 1.0f, Identity(), projection, ViewportHeight), 0.01);
+
+	// A narrower field of view magnifies it
+	CHECK(LodSelector::ScreenRadius(XMFLOAT3(0, 0, 10), 1.0f, Identity(), Perspective(0.5f), ViewportHeight) > r * 2.0f);
+
+	// From inside, the sphere covers everything
+	CHECK(LodSelector::ScreenRadius(XMFLOAT3(0, 0, 0.5f), 1.0f, Identity(), projection, ViewportHeight) == FLT_MAX);
+}
+
+// Far away or small spheres get coarser levels, close or big ones finer ones
+TEST(LodSelector, PerspectiveSelection)
+{
+	XMFLOAT4X4 projection = Perspective(1.5707963f);
+	XMFLOAT4X4 view = Identity();
+
+	// At 500 pixels per unit of radius over distance, a 1 pixel budget needs the
+	// error (in units of the mesh's radius) under distance / 500
+	CHECK_EQUAL(0u, Select(XMFLOAT3(0, 0, 4), 1.0f, view, projection));
+	CHECK_EQUAL(1u, Select(XMFLOAT3(0, 0, 7), 1.0f, view, projection));
+	CHECK_EQUAL(2u, Select(XMFLOAT3(0, 0, 15), 1.0f, view, projection));
+	CHECK_EQUAL(3u, Select(XMFLOAT3(0, 0, 30), 1.0f, view, projection));
+	CHECK_EQUAL(0u, Select(XMFLOAT3(0, 0, 0), 1.0f, view, projection));
+
+	// Scaling the entity up is the same as bringing it closer
+	CHECK_EQUAL(3u, Select(XMFLOAT3(0, 0, 30), 0.5f, view, projection));
+	CHECK_EQUAL(2u, Select(XMFLOAT3(0, 0, 30), 2.0f, view, projection));
+	CHECK_EQUAL(0u, Select(XMFLOAT3(0, 0, 30), 8.0f, view, projection));
+
+	// A looser pixel budget allows coarser levels
+	float screenRadius = LodSelector::ScreenRadius(XMFLOAT3(0, 0, 7), 1.0f, view, projection, ViewportHeight);
+	CHECK_EQUAL(3u, LodSelector::Select(Lods, LodCount, 1.0f, screenRadius, 4.0f));
+}
+
+// Orthographic cameras pick by how much of the view a sphere fills, whatever its distance
+TEST(LodSelector, OrthographicSelection)
+{
+	CHECK_NEAR(50.0, LodSelector::ScreenRadius(XMFLOAT3(0, 0, 10), 1.0f, Identity(), Orthographic(20.0f), ViewportHeight), 0.001);
+	CHECK_NEAR(50.0, LodSelector::ScreenRadius(XMFLOAT3(0, 0, 900), 1.0f, Identity(), Orthographic(20.0f), ViewportHeight), 0.001);
+
+	for (float z = 5.0f; z < 500.0f; z *= 3.0f)
+	{
+		CHECK_EQUAL(0u, Select(XMFLOAT3(0, 0, z), 1.0f, Identity(), Orthographic(5.0f)));
+		CHECK_EQUAL(1u, Select(XMFLOAT3(0, 0, z), 1.0f, Identity(), Orthographic(15.0f)));
+		CHECK_EQUAL(2u, Select(XMFLOAT3(0, 0, z), 1.0f, Identity(), Orthographic(30.0f)));
+		CHECK_EQUAL(3u, Select(XMFLOAT3(0, 0, z), 1.0f, Identity(), Orthographic(100.0f)));
+	}
+
+	// A bigger sphere in the same view needs a finer level
+	CHECK_EQUAL(1u, Select(XMFLOAT3(0, 0, 10), 2.0f, Identity(), Orthographic(30.0f)));
+}
+
+// Without levels, or a radius to measure against, it's always the full mesh
+TEST(LodSelector, FallsBackToFullMesh)
+{
+	CHECK_EQUAL(0u, LodSelector::Select(Lods, 0, 1.0f, 1.0f));
+	CHECK_EQUAL(0u, LodSelector::Select(Lods, LodCount, 0.0f, 1.0f));
+	CHECK_EQUAL(0u, LodSelector::Select(Lods, 1, 1.0f, 0.001f));
+	CHECK_EQUAL(LodCount - 1, LodSelector::Select(Lods, LodCount, 1.0f, 0.0f));
+}
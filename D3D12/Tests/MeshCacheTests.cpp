@@ -0,0 +1,137 @@
+#include "TestFramework.h"
+#include "MeshCache.h"
+#include "VertexPacking.h"
+
+#include <filesystem>
+#include <string>
+
+using namespace DirectX;
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	const char Source[] = "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nf 1 2 3\nf 3 4 1\n";
+
+	// A quad with one LOD, one meshlet and one sub-mesh, ready to write
+	struct Quad
+	{
+		std::vector<PackedVertex> vertices;
+		PositionQuantization quantization{};
+		std::vector<unsigned int> indices = { 0, 2, 1, 2, 0, 3 };
+		MeshLod lod = { 0, 6, 0.0f };
+		MeshletData meshlets;
+		SubMesh subMesh = { 0, 6, 0, 1, 0, 1, 0 };
+		std::vector<std::string> materialNames = { "M_Quad" };
+		XMFLOAT3 boundsMin = XMFLOAT3(0, 0, 0);
+		XMFLOAT3 boundsMax = XMFLOAT3(1, 1, 0);
+
+		Quad()
+		{
+			quantization = VertexPacking::ComputeQuantization(boundsMin, boundsMax);
+			Vertex corners[4] = {};
+			corners[1].Position = XMFLOAT3(1, 0, 0);
+			corners[2].Position = XMFLOAT3(1, 1, 0);
+			corners[3].Position = XMFLOAT3(0, 1, 0);
+			for (Vertex& v : corners)
+				vertices.push_back(VertexPacking::Encode(v, quantization));
+
+			Meshlet meshlet = {};
+			meshlet.vertexCount = 4;
+			meshlet.triangleCount = 2;
+			meshlet.radius = 1.0f;
+			meshlets.meshlets.push_back(meshlet);
+			meshlets.vertices = { 0, 1, 2, 3 };
+			meshlets.triangles = { 0, 2, 1, 2, 0, 3 };
+		}
+
+		bool Write(const std::wstring& path, unsigned long long hash)
+		{
+			return MeshCache::Write(path.c_str(), hash, sizeof(Source), vertices.data(), (unsigned int)vertices.size(),
+				quantization, indices.data(), (unsigned int)indices.size(), &lod, 1, meshlets, &subMesh, 1,
+				materialNames, boundsMin, boundsMax, 1.0f);
+		}
+	};
+
+	unsigned long long Hash(float weldEpsilon, bool optimize, bool generateLods)
+	{
+		return MeshCache::HashSource(Source, sizeof(Source), weldEpsilon, optimize, generateLods);
+	}
+
+	bool Opens(const std::wstring& path, unsigned long long hash, unsigned long long size)
+	{
+		MappedFile cacheFile;
+		MeshCache::View view;
+		return MeshCache::Open(path.c_str(), hash, size, cacheFile, view);
+	}
+}
+
+// Editing the source or changing any processing setting misses the cache
+TEST(MeshCache, RejectsChangedSource)
+{
+	std::wstring path = TestFramework::TempPath("EngineTestsQuad.mesh");
+	unsigned long long hash = Hash(0.0f, true, true);
+	Quad quad;
+	CHECK(quad.Write(path, hash));
+	CHECK(Opens(path, hash, sizeof(Source)));
+
+	std::string edited = Source;
+	edited[2] = '2';
+	CHECK(!Opens(path, MeshCache::HashSource(edited.data(), sizeof(Source), 0.0f, true, true), sizeof(Source)));
+	CHECK(!Opens(path, hash, sizeof(Source) + 1));
+	CHECK(!Opens(path, Hash(0.001f, true, true), sizeof(Source)));
+	CHECK(!Opens(path, Hash(0.0f, false, true), sizeof(Source)));
+	CHECK(!Opens(path, Hash(0.0f, true, false), sizeof(Source)));
+	std::filesystem::remove(path);
+}
+
+// Indices that point past the vertices never reach the GPU
+TEST(MeshCache, RejectsOutOfRangeIndices)
+{
+	std::wstring path = TestFramework::TempPath("EngineTestsQuad.mesh");
+
+	Quad badIndex;
+	badIndex.indices[4] = 4;
+	CHECK(badIndex.Write(path, 1));
+	CHECK(!Opens(path, 1, sizeof(Source)));
+
+	Quad badMeshletVertex;
+	badMeshletVertex.meshlets.vertices[3] = 7;
+	CHECK(badMeshletVertex.Write(path, 1));
+	CHECK(!Opens(path, 1, sizeof(Source)));
+
+	Quad badMeshletTriangle;
+	badMeshletTriangle.meshlets.triangles[5] = 4;
+	CHECK(badMeshletTriangle.Write(path, 1));
+	CHECK(!Opens(path, 1, sizeof(Source)));
+
+	Quad good;
+	CHECK(good.Write(path, 1));
+	CHECK(Opens(path, 1, sizeof(Source)));
+	std::filesystem::remove(path);
+}
+
+// A new cache replaces the old one whole, without leaving its temporary file behind
+TEST(MeshCache, ReplacesAtomically)
+{
+	std::filesystem::path folder = TestFramework::TempPath("EngineTestsMeshCache");
+	std::filesystem::remove_all(folder);
+	std::filesystem::create_directories(folder);
+	std::wstring path = (folder / "Quad.mesh").wstring();
+
+	Quad quad;
+	CHECK(quad.Write(path, 1));
+	CHECK(quad.Write(path, 2));
+	CHECK(!Opens(path, 1, sizeof(Source)));
+	CHECK(Opens(path, 2, sizeof(Source)));
+
+	size_t files = 0;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(folder))
+		files += entry.path().filename() == "Quad.mesh" ? 1 : 100;
+	CHECK_EQUAL(1u, files);
+
+	// A cache that can't be written leaves nothing behind either
+	std::wstring missing = (folder / "Missing" / "Quad.mesh").wstring();
+	CHECK(!quad.Write(missing, 1));
+	std::filesystem::remove_all(folder);
+}
@@ -0,0 +1,122 @@
+#include "TestFramework.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <random>
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	typedef std::array<float, 9> Triangle;
+
+	// A flat size x size grid of quads, with its triangles in a random order
+	void ShuffledGrid(unsigned int size, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+	{
+		verts.assign((size_t)(size + 1) * (size + 1), Vertex());
+		for (unsigned int y = 0; y <= size; y++)
+		{
+			for (unsigned int x = 0; x <= size; x++)
+			{
+				Vertex& v = verts[(size_t)y * (size + 1) + x];
+				v.Position = DirectX::XMFLOAT3((float)x, (float)y, 0.0f);
+				v.Normal = DirectX::XMFLOAT3(0.0f, 0.0f, -1.0f);
+			}
+		}
+
+		std::vector<unsigned int> quads((size_t)size * size);
+		for (unsigned int q = 0; q < quads.size(); q++)
+			quads[q] = q;
+		std::shuffle(quads.begin(), quads.end(), std::mt19937(1234));
+
+		indices.clear();
+		for (unsigned int q : quads)
+		{
+			unsigned int corner = (q / size) * (size + 1) + q % size;
+			unsigned int quad[6] = { corner, corner + size + 1, corner + 1, corner + 1, corner + size + 1, corner + size + 2 };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+
+	// The triangles by their corners' positions, each rotated to start at its
+	// smallest corner (which keeps the winding), in sorted order. Two index
+	// buffers draw the same thing if these match, whatever order they're in.
+	std::vector<Triangle> Triangles(const std::vector<Vertex>& verts, const unsigned int* indices, size_t indexCount)
+	{
+		std::vector<Triangle> triangles;
+		for (size_t i = 0; i + 2 < indexCount; i += 3)
+		{
+			std::array<DirectX::XMFLOAT3, 3> corners = { verts[indices[i]].Position, verts[indices[i + 1]].Position, verts[indices[i + 2]].Position };
+			auto less = [](const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b)
+				{
+					return a.x != b.x ? a.x < b.x : a.y != b.y ? a.y < b.y : a.z < b.z;
+				};
+			std::rotate(corners.begin(), std::min_element(corners.begin(), corners.end(), less), corners.end());
+
+			Triangle triangle;
+			for (int c = 0; c < 3; c++)
+			{
+				triangle[c * 3 + 0] = corners[c].x;
+				triangle[c * 3 + 1] = corners[c].y;
+				triangle[c * 3 + 2] = corners[c].z;
+			}
+			triangles.push_back(triangle);
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+}
+
+// Reordering for the vertex cache cuts the misses well below a shuffled grid's, and keeps every triangle
+TEST(MeshOptimizer, VertexCacheLowersAcmr)
+{
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	ShuffledGrid(32, verts, indices);
+	std::vector<unsigned int> original = indices;
+
+	VertexCacheStats before = MeshOptimizer::SimulateVertexCache(indices.data(), indices.size(), verts.size());
+	MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), verts.size());
+	VertexCacheStats after = MeshOptimizer::SimulateVertexCache(indices.data(), indices.size(), verts.size());
+
+	CHECK(after.acmr < before.acmr);
+	CHECK(after.acmr < 0.8f);
+	CHECK(after.atvr < before.atvr);
+	CHECK_EQUAL(original.size(), indices.size());
+	CHECK(Triangles(verts, indices.data(), indices.size()) == Triangles(verts, original.data(), original.size()));
+}
+
+// Every pass together still draws the same triangles, each sub-mesh keeping its own
+TEST(MeshOptimizer, OptimizeKeepsSubMeshTriangles)
+{
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	ShuffledGrid(16, verts, indices);
+
+	// An unused vertex, which the fetch pass drops
+	verts.push_back(Vertex());
+	verts.back().Position = DirectX::XMFLOAT3(-5.0f, -5.0f, 0.0f);
+
+	std::vector<SubMesh> subMeshes(2, SubMesh());
+	subMeshes[0].indexCount = (unsigned int)(indices.size() / 6) * 3;
+	subMeshes[1].indexOffset = subMeshes[0].indexCount;
+	subMeshes[1].indexCount = (unsigned int)indices.size() - subMeshes[0].indexCount;
+
+	std::vector<Vertex> originalVerts = verts;
+	std::vector<unsigned int> original = indices;
+	MeshOptimizer::Optimize(verts, indices, subMeshes);
+
+	CHECK_EQUAL(originalVerts.size() - 1, verts.size());
+	CHECK_EQUAL(original.size(), indices.size());
+	for (unsigned int index : indices)
+		CHECK(index < verts.size());
+
+	for (const SubMesh& subMesh : subMeshes)
+	{
+		CHECK(Triangles(verts, &indices[subMesh.indexOffset], subMesh.indexCount) ==
+			Triangles(originalVerts, &original[subMesh.indexOffset], subMesh.indexCount));
+	}
+	CHECK(MeshOptimizer::SimulateVertexCache(indices.data(), indices.size(), verts.size()).acmr <
+		MeshOptimizer::SimulateVertexCache(original.data(), original.size(), originalVerts.size()).acmr);
+}
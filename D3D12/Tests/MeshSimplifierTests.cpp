@@ -0,0 +1,156 @@
+#include "TestFramework.h"
+#include "MeshSimplifier.h"
+#include "ObjLoader.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// A flat size x size grid of quads at the given x offset, appended to the mesh
+	void AppendGrid(unsigned int size, float offset, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+	{
+		unsigned int first = (unsigned int)verts.size();
+		for (unsigned int y = 0; y <= size; y++)
+		{
+			for (unsigned int x = 0; x <= size; x++)
+			{
+				Vertex v = {};
+				v.Position = DirectX::XMFLOAT3(offset + (float)x / size, (float)y / size, 0.0f);
+				v.Normal = DirectX::XMFLOAT3(0.0f, 0.0f, -1.0f);
+				v.UV = DirectX::XMFLOAT2((float)x / size, (float)y / size);
+				verts.push_back(v);
+			}
+		}
+
+		for (unsigned int y = 0; y < size; y++)
+		{
+			for (unsigned int x = 0; x < size; x++)
+			{
+				unsigned int corner = first + y * (size + 1) + x;
+				unsigned int quad[6] = { corner, corner + size + 1, corner + 1, corner + 1, corner + size + 1, corner + size + 2 };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+	}
+
+	// Distance from the center of the bounds to the furthest vertex, as the simplifier measures it
+	float Radius(const std::vector<Vertex>& verts)
+	{
+		DirectX::XMFLOAT3 minP = verts[0].Position;
+		DirectX::XMFLOAT3 maxP = minP;
+		for (const Vertex& v : verts)
+		{
+			minP = DirectX::XMFLOAT3(std::min(minP.x, v.Position.x), std::min(minP.y, v.Position.y), std::min(minP.z, v.Position.z));
+			maxP = DirectX::XMFLOAT3(std::max(maxP.x, v.Position.x), std::max(maxP.y, v.Position.y), std::max(maxP.z, v.Position.z));
+		}
+
+		float radius = 0.0f;
+		for (const Vertex& v : verts)
+		{
+			float dx = v.Position.x - (minP.x + maxP.x) * 0.5f;
+			float dy = v.Position.y - (minP.y + maxP.y) * 0.5f;
+			float dz = v.Position.z - (minP.z + maxP.z) * 0.5f;
+			radius = std::max(radius, std::sqrt(dx * dx + dy * dy + dz * dz));
+		}
+		return radius;
+	}
+
+	bool Load(const char* mesh, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+	{
+		std::vector<SubMesh> subMeshes;
+		std::vector<std::string> materialNames;
+		std::wstring path = TestFramework::AssetPath((std::string("Basic Meshes/") + mesh).c_str());
+		return ObjLoader::LoadFile(path.c_str(), verts, indices, subMeshes, materialNames) && !indices.empty();
+	}
+}
+
+// A flat mesh simplifies with no error, so every level gets down to its ratio
+TEST(MeshSimplifier, ReachesTriangleRatios)
+{
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	AppendGrid(32, 0.0f, verts, indices);
+	unsigned int sourceTriangles = (unsigned int)indices.size() / 3;
+
+	size_t targetCount = sizeof(MeshSimplifier::DefaultLodTargets) / sizeof(LodTarget);
+	std::vector<MeshLod> lods = MeshSimplifier::BuildLodChain(verts.data(), verts.size(), indices,
+		0, (unsigned int)indices.size(), MeshSimplifier::DefaultLodTargets, targetCount);
+
+	CHECK_EQUAL(targetCount + 1, lods.size());
+	CHECK(lods[0].indexOffset == 0 && lods[0].indexCount == sourceTriangles * 3 && lods[0].error == 0.0f);
+	for (size_t i = 1; i < lods.size() && i <= targetCount; i++)
+	{
+		CHECK(lods[i].indexCount > 0);
+		CHECK(lods[i].indexCount / 3 <= sourceTriangles * MeshSimplifier::DefaultLodTargets[i - 1].triangleRatio);
+		CHECK(lods[i].indexCount < lods[i - 1].indexCount);
+		CHECK_NEAR(0.0, lods[i].error, 0.0001);
+		CHECK(lods[i].indexOffset + lods[i].indexCount <= indices.size());
+	}
+}
+
+// A curved mesh stops short of its ratio rather than stray further than the error allows
+TEST(MeshSimplifier, StaysWithinErrorBound)
+{
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	CHECK(Load("torus.obj", verts, indices));
+	if (indices.empty())
+		return;
+
+	float radius = Radius(verts);
+	unsigned int sourceTriangles = (unsigned int)indices.size() / 3;
+	const float maxErrors[] = { 0.005f, 0.02f, 0.08f };
+	for (float maxError : maxErrors)
+	{
+		std::vector<unsigned int> lodIndices = indices;
+		LodTarget target = { 0.05f, maxError };
+		std::vector<MeshLod> lods = MeshSimplifier::BuildLodChain(verts.data(), verts.size(), lodIndices,
+			0, (unsigned int)lodIndices.size(), &target, 1);
+
+		CHECK_EQUAL(2u, lods.size());
+		if (lods.size() != 2)
+			continue;
+		CHECK(lods[1].error > 0.0f);
+		CHECK(lods[1].error <= maxError * radius);
+	}
+
+	// Too tight a bound to get anywhere near the ratio
+	LodTarget tight = { 0.05f, 0.001f };
+	std::vector<MeshLod> lods = MeshSimplifier::BuildLodChain(verts.data(), verts.size(), indices,
+		0, (unsigned int)indices.size(), &tight, 1);
+	CHECK(lods.size() == 1 || lods[1].indexCount / 3 > sourceTriangles * tight.triangleRatio);
+	for (const MeshLod& lod : lods)
+		CHECK(lod.error <= tight.maxError * radius);
+}
+
+// Every level of a sub-mesh indexes the shared vertex buffer, and only vertices its full level uses
+TEST(MeshSimplifier, SharesSubMeshVertices)
+{
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	AppendGrid(8, 0.0f, verts, indices);
+	unsigned int secondOffset = (unsigned int)indices.size();
+	AppendGrid(16, 2.0f, verts, indices);
+	unsigned int secondCount = (unsigned int)indices.size() - secondOffset;
+	unsigned int firstVertex = 9 * 9;
+	std::vector<unsigned int> original = indices;
+
+	std::vector<MeshLod> lods = MeshSimplifier::BuildLodChain(verts.data(), verts.size(), indices,
+		secondOffset, secondCount, MeshSimplifier::DefaultLodTargets, 2);
+
+	CHECK_EQUAL(3u, lods.size());
+	CHECK(std::equal(original.begin(), original.end(), indices.begin()));
+	for (size_t i = 1; i < lods.size(); i++)
+	{
+		CHECK(lods[i].indexOffset >= original.size());
+		CHECK(lods[i].indexOffset + lods[i].indexCount <= indices.size());
+		for (unsigned int j = 0; j < lods[i].indexCount && lods[i].indexOffset + j < indices.size(); j++)
+		{
+			unsigned int index = indices[lods[i].indexOffset + j];
+			CHECK(index >= firstVertex && index < verts.size());
+		}
+	}
+}
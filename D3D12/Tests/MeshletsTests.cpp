@@ -0,0 +1,255 @@
+#include "TestFramework.h"
+#include "Meshlets.h"
+#include "ObjLoader.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// A flat size x size grid of unit quads in the z = 0 plane, facing -z
+	void Grid(unsigned int size, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+	{
+		verts.clear();
+		indices.clear();
+		for (unsigned int y = 0; y <= size; y++)
+		{
+			for (unsigned int x = 0; x <= size; x++)
+			{
+				Vertex v = {};
+				v.Position = XMFLOAT3((float)x, (float)y, 0.0f);
+				v.Normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
+				verts.push_back(v);
+			}
+		}
+
+		for (unsigned int y = 0; y < size; y++)
+		{
+			for (unsigned int x = 0; x < size; x++)
+			{
+				unsigned int corner = y * (size + 1) + x;
+				unsigned int quad[6] = { corner, corner + size + 1, corner + 1, corner + 1, corner + size + 1, corner + size + 2 };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+	}
+
+	XMFLOAT4X4 Translation(float x, float y, float z)
+	{
+		XMFLOAT4X4 m;
+		memset(&m, 0, sizeof(m));
+		m._11 = m._22 = m._33 = m._44 = 1.0f;
+		m._41 = x;
+		m._42 = y;
+		m._43 = z;
+		return m;
+	}
+
+	// Left-handed 90 degree perspective, like XMMatrixPerspectiveFovLH
+	XMFLOAT4X4 Perspective()
+	{
+		float nearZ = 0.1f, farZ = 1000.0f;
+		XMFLOAT4X4 m;
+		memset(&m, 0, sizeof(m));
+		m._11 = 1.0f;
+		m._22 = 1.0f;
+		m._33 = farZ / (farZ - nearZ);
+		m._34 = 1.0f;
+		m._43 = -nearZ * farZ / (farZ - nearZ);
+		return m;
+	}
+
+	// A view that contains everything, so only the cone can cull
+	MeshletCullView Everywhere(XMFLOAT3 cameraPosition)
+	{
+		MeshletCullView cullView;
+		for (int i = 0; i < 6; i++)
+			cullView.planes[i] = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+		cullView.cameraPosition = cameraPosition;
+		return cullView;
+	}
+
+	// A meshlet's triangles as indices into the mesh's vertex buffer
+	std::vector<unsigned int> MeshletIndices(const MeshletData& data, const Meshlet& meshlet)
+	{
+		std::vector<unsigned int> indices;
+		for (unsigned int i = 0; i < meshlet.triangleCount * 3; i++)
+			indices.push_back(data.vertices[meshlet.vertexOffset + data.triangles[meshlet.triangleOffset + i]]);
+		return indices;
+	}
+
+	// Triangles as sorted triples, each rotated to start at its smallest index
+	std::vector<std::array<unsigned int, 3>> SortedTriangles(const std::vector<unsigned int>& indices)
+	{
+		std::vector<std::array<unsigned int, 3>> triangles;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			std::array<unsigned int, 3> t = { indices[i], indices[i + 1], indices[i + 2] };
+			std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+			triangles.push_back(t);
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+}
+
+// Every meshlet stays within the vertex and triangle limits, and together they hold each triangle once
+TEST(Meshlets, RespectsLimits)
+{
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	std::vector<SubMesh> subMeshes;
+	std::vector<std::string> materialNames;
+	std::wstring path = TestFramework::AssetPath("Basic Meshes/torus.obj");
+	CHECK(ObjLoader::LoadFile(path.c_str(), verts, indices, subMeshes, materialNames));
+
+	MeshletData data;
+	Meshlets::Build(verts.data(), verts.size(), indices.data(), indices.size(), data);
+	CHECK(data.meshlets.size() >= indices.size() / 3 / Meshlets::MaxTriangles);
+
+	std::vector<unsigned int> all;
+	for (const Meshlet& meshlet : data.meshlets)
+	{
+		CHECK(meshlet.vertexCount > 0 && meshlet.vertexCount <= Meshlets::MaxVertices);
+		CHECK(meshlet.triangleCount > 0 && meshlet.triangleCount <= Meshlets::MaxTriangles);
+		CHECK(meshlet.vertexOffset + meshlet.vertexCount <= data.vertices.size());
+		CHECK(meshlet.triangleOffset + meshlet.triangleCount * 3 <= data.triangles.size());
+		for (unsigned int i = 0; i < meshlet.triangleCount * 3; i++)
+			CHECK(data.triangles[meshlet.triangleOffset + i] < meshlet.vertexCount);
+		for (unsigned int i = 0; i < meshlet.vertexCount; i++)
+			CHECK(data.vertices[meshlet.vertexOffset + i] < verts.size());
+
+		std::vector<unsigned int> meshletIndices = MeshletIndices(data, meshlet);
+		all.insert(all.end(), meshletIndices.begin(), meshletIndices.end());
+	}
+	CHECK(SortedTriangles(all) == SortedTriangles(indices));
+}
+
+// Each meshlet's bounding sphere holds all of its vertices
+TEST(Meshlets, SpheresContainVertices)
+{
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	std::vector<SubMesh> subMeshes;
+	std::vector<std::string> materialNames;
+	std::wstring path = TestFramework::AssetPath("Basic Meshes/sphere.obj");
+	CHECK(ObjLoader::LoadFile(path.c_str(), verts, indices, subMeshes, materialNames));
+
+	MeshletData data;
+	Meshlets::Build(verts.data(), verts.size(), indices.data(), indices.size(), data);
+	CHECK(!data.meshlets.empty());
+	for (const Meshlet& meshlet : data.meshlets)
+	{
+		for (unsigned int i = 0; i < meshlet.vertexCount; i++)
+		{
+			const XMFLOAT3& p = verts[data.vertices[meshlet.vertexOffset + i]].Position;
+			float dx = p.x - meshlet.center.x, dy = p.y - meshlet.center.y, dz = p.z - meshlet.center.z;
+			CHECK(std::sqrt(dx * dx + dy * dy + dz * dz) <= meshlet.radius * 1.0001f + 0.00001f);
+		}
+	}
+}
+
+// A flat meshlet is culled from behind, where every one of its triangles faces away, and kept from the front
+TEST(Meshlets, CullsBackFacingCone)
+{
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	Grid(8, verts, indices);
+
+	MeshletData data;
+	Meshlets::Build(verts.data(), verts.size(), indices.data(), indices.size(), data);
+	CHECK(!data.meshlets.empty());
+
+	std::vector<unsigned int> out;
+	XMFLOAT3 behind(4.0f, 4.0f, 10.0f);
+	MeshletCullStats stats;
+	CHECK_EQUAL(0u, Meshlets::Cull(data, 0, (unsigned int)data.meshlets.size(), Everywhere(behind), out, &stats));
+	CHECK_EQUAL(data.meshlets.size(), stats.backfaceCulled);
+	CHECK_EQUAL(0u, stats.frustumCulled);
+
+	// Which really is behind every triangle, for the clockwise winding the rasterizer culls
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		const XMFLOAT3& a = verts[indices[i]].Position;
+		const XMFLOAT3& b = verts[indices[i + 1]].Position;
+		const XMFLOAT3& c = verts[indices[i + 2]].Position;
+		XMFLOAT3 ab(b.x - a.x, b.y - a.y, b.z - a.z), ac(c.x - a.x, c.y - a.y, c.z - a.z);
+		XMFLOAT3 normal(ab.y * ac.z - ab.z * ac.y, ab.z * ac.x - ab.x * ac.z, ab.x * ac.y - ab.y * ac.x);
+		CHECK(normal.x * (behind.x - a.x) + normal.y * (behind.y - a.y) + normal.z * (behind.z - a.z) < 0.0f);
+	}
+
+	stats = MeshletCullStats();
+	CHECK_EQUAL(indices.size(), Meshlets::Cull(data, 0, (unsigned int)data.meshlets.size(), Everywhere(XMFLOAT3(4.0f, 4.0f, -10.0f)), out, &stats));
+	CHECK_EQUAL(0u, stats.backfaceCulled);
+}
+
+// Meshlets outside the camera's frustum are dropped, moved there by the camera or the entity
+TEST(Meshlets, CullsOutsideFrustum)
+{
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	Grid(8, verts, indices);
+
+	MeshletData data;
+	Meshlets::Build(verts.data(), verts.size(), indices.data(), indices.size(), data);
+	unsigned int count = (unsigned int)data.meshlets.size();
+	XMFLOAT4X4 view = Translation(0, 0, 0);
+	XMFLOAT4X4 projection = Perspective();
+
+	// Ahead of the camera at the origin, looking down +z
+	std::vector<unsigned int> out;
+	MeshletCullView cullView = Meshlets::MakeCullView(Translation(-4, -4, 20), view, projection, XMFLOAT3(0, 0, 0));
+	CHECK_EQUAL(indices.size(), Meshlets::Cull(data, 0, count, cullView, out));
+
+	// Off to the side, and behind
+	MeshletCullStats stats;
+	cullView = Meshlets::MakeCullView(Translation(100, -4, 20), view, projection, XMFLOAT3(0, 0, 0));
+	CHECK_EQUAL(0u, Meshlets::Cull(data, 0, count, cullView, out, &stats));
+	CHECK_EQUAL(count, stats.frustumCulled);
+	cullView = Meshlets::MakeCullView(Translation(-4, -4, -20), view, projection, XMFLOAT3(0, 0, 0));
+	CHECK_EQUAL(0u, Meshlets::Cull(data, 0, count, cullView, out));
+
+	// The camera moved away, rather than the grid
+	cullView = Meshlets::MakeCullView(Translation(-4, -4, 20), Translation(0, 200, 0), projection, XMFLOAT3(0, -200, 0));
+	CHECK_EQUAL(0u, Meshlets::Cull(data, 0, count, cullView, out));
+}
+
+// What survives a partial view is exactly the surviving meshlets' triangles, in order
+TEST(Meshlets, CompactsSurvivingTriangles)
+{
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	Grid(64, verts, indices);
+
+	MeshletData data;
+	Meshlets::Build(verts.data(), verts.size(), indices.data(), indices.size(), data);
+	unsigned int count = (unsigned int)data.meshlets.size();
+
+	// Close enough that only the middle of the grid is in view
+	MeshletCullView cullView = Meshlets::MakeCullView(Translation(-32, -32, 10), Translation(0, 0, 0), Perspective(), XMFLOAT3(0, 0, 0));
+	std::vector<unsigned int> out;
+	MeshletCullStats stats;
+	size_t drawn = Meshlets::Cull(data, 0, count, cullView, out, &stats);
+	CHECK(stats.frustumCulled > 0 && stats.frustumCulled < count);
+	CHECK_EQUAL(drawn, out.size());
+	CHECK_EQUAL(stats.trianglesDrawn * 3, out.size());
+	CHECK_EQUAL(indices.size() / 3, stats.triangles);
+
+	std::vector<unsigned int> expected;
+	std::vector<unsigned int> single;
+	for (unsigned int m = 0; m < count; m++)
+	{
+		if (Meshlets::Cull(data, m, 1, cullView, single) == 0)
+			continue;
+		std::vector<unsigned int> meshletIndices = MeshletIndices(data, data.meshlets[m]);
+		CHECK(single == meshletIndices);
+		expected.insert(expected.end(), meshletIndices.begin(), meshletIndices.end());
+	}
+	CHECK(out == expected);
+}
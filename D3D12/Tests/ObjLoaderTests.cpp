@@ -0,0 +1,257 @@
+#include "TestFramework.h"
+#include "ObjReference.h"
+#include "ObjLoader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	struct ParsedObj
+	{
+		std::vector<Vertex> verts;
+		std::vector<unsigned int> indices;
+		std::vector<SubMesh> subMeshes;
+		std::vector<std::string> materialNames;
+	};
+
+	ParsedObj Parse(const std::string& text, unsigned int threads = 1)
+	{
+		ParsedObj obj;
+		ObjLoader::Parse(text.data(), text.size(), obj.verts, obj.indices, obj.subMeshes, obj.materialNames, threads);
+		return obj;
+	}
+
+	// Within a couple of float steps, which is as close as two correctly
+	// rounded scanners can disagree through a double
+	bool Close(float a, float b)
+	{
+		return std::fabs(a - b) <= 2.5e-7f * (std::fabs(a) > 1.0f ? std::fabs(a) : 1.0f);
+	}
+
+	bool SameCorner(const Vertex& a, const Vertex& b)
+	{
+		return
+			Close(a.Position.x, b.Position.x) && Close(a.Position.y, b.Position.y) && Close(a.Position.z, b.Position.z) &&
+			Close(a.Normal.x, b.Normal.x) && Close(a.Normal.y, b.Normal.y) && Close(a.Normal.z, b.Normal.z) &&
+			Close(a.UV.x, b.UV.x) && Close(a.UV.y, b.UV.y);
+	}
+}
+
+// Every triangle corner of every mesh in Assets comes out as the old loader made it
+TEST(ObjLoader, MatchesReferenceLoader)
+{
+	const char* files[] = { "cube.obj", "cylinder.obj", "helix.obj", "quad.obj", "quad_double_sided.obj", "sphere.obj", "torus.obj" };
+	for (const char* file : files)
+	{
+		std::wstring path = TestFramework::AssetPath((std::string("Basic Meshes/") + file).c_str());
+		ParsedObj obj;
+		std::vector<Vertex> referenceVerts;
+		std::vector<unsigned int> referenceIndices;
+		CHECK(ObjLoader::LoadFile(path.c_str(), obj.verts, obj.indices, obj.subMeshes, obj.materialNames));
+		CHECK(ObjReference::LoadFile(path, referenceVerts, referenceIndices));
+		CHECK_EQUAL(referenceIndices.size(), obj.indices.size());
+
+		size_t mismatches = 0;
+		for (size_t i = 0; i < obj.indices.size() && i < referenceIndices.size(); i++)
+		{
+			if (!SameCorner(referenceVerts[referenceIndices[i]], obj.verts[obj.indices[i]]))
+				mismatches++;
+		}
+		CHECK_EQUAL(0u, mismatches);
+
+		// Welding shares vertices between triangles
+		CHECK(obj.verts.size() < referenceVerts.size());
+	}
+}
+
+TEST(ObjLoader, ScansNumbers)
+{
+	ParsedObj obj = Parse(
+		"v 1 -2.5 +3e2\n"
+		"v .5 1.e-3 -0\n"
+		"v 123456.789 -0.000001 1E+1\n"
+		"vt 0.25 0.75\n"
+		"vn 0 0 1\n"
+		"f 1/1/1 2/1/1 3/1/1\n");
+
+	CHECK_EQUAL(3u, obj.verts.size());
+	CHECK_EQUAL(3u, obj.indices.size());
+	if (obj.verts.size() != 3)
+		return;
+
+	// Z is flipped into DirectX's left-handed space, and so is V
+	CHECK_NEAR(1.0, obj.verts[0].Position.x, 0.0);
+	CHECK_NEAR(-2.5, obj.verts[0].Position.y, 0.0);
+	CHECK_NEAR(-300.0, obj.verts[0].Position.z, 0.0);
+	CHECK_NEAR(0.5, obj.verts[1].Position.x, 0.0);
+	CHECK_NEAR(0.001f, obj.verts[1].Position.y, 0.0);
+	CHECK_NEAR(123456.789f, obj.verts[2].Position.x, 0.0);
+	CHECK_NEAR(-0.000001f, obj.verts[2].Position.y, 0.0);
+	CHECK_NEAR(-10.0, obj.verts[2].Position.z, 0.0);
+	CHECK_NEAR(0.25, obj.verts[0].UV.x, 0.0);
+	CHECK_NEAR(0.25, obj.verts[0].UV.y, 0.0);
+	CHECK_NEAR(-1.0, obj.verts[0].Normal.z, 0.0);
+}
+
+// Polygons are fanned from their first corner, with the winding flipped
+TEST(ObjLoader, FansPolygons)
+{
+	ParsedObj obj = Parse(
+		"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0.5 2 0\nv 0 1 0\n"
+		"vt 0 0\nvn 0 0 1\n"
+		"f 1/1/1 2/1/1 3/1/1 4/1/1 5/1/1\n");
+
+	const unsigned int expected[] = { 0, 2, 1, 0, 3, 2, 0, 4, 3 };
+	CHECK_EQUAL(9u, obj.indices.size());
+	for (size_t i = 0; i < obj.indices.size() && i < 9; i++)
+		CHECK_EQUAL(expected[i], obj.indices[i]);
+}
+
+TEST(ObjLoader, ResolvesNegativeIndices)
+{
+	std::string attributes = "v 0 0 0\nv 1 0 0\nv 0 1 0\nvt 0 0\nvt 1 0\nvt 0 1\nvn 0 0 1\n";
+	ParsedObj absolute = Parse(attributes + "f 1/1/1 2/2/1 3/3/1\n");
+	ParsedObj relative = Parse(attributes + "f -3/-3/-1 -2/-2/-1 -1/-1/-1\n");
+
+	CHECK(absolute.indices == relative.indices);
+	CHECK_EQUAL(absolute.verts.size(), relative.verts.size());
+	CHECK(absolute.verts.size() == relative.verts.size() &&
+		memcmp(absolute.verts.data(), relative.verts.data(), absolute.verts.size() * sizeof(Vertex)) == 0);
+}
+
+// Windows line endings, a missing final newline and faces without uvs
+TEST(ObjLoader, HandlesLooseFormatting)
+{
+	ParsedObj obj = Parse("v 0 0 0\r\nv 1 0 0\r\nv 0 1 0\r\nvn 0 0 1\r\nf 1//1 2//1 3//1");
+
+	CHECK_EQUAL(3u, obj.indices.size());
+	CHECK_EQUAL(3u, obj.verts.size());
+	if (obj.verts.size() == 3)
+		CHECK_NEAR(1.0, obj.verts[1].Position.x, 0.0);
+}
+
+TEST(ObjLoader, GroupsSubMeshes)
+{
+	ParsedObj obj = Parse(
+		"v 0 0 0\nv 1 0 0\nv 0 1 0\nvt 0 0\nvn 0 0 1\n"
+		"o First\nusemtl A\nf 1/1/1 2/1/1 3/1/1\n"
+		"o Second\nusemtl B\nf 1/1/1 3/1/1 2/1/1\nf 3/1/1 2/1/1 1/1/1\n"
+		"o First\nusemtl A\nf 2/1/1 1/1/1 3/1/1\n");
+
+	CHECK_EQUAL(2u, obj.materialNames.size());
+	CHECK_EQUAL(2u, obj.subMeshes.size());
+	if (obj.subMeshes.size() != 2)
+		return;
+
+	// Each sub-mesh's triangles end up as one contiguous range
+	CHECK_EQUAL(0u, obj.subMeshes[0].indexOffset);
+	CHECK_EQUAL(6u, obj.subMeshes[0].indexCount);
+	CHECK_EQUAL(6u, obj.subMeshes[1].indexOffset);
+	CHECK_EQUAL(6u, obj.subMeshes[1].indexCount);
+	CHECK(obj.materialNames[0] == "A" && obj.materialNames[1] == "B");
+}
+
+// Materials switching every triangle, across groups and thread chunks, still give each
+// sub-mesh one material slot and a range holding only its own triangles, in file order
+TEST(ObjLoader, SplitsInterleavedMaterials)
+{
+	const char* groups[] = { "Left", "Right" };
+	const char* materials[] = { "M_Wood", "M_Paint", "M_Rock" };
+	auto groupOf = [](unsigned int t) { return (t / 5) % 2; };
+	auto materialOf = [](unsigned int t) { return (t * 7 / 3) % 3; };
+
+	// Triangle t's corners all sit at x = t, so it can be found wherever it ends up
+	std::ostringstream text;
+	const unsigned int triangles = 40000;
+	for (unsigned int t = 0; t < triangles; t++)
+	{
+		if (t == 0 || groupOf(t) != groupOf(t - 1))
+			text << "g " << groups[groupOf(t)] << "\n";
+		text << "usemtl " << materials[materialOf(t)] << "\n";
+		text << "v " << t << " 0 0\nv " << t << " 1 0\nv " << t << " 0 1\n";
+		text << "f " << t * 3 + 1 << " " << t * 3 + 2 << " " << t * 3 + 3 << "\n";
+	}
+	CHECK(text.str().size() > 2 * 1024 * 1024);
+
+	for (unsigned int threads = 1; threads <= 4; threads += 3)
+	{
+		ParsedObj obj = Parse(text.str(), threads);
+		CHECK_EQUAL(triangles * 3, obj.indices.size());
+		CHECK_EQUAL(6u, obj.subMeshes.size());
+		CHECK_EQUAL(3u, obj.materialNames.size());
+		if (obj.indices.size() != triangles * 3 || obj.materialNames.size() != 3)
+			continue;
+
+		// Slots are numbered by first use (triangles 0, 1 and 2), and shared by both groups
+		CHECK(obj.materialNames[0] == "M_Wood" && obj.materialNames[1] == "M_Rock" && obj.materialNames[2] == "M_Paint");
+
+		std::vector<bool> seen(triangles, false);
+		std::vector<unsigned int> pairs;
+		unsigned int nextOffset = 0;
+		for (const SubMesh& subMesh : obj.subMeshes)
+		{
+			CHECK_EQUAL(nextOffset, subMesh.indexOffset);
+			CHECK(subMesh.materialSlot < 3);
+			nextOffset = subMesh.indexOffset + subMesh.indexCount;
+
+			unsigned int first = (unsigned int)obj.verts[obj.indices[subMesh.indexOffset]].Position.x;
+			unsigned int pair = groupOf(first) * 3 + materialOf(first);
+			CHECK(std::find(pairs.begin(), pairs.end(), pair) == pairs.end());
+			pairs.push_back(pair);
+
+			int previous = -1;
+			for (unsigned int i = subMesh.indexOffset; i < nextOffset && i < obj.indices.size(); i += 3)
+			{
+				unsigned int t = (unsigned int)obj.verts[obj.indices[i]].Position.x;
+				CHECK(t < triangles && (int)t > previous);
+				CHECK(groupOf(t) == groupOf(first));
+				CHECK(obj.materialNames[subMesh.materialSlot] == materials[materialOf(t)]);
+				if (t < triangles)
+					seen[t] = true;
+				previous = (int)t;
+			}
+		}
+		CHECK_EQUAL(obj.indices.size(), nextOffset);
+		CHECK(std::find(seen.begin(), seen.end(), false) == seen.end());
+	}
+}
+
+// Large files are split across threads, which must not change a single byte
+TEST(ObjLoader, ThreadCountDoesNotChangeOutput)
+{
+	// Enough text for several chunks, with groups, materials and relative indices
+	std::ostringstream text;
+	ObjReference::WriteSynthetic(text, 6 * 1024 * 1024, true);
+	ParsedObj single = Parse(text.str(), 1);
+	CHECK(single.indices.size() > 0);
+	CHECK(single.subMeshes.size() == 3);
+
+	for (unsigned int threads = 2; threads <= 8; threads++)
+	{
+		ParsedObj multi = Parse(text.str(), threads);
+		CHECK(multi.materialNames == single.materialNames);
+		CHECK(multi.verts.size() == single.verts.size() &&
+			memcmp(multi.verts.data(), single.verts.data(), single.verts.size() * sizeof(Vertex)) == 0);
+		CHECK(multi.indices == single.indices);
+		CHECK(multi.subMeshes.size() == single.subMeshes.size() &&
+			memcmp(multi.subMeshes.data(), single.subMeshes.data(), single.subMeshes.size() * sizeof(SubMesh)) == 0);
+	}
+}
+
+// Relative indices resolve against what came before them in the whole file, not the chunk
+TEST(ObjLoader, RelativeIndicesMatchAbsolute)
+{
+	std::ostringstream absoluteText, relativeText;
+	ObjReference::WriteSynthetic(absoluteText, 3 * 1024 * 1024, false);
+	ObjReference::WriteSynthetic(relativeText, 3 * 1024 * 1024, true);
+	ParsedObj absolute = Parse(absoluteText.str(), 4);
+	ParsedObj relative = Parse(relativeText.str(), 4);
+
+	CHECK(relative.indices == absolute.indices);
+	CHECK(relative.verts.size() == absolute.verts.size() &&
+		memcmp(relative.verts.data(), absolute.verts.data(), absolute.verts.size() * sizeof(Vertex)) == 0);
+}
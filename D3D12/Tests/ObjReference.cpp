@@ -0,0 +1,166 @@
+#include "ObjReference.h"
+
+#include <cstdio>
+#include <fstream>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// The loader Mesh used before ObjLoader, with sscanf
+// standing in for sscanf_s (the same thing for numbers),
+// and without calculating tangents
+// --------------------------------------------------------
+bool ObjReference::LoadFile(const std::filesystem::path& fileName, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	std::ifstream obj(fileName);
+	if (!obj.is_open())
+		return false;
+
+	std::vector<XMFLOAT3> positions;
+	std::vector<XMFLOAT3> normals;
+	std::vector<XMFLOAT2> uvs;
+	verts.clear();
+	indices.clear();
+	unsigned int indexCounter = 0;
+	char chars[100];
+
+	while (obj.good())
+	{
+		obj.getline(chars, 100);
+
+		if (chars[0] == 'v' && chars[1] == 'n')
+		{
+			XMFLOAT3 norm;
+			sscanf(chars, "vn %f %f %f", &norm.x, &norm.y, &norm.z);
+			normals.push_back(norm);
+		}
+		else if (chars[0] == 'v' && chars[1] == 't')
+		{
+			XMFLOAT2 uv;
+			sscanf(chars, "vt %f %f", &uv.x, &uv.y);
+			uvs.push_back(uv);
+		}
+		else if (chars[0] == 'v')
+		{
+			XMFLOAT3 pos;
+			sscanf(chars, "v %f %f %f", &pos.x, &pos.y, &pos.z);
+			positions.push_back(pos);
+		}
+		else if (chars[0] == 'f')
+		{
+			int i[12];
+			int numbersRead = sscanf(chars, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
+				&i[0], &i[1], &i[2], &i[3], &i[4], &i[5],
+				&i[6], &i[7], &i[8], &i[9], &i[10], &i[11]);
+
+			if (numbersRead == 1)
+			{
+				numbersRead = sscanf(chars, "f %d//%d %d//%d %d//%d %d//%d",
+					&i[0], &i[2], &i[3], &i[5], &i[6], &i[8], &i[9], &i[11]);
+				i[1] = i[4] = i[7] = i[10] = 1;
+				if (uvs.size() == 0)
+					uvs.push_back(XMFLOAT2(0, 0));
+			}
+
+			Vertex v[4] = {};
+			int corners = numbersRead == 12 || numbersRead == 8 ? 4 : 3;
+			for (int c = 0; c < corners; c++)
+			{
+				v[c].Position = positions[i[c * 3] - 1];
+				v[c].UV = uvs[i[c * 3 + 1] - 1];
+				v[c].Normal = normals[i[c * 3 + 2] - 1];
+
+				// Right-handed to left-handed, and V flipped
+				v[c].UV.y = 1.0f - v[c].UV.y;
+				v[c].Position.z *= -1.0f;
+				v[c].Normal.z *= -1.0f;
+			}
+
+			// Flipping the winding order
+			verts.push_back(v[0]);
+			verts.push_back(v[2]);
+			verts.push_back(v[1]);
+			if (corners == 4)
+			{
+				verts.push_back(v[0]);
+				verts.push_back(v[3]);
+				verts.push_back(v[2]);
+			}
+
+			while (indexCounter < verts.size())
+				indices.push_back(indexCounter++);
+		}
+	}
+
+	return true;
+}
+
+// --------------------------------------------------------
+// Rows of the grid are written one at a time, each with
+// its own vertices followed by the quads joining it to the
+// row before, so the file can be any size without building
+// it in memory. With relativeIndices, every fourth row's
+// quads point back at their vertices with negative indices
+// (which the reference loader can't read).
+// --------------------------------------------------------
+void ObjReference::WriteSynthetic(std::ostream& out, unsigned long long targetBytes, bool relativeIndices)
+{
+	const unsigned int columns = 256;
+	const char* materials[] = { "M_Wood", "M_Paint", "M_Rock" };
+	unsigned long long written = 0;
+	char line[160];
+
+	auto write = [&](int length)
+		{
+			out.write(line, length);
+			written += length;
+		};
+
+	write(snprintf(line, sizeof(line), "# Synthetic grid for ObjLoader tests and benchmarks\n"));
+	for (unsigned int row = 0; row == 0 || written < targetBytes; row++)
+	{
+		if (row % 64 == 1)
+		{
+			write(snprintf(line, sizeof(line), "o Strip%u\n", row / 64));
+			write(snprintf(line, sizeof(line), "usemtl %s\n", materials[(row / 64) % 3]));
+		}
+
+		for (unsigned int c = 0; c < columns; c++)
+		{
+			float x = c * 0.013671875f - 1.75f;
+			float z = row * 0.0078125f;
+			float y = 0.25f * (float)((c * 7 + row * 13) % 17) / 17.0f;
+			write(snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", x, y, -z));
+			write(snprintf(line, sizeof(line), "vt %.6f %.6f\n", (float)c / columns, (float)(row % 1024) / 1024.0f));
+			write(snprintf(line, sizeof(line), "vn %.6f %.6f %.6f\n", 0.0f, 0.9805806756f, -0.1961161351f * ((row & 1) ? 1.0f : -1.0f)));
+		}
+
+		if (row == 0)
+			continue;
+
+		// Quads between this row and the last, with 1-based indices
+		unsigned int thisRow = row * columns + 1;
+		unsigned int lastRow = thisRow - columns;
+		unsigned int total = thisRow + columns - 1;
+		for (unsigned int c = 0; c + 1 < columns; c++)
+		{
+			unsigned int a = lastRow + c, b = lastRow + c + 1, d = thisRow + c, e = thisRow + c + 1;
+			// The file's size is counted as if every index were absolute,
+			// so the same target makes the same grid either way
+			int length = snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u\n",
+				a, a, a, b, b, b, e, e, e, d, d, d);
+			if (relativeIndices && row % 4 == 0)
+			{
+				int ra = (int)a - (int)total - 1, rb = (int)b - (int)total - 1;
+				int rd = (int)d - (int)total - 1, re = (int)e - (int)total - 1;
+				out.write(line, snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n",
+					ra, ra, ra, rb, rb, rb, re, re, re, rd, rd, rd));
+				written += length;
+			}
+			else
+			{
+				write(length);
+			}
+		}
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <filesystem>
+#include <ostream>
+#include <vector>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// What ObjLoader gets measured and checked against
+//
+// LoadFile() is the engine's original .OBJ loader (one
+// getline and sscanf per line, one vertex per corner), kept
+// only as a reference. WriteSynthetic() makes OBJ text of
+// any size, for tests and benchmarks that need more than
+// the small meshes in Assets.
+// --------------------------------------------------------
+namespace ObjReference
+{
+	// Positions, uvs and normals of every triangle corner, three per
+	// triangle in draw order, with indices simply counting up
+	bool LoadFile(const std::filesystem::path& fileName, std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+
+	// A grid of quads, split into o/usemtl groups, until the text
+	// reaches at least targetBytes. Numbers have six decimals. With
+	// relativeIndices every fourth row of faces uses negative indices,
+	// for the same grid as the absolute version of the same size.
+	void WriteSynthetic(std::ostream& out, unsigned long long targetBytes, bool relativeIndices = false);
+}
@@ -0,0 +1,80 @@
+#include "TestFramework.h"
+#include "Parallel.h"
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+
+// Every index runs exactly once, and all of them have by the time Run returns
+TEST(Parallel, RunsEachIndexOnce)
+{
+	const size_t counts[] = { 0, 1, 2, 3, 7, 64, 1000 };
+	for (size_t count : counts)
+	{
+		std::vector<std::atomic<int>> runs(count);
+		for (std::atomic<int>& r : runs)
+			r = 0;
+
+		Parallel::Run(count, [&](size_t i) { runs[i]++; });
+
+		size_t wrong = 0;
+		for (std::atomic<int>& r : runs)
+		{
+			if (r.load() != 1)
+				wrong++;
+		}
+		CHECK_EQUAL(0u, wrong);
+	}
+}
+
+// Runs from inside a run finish, even with every worker busy
+TEST(Parallel, NestedRunsFinish)
+{
+	std::atomic<size_t> total = 0;
+	Parallel::Run(Parallel::HardwareThreads() + 2, [&](size_t)
+		{
+			Parallel::Run(16, [&](size_t)
+				{
+					Parallel::Run(4, [&](size_t) { total++; });
+				});
+		});
+	CHECK_EQUAL((Parallel::HardwareThreads() + 2) * 64u, total.load());
+}
+
+// Runs from several threads at once share the pool
+TEST(Parallel, ConcurrentCallers)
+{
+	std::atomic<size_t> total = 0;
+	std::vector<std::thread> callers;
+	for (int c = 0; c < 4; c++)
+	{
+		callers.emplace_back([&]()
+			{
+				for (int r = 0; r < 100; r++)
+					Parallel::Run(8, [&](size_t) { total++; });
+			});
+	}
+	for (std::thread& t : callers)
+		t.join();
+	CHECK_EQUAL(4u * 100u * 8u, total.load());
+}
+
+// Running every frame reuses the same threads rather than making new ones
+TEST(Parallel, ReusesWorkerThreads)
+{
+	std::mutex mutex;
+	std::set<std::thread::id> threads;
+	for (int frame = 0; frame < 200; frame++)
+	{
+		Parallel::Run(8, [&](size_t)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				threads.insert(std::this_thread::get_id());
+			});
+	}
+
+	CHECK(threads.count(std::this_thread::get_id()) == 1);
+	CHECK(threads.size() <= Parallel::WorkerCount() + 1u);
+	CHECK_EQUAL(Parallel::HardwareThreads() - 1, Parallel::WorkerCount());
+}
@@ -0,0 +1,329 @@
+#include "TestFramework.h"
+#include "PipelineCache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// Descriptions are just an id, and a pipeline remembers which one made it
+	struct FakePipeline
+	{
+		int description;
+		bool fromLibrary;
+	};
+
+	// --------------------------------------------------------
+	// A driver whose library is a map of names to descriptions,
+	// serialized behind a "driver" tag it checks on the way in
+	// --------------------------------------------------------
+	class FakePipelineDevice : public PipelineDevice
+	{
+	public:
+
+		unsigned int driver = 1;
+		bool failCreates = false;
+		size_t opens = 0;
+		size_t creates = 0;
+		size_t releases = 0;
+		size_t serializes = 0;
+		std::map<std::wstring, int> library;
+
+		bool OpenLibrary(const void* data, size_t size) override
+		{
+			opens++;
+			library.clear();
+			if (size == 0)
+				return true;
+
+			const unsigned char* bytes = (const unsigned char*)data;
+			unsigned int tag;
+			if (size < sizeof(tag))
+				return false;
+			memcpy(&tag, bytes, sizeof(tag));
+			if (tag != driver)
+				return false;
+
+			size_t offset = sizeof(tag);
+			while (offset < size)
+			{
+				unsigned int length;
+				int description;
+				if (size - offset < sizeof(length))
+					return false;
+				memcpy(&length, bytes + offset, sizeof(length));
+				offset += sizeof(length);
+				if (size - offset < length * sizeof(wchar_t) + sizeof(description))
+					return false;
+
+				std::wstring name(length, L' ');
+				memcpy(&name[0], bytes + offset, length * sizeof(wchar_t));
+				offset += length * sizeof(wchar_t);
+				memcpy(&description, bytes + offset, sizeof(description));
+				offset += sizeof(description);
+				library[name] = description;
+			}
+			return true;
+		}
+
+		void* LoadPipeline(const wchar_t* name, const void* description) override
+		{
+			auto stored = library.find(name);
+			if (stored == library.end() || stored->second != *(const int*)description)
+				return 0;
+			return new FakePipeline{ stored->second, true };
+		}
+
+		void* CreatePipeline(const void* description) override
+		{
+			if (failCreates)
+				return 0;
+			creates++;
+			return new FakePipeline{ *(const int*)description, false };
+		}
+
+		bool StorePipeline(const wchar_t* name, void* pipeline) override
+		{
+			library[name] = ((FakePipeline*)pipeline)->description;
+			return true;
+		}
+
+		void ReleasePipeline(void* pipeline) override
+		{
+			releases++;
+			delete (FakePipeline*)pipeline;
+		}
+
+		bool SerializeLibrary(std::vector<unsigned char>& data) override
+		{
+			serializes++;
+			data.resize(sizeof(driver));
+			memcpy(data.data(), &driver, sizeof(driver));
+			for (auto& pair : library)
+			{
+				unsigned int length = (unsigned int)pair.first.size();
+				size_t offset = data.size();
+				data.resize(offset + sizeof(length) + length * sizeof(wchar_t) + sizeof(int));
+				memcpy(&data[offset], &length, sizeof(length));
+				memcpy(&data[offset + sizeof(length)], pair.first.data(), length * sizeof(wchar_t));
+				memcpy(&data[offset + sizeof(length) + length * sizeof(wchar_t)], &pair.second, sizeof(int));
+			}
+			return true;
+		}
+	};
+
+	unsigned long long Key(int description)
+	{
+		PipelineHasher hasher;
+		hasher.AddValue(description);
+		return hasher.GetHash();
+	}
+
+	FakePipeline* Get(PipelineCache& cache, int description)
+	{
+		return (FakePipeline*)cache.GetPipeline(Key(description), &description);
+	}
+
+	// A library file holding pipelines for the given descriptions
+	void WriteLibrary(const std::filesystem::path& file, std::initializer_list<int> descriptions)
+	{
+		FakePipelineDevice device;
+		PipelineCache cache(&device);
+		for (int description : descriptions)
+			Get(cache, description);
+		cache.Save(file);
+	}
+}
+
+TEST(PipelineCache, HashesFieldsNotLayout)
+{
+	PipelineHasher a;
+	a.AddValue(7);
+	a.AddString("VSMain");
+	a.AddValue(1.5f);
+
+	PipelineHasher b;
+	b.AddValue(7);
+	b.AddString("VSMain");
+	b.AddValue(1.5f);
+	CHECK(a.GetHash() == b.GetHash());
+
+	// Where the bytes are split matters, as do null and empty strings
+	PipelineHasher ab_c, a_bc, empty, null;
+	ab_c.Add("ab", 2); ab_c.Add("c", 1);
+	a_bc.Add("a", 1); a_bc.Add("bc", 2);
+	empty.AddString("");
+	null.AddString(0);
+	CHECK(ab_c.GetHash() != a_bc.GetHash());
+	CHECK(empty.GetHash() != null.GetHash());
+	CHECK(Key(1) != Key(2));
+
+	CHECK(PipelineCache::PipelineName(0x0123456789abcdefull) == L"0123456789abcdef");
+	CHECK(PipelineCache::PipelineName(0xfull) == L"000000000000000f");
+}
+
+// Each key is made once and shared after that, and everything is released at the end
+TEST(PipelineCache, MakesEachPipelineOnce)
+{
+	FakePipelineDevice device;
+	{
+		PipelineCache cache(&device);
+		FakePipeline* first = Get(cache, 1);
+		CHECK(first != 0);
+		CHECK(Get(cache, 1) == first);
+		FakePipeline* second = Get(cache, 2);
+		CHECK(second != 0 && second != first);
+		CHECK(second != 0 && second->description == 2);
+
+		PipelineCacheStats stats = cache.GetStats();
+		CHECK_EQUAL(3u, stats.requests);
+		CHECK_EQUAL(1u, stats.shared);
+		CHECK_EQUAL(2u, stats.compiled);
+		CHECK_EQUAL(2u, stats.stored);
+		CHECK_EQUAL(0u, stats.loaded);
+		CHECK_EQUAL(2u, cache.GetPipelineCount());
+		CHECK(!stats.libraryOpened);
+	}
+	CHECK_EQUAL(2u, device.creates);
+	CHECK_EQUAL(2u, device.releases);
+}
+
+// A failed compile isn't remembered, so asking again tries again
+TEST(PipelineCache, RetriesFailedPipelines)
+{
+	FakePipelineDevice device;
+	PipelineCache cache(&device);
+
+	device.failCreates = true;
+	CHECK(Get(cache, 5) == 0);
+	CHECK_EQUAL(1u, cache.GetStats().failed);
+	CHECK_EQUAL(0u, cache.GetPipelineCount());
+
+	device.failCreates = false;
+	CHECK(Get(cache, 5) != 0);
+	CHECK_EQUAL(1u, cache.GetStats().compiled);
+	CHECK_EQUAL(1u, cache.GetPipelineCount());
+}
+
+// Pipelines saved on one run load on the next without compiling
+TEST(PipelineCache, ReloadsSavedLibrary)
+{
+	std::filesystem::path file = TestFramework::TempPath("PipelineCacheTest.bin");
+	WriteLibrary(file, { 1, 2, 3 });
+
+	FakePipelineDevice device;
+	PipelineCache cache(&device);
+	CHECK(cache.Load(file));
+	CHECK_EQUAL(3u, device.library.size());
+
+	FakePipeline* pipeline = Get(cache, 2);
+	CHECK(pipeline != 0 && pipeline->fromLibrary);
+	CHECK(Get(cache, 4) != 0);
+
+	PipelineCacheStats stats = cache.GetStats();
+	CHECK(stats.libraryOpened);
+	CHECK_EQUAL(1u, stats.loaded);
+	CHECK_EQUAL(1u, stats.compiled);
+
+	// Only a library that gained something is written again
+	CHECK(cache.Save(file));
+	CHECK_EQUAL(1u, device.serializes);
+	CHECK(cache.Save(file));
+	CHECK_EQUAL(1u, device.serializes);
+
+	FakePipelineDevice unchanged;
+	PipelineCache reloaded(&unchanged);
+	CHECK(reloaded.Load(file));
+	Get(reloaded, 1);
+	CHECK(reloaded.Save(file));
+	CHECK_EQUAL(0u, unchanged.serializes);
+	CHECK_EQUAL(0u, unchanged.creates);
+	CHECK_EQUAL(4u, unchanged.library.size());
+
+	std::filesystem::remove(file);
+}
+
+// Damaged, out of date or foreign files start empty rather than reaching the device
+TEST(PipelineCache, RejectsBadLibraries)
+{
+	std::filesystem::path file = TestFramework::TempPath("PipelineCacheTest.bin");
+	WriteLibrary(file, { 1, 2 });
+	std::vector<char> good;
+	{
+		std::ifstream in(file, std::ios::binary);
+		good.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	}
+	CHECK(good.size() > 32);
+
+	auto loads = [&](const std::vector<char>& bytes, size_t& opens)
+	{
+		{
+			std::ofstream out(file, std::ios::binary | std::ios::trunc);
+			out.write(bytes.data(), (std::streamsize)bytes.size());
+		}
+		FakePipelineDevice device;
+		PipelineCache cache(&device);
+		bool loaded = cache.Load(file);
+		opens = device.opens;
+
+		// Whatever happened, pipelines still get made
+		CHECK(Get(cache, 1) != 0);
+		return loaded;
+	};
+
+	size_t opens = 0;
+	CHECK(loads(good, opens));
+	CHECK_EQUAL(2u, opens);
+
+	std::vector<char> truncated(good.begin(), good.end() - 3);
+	CHECK(!loads(truncated, opens));
+	CHECK_EQUAL(1u, opens);
+
+	std::vector<char> flipped = good;
+	flipped.back() ^= 0x40;
+	CHECK(!loads(flipped, opens));
+	CHECK_EQUAL(1u, opens);
+
+	std::vector<char> oldVersion = good;
+	oldVersion[4]++;
+	CHECK(!loads(oldVersion, opens));
+	CHECK_EQUAL(1u, opens);
+
+	std::vector<char> notALibrary(good.size(), 'x');
+	CHECK(!loads(notALibrary, opens));
+	CHECK_EQUAL(1u, opens);
+
+	// Intact, but from another driver: the device turns it down
+	{
+		FakePipelineDevice otherDriver;
+		otherDriver.driver = 2;
+		PipelineCache cache(&otherDriver);
+		Get(cache, 1);
+		cache.Save(file);
+	}
+	FakePipelineDevice device;
+	PipelineCache cache(&device);
+	CHECK(!cache.Load(file));
+	CHECK(!cache.GetStats().libraryOpened);
+	CHECK(Get(cache, 1) != 0 && !Get(cache, 1)->fromLibrary);
+
+	std::filesystem::remove(file);
+}
+
+// A stored entry whose description doesn't match is compiled fresh
+TEST(PipelineCache, CompilesOnDescriptionMismatch)
+{
+	FakePipelineDevice device;
+	PipelineCache cache(&device);
+	device.library[PipelineCache::PipelineName(Key(9))] = 10;
+
+	int description = 9;
+	FakePipeline* pipeline = (FakePipeline*)cache.GetPipeline(Key(9), &description);
+	CHECK(pipeline != 0 && !pipeline->fromLibrary);
+	CHECK_EQUAL(0u, cache.GetStats().loaded);
+	CHECK_EQUAL(1u, cache.GetStats().compiled);
+}
@@ -0,0 +1,124 @@
+#include "TestFramework.h"
+#include "ObjReference.h"
+#include "ObjLoader.h"
+#include "Tangents.h"
+
+#include <sstream>
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	struct TangentDifference
+	{
+		double maxAngle = 0.0;	// Degrees
+		size_t handednessMismatches = 0;
+		size_t compared = 0;
+	};
+
+	// Runs both versions on the mesh and compares their results. Vertices the
+	// reference leaves as NaN (degenerate UVs) are skipped, since Calculate()
+	// deliberately avoids that.
+	TangentDifference Compare(std::vector<Vertex> verts, const std::vector<unsigned int>& indices, unsigned int threads)
+	{
+		std::vector<Vertex> reference = verts;
+		Tangents::CalculateReference(reference.data(), reference.size(), indices.data(), indices.size());
+		Tangents::Calculate(verts.data(), verts.size(), indices.data(), indices.size(), threads);
+
+		TangentDifference difference;
+		for (size_t v = 0; v < verts.size(); v++)
+		{
+			const DirectX::XMFLOAT4& a = reference[v].Tangent;
+			const DirectX::XMFLOAT4& b = verts[v].Tangent;
+			if (std::isnan(a.x) || std::isnan(a.y) || std::isnan(a.z))
+				continue;
+
+			// atan2 stays accurate for tiny angles, unlike acos of the dot product
+			double cx = (double)a.y * b.z - (double)a.z * b.y;
+			double cy = (double)a.z * b.x - (double)a.x * b.z;
+			double cz = (double)a.x * b.y - (double)a.y * b.x;
+			double angle = std::atan2(std::sqrt(cx * cx + cy * cy + cz * cz), (double)a.x * b.x + (double)a.y * b.y + (double)a.z * b.z);
+			if (angle * 57.29578 > difference.maxAngle)
+				difference.maxAngle = angle * 57.29578;
+			if (a.w != b.w)
+				difference.handednessMismatches++;
+			difference.compared++;
+		}
+		return difference;
+	}
+
+	bool Load(const char* mesh, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+	{
+		std::vector<SubMesh> subMeshes;
+		std::vector<std::string> materialNames;
+		std::wstring path = TestFramework::AssetPath((std::string("Basic Meshes/") + mesh).c_str());
+		return ObjLoader::LoadFile(path.c_str(), verts, indices, subMeshes, materialNames) && !indices.empty();
+	}
+}
+
+TEST(Tangents, SseMatchesReferenceOnAssets)
+{
+	const char* meshes[] = { "cube.obj", "cylinder.obj", "helix.obj", "sphere.obj", "torus.obj" };
+	for (const char* mesh : meshes)
+	{
+		std::vector<Vertex> verts;
+		std::vector<unsigned int> indices;
+		CHECK(Load(mesh, verts, indices));
+
+		TangentDifference difference = Compare(verts, indices, 1);
+		CHECK(difference.compared > 0);
+		CHECK_NEAR(0.0, difference.maxAngle, 0.01);
+		CHECK_EQUAL(0u, difference.handednessMismatches);
+	}
+}
+
+// Enough triangles to split across threads, whose partial sums must add up the same
+TEST(Tangents, SseMatchesReferenceOnThreads)
+{
+	std::ostringstream text;
+	ObjReference::WriteSynthetic(text, 8 * 1024 * 1024);
+	std::string obj = text.str();
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	std::vector<SubMesh> subMeshes;
+	std::vector<std::string> materialNames;
+	ObjLoader::Parse(obj.data(), obj.size(), verts, indices, subMeshes, materialNames, 1);
+	CHECK(indices.size() / 3 > 4 * 16384);
+
+	for (unsigned int threads : { 1u, 2u, 4u })
+	{
+		TangentDifference difference = Compare(verts, indices, threads);
+		CHECK_EQUAL(verts.size(), difference.compared);
+		CHECK_NEAR(0.0, difference.maxAngle, 0.01);
+		CHECK_EQUAL(0u, difference.handednessMismatches);
+	}
+}
+
+// Tangents are unit length, orthogonal to the normal, and flip w for mirrored UVs
+TEST(Tangents, FrameIsOrthonormalAndHanded)
+{
+	// Two triangles side by side in the XY plane, the second with its U mirrored
+	Vertex verts[6] = {};
+	const float positions[6][2] = { { 0, 0 }, { 0, 1 }, { 1, 0 }, { 2, 0 }, { 2, 1 }, { 3, 0 } };
+	const float uvs[6][2] = { { 0, 1 }, { 0, 0 }, { 1, 1 }, { 1, 1 }, { 1, 0 }, { 0, 1 } };
+	for (int v = 0; v < 6; v++)
+	{
+		verts[v].Position = DirectX::XMFLOAT3(positions[v][0], positions[v][1], 0.0f);
+		verts[v].Normal = DirectX::XMFLOAT3(0.0f, 0.0f, -1.0f);
+		verts[v].UV = DirectX::XMFLOAT2(uvs[v][0], uvs[v][1]);
+	}
+	const unsigned int indices[6] = { 0, 1, 2, 3, 4, 5 };
+	Tangents::Calculate(verts, 6, indices, 6);
+
+	for (int v = 0; v < 6; v++)
+	{
+		const DirectX::XMFLOAT4& t = verts[v].Tangent;
+		CHECK_NEAR(1.0, std::sqrt(t.x * t.x + t.y * t.y + t.z * t.z), 1e-5);
+		CHECK_NEAR(0.0, t.z, 1e-6);
+	}
+
+	// Mirroring U turns the tangent around and flips the handedness
+	CHECK_NEAR(1.0, verts[0].Tangent.x, 1e-5);
+	CHECK_NEAR(-1.0, verts[3].Tangent.x, 1e-5);
+	CHECK(verts[0].Tangent.w == -verts[3].Tangent.w);
+}
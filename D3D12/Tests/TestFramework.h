@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Just enough of a test framework to run the engine's
+// portable tests anywhere, with nothing to install
+//
+// TEST(Suite, Name) defines a test and registers it. The
+// CHECK macros record a failure (with file and line) and
+// carry on, so one run reports everything that's wrong.
+// EngineTests runs every test, or just one suite's when
+// given its name, which is how CTest runs them.
+// --------------------------------------------------------
+namespace TestFramework
+{
+	typedef void (*TestFunction)();
+
+	struct TestCase
+	{
+		const char* suite;
+		const char* name;
+		TestFunction function;
+	};
+
+	std::vector<TestCase>& Registry();
+	void Fail(const char* file, int line, const std::string& message);
+
+	struct Registrar
+	{
+		Registrar(const char* suite, const char* name, TestFunction function)
+		{
+			Registry().push_back({ suite, name, function });
+		}
+	};
+
+	// Where the repo's Assets folder is, for tests that load real files
+	std::wstring AssetPath(const char* relativePath);
+
+	// A file for a test to write to, in the system's temp folder
+	std::wstring TempPath(const char* fileName);
+}
+
+#define TEST(suite, name) \
+	static void suite##_##name(); \
+	static TestFramework::Registrar suite##_##name##_registrar(#suite, #name, suite##_##name); \
+	static void suite##_##name()
+
+#define CHECK(expression) \
+	do { if (!(expression)) TestFramework::Fail(__FILE__, __LINE__, #expression); } while (0)
+
+#define CHECK_EQUAL(expected, actual) \
+	do { if (!((expected) == (actual))) TestFramework::Fail(__FILE__, __LINE__, \
+		std::string(#actual " is ") + std::to_string(actual) + ", expected " + std::to_string(expected)); } while (0)
+
+#define CHECK_NEAR(expected, actual, tolerance) \
+	do { if (!(std::fabs((double)(expected) - (double)(actual)) <= (tolerance))) TestFramework::Fail(__FILE__, __LINE__, \
+		std::string(#actual " is ") + std::to_string(actual) + ", expected " + std::to_string(expected) + " +- " + std::to_string(tolerance)); } while (0)
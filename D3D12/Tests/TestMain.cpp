@@ -0,0 +1,66 @@
+#include "TestFramework.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	size_t failures = 0;
+}
+
+std::vector<TestFramework::TestCase>& TestFramework::Registry()
+{
+	static std::vector<TestCase> tests;
+	return tests;
+}
+
+void TestFramework::Fail(const char* file, int line, const std::string& message)
+{
+	printf("  %s(%d): %s\n", file, line, message.c_str());
+	failures++;
+}
+
+std::wstring TestFramework::AssetPath(const char* relativePath)
+{
+	return (std::filesystem::path(ASSET_DIRECTORY) / relativePath).wstring();
+}
+
+std::wstring TestFramework::TempPath(const char* fileName)
+{
+	return (std::filesystem::temp_directory_path() / fileName).wstring();
+}
+
+// --------------------------------------------------------
+// Runs every registered test, or only those of the suite
+// named on the command line. Returns nonzero if any failed.
+// --------------------------------------------------------
+int main(int argc, char** argv)
+{
+	const char* suite = argc > 1 ? argv[1] : 0;
+	size_t run = 0;
+	size_t failed = 0;
+	for (const TestFramework::TestCase& test : TestFramework::Registry())
+	{
+		if (suite && strcmp(suite, test.suite) != 0)
+			continue;
+
+		size_t failuresBefore = failures;
+		printf("%s.%s\n", test.suite, test.name);
+		test.function();
+		run++;
+		if (failures != failuresBefore)
+			failed++;
+	}
+
+	if (run == 0)
+	{
+		printf("No tests found%s%s\n", suite ? " in suite " : "", suite ? suite : "");
+		return 1;
+	}
+
+	printf("%zu of %zu tests passed\n", run - failed, run);
+	return failed > 0 ? 1 : 0;
+}
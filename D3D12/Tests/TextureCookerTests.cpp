@@ -0,0 +1,206 @@
+#include "TestFramework.h"
+#include "TextureCooker.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+using namespace TextureCooker;
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	const BlockFormat Formats[] = { BlockFormat::BC1, BlockFormat::BC4, BlockFormat::BC5, BlockFormat::BC7 };
+
+	// Channels each format keeps, which is what round trips are compared over
+	unsigned int Channels(BlockFormat format)
+	{
+		switch (format)
+		{
+		case BlockFormat::BC1: return 3;
+		case BlockFormat::BC4: return 1;
+		case BlockFormat::BC5: return 2;
+		default: return 4;
+		}
+	}
+
+	Image Solid(unsigned int width, unsigned int height, const unsigned char rgba[4])
+	{
+		Image image;
+		image.width = width;
+		image.height = height;
+		for (unsigned int i = 0; i < width * height; i++)
+			image.rgba.insert(image.rgba.end(), rgba, rgba + 4);
+		return image;
+	}
+
+	// Smooth ramps in each channel, the kind of content block compression handles well
+	Image Gradient(unsigned int size)
+	{
+		Image image;
+		image.width = size;
+		image.height = size;
+		for (unsigned int y = 0; y < size; y++)
+		{
+			for (unsigned int x = 0; x < size; x++)
+			{
+				image.rgba.push_back((unsigned char)(x * 255 / (size - 1)));
+				image.rgba.push_back((unsigned char)(y * 255 / (size - 1)));
+				image.rgba.push_back((unsigned char)((x + y) * 255 / (2 * size - 2)));
+				image.rgba.push_back(255);
+			}
+		}
+		return image;
+	}
+
+	Image RoundTrip(const Image& image, BlockFormat format)
+	{
+		std::vector<unsigned char> blocks;
+		CompressImage(image, format, blocks);
+		Image decoded;
+		DecompressImage(blocks.data(), format, image.width, image.height, decoded);
+		return decoded;
+	}
+
+	uint32_t ReadUint(const std::vector<char>& file, size_t offset)
+	{
+		uint32_t value = 0;
+		if (offset + 4 <= file.size())
+			memcpy(&value, &file[offset], 4);
+		return value;
+	}
+}
+
+// A block of one color comes back exactly, in every format, for colors each format can store
+TEST(TextureCooker, SolidBlocksRoundTrip)
+{
+	// BC1 stores colors as 5:6:5, so its colors are ones that expand back exactly
+	const unsigned char colors[][4] =
+	{
+		{ 0, 0, 0, 255 },
+		{ 255, 255, 255, 255 },
+		{ 255, 0, 0, 255 },
+		{ 181, 130, 66, 255 },
+	};
+
+	for (BlockFormat format : Formats)
+	{
+		for (const unsigned char* color : colors)
+		{
+			Image image = Solid(8, 8, color);
+			CHECK(Psnr(image, RoundTrip(image, format), Channels(format)) == HUGE_VAL);
+		}
+	}
+
+	// The single channel formats and BC7 hold any value
+	const unsigned char odd[4] = { 37, 201, 99, 173 };
+	Image image = Solid(4, 4, odd);
+	CHECK(Psnr(image, RoundTrip(image, BlockFormat::BC4), 1) == HUGE_VAL);
+	CHECK(Psnr(image, RoundTrip(image, BlockFormat::BC5), 2) == HUGE_VAL);
+	CHECK(Psnr(image, RoundTrip(image, BlockFormat::BC7), 4) == HUGE_VAL);
+}
+
+// Smooth gradients keep well above each format's quality floor
+TEST(TextureCooker, GradientsKeepQuality)
+{
+	Image image = Gradient(64);
+	const double floors[] = { 36.0, 45.0, 45.0, 38.0 };
+	for (size_t f = 0; f < 4; f++)
+	{
+		double psnr = Psnr(image, RoundTrip(image, Formats[f]), Channels(Formats[f]));
+		if (psnr < floors[f])
+			printf("  %s: %.2f dB\n", FormatName(Formats[f]), psnr);
+		CHECK(psnr >= floors[f]);
+	}
+
+	// Sizes that aren't whole blocks are cropped back to the image
+	Image odd;
+	odd.width = 10;
+	odd.height = 10;
+	for (unsigned int y = 0; y < 10; y++)
+		odd.rgba.insert(odd.rgba.end(), image.rgba.begin() + (size_t)y * 64 * 4, image.rgba.begin() + ((size_t)y * 64 + 10) * 4);
+	Image decoded = RoundTrip(odd, BlockFormat::BC7);
+	CHECK(decoded.width == 10 && decoded.height == 10);
+	CHECK(Psnr(odd, decoded, 4) >= floors[3]);
+}
+
+// A cooked file names its format and holds every mip, in the DX10 DDS layout
+TEST(TextureCooker, WritesDdsHeader)
+{
+	const uint32_t dxgiFormats[] = { 71, 80, 83, 98 };
+	std::wstring path = TestFramework::TempPath("EngineTestsCooked.dds");
+	for (size_t f = 0; f < 4; f++)
+	{
+		CookStats stats;
+		Image image = Gradient(64);
+		image.height = 32;
+		image.rgba.resize((size_t)64 * 32 * 4);
+		CHECK(CookTexture(image, TextureKind::Color, Formats[f], path, stats));
+		CHECK_EQUAL(7u, stats.mips);
+
+		std::ifstream in(std::filesystem::path(path), std::ios::binary);
+		std::vector<char> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		in.close();
+
+		CHECK_EQUAL(0x20534444u, ReadUint(file, 0));			// "DDS "
+		CHECK_EQUAL(124u, ReadUint(file, 4));
+		CHECK_EQUAL(32u, ReadUint(file, 12));					// Height
+		CHECK_EQUAL(64u, ReadUint(file, 16));					// Width
+		CHECK_EQUAL(7u, ReadUint(file, 28));					// Mips
+		CHECK_EQUAL(0x30315844u, ReadUint(file, 4 + 80));		// "DX10"
+		CHECK_EQUAL(dxgiFormats[f], ReadUint(file, 128));
+		CHECK_EQUAL(3u, ReadUint(file, 132));					// Texture 2D
+		CHECK_EQUAL(1u, ReadUint(file, 140));					// Array size
+
+		// Every mip is at least one whole block
+		unsigned int blockBytes = Formats[f] == BlockFormat::BC1 || Formats[f] == BlockFormat::BC4 ? 8 : 16;
+		size_t dataBytes = 0;
+		for (unsigned int w = 64, h = 32, m = 0; m < 7; m++, w = w > 1 ? w / 2 : 1, h = h > 1 ? h / 2 : 1)
+			dataBytes += (size_t)((w + 3) / 4) * ((h + 3) / 4) * blockBytes;
+		CHECK_EQUAL(ReadUint(file, 20), (64u / 4) * (32u / 4) * blockBytes);
+		CHECK_EQUAL(4 + 124 + 20 + dataBytes, file.size());
+		CHECK_EQUAL(dataBytes, stats.cookedBytes);
+	}
+	std::filesystem::remove(path);
+}
+
+// Colors are averaged in linear space, so black and white make a light gray, not 128
+TEST(TextureCooker, FiltersColorMipsInLinearSpace)
+{
+	Image checkerboard;
+	checkerboard.width = 4;
+	checkerboard.height = 4;
+	for (unsigned int y = 0; y < 4; y++)
+	{
+		for (unsigned int x = 0; x < 4; x++)
+		{
+			unsigned char value = (x + y) % 2 ? 255 : 0;
+			unsigned char pixel[4] = { value, value, value, value };
+			checkerboard.rgba.insert(checkerboard.rgba.end(), pixel, pixel + 4);
+		}
+	}
+
+	// With the shaders' gamma of 2.2, half way is 255 * 0.5^(1/2.2) = 186
+	// (the exact sRGB curve would give 188)
+	std::vector<Image> mips;
+	BuildMips(checkerboard, TextureKind::Color, mips);
+	CHECK_EQUAL(3u, mips.size());
+	for (size_t m = 1; m < mips.size(); m++)
+	{
+		for (size_t i = 0; i < mips[m].rgba.size(); i++)
+		{
+			if (i % 4 == 3)
+				CHECK_NEAR(128.0, mips[m].rgba[i], 1.0);	// Alpha is linear already
+			else
+				CHECK_NEAR(186.0, mips[m].rgba[i], 1.0);
+		}
+	}
+
+	// Masks and normals aren't colors, so they average as they are
+	BuildMips(checkerboard, TextureKind::Mask, mips);
+	CHECK_NEAR(128.0, mips[1].rgba[0], 1.0);
+}
@@ -0,0 +1,130 @@
+#include "TestFramework.h"
+#include "TextureStreamer.h"
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	const unsigned int Size = 256;
+	const unsigned int StartupMips = 3;	// 32x32 and down
+	const unsigned int MaxChanges = 4;
+
+	// Runs a frame's update and completes every change straight away
+	std::vector<TextureStreamChange> Update(TextureStreamer& streamer, unsigned long long frame)
+	{
+		std::vector<TextureStreamChange> changes;
+		streamer.Update(frame, MaxChanges, changes);
+		for (const TextureStreamChange& change : changes)
+			streamer.Complete(change.texture, change.firstMip);
+		return changes;
+	}
+
+	bool HasChange(const std::vector<TextureStreamChange>& changes, unsigned int texture, unsigned int firstMip, bool promotion)
+	{
+		for (const TextureStreamChange& change : changes)
+		{
+			if (change.texture == texture && change.firstMip == firstMip && change.promotion == promotion)
+				return true;
+		}
+		return false;
+	}
+
+	// Bytes of a texture's startup mips
+	unsigned long long StartupBytes()
+	{
+		TextureStreamer streamer(0, StartupMips, 100);
+		streamer.Add(Size, Size, 32);
+		return streamer.GetStats().residentBytes;
+	}
+
+	// Bytes a texture's full chain adds over its startup mips
+	unsigned long long FullDetailBytes()
+	{
+		TextureStreamer streamer(0, StartupMips, 100);
+		unsigned int texture = streamer.Add(Size, Size, 32);
+		streamer.Request(texture, 0, 1);
+		Update(streamer, 1);
+		return streamer.GetStats().residentBytes - StartupBytes();
+	}
+}
+
+// Over budget, the least recently requested textures drop back first, and this frame's requests keep their mips
+TEST(TextureStreamer, EvictsColdestFirst)
+{
+	unsigned long long full = FullDetailBytes();
+	CHECK(full > 0);
+
+	// Room for four textures' startup mips and two at full detail
+	unsigned long long budget = 4 * StartupBytes() + 2 * full;
+	TextureStreamer streamer(budget, StartupMips, 100);
+	unsigned int a = streamer.Add(Size, Size, 32);
+	unsigned int b = streamer.Add(Size, Size, 32);
+	unsigned int c = streamer.Add(Size, Size, 32);
+	unsigned int d = streamer.Add(Size, Size, 32);
+	unsigned int startupMip = streamer.GetStartupMip(a);
+	CHECK_EQUAL(6u, startupMip);
+
+	streamer.Request(a, 0, 1);
+	CHECK(HasChange(Update(streamer, 1), a, 0, true));
+	streamer.Request(b, 0, 2);
+	CHECK(HasChange(Update(streamer, 2), b, 0, true));
+	CHECK_EQUAL(budget, streamer.GetStats().residentBytes);
+	CHECK_EQUAL(0u, streamer.GetStats().evictions);
+
+	// C only fits if someone goes, and A was asked for longest ago
+	streamer.Request(c, 0, 3);
+	std::vector<TextureStreamChange> changes = Update(streamer, 3);
+	CHECK_EQUAL(2u, changes.size());
+	CHECK(HasChange(changes, a, startupMip, false));
+	CHECK(HasChange(changes, c, 0, true));
+	CHECK_EQUAL(1u, streamer.GetStats().evictions);
+	CHECK(streamer.GetStats().residentBytes <= budget);
+
+	// D pushes out B, not C, which is still wanted this frame
+	streamer.Request(c, 0, 4);
+	streamer.Request(d, 0, 4);
+	changes = Update(streamer, 4);
+	CHECK_EQUAL(2u, changes.size());
+	CHECK(HasChange(changes, b, startupMip, false));
+	CHECK(HasChange(changes, d, 0, true));
+	CHECK_EQUAL(2u, streamer.GetStats().evictions);
+	CHECK_EQUAL(2u, streamer.GetStats().texturesAtFullDetail);
+	CHECK(streamer.GetStats().residentBytes <= budget);
+
+	// Nothing changes while both keep being asked for
+	streamer.Request(c, 0, 5);
+	streamer.Request(d, 0, 5);
+	CHECK(Update(streamer, 5).empty());
+}
+
+// A request that can't fit whole gets as much detail as the budget allows
+TEST(TextureStreamer, DefersWhatDoesNotFit)
+{
+	unsigned long long budget = StartupBytes() + FullDetailBytes() / 2;
+	TextureStreamer streamer(budget, StartupMips, 100);
+	unsigned int texture = streamer.Add(Size, Size, 32);
+
+	streamer.Request(texture, 0, 1);
+	std::vector<TextureStreamChange> changes = Update(streamer, 1);
+	CHECK_EQUAL(1u, changes.size());
+	CHECK(HasChange(changes, texture, 1, true));
+	CHECK_EQUAL(1u, streamer.GetStats().deferred);
+	CHECK_EQUAL(0u, streamer.GetStats().texturesAtFullDetail);
+	CHECK(streamer.GetStats().residentBytes <= budget);
+}
+
+// Textures no one asks for drop back to their startup mips after the idle frames
+TEST(TextureStreamer, DropsIdleTextures)
+{
+	TextureStreamer streamer(0, StartupMips, 2);
+	unsigned int texture = streamer.Add(Size, Size, 32);
+	unsigned int startupMip = streamer.GetStartupMip(texture);
+	unsigned long long startupBytes = streamer.GetStats().residentBytes;
+
+	streamer.Request(texture, 2, 1);
+	CHECK(HasChange(Update(streamer, 1), texture, 2, true));
+	CHECK(Update(streamer, 3).empty());
+	CHECK(HasChange(Update(streamer, 4), texture, startupMip, false));
+	CHECK_EQUAL(startupBytes, streamer.GetStats().residentBytes);
+	CHECK_EQUAL(0u, streamer.GetStats().evictions);
+}
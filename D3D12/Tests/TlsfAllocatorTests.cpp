@@ -0,0 +1,156 @@
+#include "TestFramework.h"
+#include "TlsfAllocator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	struct Live
+	{
+		TlsfAllocation allocation;
+		unsigned long long size;
+		unsigned long long alignment;
+	};
+
+	// No two live allocations overlap, each keeps its alignment and is at least as
+	// big as asked, and the allocator's totals agree with what's actually live
+	bool Consistent(TlsfAllocator& allocator, const std::vector<Live>& live)
+	{
+		std::vector<Live> sorted = live;
+		std::sort(sorted.begin(), sorted.end(),
+			[](const Live& a, const Live& b) { return a.allocation.offset < b.allocation.offset; });
+
+		unsigned long long end = 0;
+		unsigned long long used = 0;
+		for (const Live& entry : sorted)
+		{
+			if (entry.allocation.offset < end ||
+				entry.allocation.offset % entry.alignment != 0 ||
+				entry.allocation.size < entry.size)
+				return false;
+
+			end = entry.allocation.offset + entry.allocation.size;
+			used += entry.allocation.size;
+		}
+
+		TlsfStats stats = allocator.GetStats();
+		return
+			end <= allocator.GetCapacity() &&
+			used == stats.usedBytes &&
+			live.size() == stats.allocations &&
+			stats.usedBytes + stats.freeBytes <= stats.capacity &&
+			stats.largestFree <= stats.freeBytes;
+	}
+}
+
+// A random GPU-heap-like workload never breaks any of the allocator's promises
+TEST(TlsfAllocator, RandomWorkloadStaysConsistent)
+{
+	const unsigned long long capacity = 64ull * 1024 * 1024;
+	const unsigned long long alignments[] = { 256, 4096, 64 * 1024 };
+	TlsfAllocator allocator(capacity);
+	std::vector<Live> live;
+	unsigned long long usedBytes = 0;
+
+	std::mt19937 random(99);
+	std::uniform_real_distribution<double> exponent(8.0, 21.0);
+	size_t checksFailed = 0;
+	size_t successes = 0;
+	for (unsigned int op = 0; op < 50000; op++)
+	{
+		bool allocate = live.empty() || random() % 100 < (usedBytes < capacity * 3 / 4 ? 60u : 40u);
+		if (allocate)
+		{
+			Live entry;
+			entry.size = (unsigned long long)std::pow(2.0, exponent(random)) + random() % 100;
+			entry.alignment = alignments[random() % 3];
+			if (allocator.Allocate(entry.size, entry.alignment, entry.allocation))
+			{
+				live.push_back(entry);
+				usedBytes += entry.allocation.size;
+				successes++;
+			}
+		}
+		else
+		{
+			size_t index = random() % live.size();
+			usedBytes -= live[index].allocation.size;
+			allocator.Free(live[index].allocation);
+			live[index] = live.back();
+			live.pop_back();
+		}
+
+		if (op % 250 == 249 && !Consistent(allocator, live))
+			checksFailed++;
+	}
+	CHECK_EQUAL(0u, checksFailed);
+	CHECK(successes > 10000);
+
+	// Everything freed merges back into a single range
+	for (const Live& entry : live)
+		allocator.Free(entry.allocation);
+	TlsfStats empty = allocator.GetStats();
+	CHECK(allocator.IsEmpty());
+	CHECK_EQUAL(1u, empty.freeRanges);
+	CHECK_EQUAL(capacity, empty.largestFree);
+	CHECK_EQUAL(0u, empty.usedBytes);
+}
+
+// Freeing merges a range with free neighbors on either side
+TEST(TlsfAllocator, CoalescesNeighbors)
+{
+	TlsfAllocator allocator(1024 * 1024);
+	TlsfAllocation a, b, c, d;
+	CHECK(allocator.Allocate(1000, 256, a));
+	CHECK(allocator.Allocate(1000, 256, b));
+	CHECK(allocator.Allocate(1000, 256, c));
+	CHECK(allocator.Allocate(1000, 256, d));
+
+	// a and c freed: two holes, plus the tail after d
+	allocator.Free(a);
+	allocator.Free(c);
+	CHECK_EQUAL(3u, allocator.GetStats().freeRanges);
+
+	// Freeing b joins a, b and c into one hole
+	allocator.Free(b);
+	TlsfStats stats = allocator.GetStats();
+	CHECK_EQUAL(2u, stats.freeRanges);
+	CHECK(stats.largestFree >= 1024 * 1024 - d.offset - d.size);
+
+	// And d joins that hole with the tail
+	allocator.Free(d);
+	stats = allocator.GetStats();
+	CHECK_EQUAL(1u, stats.freeRanges);
+	CHECK_EQUAL(1024u * 1024u, stats.largestFree);
+	CHECK_NEAR(0.0, stats.Fragmentation(), 0.0);
+}
+
+// Holes get reused, alignment is honored, and a full heap says so
+TEST(TlsfAllocator, ReusesHolesAndFailsWhenFull)
+{
+	TlsfAllocator allocator(64 * 1024);
+	TlsfAllocation first, second, third;
+	CHECK(allocator.Allocate(16 * 1024, 256, first));
+	CHECK(allocator.Allocate(16 * 1024, 256, second));
+	allocator.Free(first);
+
+	// A fitting request lands in the hole at the front
+	CHECK(allocator.Allocate(8 * 1024, 4096, third));
+	CHECK_EQUAL(0u, third.offset);
+
+	TlsfAllocation aligned;
+	CHECK(allocator.Allocate(100, 16 * 1024, aligned));
+	CHECK_EQUAL(0u, aligned.offset % (16 * 1024));
+
+	TlsfAllocation tooBig;
+	CHECK(!allocator.Allocate(64 * 1024, 256, tooBig));
+
+	allocator.Reset(64 * 1024);
+	CHECK(allocator.IsEmpty());
+	CHECK(allocator.Allocate(64 * 1024, 256, tooBig));
+	CHECK_EQUAL(0u, tooBig.offset);
+}
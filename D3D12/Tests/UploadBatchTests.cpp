@@ -0,0 +1,317 @@
+#include "TestFramework.h"
+#include "UploadBatch.h"
+
+#include <cstring>
+#include <map>
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	struct FakeBuffer
+	{
+		std::vector<unsigned char> bytes;
+	};
+
+	// Subresources of width x height 4-byte texels, one after another
+	struct FakeTexture
+	{
+		unsigned int width;
+		unsigned int height;
+		std::vector<std::vector<unsigned char>> subresources;
+	};
+
+	// --------------------------------------------------------
+	// A GPU that only runs copies once their fence completes,
+	// reading staging memory at that point, so a batch that
+	// reuses staging space too early uploads the wrong bytes
+	// --------------------------------------------------------
+	class FakeUploadDevice : public UploadDevice
+	{
+	public:
+
+		unsigned long long completed = 0;
+		unsigned long long signalled = 0;
+		size_t stagingCreations = 0;
+		size_t waits = 0;
+
+		void* CreateStaging(size_t capacity) override
+		{
+			staging.assign(capacity, 0xCD);
+			stagingCreations++;
+			return staging.data();
+		}
+
+		void CopyBuffer(void* destination, size_t destinationOffset, size_t stagingOffset, size_t size) override
+		{
+			Copy copy = {};
+			copy.buffer = (FakeBuffer*)destination;
+			copy.destinationOffset = destinationOffset;
+			copy.stagingOffset = stagingOffset;
+			copy.size = size;
+			recording.push_back(copy);
+		}
+
+		unsigned long long GetTextureFootprints(void* texture, unsigned int firstSubresource,
+			unsigned int subresourceCount, UploadFootprint* footprints) override
+		{
+			FakeTexture* fake = (FakeTexture*)texture;
+			unsigned long long offset = 0;
+			for (unsigned int i = 0; i < subresourceCount; i++)
+			{
+				// Rows padded to 256 bytes and subresources to 512, like D3D12
+				footprints[i].offset = offset;
+				footprints[i].rowSize = fake->width * 4ull;
+				footprints[i].rowPitch = (fake->width * 4 + 255) / 256 * 256;
+				footprints[i].rowCount = fake->height;
+				footprints[i].depth = 1;
+				offset = (offset + (unsigned long long)footprints[i].rowPitch * fake->height + 511) / 512 * 512;
+			}
+			return offset;
+		}
+
+		void CopyTexture(void* texture, unsigned int subresource, size_t stagingOffset, const UploadFootprint& footprint) override
+		{
+			Copy copy = {};
+			copy.texture = (FakeTexture*)texture;
+			copy.subresource = subresource;
+			copy.stagingOffset = stagingOffset;
+			copy.footprint = footprint;
+			recording.push_back(copy);
+		}
+
+		unsigned long long Execute() override
+		{
+			signalled++;
+			submitted[signalled] = recording;
+			recording.clear();
+			return signalled;
+		}
+
+		unsigned long long GetCompletedValue() override
+		{
+			return completed;
+		}
+
+		void WaitForValue(unsigned long long fenceValue) override
+		{
+			waits++;
+			Complete(fenceValue);
+		}
+
+		// Lets the GPU catch up to the given fence value
+		void Complete(unsigned long long fenceValue)
+		{
+			while (completed < fenceValue && completed < signalled)
+			{
+				completed++;
+				for (const Copy& copy : submitted[completed])
+					Run(copy);
+				submitted.erase(completed);
+			}
+		}
+
+	private:
+
+		struct Copy
+		{
+			FakeBuffer* buffer;
+			size_t destinationOffset;
+			FakeTexture* texture;
+			unsigned int subresource;
+			size_t stagingOffset;
+			size_t size;
+			UploadFootprint footprint;
+		};
+
+		std::vector<unsigned char> staging;
+		std::vector<Copy> recording;
+		std::map<unsigned long long, std::vector<Copy>> submitted;
+
+		void Run(const Copy& copy)
+		{
+			if (copy.buffer)
+			{
+				memcpy(copy.buffer->bytes.data() + copy.destinationOffset, staging.data() + copy.stagingOffset, copy.size);
+				return;
+			}
+
+			std::vector<unsigned char>& texels = copy.texture->subresources[copy.subresource];
+			for (unsigned int row = 0; row < copy.footprint.rowCount; row++)
+			{
+				memcpy(texels.data() + row * copy.footprint.rowSize,
+					staging.data() + copy.stagingOffset + (size_t)row * copy.footprint.rowPitch,
+					(size_t)copy.footprint.rowSize);
+			}
+		}
+	};
+
+	std::vector<unsigned char> Pattern(size_t size, unsigned int seed)
+	{
+		std::vector<unsigned char> bytes(size);
+		for (size_t i = 0; i < size; i++)
+			bytes[i] = (unsigned char)((i * 31 + seed * 17 + (i >> 8)) & 0xFF);
+		return bytes;
+	}
+}
+
+TEST(UploadRing, AllocatesRetiresAndNeverWraps)
+{
+	UploadRing ring(1024);
+	size_t a = 0, b = 0, c = 0;
+	CHECK(ring.Allocate(400, 16, a));
+	CHECK(ring.Allocate(400, 16, b));
+	CHECK_EQUAL(0u, a);
+	CHECK_EQUAL(400u, b);
+
+	// 300 more bytes would run past the end, and the front is still in use
+	CHECK(!ring.Allocate(300, 16, c));
+	ring.Close(1);
+	CHECK_EQUAL(1u, ring.GetOldestFence());
+	ring.Retire(0);
+	CHECK(!ring.Allocate(300, 16, c));
+
+	// Once the GPU is done it all comes back, starting from the front
+	ring.Retire(1);
+	CHECK_EQUAL(0u, ring.GetOldestFence());
+	CHECK(ring.Allocate(300, 16, c));
+	CHECK_EQUAL(0u, c);
+	CHECK(!ring.Allocate(2048, 16, c));
+}
+
+TEST(UploadRing, SkipsToTheFrontRatherThanSplitting)
+{
+	UploadRing ring(1024);
+	size_t offset = 0;
+	CHECK(ring.Allocate(600, 16, offset));
+	ring.Close(1);
+	CHECK(ring.Allocate(100, 16, offset));
+	ring.Close(2);
+	ring.Retire(1);
+
+	// 400 bytes don't fit before the end, so they go at the freed front
+	CHECK(ring.Allocate(400, 16, offset));
+	CHECK_EQUAL(0u, offset);
+	CHECK(ring.GetUsed() <= ring.GetCapacity());
+}
+
+// Many small uploads go to the GPU as one submission
+TEST(UploadBatch, BatchesIntoOneSubmit)
+{
+	FakeUploadDevice device;
+	std::vector<FakeBuffer> buffers(50);
+	{
+		UploadBatch batch(&device, 64 * 1024);
+		for (size_t i = 0; i < buffers.size(); i++)
+		{
+			buffers[i].bytes.assign(256 + i * 8, 0);
+			std::vector<unsigned char> data = Pattern(buffers[i].bytes.size(), (unsigned int)i);
+			batch.UploadBuffer(&buffers[i], data.data(), data.size());
+		}
+		CHECK(batch.HasPendingCopies());
+
+		UploadTicket ticket = batch.Submit();
+		CHECK(!batch.IsComplete(ticket));
+		device.Complete(ticket.fenceValue);
+		CHECK(batch.IsComplete(ticket));
+
+		UploadStats stats = batch.GetStats();
+		CHECK_EQUAL(1u, stats.submits);
+		CHECK_EQUAL(50u, stats.copies);
+		CHECK_EQUAL(0u, stats.stalls);
+	}
+
+	for (size_t i = 0; i < buffers.size(); i++)
+		CHECK(buffers[i].bytes == Pattern(buffers[i].bytes.size(), (unsigned int)i));
+}
+
+// A full ring waits for the GPU instead of overwriting staging it hasn't read yet
+TEST(UploadBatch, WaitsForStagingSpace)
+{
+	FakeUploadDevice device;
+	std::vector<FakeBuffer> buffers(40);
+	{
+		UploadBatch batch(&device, 4096);
+		for (size_t i = 0; i < buffers.size(); i++)
+		{
+			buffers[i].bytes.assign(900, 0);
+			std::vector<unsigned char> data = Pattern(900, (unsigned int)i);
+			batch.UploadBuffer(&buffers[i], data.data(), data.size());
+		}
+		batch.WaitForIdle();
+
+		UploadStats stats = batch.GetStats();
+		CHECK(stats.stalls > 0);
+		CHECK(stats.submits > 1);
+		CHECK(device.waits > 0);
+		CHECK_EQUAL(1u, device.stagingCreations);
+	}
+
+	for (size_t i = 0; i < buffers.size(); i++)
+		CHECK(buffers[i].bytes == Pattern(900, (unsigned int)i));
+}
+
+// Buffers bigger than the ring go up in pieces, and don't grow it
+TEST(UploadBatch, SplitsLargeBuffers)
+{
+	FakeUploadDevice device;
+	FakeBuffer buffer;
+	buffer.bytes.assign(100000, 0);
+	std::vector<unsigned char> data = Pattern(buffer.bytes.size(), 7);
+	{
+		UploadBatch batch(&device, 8192);
+		batch.UploadBuffer(&buffer, data.data(), data.size());
+		batch.WaitForIdle();
+		CHECK(batch.GetStats().copies >= 100000 / 2048);
+	}
+
+	CHECK(buffer.bytes == data);
+	CHECK_EQUAL(1u, device.stagingCreations);
+}
+
+// Texture rows land at the device's padded pitch, and come back out unpadded
+TEST(UploadBatch, UploadsPaddedTextureRows)
+{
+	FakeUploadDevice device;
+	FakeTexture texture;
+	texture.width = 37;
+	texture.height = 11;
+	texture.subresources.assign(3, std::vector<unsigned char>(37 * 4 * 11, 0));
+
+	std::vector<std::vector<unsigned char>> sources;
+	std::vector<UploadSubresource> subresources;
+	for (unsigned int i = 0; i < 3; i++)
+		sources.push_back(Pattern(37 * 4 * 11, 100 + i));
+	for (unsigned int i = 0; i < 3; i++)
+		subresources.push_back({ sources[i].data(), 37 * 4, 37 * 4 * 11 });
+
+	{
+		UploadBatch batch(&device, 4096);
+		batch.UploadTexture(&texture, subresources.data(), 3);
+		batch.WaitForIdle();
+	}
+
+	for (unsigned int i = 0; i < 3; i++)
+		CHECK(texture.subresources[i] == sources[i]);
+}
+
+// A texture bigger than the whole ring gets a bigger ring
+TEST(UploadBatch, GrowsForOversizedTextures)
+{
+	FakeUploadDevice device;
+	FakeTexture texture;
+	texture.width = 64;
+	texture.height = 64;
+	texture.subresources.assign(1, std::vector<unsigned char>(64 * 64 * 4, 0));
+	std::vector<unsigned char> source = Pattern(64 * 64 * 4, 3);
+	UploadSubresource subresource = { source.data(), 64 * 4, 64 * 64 * 4 };
+
+	{
+		UploadBatch batch(&device, 4096);
+		batch.UploadTexture(&texture, &subresource, 1);
+		batch.WaitForIdle();
+	}
+
+	CHECK(texture.subresources[0] == source);
+	CHECK_EQUAL(2u, device.stagingCreations);
+}
@@ -0,0 +1,202 @@
+#include "TestFramework.h"
+#include "MeshCache.h"
+#include "ObjLoader.h"
+#include "Tangents.h"
+#include "VertexPacking.h"
+
+#include <cfloat>
+#include <cstring>
+#include <filesystem>
+
+using namespace DirectX;
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	double AngleDegrees(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		double cx = (double)a.y * b.z - (double)a.z * b.y;
+		double cy = (double)a.z * b.x - (double)a.x * b.z;
+		double cz = (double)a.x * b.y - (double)a.y * b.x;
+		double dot = (double)a.x * b.x + (double)a.y * b.y + (double)a.z * b.z;
+		return std::atan2(std::sqrt(cx * cx + cy * cy + cz * cz), dot) * 57.29577951308232;
+	}
+
+	// Small deterministic generator, so failures can be reproduced
+	struct Random
+	{
+		unsigned int state = 12345;
+		float Next(float low, float high)
+		{
+			state = state * 1664525u + 1013904223u;
+			return low + (high - low) * (float)(state >> 8) / 16777216.0f;
+		}
+	};
+
+	bool LoadWithTangents(const char* mesh, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+	{
+		std::vector<SubMesh> subMeshes;
+		std::vector<std::string> materialNames;
+		std::wstring path = TestFramework::AssetPath((std::string("Basic Meshes/") + mesh).c_str());
+		if (!ObjLoader::LoadFile(path.c_str(), verts, indices, subMeshes, materialNames) || indices.empty())
+			return false;
+
+		Tangents::Calculate(verts.data(), verts.size(), indices.data(), indices.size());
+		return true;
+	}
+
+	void BoundsOf(const std::vector<Vertex>& verts, XMFLOAT3& boundsMin, XMFLOAT3& boundsMax)
+	{
+		boundsMin = boundsMax = verts[0].Position;
+		for (const Vertex& v : verts)
+		{
+			boundsMin = XMFLOAT3(fminf(boundsMin.x, v.Position.x), fminf(boundsMin.y, v.Position.y), fminf(boundsMin.z, v.Position.z));
+			boundsMax = XMFLOAT3(fmaxf(boundsMax.x, v.Position.x), fmaxf(boundsMax.y, v.Position.y), fmaxf(boundsMax.z, v.Position.z));
+		}
+	}
+}
+
+// Every attribute of every asset stays within the bounds VertexPacking.h promises
+TEST(VertexPacking, AssetsStayWithinErrorBounds)
+{
+	const char* meshes[] = { "cube.obj", "cylinder.obj", "helix.obj", "sphere.obj", "torus.obj" };
+	for (const char* mesh : meshes)
+	{
+		std::vector<Vertex> verts;
+		std::vector<unsigned int> indices;
+		CHECK(LoadWithTangents(mesh, verts, indices));
+		if (verts.empty())
+			continue;
+
+		XMFLOAT3 boundsMin, boundsMax;
+		BoundsOf(verts, boundsMin, boundsMax);
+		PackingError error = VertexPacking::MeasureError(verts.data(), verts.size(), VertexPacking::ComputeQuantization(boundsMin, boundsMax));
+
+		CHECK(error.position <= error.positionBound);
+		CHECK(error.normalDegrees < 0.01f);
+		CHECK(error.tangentDegrees < 0.01f);
+		CHECK(error.uvRelative <= 1.0f / 2048.0f);
+		CHECK_EQUAL(0u, error.signMismatches);
+	}
+}
+
+TEST(VertexPacking, PositionsLandWithinHalfAStep)
+{
+	PositionQuantization quantization = VertexPacking::ComputeQuantization(XMFLOAT3(-3, 0, 10), XMFLOAT3(5, 0.001f, 1000));
+	Random random;
+	for (int i = 0; i < 10000; i++)
+	{
+		Vertex v = {};
+		v.Position = XMFLOAT3(random.Next(-3, 5), random.Next(0, 0.001f), random.Next(10, 1000));
+		Vertex decoded = VertexPacking::Decode(VertexPacking::Encode(v, quantization), quantization);
+
+		// Half a step of the box on each axis, plus float rounding
+		CHECK_NEAR(v.Position.x, decoded.Position.x, 8.0 / 65535 * 0.5 + 8 * FLT_EPSILON);
+		CHECK_NEAR(v.Position.y, decoded.Position.y, 0.001 / 65535 * 0.5 + 0.001 * FLT_EPSILON);
+		CHECK_NEAR(v.Position.z, decoded.Position.z, 990.0 / 65535 * 0.5 + 1000 * FLT_EPSILON);
+	}
+
+	// The corners of the box come back exactly
+	Vertex corner = {};
+	corner.Position = XMFLOAT3(-3, 0, 10);
+	CHECK_NEAR(-3.0, VertexPacking::Decode(VertexPacking::Encode(corner, quantization), quantization).Position.x, 0.0);
+}
+
+TEST(VertexPacking, OctahedralDirectionsWithinBound)
+{
+	Random random;
+	double worst = 0.0;
+	for (int i = 0; i < 100000; i++)
+	{
+		XMFLOAT3 direction(random.Next(-1, 1), random.Next(-1, 1), random.Next(-1, 1));
+		if (direction.x * direction.x + direction.y * direction.y + direction.z * direction.z < 1e-6f)
+			continue;
+
+		short x, y;
+		VertexPacking::OctEncode(direction, x, y);
+		double angle = AngleDegrees(direction, VertexPacking::OctDecode(x, y));
+		if (angle > worst)
+			worst = angle;
+	}
+	CHECK(worst < 0.01);
+
+	// The axes, including the folded-over lower half, are exact
+	const XMFLOAT3 axes[] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+	for (const XMFLOAT3& axis : axes)
+	{
+		short x, y;
+		VertexPacking::OctEncode(axis, x, y);
+		CHECK_NEAR(0.0, AngleDegrees(axis, VertexPacking::OctDecode(x, y)), 1e-6);
+	}
+}
+
+// Every finite half survives a trip through float, and floats round to nearest even
+TEST(VertexPacking, HalfFloatConversion)
+{
+	size_t mismatches = 0;
+	for (unsigned int half = 0; half < 0x10000; half++)
+	{
+		if ((half & 0x7C00) == 0x7C00)
+			continue;
+		if (VertexPacking::FloatToHalf(VertexPacking::HalfToFloat((unsigned short)half)) != half)
+			mismatches++;
+	}
+	CHECK_EQUAL(0u, mismatches);
+
+	CHECK_EQUAL(0x3C00, VertexPacking::FloatToHalf(1.0f));
+	CHECK_EQUAL(0xC000, VertexPacking::FloatToHalf(-2.0f));
+	CHECK_EQUAL(0x7BFF, VertexPacking::FloatToHalf(65504.0f));
+	CHECK_EQUAL(0x7C00, VertexPacking::FloatToHalf(1e6f));
+	CHECK_EQUAL(0x0001, VertexPacking::FloatToHalf(5.9604645e-8f));
+	CHECK_EQUAL(0x3C00, VertexPacking::FloatToHalf(1.0f + 1.0f / 2048.0f));			// Tie, rounds down to even
+	CHECK_EQUAL(0x3C02, VertexPacking::FloatToHalf(1.0f + 3.0f / 2048.0f));			// Tie, rounds up to even
+	CHECK(std::isnan(VertexPacking::HalfToFloat(VertexPacking::FloatToHalf(NAN))));
+
+	Random random;
+	for (int i = 0; i < 10000; i++)
+	{
+		float value = random.Next(-4.0f, 4.0f);
+		float roundTrip = VertexPacking::HalfToFloat(VertexPacking::FloatToHalf(value));
+		CHECK_NEAR(value, roundTrip, (std::fabs(value) > 1.0f ? std::fabs(value) : 1.0f) / 2048.0f);
+	}
+}
+
+// The cache holds vertices already packed, along with what unpacks them
+TEST(MeshCache, StoresPackedVertices)
+{
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	CHECK(LoadWithTangents("torus.obj", verts, indices));
+	if (verts.empty())
+		return;
+
+	XMFLOAT3 boundsMin, boundsMax;
+	BoundsOf(verts, boundsMin, boundsMax);
+	PositionQuantization quantization = VertexPacking::ComputeQuantization(boundsMin, boundsMax);
+	std::vector<PackedVertex> packed(verts.size());
+	VertexPacking::EncodeAll(verts.data(), verts.size(), quantization, packed.data());
+
+	MeshLod lod = { 0, (unsigned int)indices.size(), 0.0f };
+	SubMesh subMesh = { 0, (unsigned int)indices.size(), 0, 1, 0, 0, 0 };
+	std::vector<std::string> materialNames(1, "M_Torus");
+	std::wstring cachePath = TestFramework::TempPath("EngineTestsTorus.mesh");
+	CHECK(MeshCache::Write(cachePath.c_str(), 42, 1234, packed.data(), (unsigned int)packed.size(), quantization,
+		indices.data(), (unsigned int)indices.size(), &lod, 1, MeshletData(), &subMesh, 1, materialNames,
+		boundsMin, boundsMax, 1.0f));
+
+	MappedFile cacheFile;
+	MeshCache::View view;
+	CHECK(!MeshCache::Open(cachePath.c_str(), 43, 1234, cacheFile, view));
+	CHECK(MeshCache::Open(cachePath.c_str(), 42, 1234, cacheFile, view));
+	if (!cacheFile.IsOpen())
+		return;
+
+	CHECK_EQUAL(packed.size(), view.vertexCount);
+	CHECK(memcmp(view.vertices, packed.data(), packed.size() * sizeof(PackedVertex)) == 0);
+	CHECK(memcmp(&view.quantization, &quantization, sizeof(quantization)) == 0);
+	CHECK_EQUAL(indices.size(), view.indexCount);
+	CHECK(view.materialNames == materialNames);
+	cacheFile.Close();
+	std::filesystem::remove(cachePath);
+}
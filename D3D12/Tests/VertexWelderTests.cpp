@@ -0,0 +1,130 @@
+#include "TestFramework.h"
+#include "ObjLoader.h"
+#include "VertexWelder.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	const float Epsilon = 0.001f;
+
+	// A unit quad as two triangles. The diagonal's corners are written twice,
+	// offset by the given amount, so only a distance weld can share them.
+	std::string SplitQuad(float offset)
+	{
+		char text[512];
+		snprintf(text, sizeof(text),
+			"v 0 0 0\nv 1 0 0\nv 1 1 0\nv %g %g 0\nv 0 1 0\nv %g 0 0\n"
+			"vt 0 0\nvn 0 0 1\n"
+			"f 1/1/1 2/1/1 3/1/1\nf 4/1/1 5/1/1 6/1/1\n",
+			1.0f + offset, 1.0f + offset, offset);
+		return text;
+	}
+
+	// Loads text through a file, as the game does, so the weld epsilon applies
+	bool Load(const std::string& text, float weldEpsilon, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+	{
+		std::wstring file = TestFramework::TempPath("VertexWelderTest.obj");
+		{
+			std::ofstream out(std::filesystem::path(file), std::ios::binary | std::ios::trunc);
+			out << text;
+		}
+
+		std::vector<SubMesh> subMeshes;
+		std::vector<std::string> materialNames;
+		bool loaded = ObjLoader::LoadFile(file.c_str(), verts, indices, subMeshes, materialNames, weldEpsilon);
+		std::filesystem::remove(std::filesystem::path(file));
+		return loaded;
+	}
+
+	Vertex MakeVertex(float x, float y, float u, float nz)
+	{
+		Vertex v = {};
+		v.Position = DirectX::XMFLOAT3(x, y, 0);
+		v.Normal = DirectX::XMFLOAT3(0, 0, nz);
+		v.UV = DirectX::XMFLOAT2(u, 0);
+		return v;
+	}
+}
+
+// Corners with the same v/vt/vn triple share one vertex without any epsilon
+TEST(VertexWelder, WeldsExactCorners)
+{
+	std::string quad =
+		"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nvt 0 0\nvn 0 0 1\n"
+		"f 1/1/1 2/1/1 3/1/1\nf 3/1/1 4/1/1 1/1/1\n";
+
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	CHECK(Load(quad, 0.0f, verts, indices));
+	CHECK_EQUAL(6u, indices.size());
+	CHECK_EQUAL(4u, verts.size());
+
+	// The triangles share the diagonal's two corners
+	size_t shared = 0;
+	for (size_t i = 0; i < 3 && indices.size() == 6; i++)
+	{
+		for (size_t j = 3; j < 6; j++)
+		{
+			if (indices[i] == indices[j])
+				shared++;
+		}
+	}
+	CHECK_EQUAL(2u, shared);
+}
+
+// Corners half an epsilon apart merge only when welding by distance
+TEST(VertexWelder, WeldsWithinEpsilon)
+{
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	CHECK(Load(SplitQuad(Epsilon / 2), 0.0f, verts, indices));
+	CHECK_EQUAL(6u, verts.size());
+
+	CHECK(Load(SplitQuad(Epsilon / 2), Epsilon, verts, indices));
+	CHECK_EQUAL(4u, verts.size());
+	CHECK_EQUAL(6u, indices.size());
+	for (unsigned int index : indices)
+		CHECK(index < verts.size());
+
+	// Further apart than epsilon, they stay separate
+	CHECK(Load(SplitQuad(Epsilon * 2), Epsilon, verts, indices));
+	CHECK_EQUAL(6u, verts.size());
+}
+
+// The same position with a different uv or normal is a seam, and keeps both vertices
+TEST(VertexWelder, KeepsSeams)
+{
+	std::vector<Vertex> verts =
+	{
+		MakeVertex(0, 0, 0.0f, 1.0f), MakeVertex(1, 0, 0.0f, 1.0f), MakeVertex(0, 1, 0.0f, 1.0f),
+		MakeVertex(0, 0, 0.5f, 1.0f), MakeVertex(1, 0, 0.0f, -1.0f), MakeVertex(0, 1, Epsilon / 2, 1.0f),
+	};
+	std::vector<unsigned int> indices = { 0, 1, 2, 3, 4, 5 };
+
+	WeldStats stats = VertexWelder::WeldByDistance(verts, indices, Epsilon);
+	CHECK_EQUAL(6u, stats.verticesBefore);
+	CHECK_EQUAL(5u, stats.verticesAfter);
+	CHECK_EQUAL(5u, verts.size());
+	CHECK_EQUAL(6u, indices.size());
+	CHECK(indices.size() == 6 && indices[5] == indices[2] && indices[3] != indices[0] && indices[4] != indices[1]);
+}
+
+// Triangles that collapse to a line once welded are dropped
+TEST(VertexWelder, DropsCollapsedTriangles)
+{
+	std::vector<Vertex> verts =
+	{
+		MakeVertex(0, 0, 0, 1), MakeVertex(1, 0, 0, 1), MakeVertex(0, 1, 0, 1),
+		MakeVertex(0, 0, 0, 1), MakeVertex(Epsilon / 2, 0, 0, 1), MakeVertex(1, 1, 0, 1),
+	};
+	std::vector<unsigned int> indices = { 0, 1, 2, 3, 4, 5 };
+
+	VertexWelder::WeldByDistance(verts, indices, Epsilon);
+	CHECK_EQUAL(3u, indices.size());
+	CHECK_EQUAL(4u, verts.size());
+}
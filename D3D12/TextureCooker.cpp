@@ -0,0 +1,1389 @@
+#include "TextureCooker.h"
+#include "Parallel.h"
+
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cwctype>
+#include <fstream>
+#include <string>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <wincodec.h>
+#include <wrl/client.h>
+#endif
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// The shaders gamma decode albedo with pow(c, 2.2), so mips
+	// are filtered in that same space
+	const float Gamma = 2.2f;
+
+	unsigned int BlockBytes(TextureCooker::BlockFormat format)
+	{
+		return format == TextureCooker::BlockFormat::BC1 || format == TextureCooker::BlockFormat::BC4 ? 8 : 16;
+	}
+
+	unsigned char ToByte(float value)
+	{
+		value = value * 255.0f + 0.5f;
+		return value <= 0.0f ? 0 : value >= 255.0f ? 255 : (unsigned char)value;
+	}
+
+	// A 4x4 block of pixels, repeating the last row or column
+	// of images (or small mips) that don't fill it
+	void ReadBlock(const TextureCooker::Image& image, unsigned int blockX, unsigned int blockY, unsigned char pixels[16][4])
+	{
+		for (unsigned int y = 0; y < 4; y++)
+		{
+			unsigned int sourceY = blockY * 4 + y < image.height ? blockY * 4 + y : image.height - 1;
+			for (unsigned int x = 0; x < 4; x++)
+			{
+				unsigned int sourceX = blockX * 4 + x < image.width ? blockX * 4 + x : image.width - 1;
+				memcpy(pixels[y * 4 + x], &image.rgba[((size_t)sourceY * image.width + sourceX) * 4], 4);
+			}
+		}
+	}
+
+	void WriteBlock(TextureCooker::Image& image, unsigned int blockX, unsigned int blockY, const unsigned char pixels[16][4])
+	{
+		for (unsigned int y = 0; y < 4 && blockY * 4 + y < image.height; y++)
+		{
+			for (unsigned int x = 0; x < 4 && blockX * 4 + x < image.width; x++)
+				memcpy(&image.rgba[((size_t)(blockY * 4 + y) * image.width + blockX * 4 + x) * 4], pixels[y * 4 + x], 4);
+		}
+	}
+
+	// --------------------------------------------------------
+	// Mean and main direction of a block's values, which is
+	// the line its endpoints are first fit along. A flat block
+	// gets a zero axis.
+	// --------------------------------------------------------
+	void PrincipalAxis(const float points[16][4], unsigned int channels, float mean[4], float axis[4])
+	{
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			mean[c] = 0.0f;
+			axis[c] = 0.0f;
+		}
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			for (unsigned int c = 0; c < channels; c++)
+				mean[c] += points[i][c] / 16.0f;
+		}
+
+		float covariance[4][4] = {};
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			for (unsigned int a = 0; a < channels; a++)
+			{
+				for (unsigned int b = 0; b < channels; b++)
+					covariance[a][b] += (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+			}
+		}
+
+		// Power iteration, starting from the channel that varies most
+		unsigned int widest = 0;
+		for (unsigned int c = 1; c < channels; c++)
+		{
+			if (covariance[c][c] > covariance[widest][widest])
+				widest = c;
+		}
+		if (covariance[widest][widest] <= 0.0f)
+			return;
+
+		for (unsigned int c = 0; c < channels; c++)
+			axis[c] = covariance[widest][c];
+
+		for (unsigned int iteration = 0; iteration < 8; iteration++)
+		{
+			float next[4] = {};
+			float length = 0.0f;
+			for (unsigned int a = 0; a < channels; a++)
+			{
+				for (unsigned int b = 0; b < channels; b++)
+					next[a] += covariance[a][b] * axis[b];
+				length += next[a] * next[a];
+			}
+			if (length <= 0.0f)
+				break;
+
+			length = std::sqrt(length);
+			for (unsigned int c = 0; c < channels; c++)
+				axis[c] = next[c] / length;
+		}
+	}
+
+	// The ends of the principal axis that just cover every point
+	void AxisEndpoints(const float points[16][4], unsigned int channels, float low[4], float high[4])
+	{
+		float mean[4];
+		float axis[4];
+		PrincipalAxis(points, channels, mean, axis);
+
+		float minT = 0.0f;
+		float maxT = 0.0f;
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			float t = 0.0f;
+			for (unsigned int c = 0; c < channels; c++)
+				t += (points[i][c] - mean[c]) * axis[c];
+			minT = t < minT ? t : minT;
+			maxT = t > maxT ? t : maxT;
+		}
+
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			low[c] = mean[c] + axis[c] * minT;
+			high[c] = mean[c] + axis[c] * maxT;
+		}
+	}
+
+	// --------------------------------------------------------
+	// Best endpoints (in the least squares sense) for points
+	// that each sit weights[i] of the way from low to high.
+	// Returns false if the weights can't pin them down.
+	// --------------------------------------------------------
+	bool LeastSquaresEndpoints(const float points[16][4], const float weights[16], unsigned int channels, float low[4], float high[4])
+	{
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[4] = {};
+		float bx[4] = {};
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			float a = 1.0f - weights[i];
+			float b = weights[i];
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (unsigned int c = 0; c < channels; c++)
+			{
+				ax[c] += a * points[i][c];
+				bx[c] += b * points[i][c];
+			}
+		}
+
+		float determinant = aa * bb - ab * ab;
+		if (std::fabs(determinant) < 1e-6f)
+			return false;
+
+		for (unsigned int c = 0; c < channels; c++)
+		{
+			low[c] = std::clamp((bb * ax[c] - ab * bx[c]) / determinant, 0.0f, 255.0f);
+			high[c] = std::clamp((aa * bx[c] - ab * ax[c]) / determinant, 0.0f, 255.0f);
+		}
+		return true;
+	}
+
+	// --------------------------------------------------------
+	// BC1: two RGB565 endpoints and a 2-bit index per pixel.
+	// Only the four color mode is written, so the first
+	// endpoint is always the larger one.
+	// --------------------------------------------------------
+	unsigned short To565(const float color[4])
+	{
+		unsigned int r = (unsigned int)std::clamp(color[0] * 31.0f / 255.0f + 0.5f, 0.0f, 31.0f);
+		unsigned int g = (unsigned int)std::clamp(color[1] * 63.0f / 255.0f + 0.5f, 0.0f, 63.0f);
+		unsigned int b = (unsigned int)std::clamp(color[2] * 31.0f / 255.0f + 0.5f, 0.0f, 31.0f);
+		return (unsigned short)((r << 11) | (g << 5) | b);
+	}
+
+	void BC1Palette(unsigned short color0, unsigned short color1, int palette[4][3])
+	{
+		unsigned short colors[2] = { color0, color1 };
+		for (unsigned int e = 0; e < 2; e++)
+		{
+			unsigned int r = colors[e] >> 11;
+			unsigned int g = (colors[e] >> 5) & 63;
+			unsigned int b = colors[e] & 31;
+			palette[e][0] = (int)((r << 3) | (r >> 2));
+			palette[e][1] = (int)((g << 2) | (g >> 4));
+			palette[e][2] = (int)((b << 3) | (b >> 2));
+		}
+
+		for (unsigned int c = 0; c < 3; c++)
+		{
+			if (color0 > color1)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+			}
+			else
+			{
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				palette[3][c] = 0;
+			}
+		}
+	}
+
+	// Quantizes a pair of endpoints and picks each pixel's closest color
+	float FitBC1(const float points[16][4], const float low[4], const float high[4],
+		unsigned short& color0, unsigned short& color1, unsigned int& indices)
+	{
+		color0 = To565(high);
+		color1 = To565(low);
+		if (color0 < color1)
+			std::swap(color0, color1);
+
+		int palette[4][3];
+		BC1Palette(color0, color1, palette);
+		unsigned int usable = color0 > color1 ? 4 : 1;
+
+		float error = 0.0f;
+		indices = 0;
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			unsigned int best = 0;
+			float bestError = 1e30f;
+			for (unsigned int p = 0; p < usable; p++)
+			{
+				float e = 0.0f;
+				for (unsigned int c = 0; c < 3; c++)
+					e += (points[i][c] - palette[p][c]) * (points[i][c] - palette[p][c]);
+				if (e < bestError)
+				{
+					bestError = e;
+					best = p;
+				}
+			}
+			indices |= best << (2 * i);
+			error += bestError;
+		}
+		return error;
+	}
+
+	void EncodeBC1(const unsigned char pixels[16][4], unsigned char* block)
+	{
+		float points[16][4];
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			for (unsigned int c = 0; c < 4; c++)
+				points[i][c] = pixels[i][c];
+		}
+
+		float low[4];
+		float high[4];
+		AxisEndpoints(points, 3, low, high);
+
+		unsigned short color0, color1;
+		unsigned int indices;
+		float error = FitBC1(points, low, high, color0, color1, indices);
+
+		// Refit the endpoints to the chosen indices while that helps
+		const float IndexWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+		for (unsigned int iteration = 0; iteration < 2 && color0 > color1; iteration++)
+		{
+			// Index 0 is color0 (the high end), so weights go from high to low
+			float weights[16];
+			for (unsigned int i = 0; i < 16; i++)
+				weights[i] = IndexWeights[(indices >> (2 * i)) & 3];
+			if (!LeastSquaresEndpoints(points, weights, 3, high, low))
+				break;
+
+			unsigned short refit0, refit1;
+			unsigned int refitIndices;
+			float refitError = FitBC1(points, low, high, refit0, refit1, refitIndices);
+			if (refitError >= error)
+				break;
+
+			color0 = refit0;
+			color1 = refit1;
+			indices = refitIndices;
+			error = refitError;
+		}
+
+		memcpy(block, &color0, 2);
+		memcpy(block + 2, &color1, 2);
+		memcpy(block + 4, &indices, 4);
+	}
+
+	void DecodeBC1(const unsigned char* block, unsigned char pixels[16][4])
+	{
+		unsigned short color0, color1;
+		unsigned int indices;
+		memcpy(&color0, block, 2);
+		memcpy(&color1, block + 2, 2);
+		memcpy(&indices, block + 4, 4);
+
+		int palette[4][3];
+		BC1Palette(color0, color1, palette);
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			unsigned int index = (indices >> (2 * i)) & 3;
+			for (unsigned int c = 0; c < 3; c++)
+				pixels[i][c] = (unsigned char)palette[index][c];
+			pixels[i][3] = color0 <= color1 && index == 3 ? 0 : 255;
+		}
+	}
+
+	// --------------------------------------------------------
+	// BC4: two 8-bit endpoints and a 3-bit index per pixel.
+	// With the first endpoint larger there are six steps
+	// between them; otherwise four, plus exact 0 and 255.
+	// --------------------------------------------------------
+	void BC4Palette(unsigned int value0, unsigned int value1, unsigned int palette[8])
+	{
+		palette[0] = value0;
+		palette[1] = value1;
+		if (value0 > value1)
+		{
+			for (unsigned int i = 1; i <= 6; i++)
+				palette[i + 1] = ((7 - i) * value0 + i * value1 + 3) / 7;
+		}
+		else
+		{
+			for (unsigned int i = 1; i <= 4; i++)
+				palette[i + 1] = ((5 - i) * value0 + i * value1 + 2) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	unsigned int FitBC4(const unsigned char values[16], unsigned int value0, unsigned int value1, unsigned long long& indices)
+	{
+		unsigned int palette[8];
+		BC4Palette(value0, value1, palette);
+
+		unsigned int error = 0;
+		indices = 0;
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			unsigned int best = 0;
+			unsigned int bestError = 0xFFFFFFFF;
+			for (unsigned int p = 0; p < 8; p++)
+			{
+				int difference = (int)values[i] - (int)palette[p];
+				unsigned int e = (unsigned int)(difference * difference);
+				if (e < bestError)
+				{
+					bestError = e;
+					best = p;
+				}
+			}
+			indices |= (unsigned long long)best << (3 * i);
+			error += bestError;
+		}
+		return error;
+	}
+
+	// Tries the range of the block (and a little inside it) in
+	// the six step mode, and in the four step mode if any value
+	// is exactly 0 or 255
+	void EncodeBC4(const unsigned char values[16], unsigned char* block)
+	{
+		unsigned int low = 255, high = 0;
+		unsigned int innerLow = 255, innerHigh = 0;
+		bool extremes = false;
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			unsigned int v = values[i];
+			low = v < low ? v : low;
+			high = v > high ? v : high;
+			if (v == 0 || v == 255)
+			{
+				extremes = true;
+				continue;
+			}
+			innerLow = v < innerLow ? v : innerLow;
+			innerHigh = v > innerHigh ? v : innerHigh;
+		}
+
+		unsigned int best0 = high, best1 = low;
+		unsigned long long bestIndices;
+		unsigned int bestError = FitBC4(values, best0, best1, bestIndices);
+
+		for (unsigned int inset0 = 0; inset0 <= 2 && bestError > 0; inset0++)
+		{
+			for (unsigned int inset1 = 0; inset1 <= 2; inset1++)
+			{
+				if (high < low + inset0 + inset1 + 1)
+					continue;
+
+				unsigned long long indices;
+				unsigned int error = FitBC4(values, high - inset0, low + inset1, indices);
+				if (error < bestError)
+				{
+					best0 = high - inset0;
+					best1 = low + inset1;
+					bestIndices = indices;
+					bestError = error;
+				}
+			}
+		}
+
+		if (extremes && bestError > 0)
+		{
+			if (innerLow > innerHigh)
+				innerLow = innerHigh = 0;
+
+			unsigned long long indices;
+			unsigned int error = FitBC4(values, innerLow, innerHigh, indices);
+			if (error < bestError)
+			{
+				best0 = innerLow;
+				best1 = innerHigh;
+				bestIndices = indices;
+			}
+		}
+
+		block[0] = (unsigned char)best0;
+		block[1] = (unsigned char)best1;
+		for (unsigned int b = 0; b < 6; b++)
+			block[2 + b] = (unsigned char)(bestIndices >> (8 * b));
+	}
+
+	void DecodeBC4(const unsigned char* block, unsigned char values[16])
+	{
+		unsigned int palette[8];
+		BC4Palette(block[0], block[1], palette);
+
+		unsigned long long indices = 0;
+		for (unsigned int b = 0; b < 6; b++)
+			indices |= (unsigned long long)block[2 + b] << (8 * b);
+
+		for (unsigned int i = 0; i < 16; i++)
+			values[i] = (unsigned char)palette[(indices >> (3 * i)) & 7];
+	}
+
+	// --------------------------------------------------------
+	// BC7, mostly mode 6: one subset, RGBA endpoints of 7 bits
+	// plus a shared low bit each, and a 4-bit index per pixel.
+	// Fitting one line through all four channels is the
+	// fastest BC7 mode to search and still well ahead of BC1.
+	// Blocks of one color use mode 5 instead (see below).
+	// --------------------------------------------------------
+	const unsigned int BC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	struct BC7Mode6
+	{
+		unsigned int endpoints[2][4];	// 7 bits each
+		unsigned int pBits[2];
+		unsigned char indices[16];
+	};
+
+	void BC7Palette(const BC7Mode6& block, unsigned int palette[16][4])
+	{
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			unsigned int e0 = (block.endpoints[0][c] << 1) | block.pBits[0];
+			unsigned int e1 = (block.endpoints[1][c] << 1) | block.pBits[1];
+			for (unsigned int i = 0; i < 16; i++)
+				palette[i][c] = ((64 - BC7Weights[i]) * e0 + BC7Weights[i] * e1 + 32) >> 6;
+		}
+	}
+
+	// Quantizes a pair of endpoints with each choice of p-bits,
+	// keeping whichever fits the block best
+	float FitBC7(const float points[16][4], const float low[4], const float high[4], BC7Mode6& block)
+	{
+		float bestError = 1e30f;
+		for (unsigned int p = 0; p < 4; p++)
+		{
+			BC7Mode6 candidate;
+			candidate.pBits[0] = p & 1;
+			candidate.pBits[1] = p >> 1;
+			for (unsigned int c = 0; c < 4; c++)
+			{
+				candidate.endpoints[0][c] = (unsigned int)std::clamp((low[c] - candidate.pBits[0]) / 2.0f + 0.5f, 0.0f, 127.0f);
+				candidate.endpoints[1][c] = (unsigned int)std::clamp((high[c] - candidate.pBits[1]) / 2.0f + 0.5f, 0.0f, 127.0f);
+			}
+
+			unsigned int palette[16][4];
+			BC7Palette(candidate, palette);
+
+			// The palette runs (almost) along the line between the endpoints,
+			// so each pixel only needs checking against the entries either
+			// side of where it projects onto that line
+			float direction[4];
+			float lengthSquared = 0.0f;
+			for (unsigned int c = 0; c < 4; c++)
+			{
+				direction[c] = (float)palette[15][c] - (float)palette[0][c];
+				lengthSquared += direction[c] * direction[c];
+			}
+
+			float error = 0.0f;
+			for (unsigned int i = 0; i < 16 && error < bestError; i++)
+			{
+				float t = 0.0f;
+				for (unsigned int c = 0; c < 4 && lengthSquared > 0.0f; c++)
+					t += (points[i][c] - palette[0][c]) * direction[c] / lengthSquared;
+				unsigned int nearest = (unsigned int)std::clamp(t * 15.0f + 0.5f, 0.0f, 15.0f);
+
+				unsigned int best = 0;
+				float pixelError = 1e30f;
+				for (unsigned int e = nearest > 0 ? nearest - 1 : 0; e <= nearest + 1 && e < 16; e++)
+				{
+					float d = 0.0f;
+					for (unsigned int c = 0; c < 4; c++)
+						d += (points[i][c] - palette[e][c]) * (points[i][c] - palette[e][c]);
+					if (d < pixelError)
+					{
+						pixelError = d;
+						best = e;
+					}
+				}
+				candidate.indices[i] = (unsigned char)best;
+				error += pixelError;
+			}
+
+			if (error < bestError)
+			{
+				bestError = error;
+				block = candidate;
+			}
+		}
+		return bestError;
+	}
+
+	struct BitWriter
+	{
+		unsigned char* data;
+		unsigned int position;
+
+		void Write(unsigned int value, unsigned int bits)
+		{
+			for (unsigned int b = 0; b < bits; b++, position++)
+			{
+				if ((value >> b) & 1)
+					data[position >> 3] |= (unsigned char)(1 << (position & 7));
+			}
+		}
+	};
+
+	struct BitReader
+	{
+		const unsigned char* data;
+		unsigned int position;
+
+		unsigned int Read(unsigned int bits)
+		{
+			unsigned int value = 0;
+			for (unsigned int b = 0; b < bits; b++, position++)
+				value |= ((data[position >> 3] >> (position & 7)) & 1u) << b;
+			return value;
+		}
+	};
+
+	// --------------------------------------------------------
+	// Mode 5 keeps color and alpha apart: 7-bit color endpoints
+	// (widened by repeating their top bit), 8-bit alpha ones and
+	// 2-bit indices for each. Mode 6's shared low bit can't hit
+	// every solid color (opaque black, say), but mode 5's color
+	// index 1 reaches every 8-bit value from some endpoint pair.
+	// --------------------------------------------------------
+	const unsigned int BC7Weights2[4] = { 0, 21, 43, 64 };
+
+	inline unsigned int ExpandBC7Color(unsigned int endpoint)
+	{
+		return (endpoint << 1) | (endpoint >> 6);
+	}
+
+	// The endpoints (e0 | e1 << 7) that land on each value at index 1, found once
+	struct BC7SolidTable
+	{
+		unsigned short endpoints[256];
+	};
+
+	const BC7SolidTable& GetBC7SolidTable()
+	{
+		static const BC7SolidTable table = []()
+			{
+				BC7SolidTable built = {};
+				bool found[256] = {};
+				for (unsigned int e0 = 0; e0 < 128; e0++)
+				{
+					for (unsigned int e1 = 0; e1 < 128; e1++)
+					{
+						unsigned int value = ((64 - BC7Weights2[1]) * ExpandBC7Color(e0) + BC7Weights2[1] * ExpandBC7Color(e1) + 32) >> 6;
+						if (!found[value])
+						{
+							built.endpoints[value] = (unsigned short)(e0 | e1 << 7);
+							found[value] = true;
+						}
+					}
+				}
+				return built;
+			}();
+		return table;
+	}
+
+	// Returns false, writing nothing, if the block isn't all one color
+	bool EncodeBC7Solid(const unsigned char pixels[16][4], unsigned char* block)
+	{
+		for (unsigned int i = 1; i < 16; i++)
+		{
+			if (memcmp(pixels[i], pixels[0], 4) != 0)
+				return false;
+		}
+
+		const BC7SolidTable& table = GetBC7SolidTable();
+		memset(block, 0, 16);
+		BitWriter writer = { block, 0 };
+		writer.Write(1 << 5, 6);
+		writer.Write(0, 2);	// No channel rotation
+		for (unsigned int c = 0; c < 3; c++)
+		{
+			writer.Write(table.endpoints[pixels[0][c]] & 127, 7);
+			writer.Write(table.endpoints[pixels[0][c]] >> 7, 7);
+		}
+		writer.Write(pixels[0][3], 8);
+		writer.Write(pixels[0][3], 8);
+		for (unsigned int i = 0; i < 16; i++)
+			writer.Write(1, i == 0 ? 1 : 2);
+		return true;	// Alpha indices are all 0
+	}
+
+	void DecodeBC7Mode5(BitReader& reader, unsigned char pixels[16][4])
+	{
+		unsigned int rotation = reader.Read(2);
+		unsigned int endpoints[2][4];
+		for (unsigned int c = 0; c < 3; c++)
+		{
+			endpoints[0][c] = ExpandBC7Color(reader.Read(7));
+			endpoints[1][c] = ExpandBC7Color(reader.Read(7));
+		}
+		endpoints[0][3] = reader.Read(8);
+		endpoints[1][3] = reader.Read(8);
+
+		unsigned int colorIndices[16];
+		unsigned int alphaIndices[16];
+		for (unsigned int i = 0; i < 16; i++)
+			colorIndices[i] = reader.Read(i == 0 ? 1 : 2);
+		for (unsigned int i = 0; i < 16; i++)
+			alphaIndices[i] = reader.Read(i == 0 ? 1 : 2);
+
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			for (unsigned int c = 0; c < 4; c++)
+			{
+				unsigned int weight = BC7Weights2[c < 3 ? colorIndices[i] : alphaIndices[i]];
+				pixels[i][c] = (unsigned char)(((64 - weight) * endpoints[0][c] + weight * endpoints[1][c] + 32) >> 6);
+			}
+
+			// Rotation swaps alpha with one of the colors
+			if (rotation > 0)
+				std::swap(pixels[i][rotation - 1], pixels[i][3]);
+		}
+	}
+
+	void EncodeBC7(const unsigned char pixels[16][4], unsigned char* block)
+	{
+		if (EncodeBC7Solid(pixels, block))
+			return;
+
+		float points[16][4];
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			for (unsigned int c = 0; c < 4; c++)
+				points[i][c] = pixels[i][c];
+		}
+
+		float low[4];
+		float high[4];
+		AxisEndpoints(points, 4, low, high);
+
+		BC7Mode6 best;
+		float error = FitBC7(points, low, high, best);
+
+		// Refit the endpoints to the chosen indices while that helps
+		for (unsigned int iteration = 0; iteration < 3 && error > 0.0f; iteration++)
+		{
+			float weights[16];
+			for (unsigned int i = 0; i < 16; i++)
+				weights[i] = BC7Weights[best.indices[i]] / 64.0f;
+			if (!LeastSquaresEndpoints(points, weights, 4, low, high))
+				break;
+
+			BC7Mode6 refit;
+			float refitError = FitBC7(points, low, high, refit);
+			if (refitError >= error)
+				break;
+
+			best = refit;
+			error = refitError;
+		}
+
+		// The first pixel's index has an implied top bit of 0,
+		// so flip the endpoints around if it's in the top half
+		if (best.indices[0] >= 8)
+		{
+			for (unsigned int c = 0; c < 4; c++)
+				std::swap(best.endpoints[0][c], best.endpoints[1][c]);
+			std::swap(best.pBits[0], best.pBits[1]);
+			for (unsigned int i = 0; i < 16; i++)
+				best.indices[i] = (unsigned char)(15 - best.indices[i]);
+		}
+
+		memset(block, 0, 16);
+		BitWriter writer = { block, 0 };
+		writer.Write(1 << 6, 7);
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			writer.Write(best.endpoints[0][c], 7);
+			writer.Write(best.endpoints[1][c], 7);
+		}
+		writer.Write(best.pBits[0], 1);
+		writer.Write(best.pBits[1], 1);
+		for (unsigned int i = 0; i < 16; i++)
+			writer.Write(best.indices[i], i == 0 ? 3 : 4);
+	}
+
+	// Only modes 5 and 6 (what EncodeBC7 writes) are understood;
+	// any other block decodes to black
+	void DecodeBC7(const unsigned char* block, unsigned char pixels[16][4])
+	{
+		BitReader reader = { block, 0 };
+		if (reader.Read(6) == 1 << 5)
+		{
+			DecodeBC7Mode5(reader, pixels);
+			return;
+		}
+
+		reader.position = 0;
+		if (reader.Read(7) != 1 << 6)
+		{
+			memset(pixels, 0, 16 * 4);
+			return;
+		}
+
+		BC7Mode6 decoded;
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			decoded.endpoints[0][c] = reader.Read(7);
+			decoded.endpoints[1][c] = reader.Read(7);
+		}
+		decoded.pBits[0] = reader.Read(1);
+		decoded.pBits[1] = reader.Read(1);
+		for (unsigned int i = 0; i < 16; i++)
+			decoded.indices[i] = (unsigned char)reader.Read(i == 0 ? 3 : 4);
+
+		unsigned int palette[16][4];
+		BC7Palette(decoded, palette);
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			for (unsigned int c = 0; c < 4; c++)
+				pixels[i][c] = (unsigned char)palette[decoded.indices[i]][c];
+		}
+	}
+
+	void EncodeBlock(const unsigned char pixels[16][4], TextureCooker::BlockFormat format, unsigned char* block)
+	{
+		unsigned char values[16];
+		switch (format)
+		{
+		case TextureCooker::BlockFormat::BC1:
+			EncodeBC1(pixels, block);
+			break;
+
+		case TextureCooker::BlockFormat::BC4:
+			for (unsigned int i = 0; i < 16; i++)
+				values[i] = pixels[i][0];
+			EncodeBC4(values, block);
+			break;
+
+		case TextureCooker::BlockFormat::BC5:
+			for (unsigned int c = 0; c < 2; c++)
+			{
+				for (unsigned int i = 0; i < 16; i++)
+					values[i] = pixels[i][c];
+				EncodeBC4(values, block + 8 * c);
+			}
+			break;
+
+		case TextureCooker::BlockFormat::BC7:
+			EncodeBC7(pixels, block);
+			break;
+		}
+	}
+
+	// Channels a format doesn't store come back as 0 (or 255 for alpha)
+	void DecodeBlock(const unsigned char* block, TextureCooker::BlockFormat format, unsigned char pixels[16][4])
+	{
+		unsigned char values[16];
+		switch (format)
+		{
+		case TextureCooker::BlockFormat::BC1:
+			DecodeBC1(block, pixels);
+			break;
+
+		case TextureCooker::BlockFormat::BC4:
+		case TextureCooker::BlockFormat::BC5:
+			for (unsigned int i = 0; i < 16; i++)
+			{
+				pixels[i][1] = 0;
+				pixels[i][2] = 0;
+				pixels[i][3] = 255;
+			}
+			for (unsigned int c = 0; c < (format == TextureCooker::BlockFormat::BC5 ? 2u : 1u); c++)
+			{
+				DecodeBC4(block + 8 * c, values);
+				for (unsigned int i = 0; i < 16; i++)
+					pixels[i][c] = values[i];
+			}
+			break;
+
+		case TextureCooker::BlockFormat::BC7:
+			DecodeBC7(block, pixels);
+			break;
+		}
+	}
+
+	// --------------------------------------------------------
+	// DDS file layout, written with the DX10 extension header
+	// so every format is named by its DXGI format
+	// --------------------------------------------------------
+	struct DdsPixelFormat
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t rgbBitCount;
+		uint32_t rBitMask;
+		uint32_t gBitMask;
+		uint32_t bBitMask;
+		uint32_t aBitMask;
+	};
+
+	struct DdsHeader
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitchOrLinearSize;
+		uint32_t depth;
+		uint32_t mipMapCount;
+		uint32_t reserved1[11];
+		DdsPixelFormat pixelFormat;
+		uint32_t caps;
+		uint32_t caps2;
+		uint32_t caps3;
+		uint32_t caps4;
+		uint32_t reserved2;
+	};
+
+	struct DdsHeaderDX10
+	{
+		uint32_t dxgiFormat;
+		uint32_t resourceDimension;
+		uint32_t miscFlag;
+		uint32_t arraySize;
+		uint32_t miscFlags2;
+	};
+
+	static_assert(sizeof(DdsHeader) == 124, "DDS header must be 124 bytes");
+
+	const uint32_t DdsMagic = 0x20534444;		// "DDS "
+	const uint32_t DdsFourCCDX10 = 0x30315844;	// "DX10"
+
+	uint32_t DxgiFormat(TextureCooker::BlockFormat format)
+	{
+		switch (format)
+		{
+		case TextureCooker::BlockFormat::BC1: return 71;	// DXGI_FORMAT_BC1_UNORM
+		case TextureCooker::BlockFormat::BC4: return 80;	// DXGI_FORMAT_BC4_UNORM
+		case TextureCooker::BlockFormat::BC5: return 83;	// DXGI_FORMAT_BC5_UNORM
+		default: return 98;								// DXGI_FORMAT_BC7_UNORM
+		}
+	}
+
+	// --------------------------------------------------------
+	// Binary Netpbm images: P5 (gray), P6 (RGB) and P7 (PAM,
+	// 1 to 4 channels), 8 bits per channel
+	// --------------------------------------------------------
+	bool ReadNetpbm(const std::filesystem::path& path, TextureCooker::Image& image)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+
+		// Header tokens, skipping whitespace and comments
+		auto token = [&]()
+			{
+				std::string text;
+				char c;
+				while (file.get(c))
+				{
+					if (c == '#')
+					{
+						while (file.get(c) && c != '\n');
+						continue;
+					}
+					if (std::isspace((unsigned char)c))
+					{
+						if (!text.empty())
+							break;
+						continue;
+					}
+					text += c;
+				}
+				return text;
+			};
+
+		std::string magic = token();
+		unsigned int width = 0, height = 0, channels = 0, maxValue = 0;
+		if (magic == "P5" || magic == "P6")
+		{
+			width = (unsigned int)std::stoul("0" + token());
+			height = (unsigned int)std::stoul("0" + token());
+			maxValue = (unsigned int)std::stoul("0" + token());
+			channels = magic == "P5" ? 1 : 3;
+		}
+		else if (magic == "P7")
+		{
+			for (std::string key = token(); !key.empty() && key != "ENDHDR"; key = token())
+			{
+				if (key == "WIDTH") width = (unsigned int)std::stoul("0" + token());
+				else if (key == "HEIGHT") height = (unsigned int)std::stoul("0" + token());
+				else if (key == "DEPTH") channels = (unsigned int)std::stoul("0" + token());
+				else if (key == "MAXVAL") maxValue = (unsigned int)std::stoul("0" + token());
+				else if (key == "TUPLTYPE") token();
+			}
+		}
+
+		if (width == 0 || height == 0 || channels == 0 || channels > 4 || maxValue != 255)
+			return false;
+
+		std::vector<unsigned char> data((size_t)width * height * channels);
+		if (!file.read((char*)data.data(), (std::streamsize)data.size()))
+			return false;
+
+		// Gray and RGB become opaque RGBA, and gray + alpha keeps its alpha
+		image.width = width;
+		image.height = height;
+		image.rgba.resize((size_t)width * height * 4);
+		for (size_t i = 0; i < (size_t)width * height; i++)
+		{
+			const unsigned char* in = &data[i * channels];
+			unsigned char* out = &image.rgba[i * 4];
+			bool gray = channels < 3;
+			out[0] = in[0];
+			out[1] = gray ? in[0] : in[1];
+			out[2] = gray ? in[0] : in[2];
+			out[3] = channels == 2 ? in[1] : channels == 4 ? in[3] : 255;
+		}
+		return true;
+	}
+
+	bool IsNetpbm(const std::wstring& extension)
+	{
+		return extension == L".pam" || extension == L".ppm" || extension == L".pgm";
+	}
+
+	std::wstring LowerExtension(const std::filesystem::path& path)
+	{
+		std::wstring extension = path.extension().wstring();
+		for (wchar_t& c : extension)
+			c = (wchar_t)std::towlower(c);
+		return extension;
+	}
+
+#ifdef _WIN32
+	bool ReadWIC(const std::filesystem::path& path, TextureCooker::Image& image)
+	{
+		HRESULT com = CoInitializeEx(0, COINIT_MULTITHREADED);
+		bool read = false;
+		{
+			Microsoft::WRL::ComPtr<IWICImagingFactory> factory;
+			Microsoft::WRL::ComPtr<IWICBitmapDecoder> decoder;
+			Microsoft::WRL::ComPtr<IWICBitmapFrameDecode> frame;
+			Microsoft::WRL::ComPtr<IWICFormatConverter> converter;
+			UINT width = 0;
+			UINT height = 0;
+			if (SUCCEEDED(CoCreateInstance(CLSID_WICImagingFactory, 0, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(factory.GetAddressOf()))) &&
+				SUCCEEDED(factory->CreateDecoderFromFilename(path.c_str(), 0, GENERIC_READ, WICDecodeMetadataCacheOnDemand, decoder.GetAddressOf())) &&
+				SUCCEEDED(decoder->GetFrame(0, frame.GetAddressOf())) &&
+				SUCCEEDED(factory->CreateFormatConverter(converter.GetAddressOf())) &&
+				SUCCEEDED(converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, 0, 0.0, WICBitmapPaletteTypeCustom)) &&
+				SUCCEEDED(converter->GetSize(&width, &height)) &&
+				width > 0 && height > 0)
+			{
+				image.width = width;
+				image.height = height;
+				image.rgba.resize((size_t)width * height * 4);
+				read = SUCCEEDED(converter->CopyPixels(0, width * 4, (UINT)image.rgba.size(), image.rgba.data()));
+			}
+		}
+		if (SUCCEEDED(com))
+			CoUninitialize();
+		return read;
+	}
+#endif
+
+	// Everything ending in one of these is a non-color texture
+	bool EndsWith(const std::wstring& text, const wchar_t* suffix)
+	{
+		size_t length = wcslen(suffix);
+		return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+	}
+}
+
+TextureCooker::TextureKind TextureCooker::KindFromPath(const std::filesystem::path& path)
+{
+	std::wstring name = path.stem().wstring();
+	for (wchar_t& c : name)
+		c = (wchar_t)std::towlower(c);
+
+	if (EndsWith(name, L"_normals") || EndsWith(name, L"_normal"))
+		return TextureKind::Normal;
+	if (EndsWith(name, L"_metal") || EndsWith(name, L"_metallic") || EndsWith(name, L"_roughness") ||
+		EndsWith(name, L"_rough") || EndsWith(name, L"_ao"))
+		return TextureKind::Mask;
+	return TextureKind::Color;
+}
+
+TextureCooker::BlockFormat TextureCooker::FormatForKind(TextureKind kind, bool bc1Color)
+{
+	switch (kind)
+	{
+	case TextureKind::Normal: return BlockFormat::BC5;
+	case TextureKind::Mask: return BlockFormat::BC4;
+	default: return bc1Color ? BlockFormat::BC1 : BlockFormat::BC7;
+	}
+}
+
+const char* TextureCooker::FormatName(BlockFormat format)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1: return "BC1";
+	case BlockFormat::BC4: return "BC4";
+	case BlockFormat::BC5: return "BC5";
+	default: return "BC7";
+	}
+}
+
+std::filesystem::path TextureCooker::CookedPath(const std::filesystem::path& source)
+{
+	std::filesystem::path cooked = source;
+	return cooked.replace_extension(L".dds");
+}
+
+bool TextureCooker::IsCookedCurrent(const std::filesystem::path& source)
+{
+	std::error_code error;
+	std::filesystem::path cooked = CookedPath(source);
+	if (cooked == source || !std::filesystem::exists(cooked, error))
+		return false;
+
+	// Missing sources are fine; the cooked file is all that's needed
+	std::filesystem::file_time_type sourceTime = std::filesystem::last_write_time(source, error);
+	if (error)
+		return true;
+
+	std::filesystem::file_time_type cookedTime = std::filesystem::last_write_time(cooked, error);
+	return !error && cookedTime >= sourceTime;
+}
+
+bool TextureCooker::CanReadImage(const std::filesystem::path& path)
+{
+	std::wstring extension = LowerExtension(path);
+#ifdef _WIN32
+	if (extension == L".png" || extension == L".jpg" || extension == L".jpeg" ||
+		extension == L".bmp" || extension == L".tif" || extension == L".tiff")
+		return true;
+#endif
+	return IsNetpbm(extension);
+}
+
+bool TextureCooker::ReadImage(const std::filesystem::path& path, Image& image)
+{
+	if (IsNetpbm(LowerExtension(path)))
+		return ReadNetpbm(path, image);
+#ifdef _WIN32
+	return ReadWIC(path, image);
+#else
+	return false;
+#endif
+}
+
+// --------------------------------------------------------
+// Builds the full chain down to 1x1, each mip a 2x2 box
+// filter of the one before it. The chain is kept in linear
+// float space so rounding doesn't build up from mip to mip.
+// --------------------------------------------------------
+void TextureCooker::BuildMips(const Image& image, TextureKind kind, std::vector<Image>& mips)
+{
+	mips.clear();
+	mips.push_back(image);
+
+	float toLinear[256];
+	for (unsigned int v = 0; v < 256; v++)
+	{
+		float unit = v / 255.0f;
+		toLinear[v] = kind == TextureKind::Color ? std::pow(unit, Gamma) : kind == TextureKind::Normal ? unit * 2.0f - 1.0f : unit;
+	}
+
+	unsigned int width = image.width;
+	unsigned int height = image.height;
+	std::vector<float> level((size_t)width * height * 4);
+	for (size_t i = 0; i < level.size(); i++)
+		level[i] = (i & 3) == 3 ? image.rgba[i] / 255.0f : toLinear[image.rgba[i]];
+
+	while (width > 1 || height > 1)
+	{
+		unsigned int mipWidth = width > 1 ? width / 2 : 1;
+		unsigned int mipHeight = height > 1 ? height / 2 : 1;
+		std::vector<float> next((size_t)mipWidth * mipHeight * 4);
+
+		Image mip;
+		mip.width = mipWidth;
+		mip.height = mipHeight;
+		mip.rgba.resize(next.size());
+
+		for (unsigned int y = 0; y < mipHeight; y++)
+		{
+			size_t row0 = (size_t)(2 * y < height ? 2 * y : height - 1) * width;
+			size_t row1 = (size_t)(2 * y + 1 < height ? 2 * y + 1 : height - 1) * width;
+			for (unsigned int x = 0; x < mipWidth; x++)
+			{
+				size_t x0 = 2 * x < width ? 2 * x : width - 1;
+				size_t x1 = 2 * x + 1 < width ? 2 * x + 1 : width - 1;
+				float* out = &next[((size_t)y * mipWidth + x) * 4];
+				for (unsigned int c = 0; c < 4; c++)
+				{
+					out[c] = (level[(row0 + x0) * 4 + c] + level[(row0 + x1) * 4 + c] +
+						level[(row1 + x0) * 4 + c] + level[(row1 + x1) * 4 + c]) * 0.25f;
+				}
+
+				// Averaged normals get shorter, and would shade darker
+				if (kind == TextureKind::Normal)
+				{
+					float length = std::sqrt(out[0] * out[0] + out[1] * out[1] + out[2] * out[2]);
+					for (unsigned int c = 0; c < 3 && length > 0.0f; c++)
+						out[c] /= length;
+				}
+
+				unsigned char* pixel = &mip.rgba[((size_t)y * mipWidth + x) * 4];
+				for (unsigned int c = 0; c < 3; c++)
+				{
+					pixel[c] = kind == TextureKind::Color ? ToByte(std::pow(out[c], 1.0f / Gamma)) :
+						kind == TextureKind::Normal ? ToByte(out[c] * 0.5f + 0.5f) : ToByte(out[c]);
+				}
+				pixel[3] = ToByte(out[3]);
+			}
+		}
+
+		mips.push_back(std::move(mip));
+		level.swap(next);
+		width = mipWidth;
+		height = mipHeight;
+	}
+}
+
+// --------------------------------------------------------
+// Compresses an image block by block. Rows of blocks are
+// shared out across threads as they finish the last one.
+// --------------------------------------------------------
+void TextureCooker::CompressImage(const Image& image, BlockFormat format, std::vector<unsigned char>& blocks)
+{
+	unsigned int blocksWide = (image.width + 3) / 4;
+	unsigned int blocksHigh = (image.height + 3) / 4;
+	unsigned int blockBytes = BlockBytes(format);
+	blocks.assign((size_t)blocksWide * blocksHigh * blockBytes, 0);
+
+	unsigned int threadCount = Parallel::HardwareThreads();
+	if (threadCount > blocksHigh)
+		threadCount = blocksHigh;
+
+	std::atomic<unsigned int> nextRow = 0;
+	Parallel::Run(threadCount, [&](size_t)
+		{
+			unsigned char pixels[16][4];
+			for (unsigned int y = nextRow++; y < blocksHigh; y = nextRow++)
+			{
+				for (unsigned int x = 0; x < blocksWide; x++)
+				{
+					ReadBlock(image, x, y, pixels);
+					EncodeBlock(pixels, format, &blocks[((size_t)y * blocksWide + x) * blockBytes]);
+				}
+			}
+		});
+}
+
+void TextureCooker::DecompressImage(const unsigned char* blocks, BlockFormat format, unsigned int width, unsigned int height, Image& image)
+{
+	unsigned int blocksWide = (width + 3) / 4;
+	unsigned int blocksHigh = (height + 3) / 4;
+	unsigned int blockBytes = BlockBytes(format);
+
+	image.width = width;
+	image.height = height;
+	image.rgba.resize((size_t)width * height * 4);
+
+	unsigned char pixels[16][4];
+	for (unsigned int y = 0; y < blocksHigh; y++)
+	{
+		for (unsigned int x = 0; x < blocksWide; x++)
+		{
+			DecodeBlock(&blocks[((size_t)y * blocksWide + x) * blockBytes], format, pixels);
+			WriteBlock(image, x, y, pixels);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Peak signal to noise ratio between two same-sized images,
+// over their first few channels. Identical images give
+// infinity.
+// --------------------------------------------------------
+double TextureCooker::Psnr(const Image& a, const Image& b, unsigned int channels)
+{
+	if (a.width != b.width || a.height != b.height || channels == 0)
+		return 0.0;
+
+	double squaredError = 0.0;
+	for (size_t i = 0; i < (size_t)a.width * a.height; i++)
+	{
+		for (unsigned int c = 0; c < channels; c++)
+		{
+			double difference = (double)a.rgba[i * 4 + c] - (double)b.rgba[i * 4 + c];
+			squaredError += difference * difference;
+		}
+	}
+
+	double meanSquaredError = squaredError / ((double)a.width * a.height * channels);
+	return meanSquaredError > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : HUGE_VAL;
+}
+
+bool TextureCooker::WriteDds(const std::filesystem::path& path, BlockFormat format, unsigned int width, unsigned int height,
+	const std::vector<std::vector<unsigned char>>& mipBlocks)
+{
+	DdsHeader header = {};
+	header.size = sizeof(DdsHeader);
+	header.flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;	// Caps, height, width, pixel format, mip count, linear size
+	header.height = height;
+	header.width = width;
+	header.pitchOrLinearSize = mipBlocks.empty() ? 0 : (uint32_t)mipBlocks[0].size();
+	header.mipMapCount = (uint32_t)mipBlocks.size();
+	header.pixelFormat.size = sizeof(DdsPixelFormat);
+	header.pixelFormat.flags = 0x4;	// Four CC
+	header.pixelFormat.fourCC = DdsFourCCDX10;
+	header.caps = 0x1000 | (mipBlocks.size() > 1 ? 0x400000 | 0x8 : 0);	// Texture, mipmap, complex
+
+	DdsHeaderDX10 extension = {};
+	extension.dxgiFormat = DxgiFormat(format);
+	extension.resourceDimension = 3;	// Texture 2D
+	extension.arraySize = 1;
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+		return false;
+
+	file.write((const char*)&DdsMagic, sizeof(DdsMagic));
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)&extension, sizeof(extension));
+	for (const std::vector<unsigned char>& blocks : mipBlocks)
+		file.write((const char*)blocks.data(), (std::streamsize)blocks.size());
+	return (bool)file;
+}
+
+bool TextureCooker::CookTexture(const Image& image, TextureKind kind, BlockFormat format, const std::filesystem::path& output, CookStats& stats)
+{
+	stats = CookStats();
+	stats.width = image.width;
+	stats.height = image.height;
+	if (image.width == 0 || image.height == 0)
+		return false;
+
+	// BC1 has no alpha worth keeping, so textures that use it get BC7
+	bool opaque = true;
+	for (size_t i = 3; i < image.rgba.size() && opaque; i += 4)
+		opaque = image.rgba[i] == 255;
+	if (format == BlockFormat::BC1 && !opaque)
+		format = BlockFormat::BC7;
+	stats.format = format;
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+	std::vector<Image> mips;
+	BuildMips(image, kind, mips);
+	auto encodeTime = std::chrono::high_resolution_clock::now();
+
+	std::vector<std::vector<unsigned char>> mipBlocks(mips.size());
+	for (size_t m = 0; m < mips.size(); m++)
+	{
+		CompressImage(mips[m], format, mipBlocks[m]);
+		stats.pixels += (unsigned long long)mips[m].width * mips[m].height;
+		stats.cookedBytes += mipBlocks[m].size();
+	}
+	auto endTime = std::chrono::high_resolution_clock::now();
+
+	stats.mips = (unsigned int)mips.size();
+	stats.sourceBytes = stats.pixels * 4;
+	stats.mipSeconds = std::chrono::duration<double>(encodeTime - startTime).count();
+	stats.encodeSeconds = std::chrono::duration<double>(endTime - encodeTime).count();
+
+	// Measured over the channels the format keeps (and the shaders read)
+	unsigned int channels =
+		format == BlockFormat::BC4 ? 1 :
+		format == BlockFormat::BC5 ? 2 :
+		format == BlockFormat::BC7 && !opaque ? 4 : 3;
+	Image decoded;
+	DecompressImage(mipBlocks[0].data(), format, image.width, image.height, decoded);
+	stats.psnr = Psnr(image, decoded, channels);
+
+	return WriteDds(output, format, image.width, image.height, mipBlocks);
+}
+
+void TextureCooker::CookFolder(const std::filesystem::path& folder, bool bc1Color)
+{
+	std::error_code error;
+	std::vector<std::filesystem::path> files;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(folder, error))
+	{
+		if (entry.is_regular_file() && CanReadImage(entry.path()))
+			files.push_back(entry.path());
+	}
+	std::sort(files.begin(), files.end());
+
+	printf("Cooking %zu textures in %ls\n", files.size(), folder.wstring().c_str());
+
+	const double MB = 1024.0 * 1024.0;
+	unsigned long long totalPixels = 0;
+	unsigned long long totalSource = 0;
+	unsigned long long totalCooked = 0;
+	double totalEncodeSeconds = 0;
+	for (const std::filesystem::path& file : files)
+	{
+		Image image;
+		if (!ReadImage(file, image))
+		{
+			printf("  %ls: could not read\n", file.filename().wstring().c_str());
+			continue;
+		}
+
+		TextureKind kind = KindFromPath(file);
+		CookStats stats;
+		std::filesystem::path output = CookedPath(file);
+		if (!CookTexture(image, kind, FormatForKind(kind, bc1Color), output, stats))
+		{
+			printf("  %ls: could not write %ls\n", file.filename().wstring().c_str(), output.filename().wstring().c_str());
+			continue;
+		}
+
+		printf("  %-28ls %4ux%-4u %s, %2u mips: %6.2f -> %5.2f MB, mips %6.1f ms, encode %7.1f ms (%6.1f MPixels/s), PSNR %.2f dB\n",
+			file.filename().wstring().c_str(), stats.width, stats.height, FormatName(stats.format), stats.mips,
+			stats.sourceBytes / MB, stats.cookedBytes / MB, stats.mipSeconds * 1000.0, stats.encodeSeconds * 1000.0,
+			stats.pixels / 1000000.0 / stats.encodeSeconds, stats.psnr);
+
+		totalPixels += stats.pixels;
+		totalSource += stats.sourceBytes;
+		totalCooked += stats.cookedBytes;
+		totalEncodeSeconds += stats.encodeSeconds;
+	}
+
+	if (totalEncodeSeconds > 0)
+	{
+		printf("Cooked %.2f MB of RGBA down to %.2f MB, encoding %.1f MPixels/s on %u threads\n",
+			totalSource / MB, totalCooked / MB, totalPixels / 1000000.0 / totalEncodeSeconds, Parallel::HardwareThreads());
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+// --------------------------------------------------------
+// Offline texture cooker: turns source images into block
+// compressed .dds files with full mip chains, which the
+// engine loads in place of the source when they're there
+//
+// Each texture is compressed based on what it holds, going
+// by its file name:
+//  - Colors (albedo):      BC7, or BC1 if asked for
+//  - Normals (_normals):   BC5, x and y only
+//  - Masks (_metal, etc.): BC4, red only
+//
+// Mips are filtered in linear space: colors are gamma
+// decoded first (the shaders treat them as gamma 2.2) and
+// normals are renormalized. Nothing here needs a GPU, so
+// it runs anywhere; only reading the source image differs
+// by platform (see ReadImage()).
+// --------------------------------------------------------
+namespace TextureCooker
+{
+	enum class TextureKind
+	{
+		Color,
+		Normal,
+		Mask
+	};
+
+	enum class BlockFormat
+	{
+		BC1,	// RGB, 4 bits per pixel
+		BC4,	// R, 4 bits per pixel
+		BC5,	// RG, 8 bits per pixel
+		BC7		// RGBA, 8 bits per pixel
+	};
+
+	// 8-bit RGBA pixels, tightly packed
+	struct Image
+	{
+		unsigned int width = 0;
+		unsigned int height = 0;
+		std::vector<unsigned char> rgba;
+	};
+
+	struct CookStats
+	{
+		unsigned int width = 0;
+		unsigned int height = 0;
+		unsigned int mips = 0;
+		BlockFormat format = BlockFormat::BC7;
+		unsigned long long pixels = 0;			// In every mip
+		unsigned long long sourceBytes = 0;		// As RGBA8, with mips
+		unsigned long long cookedBytes = 0;
+		double mipSeconds = 0;
+		double encodeSeconds = 0;
+		double psnr = 0;						// Of the top mip, over the channels kept
+	};
+
+	TextureKind KindFromPath(const std::filesystem::path& path);
+	BlockFormat FormatForKind(TextureKind kind, bool bc1Color = false);
+	const char* FormatName(BlockFormat format);
+
+	// The cooked file for a source image (the same name, as .dds), and
+	// whether it exists and is at least as new as the source
+	std::filesystem::path CookedPath(const std::filesystem::path& source);
+	bool IsCookedCurrent(const std::filesystem::path& source);
+
+	// Reads a source image as RGBA. Binary PGM/PPM/PAM files work
+	// everywhere; on Windows anything WIC can decode works too.
+	bool CanReadImage(const std::filesystem::path& path);
+	bool ReadImage(const std::filesystem::path& path, Image& image);
+
+	// Building blocks, exposed for testing
+	void BuildMips(const Image& image, TextureKind kind, std::vector<Image>& mips);
+	void CompressImage(const Image& image, BlockFormat format, std::vector<unsigned char>& blocks);
+	void DecompressImage(const unsigned char* blocks, BlockFormat format, unsigned int width, unsigned int height, Image& image);
+	double Psnr(const Image& a, const Image& b, unsigned int channels);
+	bool WriteDds(const std::filesystem::path& path, BlockFormat format, unsigned int width, unsigned int height,
+		const std::vector<std::vector<unsigned char>>& mipBlocks);
+
+	// Cooks one image into a .dds file
+	bool CookTexture(const Image& image, TextureKind kind, BlockFormat format, const std::filesystem::path& output, CookStats& stats);
+
+	// Cooks every readable image in a folder, printing the size,
+	// encode throughput and PSNR of each
+	void CookFolder(const std::filesystem::path& folder, bool bc1Color = false);
+}
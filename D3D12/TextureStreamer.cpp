@@ -0,0 +1,262 @@
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+
+TextureStreamer::TextureStreamer(unsigned long long budgetBytes, unsigned int startupMips, unsigned int idleFrames)
+{
+	Reset(budgetBytes, startupMips, idleFrames);
+}
+
+void TextureStreamer::Reset(unsigned long long budgetBytes, unsigned int startupMips, unsigned int idleFrames)
+{
+	this->budgetBytes = budgetBytes;
+	this->startupMips = startupMips > 0 ? startupMips : 1;
+	this->idleFrames = idleFrames;
+	residentBytes = 0;
+	textures.clear();
+
+	stats = TextureStreamStats();
+	stats.budgetBytes = budgetBytes;
+}
+
+unsigned int TextureStreamer::Add(unsigned int width, unsigned int height, unsigned int bitsPerPixel)
+{
+	Texture texture = {};
+	texture.width = width > 0 ? width : 1;
+	texture.height = height > 0 ? height : 1;
+	texture.bitsPerPixel = bitsPerPixel;
+
+	texture.mipCount = MipCount(texture.width, texture.height);
+	texture.startupMip = StartupMip(texture.width, texture.height, startupMips);
+	texture.residentMip = texture.startupMip;
+	texture.pendingMip = texture.startupMip;
+	texture.requestedMip = texture.startupMip;
+	texture.lastRequestFrame = 0;
+	texture.changing = false;
+	texture.removed = false;
+
+	residentBytes += MipChainBytes(texture, texture.startupMip);
+	textures.push_back(texture);
+	return (unsigned int)textures.size() - 1;
+}
+
+// --------------------------------------------------------
+// Stops tracking a texture (its id isn't reused). Any change
+// in flight for it should be dropped rather than completed.
+// --------------------------------------------------------
+void TextureStreamer::Remove(unsigned int texture)
+{
+	Texture& t = textures[texture];
+	if (t.removed)
+		return;
+
+	residentBytes -= MipChainBytes(t, t.changing ? t.pendingMip : t.residentMip);
+	t.removed = true;
+	t.changing = false;
+}
+
+unsigned int TextureStreamer::GetStartupMip(unsigned int texture) { return textures[texture].startupMip; }
+unsigned int TextureStreamer::GetMipCount(unsigned int texture) { return textures[texture].mipCount; }
+
+unsigned int TextureStreamer::MipCount(unsigned int width, unsigned int height)
+{
+	unsigned int size = width > height ? width : height;
+	unsigned int count = 1;
+	while (size > 1)
+	{
+		size /= 2;
+		count++;
+	}
+	return count;
+}
+
+unsigned int TextureStreamer::StartupMip(unsigned int width, unsigned int height, unsigned int startupMips)
+{
+	unsigned int count = MipCount(width, height);
+	return count > startupMips ? count - startupMips : 0;
+}
+
+// --------------------------------------------------------
+// One texel per pixel is as much detail as can be seen, so
+// each halving of the screen size drops another mip
+// --------------------------------------------------------
+unsigned int TextureStreamer::MipForScreenSize(unsigned int width, unsigned int height, float screenPixels)
+{
+	unsigned int size = width > height ? width : height;
+	if (screenPixels < 1.0f)
+		screenPixels = 1.0f;
+	if (size <= screenPixels)
+		return 0;
+
+	return (unsigned int)std::floor(std::log2(size / screenPixels));
+}
+
+void TextureStreamer::Request(unsigned int texture, unsigned int mip, unsigned long long frame)
+{
+	Texture& t = textures[texture];
+	if (mip >= t.mipCount)
+		mip = t.mipCount - 1;
+
+	// The finest request of the frame wins
+	if (t.lastRequestFrame != frame || mip < t.requestedMip)
+		t.requestedMip = mip;
+	t.lastRequestFrame = frame;
+}
+
+// --------------------------------------------------------
+// Idle textures are dropped first, since that only frees
+// memory. Then the textures that want more detail are
+// promoted, most recently requested first, each evicting
+// detail from textures requested less recently than it if
+// it doesn't fit. If even that isn't enough, it gets as
+// many of the mips it asked for as will fit.
+// --------------------------------------------------------
+void TextureStreamer::Update(unsigned long long frame, unsigned int maxChanges, std::vector<TextureStreamChange>& changes)
+{
+	changes.clear();
+
+	std::vector<unsigned int> promotions;
+	for (unsigned int i = 0; i < textures.size(); i++)
+	{
+		Texture& t = textures[i];
+		if (t.changing || t.removed)
+			continue;
+
+		bool idle = t.lastRequestFrame == 0 || frame - t.lastRequestFrame > idleFrames;
+		if (idle && t.residentMip < t.startupMip)
+		{
+			if (changes.size() < maxChanges)
+				StartChange(i, t.startupMip, false, changes);
+		}
+		else if (!idle && t.requestedMip < t.residentMip)
+		{
+			promotions.push_back(i);
+		}
+	}
+
+	std::sort(promotions.begin(), promotions.end(), [&](unsigned int a, unsigned int b)
+		{
+			if (textures[a].lastRequestFrame != textures[b].lastRequestFrame)
+				return textures[a].lastRequestFrame > textures[b].lastRequestFrame;
+			return textures[a].residentMip - textures[a].requestedMip > textures[b].residentMip - textures[b].requestedMip;
+		});
+
+	for (unsigned int index : promotions)
+	{
+		if (changes.size() >= maxChanges)
+			break;
+
+		// Anything requested less recently than this texture can give up its detail,
+		// least recently requested first
+		Texture& t = textures[index];
+		std::vector<unsigned int> victims;
+		unsigned long long evictableBytes = 0;
+		for (unsigned int i = 0; i < textures.size(); i++)
+		{
+			Texture& other = textures[i];
+			if (other.changing || other.removed || other.residentMip >= other.startupMip || other.lastRequestFrame >= t.lastRequestFrame)
+				continue;
+
+			victims.push_back(i);
+			evictableBytes += MipChainBytes(other, other.residentMip) - MipChainBytes(other, other.startupMip);
+		}
+
+		std::sort(victims.begin(), victims.end(), [&](unsigned int a, unsigned int b)
+			{
+				return textures[a].lastRequestFrame < textures[b].lastRequestFrame;
+			});
+
+		// The most detail that can fit, even if it isn't all that was asked for
+		unsigned int firstMip = t.requestedMip;
+		while (budgetBytes > 0 && firstMip < t.residentMip &&
+			residentBytes + MipChainBytes(t, firstMip) - MipChainBytes(t, t.residentMip) > budgetBytes + evictableBytes)
+		{
+			firstMip++;
+		}
+
+		if (firstMip != t.requestedMip)
+			stats.deferred++;
+		if (firstMip == t.residentMip)
+			continue;
+
+		// Work out who has to go before evicting anyone, so nothing
+		// is evicted for a promotion that can't start this frame
+		unsigned long long extra = MipChainBytes(t, firstMip) - MipChainBytes(t, t.residentMip);
+		unsigned long long freed = 0;
+		size_t victimCount = 0;
+		while (budgetBytes > 0 && residentBytes + extra > budgetBytes + freed && victimCount < victims.size())
+		{
+			Texture& victim = textures[victims[victimCount++]];
+			freed += MipChainBytes(victim, victim.residentMip) - MipChainBytes(victim, victim.startupMip);
+		}
+
+		if (changes.size() + victimCount + 1 > maxChanges)
+			break;
+
+		for (size_t v = 0; v < victimCount; v++)
+		{
+			StartChange(victims[v], textures[victims[v]].startupMip, false, changes);
+			stats.evictions++;
+		}
+		StartChange(index, firstMip, true, changes);
+	}
+}
+
+void TextureStreamer::Complete(unsigned int texture, unsigned int firstMip)
+{
+	Texture& t = textures[texture];
+	if (!t.changing || t.removed)
+		return;
+
+	// Gave up part way, so the memory counted for it isn't used after all
+	if (firstMip != t.pendingMip)
+		residentBytes = residentBytes - MipChainBytes(t, t.pendingMip) + MipChainBytes(t, firstMip);
+
+	t.residentMip = firstMip;
+	t.pendingMip = firstMip;
+	t.changing = false;
+}
+
+TextureStreamStats TextureStreamer::GetStats()
+{
+	TextureStreamStats current = stats;
+	current.residentBytes = residentBytes;
+	current.textures = 0;
+	current.texturesAtFullDetail = 0;
+	for (const Texture& t : textures)
+	{
+		if (t.removed)
+			continue;
+
+		current.textures++;
+		if (t.residentMip == 0)
+			current.texturesAtFullDetail++;
+	}
+	return current;
+}
+
+unsigned long long TextureStreamer::MipChainBytes(const Texture& texture, unsigned int firstMip)
+{
+	unsigned long long bytes = 0;
+	for (unsigned int m = firstMip; m < texture.mipCount; m++)
+	{
+		unsigned long long width = texture.width >> m;
+		unsigned long long height = texture.height >> m;
+		bytes += ((width > 0 ? width : 1) * (height > 0 ? height : 1) * texture.bitsPerPixel + 7) / 8;
+	}
+	return bytes;
+}
+
+void TextureStreamer::StartChange(unsigned int texture, unsigned int firstMip, bool promotion, std::vector<TextureStreamChange>& changes)
+{
+	Texture& t = textures[texture];
+	residentBytes = residentBytes - MipChainBytes(t, t.residentMip) + MipChainBytes(t, firstMip);
+	t.pendingMip = firstMip;
+	t.changing = true;
+
+	TextureStreamChange change = { texture, firstMip, promotion };
+	changes.push_back(change);
+	if (promotion)
+		stats.promotions++;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <vector>
+
+// A texture's resident mips changing, as decided by TextureStreamer
+struct TextureStreamChange
+{
+	unsigned int texture;
+	unsigned int firstMip;		// Finest mip that should be resident
+	bool promotion;				// More detail, or less to save memory
+};
+
+struct TextureStreamStats
+{
+	unsigned long long budgetBytes = 0;
+	unsigned long long residentBytes = 0;	// Including changes still in flight
+	unsigned int textures = 0;
+	unsigned int texturesAtFullDetail = 0;
+	unsigned int promotions = 0;			// Started so far
+	unsigned int evictions = 0;
+	unsigned int deferred = 0;				// Promotions held back by the budget
+};
+
+// --------------------------------------------------------
+// Decides which mips of each streamed texture should be
+// resident, within a memory budget
+//
+// Each frame, draws say how much detail they'd like from
+// a texture (see MipForScreenSize()). Update() turns that
+// into changes: textures that want finer mips than they
+// have are promoted, most recently requested first, and
+// when that would go over budget the textures that were
+// requested least recently drop back to their startup
+// mips to make room. Textures no one has asked for in a
+// while are dropped back too.
+//
+// Mip 0 is always the full size image. Every texture keeps
+// at least its coarsest startup mips. Nothing here touches
+// the GPU; the caller carries out each change and reports
+// back with Complete().
+// --------------------------------------------------------
+class TextureStreamer
+{
+public:
+
+	TextureStreamer(unsigned long long budgetBytes = 0, unsigned int startupMips = 1, unsigned int idleFrames = 0);
+	void Reset(unsigned long long budgetBytes, unsigned int startupMips, unsigned int idleFrames);
+
+	// Registers a texture and returns its id. Its startup mips
+	// (the coarsest startupMips of the chain) are assumed resident.
+	unsigned int Add(unsigned int width, unsigned int height, unsigned int bitsPerPixel);
+	void Remove(unsigned int texture);
+	unsigned int GetStartupMip(unsigned int texture);
+	unsigned int GetMipCount(unsigned int texture);
+
+	// Mips in a full chain for a texture of this size, and the
+	// finest of them a texture starts with
+	static unsigned int MipCount(unsigned int width, unsigned int height);
+	static unsigned int StartupMip(unsigned int width, unsigned int height, unsigned int startupMips);
+
+	// Finest mip worth having when the texture covers about
+	// screenPixels across, for a texture of the given size
+	static unsigned int MipForScreenSize(unsigned int width, unsigned int height, float screenPixels);
+
+	// Asks for at least this much detail from a texture this frame
+	// (frames are numbered from 1, and only ever go up)
+	void Request(unsigned int texture, unsigned int mip, unsigned long long frame);
+
+	// Works out what should change, starting at most maxChanges
+	// (textures with a change in flight are left alone)
+	void Update(unsigned long long frame, unsigned int maxChanges, std::vector<TextureStreamChange>& changes);
+
+	// The change for this texture is done (or gave up, if firstMip is
+	// what was already resident) and its mips are now resident
+	void Complete(unsigned int texture, unsigned int firstMip);
+
+	TextureStreamStats GetStats();
+
+private:
+
+	struct Texture
+	{
+		unsigned int width;
+		unsigned int height;
+		unsigned int bitsPerPixel;		// 4 or 8 for block compressed textures
+		unsigned int mipCount;
+		unsigned int startupMip;
+		unsigned int residentMip;		// Finest mip resident now
+		unsigned int pendingMip;		// Finest mip once its change is done
+		unsigned int requestedMip;		// Finest mip asked for in lastRequestFrame
+		unsigned long long lastRequestFrame;
+		bool changing;
+		bool removed;
+	};
+
+	unsigned long long budgetBytes;
+	unsigned int startupMips;
+	unsigned int idleFrames;
+	unsigned long long residentBytes;
+	std::vector<Texture> textures;
+	TextureStreamStats stats;
+
+	unsigned long long MipChainBytes(const Texture& texture, unsigned int firstMip);
+	void StartChange(unsigned int texture, unsigned int firstMip, bool promotion, std::vector<TextureStreamChange>& changes);
+};
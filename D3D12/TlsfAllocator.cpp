@@ -0,0 +1,324 @@
+#include "TlsfAllocator.h"
+
+#include <algorithm>
+#include <bit>
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	inline unsigned long long AlignUp(unsigned long long value, unsigned long long alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	inline unsigned int Log2(unsigned long long value)
+	{
+		return (unsigned int)std::bit_width(value) - 1;
+	}
+}
+
+float TlsfStats::Fragmentation() const
+{
+	return freeBytes == 0 ? 0.0f : 1.0f - (float)((double)largestFree / (double)freeBytes);
+}
+
+TlsfAllocator::TlsfAllocator(unsigned long long capacity)
+{
+	Reset(capacity);
+}
+
+void TlsfAllocator::Reset(unsigned long long capacity)
+{
+	this->capacity = capacity;
+	usedBytes = 0;
+	allocationCount = 0;
+	freeRangeCount = 0;
+
+	blocks.clear();
+	unusedBlocks.clear();
+	firstLevelMask = 0;
+	for (unsigned int fl = 0; fl < FirstLevelCount; fl++)
+	{
+		secondLevelMasks[fl] = 0;
+		for (unsigned int sl = 0; sl < SecondLevelCount; sl++)
+			freeHeads[fl][sl] = None;
+	}
+
+	if (capacity > 0)
+		InsertFree(NewBlock(0, capacity));
+}
+
+// --------------------------------------------------------
+// Takes a free range from the smallest class that fits,
+// then trims off whatever's left on either side of
+// the aligned allocation and puts it back as free ranges.
+//
+// size       - Bytes needed (0 is treated as 1)
+// alignment  - Power of two the offset must be a multiple of
+// allocation - Receives the range, needed later to free it
+// --------------------------------------------------------
+bool TlsfAllocator::Allocate(unsigned long long size, unsigned long long alignment, TlsfAllocation& allocation)
+{
+	if (size == 0) size = 1;
+	if (alignment == 0) alignment = 1;
+	if (size > capacity)
+		return false;
+
+	unsigned int block = FindFree(size, alignment);
+	if (block == None)
+		return false;
+
+	RemoveFree(block);
+
+	unsigned long long padding = AlignUp(blocks[block].offset, alignment) - blocks[block].offset;
+	if (padding > 0)
+	{
+		unsigned int rest = SplitFront(block, padding);
+		InsertFree(block);
+		block = rest;
+	}
+
+	if (blocks[block].size > size)
+		InsertFree(SplitFront(block, size));
+
+	usedBytes += size;
+	allocationCount++;
+
+	allocation.offset = blocks[block].offset;
+	allocation.size = size;
+	allocation.block = block;
+	return true;
+}
+
+// --------------------------------------------------------
+// Returns a range, merging it with any free neighbors so
+// free space never stays split along old boundaries
+// --------------------------------------------------------
+void TlsfAllocator::Free(const TlsfAllocation& allocation)
+{
+	unsigned int block = allocation.block;
+	if (block >= blocks.size() || blocks[block].free)
+		return;
+
+	usedBytes -= blocks[block].size;
+	allocationCount--;
+
+	unsigned int prev = blocks[block].prevPhysical;
+	if (prev != None && blocks[prev].free)
+	{
+		RemoveFree(prev);
+		blocks[prev].size += blocks[block].size;
+		blocks[prev].nextPhysical = blocks[block].nextPhysical;
+		if (blocks[block].nextPhysical != None)
+			blocks[blocks[block].nextPhysical].prevPhysical = prev;
+
+		unusedBlocks.push_back(block);
+		block = prev;
+	}
+
+	unsigned int next = blocks[block].nextPhysical;
+	if (next != None && blocks[next].free)
+	{
+		RemoveFree(next);
+		blocks[block].size += blocks[next].size;
+		blocks[block].nextPhysical = blocks[next].nextPhysical;
+		if (blocks[next].nextPhysical != None)
+			blocks[blocks[next].nextPhysical].prevPhysical = block;
+
+		unusedBlocks.push_back(next);
+	}
+
+	InsertFree(block);
+}
+
+bool TlsfAllocator::IsEmpty() { return allocationCount == 0; }
+unsigned long long TlsfAllocator::GetCapacity() { return capacity; }
+
+TlsfStats TlsfAllocator::GetStats()
+{
+	TlsfStats stats;
+	stats.capacity = capacity;
+	stats.usedBytes = usedBytes;
+	stats.freeBytes = capacity - usedBytes;	// Alignment gaps go back as free ranges
+	stats.allocations = allocationCount;
+	stats.freeRanges = freeRangeCount;
+
+	// Only the highest non-empty class can hold the largest range
+	if (firstLevelMask != 0)
+	{
+		unsigned int fl = Log2(firstLevelMask);
+		unsigned int sl = Log2(secondLevelMasks[fl]);
+		for (unsigned int b = freeHeads[fl][sl]; b != None; b = blocks[b].nextFree)
+			stats.largestFree = std::max(stats.largestFree, blocks[b].size);
+	}
+
+	return stats;
+}
+
+unsigned int TlsfAllocator::NewBlock(unsigned long long offset, unsigned long long size)
+{
+	Block block = { offset, size, None, None, None, None, false };
+	if (!unusedBlocks.empty())
+	{
+		unsigned int index = unusedBlocks.back();
+		unusedBlocks.pop_back();
+		blocks[index] = block;
+		return index;
+	}
+
+	blocks.push_back(block);
+	return (unsigned int)blocks.size() - 1;
+}
+
+// --------------------------------------------------------
+// Free ranges are filed under the class their size falls
+// in (rounding down), so everything in a class is at least
+// as big as the class's smallest size
+// --------------------------------------------------------
+void TlsfAllocator::InsertFree(unsigned int block)
+{
+	unsigned int fl, sl;
+	MapSize(blocks[block].size, fl, sl);
+
+	unsigned int head = freeHeads[fl][sl];
+	blocks[block].free = true;
+	blocks[block].prevFree = None;
+	blocks[block].nextFree = head;
+	if (head != None)
+		blocks[head].prevFree = block;
+
+	freeHeads[fl][sl] = block;
+	secondLevelMasks[fl] |= 1u << sl;
+	firstLevelMask |= 1ull << fl;
+	freeRangeCount++;
+}
+
+void TlsfAllocator::RemoveFree(unsigned int block)
+{
+	unsigned int fl, sl;
+	MapSize(blocks[block].size, fl, sl);
+
+	unsigned int prev = blocks[block].prevFree;
+	unsigned int next = blocks[block].nextFree;
+	if (prev != None) blocks[prev].nextFree = next;
+	if (next != None) blocks[next].prevFree = prev;
+
+	if (freeHeads[fl][sl] == block)
+	{
+		freeHeads[fl][sl] = next;
+		if (next == None)
+		{
+			secondLevelMasks[fl] &= ~(1u << sl);
+			if (secondLevelMasks[fl] == 0)
+				firstLevelMask &= ~(1ull << fl);
+		}
+	}
+
+	blocks[block].free = false;
+	freeRangeCount--;
+}
+
+// --------------------------------------------------------
+// Finds a free range that fits size bytes at the given
+// alignment. Usually that's the head of the first class
+// that's sure to fit, with no searching. Only when that
+// fails, or alignment gets in the way, does it walk the one
+// class whose ranges might fit or might not.
+// --------------------------------------------------------
+unsigned int TlsfAllocator::FindFree(unsigned long long size, unsigned long long alignment)
+{
+	unsigned int block = FindFreeClass(size);
+	if (block != None && Fits(block, size, alignment))
+		return block;
+
+	if (alignment > 1)
+	{
+		block = FindFreeClass(size + alignment - 1);
+		if (block != None)
+			return block;
+	}
+
+	unsigned int fl, sl;
+	MapSize(size, fl, sl);
+	for (block = freeHeads[fl][sl]; block != None; block = blocks[block].nextFree)
+	{
+		if (Fits(block, size, alignment))
+			return block;
+	}
+
+	return None;
+}
+
+// --------------------------------------------------------
+// Returns the head of the first non-empty class above the
+// one holding size, since every range in those classes is
+// at least size bytes - or None if there are none
+// --------------------------------------------------------
+unsigned int TlsfAllocator::FindFreeClass(unsigned long long size)
+{
+	if (size >= SecondLevelCount)
+		size += (1ull << (Log2(size) - SecondLevelBits)) - 1;
+
+	unsigned int fl, sl;
+	MapSize(size, fl, sl);
+
+	unsigned int secondLevelMask = secondLevelMasks[fl] & (~0u << sl);
+	if (secondLevelMask == 0)
+	{
+		unsigned long long firstLevel = fl + 1 < FirstLevelCount ? firstLevelMask & (~0ull << (fl + 1)) : 0;
+		if (firstLevel == 0)
+			return None;
+
+		fl = (unsigned int)std::countr_zero(firstLevel);
+		secondLevelMask = secondLevelMasks[fl];
+	}
+
+	sl = (unsigned int)std::countr_zero(secondLevelMask);
+	return freeHeads[fl][sl];
+}
+
+// --------------------------------------------------------
+// Picks the class a size belongs to: sizes below 16 get a
+// class each, larger ones go by their highest set bit and
+// the four bits below it
+// --------------------------------------------------------
+void TlsfAllocator::MapSize(unsigned long long size, unsigned int& fl, unsigned int& sl)
+{
+	if (size < SecondLevelCount)
+	{
+		fl = 0;
+		sl = (unsigned int)size;
+		return;
+	}
+
+	unsigned int log = Log2(size);
+	fl = log - SecondLevelBits + 1;
+	sl = (unsigned int)(size >> (log - SecondLevelBits)) ^ SecondLevelCount;
+}
+
+bool TlsfAllocator::Fits(unsigned int block, unsigned long long size, unsigned long long alignment)
+{
+	return AlignUp(blocks[block].offset, alignment) + size <= blocks[block].offset + blocks[block].size;
+}
+
+// --------------------------------------------------------
+// Cuts a block in two, keeping the first size bytes and
+// returning the rest as a new block (not yet in any free
+// list), or None if there's nothing left over
+// --------------------------------------------------------
+unsigned int TlsfAllocator::SplitFront(unsigned int block, unsigned long long size)
+{
+	if (blocks[block].size <= size)
+		return None;
+
+	unsigned int rest = NewBlock(blocks[block].offset + size, blocks[block].size - size);
+	blocks[rest].prevPhysical = block;
+	blocks[rest].nextPhysical = blocks[block].nextPhysical;
+	if (blocks[block].nextPhysical != None)
+		blocks[blocks[block].nextPhysical].prevPhysical = rest;
+
+	blocks[block].nextPhysical = rest;
+	blocks[block].size = size;
+	return rest;
+}
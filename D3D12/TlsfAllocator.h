@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// A range handed out by TlsfAllocator
+struct TlsfAllocation
+{
+	unsigned long long offset = 0;
+	unsigned long long size = 0;
+	unsigned int block = 0xFFFFFFFF;	// Allocator's bookkeeping, needed to free it
+};
+
+struct TlsfStats
+{
+	unsigned long long capacity = 0;
+	unsigned long long usedBytes = 0;		// Requested sizes, not counting alignment gaps
+	unsigned long long freeBytes = 0;
+	unsigned long long largestFree = 0;
+	size_t allocations = 0;
+	size_t freeRanges = 0;
+
+	// 0 while all free space is one range, approaching 1 as it's
+	// scattered into pieces too small for big allocations
+	float Fragmentation() const;
+};
+
+// --------------------------------------------------------
+// Two-level segregated fit allocator over a range of offsets
+//
+// Free ranges are kept in size classes: one per power of
+// two, each split into 16 linear steps. Bitmasks of the
+// non-empty classes make finding a good fit, and freeing
+// (which merges with free neighbors), constant time no
+// matter how many allocations there are.
+//
+// Nothing here touches memory, so it can manage anything
+// addressed by offset - GPU heaps in particular (see
+// GpuMemory.h).
+// --------------------------------------------------------
+class TlsfAllocator
+{
+public:
+
+	TlsfAllocator(unsigned long long capacity = 0);
+
+	// Forgets every allocation and starts over with one free range
+	void Reset(unsigned long long capacity);
+
+	// Finds size bytes at an offset that's a multiple of alignment (a power of two)
+	bool Allocate(unsigned long long size, unsigned long long alignment, TlsfAllocation& allocation);
+	void Free(const TlsfAllocation& allocation);
+
+	bool IsEmpty();
+	unsigned long long GetCapacity();
+	TlsfStats GetStats();
+
+private:
+
+	static const unsigned int SecondLevelBits = 4;
+	static const unsigned int SecondLevelCount = 1 << SecondLevelBits;
+	static const unsigned int FirstLevelCount = 64;
+	static const unsigned int None = 0xFFFFFFFF;
+
+	// A range of offsets, linked to its neighbors in address order
+	// and, while free, to the other free ranges of its size class
+	struct Block
+	{
+		unsigned long long offset;
+		unsigned long long size;
+		unsigned int prevPhysical;
+		unsigned int nextPhysical;
+		unsigned int prevFree;
+		unsigned int nextFree;
+		bool free;
+	};
+
+	std::vector<Block> blocks;
+	std::vector<unsigned int> unusedBlocks;
+
+	unsigned long long firstLevelMask;
+	unsigned int secondLevelMasks[FirstLevelCount];
+	unsigned int freeHeads[FirstLevelCount][SecondLevelCount];
+
+	unsigned long long capacity;
+	unsigned long long usedBytes;
+	size_t allocationCount;
+	size_t freeRangeCount;
+
+	unsigned int NewBlock(unsigned long long offset, unsigned long long size);
+	void InsertFree(unsigned int block);
+	void RemoveFree(unsigned int block);
+	unsigned int FindFree(unsigned long long size, unsigned long long alignment);
+	unsigned int FindFreeClass(unsigned long long size);
+	void MapSize(unsigned long long size, unsigned int& fl, unsigned int& sl);
+	bool Fits(unsigned int block, unsigned long long size, unsigned long long alignment);
+	unsigned int SplitFront(unsigned int block, unsigned long long size);
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// The engine's performance measurements, run by EngineBench
+// rather than the game, so none of them ship in the game
+//
+// Each takes the rest of the command line after its name
+// and prints a table to the console. A benchmark returns
+// false if it couldn't run or a result didn't match what
+// it was checked against.
+// --------------------------------------------------------
+namespace Benchmarks
+{
+	typedef std::vector<std::string> Arguments;
+
+	// obj [file.obj ...] [-synthetic megabytes]
+	// MB/s of ObjLoader against the original loader, on the Basic Meshes
+	// (or the given files) and on a generated file (1024 MB by default)
+	bool ObjThroughput(const Arguments& args);
+
+	// objthreads [file.obj] [maxThreads]
+	// How ObjLoader's parse time scales from 1 to maxThreads threads (one per
+	// core by default), on the given file or a generated 256 MB one
+	bool ObjThreadScaling(const Arguments& args);
+
+	// tangents [file.obj] [maxThreads]
+	// The reference tangent generation against the SSE one at 1 to maxThreads
+	// threads, on the given file or a generated 64 MB one
+	bool TangentScaling(const Arguments& args);
+
+	// entities [count] [maxThreads]
+	// CPU cost of recording a frame of count entities (10000 by default), on
+	// one thread and split over 1 to maxThreads, with Parallel's worker pool
+	// against spawning threads every frame
+	bool EntityScaling(const Arguments& args);
+
+	// meshopt [file.obj ...]
+	// ACMR and ATVR of the simulated vertex cache before and after MeshOptimizer,
+	// on the Basic Meshes (or the given files) and a shuffled grid
+	bool MeshOptimization(const Arguments& args);
+
+	// heap [operations]
+	// Speed and fragmentation of TlsfAllocator on a random GPU-heap-like load
+	bool TlsfWorkload(const Arguments& args);
+
+	// zones [count]
+	// Cost of opening and closing a CPU zone, and of collecting it, over count
+	// zones (a million by default) on one thread
+	bool ZoneCost(const Arguments& args);
+}
@@ -0,0 +1,59 @@
+#include "Benchmarks.h"
+
+#include <cstdio>
+#include <cstring>
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	struct Benchmark
+	{
+		const char* name;
+		bool (*run)(const Benchmarks::Arguments& args);
+		const char* usage;
+	};
+
+	const Benchmark benchmarks[] =
+	{
+		{ "obj", Benchmarks::ObjThroughput, "obj [file.obj ...] [-synthetic megabytes]" },
+		{ "objthreads", Benchmarks::ObjThreadScaling, "objthreads [file.obj] [maxThreads]" },
+		{ "tangents", Benchmarks::TangentScaling, "tangents [file.obj] [maxThreads]" },
+		{ "entities", Benchmarks::EntityScaling, "entities [count] [maxThreads]" },
+		{ "meshopt", Benchmarks::MeshOptimization, "meshopt [file.obj ...]" },
+		{ "heap", Benchmarks::TlsfWorkload, "heap [operations]" },
+		{ "zones", Benchmarks::ZoneCost, "zones [count]" },
+	};
+
+	void PrintUsage()
+	{
+		printf("Usage: EngineBench <benchmark> [arguments]\n");
+		for (const Benchmark& benchmark : benchmarks)
+			printf("  %s\n", benchmark.usage);
+	}
+}
+
+// --------------------------------------------------------
+// Runs the benchmark named by the first argument
+// --------------------------------------------------------
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	for (const Benchmark& benchmark : benchmarks)
+	{
+		if (strcmp(argv[1], benchmark.name) != 0)
+			continue;
+
+		Benchmarks::Arguments args(argv + 2, argv + argc);
+		return benchmark.run(args) ? 0 : 1;
+	}
+
+	printf("Unknown benchmark %s\n", argv[1]);
+	PrintUsage();
+	return 1;
+}
@@ -0,0 +1,255 @@
+#include "Benchmarks.h"
+#include "BufferStructs.h"
+#include "LodSelector.h"
+#include "Meshlets.h"
+#include "MeshSimplifier.h"
+#include "ObjLoader.h"
+#include "Parallel.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <thread>
+
+using namespace DirectX;
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// What draw recording needs from a mesh on the CPU
+	struct BenchMesh
+	{
+		float radius = 0;
+		std::vector<MeshLod> lods;
+		MeshletData meshlets;
+	};
+
+	struct BenchEntity
+	{
+		const BenchMesh* mesh;
+		XMFLOAT3 position;
+		float scale;
+	};
+
+	// One thread's share of a frame, like Game's DrawChunk
+	struct BenchChunk
+	{
+		std::vector<unsigned char> uploads;
+		std::vector<unsigned int> culledIndices;
+		size_t indicesDrawn = 0;
+	};
+
+	bool LoadMesh(const char* file, BenchMesh& mesh)
+	{
+		std::vector<Vertex> verts;
+		std::vector<unsigned int> indices;
+		std::vector<SubMesh> subMeshes;
+		std::vector<std::string> materialNames;
+		std::wstring path = (std::filesystem::path(ASSET_DIRECTORY) / "Basic Meshes" / file).wstring();
+		if (!ObjLoader::LoadFile(path.c_str(), verts, indices, subMeshes, materialNames) || indices.empty())
+			return false;
+
+		for (const Vertex& v : verts)
+		{
+			float distance = std::sqrt(v.Position.x * v.Position.x + v.Position.y * v.Position.y + v.Position.z * v.Position.z);
+			if (distance > mesh.radius)
+				mesh.radius = distance;
+		}
+
+		unsigned int indexCount = (unsigned int)indices.size();
+		mesh.lods = MeshSimplifier::BuildLodChain(verts.data(), verts.size(), indices, 0, indexCount,
+			MeshSimplifier::DefaultLodTargets, sizeof(MeshSimplifier::DefaultLodTargets) / sizeof(LodTarget));
+		if (indexCount / 3 >= Meshlets::MinTriangles)
+			Meshlets::Build(verts.data(), verts.size(), indices.data(), indexCount, mesh.meshlets);
+		return true;
+	}
+
+	// A left-handed perspective projection, as XMMatrixPerspectiveFovLH makes
+	XMFLOAT4X4 Perspective(float fovY, float aspect, float nearZ, float farZ)
+	{
+		XMFLOAT4X4 m = {};
+		float yScale = 1.0f / std::tan(fovY * 0.5f);
+		m._11 = yScale / aspect;
+		m._22 = yScale;
+		m._33 = farZ / (farZ - nearZ);
+		m._34 = 1.0f;
+		m._43 = -nearZ * farZ / (farZ - nearZ);
+		return m;
+	}
+
+	XMFLOAT4X4 Identity()
+	{
+		XMFLOAT4X4 m = {};
+		m._11 = m._22 = m._33 = m._44 = 1.0f;
+		return m;
+	}
+
+	// --------------------------------------------------------
+	// The CPU side of Game::RecordDraws for some entities: the
+	// per-draw constants copied into upload memory, the LOD
+	// pick, and meshlet culling at full detail
+	// --------------------------------------------------------
+	void RecordEntities(BenchChunk& chunk, const BenchEntity* entities, size_t count, const VSExternalData& frameData)
+	{
+		const size_t constantSize = (sizeof(VSExternalData) + 255) / 256 * 256;
+		if (chunk.uploads.size() < count * constantSize)
+			chunk.uploads.resize(count * constantSize);
+
+		VSExternalData data = frameData;
+		XMFLOAT3 cameraPosition(0, 0, 0);
+		chunk.indicesDrawn = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			const BenchEntity& e = entities[i];
+
+			// Scale then translate, and its inverse transpose
+			data.world = Identity();
+			data.world._11 = data.world._22 = data.world._33 = e.scale;
+			data.world._41 = e.position.x;
+			data.world._42 = e.position.y;
+			data.world._43 = e.position.z;
+			data.worldInverseTranspose = Identity();
+			data.worldInverseTranspose._11 = data.worldInverseTranspose._22 = data.worldInverseTranspose._33 = 1.0f / e.scale;
+			data.worldInverseTranspose._14 = -e.position.x / e.scale;
+			data.worldInverseTranspose._24 = -e.position.y / e.scale;
+			data.worldInverseTranspose._34 = -e.position.z / e.scale;
+			memcpy(chunk.uploads.data() + i * constantSize, &data, sizeof(data));
+
+			const BenchMesh& mesh = *e.mesh;
+			float screenRadius = LodSelector::ScreenRadius(e.position, mesh.radius * e.scale, data.view, data.proj, 1080.0f);
+			unsigned int lodIndex = LodSelector::Select(mesh.lods.data(), mesh.lods.size(), mesh.radius, screenRadius);
+			if (lodIndex == 0 && !mesh.meshlets.meshlets.empty())
+			{
+				MeshletCullView cullView = Meshlets::MakeCullView(data.world, data.view, data.proj, cameraPosition);
+				chunk.indicesDrawn += Meshlets::Cull(mesh.meshlets, 0, (unsigned int)mesh.meshlets.meshlets.size(), cullView, chunk.culledIndices);
+			}
+			else
+			{
+				chunk.indicesDrawn += mesh.lods[lodIndex].indexCount;
+			}
+		}
+	}
+
+	// How Parallel::Run used to work: new threads every call
+	template<typename Work>
+	void SpawnRun(size_t count, Work work)
+	{
+		std::vector<std::thread> threads;
+		for (size_t i = 1; i < count; i++)
+			threads.emplace_back(work, i);
+
+		if (count > 0)
+			work(0);
+		for (std::thread& t : threads)
+			t.join();
+	}
+}
+
+// --------------------------------------------------------
+// Records a crowd of entities the way the game does, split
+// into one chunk per thread, and times a frame of it with
+// the worker pool against spawning threads every frame.
+// Both have to draw the same number of indices.
+// --------------------------------------------------------
+bool Benchmarks::EntityScaling(const Arguments& args)
+{
+	size_t entityCount = args.size() > 0 ? (size_t)strtoull(args[0].c_str(), 0, 10) : 10000;
+	unsigned int maxThreads = args.size() > 1 ? (unsigned int)strtoul(args[1].c_str(), 0, 10) : 0;
+	if (maxThreads == 0)
+		maxThreads = Parallel::HardwareThreads();
+	if (entityCount == 0)
+		entityCount = 10000;
+
+	// Mostly low-poly spheres, with dense helixes that get meshlet culled
+	BenchMesh sphere, helix;
+	if (!LoadMesh("sphere.obj", sphere) || !LoadMesh("helix.obj", helix))
+	{
+		printf("Could not load the Basic Meshes\n");
+		return false;
+	}
+
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> spread(-50.0f, 50.0f);
+	std::uniform_real_distribution<float> depth(2.0f, 100.0f);
+	std::uniform_real_distribution<float> size(0.05f, 3.0f);
+	std::vector<BenchEntity> entities(entityCount);
+	for (size_t i = 0; i < entityCount; i++)
+	{
+		entities[i].mesh = i % 4 == 0 ? &helix : &sphere;
+		entities[i].position = XMFLOAT3(spread(random), spread(random) * 0.2f, depth(random));
+		entities[i].scale = size(random);
+	}
+
+	VSExternalData frameData = {};
+	frameData.view = Identity();
+	frameData.proj = Perspective(3.14159265f / 4.0f, 16.0f / 9.0f, 0.1f, 1000.0f);
+
+	std::vector<BenchChunk> chunks(maxThreads);
+	auto frame = [&](unsigned int threads, auto run)
+		{
+			size_t chunkSize = (entityCount + threads - 1) / threads;
+			run(threads, [&](size_t c)
+				{
+					size_t first = c * chunkSize;
+					size_t count = first < entityCount ? entityCount - first : 0;
+					RecordEntities(chunks[c], entities.data() + first, count < chunkSize ? count : chunkSize, frameData);
+				});
+
+			size_t indices = 0;
+			for (unsigned int c = 0; c < threads; c++)
+				indices += chunks[c].indicesDrawn;
+			return indices;
+		};
+
+	// Milliseconds per frame, as the best of several runs of many frames
+	const int runs = 5;
+	const int frames = 50;
+	size_t expectedIndices = 0;
+	bool matched = true;
+	auto time = [&](unsigned int threads, auto run)
+		{
+			double best = 0.0;
+			for (int r = 0; r < runs; r++)
+			{
+				auto startTime = std::chrono::steady_clock::now();
+				for (int f = 0; f < frames; f++)
+				{
+					size_t indices = frame(threads, run);
+					if (expectedIndices == 0)
+						expectedIndices = indices;
+					matched = matched && indices == expectedIndices;
+				}
+				double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count() / frames;
+				if (r == 0 || seconds < best)
+					best = seconds;
+			}
+			return best * 1000.0;
+		};
+
+	auto pool = [](size_t count, auto work) { Parallel::Run(count, work); };
+	auto spawn = [](size_t count, auto work) { SpawnRun(count, work); };
+	auto loop = [](size_t count, auto work) { for (size_t i = 0; i < count; i++) work(i); };
+
+	printf("Recording %zu entities (%zu helixes): %u hardware threads, %u pool workers\n",
+		entityCount, (entityCount + 3) / 4, Parallel::HardwareThreads(), Parallel::WorkerCount());
+	double single = time(1, loop);
+	printf("  single thread   %9.3f ms per frame\n", single);
+	printf("  %7s  %14s  %14s  %10s\n", "threads", "pool ms", "spawn ms", "pool gain");
+	for (unsigned int threads = 1; threads <= maxThreads; threads++)
+	{
+		double pooled = time(threads, pool);
+		double spawned = time(threads, spawn);
+		printf("  %7u  %8.3f %4.2fx  %8.3f %4.2fx  %9.3f ms\n",
+			threads, pooled, single / pooled, spawned, single / spawned, spawned - pooled);
+	}
+	printf("  %zu indices drawn per frame\n", expectedIndices);
+
+	if (!matched)
+		printf("Error: thread counts disagree on what was drawn\n");
+	return matched;
+}
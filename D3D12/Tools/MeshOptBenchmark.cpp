@@ -0,0 +1,120 @@
+#include "Benchmarks.h"
+#include "MeshOptimizer.h"
+#include "ObjLoader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// A flat size x size grid of quads, with its triangles in a random order
+	// so there's no reuse to start with
+	void ShuffledGrid(unsigned int size, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+	{
+		verts.assign((size_t)(size + 1) * (size + 1), Vertex());
+		for (unsigned int y = 0; y <= size; y++)
+		{
+			for (unsigned int x = 0; x <= size; x++)
+			{
+				Vertex& v = verts[(size_t)y * (size + 1) + x];
+				v.Position = DirectX::XMFLOAT3((float)x, (float)y, 0.0f);
+				v.Normal = DirectX::XMFLOAT3(0.0f, 0.0f, -1.0f);
+				v.UV = DirectX::XMFLOAT2((float)x / size, (float)y / size);
+			}
+		}
+
+		std::vector<unsigned int> quads((size_t)size * size);
+		for (unsigned int q = 0; q < quads.size(); q++)
+			quads[q] = q;
+		std::shuffle(quads.begin(), quads.end(), std::mt19937(1234));
+
+		indices.clear();
+		for (unsigned int q : quads)
+		{
+			unsigned int corner = (q / size) * (size + 1) + q % size;
+			unsigned int quad[6] = { corner, corner + size + 1, corner + 1, corner + 1, corner + size + 1, corner + size + 2 };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+
+	// One row of the table: the mesh as loaded, after the vertex cache
+	// pass alone and after every pass, with how long those took
+	void Measure(const char* label, const std::vector<Vertex>& loadedVerts, const std::vector<unsigned int>& loadedIndices,
+		const std::vector<SubMesh>& subMeshes)
+	{
+		VertexCacheStats before = MeshOptimizer::SimulateVertexCache(loadedIndices.data(), loadedIndices.size(), loadedVerts.size());
+
+		std::vector<unsigned int> indices = loadedIndices;
+		auto startTime = std::chrono::steady_clock::now();
+		MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), loadedVerts.size());
+		std::chrono::duration<double> cacheSeconds = std::chrono::steady_clock::now() - startTime;
+		VertexCacheStats cacheOnly = MeshOptimizer::SimulateVertexCache(indices.data(), indices.size(), loadedVerts.size());
+
+		std::vector<Vertex> verts = loadedVerts;
+		indices = loadedIndices;
+		startTime = std::chrono::steady_clock::now();
+		MeshOptimizer::Optimize(verts, indices, subMeshes);
+		std::chrono::duration<double> allSeconds = std::chrono::steady_clock::now() - startTime;
+		VertexCacheStats after = MeshOptimizer::SimulateVertexCache(indices.data(), indices.size(), verts.size());
+
+		printf("  %-24s %8zu  %5.3f %5.3f  %5.3f %5.3f %8.2f  %5.3f %5.3f %8.2f\n",
+			label, loadedIndices.size() / 3,
+			before.acmr, before.atvr,
+			cacheOnly.acmr, cacheOnly.atvr, cacheSeconds.count() * 1000.0,
+			after.acmr, after.atvr, allSeconds.count() * 1000.0);
+	}
+}
+
+// --------------------------------------------------------
+// Reports what MeshOptimizer does for the post-transform
+// cache: ACMR and ATVR (see VertexCacheStats) as loaded,
+// after OptimizeVertexCache and after every pass, on the
+// Basic Meshes (or the given files) and on a shuffled grid.
+// EngineTests checks the passes on a smaller grid.
+// --------------------------------------------------------
+bool Benchmarks::MeshOptimization(const Arguments& args)
+{
+	std::vector<std::filesystem::path> files;
+	for (const std::string& arg : args)
+		files.push_back(arg);
+	if (files.empty())
+	{
+		const char* meshes[] = { "cube.obj", "cylinder.obj", "helix.obj", "quad.obj", "quad_double_sided.obj", "sphere.obj", "torus.obj" };
+		for (const char* mesh : meshes)
+			files.push_back(std::filesystem::path(ASSET_DIRECTORY) / "Basic Meshes" / mesh);
+	}
+
+	printf("Simulated %u entry FIFO cache\n", MeshOptimizer::SimulatedCacheSize);
+	printf("  %-24s %8s  %-11s  %-20s  %-20s\n", "", "", "Loaded", "Vertex cache pass", "All passes");
+	printf("  %-24s %8s  %5s %5s  %5s %5s %8s  %5s %5s %8s\n", "Mesh", "Tris", "ACMR", "ATVR", "ACMR", "ATVR", "ms", "ACMR", "ATVR", "ms");
+
+	bool allLoaded = true;
+	for (const std::filesystem::path& file : files)
+	{
+		std::vector<Vertex> verts;
+		std::vector<unsigned int> indices;
+		std::vector<SubMesh> subMeshes;
+		std::vector<std::string> materialNames;
+		std::wstring fileName = file.wstring();
+		std::string label = file.filename().string();
+		if (!ObjLoader::LoadFile(fileName.c_str(), verts, indices, subMeshes, materialNames) || indices.empty())
+		{
+			printf("  %-24s could not load\n", label.c_str());
+			allLoaded = false;
+			continue;
+		}
+		Measure(label.c_str(), verts, indices, subMeshes);
+	}
+
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	ShuffledGrid(256, verts, indices);
+	Measure("shuffled 256x256 grid", verts, indices, std::vector<SubMesh>());
+	return allLoaded;
+}
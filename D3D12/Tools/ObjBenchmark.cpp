@@ -0,0 +1,199 @@
+#include "Benchmarks.h"
+#include "../Tests/ObjReference.h"
+#include "MappedFile.h"
+#include "ObjLoader.h"
+#include "Parallel.h"
+
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// Best of several runs for small files, one run for big ones
+	template<typename Load>
+	double BestSeconds(unsigned long long fileBytes, Load load)
+	{
+		int runs = fileBytes < 64ull * 1024 * 1024 ? 5 : 1;
+		double best = 0.0;
+		for (int run = 0; run < runs; run++)
+		{
+			auto startTime = std::chrono::steady_clock::now();
+			if (!load())
+				return -1.0;
+			std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - startTime;
+			if (run == 0 || seconds.count() < best)
+				best = seconds.count();
+		}
+		return best;
+	}
+
+	bool MeasureFile(const std::filesystem::path& path, const char* label)
+	{
+		std::error_code error;
+		unsigned long long bytes = std::filesystem::file_size(path, error);
+		if (error)
+		{
+			printf("  %-24s could not open\n", label);
+			return false;
+		}
+
+		std::vector<Vertex> verts;
+		std::vector<unsigned int> indices;
+		std::vector<SubMesh> subMeshes;
+		std::vector<std::string> materialNames;
+		std::wstring fileName = path.wstring();
+
+		double reference = BestSeconds(bytes, [&]() { return ObjReference::LoadFile(path, verts, indices); });
+		size_t referenceTriangles = indices.size() / 3;
+		double loader = BestSeconds(bytes, [&]() { return ObjLoader::LoadFile(fileName.c_str(), verts, indices, subMeshes, materialNames); });
+		if (reference < 0.0 || loader < 0.0)
+		{
+			printf("  %-24s failed to load\n", label);
+			return false;
+		}
+
+		double megabytes = bytes / (1024.0 * 1024.0);
+		bool sameTriangles = indices.size() / 3 == referenceTriangles;
+		printf("  %-24s %9.2f %14.1f %14.1f %8.2fx   %s\n",
+			label, megabytes, megabytes / reference, megabytes / loader, reference / loader,
+			sameTriangles ? "same triangles" : "TRIANGLE MISMATCH");
+		return sameTriangles;
+	}
+
+	// Writes a synthetic file to the temp folder, returning its path (or an empty one)
+	std::filesystem::path WriteSyntheticFile(unsigned long long megabytes)
+	{
+		std::filesystem::path synthetic = std::filesystem::temp_directory_path() / "EngineBenchSynthetic.obj";
+		std::ofstream out(synthetic, std::ios::binary);
+		ObjReference::WriteSynthetic(out, megabytes * 1024 * 1024);
+		if (!out)
+		{
+			printf("  Could not write %s\n", synthetic.string().c_str());
+			return std::filesystem::path();
+		}
+		return synthetic;
+	}
+}
+
+// --------------------------------------------------------
+// Loads each file with the original getline/sscanf loader
+// and then with ObjLoader, and prints the throughput of each
+// --------------------------------------------------------
+bool Benchmarks::ObjThroughput(const Arguments& args)
+{
+	std::vector<std::filesystem::path> files;
+	unsigned long long syntheticMegabytes = 1024;
+	for (size_t i = 0; i < args.size(); i++)
+	{
+		if (args[i] == "-synthetic" && i + 1 < args.size())
+			syntheticMegabytes = strtoull(args[++i].c_str(), 0, 10);
+		else
+			files.push_back(args[i]);
+	}
+
+	if (files.empty())
+	{
+		const char* meshes[] = { "cube.obj", "cylinder.obj", "helix.obj", "quad.obj", "quad_double_sided.obj", "sphere.obj", "torus.obj" };
+		for (const char* mesh : meshes)
+			files.push_back(std::filesystem::path(ASSET_DIRECTORY) / "Basic Meshes" / mesh);
+	}
+
+	printf("OBJ load throughput\n");
+	printf("  %-24s %9s %14s %14s %9s\n", "file", "MB", "original MB/s", "ObjLoader MB/s", "speedup");
+	bool allMatched = true;
+	for (const std::filesystem::path& file : files)
+		allMatched = MeasureFile(file, file.filename().string().c_str()) && allMatched;
+
+	if (syntheticMegabytes > 0)
+	{
+		std::filesystem::path synthetic = WriteSyntheticFile(syntheticMegabytes);
+		if (synthetic.empty())
+			return false;
+
+		allMatched = MeasureFile(synthetic, "synthetic") && allMatched;
+		std::filesystem::remove(synthetic);
+	}
+
+	return allMatched;
+}
+
+// --------------------------------------------------------
+// Parses a file with 1 through maxThreads threads, printing
+// the best of several runs at each thread count and checking
+// that every result matches the 1 thread one
+// --------------------------------------------------------
+bool Benchmarks::ObjThreadScaling(const Arguments& args)
+{
+	unsigned int maxThreads = args.size() > 1 ? (unsigned int)strtoul(args[1].c_str(), 0, 10) : 0;
+	if (maxThreads == 0)
+		maxThreads = Parallel::HardwareThreads();
+
+	// Without a file, parse a generated one big enough to split many ways
+	std::filesystem::path path = args.empty() ? WriteSyntheticFile(256) : std::filesystem::path(args[0]);
+	if (path.empty())
+		return false;
+
+	std::wstring fileName = path.wstring();
+	MappedFile file(fileName.c_str());
+	if (!file.IsOpen())
+	{
+		printf("Could not open %s\n", path.string().c_str());
+		return false;
+	}
+
+	const int runs = 3;
+	double megabytes = file.GetSize() / (1024.0 * 1024.0);
+	printf("OBJ parse scaling for %s (%.2f MB)\n", path.filename().string().c_str(), megabytes);
+	printf("  threads   best ms      MB/s   speedup   output\n");
+
+	std::vector<Vertex> referenceVerts, verts;
+	std::vector<unsigned int> referenceIndices, indices;
+	std::vector<SubMesh> referenceSubMeshes, subMeshes;
+	std::vector<std::string> materialNames;
+	double baseline = 0.0;
+	bool allIdentical = true;
+
+	for (unsigned int threads = 1; threads <= maxThreads; threads++)
+	{
+		double best = 0.0;
+		for (int run = 0; run < runs; run++)
+		{
+			auto startTime = std::chrono::steady_clock::now();
+			ObjLoader::Parse(file.GetData(), file.GetSize(), verts, indices, subMeshes, materialNames, threads);
+			std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - startTime;
+			if (run == 0 || seconds.count() < best)
+				best = seconds.count();
+		}
+
+		if (threads == 1)
+		{
+			baseline = best;
+			referenceVerts = verts;
+			referenceIndices = indices;
+			referenceSubMeshes = subMeshes;
+		}
+
+		bool identical =
+			verts.size() == referenceVerts.size() &&
+			indices.size() == referenceIndices.size() &&
+			subMeshes.size() == referenceSubMeshes.size() &&
+			memcmp(verts.data(), referenceVerts.data(), verts.size() * sizeof(Vertex)) == 0 &&
+			memcmp(indices.data(), referenceIndices.data(), indices.size() * sizeof(unsigned int)) == 0 &&
+			memcmp(subMeshes.data(), referenceSubMeshes.data(), subMeshes.size() * sizeof(SubMesh)) == 0;
+		allIdentical = allIdentical && identical;
+
+		printf("  %7u %9.2f %9.1f %8.2fx   %s\n",
+			threads, best * 1000.0, megabytes / best, baseline / best, identical ? "identical" : "MISMATCH");
+	}
+
+	file.Close();
+	if (args.empty())
+		std::filesystem::remove(path);
+	return allIdentical;
+}
@@ -0,0 +1,55 @@
+#include "SceneBenchmark.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// --------------------------------------------------------
+// Runs the headless scene benchmark, for perf tracking on
+// machines without a window or GPU (CI included):
+//
+//  SceneBenchmark [-frames n] [-warmup n] [-entities n]
+//                 [-seed n] [-delta seconds] [-out file.json]
+//
+// Same scene and report as the game's -benchmark option.
+// --------------------------------------------------------
+int main(int argc, char** argv)
+{
+	SceneBenchmarkSettings settings;
+	const char* reportFile = "Benchmark.json";
+	for (int i = 1; i < argc; i++)
+	{
+		if (i + 1 >= argc)
+		{
+			printf("Missing a value for %s\n", argv[i]);
+			return 1;
+		}
+
+		const char* value = argv[++i];
+		if (strcmp(argv[i - 1], "-frames") == 0)
+			settings.frames = (unsigned int)strtoul(value, 0, 10);
+		else if (strcmp(argv[i - 1], "-warmup") == 0)
+			settings.warmupFrames = (unsigned int)strtoul(value, 0, 10);
+		else if (strcmp(argv[i - 1], "-entities") == 0)
+			settings.entityCount = (unsigned int)strtoul(value, 0, 10);
+		else if (strcmp(argv[i - 1], "-seed") == 0)
+			settings.seed = (unsigned int)strtoul(value, 0, 10);
+		else if (strcmp(argv[i - 1], "-delta") == 0)
+			settings.deltaTime = strtod(value, 0);
+		else if (strcmp(argv[i - 1], "-out") == 0)
+			reportFile = value;
+		else
+		{
+			printf("Usage: SceneBenchmark [-frames n] [-warmup n] [-entities n] [-seed n] [-delta seconds] [-out file.json]\n");
+			return 1;
+		}
+	}
+
+	if (settings.frames == 0 || settings.entityCount == 0 || settings.deltaTime <= 0)
+	{
+		printf("Frames, entities and the delta time have to be more than 0\n");
+		return 1;
+	}
+
+	return SceneBenchmark::RunHeadless(settings, reportFile) ? 0 : 1;
+}
@@ -0,0 +1,24 @@
+# --------------------------------------------------------
+# A short SceneBenchmark run for CTest, so the headless
+# benchmark can't quietly stop working. Run as a script:
+#
+#  cmake -DBENCHMARK=<exe> -DREPORT=<file.json> -P SceneBenchmarkSmoke.cmake
+#
+# Fails unless the run exits with 0 and writes a report
+# with its frame times in it.
+# --------------------------------------------------------
+file(REMOVE "${REPORT}")
+execute_process(
+	COMMAND "${BENCHMARK}" -frames 20 -warmup 5 -entities 200 -out "${REPORT}"
+	RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+	message(FATAL_ERROR "SceneBenchmark exited with ${result}")
+endif()
+
+if(NOT EXISTS "${REPORT}")
+	message(FATAL_ERROR "SceneBenchmark didn't write ${REPORT}")
+endif()
+file(READ "${REPORT}" report)
+if(NOT report MATCHES "\"frames\":20" OR NOT report MATCHES "\"frameTime\"")
+	message(FATAL_ERROR "SceneBenchmark's report is missing its frame times:\n${report}")
+endif()
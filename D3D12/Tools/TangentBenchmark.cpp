@@ -0,0 +1,74 @@
+#include "Benchmarks.h"
+#include "../Tests/ObjReference.h"
+#include "ObjLoader.h"
+#include "Parallel.h"
+#include "Tangents.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <sstream>
+
+// --------------------------------------------------------
+// Times the reference tangent generation, then the SSE one
+// at every thread count, as the best of several runs each.
+// EngineTests checks that the two agree.
+// --------------------------------------------------------
+bool Benchmarks::TangentScaling(const Arguments& args)
+{
+	unsigned int maxThreads = args.size() > 1 ? (unsigned int)strtoul(args[1].c_str(), 0, 10) : 0;
+	if (maxThreads == 0)
+		maxThreads = Parallel::HardwareThreads();
+
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	std::vector<SubMesh> subMeshes;
+	std::vector<std::string> materialNames;
+	std::string name = args.empty() ? "a synthetic grid" : args[0];
+	if (args.empty())
+	{
+		// Big enough to be worth every thread
+		std::ostringstream text;
+		ObjReference::WriteSynthetic(text, 64 * 1024 * 1024);
+		std::string obj = text.str();
+		ObjLoader::Parse(obj.data(), obj.size(), verts, indices, subMeshes, materialNames);
+	}
+	else
+	{
+		std::wstring fileName = std::filesystem::path(name).wstring();
+		ObjLoader::LoadFile(fileName.c_str(), verts, indices, subMeshes, materialNames);
+	}
+
+	if (indices.empty())
+	{
+		printf("Could not load %s\n", name.c_str());
+		return false;
+	}
+
+	const int runs = 5;
+	auto time = [&](auto work)
+		{
+			double best = 0.0;
+			for (int run = 0; run < runs; run++)
+			{
+				auto startTime = std::chrono::steady_clock::now();
+				work();
+				std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - startTime;
+				if (run == 0 || seconds.count() < best)
+					best = seconds.count();
+			}
+			return best;
+		};
+
+	printf("Tangents for %s: %zu vertices, %zu triangles\n", name.c_str(), verts.size(), indices.size() / 3);
+	double referenceTime = time([&]() { Tangents::CalculateReference(verts.data(), verts.size(), indices.data(), indices.size()); });
+	printf("  reference        %9.2f ms\n", referenceTime * 1000.0);
+
+	for (unsigned int threads = 1; threads <= maxThreads; threads++)
+	{
+		double best = time([&]() { Tangents::Calculate(verts.data(), verts.size(), indices.data(), indices.size(), threads); });
+		printf("  SSE, %2u threads  %9.2f ms  %6.2fx\n", threads, best * 1000.0, referenceTime / best);
+	}
+	return true;
+}
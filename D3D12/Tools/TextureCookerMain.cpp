@@ -0,0 +1,32 @@
+#include "TextureCooker.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+// --------------------------------------------------------
+// Cooks a folder of source images into .dds files, which
+// the game then loads in their place (see TextureCooker.h)
+//
+// Usage: TextureCooker <folder> [bc1]
+// --------------------------------------------------------
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		printf("Usage: TextureCooker <folder> [bc1]\n");
+		printf("  Compresses every image in the folder to a .dds beside it (bc1 uses BC1 for albedo)\n");
+		return 1;
+	}
+
+	std::filesystem::path folder = argv[1];
+	if (!std::filesystem::is_directory(folder))
+	{
+		printf("%s is not a folder\n", argv[1]);
+		return 1;
+	}
+
+	bool bc1Color = argc > 2 && strcmp(argv[2], "bc1") == 0;
+	TextureCooker::CookFolder(folder, bc1Color);
+	return 0;
+}
@@ -0,0 +1,124 @@
+#include "Benchmarks.h"
+#include "TlsfAllocator.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+// --------------------------------------------------------
+// Runs a random mix of allocations and frees that looks
+// like a heap of GPU resources: mostly small buffers, a
+// long tail of large ones, and D3D12's usual alignments.
+// Prints how fast it went, how fragmented the heap got and
+// how the memory used compares with what committed
+// resources (64 KB apiece) would have taken. EngineTests
+// checks the allocator's results on the same kind of load.
+// --------------------------------------------------------
+bool Benchmarks::TlsfWorkload(const Arguments& args)
+{
+	unsigned int operations = args.empty() ? 0 : (unsigned int)strtoul(args[0].c_str(), 0, 10);
+	if (operations == 0)
+		operations = 1000000;
+
+	const unsigned long long capacity = 256ull * 1024 * 1024;
+	const unsigned long long committedAlignment = 64 * 1024;
+	const unsigned long long alignments[] = { 256, 4096, 64 * 1024 };
+
+	// The random choices are made up front, so the timed run measures only the allocator.
+	// Sizes are log-uniform between 256 bytes and 8 MB.
+	struct Operation
+	{
+		unsigned long long size;
+		unsigned long long alignment;
+		unsigned int roll;
+		unsigned int pick;
+	};
+
+	std::vector<Operation> ops(operations);
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<double> exponent(8.0, 23.0);
+	for (Operation& op : ops)
+	{
+		op.size = (unsigned long long)std::pow(2.0, exponent(random));
+		op.alignment = alignments[random() % 3];
+		op.roll = random() % 100;
+		op.pick = random();
+	}
+
+	// Keeps the heap around 75% full. Every 1000 operations the
+	// fragmentation is sampled, if asked, which the timed run doesn't.
+	auto run = [&](TlsfAllocator& allocator, std::vector<TlsfAllocation>& live, bool sample, size_t& failures, double& fragmentation)
+		{
+			unsigned long long usedBytes = 0;
+			size_t samples = 0;
+			fragmentation = 0.0;
+
+			for (unsigned int op = 0; op < operations; op++)
+			{
+				double fill = (double)usedBytes / (double)capacity;
+				bool allocate = live.empty() || ops[op].roll < (fill < 0.75 ? 60u : 40u);
+				if (allocate)
+				{
+					TlsfAllocation allocation;
+					if (allocator.Allocate(ops[op].size, ops[op].alignment, allocation))
+					{
+						live.push_back(allocation);
+						usedBytes += allocation.size;
+					}
+					else
+						failures++;
+				}
+				else
+				{
+					size_t index = ops[op].pick % live.size();
+					usedBytes -= live[index].size;
+					allocator.Free(live[index]);
+					live[index] = live.back();
+					live.pop_back();
+				}
+
+				if (sample && op % 1000 == 999)
+				{
+					fragmentation += allocator.GetStats().Fragmentation();
+					samples++;
+				}
+			}
+
+			if (samples > 0)
+				fragmentation /= (double)samples;
+		};
+
+	TlsfAllocator allocator(capacity);
+	std::vector<TlsfAllocation> live;
+	size_t failures = 0;
+	double averageFragmentation = 0.0;
+	run(allocator, live, true, failures, averageFragmentation);
+
+	TlsfStats stats = allocator.GetStats();
+	unsigned long long committedBytes = 0;
+	for (const TlsfAllocation& allocation : live)
+		committedBytes += (allocation.size + committedAlignment - 1) / committedAlignment * committedAlignment;
+
+	// Timing, without the sampling
+	TlsfAllocator timed(capacity);
+	std::vector<TlsfAllocation> timedLive;
+	size_t timedFailures = 0;
+	double timedFragmentation = 0.0;
+	auto startTime = std::chrono::steady_clock::now();
+	run(timed, timedLive, false, timedFailures, timedFragmentation);
+	std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - startTime;
+
+	const double MB = 1024.0 * 1024.0;
+	printf("TLSF allocator: %u random operations in %.0f MB\n", operations, capacity / MB);
+	printf("  %.1f ns per operation\n", seconds.count() * 1e9 / operations);
+	printf("  %zu allocations failed for lack of space\n", failures);
+	printf("  at the end: %zu allocations using %.2f MB, %.2f MB free in %zu ranges (largest %.2f MB)\n",
+		stats.allocations, stats.usedBytes / MB, stats.freeBytes / MB, stats.freeRanges, stats.largestFree / MB);
+	printf("  fragmentation: %.1f%% at the end, %.1f%% on average\n",
+		stats.Fragmentation() * 100.0, averageFragmentation * 100.0);
+	printf("  as committed resources the same allocations would take %.2f MB (%.1f%% more)\n",
+		committedBytes / MB, stats.usedBytes ? (committedBytes / (double)stats.usedBytes - 1.0) * 100.0 : 0.0);
+	return true;
+}
@@ -0,0 +1,57 @@
+#include "Benchmarks.h"
+#include "CpuZones.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+// --------------------------------------------------------
+// Times opening and closing CPU zones on this thread, and
+// collecting them. Zones go in batches of half a ring,
+// collected between batches (timed separately) so none are
+// dropped.
+// --------------------------------------------------------
+bool Benchmarks::ZoneCost(const Arguments& args)
+{
+#if CPU_ZONES_ENABLED
+	unsigned int zoneCount = args.empty() ? 0 : (unsigned int)strtoul(args[0].c_str(), 0, 10);
+	if (zoneCount == 0)
+		zoneCount = 1000000;
+
+	CpuZones::EndFrame();
+	size_t droppedBefore = CpuZones::GetDroppedZones();
+
+	double zoneSeconds = 0;
+	double collectSeconds = 0;
+	unsigned int done = 0;
+	while (done < zoneCount)
+	{
+		unsigned int batch = zoneCount - done < CpuZones::RingSize / 2 ? zoneCount - done : CpuZones::RingSize / 2;
+		auto startTime = std::chrono::high_resolution_clock::now();
+		for (unsigned int i = 0; i < batch; i++)
+		{
+			CPU_ZONE("Benchmark");
+		}
+		auto collectTime = std::chrono::high_resolution_clock::now();
+		CpuZones::EndFrame();
+		auto endTime = std::chrono::high_resolution_clock::now();
+
+		zoneSeconds += std::chrono::duration<double>(collectTime - startTime).count();
+		collectSeconds += std::chrono::duration<double>(endTime - collectTime).count();
+		done += batch;
+	}
+
+#ifdef CPU_ZONES_RDTSC
+	const char* clock = "rdtsc";
+#else
+	const char* clock = "steady_clock";
+#endif
+	size_t dropped = CpuZones::GetDroppedZones() - droppedBefore;
+	printf("CPU zones: %u zones at %.1f ns each (%s), collected at %.1f ns each, %zu dropped\n",
+		zoneCount, zoneSeconds * 1e9 / zoneCount, clock, collectSeconds * 1e9 / zoneCount, dropped);
+	return dropped == 0;
+#else
+	printf("CPU zones are compiled out (CPU_ZONES_ENABLED is 0)\n");
+	return false;
+#endif
+}
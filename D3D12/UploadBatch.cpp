@@ -0,0 +1,262 @@
+#include "UploadBatch.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Annonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// Buffer copies have no alignment rules, but this keeps memcpy happy
+	const size_t BufferAlignment = 16;
+
+	inline unsigned long long AlignUp(unsigned long long value, unsigned long long alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+UploadRing::UploadRing(size_t capacity)
+{
+	Reset(capacity);
+}
+
+void UploadRing::Reset(size_t capacity)
+{
+	this->capacity = capacity;
+	head = tail = closedEnd = 0;
+	regions.clear();
+}
+
+// --------------------------------------------------------
+// Hands out the next size bytes, skipping to the start of
+// the ring if they'd run past its end. Fails if that would
+// reach into bytes the GPU might still be reading.
+//
+// size      - Bytes needed
+// alignment - Power of two the offset must be a multiple of
+//             (the capacity should be a multiple of it too)
+// offset    - Receives the offset into the ring
+// --------------------------------------------------------
+bool UploadRing::Allocate(size_t size, size_t alignment, size_t& offset)
+{
+	if (size > capacity)
+		return false;
+
+	// Once everything is retired, start over at the front
+	if (head == tail)
+		head = tail = closedEnd = 0;
+
+	unsigned long long start = AlignUp(head, alignment);
+	if (size > 0 && start / capacity != (start + size - 1) / capacity)
+		start = AlignUp(start, capacity);
+
+	if (start + size - tail > capacity)
+		return false;
+
+	offset = (size_t)(start % capacity);
+	head = start + size;
+	return true;
+}
+
+void UploadRing::Close(unsigned long long fenceValue)
+{
+	if (head == closedEnd)
+		return;
+
+	Region region = { head, fenceValue };
+	regions.push_back(region);
+	closedEnd = head;
+}
+
+void UploadRing::Retire(unsigned long long completedFenceValue)
+{
+	while (!regions.empty() && regions.front().fenceValue <= completedFenceValue)
+	{
+		tail = regions.front().end;
+		regions.pop_front();
+	}
+}
+
+unsigned long long UploadRing::GetOldestFence()
+{
+	return regions.empty() ? 0 : regions.front().fenceValue;
+}
+
+bool UploadRing::HasOpenAllocations() { return head != closedEnd; }
+size_t UploadRing::GetCapacity() { return capacity; }
+size_t UploadRing::GetUsed() { return (size_t)(head - tail); }
+
+// --------------------------------------------------------
+// Creates the staging ring, rounded up so texture
+// allocations stay aligned when it wraps
+// --------------------------------------------------------
+UploadBatch::UploadBatch(UploadDevice* device, size_t stagingCapacity)
+{
+	this->device = device;
+	pendingCopies = false;
+	lastSubmitted = 0;
+
+	size_t capacity = (size_t)AlignUp(std::max(stagingCapacity, TextureAlignment), TextureAlignment);
+	ring.Reset(capacity);
+	staging = (unsigned char*)device->CreateStaging(capacity);
+}
+
+UploadBatch::~UploadBatch()
+{
+	// The GPU may still be reading the staging memory
+	WaitForIdle();
+}
+
+// --------------------------------------------------------
+// Copies buffer data into staging memory and records the
+// copy. Buffers bigger than a quarter of the ring go up in
+// pieces, so they never need the whole ring to themselves.
+// --------------------------------------------------------
+void UploadBatch::UploadBuffer(void* destination, const void* data, size_t size, size_t destinationOffset)
+{
+	const unsigned char* source = (const unsigned char*)data;
+	size_t maxPiece = std::max(ring.GetCapacity() / 4, BufferAlignment);
+
+	while (size > 0)
+	{
+		size_t piece = std::min(size, maxPiece);
+		size_t offset = AllocateStaging(piece, BufferAlignment);
+		memcpy(staging + offset, source, piece);
+		device->CopyBuffer(destination, destinationOffset, offset, piece);
+
+		pendingCopies = true;
+		stats.bytes += piece;
+		stats.copies++;
+
+		source += piece;
+		destinationOffset += piece;
+		size -= piece;
+	}
+}
+
+// --------------------------------------------------------
+// Copies each subresource into staging memory row by row,
+// using the device's layout (which pads rows out to its
+// required pitch), and records one copy per subresource
+// --------------------------------------------------------
+void UploadBatch::UploadTexture(void* texture, const UploadSubresource* subresources, unsigned int subresourceCount,
+	unsigned int firstSubresource)
+{
+	if (subresourceCount == 0)
+		return;
+
+	std::vector<UploadFootprint> footprints(subresourceCount);
+	unsigned long long totalBytes = device->GetTextureFootprints(texture, firstSubresource, subresourceCount, footprints.data());
+	size_t offset = AllocateStaging((size_t)totalBytes, TextureAlignment);
+
+	for (unsigned int i = 0; i < subresourceCount; i++)
+	{
+		const UploadFootprint& footprint = footprints[i];
+		const UploadSubresource& source = subresources[i];
+		unsigned char* destination = staging + offset + footprint.offset;
+
+		for (unsigned int z = 0; z < footprint.depth; z++)
+		{
+			for (unsigned int row = 0; row < footprint.rowCount; row++)
+			{
+				memcpy(
+					destination + ((size_t)z * footprint.rowCount + row) * footprint.rowPitch,
+					(const unsigned char*)source.data + z * source.slicePitch + row * source.rowPitch,
+					(size_t)footprint.rowSize);
+			}
+		}
+
+		device->CopyTexture(texture, firstSubresource + i, offset + (size_t)footprint.offset, footprint);
+		stats.copies++;
+	}
+
+	pendingCopies = true;
+	stats.bytes += (size_t)totalBytes;
+}
+
+UploadTicket UploadBatch::Submit()
+{
+	if (pendingCopies)
+	{
+		lastSubmitted = device->Execute();
+		ring.Close(lastSubmitted);
+		pendingCopies = false;
+		stats.submits++;
+	}
+
+	// Free whatever has finished in the meantime
+	ring.Retire(device->GetCompletedValue());
+
+	UploadTicket ticket;
+	ticket.fenceValue = lastSubmitted;
+	return ticket;
+}
+
+bool UploadBatch::IsComplete(UploadTicket ticket)
+{
+	return device->GetCompletedValue() >= ticket.fenceValue;
+}
+
+void UploadBatch::Wait(UploadTicket ticket)
+{
+	if (!IsComplete(ticket))
+		device->WaitForValue(ticket.fenceValue);
+
+	ring.Retire(device->GetCompletedValue());
+}
+
+void UploadBatch::WaitForIdle()
+{
+	Wait(Submit());
+}
+
+bool UploadBatch::HasPendingCopies() { return pendingCopies; }
+UploadStats UploadBatch::GetStats() { return stats; }
+
+void UploadBatch::PrintStats()
+{
+	printf("Uploads: %.2f MB in %zu copies, %zu submits, %zu stalls\n",
+		stats.bytes / (1024.0 * 1024.0), stats.copies, stats.submits, stats.stalls);
+}
+
+// --------------------------------------------------------
+// Finds staging space for an upload. When the ring is
+// full, whatever's been recorded is submitted and the CPU
+// waits for the oldest submission still holding space.
+// Anything bigger than the whole ring gets a bigger ring.
+// --------------------------------------------------------
+size_t UploadBatch::AllocateStaging(size_t size, size_t alignment)
+{
+	if (size > ring.GetCapacity())
+	{
+		WaitForIdle();
+		stats.stalls++;
+
+		size_t capacity = ring.GetCapacity();
+		while (capacity < size)
+			capacity *= 2;
+
+		ring.Reset(capacity);
+		staging = (unsigned char*)device->CreateStaging(capacity);
+	}
+
+	size_t offset = 0;
+	while (!ring.Allocate(size, alignment, offset))
+	{
+		if (ring.HasOpenAllocations())
+			Submit();
+
+		unsigned long long oldest = ring.GetOldestFence();
+		if (oldest > device->GetCompletedValue())
+		{
+			device->WaitForValue(oldest);
+			stats.stalls++;
+		}
+		ring.Retire(device->GetCompletedValue());
+	}
+
+	return offset;
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+
+// Identifies one submission of an UploadBatch. Fence values only
+// ever grow, so a ticket is complete once the device's completed
+// fence value reaches it.
+struct UploadTicket
+{
+	unsigned long long fenceValue = 0;
+};
+
+// One subresource's worth of source data (same layout as D3D12_SUBRESOURCE_DATA)
+struct UploadSubresource
+{
+	const void* data;
+	long long rowPitch;
+	long long slicePitch;
+};
+
+// Where a texture subresource lives inside the staging memory,
+// relative to the start of the texture's staging allocation
+struct UploadFootprint
+{
+	unsigned long long offset;
+	unsigned int rowPitch;		// Bytes between rows in staging memory
+	unsigned int rowCount;		// Rows per slice
+	unsigned long long rowSize;	// Bytes of actual data per row
+	unsigned int depth;			// Slices
+};
+
+// Running totals, for seeing how much the batching saves
+struct UploadStats
+{
+	size_t bytes = 0;
+	size_t copies = 0;
+	size_t submits = 0;
+	size_t stalls = 0;			// Times the CPU had to wait for staging space
+};
+
+// --------------------------------------------------------
+// The handful of GPU operations UploadBatch needs, so the
+// batching and staging logic doesn't depend on D3D12 (see
+// UploadDeviceD3D12.h) and can run against a fake device.
+//
+// Resources are the device's own handles, passed through
+// untouched (ID3D12Resource pointers for D3D12).
+// --------------------------------------------------------
+class UploadDevice
+{
+public:
+
+	virtual ~UploadDevice() {}
+
+	// Replaces the staging buffer with a persistently mapped one of
+	// the given size and returns its CPU address. Only called while
+	// nothing is in flight.
+	virtual void* CreateStaging(size_t capacity) = 0;
+
+	// Records a copy from staging memory into a buffer
+	virtual void CopyBuffer(void* destination, size_t destinationOffset, size_t stagingOffset, size_t size) = 0;
+
+	// Lays out the given subresources of a texture in staging memory,
+	// filling in one footprint each. Returns the total byte size.
+	virtual unsigned long long GetTextureFootprints(void* texture, unsigned int firstSubresource,
+		unsigned int subresourceCount, UploadFootprint* footprints) = 0;
+
+	// Records a copy into one texture subresource, whose footprint
+	// starts at stagingOffset in staging memory
+	virtual void CopyTexture(void* texture, unsigned int subresource, size_t stagingOffset, const UploadFootprint& footprint) = 0;
+
+	// Submits everything recorded so far, signals a fence after it and
+	// starts recording again. Returns the signalled fence value.
+	virtual unsigned long long Execute() = 0;
+
+	virtual unsigned long long GetCompletedValue() = 0;
+	virtual void WaitForValue(unsigned long long fenceValue) = 0;
+};
+
+// --------------------------------------------------------
+// Linear sub-allocator over a fixed-size ring of bytes
+//
+// Allocations are handed out in order and freed in the same
+// order: everything allocated before Close() is tagged with
+// that fence value, and Retire() frees it all once the fence
+// is reached. An allocation never wraps around the end, so
+// each one is a single contiguous range.
+// --------------------------------------------------------
+class UploadRing
+{
+public:
+
+	UploadRing(size_t capacity = 0);
+
+	// Forgets every allocation and switches to a new capacity
+	void Reset(size_t capacity);
+
+	// Finds room for size bytes at the given (power of two) alignment.
+	// Returns false if that can't happen until more work is retired.
+	bool Allocate(size_t size, size_t alignment, size_t& offset);
+
+	// Tags everything allocated since the last Close() with a fence value
+	void Close(unsigned long long fenceValue);
+
+	// Frees every closed range whose fence value has been reached
+	void Retire(unsigned long long completedFenceValue);
+
+	// Oldest fence value still holding on to space, or 0 if there are none
+	unsigned long long GetOldestFence();
+
+	bool HasOpenAllocations();
+	size_t GetCapacity();
+	size_t GetUsed();
+
+private:
+
+	// A closed run of allocations, ending at the given position
+	struct Region
+	{
+		unsigned long long end;
+		unsigned long long fenceValue;
+	};
+
+	size_t capacity;
+
+	// Positions count bytes since the last Reset(), so they never wrap.
+	// The ring offset of a position is position % capacity.
+	unsigned long long head;		// Next free byte
+	unsigned long long tail;		// Oldest byte still in use
+	unsigned long long closedEnd;	// End of the last closed region
+
+	std::deque<Region> regions;
+};
+
+// --------------------------------------------------------
+// Batches buffer and texture uploads into as few GPU
+// submissions as possible
+//
+// Source data is copied straight into a persistently mapped
+// staging ring and the matching GPU copies are recorded on
+// one command list, so uploading many resources costs one
+// submission instead of one stall each. Submit() hands back
+// a ticket that can be polled or waited on. The CPU only
+// waits when the staging ring is full, and then only for
+// the oldest submission still using it.
+//
+// Destination resources must stay alive until the ticket of
+// the submission that uploads them is complete.
+// --------------------------------------------------------
+class UploadBatch
+{
+public:
+
+	// Staging allocations for textures must start on this boundary
+	static constexpr size_t TextureAlignment = 512;
+
+	UploadBatch(UploadDevice* device, size_t stagingCapacity);
+	~UploadBatch();
+	UploadBatch(const UploadBatch&) = delete;
+	UploadBatch& operator=(const UploadBatch&) = delete;
+
+	// Copies size bytes into the destination buffer, starting at destinationOffset
+	void UploadBuffer(void* destination, const void* data, size_t size, size_t destinationOffset = 0);
+
+	// Copies the given subresources into the texture, starting at firstSubresource
+	void UploadTexture(void* texture, const UploadSubresource* subresources, unsigned int subresourceCount,
+		unsigned int firstSubresource = 0);
+
+	// Sends everything recorded since the last submit to the GPU.
+	// With nothing recorded, returns the previous submission's ticket.
+	UploadTicket Submit();
+
+	bool IsComplete(UploadTicket ticket);
+	void Wait(UploadTicket ticket);
+
+	// Submits anything pending and waits for all of it
+	void WaitForIdle();
+
+	bool HasPendingCopies();
+	UploadStats GetStats();
+	void PrintStats();
+
+private:
+
+	UploadDevice* device;
+	UploadRing ring;
+	unsigned char* staging;
+	bool pendingCopies;
+	unsigned long long lastSubmitted;
+	UploadStats stats;
+
+	// Finds staging space, submitting and waiting as needed
+	size_t AllocateStaging(size_t size, size_t alignment);
+};
@@ -0,0 +1,195 @@
+#include "UploadDeviceD3D12.h"
+
+#include <vector>
+
+// --------------------------------------------------------
+// Creates the copy queue, its command list and the fence
+// that tracks submissions. Staging memory comes later,
+// from CreateStaging().
+// --------------------------------------------------------
+UploadDeviceD3D12::UploadDeviceD3D12(ID3D12Device* device)
+{
+	this->device = device;
+	fenceValue = 0;
+
+	D3D12_COMMAND_QUEUE_DESC qDesc = {};
+	qDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+	qDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+	device->CreateCommandQueue(&qDesc, IID_PPV_ARGS(queue.GetAddressOf()));
+
+	device->CreateCommandAllocator(
+		D3D12_COMMAND_LIST_TYPE_COPY,
+		IID_PPV_ARGS(allocator.GetAddressOf()));
+
+	// Lists start out open, ready for recording
+	device->CreateCommandList(
+		0,
+		D3D12_COMMAND_LIST_TYPE_COPY,
+		allocator.Get(),
+		0,
+		IID_PPV_ARGS(list.GetAddressOf()));
+
+	device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(fence.GetAddressOf()));
+	fenceEvent = CreateEventEx(0, 0, 0, EVENT_ALL_ACCESS);
+}
+
+UploadDeviceD3D12::~UploadDeviceD3D12()
+{
+	// Don't pull anything out from under the copy queue
+	WaitForValue(fenceValue);
+	CloseHandle(fenceEvent);
+}
+
+// --------------------------------------------------------
+// Replaces the staging buffer with a new upload heap
+// buffer, which stays mapped for its whole lifetime
+// --------------------------------------------------------
+void* UploadDeviceD3D12::CreateStaging(size_t capacity)
+{
+	staging.Reset();
+
+	D3D12_HEAP_PROPERTIES heapProps = {};
+	heapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	heapProps.CreationNodeMask = 1;
+	heapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	heapProps.Type = D3D12_HEAP_TYPE_UPLOAD;
+	heapProps.VisibleNodeMask = 1;
+
+	D3D12_RESOURCE_DESC resDesc = {};
+	resDesc.Alignment = 0;
+	resDesc.DepthOrArraySize = 1;
+	resDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	resDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+	resDesc.Format = DXGI_FORMAT_UNKNOWN;
+	resDesc.Height = 1;
+	resDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	resDesc.MipLevels = 1;
+	resDesc.SampleDesc.Count = 1;
+	resDesc.SampleDesc.Quality = 0;
+	resDesc.Width = capacity;
+
+	device->CreateCommittedResource(
+		&heapProps,
+		D3D12_HEAP_FLAG_NONE,
+		&resDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		0,
+		IID_PPV_ARGS(staging.GetAddressOf()));
+
+	// Keep mapped! The CPU never reads it back.
+	void* address = 0;
+	D3D12_RANGE range{ 0, 0 };
+	staging->Map(0, &range, &address);
+	return address;
+}
+
+void UploadDeviceD3D12::CopyBuffer(void* destination, size_t destinationOffset, size_t stagingOffset, size_t size)
+{
+	list->CopyBufferRegion(
+		(ID3D12Resource*)destination,
+		destinationOffset,
+		staging.Get(),
+		stagingOffset,
+		size);
+}
+
+unsigned long long UploadDeviceD3D12::GetTextureFootprints(void* texture, unsigned int firstSubresource,
+	unsigned int subresourceCount, UploadFootprint* footprints)
+{
+	D3D12_RESOURCE_DESC desc = ((ID3D12Resource*)texture)->GetDesc();
+
+	std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts(subresourceCount);
+	std::vector<UINT> rowCounts(subresourceCount);
+	std::vector<UINT64> rowSizes(subresourceCount);
+	UINT64 totalBytes = 0;
+
+	device->GetCopyableFootprints(&desc, firstSubresource, subresourceCount, 0,
+		layouts.data(), rowCounts.data(), rowSizes.data(), &totalBytes);
+
+	for (unsigned int i = 0; i < subresourceCount; i++)
+	{
+		footprints[i].offset = layouts[i].Offset;
+		footprints[i].rowPitch = layouts[i].Footprint.RowPitch;
+		footprints[i].rowCount = rowCounts[i];
+		footprints[i].rowSize = rowSizes[i];
+		footprints[i].depth = layouts[i].Footprint.Depth;
+	}
+
+	return totalBytes;
+}
+
+// --------------------------------------------------------
+// Records a copy into one texture subresource. The layout
+// is asked for again rather than rebuilt from the footprint,
+// since the copy also needs the subresource's format and
+// dimensions.
+// --------------------------------------------------------
+void UploadDeviceD3D12::CopyTexture(void* texture, unsigned int subresource, size_t stagingOffset, const UploadFootprint& footprint)
+{
+	ID3D12Resource* resource = (ID3D12Resource*)texture;
+	D3D12_RESOURCE_DESC desc = resource->GetDesc();
+
+	D3D12_TEXTURE_COPY_LOCATION source = {};
+	source.pResource = staging.Get();
+	source.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+	device->GetCopyableFootprints(&desc, subresource, 1, stagingOffset, &source.PlacedFootprint, 0, 0, 0);
+
+	D3D12_TEXTURE_COPY_LOCATION destination = {};
+	destination.pResource = resource;
+	destination.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+	destination.SubresourceIndex = subresource;
+
+	list->CopyTextureRegion(&destination, 0, 0, 0, &source, 0);
+}
+
+// --------------------------------------------------------
+// Submits the recorded copies and signals the next fence
+// value after them. The allocator holding those commands
+// is set aside until that value is reached, and recording
+// carries on with one that's free.
+// --------------------------------------------------------
+unsigned long long UploadDeviceD3D12::Execute()
+{
+	list->Close();
+	ID3D12CommandList* lists[] = { list.Get() };
+	queue->ExecuteCommandLists(1, lists);
+
+	fenceValue++;
+	queue->Signal(fence.Get(), fenceValue);
+
+	RetiredAllocator retired = { allocator, fenceValue };
+	retiredAllocators.push_back(retired);
+
+	if (retiredAllocators.front().fenceValue <= fence->GetCompletedValue())
+	{
+		allocator = retiredAllocators.front().allocator;
+		retiredAllocators.pop_front();
+	}
+	else
+	{
+		allocator.Reset();
+		device->CreateCommandAllocator(
+			D3D12_COMMAND_LIST_TYPE_COPY,
+			IID_PPV_ARGS(allocator.GetAddressOf()));
+	}
+
+	allocator->Reset();
+	list->Reset(allocator.Get(), 0);
+	return fenceValue;
+}
+
+unsigned long long UploadDeviceD3D12::GetCompletedValue()
+{
+	return fence->GetCompletedValue();
+}
+
+void UploadDeviceD3D12::WaitForValue(unsigned long long fenceValue)
+{
+	if (fence->GetCompletedValue() >= fenceValue)
+		return;
+
+	fence->SetEventOnCompletion(fenceValue, fenceEvent);
+	WaitForSingleObject(fenceEvent, INFINITE);
+}
+
+ID3D12Fence* UploadDeviceD3D12::GetFence() { return fence.Get(); }
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <Windows.h>
+#include <d3d12.h>
+#include <deque>
+#include <wrl/client.h>
+#include "UploadBatch.h"
+
+// --------------------------------------------------------
+// UploadBatch's device on its own D3D12 copy queue
+//
+// Copies are recorded on one copy command list and run
+// alongside rendering. Nothing on the direct queue may use
+// an uploaded resource until it has waited on GetFence()
+// for the upload's ticket (see Graphics::FlushUploads).
+//
+// Destinations are ID3D12Resource pointers that must be in
+// the COMMON or COPY_DEST state. They decay back to COMMON
+// once the copy queue is done with them.
+// --------------------------------------------------------
+class UploadDeviceD3D12 : public UploadDevice
+{
+public:
+
+	UploadDeviceD3D12(ID3D12Device* device);
+	~UploadDeviceD3D12();
+	UploadDeviceD3D12(const UploadDeviceD3D12&) = delete;
+	UploadDeviceD3D12& operator=(const UploadDeviceD3D12&) = delete;
+
+	void* CreateStaging(size_t capacity) override;
+	void CopyBuffer(void* destination, size_t destinationOffset, size_t stagingOffset, size_t size) override;
+	unsigned long long GetTextureFootprints(void* texture, unsigned int firstSubresource,
+		unsigned int subresourceCount, UploadFootprint* footprints) override;
+	void CopyTexture(void* texture, unsigned int subresource, size_t stagingOffset, const UploadFootprint& footprint) override;
+	unsigned long long Execute() override;
+	unsigned long long GetCompletedValue() override;
+	void WaitForValue(unsigned long long fenceValue) override;
+
+	// Signalled by the copy queue with each ticket's fence value
+	ID3D12Fence* GetFence();
+
+private:
+
+	// An allocator whose commands are still in flight until fenceValue
+	struct RetiredAllocator
+	{
+		Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator;
+		unsigned long long fenceValue;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D12Device> device;
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue> queue;
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> list;
+	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator;
+	std::deque<RetiredAllocator> retiredAllocators;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> staging;
+
+	Microsoft::WRL::ComPtr<ID3D12Fence> fence;
+	HANDLE fenceEvent;
+	unsigned long long fenceValue;
+};
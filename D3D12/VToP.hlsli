@@ -16,7 +16,7 @@ struct VertexToPixel
     float4 screenPosition : SV_POSITION; // XYZW position (System Value Position)
     float3 normal : NORMAL; // XYZ normal
     float2 uv : TEXCOORD; // UVs
-    float3 tangent : TANGENT; // XYZ tangent
+    float4 tangent : TANGENT; // XYZ tangent, W bitangent sign
     float3 worldPosition : WORLDPOSITION; // world XYZ position
 };
 
@@ -12,5 +12,22 @@ struct Vertex
 	DirectX::XMFLOAT3 Position;	    // The local position of the vertex
 	DirectX::XMFLOAT3 Normal;       // This vertex's normal
 	DirectX::XMFLOAT2 UV;           // The UV coord of this vertex
-	DirectX::XMFLOAT3 Tangent;      // Tangent for normal mapping
-};
\ No newline at end of file
+	DirectX::XMFLOAT4 Tangent;      // Tangent for normal mapping, w = bitangent sign
+};
+
+// --------------------------------------------------------
+// The compact vertex actually stored in GPU buffers (20 bytes)
+//
+// Built from a Vertex by VertexPacking::Encode() and decoded
+// at the top of VertexShader.hlsl:
+//  - Position is 16-bit UNORM within the mesh's bounding box,
+//    with the tangent's bitangent sign in w (0 = -1, 1 = +1)
+//  - Normal and tangent are octahedral-encoded 16-bit SNORM
+//  - UV is a pair of half floats
+// --------------------------------------------------------
+struct PackedVertex
+{
+	unsigned short Position[4];	    // R16G16B16A16_UNORM
+	short NormalTangent[4];         // R16G16B16A16_SNORM (normal xy, tangent zw)
+	unsigned short UV[2];           // R16G16_FLOAT
+};
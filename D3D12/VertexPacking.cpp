@@ -0,0 +1,288 @@
+#include "VertexPacking.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace VertexPacking
+{
+	// Annonymous namespace to hold helpers
+	// only accessible in this file
+	namespace
+	{
+		const float SnormScale = 32767.0f;
+		const float UnormScale = 65535.0f;
+
+		inline float Clamp(float value, float low, float high)
+		{
+			return value < low ? low : (value > high ? high : value);
+		}
+
+		inline float Length(const XMFLOAT3& v)
+		{
+			return std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+		}
+
+		// Angle between two directions, accurate even when tiny
+		float AngleDegrees(const XMFLOAT3& a, const XMFLOAT3& b)
+		{
+			double cx = (double)a.y * b.z - (double)a.z * b.y;
+			double cy = (double)a.z * b.x - (double)a.x * b.z;
+			double cz = (double)a.x * b.y - (double)a.y * b.x;
+			double dot = (double)a.x * b.x + (double)a.y * b.y + (double)a.z * b.z;
+			return (float)(std::atan2(std::sqrt(cx * cx + cy * cy + cz * cz), dot) * 57.29577951308232);
+		}
+
+		inline unsigned short QuantizeUnorm(float value, float offset, float scale)
+		{
+			float n = scale > 0.0f ? (value - offset) / scale : 0.0f;
+			return (unsigned short)(Clamp(n, 0.0f, 1.0f) * UnormScale + 0.5f);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Positions are stored relative to the bounding box, so the
+// full 16 bits cover exactly the space the mesh occupies
+// --------------------------------------------------------
+PositionQuantization VertexPacking::ComputeQuantization(XMFLOAT3 boundsMin, XMFLOAT3 boundsMax)
+{
+	PositionQuantization quantization;
+	quantization.scale = XMFLOAT3(
+		boundsMax.x - boundsMin.x,
+		boundsMax.y - boundsMin.y,
+		boundsMax.z - boundsMin.z);
+	quantization.offset = boundsMin;
+	return quantization;
+}
+
+PackedVertex VertexPacking::Encode(const Vertex& v, const PositionQuantization& quantization)
+{
+	PackedVertex packed;
+	packed.Position[0] = QuantizeUnorm(v.Position.x, quantization.offset.x, quantization.scale.x);
+	packed.Position[1] = QuantizeUnorm(v.Position.y, quantization.offset.y, quantization.scale.y);
+	packed.Position[2] = QuantizeUnorm(v.Position.z, quantization.offset.z, quantization.scale.z);
+	packed.Position[3] = v.Tangent.w < 0.0f ? 0 : 65535;
+
+	OctEncode(v.Normal, packed.NormalTangent[0], packed.NormalTangent[1]);
+	OctEncode(XMFLOAT3(v.Tangent.x, v.Tangent.y, v.Tangent.z), packed.NormalTangent[2], packed.NormalTangent[3]);
+
+	packed.UV[0] = FloatToHalf(v.UV.x);
+	packed.UV[1] = FloatToHalf(v.UV.y);
+	return packed;
+}
+
+// --------------------------------------------------------
+// Does exactly what the input assembler and the top of
+// VertexShader.hlsl do with a PackedVertex
+// --------------------------------------------------------
+Vertex VertexPacking::Decode(const PackedVertex& packed, const PositionQuantization& quantization)
+{
+	Vertex v;
+	v.Position = XMFLOAT3(
+		packed.Position[0] / UnormScale * quantization.scale.x + quantization.offset.x,
+		packed.Position[1] / UnormScale * quantization.scale.y + quantization.offset.y,
+		packed.Position[2] / UnormScale * quantization.scale.z + quantization.offset.z);
+
+	v.Normal = OctDecode(packed.NormalTangent[0], packed.NormalTangent[1]);
+	XMFLOAT3 tangent = OctDecode(packed.NormalTangent[2], packed.NormalTangent[3]);
+	v.Tangent = XMFLOAT4(tangent.x, tangent.y, tangent.z, packed.Position[3] / UnormScale * 2.0f - 1.0f);
+
+	v.UV = XMFLOAT2(HalfToFloat(packed.UV[0]), HalfToFloat(packed.UV[1]));
+	return v;
+}
+
+void VertexPacking::EncodeAll(const Vertex* verts, size_t count, const PositionQuantization& quantization, PackedVertex* packed)
+{
+	for (size_t i = 0; i < count; i++)
+		packed[i] = Encode(verts[i], quantization);
+}
+
+// --------------------------------------------------------
+// Round trips every vertex and records the worst error of
+// each attribute. Zero-length normals and tangents (which
+// can't be encoded meaningfully) are ignored.
+// --------------------------------------------------------
+PackingError VertexPacking::MeasureError(const Vertex* verts, size_t count, const PositionQuantization& quantization)
+{
+	// Half a quantization step, plus float rounding in the decode
+	PackingError error;
+	const float* scale = &quantization.scale.x;
+	const float* offset = &quantization.offset.x;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float bound = scale[axis] / UnormScale * 0.5f + (std::fabs(offset[axis]) + scale[axis]) * FLT_EPSILON;
+		if (bound > error.positionBound) error.positionBound = bound;
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const Vertex& original = verts[i];
+		Vertex decoded = Decode(Encode(original, quantization), quantization);
+
+		float dx = std::fabs(decoded.Position.x - original.Position.x);
+		float dy = std::fabs(decoded.Position.y - original.Position.y);
+		float dz = std::fabs(decoded.Position.z - original.Position.z);
+		if (dx > error.position) error.position = dx;
+		if (dy > error.position) error.position = dy;
+		if (dz > error.position) error.position = dz;
+
+		if (Length(original.Normal) > 0.0f)
+		{
+			float angle = AngleDegrees(original.Normal, decoded.Normal);
+			if (angle > error.normalDegrees) error.normalDegrees = angle;
+		}
+
+		XMFLOAT3 tangent(original.Tangent.x, original.Tangent.y, original.Tangent.z);
+		if (Length(tangent) > 0.0f)
+		{
+			float angle = AngleDegrees(tangent, XMFLOAT3(decoded.Tangent.x, decoded.Tangent.y, decoded.Tangent.z));
+			if (angle > error.tangentDegrees) error.tangentDegrees = angle;
+		}
+
+		float u = std::fabs(decoded.UV.x - original.UV.x) / (std::fabs(original.UV.x) > 1.0f ? std::fabs(original.UV.x) : 1.0f);
+		float v = std::fabs(decoded.UV.y - original.UV.y) / (std::fabs(original.UV.y) > 1.0f ? std::fabs(original.UV.y) : 1.0f);
+		if (u > error.uvRelative) error.uvRelative = u;
+		if (v > error.uvRelative) error.uvRelative = v;
+
+		if ((original.Tangent.w < 0.0f) != (decoded.Tangent.w < 0.0f))
+			error.signMismatches++;
+	}
+
+	return error;
+}
+
+// --------------------------------------------------------
+// Float to IEEE half conversion, rounding to nearest even
+// like the GPU does. Out of range values become infinity.
+// --------------------------------------------------------
+unsigned short VertexPacking::FloatToHalf(float value)
+{
+	unsigned int bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	unsigned int sign = (bits >> 16) & 0x8000;
+	unsigned int exponent = (bits >> 23) & 0xFF;
+	unsigned int mantissa = bits & 0x7FFFFF;
+
+	// Infinity and NaN (keeping NaNs as NaNs)
+	if (exponent == 0xFF)
+		return (unsigned short)(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+
+	int halfExponent = (int)exponent - 127 + 15;
+	if (halfExponent >= 31)
+		return (unsigned short)(sign | 0x7C00);
+
+	// Too small for a normal half, so produce a subnormal (or zero)
+	if (halfExponent <= 0)
+	{
+		if (halfExponent < -10)
+			return (unsigned short)sign;
+
+		mantissa |= 0x800000;
+		unsigned int shift = (unsigned int)(14 - halfExponent);
+		unsigned int half = mantissa >> shift;
+		unsigned int remainder = mantissa & ((1u << shift) - 1);
+		unsigned int halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half & 1)))
+			half++;
+		return (unsigned short)(sign | half);
+	}
+
+	// Rounding up may carry into the exponent, which is still correct
+	unsigned int half = ((unsigned int)halfExponent << 10) | (mantissa >> 13);
+	unsigned int remainder = mantissa & 0x1FFF;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+		half++;
+	return (unsigned short)(sign | half);
+}
+
+float VertexPacking::HalfToFloat(unsigned short half)
+{
+	unsigned int sign = (unsigned int)(half & 0x8000) << 16;
+	unsigned int exponent = (half >> 10) & 0x1F;
+	unsigned int mantissa = half & 0x3FF;
+
+	unsigned int bits;
+	if (exponent == 0)
+	{
+		// Zero or subnormal
+		float value = mantissa * (1.0f / 16777216.0f);
+		return sign ? -value : value;
+	}
+	else if (exponent == 31)
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	else
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+// --------------------------------------------------------
+// Octahedral encoding: project the direction onto the
+// octahedron |x| + |y| + |z| = 1, then fold the lower half
+// over the upper half so it unwraps into a square. Of the
+// four 16-bit codes surrounding the exact result, the one
+// that decodes closest to the original is kept.
+// --------------------------------------------------------
+void VertexPacking::OctEncode(const XMFLOAT3& direction, short& x, short& y)
+{
+	float l1 = std::fabs(direction.x) + std::fabs(direction.y) + std::fabs(direction.z);
+	if (!(l1 > 0.0f))
+	{
+		x = y = 0;
+		return;
+	}
+
+	float u = direction.x / l1;
+	float v = direction.y / l1;
+	if (direction.z < 0.0f)
+	{
+		float foldedU = (1.0f - std::fabs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+		float foldedV = (1.0f - std::fabs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+		u = foldedU;
+		v = foldedV;
+	}
+
+	float length = Length(direction);
+	XMFLOAT3 unit(direction.x / length, direction.y / length, direction.z / length);
+
+	float baseU = std::floor(u * SnormScale);
+	float baseV = std::floor(v * SnormScale);
+	float bestDot = -2.0f;
+	for (int i = 0; i < 4; i++)
+	{
+		short cu = (short)Clamp(baseU + (i & 1), -SnormScale, SnormScale);
+		short cv = (short)Clamp(baseV + (i >> 1), -SnormScale, SnormScale);
+		XMFLOAT3 decoded = OctDecode(cu, cv);
+		float dot = decoded.x * unit.x + decoded.y * unit.y + decoded.z * unit.z;
+		if (dot > bestDot)
+		{
+			bestDot = dot;
+			x = cu;
+			y = cv;
+		}
+	}
+}
+
+XMFLOAT3 VertexPacking::OctDecode(short x, short y)
+{
+	// SNORM conversion, as done by the input assembler
+	float u = x / SnormScale;
+	float v = y / SnormScale;
+	if (u < -1.0f) u = -1.0f;
+	if (v < -1.0f) v = -1.0f;
+
+	// Unfold the lower half of the octahedron
+	float z = 1.0f - std::fabs(u) - std::fabs(v);
+	float t = z < 0.0f ? -z : 0.0f;
+	u += u >= 0.0f ? -t : t;
+	v += v >= 0.0f ? -t : t;
+
+	float length = std::sqrt(u * u + v * v + z * z);
+	return XMFLOAT3(u / length, v / length, z / length);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include "Vertex.h"
+
+// Maps 16-bit UNORM positions back into object space:
+// position = unorm * scale + offset
+struct PositionQuantization
+{
+	DirectX::XMFLOAT3 scale;	// Size of the bounding box
+	DirectX::XMFLOAT3 offset;	// Minimum corner of the bounding box
+};
+
+// Largest differences found between vertices and their
+// packed-then-unpacked versions
+struct PackingError
+{
+	float position = 0.0f;			// Object-space units, per axis
+	float positionBound = 0.0f;		// Half of the largest quantization step (+ rounding)
+	float normalDegrees = 0.0f;
+	float tangentDegrees = 0.0f;
+	float uvRelative = 0.0f;		// Relative to max(|uv|, 1)
+	size_t signMismatches = 0;		// Tangent w values that didn't survive
+};
+
+// --------------------------------------------------------
+// Converts between the full-precision Vertex used while
+// loading and the PackedVertex uploaded to the GPU
+//
+// Expected error bounds:
+//  - Position: half a step of 1/65535 of the box, per axis
+//  - Normal/tangent: under 0.01 degrees (16-bit octahedral)
+//  - UV: half float rounding, 2^-11 relative
+// --------------------------------------------------------
+namespace VertexPacking
+{
+	PositionQuantization ComputeQuantization(DirectX::XMFLOAT3 boundsMin, DirectX::XMFLOAT3 boundsMax);
+
+	PackedVertex Encode(const Vertex& v, const PositionQuantization& quantization);
+	Vertex Decode(const PackedVertex& v, const PositionQuantization& quantization);
+
+	void EncodeAll(const Vertex* verts, size_t count, const PositionQuantization& quantization, PackedVertex* packed);
+
+	// Packs and unpacks every vertex, returning the worst errors
+	PackingError MeasureError(const Vertex* verts, size_t count, const PositionQuantization& quantization);
+
+	// Building blocks, exposed for testing
+	unsigned short FloatToHalf(float value);
+	float HalfToFloat(unsigned short half);
+	void OctEncode(const DirectX::XMFLOAT3& direction, short& x, short& y);
+	DirectX::XMFLOAT3 OctDecode(short x, short y);
+}
@@ -12,10 +12,9 @@ struct VertexShaderInput
 	//  |   Name          Semantic
 	//  |    |                |
 	//  v    v                v
-	float3 localPosition	: POSITION;     // XYZ position
-	float3 normal			: NORMAL;       // XYZ normal
+	float4 packedPosition	: POSITION;     // XYZ position in the mesh bounds (0-1), W bitangent sign (0 or 1)
+	float4 packedNormal		: NORMAL;       // Octahedral normal (XY) and tangent (ZW), -1 to 1
     float2 uv               : TEXCOORD;     // UVs
-    float3 tangent          : TANGENT;      // XYZ tangent
 };
 
 cbuffer ExternalData : register(b0)
@@ -24,6 +23,22 @@ cbuffer ExternalData : register(b0)
     matrix worldInvTranspose;
     matrix view;
     matrix projection;
+
+    // Maps packed positions back into object space
+    float3 positionScale;
+    float3 positionOffset;
+}
+
+// --------------------------------------------------------
+// Unfolds an octahedral-encoded direction (must match
+// VertexPacking::OctDecode in the C++ code)
+// --------------------------------------------------------
+float3 OctDecode(float2 e)
+{
+    float3 v = float3(e.xy, 1.0f - abs(e.x) - abs(e.y));
+    float t = saturate(-v.z);
+    v.xy += v.xy >= 0.0f ? -t : t;
+    return normalize(v);
 }
 
 // --------------------------------------------------------
@@ -37,17 +52,22 @@ VertexToPixel main( VertexShaderInput input )
 {
 	// Set up output struct
     VertexToPixel output;
+
+	// Decode the packed vertex
+    float3 localPosition = input.packedPosition.xyz * positionScale + positionOffset;
+    float3 normal = OctDecode(input.packedNormal.xy);
+    float4 tangent = float4(OctDecode(input.packedNormal.zw), input.packedPosition.w * 2.0f - 1.0f);
 	
 	// Multiply the three matrices together first
     matrix wvp = mul(projection, mul(view, world));
-    output.screenPosition = mul(wvp, float4(input.localPosition, 1.0f));
+    output.screenPosition = mul(wvp, float4(localPosition, 1.0f));
 
 	// world position of the vertex
-    output.worldPosition = mul(world, float4(input.localPosition, 1.0f)).xyz;
+    output.worldPosition = mul(world, float4(localPosition, 1.0f)).xyz;
 	
 	// bring normal and tangent into world space
-    output.normal = mul((float3x3) worldInvTranspose, input.normal);
-    output.tangent = mul((float3x3) world, input.tangent);
+    output.normal = mul((float3x3) worldInvTranspose, normal);
+    output.tangent = float4(mul((float3x3) world, tangent.xyz), tangent.w);
 
 	// Pass UV to PS
     output.uv = input.uv;
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "SubMesh.h"
+#include "Vertex.h"
+
+// Before/after sizes of a welding pass
+struct WeldStats
+{
+	size_t verticesBefore = 0;
+	size_t verticesAfter = 0;
+	size_t bytesBefore = 0;
+	size_t bytesAfter = 0;
+};
+
+// --------------------------------------------------------
+// Merges vertices that are close enough to be considered
+// the same, remapping the index buffer to match
+// --------------------------------------------------------
+namespace VertexWelder
+{
+	// Merge vertices whose position, normal and uv are all within epsilon
+	// of an earlier vertex, dropping any triangles that collapse as a result.
+	// If given, the sub-meshes' index ranges shrink to match.
+	WeldStats WeldByDistance(std::vector<Vertex>& verts, std::vector<unsigned int>& indices, float epsilon,
+		std::vector<SubMesh>* subMeshes = 0);
+
+	void PrintStats(const char* label, const WeldStats& stats);
+}
@@ -153,6 +153,7 @@ HRESULT Window::Create(
 // per second, including:
 //  - The window's width & height
 //  - The current FPS and ms/frame
+//  - The slowest frames of the last second, and any hitches
 //  - The graphics API in use
 // --------------------------------------------------------
 void Window::UpdateStats(float totalTime)
@@ -168,6 +169,9 @@ void Window::UpdateStats(float totalTime)
 	// How long did each frame take?  (Approx)
 	float mspf = 1000.0f / (float)fpsFrameCounter;
 
+	// The average hides the occasional slow frame, so show those too
+	FrameStatsSummary frameStats = Graphics::GetFrameStats(1.0);
+
 	// Quick and dirty title bar text (mostly for debugging)
 	std::wostringstream output;
 	output.precision(6);
@@ -176,6 +180,8 @@ void Window::UpdateStats(float totalTime)
 		"    Height: " << windowHeight <<
 		"    FPS: " << fpsFrameCounter <<
 		"    Frame Time: " << mspf << "ms" <<
+		"    p99: " << frameStats.frameTime.p99 << "ms" <<
+		"    Hitches: " << frameStats.hitches <<
 		"    Graphics: " << Graphics::APIName();
 
 	// Actually update the title bar and reset fps data